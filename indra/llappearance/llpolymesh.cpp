@@ -798,6 +798,8 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
 		mScaledNormals		=   (LLVector4a*)(mVertexData + offset); offset += 4*nverts;
 		mBinormals			=   (LLVector4a*)(mVertexData + offset); offset += 4*nverts;
 		mScaledBinormals	=   (LLVector4a*)(mVertexData + offset); offset += 4*nverts; 
+		mMorphAccumulator.init(mSharedData->mNumVertices, mCoords, mScaledNormals, mNormals,
+							   mScaledBinormals, mBinormals, mClothingWeights, mTexCoords);
 		initializeForMorph();
 	}
 }
@@ -1511,6 +1513,8 @@ BOOL LLPolyMesh::setSharedFromCurrent()
 	// there is no easy way to reapply the morphs, so we just compute
 	// the change in the base mesh and apply that.
 
+	updateMorphNormals();
+
 	LLPolyMesh delta(mSharedData, NULL);
 	U32 nverts = delta.getNumVertices();
 
@@ -1675,6 +1679,7 @@ LLVector4a *LLPolyMesh::getWritableCoords()
 //-----------------------------------------------------------------------------
 LLVector4a *LLPolyMesh::getWritableNormals()
 {
+	updateMorphNormals();
 	return mNormals;
 }
 
@@ -1683,6 +1688,7 @@ LLVector4a *LLPolyMesh::getWritableNormals()
 //-----------------------------------------------------------------------------
 LLVector4a *LLPolyMesh::getWritableBinormals()
 {
+	updateMorphNormals();
 	return mBinormals;
 }
 
@@ -1720,6 +1726,27 @@ LLVector4a *LLPolyMesh::getScaledBinormals()
 }
 
 
+//-----------------------------------------------------------------------------
+// getMorphAccumulator()
+//-----------------------------------------------------------------------------
+LLPolyMorphAccumulator& LLPolyMesh::getMorphAccumulator()
+{
+	// LOD meshes share the vertex data of their reference mesh
+	return (mReferenceMesh && !mVertexData) ? mReferenceMesh->mMorphAccumulator : mMorphAccumulator;
+}
+
+//-----------------------------------------------------------------------------
+// updateMorphNormals()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::updateMorphNormals() const
+{
+	LLPolyMorphAccumulator& accumulator = const_cast<LLPolyMesh*>(this)->getMorphAccumulator();
+	if (accumulator.hasDirtyNormals())
+	{
+		accumulator.updateNormals();
+	}
+}
+
 //-----------------------------------------------------------------------------
 // initializeForMorph()
 //-----------------------------------------------------------------------------
@@ -1728,6 +1755,8 @@ void LLPolyMesh::initializeForMorph()
 	if (!mSharedData)
 		return;
 
+	mMorphAccumulator.clearDirtyNormals();
+
     LLVector4a::memcpyNonAliased16((F32*) mCoords, (F32*) mSharedData->mBaseCoords, sizeof(LLVector4a) * mSharedData->mNumVertices);
 	LLVector4a::memcpyNonAliased16((F32*) mNormals, (F32*) mSharedData->mBaseNormals, sizeof(LLVector4a) * mSharedData->mNumVertices);
 	LLVector4a::memcpyNonAliased16((F32*) mScaledNormals, (F32*) mSharedData->mBaseNormals, sizeof(LLVector4a) * mSharedData->mNumVertices);
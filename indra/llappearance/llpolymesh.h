@@ -244,11 +244,13 @@ public:
 
 	// Get normals
 	const LLVector4a	*getNormals() const{ 
+		updateMorphNormals();
 		return mNormals; 
 	}
 
 	// Get normals
 	const LLVector4a	*getBinormals() const{ 
+		updateMorphNormals();
 		return mBinormals; 
 	}
 
@@ -271,6 +273,11 @@ public:
 	LLVector4a *getWritableBinormals();
 	LLVector4a *getScaledBinormals();
 
+	// Morph targets deform the mesh through this; the output normals and
+	// binormals are brought up to date when they are next read.
+	LLPolyMorphAccumulator& getMorphAccumulator();
+	void updateMorphNormals() const;
+
 	// Get texCoords
 	const LLVector2	*getTexCoords() const { 
 		return mTexCoords; 
@@ -376,6 +383,8 @@ protected:
 	LLVector4a				*mClothingWeights;
 	// output texture coordinates
 	LLVector2				*mTexCoords;
+	// applies morph targets to the arrays above, unused by LOD meshes
+	LLPolyMorphAccumulator	mMorphAccumulator;
 	
 	LLPolyMesh				*mReferenceMesh;
 
@@ -59,6 +59,7 @@ LLPolyMorphData::LLPolyMorphData(const std::string& morph_name)
 	mNormals = NULL;
 	mBinormals = NULL;
 	mTexCoords = NULL;
+	mHasDegenerateBinormals = true;
 
 	mMesh = NULL;
 }
@@ -73,7 +74,8 @@ LLPolyMorphData::LLPolyMorphData(const LLPolyMorphData &rhs) :
 	mCoords(NULL),
 	mNormals(NULL),
 	mBinormals(NULL),
-	mTexCoords(NULL)
+	mTexCoords(NULL),
+	mHasDegenerateBinormals(rhs.mHasDegenerateBinormals)
 {
 	const S32 numVertices = mNumIndices;
 
@@ -213,9 +215,27 @@ BOOL LLPolyMorphData::loadBinary(LLFILE *fp, LLPolyMeshSharedData *mesh)
 	mAvgDistortion.mul(1.f/(F32)mNumIndices);
 	mAvgDistortion.normalize3fast();
 
+	updateDegenerateBinormals();
+
 	return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// updateDegenerateBinormals()
+//-----------------------------------------------------------------------------
+void LLPolyMorphData::updateDegenerateBinormals()
+{
+	mHasDegenerateBinormals = false;
+	for (U32 v = 0; v < mNumIndices; v++)
+	{
+		if (!mBinormals[v].isFinite3() || (mBinormals[v].dot3(mBinormals[v]).getF32() <= F_APPROXIMATELY_ZERO))
+		{
+			mHasDegenerateBinormals = true;
+			break;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 // freeData()
 //-----------------------------------------------------------------------------
@@ -544,9 +564,253 @@ BOOL LLPolyMorphData::setMorphFromMesh(LLPolyMesh *morph)
 	mTexCoords     = new_tex_coords;
 	mNumIndices    = nindices;
 
+	updateDegenerateBinormals();
+
 	return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// LLPolyMorphAccumulator()
+//-----------------------------------------------------------------------------
+LLPolyMorphAccumulator::LLPolyMorphAccumulator()
+	: mNumVertices(0),
+	  mCoords(NULL),
+	  mScaledNormals(NULL),
+	  mNormals(NULL),
+	  mScaledBinormals(NULL),
+	  mBinormals(NULL),
+	  mClothingWeights(NULL),
+	  mTexCoords(NULL)
+{
+}
+
+//-----------------------------------------------------------------------------
+// init()
+//-----------------------------------------------------------------------------
+void LLPolyMorphAccumulator::init(U32 num_vertices, LLVector4a* coords, LLVector4a* scaled_normals, LLVector4a* normals,
+								  LLVector4a* scaled_binormals, LLVector4a* binormals, LLVector4a* clothing_weights,
+								  LLVector2* tex_coords)
+{
+	mNumVertices = num_vertices;
+	mCoords = coords;
+	mScaledNormals = scaled_normals;
+	mNormals = normals;
+	mScaledBinormals = scaled_binormals;
+	mBinormals = binormals;
+	mClothingWeights = clothing_weights;
+	mTexCoords = tex_coords;
+
+	mDirty.assign(num_vertices, 0);
+	mDirtyVertices.clear();
+}
+
+// The loop of addMorph(), with the per vertex tests it doesn't need
+// compiled out.
+template <bool MASKED, bool CLOTHING, bool CHECK_BINORMALS>
+static void add_morph_deltas(const LLPolyMorphData* morph, F32 weight, const F32* mask_weights,
+							 LLVector4a* coords, LLVector4a* scaled_normals, LLVector4a* scaled_binormals,
+							 LLVector4a* clothing_weights, LLVector2* tex_coords,
+							 U8* dirty, std::vector<U32>& dirty_vertices)
+{
+	// guard against degenerate input data before we create NaNs when the
+	// normals are updated
+	LLVector4a default_binormal;
+	default_binormal.set(1, 0, 0, 1);
+
+	F32 vert_weight = weight;
+	LLVector4a coord_weight;
+	LLVector4a normal_weight;
+	coord_weight.splat(vert_weight);
+	normal_weight.splat(vert_weight * NORMAL_SOFTEN_FACTOR);
+
+	const U32 count = morph->mNumIndices;
+	const U32* vertex_indices = morph->mVertexIndices;
+	const LLVector4a* morph_coords = morph->mCoords;
+	const LLVector4a* morph_normals = morph->mNormals;
+	const LLVector4a* morph_binormals = morph->mBinormals;
+	const LLVector2* morph_tex_coords = morph->mTexCoords;
+
+	for (U32 vert_index_morph = 0; vert_index_morph < count; vert_index_morph++)
+	{
+		U32 vert_index_mesh = vertex_indices[vert_index_morph];
+
+		F32 mask_weight = 1.f;
+		if (MASKED)
+		{
+			mask_weight = mask_weights[vert_index_morph];
+			vert_weight = weight * mask_weight;
+			coord_weight.splat(vert_weight);
+			normal_weight.splat(vert_weight * NORMAL_SOFTEN_FACTOR);
+		}
+
+		LLVector4a delta;
+		delta.setMul(morph_coords[vert_index_morph], coord_weight);
+		coords[vert_index_mesh].add(delta);
+
+		if (CLOTHING)
+		{
+			LLVector4a* clothing_weight = &clothing_weights[vert_index_mesh];
+			clothing_weight->add(delta);
+			clothing_weight->getF32ptr()[VW] = mask_weight;
+		}
+
+		delta.setMul(morph_normals[vert_index_morph], normal_weight);
+		scaled_normals[vert_index_mesh].add(delta);
+
+		const LLVector4a* binormal = &morph_binormals[vert_index_morph];
+		if (CHECK_BINORMALS &&
+			(!binormal->isFinite3() || (binormal->dot3(*binormal).getF32() <= F_APPROXIMATELY_ZERO)))
+		{
+			binormal = &default_binormal;
+		}
+		delta.setMul(*binormal, normal_weight);
+		scaled_binormals[vert_index_mesh].add(delta);
+
+		LLVector2& tex_coord = tex_coords[vert_index_mesh];
+		tex_coord.mV[VX] += morph_tex_coords[vert_index_morph].mV[VX] * vert_weight;
+		tex_coord.mV[VY] += morph_tex_coords[vert_index_morph].mV[VY] * vert_weight;
+
+		if (!dirty[vert_index_mesh])
+		{
+			dirty[vert_index_mesh] = 1;
+			dirty_vertices.push_back(vert_index_mesh);
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// addMorph()
+//-----------------------------------------------------------------------------
+void LLPolyMorphAccumulator::addMorph(const LLPolyMorphData* morph, F32 weight, const F32* mask_weights, bool clothing)
+{
+	if (!morph->mNumIndices)
+	{
+		return;
+	}
+
+	typedef void (*add_func_t)(const LLPolyMorphData*, F32, const F32*, LLVector4a*, LLVector4a*, LLVector4a*,
+							   LLVector4a*, LLVector2*, U8*, std::vector<U32>&);
+	static const add_func_t add_funcs[8] =
+	{
+		add_morph_deltas<false, false, false>,
+		add_morph_deltas<false, false, true>,
+		add_morph_deltas<false, true, false>,
+		add_morph_deltas<false, true, true>,
+		add_morph_deltas<true, false, false>,
+		add_morph_deltas<true, false, true>,
+		add_morph_deltas<true, true, false>,
+		add_morph_deltas<true, true, true>,
+	};
+
+	bool masked = mask_weights != NULL;
+	clothing = clothing && mClothingWeights;
+	U32 variant = (masked ? 4 : 0) | (clothing ? 2 : 0) | (morph->mHasDegenerateBinormals ? 1 : 0);
+	add_funcs[variant](morph, weight, mask_weights, mCoords, mScaledNormals, mScaledBinormals,
+					   mClothingWeights, mTexCoords, &mDirty[0], mDirtyVertices);
+}
+
+//-----------------------------------------------------------------------------
+// updateNormals()
+//-----------------------------------------------------------------------------
+void LLPolyMorphAccumulator::updateNormals()
+{
+	// Four vertices at a time, transposed so that each register holds one
+	// component of the four. The arithmetic is the same as
+	// normalize3fast() and setCross3() on each vertex, in the same order:
+	//   normal = normalize(scaled_normal)
+	//   binormal = normalize(normal x (scaled_binormal x normal))
+	U32 count = (U32)mDirtyVertices.size();
+	U32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		const U32* verts = &mDirtyVertices[i];
+
+		LLQuad nx = mScaledNormals[verts[0]];
+		LLQuad ny = mScaledNormals[verts[1]];
+		LLQuad nz = mScaledNormals[verts[2]];
+		LLQuad nw = mScaledNormals[verts[3]];
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+		LLQuad sx = mScaledBinormals[verts[0]];
+		LLQuad sy = mScaledBinormals[verts[1]];
+		LLQuad sz = mScaledBinormals[verts[2]];
+		LLQuad sw = mScaledBinormals[verts[3]];
+		_MM_TRANSPOSE4_PS(sx, sy, sz, sw);
+
+		LLQuad len_sqrd = _mm_add_ps(_mm_mul_ps(nz, nz), _mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)));
+		LLQuad rsqrt = _mm_rsqrt_ps(len_sqrd);
+		nx = _mm_mul_ps(nx, rsqrt);
+		ny = _mm_mul_ps(ny, rsqrt);
+		nz = _mm_mul_ps(nz, rsqrt);
+		nw = _mm_mul_ps(nw, rsqrt);
+
+		// tangent = scaled_binormal x normal
+		LLQuad tx = _mm_sub_ps(_mm_mul_ps(sy, nz), _mm_mul_ps(sz, ny));
+		LLQuad ty = _mm_sub_ps(_mm_mul_ps(sz, nx), _mm_mul_ps(sx, nz));
+		LLQuad tz = _mm_sub_ps(_mm_mul_ps(sx, ny), _mm_mul_ps(sy, nx));
+
+		// binormal = normal x tangent
+		LLQuad bx = _mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(nz, ty));
+		LLQuad by = _mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(nx, tz));
+		LLQuad bz = _mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(ny, tx));
+		LLQuad bw = _mm_setzero_ps();
+
+		len_sqrd = _mm_add_ps(_mm_mul_ps(bz, bz), _mm_add_ps(_mm_mul_ps(bx, bx), _mm_mul_ps(by, by)));
+		rsqrt = _mm_rsqrt_ps(len_sqrd);
+		bx = _mm_mul_ps(bx, rsqrt);
+		by = _mm_mul_ps(by, rsqrt);
+		bz = _mm_mul_ps(bz, rsqrt);
+
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+		mNormals[verts[0]] = nx;
+		mNormals[verts[1]] = ny;
+		mNormals[verts[2]] = nz;
+		mNormals[verts[3]] = nw;
+
+		_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+		mBinormals[verts[0]] = bx;
+		mBinormals[verts[1]] = by;
+		mBinormals[verts[2]] = bz;
+		mBinormals[verts[3]] = bw;
+
+		mDirty[verts[0]] = 0;
+		mDirty[verts[1]] = 0;
+		mDirty[verts[2]] = 0;
+		mDirty[verts[3]] = 0;
+	}
+
+	for (; i < count; i++)
+	{
+		U32 vert_index_mesh = mDirtyVertices[i];
+		mDirty[vert_index_mesh] = 0;
+
+		// calculate new normals based on half angles
+		LLVector4a norm = mScaledNormals[vert_index_mesh];
+		norm.normalize3fast();
+		mNormals[vert_index_mesh] = norm;
+
+		// calculate new binormals
+		LLVector4a tangent;
+		tangent.setCross3(mScaledBinormals[vert_index_mesh], norm);
+		LLVector4a& normalized_binormal = mBinormals[vert_index_mesh];
+		normalized_binormal.setCross3(norm, tangent);
+		normalized_binormal.normalize3fast();
+	}
+	mDirtyVertices.clear();
+}
+
+//-----------------------------------------------------------------------------
+// clearDirtyNormals()
+//-----------------------------------------------------------------------------
+void LLPolyMorphAccumulator::clearDirtyNormals()
+{
+	for (std::vector<U32>::const_iterator iter = mDirtyVertices.begin(); iter != mDirtyVertices.end(); ++iter)
+	{
+		mDirty[*iter] = 0;
+	}
+	mDirtyVertices.clear();
+}
+
 //-----------------------------------------------------------------------------
 // LLPolyMorphTargetInfo()
 //-----------------------------------------------------------------------------
@@ -853,75 +1117,10 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 	if (delta_weight != 0.f)
 	{
 		llassert(!mMesh->isLOD());
-		LLVector4a *coords = mMesh->getWritableCoords();
-
-		LLVector4a *scaled_normals = mMesh->getScaledNormals();
-		LLVector4a *normals = mMesh->getWritableNormals();
-
-		LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
-		LLVector4a *binormals = mMesh->getWritableBinormals();
-
-		LLVector4a *clothing_weights = mMesh->getWritableClothingWeights();
-		LLVector2 *tex_coords = mMesh->getWritableTexCoords();
-
 		F32 *maskWeightArray = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
+		bool clothing = getInfo()->mIsClothingMorph && mMesh->getWritableClothingWeights();
 
-		for(U32 vert_index_morph = 0; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
-		{
-			S32 vert_index_mesh = mMorphData->mVertexIndices[vert_index_morph];
-
-			F32 maskWeight = 1.f;
-			if (maskWeightArray)
-			{
-				maskWeight = maskWeightArray[vert_index_morph];
-			}
-
-
-			LLVector4a pos = mMorphData->mCoords[vert_index_morph];
-			pos.mul(delta_weight*maskWeight);
-			coords[vert_index_mesh].add(pos);
-
-			if (getInfo()->mIsClothingMorph && clothing_weights)
-			{
-				LLVector4a clothing_offset = mMorphData->mCoords[vert_index_morph];
-				clothing_offset.mul(delta_weight * maskWeight);
-				LLVector4a* clothing_weight = &clothing_weights[vert_index_mesh];
-				clothing_weight->add(clothing_offset);
-				clothing_weight->getF32ptr()[VW] = maskWeight;
-			}
-
-			// calculate new normals based on half angles
-			LLVector4a norm = mMorphData->mNormals[vert_index_morph];
-			norm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-			scaled_normals[vert_index_mesh].add(norm);
-			norm = scaled_normals[vert_index_mesh];
-
-			// guard against degenerate input data before we create NaNs below!
-			//
-			norm.normalize3fast();
-			normals[vert_index_mesh] = norm;
-
-			// calculate new binormals
-			LLVector4a binorm = mMorphData->mBinormals[vert_index_morph];
-
-			// guard against degenerate input data before we create NaNs below!
-			//
-			if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
-			{
-				binorm.set(1,0,0,1);
-			}
-
-			binorm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-			scaled_binormals[vert_index_mesh].add(binorm);
-			LLVector4a tangent;
-			tangent.setCross3(scaled_binormals[vert_index_mesh], norm);
-			LLVector4a& normalized_binormal = binormals[vert_index_mesh];
-
-			normalized_binormal.setCross3(norm, tangent); 			
-			normalized_binormal.normalize3fast();
-			
-			tex_coords[vert_index_mesh] += mMorphData->mTexCoords[vert_index_morph] * delta_weight * maskWeight;
-		}
+		mMesh->getMorphAccumulator().addMorph(mMorphData, delta_weight, maskWeightArray, clothing);
 
 		// now apply volume changes
 		for( volume_list_t::iterator iter = mVolumeMorphs.begin(); iter != mVolumeMorphs.end(); iter++ )
@@ -960,56 +1159,25 @@ void	LLPolyMorphTarget::applyMask(U8 *maskTextureData, S32 width, S32 height, S3
 
 		if (maskWeights)
 		{
-			LLVector4a *coords = mMesh->getWritableCoords();
-			LLVector4a *scaled_normals = mMesh->getScaledNormals();
-			LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
-			LLVector2 *tex_coords = mMesh->getWritableTexCoords();
-
-			LLVector4Logical clothing_mask;
-			clothing_mask.clear();
-			clothing_mask.setElement<0>();
-			clothing_mask.setElement<1>();
-			clothing_mask.setElement<2>();
-
-
-			for(U32 vert = 0; vert < mMorphData->mNumIndices; vert++)
+			if (!mVertMask->sampleMask(maskTextureData, width, height, num_components, invert))
 			{
-				F32 lastMaskWeight = mLastWeight * maskWeights[vert];
-				S32 out_vert = mMorphData->mVertexIndices[vert];
-
-				// remove effect of existing masked morph
-				LLVector4a t;
-				t = mMorphData->mCoords[vert];
-				t.mul(lastMaskWeight);
-				coords[out_vert].sub(t);
-
-				t = mMorphData->mNormals[vert];
-				t.mul(lastMaskWeight*NORMAL_SOFTEN_FACTOR);
-				scaled_normals[out_vert].sub(t);
-
-				t = mMorphData->mBinormals[vert];
-				t.mul(lastMaskWeight*NORMAL_SOFTEN_FACTOR);
-				scaled_binormals[out_vert].sub(t);
-
-				tex_coords[out_vert] -= mMorphData->mTexCoords[vert] * lastMaskWeight;
-
-				if (clothing_weights)
-				{
-					LLVector4a clothing_offset = mMorphData->mCoords[vert];
-					clothing_offset.mul(lastMaskWeight);
-					LLVector4a* clothing_weight = &clothing_weights[out_vert];
-					LLVector4a t;
-					t.setSub(*clothing_weight, clothing_offset);
-					clothing_weight->setSelectWithMask(clothing_mask, t, *clothing_weight);
-				}
+				// same mask as before, only catch up with the weight
+				apply(mLastSex);
+				return;
 			}
+
+			mMesh->getMorphAccumulator().addMorph(mMorphData, -mLastWeight, maskWeights, clothing_weights != NULL);
 		}
 	}
 
 	// set last weight to 0, since we've removed the effect of this morph
 	mLastWeight = 0.f;
 
-	mVertMask->generateMask(maskTextureData, width, height, num_components, invert, clothing_weights);
+	if (!mVertMask->getMorphMaskWeights())
+	{
+		mVertMask->sampleMask(maskTextureData, width, height, num_components, invert);
+	}
+	mVertMask->commitMask(clothing_weights);
 
 	apply(mLastSex);
 }
@@ -1019,6 +1187,9 @@ void	LLPolyMorphTarget::applyMask(U8 *maskTextureData, S32 width, S32 height, S3
 // LLPolyVertexMask()
 //-----------------------------------------------------------------------------
 LLPolyVertexMask::LLPolyVertexMask(LLPolyMorphData* morph_data)
+	: mOffsetsWidth(0),
+	  mOffsetsHeight(0),
+	  mOffsetsComponents(0)
 {
 	mWeights = new F32[morph_data->mNumIndices];
 	mMorphData = morph_data;
@@ -1037,6 +1208,15 @@ LLPolyVertexMask::~LLPolyVertexMask()
 // generateMask()
 //-----------------------------------------------------------------------------
 void LLPolyVertexMask::generateMask(U8 *maskTextureData, S32 width, S32 height, S32 num_components, BOOL invert, LLVector4a *clothing_weights)
+{
+	sampleMask(maskTextureData, width, height, num_components, invert);
+	commitMask(clothing_weights);
+}
+
+//-----------------------------------------------------------------------------
+// sampleMask()
+//-----------------------------------------------------------------------------
+bool LLPolyVertexMask::sampleMask(U8 *maskTextureData, S32 width, S32 height, S32 num_components, BOOL invert)
 {
 // RN debug output that uses Image Debugger (http://www.cs.unc.edu/~baxter/projects/imdebug/)
 //	BOOL debugImg = FALSE; 
@@ -1051,36 +1231,67 @@ void LLPolyVertexMask::generateMask(U8 *maskTextureData, S32 width, S32 height,
 //			imdebug("lum rbga=rgba b=8 w=%d h=%d %p", width, height, maskTextureData);
 //		}
 //	}
-	for (U32 index = 0; index < mMorphData->mNumIndices; index++)
+	U32 count = mMorphData->mNumIndices;
+	if (width != mOffsetsWidth || height != mOffsetsHeight || num_components != mOffsetsComponents)
 	{
-		S32 vertIndex = mMorphData->mVertexIndices[index];
-		const S32 *sharedVertIndex = mMorphData->mMesh->getSharedVert(vertIndex);
-		LLVector2 uvCoords;
-
-		if (sharedVertIndex)
-		{
-			uvCoords = mMorphData->mMesh->getUVs(*sharedVertIndex);
-		}
-		else
+		mTexelOffsets.resize(count);
+		for (U32 index = 0; index < count; index++)
 		{
-			uvCoords = mMorphData->mMesh->getUVs(vertIndex);
+			S32 vertIndex = mMorphData->mVertexIndices[index];
+			const S32 *sharedVertIndex = mMorphData->mMesh->getSharedVert(vertIndex);
+			LLVector2 uvCoords;
+
+			if (sharedVertIndex)
+			{
+				uvCoords = mMorphData->mMesh->getUVs(*sharedVertIndex);
+			}
+			else
+			{
+				uvCoords = mMorphData->mMesh->getUVs(vertIndex);
+			}
+			U32 s = llclamp((U32)(uvCoords.mV[VX] * (F32)(width - 1)), (U32)0, (U32)width - 1);
+			U32 t = llclamp((U32)(uvCoords.mV[VY] * (F32)(height - 1)), (U32)0, (U32)height - 1);
+
+			mTexelOffsets[index] = ((t * width + s) * num_components) + (num_components - 1);
 		}
-		U32 s = llclamp((U32)(uvCoords.mV[VX] * (F32)(width - 1)), (U32)0, (U32)width - 1);
-		U32 t = llclamp((U32)(uvCoords.mV[VY] * (F32)(height - 1)), (U32)0, (U32)height - 1);
-		
-		mWeights[index] = ((F32) maskTextureData[((t * width + s) * num_components) + (num_components - 1)]) / 255.f;
+		mOffsetsWidth = width;
+		mOffsetsHeight = height;
+		mOffsetsComponents = num_components;
+	}
+
+	mSampledWeights.resize(count);
+	for (U32 index = 0; index < count; index++)
+	{
+		F32 weight = ((F32) maskTextureData[mTexelOffsets[index]]) / 255.f;
 		
 		if (invert) 
 		{
-			mWeights[index] = 1.f - mWeights[index];
+			weight = 1.f - weight;
 		}
 
 		// now apply step function
-		// mWeights[index] = mWeights[index] > 0.95f ? 1.f : 0.f;
+		// weight = weight > 0.95f ? 1.f : 0.f;
+
+		mSampledWeights[index] = weight;
+	}
+
+	return !mWeightsGenerated || count == 0 ||
+		memcmp(&mSampledWeights[0], mWeights, count * sizeof(F32)) != 0;
+}
+
+//-----------------------------------------------------------------------------
+// commitMask()
+//-----------------------------------------------------------------------------
+void LLPolyVertexMask::commitMask(LLVector4a *clothing_weights)
+{
+	U32 count = llmin(mMorphData->mNumIndices, (U32)mSampledWeights.size());
+	for (U32 index = 0; index < count; index++)
+	{
+		mWeights[index] = mSampledWeights[index];
 
 		if (clothing_weights)
 		{
-			clothing_weights[vertIndex].getF32ptr()[VW] = mWeights[index];
+			clothing_weights[mMorphData->mVertexIndices[index]].getF32ptr()[VW] = mWeights[index];
 		}
 	}
 	mWeightsGenerated = TRUE;
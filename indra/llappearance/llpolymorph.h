@@ -65,6 +65,8 @@ public:
 	BOOL			saveLLM(LLFILE *fp);
 	BOOL			saveOBJ(LLFILE *fp);
 	BOOL			setMorphFromMesh(LLPolyMesh *morph);
+	// Sets mHasDegenerateBinormals, for when the binormals were changed.
+	void			updateDegenerateBinormals();
 
 public:
 	std::string			mName;
@@ -77,6 +79,8 @@ public:
 	LLVector4a*			mNormals;
 	LLVector4a*			mBinormals;
 	LLVector2*			mTexCoords;
+	// some binormals are too short or not finite to be used as they are
+	bool				mHasDegenerateBinormals;
 
 	F32					mTotalDistortion;	// vertex distortion summed over entire morph
 	F32					mMaxDistortion;		// maximum single vertex distortion in a given morph
@@ -88,6 +92,47 @@ private:
 } LL_ALIGN_POSTFIX(16);
 
 
+//-----------------------------------------------------------------------------
+// LLPolyMorphAccumulator()
+// Adds morph target deltas to the vertex arrays of a mesh. Positions,
+// texture coordinates and the scaled normals and binormals are updated
+// right away; the output normals and binormals of the vertices that moved
+// are only normalized again by updateNormals(), once per vertex however
+// many morphs moved it.
+//-----------------------------------------------------------------------------
+class LLPolyMorphAccumulator
+{
+public:
+	LLPolyMorphAccumulator();
+
+	void init(U32 num_vertices, LLVector4a* coords, LLVector4a* scaled_normals, LLVector4a* normals,
+			  LLVector4a* scaled_binormals, LLVector4a* binormals, LLVector4a* clothing_weights,
+			  LLVector2* tex_coords);
+
+	// Adds weight times the deltas of morph, times mask_weights per vertex
+	// when not NULL. clothing also adds the position deltas to the clothing
+	// weights and stores the mask weight in their w.
+	void addMorph(const LLPolyMorphData* morph, F32 weight, const F32* mask_weights, bool clothing);
+
+	bool hasDirtyNormals() const			{ return !mDirtyVertices.empty(); }
+	void updateNormals();
+	// Forgets the vertices that moved, for when the arrays were reset.
+	void clearDirtyNormals();
+
+private:
+	U32				mNumVertices;
+	LLVector4a*		mCoords;
+	LLVector4a*		mScaledNormals;
+	LLVector4a*		mNormals;
+	LLVector4a*		mScaledBinormals;
+	LLVector4a*		mBinormals;
+	LLVector4a*		mClothingWeights;
+	LLVector2*		mTexCoords;
+
+	std::vector<U8>		mDirty;				// per vertex
+	std::vector<U32>	mDirtyVertices;
+};
+
 //-----------------------------------------------------------------------------
 // LLPolyVertexMask()
 //-----------------------------------------------------------------------------
@@ -98,6 +143,12 @@ public:
 	~LLPolyVertexMask();
 
 	void generateMask(U8 *maskData, S32 width, S32 height, S32 num_components, BOOL invert, LLVector4a *clothing_weights);
+	// Samples the mask for every vertex of the morph without using the
+	// result. Returns false when the weights are the ones in use, so that
+	// commitMask() can be skipped.
+	bool sampleMask(U8 *maskData, S32 width, S32 height, S32 num_components, BOOL invert);
+	// Makes the weights of the last sampleMask() the ones in use.
+	void commitMask(LLVector4a *clothing_weights);
 	F32* getMorphMaskWeights();
 
 
@@ -106,6 +157,13 @@ protected:
 	LLPolyMorphData *mMorphData;
 	BOOL			mWeightsGenerated;
 
+	// Offset of the mask byte of each vertex for the texture size below,
+	// so that the texture coordinates are only looked up when it changes.
+	std::vector<U32>	mTexelOffsets;
+	std::vector<F32>	mSampledWeights;
+	S32				mOffsetsWidth;
+	S32				mOffsetsHeight;
+	S32				mOffsetsComponents;
 };
 
 //-----------------------------------------------------------------------------
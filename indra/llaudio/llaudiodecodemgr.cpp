@@ -35,18 +35,22 @@
 
 #include "llvorbisdecode.h"
 #include "llaudioengine.h"
-#include "lllfsthread.h"
 #include "llvfile.h"
 #include "llstring.h"
 #include "lldir.h"
 #include "llendianswizzle.h"
 #include "llassetstorage.h"
+#include "llfasttimer.h"
 #include "llrefcount.h"
+#include "llthreadpool.h"
 
 #include "vorbis/codec.h"
 #include "vorbis/vorbisfile.h"
 #include "llvorbisencode.h"
+#include <deque>
 #include <iterator> //VS2010
+#include <list>
+#include <map>
 
 extern LLAudioEngine *gAudiop;
 
@@ -54,6 +58,16 @@ LLAudioDecodeMgr *gAudioDecodeMgrp = NULL;
 
 static const S32 WAV_HEADER_SIZE = 44;
 
+// Each decode on the pool holds its whole Ogg file and WAV image; this keeps
+// a burst of new sounds from holding all of them at once.
+static const U32 MAX_DECODES_IN_FLIGHT = 8;
+
+static const U32 DEFAULT_DECODED_CACHE_SIZE = 64 * 1024 * 1024;
+
+static LLFastTimer::DeclareTimer FTM_INSTALL_SOUNDS("Install Decoded Sounds");
+static LLFastTimer::DeclareTimer FTM_AUDIO_DECODE_WAIT("Audio Decode Queue Wait");
+static LLFastTimer::DeclareTimer FTM_AUDIO_DECODE("Audio Decode (Threads)");
+
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -61,158 +75,185 @@ static const S32 WAV_HEADER_SIZE = 44;
 class LLVorbisDecodeState : public LLRefCount
 {
 public:
-	class WriteResponder : public LLLFSThread::Responder
-	{
-	public:
-		WriteResponder(LLVorbisDecodeState* decoder) : mDecoder(decoder) {}
-		~WriteResponder() {}
-		void completed(S32 bytes)
-		{
-			mDecoder->ioComplete(bytes);
-		}
-		LLPointer<LLVorbisDecodeState> mDecoder;
-	};
-	
-	LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename);
+	LLVorbisDecodeState(const LLUUID &uuid);
 
-	BOOL initDecode();
+	// Copies the Ogg file out of the VFS; main thread only. Everything
+	// after this works on memory and may run on a pool thread.
+	BOOL readSource();
+	BOOL initDecode(bool allow_large_sounds);
 	BOOL decodeSection(); // Return TRUE if done.
-	BOOL finishDecode();
+	void finishDecode();
+	// initDecode(), decodeSection() until done and finishDecode() in one go.
+	void decodeAll(bool allow_large_sounds);
 
 	void flushBadFile();
 
-	void ioComplete(S32 bytes)			{ mBytesRead = bytes; }
 	BOOL isValid() const				{ return mValid; }
 	BOOL isDone() const					{ return mDone; }
+	// The stream itself is broken; flushBadFile() so it gets fetched again.
+	BOOL isBadStream() const			{ return mBadStream; }
 	const LLUUID &getUUID() const		{ return mUUID; }
+	std::vector<U8>& getWAVBuffer()		{ return mWAVBuffer; }
+
+	// The Ogg file and the read position in it, for the vorbisfile callbacks.
+	std::vector<U8> mOggData;
+	size_t mOggPos;
+
+	F64 mRequestTime;		// when the decode was requested, for the latency stats
 
 protected:
 	virtual ~LLVorbisDecodeState();
 
 	BOOL mValid;
 	BOOL mDone;
-	LLAtomicS32 mBytesRead;
+	BOOL mBadStream;
 	LLUUID mUUID;
 
 	std::vector<U8> mWAVBuffer;
-#if !defined(USE_WAV_VFILE)
-	std::string mOutFilename;
-	LLLFSThread::handle_t mFileHandle;
-#endif
 	
-	LLVFile *mInFilep;
+	bool mOpened;			// mVF needs ov_clear()
 	OggVorbis_File mVF;
 	S32 mCurrentSection;
 };
 
-size_t vfs_read(void *ptr, size_t size, size_t nmemb, void *datasource)
+size_t ogg_mem_read(void *ptr, size_t size, size_t nmemb, void *datasource)
 {
-	LLVFile *file = (LLVFile *)datasource;
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
 
-	if (file->read((U8*)ptr, (S32)(size * nmemb)))	/*Flawfinder: ignore*/
+	if (!size)
 	{
-		S32 read = file->getLastBytesRead();
-		return  read / size;	/*Flawfinder: ignore*/
+		return 0;
 	}
-	else
+	size_t count = llmin(nmemb, (state->mOggData.size() - state->mOggPos) / size);
+	if (count)
 	{
-		return 0;
+		memcpy(ptr, &state->mOggData[state->mOggPos], count * size);	/*Flawfinder: ignore*/
+		state->mOggPos += count * size;
 	}
+	return count;
 }
 
-int vfs_seek(void *datasource, ogg_int64_t offset, int whence)
+int ogg_mem_seek(void *datasource, ogg_int64_t offset, int whence)
 {
-	LLVFile *file = (LLVFile *)datasource;
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
 
-	// vfs has 31-bit files
-	if (offset > S32_MAX)
-	{
-		return -1;
-	}
-
-	S32 origin;
+	ogg_int64_t origin;
 	switch (whence) {
 	case SEEK_SET:
 		origin = 0;
 		break;
 	case SEEK_END:
-		origin = file->getSize();
+		origin = state->mOggData.size();
 		break;
 	case SEEK_CUR:
-		origin = -1;
+		origin = state->mOggPos;
 		break;
 	default:
-		llerrs << "Invalid whence argument to vfs_seek" << llendl;
 		return -1;
 	}
 
-	if (file->seek((S32)offset, origin))
-	{
-		return 0;
-	}
-	else
+	ogg_int64_t pos = origin + offset;
+	if (pos < 0 || pos > (ogg_int64_t)state->mOggData.size())
 	{
 		return -1;
 	}
+	state->mOggPos = (size_t)pos;
+	return 0;
 }
 
-int vfs_close (void *datasource)
+long ogg_mem_tell(void *datasource)
 {
-	LLVFile *file = (LLVFile *)datasource;
-	delete file;
-	return 0;
+	LLVorbisDecodeState *state = (LLVorbisDecodeState *)datasource;
+	return (long)state->mOggPos;
 }
 
-long vfs_tell (void *datasource)
+LLVorbisDecodeState::LLVorbisDecodeState(const LLUUID &uuid) :
+	mOggPos(0), mRequestTime(0.0),
+	mValid(FALSE), mDone(FALSE), mBadStream(FALSE), mUUID(uuid),
+	mOpened(false), mCurrentSection(0)
 {
-	LLVFile *file = (LLVFile *)datasource;
-	return file->tell();
 }
 
-LLVorbisDecodeState::LLVorbisDecodeState(const LLUUID &uuid, const std::string &out_filename) :
-	mValid(FALSE), mDone(FALSE), mBytesRead(-1), mUUID(uuid),
-#if !defined(USE_WAV_VFILE)
-	mOutFilename(out_filename), mFileHandle(LLLFSThread::nullHandle()),
-#endif
-	mInFilep(NULL), mCurrentSection(0)
+LLVorbisDecodeState::~LLVorbisDecodeState()
 {
+	if (mOpened)
+	{
+		ov_clear(&mVF);
+	}
 }
 
-LLVorbisDecodeState::~LLVorbisDecodeState()
+BOOL LLVorbisDecodeState::readSource()
 {
-	if (!mDone)
+	LLVFile in_file(gVFS, mUUID, LLAssetType::AT_SOUND);
+	S32 size = in_file.getSize();
+	if (size <= 0)
 	{
-		delete mInFilep;
-		mInFilep = NULL;
+		llwarns << "unable to open vorbis source vfile for reading" << llendl;
+		return FALSE;
+	}
+
+	mOggData.resize(size);
+	if (!in_file.read(&mOggData[0], size) || in_file.getLastBytesRead() != size)
+	{
+		llwarns << "unable to read vorbis source vfile " << mUUID << llendl;
+		mOggData.clear();
+		return FALSE;
 	}
+	mOggPos = 0;
+	return TRUE;
 }
 
+void LLVorbisDecodeState::decodeAll(bool allow_large_sounds)
+{
+	if (!initDecode(allow_large_sounds))
+	{
+		return;
+	}
+	try
+	{
+		while (!decodeSection())
+		{
+		}
+	}
+	catch (std::bad_alloc)
+	{
+		llwarns << "bad_alloc whilst decoding " << mUUID << llendl;
+		mWAVBuffer.clear();
+		mValid = FALSE;
+		mDone = TRUE;
+		return;
+	}
+	if (isValid())
+	{
+		finishDecode();
+	}
+	// The Ogg data is not needed anymore.
+	std::vector<U8>().swap(mOggData);
+}
 
-BOOL LLVorbisDecodeState::initDecode()
+BOOL LLVorbisDecodeState::initDecode(bool allow_large_sounds)
 {
-	ov_callbacks vfs_callbacks;
-	vfs_callbacks.read_func = vfs_read;
-	vfs_callbacks.seek_func = vfs_seek;
-	vfs_callbacks.close_func = vfs_close;
-	vfs_callbacks.tell_func = vfs_tell;
+	ov_callbacks mem_callbacks;
+	mem_callbacks.read_func = ogg_mem_read;
+	mem_callbacks.seek_func = ogg_mem_seek;
+	mem_callbacks.close_func = NULL;
+	mem_callbacks.tell_func = ogg_mem_tell;
 
 	//llinfos << "Initing decode from vfile: " << mUUID << llendl;
 
-	mInFilep = new LLVFile(gVFS, mUUID, LLAssetType::AT_SOUND);
-	if (!mInFilep || !mInFilep->getSize())
+	if (mOggData.empty())
 	{
-		llwarns << "unable to open vorbis source vfile for reading" << llendl;
-		delete mInFilep;
-		mInFilep = NULL;
+		llwarns << "no vorbis source data for " << mUUID << llendl;
 		return FALSE;
 	}
 
-	int r = ov_open_callbacks(mInFilep, &mVF, NULL, 0, vfs_callbacks);
+	int r = ov_open_callbacks(this, &mVF, NULL, 0, mem_callbacks);
 	if(r < 0) 
 	{
 		llwarns << r << " Input to vorbis decode does not appear to be an Ogg bitstream: " << mUUID << llendl;
 		return(FALSE);
 	}
+	mOpened = true;
 	
 	S32 sample_count = ov_pcm_total(&mVF, -1);
 	size_t size_guess = (size_t)sample_count;
@@ -244,7 +285,7 @@ BOOL LLVorbisDecodeState::initDecode()
 		llwarns << "Bad sound caught by zmagic" << llendl;
 		abort_decode = true;
 	}
-	else if(!gAudiop->getAllowLargeSounds())
+	else if(!allow_large_sounds)
 	{
 	// </edit> 
 	//Much more restrictive than zmagic. Perhaps make toggleable.
@@ -272,8 +313,6 @@ BOOL LLVorbisDecodeState::initDecode()
 		{
 			llwarns << "Bad asset encoded by: " << comment->vendor << llendl;
 		}
-		delete mInFilep;
-		mInFilep = NULL;
 		return FALSE;
 	}
 	
@@ -288,11 +327,6 @@ BOOL LLVorbisDecodeState::initDecode()
 	catch(std::bad_alloc)
 	{
 		llwarns << "bad_alloc" << llendl;
-		if(mInFilep)
-		{
-			delete mInFilep;
-			mInFilep = NULL;
-		}
 		return FALSE;
 	}
 	// </edit>
@@ -386,9 +420,9 @@ BOOL LLVorbisDecodeState::initDecode()
 
 BOOL LLVorbisDecodeState::decodeSection()
 {
-	if (!mInFilep)
+	if (!mOpened)
 	{
-		llwarns << "No VFS file to decode in vorbis!" << llendl;
+		llwarns << "No vorbis stream to decode!" << llendl;
 		return TRUE;
 	}
 	if (mDone)
@@ -417,6 +451,7 @@ BOOL LLVorbisDecodeState::decodeSection()
 
 		mValid = FALSE;
 		mDone = TRUE;
+		mBadStream = TRUE;
 		// We're done, return TRUE.
 		return TRUE;
 	}
@@ -430,138 +465,101 @@ BOOL LLVorbisDecodeState::decodeSection()
 	return eof;
 }
 
-BOOL LLVorbisDecodeState::finishDecode()
+void LLVorbisDecodeState::finishDecode()
 {
 	if (!isValid())
 	{
 		llwarns << "Bogus vorbis decode state for " << getUUID() << ", aborting!" << llendl;
-		return TRUE; // We've finished
+		return;
 	}
 
-#if !defined(USE_WAV_VFILE)	
-	if (mFileHandle == LLLFSThread::nullHandle())
-#endif
-	{
-		ov_clear(&mVF);
+	ov_clear(&mVF);
+	mOpened = false;
   
-		// write "data" chunk length, in little-endian format
-		S32 data_length = mWAVBuffer.size() - WAV_HEADER_SIZE;
-		mWAVBuffer[40] = (data_length) & 0x000000FF;
-		mWAVBuffer[41] = (data_length >> 8) & 0x000000FF;
-		mWAVBuffer[42] = (data_length >> 16) & 0x000000FF;
-		mWAVBuffer[43] = (data_length >> 24) & 0x000000FF;
-		// write overall "RIFF" length, in little-endian format
-		data_length += 36;
-		mWAVBuffer[4] = (data_length) & 0x000000FF;
-		mWAVBuffer[5] = (data_length >> 8) & 0x000000FF;
-		mWAVBuffer[6] = (data_length >> 16) & 0x000000FF;
-		mWAVBuffer[7] = (data_length >> 24) & 0x000000FF;
-
-		//
-		// FUDGECAKES!!! Vorbis encode/decode messes up loop point transitions (pop)
-		// do a cheap-and-cheesy crossfade 
-		//
+	// write "data" chunk length, in little-endian format
+	S32 data_length = mWAVBuffer.size() - WAV_HEADER_SIZE;
+	mWAVBuffer[40] = (data_length) & 0x000000FF;
+	mWAVBuffer[41] = (data_length >> 8) & 0x000000FF;
+	mWAVBuffer[42] = (data_length >> 16) & 0x000000FF;
+	mWAVBuffer[43] = (data_length >> 24) & 0x000000FF;
+	// write overall "RIFF" length, in little-endian format
+	data_length += 36;
+	mWAVBuffer[4] = (data_length) & 0x000000FF;
+	mWAVBuffer[5] = (data_length >> 8) & 0x000000FF;
+	mWAVBuffer[6] = (data_length >> 16) & 0x000000FF;
+	mWAVBuffer[7] = (data_length >> 24) & 0x000000FF;
+
+	//
+	// FUDGECAKES!!! Vorbis encode/decode messes up loop point transitions (pop)
+	// do a cheap-and-cheesy crossfade 
+	//
+	{
+		S16 *samplep;
+		S32 i;
+		S32 fade_length;
+		char pcmout[4096];		/*Flawfinder: ignore*/ 	
+
+		fade_length = llmin((S32)128,(S32)(data_length-36)/8);			
+		// <edit>
+		//if((S32)mWAVBuffer.size() >= (WAV_HEADER_SIZE + 2* fade_length))
+		if((S32)mWAVBuffer.size() > (WAV_HEADER_SIZE + 2* fade_length))
+		// </edit>
 		{
-			S16 *samplep;
-			S32 i;
-			S32 fade_length;
-			char pcmout[4096];		/*Flawfinder: ignore*/ 	
-
-			fade_length = llmin((S32)128,(S32)(data_length-36)/8);			
-			// <edit>
-			//if((S32)mWAVBuffer.size() >= (WAV_HEADER_SIZE + 2* fade_length))
-			if((S32)mWAVBuffer.size() > (WAV_HEADER_SIZE + 2* fade_length))
-			// </edit>
-			{
-				memcpy(pcmout, &mWAVBuffer[WAV_HEADER_SIZE], (2 * fade_length));	/*Flawfinder: ignore*/
-			}
-			llendianswizzle(&pcmout, 2, fade_length);
-	
-			samplep = (S16 *)pcmout;
-			for (i = 0 ;i < fade_length; i++)
-			{
-				*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
-				samplep++;
-			}
-
-			llendianswizzle(&pcmout, 2, fade_length);			
-			if((WAV_HEADER_SIZE+(2 * fade_length)) < (S32)mWAVBuffer.size())
-			{
-				memcpy(&mWAVBuffer[WAV_HEADER_SIZE], pcmout, (2 * fade_length));	/*Flawfinder: ignore*/
-			}
-			S32 near_end = mWAVBuffer.size() - (2 * fade_length);
-			// <edit>
-			//if ((S32)mWAVBuffer.size() >= ( near_end + 2* fade_length))
-			if ((S32)mWAVBuffer.size() > ( near_end + 2* fade_length))
-			// </edit>
-			{
-				memcpy(pcmout, &mWAVBuffer[near_end], (2 * fade_length));	/*Flawfinder: ignore*/
-			}
-			llendianswizzle(&pcmout, 2, fade_length);
+			memcpy(pcmout, &mWAVBuffer[WAV_HEADER_SIZE], (2 * fade_length));	/*Flawfinder: ignore*/
+		}
+		llendianswizzle(&pcmout, 2, fade_length);
 
-			samplep = (S16 *)pcmout;
-			for (i = fade_length-1 ; i >=  0; i--)
-			{
-				*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
-				samplep++;
-			}
-	
-			llendianswizzle(&pcmout, 2, fade_length);			
-			if (near_end + (2 * fade_length) < (S32)mWAVBuffer.size())
-			{
-				memcpy(&mWAVBuffer[near_end], pcmout, (2 * fade_length));/*Flawfinder: ignore*/
-			}
+		samplep = (S16 *)pcmout;
+		for (i = 0 ;i < fade_length; i++)
+		{
+			*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
+			samplep++;
 		}
 
-		if (36 == data_length)
+		llendianswizzle(&pcmout, 2, fade_length);			
+		if((WAV_HEADER_SIZE+(2 * fade_length)) < (S32)mWAVBuffer.size())
 		{
-			llwarns << "BAD Vorbis decode in finishDecode!" << llendl;
-			mValid = FALSE;
-			return TRUE; // we've finished
+			memcpy(&mWAVBuffer[WAV_HEADER_SIZE], pcmout, (2 * fade_length));	/*Flawfinder: ignore*/
 		}
-#if !defined(USE_WAV_VFILE)
-		mBytesRead = -1;
-		mFileHandle = LLLFSThread::sLocal->write(mOutFilename, &mWAVBuffer[0], 0, mWAVBuffer.size(),
-							 new WriteResponder(this));
-#endif
-	}
+		S32 near_end = mWAVBuffer.size() - (2 * fade_length);
+		// <edit>
+		//if ((S32)mWAVBuffer.size() >= ( near_end + 2* fade_length))
+		if ((S32)mWAVBuffer.size() > ( near_end + 2* fade_length))
+		// </edit>
+		{
+			memcpy(pcmout, &mWAVBuffer[near_end], (2 * fade_length));	/*Flawfinder: ignore*/
+		}
+		llendianswizzle(&pcmout, 2, fade_length);
 
-	if (mFileHandle != LLLFSThread::nullHandle())
-	{
-		if (mBytesRead >= 0)
+		samplep = (S16 *)pcmout;
+		for (i = fade_length-1 ; i >=  0; i--)
 		{
-			if (mBytesRead == 0)
-			{
-				llwarns << "Unable to write file in LLVorbisDecodeState::finishDecode" << llendl;
-				mValid = FALSE;
-				return TRUE; // we've finished
-			}
+			*samplep = llfloor((F32)*samplep * ((F32)i/(F32)fade_length));
+			samplep++;
 		}
-		else
+
+		llendianswizzle(&pcmout, 2, fade_length);			
+		if (near_end + (2 * fade_length) < (S32)mWAVBuffer.size())
 		{
-			return FALSE; // not done
+			memcpy(&mWAVBuffer[near_end], pcmout, (2 * fade_length));/*Flawfinder: ignore*/
 		}
 	}
-	
-	mDone = TRUE;
 
-#if defined(USE_WAV_VFILE)
-	// write the data.
-	LLVFile output(gVFS, mUUID, LLAssetType::AT_SOUND_WAV);
-	output.write(&mWAVBuffer[0], mWAVBuffer.size());
-#endif
-	//llinfos << "Finished decode for " << getUUID() << llendl;
+	if (36 == data_length)
+	{
+		llwarns << "BAD Vorbis decode in finishDecode!" << llendl;
+		mValid = FALSE;
+		return;
+	}
 
-	return TRUE;
+	mDone = TRUE;
+	//llinfos << "Finished decode for " << getUUID() << llendl;
 }
 
 void LLVorbisDecodeState::flushBadFile()
 {
-	if (mInFilep)
-	{
-		llwarns << "Flushing bad vorbis file from VFS for " << mUUID << llendl;
-		mInFilep->remove();
-	}
+	llwarns << "Flushing bad vorbis file from VFS for " << mUUID << llendl;
+	gVFS->removeFile(mUUID, LLAssetType::AT_SOUND);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -570,21 +568,226 @@ class LLAudioDecodeMgr::Impl
 {
 	friend class LLAudioDecodeMgr;
 public:
-	Impl() {};
-	~Impl() {};
+	Impl();
+	~Impl();
 
 	void processQueue(const F32 num_secs = 0.005);
 
+	const std::vector<U8>* getDecodedData(const LLUUID &uuid);
+	bool hasDecodedData(const LLUUID &uuid) const;
+	void removeDecodedData(const LLUUID &uuid);
+	void setDecodedCacheSize(U32 bytes);
+
 protected:
-	LLLinkedQueue<LLUUID> mDecodeQueue;
-	LLPointer<LLVorbisDecodeState> mCurrentDecodep;
+	class DecodeTask;
+
+	// Pops requests until one has its Ogg data read; NULL once the queue ran empty.
+	LLPointer<LLVorbisDecodeState> popDecode();
+	void installDecodes();
+	void installDecode(LLVorbisDecodeState* decodep);
+	void addDecodedData(const LLUUID &uuid, std::vector<U8>& wav_data);
+	void trimDecodedData();
+
+	struct DecodeRequest
+	{
+		LLUUID mUUID;
+		F64 mRequestTime;
+	};
+	std::deque<DecodeRequest> mDecodeQueue;
+	LLPointer<LLVorbisDecodeState> mCurrentDecodep;	// decoding on this thread, when there is no pool
+
+	U32 mDecodesPosted;								// handed to the pool and not installed yet
+	LLThreadPoolResults<LLPointer<LLVorbisDecodeState> > mDecodedStates;	// handed back by the pool
+
+	struct DecodedSound
+	{
+		std::vector<U8> mData;
+		std::list<LLUUID>::iterator mUsedPos;
+	};
+	typedef std::map<LLUUID, DecodedSound> decoded_map_t;
+	decoded_map_t mDecodedSounds;
+	std::list<LLUUID> mDecodedUsed;					// least recently used first
+	U32 mDecodedBytes;
+	U32 mDecodedCacheSize;
+
+	U32 mCacheHits;
+	U32 mCacheMisses;
+	U32 mSoundsDecoded;
+	F64 mLatencySum;								// from addDecodeRequest() to installation
+	F64 mMaxLatency;
+};
+
+class LLAudioDecodeMgr::Impl::DecodeTask : public LLThreadPool::Task
+{
+public:
+	DecodeTask(Impl* mgr, LLVorbisDecodeState* decodep, bool allow_large_sounds)
+		: mMgr(mgr),
+		  mDecodep(decodep),
+		  mAllowLargeSounds(allow_large_sounds)
+	{
+	}
+
+	/*virtual*/ void run()
+	{
+		U32 start = LLFastTimer::getCPUClockCount32();
+		mDecodep->decodeAll(mAllowLargeSounds);
+		U32 end = LLFastTimer::getCPUClockCount32();
+		// Hands over our reference, the main thread may drop it any time after this.
+		mMgr->mDecodedStates.push(mDecodep, start - getQueuedClocks(), end - start);
+	}
+
+	/*virtual*/ void drop()
+	{
+		mMgr->mDecodedStates.push(mDecodep);
+	}
+
+private:
+	Impl* mMgr;
+	LLPointer<LLVorbisDecodeState> mDecodep;
+	bool mAllowLargeSounds;
 };
 
+LLAudioDecodeMgr::Impl::Impl()
+:	mDecodesPosted(0),
+	mDecodedBytes(0),
+	mDecodedCacheSize(DEFAULT_DECODED_CACHE_SIZE),
+	mCacheHits(0),
+	mCacheMisses(0),
+	mSoundsDecoded(0),
+	mLatencySum(0.0),
+	mMaxLatency(0.0)
+{
+}
+
+LLAudioDecodeMgr::Impl::~Impl()
+{
+	// Decodes still queued or running report back to this manager.
+	mDecodedStates.waitForAll();
+	std::vector<LLPointer<LLVorbisDecodeState> > decoded;
+	mDecodedStates.take(decoded);
+
+	llinfos << "Decoded " << mSoundsDecoded << " sounds, average latency "
+			<< (mSoundsDecoded ? mLatencySum * 1000.0 / mSoundsDecoded : 0.0) << " ms, max "
+			<< mMaxLatency * 1000.0 << " ms. Decoded sound cache: " << mCacheHits << " hits, "
+			<< mCacheMisses << " misses, " << mDecodedBytes << " bytes in use." << llendl;
+}
+
+LLPointer<LLVorbisDecodeState> LLAudioDecodeMgr::Impl::popDecode()
+{
+	while (!mDecodeQueue.empty())
+	{
+		DecodeRequest request = mDecodeQueue.front();
+		mDecodeQueue.pop_front();
+
+		LLAudioData *adp = gAudiop->getAudioData(request.mUUID);
+		if (gAudiop->hasDecodedFile(request.mUUID))
+		{
+			// This file has already been decoded, don't decode it again.
+			if (adp && adp->getLoadState() == LLAudioData::STATE_LOAD_DECODING)
+			{
+				adp->setLoadState(LLAudioData::STATE_LOAD_READY);
+			}
+			continue;
+		}
+
+		lldebugs << "Decoding " << request.mUUID << " from audio queue!" << llendl;
+
+		LLPointer<LLVorbisDecodeState> decodep = new LLVorbisDecodeState(request.mUUID);
+		decodep->mRequestTime = request.mRequestTime;
+		if (decodep->readSource())
+		{
+			return decodep;
+		}
+
+		if(adp)
+		{
+			adp->setLoadState(LLAudioData::STATE_LOAD_ERROR);
+		}
+	}
+	return NULL;
+}
+
+void LLAudioDecodeMgr::Impl::installDecodes()
+{
+	if (!mDecodesPosted)
+	{
+		return;
+	}
+	LLFastTimer t(FTM_INSTALL_SOUNDS);
+
+	std::vector<LLPointer<LLVorbisDecodeState> > decoded;
+	mDecodedStates.take(decoded, &FTM_AUDIO_DECODE_WAIT, &FTM_AUDIO_DECODE);
+
+	mDecodesPosted -= decoded.size();
+	for (std::vector<LLPointer<LLVorbisDecodeState> >::iterator iter = decoded.begin(); iter != decoded.end(); ++iter)
+	{
+		installDecode(*iter);
+	}
+}
+
+void LLAudioDecodeMgr::Impl::installDecode(LLVorbisDecodeState* decodep)
+{
+	const LLUUID& uuid = decodep->getUUID();
+	if (decodep->isBadStream())
+	{
+		// We had an error when decoding, abort.
+		llwarns << uuid << " has invalid vorbis data, aborting decode" << llendl;
+		decodep->flushBadFile();
+	}
+
+	LLAudioData *adp = gAudiop->getAudioData(uuid);
+	if (!adp)
+	{
+		llwarns << "Missing LLAudioData for decode of " << uuid << llendl;
+	}
+	else if (decodep->isValid() && decodep->isDone())
+	{
+		addDecodedData(uuid, decodep->getWAVBuffer());
+		adp->setLoadState(LLAudioData::STATE_LOAD_READY);
+		// At this point, we could see if anyone needs this sound immediately, but
+		// I'm not sure that there's a reason to - we need to poll all of the playing
+		// sounds anyway.
+
+		F64 latency = LLTimer::getTotalSeconds() - decodep->mRequestTime;
+		++mSoundsDecoded;
+		mLatencySum += latency;
+		mMaxLatency = llmax(mMaxLatency, latency);
+	}
+	else
+	{
+		adp->setLoadState(LLAudioData::STATE_LOAD_ERROR);
+		if (!decodep->isBadStream())
+		{
+			llinfos << "Vorbis decode failed for " << uuid << llendl;
+		}
+	}
+}
 
 void LLAudioDecodeMgr::Impl::processQueue(const F32 num_secs)
 {
-	LLUUID uuid;
+	installDecodes();
+
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (pool && !mCurrentDecodep)
+	{
+		bool allow_large_sounds = gAudiop->getAllowLargeSounds();
+		while (mDecodesPosted < MAX_DECODES_IN_FLIGHT)
+		{
+			LLPointer<LLVorbisDecodeState> decodep = popDecode();
+			if (decodep.isNull())
+			{
+				break;
+			}
+			DecodeTask* task = new DecodeTask(this, decodep, allow_large_sounds);
+			decodep = NULL;		// The task holds the only reference while it runs.
+			++mDecodesPosted;
+			mDecodedStates.expect();
+			pool->post(task);
+		}
+		return;
+	}
 
+	// No pool: decode here, within num_secs.
 	LLTimer decode_timer;
 
 	BOOL done = FALSE;
@@ -605,97 +808,95 @@ void LLAudioDecodeMgr::Impl::processQueue(const F32 num_secs)
 			}
 			/* <edit> */ }catch(std::bad_alloc){llerrs<<"bad_alloc whilst decoding"<<llendl;} /* </edit> */
 
-			if (mCurrentDecodep->isDone() && !mCurrentDecodep->isValid())
-			{
-				// We had an error when decoding, abort.
-				llwarns << mCurrentDecodep->getUUID() << " has invalid vorbis data, aborting decode" << llendl;
-				mCurrentDecodep->flushBadFile();
-				LLAudioData *adp = gAudiop->getAudioData(mCurrentDecodep->getUUID());
-				if(adp)
-				{
-					adp->setLoadState(LLAudioData::STATE_LOAD_ERROR);
-				}
-				mCurrentDecodep = NULL;
-				done = TRUE;
-			}
-
 			if (!res)
 			{
 				// We've used up out time slice, bail...
-				done = TRUE;
+				break;
 			}
-			else if (mCurrentDecodep)
+
+			if (mCurrentDecodep->isValid())
 			{
-				if (mCurrentDecodep->finishDecode())
-				{
-					// We finished!
-					LLAudioData *adp = gAudiop->getAudioData(mCurrentDecodep->getUUID());
-					if (!adp)
-					{
-						llwarns << "Missing LLAudioData for decode of " << mCurrentDecodep->getUUID() << llendl;
-					}
-					else if (mCurrentDecodep->isValid() && mCurrentDecodep->isDone())
-					{
-						adp->setLoadState(LLAudioData::STATE_LOAD_READY);
-						// At this point, we could see if anyone needs this sound immediately, but
-						// I'm not sure that there's a reason to - we need to poll all of the playing
-						// sounds anyway.
-						//llinfos << "Finished the vorbis decode, now what?" << llendl;
-					}
-					else
-					{
-						adp->setLoadState(LLAudioData::STATE_LOAD_ERROR);
-						llinfos << "Vorbis decode failed for " << mCurrentDecodep->getUUID() << llendl;
-					}
-					mCurrentDecodep = NULL;
-				}
-				done = TRUE; // done for now
+				mCurrentDecodep->finishDecode();
 			}
+			installDecode(mCurrentDecodep);
+			mCurrentDecodep = NULL;
+			done = TRUE; // done for now
 		}
 
 		if (!done)
 		{
-			if (!mDecodeQueue.getLength())
+			mCurrentDecodep = popDecode();
+			if (mCurrentDecodep.isNull())
 			{
 				// Nothing else on the queue.
 				done = TRUE;
 			}
-			else
+			else if (!mCurrentDecodep->initDecode(gAudiop->getAllowLargeSounds()))
 			{
-				LLUUID uuid;
-				mDecodeQueue.pop(uuid);
-				if (gAudiop->hasDecodedFile(uuid))
-				{
-					// This file has already been decoded, don't decode it again.
-					continue;
-				}
-
-				lldebugs << "Decoding " << uuid << " from audio queue!" << llendl;
-
-				std::string uuid_str;
-				std::string d_path;
-
-				LLTimer timer;
-				timer.reset();
-
-				uuid.toString(uuid_str);
-				d_path = gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
-
-				mCurrentDecodep = new LLVorbisDecodeState(uuid, d_path);
-				if (!mCurrentDecodep->initDecode())
-				{
-					LLAudioData *adp = gAudiop->getAudioData(uuid);
-					if(adp)
-					{
-						adp->setLoadState(LLAudioData::STATE_LOAD_ERROR);
-					}
-					mCurrentDecodep = NULL;
-				}
+				installDecode(mCurrentDecodep);
+				mCurrentDecodep = NULL;
 			}
 		}
 	}
 }
 
+const std::vector<U8>* LLAudioDecodeMgr::Impl::getDecodedData(const LLUUID &uuid)
+{
+	decoded_map_t::iterator iter = mDecodedSounds.find(uuid);
+	if (iter == mDecodedSounds.end())
+	{
+		++mCacheMisses;
+		return NULL;
+	}
+	++mCacheHits;
+	mDecodedUsed.splice(mDecodedUsed.end(), mDecodedUsed, iter->second.mUsedPos);
+	return &iter->second.mData;
+}
+
+bool LLAudioDecodeMgr::Impl::hasDecodedData(const LLUUID &uuid) const
+{
+	return mDecodedSounds.find(uuid) != mDecodedSounds.end();
+}
+
+void LLAudioDecodeMgr::Impl::addDecodedData(const LLUUID &uuid, std::vector<U8>& wav_data)
+{
+	removeDecodedData(uuid);
+	DecodedSound& sound = mDecodedSounds[uuid];
+	sound.mData.swap(wav_data);
+	sound.mUsedPos = mDecodedUsed.insert(mDecodedUsed.end(), uuid);
+	mDecodedBytes += sound.mData.capacity();
+	trimDecodedData();
+}
+
+void LLAudioDecodeMgr::Impl::removeDecodedData(const LLUUID &uuid)
+{
+	decoded_map_t::iterator iter = mDecodedSounds.find(uuid);
+	if (iter != mDecodedSounds.end())
+	{
+		mDecodedBytes -= iter->second.mData.capacity();
+		mDecodedUsed.erase(iter->second.mUsedPos);
+		mDecodedSounds.erase(iter);
+	}
+}
+
+void LLAudioDecodeMgr::Impl::setDecodedCacheSize(U32 bytes)
+{
+	mDecodedCacheSize = bytes;
+	trimDecodedData();
+}
+
+void LLAudioDecodeMgr::Impl::trimDecodedData()
+{
+	// Keep the newest sound even when it alone is over budget; the buffer
+	// that asked for it hasn't loaded it yet. Buffers keep their own copy,
+	// so sounds can go here once they are loaded.
+	while (mDecodedBytes > mDecodedCacheSize && mDecodedUsed.size() > 1)
+	{
+		LLUUID oldest = mDecodedUsed.front();
+		removeDecodedData(oldest);
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 LLAudioDecodeMgr::LLAudioDecodeMgr()
@@ -720,6 +921,29 @@ bool LLAudioDecodeMgr::addDecodeRequest(const LLUUID &uuid)
 	else if (!gAssetStorage || !gAssetStorage->hasLocalAsset(uuid, LLAssetType::AT_SOUND))
 		return false;
 	
-	mImpl->mDecodeQueue.push(uuid);
+	Impl::DecodeRequest request;
+	request.mUUID = uuid;
+	request.mRequestTime = LLTimer::getTotalSeconds();
+	mImpl->mDecodeQueue.push_back(request);
 	return true;
 }
+
+const std::vector<U8>* LLAudioDecodeMgr::getDecodedData(const LLUUID &uuid)
+{
+	return mImpl->getDecodedData(uuid);
+}
+
+bool LLAudioDecodeMgr::hasDecodedData(const LLUUID &uuid) const
+{
+	return mImpl->hasDecodedData(uuid);
+}
+
+void LLAudioDecodeMgr::removeDecodedData(const LLUUID &uuid)
+{
+	mImpl->removeDecodedData(uuid);
+}
+
+void LLAudioDecodeMgr::setDecodedCacheSize(U32 bytes)
+{
+	mImpl->setDecodedCacheSize(bytes);
+}
@@ -28,7 +28,8 @@
 
 #include "stdtypes.h"
 
-#include "lllinkedqueue.h"
+#include <vector>
+
 #include "lluuid.h"
 
 #include "llassettype.h"
@@ -43,9 +44,20 @@ public:
 	LLAudioDecodeMgr();
 	~LLAudioDecodeMgr();
 
+	// Sounds are decoded on the shared thread pool when there is one and
+	// within num_secs on this thread otherwise; either way the results are
+	// installed here, on the main thread.
 	void processQueue(const F32 num_secs = 0.005);
 	bool addDecodeRequest(const LLUUID &uuid);
 	void addAudioRequest(const LLUUID &uuid);
+
+	// Decoded sounds are kept in memory as complete WAV images, in least
+	// recently used order within a byte budget, and handed to LLAudioBuffer
+	// from there. Returns NULL when uuid is not (or no longer) cached.
+	const std::vector<U8>* getDecodedData(const LLUUID &uuid);
+	bool hasDecodedData(const LLUUID &uuid) const;
+	void removeDecodedData(const LLUUID &uuid);
+	void setDecodedCacheSize(U32 bytes);
 	
 protected:
 	class Impl;
@@ -1026,6 +1026,10 @@ LLAudioData * LLAudioEngine::getAudioData(const LLUUID &audio_uuid)
 			delete iter->second;
 		}
 		mAllData.erase(iter);
+		if (gAudioDecodeMgrp)
+		{
+			gAudioDecodeMgrp->removeDecodedData(audio_uuid);
+		}
  	}
  }
 void LLAudioEngine::addAudioSource(LLAudioSource *asp)
@@ -1048,8 +1052,21 @@ void LLAudioEngine::cleanupAudioSource(LLAudioSource *asp)
 }
 
 
+void LLAudioEngine::setDecodedCacheSize(U32 bytes)
+{
+	if (gAudioDecodeMgrp)
+	{
+		gAudioDecodeMgrp->setDecodedCacheSize(bytes);
+	}
+}
+
 bool LLAudioEngine::hasDecodedFile(const LLUUID &uuid)
 {
+	if (gAudioDecodeMgrp && gAudioDecodeMgrp->hasDecodedData(uuid))
+	{
+		return true;
+	}
+
 	std::string uuid_str;
 	uuid.toString(uuid_str);
 
@@ -1790,6 +1807,16 @@ bool LLAudioData::load()
 		LL_INFOS("AudioEngine") << "Already have a buffer for this sound, don't bother loading!" << LL_ENDL;
 		return true;
 	}
+
+	// Decoded sounds normally come straight from memory. Sounds that dropped
+	// out of the decoded cache before they were loaded are decoded again.
+	const std::vector<U8>* wav_data = gAudioDecodeMgrp ? gAudioDecodeMgrp->getDecodedData(mID) : NULL;
+	if (!wav_data && !gAudiop->hasDecodedFile(mID))
+	{
+		LL_DEBUGS("AudioEngine") << "Decoded data for " << mID << " is gone, decoding it again." << LL_ENDL;
+		mLoadState = STATE_LOAD_REQ_DECODE;
+		return false;
+	}
 	
 	mBufferp = gAudiop->getFreeBuffer();
 	if (!mBufferp)
@@ -1799,12 +1826,21 @@ bool LLAudioData::load()
 		return false;
 	}
 
-	std::string uuid_str;
-	std::string wav_path;
-	mID.toString(uuid_str);
-	wav_path= gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
+	bool loaded;
+	if (wav_data)
+	{
+		loaded = mBufferp->loadWAVData(&(*wav_data)[0], wav_data->size());
+	}
+	else
+	{
+		std::string uuid_str;
+		std::string wav_path;
+		mID.toString(uuid_str);
+		wav_path= gDirUtilp->getExpandedFilename(LL_PATH_CACHE,uuid_str) + ".dsf";
+		loaded = mBufferp->loadWAV(wav_path);
+	}
 
-	if (!mBufferp->loadWAV(wav_path))
+	if (!loaded)
 	{
 		// Hrm.  Right now, let's unset the buffer, since it's empty.
 		gAudiop->cleanupBuffer(mBufferp);
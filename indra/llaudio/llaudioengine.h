@@ -176,7 +176,10 @@ public:
 	LLAudioChannel *getFreeChannel(const F32 priority); // Get a free channel or flush an existing one if your priority is higher
 	void cleanupBuffer(LLAudioBuffer *bufferp);
 
+	// True when the sound is decoded, in memory or in a .dsf file.
 	bool hasDecodedFile(const LLUUID &uuid);
+	// Byte budget of the decoded sounds kept in memory.
+	void setDecodedCacheSize(U32 bytes);
 
 	void setAllowLargeSounds(bool allow) { mAllowLargeSounds = allow ;}
 	bool getAllowLargeSounds() const {return mAllowLargeSounds;}
@@ -480,6 +483,8 @@ public:
 	LLAudioBuffer() : mInUse(true), mAudioDatap(NULL) { mLastUseTimer.reset(); }
 	virtual ~LLAudioBuffer() {};
 	virtual bool loadWAV(const std::string& filename) = 0;
+	// Loads a complete WAV image from memory; the buffer keeps its own copy.
+	virtual bool loadWAVData(const U8* data, U32 size) = 0;
 	virtual U32 getLength() = 0;
 
 	friend class LLAudioEngine;
@@ -741,6 +741,33 @@ bool LLAudioBufferFMOD::loadWAV(const std::string& filename)
 }
 
 
+bool LLAudioBufferFMOD::loadWAVData(const U8* data, U32 size)
+{
+	if (!data || !size)
+	{
+		return false;
+	}
+
+	if (mSamplep)
+	{
+		// If there's already something loaded in this buffer, clean it up.
+		FSOUND_Sample_Free(mSamplep);
+		mSamplep = NULL;
+	}
+
+	// FSOUND_LOADMEMORY makes FMOD copy the data into the sample.
+	mSamplep = FSOUND_Sample_Load(FSOUND_UNMANAGED, (const char*)data, FSOUND_LOOP_NORMAL | FSOUND_LOADMEMORY, 0, size);
+	if (!mSamplep)
+	{
+		llwarns << "Could not load decoded sound data: "
+				<< FMOD_ErrorString(FSOUND_GetError()) << llendl;
+		return false;
+	}
+
+	return true;
+}
+
+
 U32 LLAudioBufferFMOD::getLength()
 {
 	if (!mSamplep)
@@ -370,6 +370,21 @@ bool LLAudioBufferOpenAL::loadWAV(const std::string& filename)
 	return true;
 }
 
+bool LLAudioBufferOpenAL::loadWAVData(const U8* data, U32 size)
+{
+	cleanup();
+	mALBuffer = alutCreateBufferFromFileImage(data, size);
+	if(mALBuffer == AL_NONE)
+	{
+		ALenum error = alutGetError();
+		llwarns << "LLAudioBufferOpenAL::loadWAVData() Error loading decoded sound data: "
+				<< alutGetErrorString(error) << llendl;
+		return false;
+	}
+
+	return true;
+}
+
 U32 LLAudioBufferOpenAL::getLength()
 {
 	if(mALBuffer == AL_NONE)
@@ -0,0 +1,122 @@
+/**
+ * @file llflatskeleton.cpp
+ * @brief Joint hierarchy flattened for updating world matrices in one pass.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llflatskeleton.h"
+
+#include "lljoint.h"
+
+LLFlatSkeleton::LLFlatSkeleton()
+:	mRoot(NULL),
+	mSerial(0)
+{
+}
+
+void LLFlatSkeleton::clear()
+{
+	mRoot = NULL;
+	mJoints.clear();
+	mParents.clear();
+	mBatched.clear();
+	mDepthEnds.clear();
+	mVisited.clear();
+}
+
+void LLFlatSkeleton::rebuild(LLJoint* root)
+{
+	clear();
+	mRoot = root;
+	mSerial = LLJoint::sHierarchySerial;
+
+	mJoints.push_back(root);
+	mParents.push_back(-1);
+	mBatched.push_back(FALSE);
+	U32 depth_start = 0;
+	while (depth_start < mJoints.size())
+	{
+		U32 depth_end = mJoints.size();
+		for (U32 i = depth_start; i < depth_end; ++i)
+		{
+			LLJoint* joint = mJoints[i];
+			for (LLJoint::child_list_t::iterator iter = joint->mChildren.begin();
+				 iter != joint->mChildren.end(); ++iter)
+			{
+				LLJoint* child = *iter;
+				mJoints.push_back(child);
+				mParents.push_back(i);
+				mBatched.push_back(child->getXform()->getParent() == joint->getXform());
+			}
+		}
+		mDepthEnds.push_back(depth_end);
+		depth_start = depth_end;
+	}
+	mVisited.resize(mJoints.size());
+	mBatch.reserve(mJoints.size());
+}
+
+U32 LLFlatSkeleton::updateWorldMatrices(LLJoint* root)
+{
+	if (root != mRoot || mSerial != LLJoint::sHierarchySerial)
+	{
+		rebuild(root);
+	}
+
+	// a joint is visited when it and all of its parents update their xform
+	U32 updates = 0;
+	U32 start = 0;
+	for (U32 depth = 0; depth < mDepthEnds.size(); ++depth)
+	{
+		U32 end = mDepthEnds[depth];
+		mBatch.clear();
+		for (U32 i = start; i < end; ++i)
+		{
+			LLJoint* joint = mJoints[i];
+			S32 parent = mParents[i];
+			mVisited[i] = joint->mUpdateXform && (parent < 0 || mVisited[parent]);
+			if (!mVisited[i] || !(joint->mDirtyFlags & LLJoint::MATRIX_DIRTY))
+			{
+				continue;
+			}
+			updates++;
+			joint->mDirtyFlags = 0x0;
+			if (mBatched[i])
+			{
+				mBatch.push_back(joint->getXform());
+			}
+			else
+			{
+				joint->getXform()->updateMatrix(FALSE);
+			}
+		}
+		if (!mBatch.empty())
+		{
+			LLXformMatrix::updateMatrices(&mBatch[0], mBatch.size());
+		}
+		start = end;
+	}
+	return updates;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file llflatskeleton.h
+ * @brief Joint hierarchy flattened for updating world matrices in one pass.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLFLATSKELETON_H
+#define LL_LLFLATSKELETON_H
+
+#include <vector>
+
+class LLJoint;
+class LLXformMatrix;
+
+// The joints under a root in breadth first order, so that the joints of
+// one depth only depend on the ones before them and their world matrices
+// can be computed together, four at a time. The order is rebuilt when a
+// joint is added to or removed from a parent anywhere.
+class LLFlatSkeleton
+{
+public:
+	LLFlatSkeleton();
+
+	// Same as root->updateWorldMatrixChildren(), but returns the number of
+	// joints updated instead of adding it to LLJoint::sNumUpdates, so that
+	// the skeletons of different roots can be updated on different threads.
+	U32 updateWorldMatrices(LLJoint* root);
+
+	void clear();
+
+private:
+	void rebuild(LLJoint* root);
+
+	LLJoint* mRoot;
+	U32 mSerial;
+
+	std::vector<LLJoint*> mJoints;
+	std::vector<S32> mParents;		// index of the parent joint, -1 for the root
+	std::vector<U8> mBatched;		// parent xform is the one of the parent joint
+	std::vector<U32> mDepthEnds;	// one past the last joint of each depth
+	std::vector<U8> mVisited;
+	std::vector<LLXformMatrix*> mBatch;
+};
+
+#endif // LL_LLFLATSKELETON_H
@@ -34,7 +34,8 @@
 #include "llmath.h"
 
 S32 LLJoint::sNumUpdates = 0;
-S32 LLJoint::sNumTouches = 0;
+LLAtomicS32 LLJoint::sNumTouches(0);
+U32 LLJoint::sHierarchySerial = 0;
 
 //-----------------------------------------------------------------------------
 // LLJoint()
@@ -187,6 +188,7 @@ void LLJoint::addChild(LLJoint* joint)
 	joint->mXform.setParent(&mXform);
 	joint->mParent = this;	
 	joint->touch();
+	sHierarchySerial++;
 }
 
 
@@ -203,6 +205,7 @@ void LLJoint::removeChild(LLJoint* joint)
 		joint->mXform.setParent(NULL);
 		joint->mParent = NULL;
 		joint->touch();
+		sHierarchySerial++;
 	}
 }
 
@@ -221,6 +224,7 @@ void LLJoint::removeAllChildren()
 		joint->mXform.setParent(NULL);
 		joint->mParent = NULL;
 		joint->touch();
+		sHierarchySerial++;
 	}
 }
 
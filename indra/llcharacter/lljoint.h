@@ -33,6 +33,7 @@
 #include <string>
 
 #include "linked_lists.h"
+#include "llatomic.h"
 #include "v3math.h"
 #include "v4math.h"
 #include "m4math.h"
@@ -99,10 +100,14 @@ public:
 	typedef std::list<LLJoint*> child_list_t;
 	child_list_t mChildren;
 
-	// debug statics
-	static S32		sNumTouches;
+	// debug statics, touches also come from the pool threads updating
+	// avatar skeletons
+	static LLAtomicS32	sNumTouches;
 	static S32		sNumUpdates;
 
+	// changes whenever a joint is added to or removed from a parent
+	static U32		sHierarchySerial;
+
 public:
 	LLJoint();
 	LLJoint(S32 joint_num);
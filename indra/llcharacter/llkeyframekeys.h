@@ -0,0 +1,91 @@
+/**
+ * @file llkeyframekeys.h
+ * @brief Searching and inserting into the sorted key lists of keyframe curves.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLKEYFRAMEKEYS_H
+#define LL_LLKEYFRAMEKEYS_H
+
+#include <algorithm>
+#include <vector>
+
+// KEY is any type with an F32 mTime member; the list is kept sorted by it.
+
+// Compares a key with a time, for searching the sorted key lists.
+template<class KEY>
+struct LLKeyTimeLess
+{
+	bool operator()(KEY const& key, F32 time) const { return key.mTime < time; }
+};
+
+// Returns the index of the first key at or after 'time' (keys.size() if there is none).
+// Playback moves forward by less than a segment per frame, so try the segment that
+// 'cursor' was left on and the one after it before falling back to a binary search.
+template<class KEY>
+U32 ll_find_key(std::vector<KEY> const& keys, F32 time, U32& cursor)
+{
+	U32 const count = keys.size();
+	U32 right = cursor;
+	if (right <= count && (right == 0 || keys[right - 1].mTime < time))
+	{
+		if (right < count && keys[right].mTime < time)
+		{
+			++right;
+			if (right < count && keys[right].mTime < time)
+			{
+				right = std::lower_bound(keys.begin() + right, keys.end(), time, LLKeyTimeLess<KEY>()) - keys.begin();
+			}
+		}
+	}
+	else
+	{
+		// Looped back (or a new cursor).
+		right = std::lower_bound(keys.begin(), keys.end(), time, LLKeyTimeLess<KEY>()) - keys.begin();
+	}
+	cursor = right;
+	return right;
+}
+
+// Adds 'key' keeping the list sorted; a key at the same time replaces the old one.
+// Animations store their keys in order, so this is normally a push_back.
+template<class KEY>
+void ll_insert_key(std::vector<KEY>& keys, KEY const& key)
+{
+	if (keys.empty() || keys.back().mTime < key.mTime)
+	{
+		keys.push_back(key);
+		return;
+	}
+	typename std::vector<KEY>::iterator iter = std::lower_bound(keys.begin(), keys.end(), key.mTime, LLKeyTimeLess<KEY>());
+	if (iter != keys.end() && iter->mTime == key.mTime)
+	{
+		*iter = key;
+	}
+	else
+	{
+		keys.insert(iter, key);
+	}
+}
+
+#endif // LL_LLKEYFRAMEKEYS_H
@@ -38,6 +38,7 @@
 #include "lldir.h"
 #include "llendianswizzle.h"
 #include "llkeyframemotion.h"
+#include "llkeyframekeys.h"
 #include "llquantize.h"
 #include "llvfile.h"
 #include "m3math.h"
@@ -101,28 +102,28 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo(bool silent) const
 		{
 			if (!silent)
 			{
-				llinfos << "\t" << joint_motion_p->mScaleCurve.mNumKeys << " scale keys at "
-				<< joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey) << " bytes" << llendl;
+				llinfos << "\t" << joint_motion_p->mScaleCurve.mKeys.size() << " scale keys at "
+				<< joint_motion_p->mScaleCurve.mKeys.capacity() * sizeof(ScaleKey) << " bytes" << llendl;
 			}
-			total_size += joint_motion_p->mScaleCurve.mNumKeys * sizeof(ScaleKey);
+			total_size += joint_motion_p->mScaleCurve.mKeys.capacity() * sizeof(ScaleKey);
 		}
 		if (joint_motion_p->mUsage & LLJointState::ROT)
 		{
 			if (!silent)
 			{
-				llinfos << "\t" << joint_motion_p->mRotationCurve.mNumKeys << " rotation keys at "
-				<< joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey) << " bytes" << llendl;
+				llinfos << "\t" << joint_motion_p->mRotationCurve.mKeys.size() << " rotation keys at "
+				<< joint_motion_p->mRotationCurve.mKeys.capacity() * sizeof(RotationKey) << " bytes" << llendl;
 			}
-			total_size += joint_motion_p->mRotationCurve.mNumKeys * sizeof(RotationKey);
+			total_size += joint_motion_p->mRotationCurve.mKeys.capacity() * sizeof(RotationKey);
 		}
 		if (joint_motion_p->mUsage & LLJointState::POS)
 		{
 			if (!silent)
 			{
-				llinfos << "\t" << joint_motion_p->mPositionCurve.mNumKeys << " position keys at "
-				<< joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey) << " bytes" << llendl;
+				llinfos << "\t" << joint_motion_p->mPositionCurve.mKeys.size() << " position keys at "
+				<< joint_motion_p->mPositionCurve.mKeys.capacity() * sizeof(PositionKey) << " bytes" << llendl;
 			}
-			total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
+			total_size += joint_motion_p->mPositionCurve.mKeys.capacity() * sizeof(PositionKey);
 		}
 	}
 	//Singu: Also add memory used by the constraints.
@@ -143,7 +144,6 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo(bool silent) const
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 
-
 //-----------------------------------------------------------------------------
 // ScaleCurve::ScaleCurve()
 //-----------------------------------------------------------------------------
@@ -165,7 +165,7 @@ LLKeyframeMotion::ScaleCurve::~ScaleCurve()
 //-----------------------------------------------------------------------------
 // getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration, U32& cursor) const
 {
 	LLVector3 value;
 
@@ -175,42 +175,41 @@ LLVector3 LLKeyframeMotion::ScaleCurve::getValue(F32 time, F32 duration)
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	U32 right = ll_find_key(mKeys, time, cursor);
+	if (right == mKeys.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mScale;
+		value = mKeys.back().mScale;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeys[right].mTime == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mScale;
+		value = mKeys[right].mScale;
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		ScaleKey& scale_before = left->second;
-		ScaleKey& scale_after = right->second;
-		if (right == mKeys.end())
-		{
-			scale_after = mLoopInKey;
-			index_after = duration;
-		}
+		ScaleKey const& scale_before = mKeys[right - 1];
+		ScaleKey const& scale_after = mKeys[right];
 
-		F32 u = (time - index_before) / (index_after - index_before);
+		F32 u = (time - scale_before.mTime) / (scale_after.mTime - scale_before.mTime);
 		value = interp(u, scale_before, scale_after);
 	}
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::ScaleCurve::addKey(ScaleKey const& key)
+{
+	ll_insert_key(mKeys, key);
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey& before, ScaleKey& after)
+LLVector3 LLKeyframeMotion::ScaleCurve::interp(F32 u, ScaleKey const& before, ScaleKey const& after) const
 {
 	switch (mInterpolationType)
 	{
@@ -245,7 +244,7 @@ LLKeyframeMotion::RotationCurve::~RotationCurve()
 //-----------------------------------------------------------------------------
 // RotationCurve::getValue()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
+LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration, U32& cursor) const
 {
 	LLQuaternion value;
 
@@ -255,42 +254,41 @@ LLQuaternion LLKeyframeMotion::RotationCurve::getValue(F32 time, F32 duration)
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	U32 right = ll_find_key(mKeys, time, cursor);
+	if (right == mKeys.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mRotation;
+		value = mKeys.back().mRotation;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeys[right].mTime == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mRotation;
+		value = mKeys[right].mRotation;
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		RotationKey& rot_before = left->second;
-		RotationKey& rot_after = right->second;
-		if (right == mKeys.end())
-		{
-			rot_after = mLoopInKey;
-			index_after = duration;
-		}
+		RotationKey const& rot_before = mKeys[right - 1];
+		RotationKey const& rot_after = mKeys[right];
 
-		F32 u = (time - index_before) / (index_after - index_before);
+		F32 u = (time - rot_before.mTime) / (rot_after.mTime - rot_before.mTime);
 		value = interp(u, rot_before, rot_after);
 	}
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::RotationCurve::addKey(RotationKey const& key)
+{
+	ll_insert_key(mKeys, key);
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey& before, RotationKey& after)
+LLQuaternion LLKeyframeMotion::RotationCurve::interp(F32 u, RotationKey const& before, RotationKey const& after) const
 {
 	switch (mInterpolationType)
 	{
@@ -326,7 +324,7 @@ LLKeyframeMotion::PositionCurve::~PositionCurve()
 //-----------------------------------------------------------------------------
 // PositionCurve::getValue()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
+LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration, U32& cursor) const
 {
 	LLVector3 value;
 
@@ -336,33 +334,24 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 		return value;
 	}
 	
-	key_map_t::iterator right = mKeys.lower_bound(time);
-	if (right == mKeys.end())
+	U32 right = ll_find_key(mKeys, time, cursor);
+	if (right == mKeys.size())
 	{
 		// Past last key
-		--right;
-		value = right->second.mPosition;
+		value = mKeys.back().mPosition;
 	}
-	else if (right == mKeys.begin() || right->first == time)
+	else if (right == 0 || mKeys[right].mTime == time)
 	{
 		// Before first key or exactly on a key
-		value = right->second.mPosition;
+		value = mKeys[right].mPosition;
 	}
 	else
 	{
 		// Between two keys
-		key_map_t::iterator left = right; --left;
-		F32 index_before = left->first;
-		F32 index_after = right->first;
-		PositionKey& pos_before = left->second;
-		PositionKey& pos_after = right->second;
-		if (right == mKeys.end())
-		{
-			pos_after = mLoopInKey;
-			index_after = duration;
-		}
+		PositionKey const& pos_before = mKeys[right - 1];
+		PositionKey const& pos_after = mKeys[right];
 
-		F32 u = (time - index_before) / (index_after - index_before);
+		F32 u = (time - pos_before.mTime) / (pos_after.mTime - pos_before.mTime);
 		value = interp(u, pos_before, pos_after);
 	}
 
@@ -371,10 +360,18 @@ LLVector3 LLKeyframeMotion::PositionCurve::getValue(F32 time, F32 duration)
 	return value;
 }
 
+//-----------------------------------------------------------------------------
+// addKey()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::PositionCurve::addKey(PositionKey const& key)
+{
+	ll_insert_key(mKeys, key);
+}
+
 //-----------------------------------------------------------------------------
 // interp()
 //-----------------------------------------------------------------------------
-LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, PositionKey& after)
+LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey const& before, PositionKey const& after) const
 {
 	switch (mInterpolationType)
 	{
@@ -397,7 +394,7 @@ LLVector3 LLKeyframeMotion::PositionCurve::interp(F32 u, PositionKey& before, Po
 //-----------------------------------------------------------------------------
 // JointMotion::update()
 //-----------------------------------------------------------------------------
-void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration)
+void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time, F32 duration, U32* cursors)
 {
 	// this value being 0 is the cause of https://jira.lindenlab.com/browse/SL-22678 but I haven't 
 	// managed to get a stack to see how it got here. Testing for 0 here will stop the crash.
@@ -413,7 +410,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::SCALE) && mScaleCurve.mNumKeys)
 	{
-		joint_state->setScale( mScaleCurve.getValue( time, duration ) );
+		joint_state->setScale( mScaleCurve.getValue( time, duration, cursors[0] ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -421,7 +418,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::ROT) && mRotationCurve.mNumKeys)
 	{
-		joint_state->setRotation( mRotationCurve.getValue( time, duration ) );
+		joint_state->setRotation( mRotationCurve.getValue( time, duration, cursors[1] ) );
 	}
 
 	//-------------------------------------------------------------------------
@@ -429,7 +426,7 @@ void LLKeyframeMotion::JointMotion::update(LLJointState* joint_state, F32 time,
 	//-------------------------------------------------------------------------
 	if ((usage & LLJointState::POS) && mPositionCurve.mNumKeys)
 	{
-		joint_state->setPosition( mPositionCurve.getValue( time, duration ) );
+		joint_state->setPosition( mPositionCurve.getValue( time, duration, cursors[2] ) );
 	}
 }
 
@@ -450,6 +447,7 @@ LLKeyframeMotion::LLKeyframeMotion(const LLUUID &id, LLMotionController* control
 		mLastSkeletonSerialNum(0),
 		mLastUpdateTime(0.f),
 		mLastLoopedTime(0.f),
+		mDeferredSample(false),
 		mAssetStatus(ASSET_UNDEFINED)
 {
 
@@ -736,7 +734,17 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 		mLastLoopedTime = time;
 	}
 
-	applyKeyframes(mLastLoopedTime);
+	// Constraints work on the sampled joint states, so motions that have
+	// them can't leave the sampling for later.
+	mDeferredSample = mConstraints.empty() && mCharacter->getMotionController().isDeferringUpdate();
+	if (mDeferredSample)
+	{
+		applyHandPose();
+	}
+	else
+	{
+		applyKeyframes(mLastLoopedTime);
+	}
 
 	applyConstraints(mLastLoopedTime, joint_mask);
 
@@ -748,16 +756,52 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 //-----------------------------------------------------------------------------
 // applyKeyframes()
 //-----------------------------------------------------------------------------
+static LLFastTimer::DeclareTimer FTM_APPLY_KEYFRAMES("Apply Keyframes");
+
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
-	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+	LLFastTimer t(FTM_APPLY_KEYFRAMES);
+	sampleKeyframes(time);
+	applyHandPose();
+}
+
+//-----------------------------------------------------------------------------
+// onDeferredUpdate()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::onDeferredUpdate()
+{
+	if (mDeferredSample)
+	{
+		mDeferredSample = false;
+		sampleKeyframes(mLastLoopedTime);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// sampleKeyframes()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::sampleKeyframes(F32 time)
+{
+	U32 const num_joint_motions = mJointMotionList->getNumJointMotions();
+	llassert_always (num_joint_motions <= mJointStates.size());
+	if (mKeyCursors.size() != num_joint_motions * JointMotion::NUM_CURVE_CURSORS)
+	{
+		mKeyCursors.assign(num_joint_motions * JointMotion::NUM_CURVE_CURSORS, 0);
+	}
+	for (U32 i=0; i<num_joint_motions; i++)
 	{
 		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
 													  time, 
-													  mJointMotionList->mDuration );
+													  mJointMotionList->mDuration,
+													  &mKeyCursors[i * JointMotion::NUM_CURVE_CURSORS]);
 	}
+}
 
+//-----------------------------------------------------------------------------
+// applyHandPose()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::applyHandPose()
+{
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
 	{
@@ -1670,8 +1714,10 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 
-			rCurve->mKeys[time] = rot_key;
+			rCurve->addKey(rot_key);
 		}
+		// Curves are shared by every avatar playing this animation; don't keep spare capacity around.
+		RotationCurve::key_list_t(rCurve->mKeys).swap(rCurve->mKeys);
 
 		//---------------------------------------------------------------------
 		// scan position curve header
@@ -1749,13 +1795,14 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp)
 				return FALSE;
 			}
 			
-			pCurve->mKeys[pos_key.mTime] = pos_key;
+			pCurve->addKey(pos_key);
 
 			if (is_pelvis)
 			{
 				mJointMotionList->mPelvisBBox.addPoint(pos_key.mPosition);
 			}
 		}
+		PositionCurve::key_list_t(pCurve->mKeys).swap(pCurve->mKeys);
 
 		joint_motion->mUsage = joint_state->getUsage();
 	}
@@ -2022,10 +2069,10 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		success &= dp.packS32(joint_motionp->mPriority, "joint_priority");
 		success &= dp.packS32(joint_motionp->mRotationCurve.mNumKeys, "num_rot_keys");
 
-		for (RotationCurve::key_map_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
+		for (RotationCurve::key_list_t::iterator iter = joint_motionp->mRotationCurve.mKeys.begin();
 			 iter != joint_motionp->mRotationCurve.mKeys.end(); ++iter)
 		{
-			RotationKey& rot_key = iter->second;
+			RotationKey& rot_key = *iter;
 			U16 time_short = F32_to_U16(rot_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
@@ -2042,10 +2089,10 @@ BOOL LLKeyframeMotion::serialize(LLDataPacker& dp) const
 		}
 
 		success &= dp.packS32(joint_motionp->mPositionCurve.mNumKeys, "num_pos_keys");
-		for (PositionCurve::key_map_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
+		for (PositionCurve::key_list_t::iterator iter = joint_motionp->mPositionCurve.mKeys.begin();
 			 iter != joint_motionp->mPositionCurve.mKeys.end(); ++iter)
 		{
-			PositionKey& pos_key = iter->second;
+			PositionKey& pos_key = *iter;
 			U16 time_short = F32_to_U16(pos_key.mTime, 0.f, mJointMotionList->mDuration);
 			success &= dp.packU16(time_short, "time");
 
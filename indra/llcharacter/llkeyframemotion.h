@@ -254,6 +254,9 @@ public:
 	// called when a motion is deactivated
 	virtual void onDeactivate();
 
+	// samples the curves at the time of the last onUpdate(), if that left it for later
+	virtual void onDeferredUpdate();
+
 	virtual void setStopTime(F32 time);
 
 	static void setVFS(LLVFS* vfs) { sVFS = vfs; }
@@ -370,6 +373,11 @@ protected:
 
 	void applyKeyframes(F32 time);
 
+	// The two parts of applyKeyframes(). Sampling only touches the joint
+	// states of this motion, so it may run on another thread.
+	void sampleKeyframes(F32 time);
+	void applyHandPose();
+
 	void applyConstraints(F32 time, U8* joint_mask);
 
 	void activateConstraint(JointConstraint* constraintp);
@@ -434,13 +442,17 @@ public:
 	public:
 		ScaleCurve();
 		~ScaleCurve();
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, ScaleKey& before, ScaleKey& after);
+		// 'cursor' is the index of the key that the previous call for the same playing motion ended on;
+		// monotonic playback then finds its segment without searching. The curve itself is shared.
+		LLVector3 getValue(F32 time, F32 duration, U32& cursor) const;
+		LLVector3 getValue(F32 time, F32 duration) const { U32 cursor = 0; return getValue(time, duration, cursor); }
+		void addKey(ScaleKey const& key);
+		LLVector3 interp(F32 u, ScaleKey const& before, ScaleKey const& after) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, ScaleKey> key_map_t;
-		key_map_t 			mKeys;
+		typedef std::vector<ScaleKey> key_list_t;	// Sorted by mTime, unique times.
+		key_list_t 			mKeys;
 		ScaleKey			mLoopInKey;
 		ScaleKey			mLoopOutKey;
 	};
@@ -453,13 +465,15 @@ public:
 	public:
 		RotationCurve();
 		~RotationCurve();
-		LLQuaternion getValue(F32 time, F32 duration);
-		LLQuaternion interp(F32 u, RotationKey& before, RotationKey& after);
+		LLQuaternion getValue(F32 time, F32 duration, U32& cursor) const;
+		LLQuaternion getValue(F32 time, F32 duration) const { U32 cursor = 0; return getValue(time, duration, cursor); }
+		void addKey(RotationKey const& key);
+		LLQuaternion interp(F32 u, RotationKey const& before, RotationKey const& after) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, RotationKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<RotationKey> key_list_t;	// Sorted by mTime, unique times.
+		key_list_t		mKeys;
 		RotationKey		mLoopInKey;
 		RotationKey		mLoopOutKey;
 	};
@@ -472,13 +486,15 @@ public:
 	public:
 		PositionCurve();
 		~PositionCurve();
-		LLVector3 getValue(F32 time, F32 duration);
-		LLVector3 interp(F32 u, PositionKey& before, PositionKey& after);
+		LLVector3 getValue(F32 time, F32 duration, U32& cursor) const;
+		LLVector3 getValue(F32 time, F32 duration) const { U32 cursor = 0; return getValue(time, duration, cursor); }
+		void addKey(PositionKey const& key);
+		LLVector3 interp(F32 u, PositionKey const& before, PositionKey const& after) const;
 
 		InterpolationType	mInterpolationType;
 		S32					mNumKeys;
-		typedef std::map<F32, PositionKey> key_map_t;
-		key_map_t		mKeys;
+		typedef std::vector<PositionKey> key_list_t;	// Sorted by mTime, unique times.
+		key_list_t		mKeys;
 		PositionKey		mLoopInKey;
 		PositionKey		mLoopOutKey;
 	};
@@ -496,7 +512,10 @@ public:
 		U32				mUsage;
 		LLJoint::JointPriority	mPriority;
 
-		void update(LLJointState* joint_state, F32 time, F32 duration);
+		// cursors points to the NUM_CURVE_CURSORS segment cursors of the playing motion for this joint.
+		void update(LLJointState* joint_state, F32 time, F32 duration, U32* cursors);
+
+		enum { NUM_CURVE_CURSORS = 3 };
 	};
 	
 	//-------------------------------------------------------------------------
@@ -542,6 +561,7 @@ protected:
 	//-------------------------------------------------------------------------
 	JointMotionListPtr				mJointMotionList;			// singu: automatically clean up cache entry when destructed.
 	std::vector<LLPointer<LLJointState> > mJointStates;
+	std::vector<U32>				mKeyCursors;				// Per instance segment cursors into the shared curves, see JointMotion::update.
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
@@ -549,6 +569,7 @@ protected:
 	U32								mLastSkeletonSerialNum;
 	F32								mLastUpdateTime;
 	F32								mLastLoopedTime;
+	bool							mDeferredSample;			// onDeferredUpdate() still has to sample the curves at mLastLoopedTime
 	AssetStatus						mAssetStatus;
 };
 
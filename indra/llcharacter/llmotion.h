@@ -238,6 +238,11 @@ public:
 	// called when a motion is deactivated
 	virtual void onDeactivate() = 0;
 
+	// called for every active motion by LLMotionController::finishDeferredUpdate(),
+	// possibly on another thread; does what onUpdate() left for later while
+	// the controller was deferring, see LLMotionController::setDeferUpdate()
+	virtual void onDeferredUpdate() {}
+
 	// can we crossfade this motion with a new instance when restarted?
 	// should ultimately always be TRUE, but lack of emote blending, etc
 	// requires this
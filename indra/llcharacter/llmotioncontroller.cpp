@@ -141,7 +141,9 @@ LLMotionController::LLMotionController()
 	  mPauseTime(0.f),
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
-	  mLastInterp(0.f)
+	  mLastInterp(0.f),
+	  mDeferUpdate(false),
+	  mBlendPending(false)
 {
 }
 
@@ -169,6 +171,8 @@ void LLMotionController::incMotionCounts(S32& num_motions, S32& num_loading_moti
 //-----------------------------------------------------------------------------
 void LLMotionController::deleteAllMotions()
 {
+	// The joints may be gone already when this is called from the destructor.
+	mBlendPending = false;
 	mLoadingMotions.clear();
 	mLoadedMotions.clear();
 	mActiveMotions.clear();
@@ -857,6 +861,8 @@ void LLMotionController::updateMotions(bool force_update)
 {
 	BOOL use_quantum = (mTimeStep != 0.f);
 
+	finishDeferredUpdate();
+
 	// Always update mPrevTimerElapsed
 	F32 cur_time = mTimer.getElapsedTimeF32();
 	F32 delta_time = cur_time - mPrevTimerElapsed;
@@ -930,13 +936,13 @@ void LLMotionController::updateMotions(bool force_update)
 		// update all regular motions
 		updateRegularMotions();
 
-		if (use_quantum)
+		if (mDeferUpdate)
 		{
-			mPoseBlender.blendAndCache(TRUE);
+			mBlendPending = true;
 		}
 		else
 		{
-			mPoseBlender.blendAndApply();
+			blendPoses();
 		}
 	}
 
@@ -944,12 +950,47 @@ void LLMotionController::updateMotions(bool force_update)
 //	llinfos << "Motion controller time " << motionTimer.getElapsedTimeF32() << llendl;
 }
 
+//-----------------------------------------------------------------------------
+// finishDeferredUpdate()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishDeferredUpdate()
+{
+	if (!mBlendPending)
+	{
+		return;
+	}
+	mBlendPending = false;
+
+	for (motion_list_t::iterator iter = mActiveMotions.begin(); iter != mActiveMotions.end(); ++iter)
+	{
+		(*iter)->onDeferredUpdate();
+	}
+	blendPoses();
+}
+
+//-----------------------------------------------------------------------------
+// blendPoses()
+//-----------------------------------------------------------------------------
+void LLMotionController::blendPoses()
+{
+	if (mTimeStep != 0.f)
+	{
+		mPoseBlender.blendAndCache(TRUE);
+	}
+	else
+	{
+		mPoseBlender.blendAndApply();
+	}
+}
+
 //-----------------------------------------------------------------------------
 // updateMotionsMinimal()
 // minimal update (e.g. while hidden)
 //-----------------------------------------------------------------------------
 void LLMotionController::updateMotionsMinimal()
 {
+	finishDeferredUpdate();
+
 	// Always update mPrevTimerElapsed
 	mPrevTimerElapsed = mTimer.getElapsedTimeF32();
 
@@ -1141,6 +1182,8 @@ void LLMotionController::dumpMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::deactivateAllMotions()
 {
+	finishDeferredUpdate();
+
 	// Singu note: this must run over mActiveMotions: other motions are not active,
 	// and running over mAllMotions will miss the ones in mDeprecatedMotions.
 	for (motion_list_t::iterator iter = mActiveMotions.begin(); iter != mActiveMotions.end();)
@@ -1155,6 +1198,8 @@ void LLMotionController::deactivateAllMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::flushAllMotions()
 {
+	finishDeferredUpdate();
+
 	std::vector<std::pair<LLUUID,F32> > active_motions;
 	active_motions.reserve(mActiveMotions.size());
 	for (motion_list_t::iterator iter = mActiveMotions.begin();
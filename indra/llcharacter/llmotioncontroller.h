@@ -143,6 +143,16 @@ public:
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
+	// While deferring, updateMotions() leaves blending the poses into the
+	// joints, and keyframe motions leave sampling their curves, to
+	// finishDeferredUpdate(). That only touches the joints and joint states
+	// of this character, so it may run on another thread while nothing else
+	// uses them. Updates and the calls below that change the active motions
+	// finish a deferred update first.
+	void setDeferUpdate(bool defer) { mDeferUpdate = defer; }
+	bool isDeferringUpdate() const { return mDeferUpdate; }
+	void finishDeferredUpdate();
+
 	void clearBlenders() { mPoseBlender.clearBlenders(); }
 
 	// flush motions
@@ -208,6 +218,7 @@ protected:
 	void updateIdleActiveMotions();
 	void purgeExcessMotions();
 	void deactivateStoppedMotions();
+	void blendPoses();
 
 protected:
 	F32					mTimeFactor;			// 1.f for normal speed
@@ -252,6 +263,8 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	bool				mDeferUpdate;
+	bool				mBlendPending;				// blendPoses() was left to finishDeferredUpdate()
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_JOINTS];
 
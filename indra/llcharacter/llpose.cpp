@@ -183,6 +183,7 @@ S32 LLPose::getNumJointStates() const
 //-----------------------------------------------------------------------------
 
 LLJointStateBlender::LLJointStateBlender()
+:	mIsActive(false)
 {
 	for(S32 i = 0; i < JSB_NUM_JOINT_STATES; i++)
 	{
@@ -478,17 +479,12 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 	for(LLJointState* jsp = pose->getFirstJointState(); jsp; jsp = pose->getNextJointState())
 	{
 		LLJoint *jointp = jsp->getJoint();
-		LLJointStateBlender* joint_blender;
-		if (mJointStateBlenderPool.find(jointp) == mJointStateBlenderPool.end())
+		LLJointStateBlender*& joint_blender = mJointStateBlenderPool[jointp];
+		if (!joint_blender)
 		{
 			// this is the first time we are animating this joint
 			// so create new jointblender and add it to our pool
 			joint_blender = new LLJointStateBlender();
-			mJointStateBlenderPool[jointp] = joint_blender;
-		}
-		else
-		{
-			joint_blender = mJointStateBlenderPool[jointp];
 		}
 
 		if (jsp->getPriority() == LLJoint::USE_MOTION_PRIORITY)
@@ -501,9 +497,10 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 		}
 
 		// add it to our list of active blenders
-		if (std::find(mActiveBlenders.begin(), mActiveBlenders.end(), joint_blender) == mActiveBlenders.end())
+		if (!joint_blender->mIsActive)
 		{
-			mActiveBlenders.push_front(joint_blender);
+			joint_blender->mIsActive = true;
+			mActiveBlenders.push_back(joint_blender);
 		}
 	}
 	return TRUE;
@@ -519,6 +516,7 @@ void LLPoseBlender::blendAndApply()
 	{
 		LLJointStateBlender* jsbp = *iter;
 		jsbp->blendJointStates();
+		jsbp->mIsActive = false;
 	}
 
 	// we're done now so there are no more active blenders for this frame
@@ -565,6 +563,7 @@ void LLPoseBlender::clearBlenders()
 	{
 		LLJointStateBlender* jsbp = *iter;
 		jsbp->clear();
+		jsbp->mIsActive = false;
 	}
 
 	mActiveBlenders.clear();
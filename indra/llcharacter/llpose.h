@@ -44,6 +44,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 
 //-----------------------------------------------------------------------------
@@ -104,6 +105,7 @@ public:
 
 public:
 	LLJoint mJointCache;
+	bool mIsActive;		// in the active blenders of the pose blender
 };
 
 class LLMotion;
@@ -111,7 +113,7 @@ class LLMotion;
 class LLPoseBlender
 {
 protected:
-	typedef std::list<LLJointStateBlender*> blender_list_t;
+	typedef std::vector<LLJointStateBlender*> blender_list_t;
 	typedef std::map<LLJoint*,LLJointStateBlender*> blender_map_t;
 	blender_map_t mJointStateBlenderPool;
 	blender_list_t mActiveBlenders;
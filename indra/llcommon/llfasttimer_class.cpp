@@ -341,6 +341,15 @@ LLFastTimer::DeclareTimer::DeclareTimer(const std::string& name)
 	update_cached_pointers_if_changed();
 }
 
+void LLFastTimer::DeclareTimer::addTime(U32 clock_count, U32 calls)
+{
+#if FAST_TIMER_ON
+	mFrameState->mSelfTimeCounter += clock_count;
+	mFrameState->mCalls += calls;
+	mFrameState->mLastCaller = LLFastTimer::sCurTimerData.mNamedTimer;
+#endif
+}
+
 // static
 void LLFastTimer::updateCachedPointers()
 {
@@ -144,6 +144,11 @@ public:
 		DeclareTimer(const std::string& name, bool open);
 		DeclareTimer(const std::string& name);
 
+		// Adds clock_count, measured with getCPUClockCount32() where no
+		// LLFastTimer can run (like on another thread), as calls to this
+		// timer under the timer running now. Main thread only.
+		void addTime(U32 clock_count, U32 calls);
+
 	private:
 		NamedTimer&		mTimer;
 		FrameState*		mFrameState;
@@ -258,10 +263,10 @@ public:
 	static CurTimerData		sCurTimerData;
 	static std::string sClockType;
 
-private:
 	static U32 getCPUClockCount32();
 	static U64 getCPUClockCount64();
 
+private:
 	static S32				sCurFrameIndex;
 	static S32				sLastFrameIndex;
 	static U64				sLastFrameTime;
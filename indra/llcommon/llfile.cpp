@@ -36,6 +36,8 @@
 
 #include "linden_common.h"
 #include "llfile.h"
+#include "llapp.h"
+#include "llatomic.h"
 #include "llstring.h"
 #include "llerror.h"
 #include "stringize.h"
@@ -44,6 +46,9 @@ using namespace std;
 
 static std::string empty;
 
+// Numbers the temporary files of write_replace().
+static LLAtomicU32 sTempFileCount;
+
 // Many of the methods below use OS-level functions that mess with errno. Wrap
 // variants of strerror() to report errors.
 
@@ -291,6 +296,34 @@ int	LLFile::rename(const std::string& filename, const std::string& newname)
 	return warnif(STRINGIZE("rename to '" << newname << "' from"), filename, rc);
 }
 
+//static
+bool LLFile::write_replace(const std::string& filename, const void* data, size_t size, const void* data2, size_t size2)
+{
+	// Named after the process and a counter, so that neither two threads
+	// nor two viewers sharing the directory write the same temporary file.
+	std::string temp_filename = STRINGIZE(filename << '.' << LLApp::getPid() << '.' << sTempFileCount++ << ".tmp");
+	LLFILE* fp = LLFile::fopen(temp_filename, "wb");
+	if (!fp)
+	{
+		return false;
+	}
+	bool written = (!size || fwrite(data, size, 1, fp) == 1) &&
+				   (!size2 || fwrite(data2, size2, 1, fp) == 1);
+	written = LLFile::close(fp) == 0 && written;
+
+	if (written && LLFile::rename_nowarn(temp_filename, filename) != 0)
+	{
+		// Windows won't rename over an existing file.
+		LLFile::remove_nowarn(filename);
+		written = LLFile::rename_nowarn(temp_filename, filename) == 0;
+	}
+	if (!written)
+	{
+		LLFile::remove_nowarn(temp_filename);
+	}
+	return written;
+}
+
 int	LLFile::stat(const std::string& filename, llstat* filestatus)
 {
 #if LL_WINDOWS
@@ -81,6 +81,11 @@ public:
 	static	int		rmdir(const std::string& filename);
 	static	int		remove(const std::string& filename);
 	static	int		rename(const std::string& filename,const std::string&	newname);
+	// Singu extension: writes size bytes at data, followed by size2 bytes at
+	// data2, to a temporary file of its own that then replaces filename, so
+	// that readers never see half a file. Returns false when that failed,
+	// in which case filename may be gone.
+	static	bool	write_replace(const std::string& filename, const void* data, size_t size, const void* data2 = NULL, size_t size2 = 0);
 	static	int		stat(const std::string&	filename,llstat*	file_status);
 	static	bool	isdir(const std::string&	filename);
 	static	bool	isfile(const std::string&	filename);
@@ -0,0 +1,271 @@
+/**
+ * @file llmappedfile.cpp
+ * @brief Cross platform wrapper around a memory-mapped file.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#if LL_WINDOWS
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#include "linden_common.h"
+#include "llmappedfile.h"
+#include "llstring.h"
+
+LLMappedFile::LLMappedFile()
+:	mMode(READ_ONLY),
+	mData(NULL),
+	mSize(0),
+#if LL_WINDOWS
+	mFileHandle(INVALID_HANDLE_VALUE),
+	mMappingHandle(NULL)
+#else
+	mFD(-1)
+#endif
+{
+}
+
+LLMappedFile::~LLMappedFile()
+{
+	close();
+}
+
+bool LLMappedFile::open(const std::string& filename, EMode mode, size_t min_size)
+{
+	close();
+
+	mFilename = filename;
+	mMode = mode;
+
+#if LL_WINDOWS
+	llutf16string utf16filename = utf8str_to_utf16str(filename);
+	DWORD access = (mode == READ_ONLY) ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE);
+	DWORD disposition = (mode == READ_ONLY) ? OPEN_EXISTING : OPEN_ALWAYS;
+	// The share mode doubles as the inter-process lock.
+	DWORD share = (mode == READ_ONLY) ? FILE_SHARE_READ : 0;
+	HANDLE file = CreateFileW(utf16filename.c_str(), access, share, NULL,
+							  disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LL_DEBUGS("MappedFile") << "Couldn't open " << filename << " error " << GetLastError() << LL_ENDL;
+		return false;
+	}
+	mFileHandle = file;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		close();
+		return false;
+	}
+	mSize = (size_t)file_size.QuadPart;
+#else
+	int flags = (mode == READ_ONLY) ? O_RDONLY : (O_RDWR | O_CREAT);
+	mFD = ::open(filename.c_str(), flags, 0600);
+	if (mFD < 0)
+	{
+		LL_DEBUGS("MappedFile") << "Couldn't open " << filename << ": " << LLFile::strerr() << LL_ENDL;
+		return false;
+	}
+	if (flock(mFD, ((mode == READ_ONLY) ? LOCK_SH : LOCK_EX) | LOCK_NB) == -1)
+	{
+		LL_DEBUGS("MappedFile") << "Couldn't lock " << filename << ", in use by another process" << LL_ENDL;
+		close();
+		return false;
+	}
+
+	struct stat file_info;
+	if (fstat(mFD, &file_info) != 0)
+	{
+		close();
+		return false;
+	}
+	mSize = (size_t)file_info.st_size;
+#endif
+
+	if (mSize < min_size && mode == READ_WRITE)
+	{
+		return resize(min_size);
+	}
+
+	if (!map())
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LLMappedFile::close()
+{
+	unmap();
+#if LL_WINDOWS
+	if (mFileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle((HANDLE)mFileHandle);
+		mFileHandle = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (mFD >= 0)
+	{
+		::close(mFD);
+		mFD = -1;
+	}
+#endif
+	mSize = 0;
+}
+
+bool LLMappedFile::resize(size_t new_size)
+{
+	if (mMode == READ_ONLY)
+	{
+		llwarns << "Attempt to resize read-only mapping of " << mFilename << llendl;
+		return false;
+	}
+
+	size_t old_size = mSize;
+	unmap();
+
+	if (!setFileSize(new_size))
+	{
+		llwarns << "Couldn't resize " << mFilename << " to " << new_size << " bytes" << llendl;
+		mSize = old_size;
+		if (!map())
+		{
+			close();
+		}
+		return false;
+	}
+
+	mSize = new_size;
+	if (!map())
+	{
+		// Most likely out of address space: go back to the old size so
+		// that the caller can keep using the existing mapping.
+		if (old_size && setFileSize(old_size))
+		{
+			mSize = old_size;
+			if (map())
+			{
+				return false;
+			}
+		}
+		close();
+		return false;
+	}
+	return true;
+}
+
+bool LLMappedFile::setFileSize(size_t size)
+{
+#if LL_WINDOWS
+	LARGE_INTEGER distance;
+	distance.QuadPart = (LONGLONG)size;
+	return mFileHandle != INVALID_HANDLE_VALUE &&
+		   SetFilePointerEx((HANDLE)mFileHandle, distance, NULL, FILE_BEGIN) &&
+		   SetEndOfFile((HANDLE)mFileHandle);
+#else
+	return mFD >= 0 && ftruncate(mFD, (off_t)size) == 0;
+#endif
+}
+
+void LLMappedFile::flush(bool async)
+{
+	if (!mData || mMode == READ_ONLY)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	FlushViewOfFile(mData, 0);
+	if (!async)
+	{
+		FlushFileBuffers((HANDLE)mFileHandle);
+	}
+#else
+	msync(mData, mSize, async ? MS_ASYNC : MS_SYNC);
+#endif
+}
+
+bool LLMappedFile::map()
+{
+	llassert(!mData);
+
+	if (!mSize)
+	{
+		// Zero sized mappings are not allowed on any platform.
+		return false;
+	}
+
+#if LL_WINDOWS
+	DWORD protect = (mMode == READ_ONLY) ? PAGE_READONLY : PAGE_READWRITE;
+	mMappingHandle = CreateFileMappingW((HANDLE)mFileHandle, NULL, protect, 0, 0, NULL);
+	if (!mMappingHandle)
+	{
+		llwarns << "Couldn't create mapping for " << mFilename << " error " << GetLastError() << llendl;
+		return false;
+	}
+	DWORD access = (mMode == READ_ONLY) ? FILE_MAP_READ : FILE_MAP_WRITE;
+	mData = (U8*)MapViewOfFile((HANDLE)mMappingHandle, access, 0, 0, mSize);
+	if (!mData)
+	{
+		llwarns << "Couldn't map " << mFilename << " error " << GetLastError() << llendl;
+		CloseHandle((HANDLE)mMappingHandle);
+		mMappingHandle = NULL;
+		return false;
+	}
+#else
+	int prot = (mMode == READ_ONLY) ? PROT_READ : (PROT_READ | PROT_WRITE);
+	void* addr = mmap(NULL, mSize, prot, MAP_SHARED, mFD, 0);
+	if (addr == MAP_FAILED)
+	{
+		llwarns << "Couldn't map " << mFilename << ": " << LLFile::strerr() << llendl;
+		return false;
+	}
+	mData = (U8*)addr;
+#endif
+	return true;
+}
+
+void LLMappedFile::unmap()
+{
+	if (!mData)
+	{
+		return;
+	}
+#if LL_WINDOWS
+	UnmapViewOfFile(mData);
+	CloseHandle((HANDLE)mMappingHandle);
+	mMappingHandle = NULL;
+#else
+	munmap(mData, mSize);
+#endif
+	mData = NULL;
+}
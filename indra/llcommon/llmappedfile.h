@@ -0,0 +1,96 @@
+/**
+ * @file llmappedfile.h
+ * @brief Cross platform wrapper around a memory-mapped file.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMAPPEDFILE_H
+#define LL_LLMAPPEDFILE_H
+
+#include <string>
+
+/**
+ * @class LLMappedFile
+ * @brief Maps a whole file into the address space of the process.
+ *
+ * The mapping is always of the complete file. Growing or shrinking the
+ * file with resize() remaps it, so any pointer obtained from getData()
+ * before the call is invalid afterwards. Callers that share a mapping
+ * between threads must serialize resize() against all other accesses.
+ */
+class LL_COMMON_API LLMappedFile
+{
+public:
+	enum EMode
+	{
+		READ_ONLY,		// The file must exist; the mapping is read-only.
+		READ_WRITE		// The file is created when missing.
+	};
+
+	LLMappedFile();
+	~LLMappedFile();
+
+	// Opens and maps filename. When min_size is larger than the current
+	// file size (and the mode is READ_WRITE) the file is grown first.
+	// Returns false on failure, in which case the object stays closed.
+	bool open(const std::string& filename, EMode mode, size_t min_size = 0);
+	void close();
+
+	// Changes the size of the file and remaps it. READ_WRITE only.
+	// On failure the old mapping is restored when possible, callers
+	// should check isOpen() to find out whether it still is usable.
+	bool resize(size_t new_size);
+
+	// Schedules dirty pages to be written back. When async is false the
+	// call blocks until the data reached the disk.
+	void flush(bool async = true);
+
+	bool isOpen() const					{ return mData != NULL; }
+	bool isReadOnly() const				{ return mMode == READ_ONLY; }
+	U8* getData() const					{ return mData; }
+	size_t getSize() const				{ return mSize; }
+	const std::string& getFilename() const	{ return mFilename; }
+
+private:
+	bool map();
+	void unmap();
+	bool setFileSize(size_t size);
+
+private:
+	// Disallow copy construction and assignment.
+	LLMappedFile(LLMappedFile const&);
+	LLMappedFile& operator=(LLMappedFile const&);
+
+	std::string	mFilename;
+	EMode		mMode;
+	U8*			mData;
+	size_t		mSize;
+#if LL_WINDOWS
+	void*		mFileHandle;
+	void*		mMappingHandle;
+#else
+	int			mFD;
+#endif
+};
+
+#endif // LL_LLMAPPEDFILE_H
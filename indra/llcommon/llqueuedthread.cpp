@@ -31,13 +31,30 @@
 
 //============================================================================
 
+// Processes one request of its LLQueuedThread on a thread of the pool.
+class LLQueuedThread::PoolTask : public LLThreadPool::Task
+{
+public:
+	PoolTask(LLQueuedThread* thread) : mThread(thread) { }
+	/*virtual*/ void run() { mThread->runPoolTask(); }
+	/*virtual*/ void drop() { mThread->dropPoolTask(); }
+
+private:
+	LLQueuedThread* mThread;
+};
+
 // MAIN THREAD
-LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause) :
+LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool should_pause,
+							   LLThreadPool* pool, U32 pool_concurrency) :
 	LLThread(name),
 	mThreaded(threaded),
 	mIdleThread(TRUE),
 	mNextHandle(0),
-	mStarted(FALSE)
+	mStarted(FALSE),
+	mThreadPool(NULL),
+	mPoolConcurrency(1),
+	mPoolTasks(0),
+	mPoolTasksWaiting(0)
 {
 	if (mThreaded)
 	{
@@ -46,7 +63,17 @@ LLQueuedThread::LLQueuedThread(const std::string& name, bool threaded, bool shou
 			pause() ; //call this before start the thread.
 		}
 
-		start();
+		if (pool && pool->getThreadCount())
+		{
+			mThreadPool = pool;
+			mStarted = TRUE;
+			mStatus = RUNNING;
+			setPoolConcurrency(pool_concurrency);
+		}
+		else
+		{
+			start();
+		}
 	}
 }
 
@@ -66,7 +93,24 @@ void LLQueuedThread::shutdown()
 	setQuitting();
 
 	unpause(); // MAIN THREAD
-	if (mThreaded)
+	if (mThreadPool)
+	{
+		// Tasks that didn't start yet return right away now, wait for
+		// the ones processing a request. Every posted task holds on to us
+		// until it ran or the pool dropped it, so we can't go before that.
+		lockData();
+		if (mPoolTasks)
+		{
+			llinfos << "LLQueuedThread (" << mName << ") waiting for " << mPoolTasks << " pool tasks" << llendl;
+		}
+		while (mPoolTasks)
+		{
+			mRunCondition->wait();
+		}
+		unlockData();
+		mStatus = STOPPED;
+	}
+	else if (mThreaded)
 	{
 		S32 timeout = 100;
 		for ( ; timeout>0; timeout--)
@@ -135,6 +179,10 @@ S32 LLQueuedThread::updateQueue(F32 max_time_ms)
 		if(pending > 0)
 		{
 			unpause();
+			if (mThreadPool)
+			{
+				postPoolTasks(); // in case requests were added while paused
+			}
 		}
 	}
 	else
@@ -154,13 +202,116 @@ void LLQueuedThread::incQueue()
 	// Something has been added to the queue
 	if (!isPaused())
 	{
-		if (mThreaded)
+		if (mThreadPool)
+		{
+			postPoolTasks();
+		}
+		else if (mThreaded)
 		{
 			wake(); // Wake the thread up if necessary.
 		}
 	}
 }
 
+void LLQueuedThread::setPoolConcurrency(U32 concurrency)
+{
+	if (!mThreadPool)
+	{
+		return;
+	}
+	lockData();
+	mPoolConcurrency = concurrency ? concurrency : mThreadPool->getThreadCount();
+	unlockData();
+	postPoolTasks();
+}
+
+// Called with lockData() held. Returns how many more pool tasks to post
+// and counts them as posted already.
+U32 LLQueuedThread::reservePoolTasks(LLThreadPool::ELane& lane)
+{
+	if (isPaused() || isQuitting() || mRequestQueue.empty())
+	{
+		return 0;
+	}
+	U32 count = 0;
+	U32 queued = mRequestQueue.size();
+	while (mPoolTasks < mPoolConcurrency && mPoolTasksWaiting < queued)
+	{
+		++mPoolTasks;
+		++mPoolTasksWaiting;
+		++count;
+	}
+	if (count)
+	{
+		mIdleThread = FALSE;
+		U32 priority = (*mRequestQueue.begin())->getPriority();
+		lane = priority >= PRIORITY_HIGH ? LLThreadPool::LANE_HIGH :
+			   priority >= PRIORITY_NORMAL ? LLThreadPool::LANE_NORMAL :
+			   LLThreadPool::LANE_LOW;
+	}
+	return count;
+}
+
+// May be called from any thread
+void LLQueuedThread::postPoolTasks()
+{
+	LLThreadPool::ELane lane = LLThreadPool::LANE_NORMAL;
+	lockData();
+	U32 count = reservePoolTasks(lane);
+	unlockData();
+	for (U32 i = 0; i < count; ++i)
+	{
+		mThreadPool->post(new PoolTask(this), lane);
+	}
+}
+
+// Runs on the thread destroying mThreadPool
+void LLQueuedThread::dropPoolTask()
+{
+	lockData();
+	--mPoolTasksWaiting;
+	if (!--mPoolTasks)
+	{
+		mRunCondition->broadcast();		// for shutdown()
+	}
+	unlockData();
+}
+
+// Runs on a thread of mThreadPool
+void LLQueuedThread::runPoolTask()
+{
+	lockData();
+	--mPoolTasksWaiting;
+	bool process = !isPaused() && !isQuitting();
+	unlockData();
+
+	if (process)
+	{
+		processNextRequest();
+	}
+
+	// Decide on the follow up tasks before giving up ours, as shutdown()
+	// may destroy us as soon as mPoolTasks drops to zero.
+	LLThreadPool::ELane lane = LLThreadPool::LANE_NORMAL;
+	LLThreadPool* pool = mThreadPool;
+	lockData();
+	--mPoolTasks;
+	U32 count = reservePoolTasks(lane);
+	if (!mPoolTasks)
+	{
+		if (mRequestQueue.empty())
+		{
+			mIdleThread = TRUE;
+		}
+		mRunCondition->broadcast();		// for shutdown()
+	}
+	unlockData();
+	for (U32 i = 0; i < count; ++i)
+	{
+		pool->post(new PoolTask(this), lane);
+	}
+}
+
 //virtual
 // May be called from any thread
 S32 LLQueuedThread::getPending()
@@ -511,7 +662,7 @@ S32 LLQueuedThread::processNextRequest()
 			req->setStatus(STATUS_QUEUED);
 			mRequestQueue.insert(req);
 			unlockData();
-			if (mThreaded && start_priority < PRIORITY_NORMAL)
+			if (mThreaded && !mThreadPool && start_priority < PRIORITY_NORMAL)
 			{
 				ms_sleep(1); // sleep the thread a little
 			}
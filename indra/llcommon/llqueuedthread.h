@@ -35,11 +35,19 @@
 #include "llapr.h"
 
 #include "llthread.h"
+#include "llthreadpool.h"
 #include "llsimplehash.h"
 
 //============================================================================
 // Note: ~LLQueuedThread is O(N) N=# of queued threads, assumed to be small
 //   It is assumed that LLQueuedThreads are rarely created/destroyed.
+//
+// When constructed with a thread pool, no thread of its own is started:
+//   requests are processed by tasks posted to the pool instead, at most
+//   pool_concurrency of them at a time (0 for as many as the pool has
+//   threads), in the lane that matches the
+//   priority of the first queued request. startThread(), endThread() and
+//   threadedUpdate() are only called when running on an own thread.
 
 class LL_COMMON_API LLQueuedThread : public LLThread
 {
@@ -155,7 +163,8 @@ public:
 	static handle_t nullHandle() { return handle_t(0); }
 	
 public:
-	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false);
+	LLQueuedThread(const std::string& name, bool threaded = true, bool should_pause = false,
+				   LLThreadPool* pool = NULL, U32 pool_concurrency = 1);
 	virtual ~LLQueuedThread();	
 	virtual void shutdown();
 	
@@ -164,6 +173,13 @@ private:
 	LLQueuedThread(const LLQueuedThread&);
 	LLQueuedThread& operator=(const LLQueuedThread&);
 
+	class PoolTask;
+	friend class PoolTask;
+	U32 reservePoolTasks(LLThreadPool::ELane& lane);	// lockData() must be held
+	void postPoolTasks();
+	void runPoolTask();
+	void dropPoolTask();
+
 	virtual bool runCondition(void);
 	virtual void run(void);
 	virtual void startThread(void);
@@ -187,6 +203,11 @@ public:
 
 	virtual S32 getPending();
 	bool getThreaded() { return mThreaded ? true : false; }
+	LLThreadPool* getThreadPool() { return mThreadPool; }
+	// How many requests may be processed at once when running on a pool,
+	// 0 for as many as the pool has threads. Takes effect on the next post.
+	void setPoolConcurrency(U32 concurrency);
+	U32 getPoolConcurrency() { return mPoolConcurrency; }
 
 	// Request accessors
 	status_t getRequestStatus(handle_t handle);
@@ -214,6 +235,12 @@ protected:
 	request_hash_t mRequestHash;
 
 	handle_t mNextHandle;
+
+	LLThreadPool* mThreadPool;	// NULL when running on our own thread
+	U32 mPoolConcurrency;
+	// Protected by lockData():
+	U32 mPoolTasks;				// tasks posted to mThreadPool that didn't finish yet
+	U32 mPoolTasksWaiting;		// those of them that didn't start yet
 };
 
 #endif // LL_LLQUEUEDTHREAD_H
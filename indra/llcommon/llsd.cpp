@@ -31,6 +31,7 @@
 #include "../llmath/llmath.h"
 #include "llformat.h"
 #include "llsdserialize.h"
+#include "llatomic.h"
 
 #ifndef LL_RELEASE_FOR_DOWNLOAD
 #define NAME_UNNAMED_NAMESPACE
@@ -60,7 +61,13 @@ class LLSD::Impl
 {
 private:
 	U32 mUseCount;
-	
+		///< For nodes owned by an LLSDArena the ARENA_OWNED bit is set on
+		//   top of the count.
+
+	enum { ARENA_OWNED = 0x80000000, USE_COUNT_MASK = 0x7fffffff };
+
+	friend class LLSDArena;
+
 protected:
 	Impl();
 
@@ -72,7 +79,8 @@ protected:
 		
 	virtual ~Impl();
 	
-	bool shared() const							{ return mUseCount > 1; }
+	bool arenaOwned() const						{ return (mUseCount & ARENA_OWNED) != 0; }
+	bool shared() const							{ return (mUseCount & USE_COUNT_MASK) > 1; }
 	
 public:
 	static void reset(Impl*& var, Impl* impl);
@@ -134,12 +142,96 @@ public:
 	static U32 sOutstandingCount;
 };
 
+/**
+ * LLSDArena
+ *
+ * Bump allocates the nodes created during one LLSDArenaScope from small
+ * chunks, each node preceded by a pointer to its chunk. Nodes keep their
+ * own use counts and are destroyed as soon as the last reference goes,
+ * like any other node. A chunk counts its live nodes and is freed with the
+ * last of them, so a value kept from a large document holds on to one chunk
+ * rather than to the whole document. As subtrees of a document may be
+ * handed to other threads, these counts are atomic.
+ *
+ * The arena itself only lives while its scope does.
+ */
+class LLSDArena
+{
+public:
+	LLSDArena();
+	~LLSDArena();
+		///< ends building; chunks still holding nodes stay behind
+
+	static LLSDArena* building()				{ return sBuilding; }
+	static void setBuilding(LLSDArena* arena)	{ sBuilding = arena; }
+
+	void* allocate(size_t size);
+	static void adopt(LLSD::Impl* impl);
+		///< marks a node constructed in allocate()'d storage as ours
+
+	static void destroy(LLSD::Impl* impl);
+		///< runs the destructor of an arena node whose use count hit zero
+
+	static U32 getChunkCount()					{ return sChunkCount; }
+
+private:
+	struct Chunk
+	{
+		LLAtomicU32 mLiveCount;		// live nodes, plus one while allocated from
+	};
+
+	static Chunk* owner(const LLSD::Impl* impl)
+		{ return *(Chunk* const*)((const char*)impl - HEADER_SIZE); }
+	static void release(Chunk* chunk);
+
+	enum { HEADER_SIZE = 8 };		// keeps the nodes 8 byte aligned
+	enum { CHUNK_HEADER_SIZE = 16, CHUNK_SIZE = 8192 };
+
+	Chunk* mChunk;
+	char* mCurrent;
+	char* mEnd;
+
+	static ll_thread_local LLSDArena* sBuilding;
+	static LLAtomicU32 sChunkCount;
+};
+
+ll_thread_local LLSDArena* LLSDArena::sBuilding = NULL;
+LLAtomicU32 LLSDArena::sChunkCount;
+
+
 #ifdef NAME_UNNAMED_NAMESPACE
 namespace LLSDUnnamedNamespace 
 #else
 namespace 
 #endif
 {
+	template<class T>
+	T* new_impl()
+		///< allocates from the arena this thread is filling, if any
+	{
+		LLSDArena* arena = LLSDArena::building();
+		if (!arena)
+		{
+			return new T;
+		}
+		T* impl = new (arena->allocate(sizeof(T))) T;
+		LLSDArena::adopt(impl);
+		return impl;
+	}
+
+	template<class T, class Arg>
+	T* new_impl(const Arg& arg)
+	{
+		LLSDArena* arena = LLSDArena::building();
+		if (!arena)
+		{
+			return new T(arg);
+		}
+		T* impl = new (arena->allocate(sizeof(T))) T(arg);
+		LLSDArena::adopt(impl);
+		return impl;
+	}
+
 	template<LLSD::Type T, class Data, class DataRef = Data>
 	class ImplBase : public LLSD::Impl
 		///< This class handles most of the work for a subclass of Impl
@@ -331,11 +423,9 @@ namespace
 		
 		DataMap mData;
 		
-	protected:
-		ImplMap(const DataMap& data) : mData(data) { }
-		
 	public:
 		ImplMap() { }
+		ImplMap(const DataMap& data) : mData(data) { }
 		
 		virtual ImplMap& makeMap(LLSD::Impl*&);
 
@@ -366,7 +456,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplMap* i = new ImplMap(mData);
+			ImplMap* i = new_impl<ImplMap>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -400,7 +490,12 @@ namespace
 	
 	LLSD& ImplMap::ref(const LLSD::String& k)
 	{
-		return mData[k];
+		DataMap::iterator i = mData.lower_bound(k);
+		if (i == mData.end()  ||  mData.key_comp()(k, i->first))
+		{
+			i = mData.insert(i, DataMap::value_type(k, LLSD()));
+		}
+		return i->second;
 	}
 	
 	const LLSD& ImplMap::ref(const LLSD::String& k) const
@@ -421,11 +516,9 @@ namespace
 		
 		DataVector mData;
 		
-	protected:
-		ImplArray(const DataVector& data) : mData(data) { }
-		
 	public:
 		ImplArray() { }
+		ImplArray(const DataVector& data) : mData(data) { }
 		
 		virtual ImplArray& makeArray(Impl*&);
 
@@ -455,7 +548,7 @@ namespace
 	{
 		if (shared())
 		{
-			ImplArray* i = new ImplArray(mData);
+			ImplArray* i = new_impl<ImplArray>(mData);
 			Impl::assign(var, i);
 			return *i;
 		}
@@ -566,9 +659,16 @@ LLSD::Impl::~Impl()
 void LLSD::Impl::reset(Impl*& var, Impl* impl)
 {
 	if (impl) ++impl->mUseCount;
-	if (var  &&  --var->mUseCount == 0)
+	if (var  &&  (--var->mUseCount & USE_COUNT_MASK) == 0)
 	{
-		delete var;
+		if (var->arenaOwned())
+		{
+			LLSDArena::destroy(var);
+		}
+		else
+		{
+			delete var;
+		}
 	}
 	var = impl;
 }
@@ -587,14 +687,14 @@ const LLSD::Impl& LLSD::Impl::safe(const Impl* impl)
 
 ImplMap& LLSD::Impl::makeMap(Impl*& var)
 {
-	ImplMap* im = new ImplMap;
+	ImplMap* im = new_impl<ImplMap>();
 	reset(var, im);
 	return *im;
 }
 
 ImplArray& LLSD::Impl::makeArray(Impl*& var)
 {
-	ImplArray* ia = new ImplArray;
+	ImplArray* ia = new_impl<ImplArray>();
 	reset(var, ia);
 	return *ia;
 }
@@ -612,42 +712,42 @@ void LLSD::Impl::assignUndefined(Impl*& var)
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Boolean v)
 {
-	reset(var, new ImplBoolean(v));
+	reset(var, new_impl<ImplBoolean>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Integer v)
 {
-	reset(var, new ImplInteger(v));
+	reset(var, new_impl<ImplInteger>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, LLSD::Real v)
 {
-	reset(var, new ImplReal(v));
+	reset(var, new_impl<ImplReal>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::String& v)
 {
-	reset(var, new ImplString(v));
+	reset(var, new_impl<ImplString>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::UUID& v)
 {
-	reset(var, new ImplUUID(v));
+	reset(var, new_impl<ImplUUID>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Date& v)
 {
-	reset(var, new ImplDate(v));
+	reset(var, new_impl<ImplDate>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::URI& v)
 {
-	reset(var, new ImplURI(v));
+	reset(var, new_impl<ImplURI>(v));
 }
 
 void LLSD::Impl::assign(Impl*& var, const LLSD::Binary& v)
 {
-	reset(var, new ImplBinary(v));
+	reset(var, new_impl<ImplBinary>(v));
 }
 
 
@@ -661,6 +761,101 @@ U32 LLSD::Impl::sAllocationCount = 0;
 U32 LLSD::Impl::sOutstandingCount = 0;
 
 
+LLSDArena::LLSDArena()
+	: mChunk(NULL),
+	  mCurrent(NULL),
+	  mEnd(NULL)
+{
+}
+
+LLSDArena::~LLSDArena()
+{
+	if (mChunk)
+	{
+		release(mChunk);
+	}
+}
+
+void* LLSDArena::allocate(size_t size)
+{
+	size = HEADER_SIZE + ((size + 7) & ~(size_t)7);
+	if (!mCurrent || mCurrent + size > mEnd)
+	{
+		if (mChunk)
+		{
+			release(mChunk);
+		}
+		size_t chunk_size = llmax((size_t)CHUNK_SIZE, CHUNK_HEADER_SIZE + size);
+		char* storage = new char[chunk_size];
+		mChunk = new (storage) Chunk;
+		mChunk->mLiveCount = 1;
+		mCurrent = storage + CHUNK_HEADER_SIZE;
+		mEnd = storage + chunk_size;
+		sChunkCount++;
+	}
+	char* header = mCurrent;
+	mCurrent += size;
+	*(Chunk**)header = mChunk;
+	mChunk->mLiveCount++;
+	return header + HEADER_SIZE;
+}
+
+//static
+void LLSDArena::adopt(LLSD::Impl* impl)
+{
+	impl->mUseCount = LLSD::Impl::ARENA_OWNED;
+}
+
+//static
+void LLSDArena::destroy(LLSD::Impl* impl)
+{
+	Chunk* chunk = owner(impl);
+	// Releases the children first, the node itself still counts.
+	impl->~Impl();
+	release(chunk);
+}
+
+//static
+void LLSDArena::release(Chunk* chunk)
+{
+	if (!--chunk->mLiveCount)
+	{
+		chunk->~Chunk();
+		delete [] (char*)chunk;
+		--sChunkCount;
+	}
+}
+
+
+bool LLSDArenaScope::sEnabled = true;
+
+LLSDArenaScope::LLSDArenaScope()
+	: mArena(NULL)
+{
+	// Nested scopes add to the outer arena.
+	if (sEnabled && !LLSDArena::building())
+	{
+		mArena = new LLSDArena;
+		LLSDArena::setBuilding(mArena);
+	}
+}
+
+LLSDArenaScope::~LLSDArenaScope()
+{
+	if (mArena)
+	{
+		LLSDArena::setBuilding(NULL);
+		delete mArena;
+	}
+}
+
+//static
+U32 LLSDArenaScope::getChunkCount()
+{
+	return LLSDArena::getChunkCount();
+}
+
+
 
 #ifdef NAME_UNNAMED_NAMESPACE
 namespace LLSDUnnamedNamespace 
@@ -455,6 +455,34 @@ struct llsd_select_string : public std::unary_function<LLSD, LLSD::String>
 
 LL_COMMON_API std::ostream& operator<<(std::ostream& s, const LLSD& llsd);
 
+class LLSDArena;
+
+/**
+ * While an LLSDArenaScope exists, all LLSD values created by the current
+ * thread are bump allocated from small chunks of memory. Arena values are
+ * reference counted and destroyed one by one like any other; a chunk is
+ * freed once the last value in it is gone.
+ *
+ * The deserializers use a scope for every document they parse, so a value
+ * kept from a document holds on to its chunk. Extract what you need
+ * (asString() etc.) rather than holding on to many small parts of large
+ * documents.
+ */
+class LL_COMMON_API LLSDArenaScope
+{
+public:
+	LLSDArenaScope();
+	~LLSDArenaScope();
+
+	static bool sEnabled;	///< when false, scopes do nothing
+
+	static U32 getChunkCount();
+		///< chunks currently allocated by all arenas, for testing
+
+private:
+	LLSDArena* mArena;
+};
+
 /** QUESTIONS & TO DOS
 	- Would Binary be more convenient as unsigned char* buffer semantics?
 	- Should Binary be convertible to/from String, and if so how?
@@ -46,6 +46,7 @@
 
 #include "lldate.h"
 #include "llsd.h"
+#include "llsdview.h"
 #include "llstring.h"
 #include "lluri.h"
 
@@ -183,6 +184,32 @@ fail:
 	return false;
 }
 
+// static
+S32 LLSDSerialize::fromBinaryBuffer(LLSD& sd, const U8* buffer, S32 size)
+{
+	LLSDBinaryView view;
+	S32 used = view.parse(buffer, size);
+	if (used > 0)
+	{
+		LLSDArenaScope arena;
+		sd = view.root().asLLSD();
+	}
+	return used;
+}
+
+// static
+S32 LLSDSerialize::fromNotationBuffer(LLSD& sd, const U8* buffer, S32 size)
+{
+	LLSDBinaryView view;
+	S32 used = view.parseNotation(buffer, size);
+	if (used > 0)
+	{
+		LLSDArenaScope arena;
+		sd = view.root().asLLSD();
+	}
+	return used;
+}
+
 /**
  * Endian handlers
  */
@@ -321,6 +348,7 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes)
 {
 	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
 	mMaxBytesLeft = max_bytes;
+	LLSDArenaScope arena;
 	return doParse(istr, data);
 }
 
@@ -330,6 +358,7 @@ S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
 {
 	mCheckLimits = false;
 	mParseLines = true;
+	LLSDArenaScope arena;
 	return doParse(istr, data);
 }
 
@@ -2081,12 +2110,9 @@ std::string zip_llsd(LLSD& data)
 }
 
 //decompress a block of LLSD from provided istream
-// not very efficient -- creats a copy of decompressed LLSD block in memory
-// and deserializes from that copy using LLSDSerialize
-bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
+bool unzip_llsd(LLSDBinaryView& view, std::vector<U8>& buffer, std::istream& is, S32 size)
 {
-	U8* result = NULL;
-	U32 cur_size = 0;
+	buffer.clear();
 	z_stream strm;
 		
 	const U32 CHUNK = 65536;
@@ -2112,7 +2138,6 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 		if (ret == Z_STREAM_ERROR)
 		{
 			inflateEnd(&strm);
-			free(result);
 			delete [] in;
 			return false;
 		}
@@ -2124,7 +2149,6 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 		case Z_DATA_ERROR:
 		case Z_MEM_ERROR:
 			inflateEnd(&strm);
-			free(result);
 			delete [] in;
 			return false;
 			break;
@@ -2132,44 +2156,50 @@ bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 
 		U32 have = CHUNK-strm.avail_out;
 
-		result = (U8*) realloc(result, cur_size + have);
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
+		buffer.insert(buffer.end(), out, out + have);
 
 	} while (ret == Z_OK);
 
 	inflateEnd(&strm);
 	delete [] in;
 
-	if (ret != Z_STREAM_END)
+	if (ret != Z_STREAM_END || buffer.empty())
 	{
-		free(result);
 		return false;
 	}
 
-	//result now points to the decompressed LLSD block
-	{
-		std::string res_str((char*) result, cur_size);
+	//buffer now holds the decompressed LLSD block
+	U8* block = &buffer[0];
+	U32 block_size = (U32)buffer.size();
 
-		std::string deprecated_header("<? LLSD/Binary ?>");
+	static const std::string deprecated_header("<? LLSD/Binary ?>");
 
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
-		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
-		}
-		cur_size = res_str.size();
+	if (block_size > deprecated_header.size() &&
+		!memcmp(block, deprecated_header.data(), deprecated_header.size()))
+	{
+		block += deprecated_header.size()+1;
+		block_size -= deprecated_header.size()+1;
+	}
 
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
-		{
-			llwarns << "Failed to unzip LLSD block" << llendl;
-			free(result);
-			return false;
-		}		
+	// Parse in place, no need to copy the block into a stream.
+	if (view.parse(block, block_size) <= 0)
+	{
+		llwarns << "Failed to unzip LLSD block" << llendl;
+		return false;
 	}
+	return true;
+}
 
-	free(result);
+bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
+{
+	LLSDBinaryView view;
+	std::vector<U8> buffer;
+	if (!unzip_llsd(view, buffer, is, size))
+	{
+		return false;
+	}
+	LLSDArenaScope arena;
+	data = view.root().asLLSD();
 	return true;
 }
 //This unzip function will only work with a gzip header and trailer - while the contents
@@ -36,10 +36,13 @@
 #define LL_LLSDSERIALIZE_H
 
 #include <iosfwd>
+#include <vector>
 #include "llpointer.h"
 #include "llrefcount.h"
 #include "llsd.h"
 
+class LLSDBinaryView;
+
 /** 
  * @class LLSDParser
  * @brief Abstract base class for LLSD parsers.
@@ -789,10 +792,25 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	/**
+	 * @brief Parses binary LLSD straight from memory, see LLSDBinaryView.
+	 *
+	 * This builds the whole tree. Callers that only read parts of the
+	 * data should keep an LLSDBinaryView instead.
+	 *
+	 * @return Returns the number of bytes used, or
+	 * LLSDParser::PARSE_FAILURE, in which case sd is left alone.
+	 */
+	static S32 fromBinaryBuffer(LLSD& sd, const U8* buffer, S32 size);
+	// Same for notation LLSD.
+	static S32 fromNotationBuffer(LLSD& sd, const U8* buffer, S32 size);
 };
 
 //dirty little zip functions -- yell at davep
 LL_COMMON_API std::string zip_llsd(LLSD& data);
 LL_COMMON_API bool unzip_llsd(LLSD& data, std::istream& is, S32 size);
+// Leaves the decompressed block in buffer and parses it into view, for
+// callers that read the data without needing a whole LLSD tree.
+LL_COMMON_API bool unzip_llsd(LLSDBinaryView& view, std::vector<U8>& buffer, std::istream& is, S32 size);
 LL_COMMON_API U8* unzip_llsdNavMesh( bool& valid, unsigned int& outsize,std::istream& is, S32 size);
 #endif // LL_LLSDSERIALIZE_H
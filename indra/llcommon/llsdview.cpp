@@ -0,0 +1,974 @@
+/**
+ * @file llsdview.cpp
+ * @brief Read-only LLSD views into a binary serialized buffer.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llsdview.h"
+
+#if !LL_WINDOWS
+#include <netinet/in.h> // ntohl
+#endif
+
+#include "apr_base64.h"
+
+#include "lldate.h"
+#include "llsdserialize.h"
+#include "llstring.h"
+#include "lluri.h"
+
+// Defined in llsdserialize.cpp
+F64 ll_ntohd(F64 netdouble);
+
+// Deeper nesting than this is not produced by anything we talk to, and
+// bounds the recursion on malicious input.
+static const S32 MAX_NESTING_DEPTH = 256;
+
+/**
+ * LLSDBinaryView
+ */
+
+LLSDBinaryView::LLSDBinaryView()
+:	mBuffer(NULL),
+	mSize(0),
+	mPos(0)
+{
+}
+
+void LLSDBinaryView::clear()
+{
+	mNodes.clear();
+	mBuffer = NULL;
+	mSize = 0;
+	mPos = 0;
+}
+
+S32 LLSDBinaryView::parse(const U8* buffer, S32 size)
+{
+	return parseBuffer(buffer, size, false);
+}
+
+S32 LLSDBinaryView::parseNotation(const U8* buffer, S32 size)
+{
+	return parseBuffer(buffer, size, true);
+}
+
+S32 LLSDBinaryView::parseBuffer(const U8* buffer, S32 size, bool notation)
+{
+	clear();
+	if (!buffer || size <= 0)
+	{
+		return LLSDParser::PARSE_FAILURE;
+	}
+	mBuffer = buffer;
+	mSize = (U32)size;
+	if (!(notation ? parseNotationValue(0) : parseValue(0)))
+	{
+		clear();
+		return LLSDParser::PARSE_FAILURE;
+	}
+	return (S32)mPos;
+}
+
+S32 LLSDBinaryView::addNode(U8 type, U32 offset, U32 size)
+{
+	Node node;
+	node.mType = type;
+	node.mFlags = 0;
+	node.mPad = 0;
+	node.mCount = 0;
+	node.mEnd = (S32)mNodes.size() + 1;
+	node.mOffset = offset;
+	node.mSize = size;
+	mNodes.push_back(node);
+	return (S32)mNodes.size() - 1;
+}
+
+bool LLSDBinaryView::readU32(U32& value)
+{
+	if (mSize - mPos < sizeof(U32))
+	{
+		return false;
+	}
+	U32 value_nbo;
+	memcpy(&value_nbo, mBuffer + mPos, sizeof(U32));
+	value = ntohl(value_nbo);
+	mPos += sizeof(U32);
+	return true;
+}
+
+// See LLSDBinaryParser::doParse() for the format.
+bool LLSDBinaryView::parseValue(S32 depth)
+{
+	if (depth > MAX_NESTING_DEPTH || mPos >= mSize)
+	{
+		return false;
+	}
+
+	U32 fixed_size = 0;
+	U8 type = LLSD::TypeUndefined;
+	char c = (char)mBuffer[mPos++];
+	switch (c)
+	{
+	case '{':
+	case '[':
+	{
+		bool map = (c == '{');
+		S32 idx = addNode(map ? LLSD::TypeMap : LLSD::TypeArray, mPos, 0);
+		U32 count;
+		if (!readU32(count))
+		{
+			return false;
+		}
+		// Every element takes at least a byte, so a bogus count fails as
+		// soon as we run out of buffer.
+		for (U32 i = 0; i < count; ++i)
+		{
+			if (map)
+			{
+				if (mPos >= mSize)
+				{
+					return false;
+				}
+				char k = (char)mBuffer[mPos++];
+				if (k == 'k')
+				{
+					if (!parseString(LLSD::TypeString))
+					{
+						return false;
+					}
+				}
+				else if (k == '\'' || k == '"')
+				{
+					if (!parseDelimited(k))
+					{
+						return false;
+					}
+				}
+				else
+				{
+					return false;
+				}
+			}
+			if (!parseValue(depth + 1))
+			{
+				return false;
+			}
+		}
+		if (mPos >= mSize || (char)mBuffer[mPos++] != (map ? '}' : ']'))
+		{
+			return false;
+		}
+		mNodes[idx].mCount = (S32)count;
+		mNodes[idx].mEnd = (S32)mNodes.size();
+		return true;
+	}
+
+	case '!':
+		addNode(LLSD::TypeUndefined, mPos, 0);
+		return true;
+
+	case '0':
+	case '1':
+	{
+		S32 idx = addNode(LLSD::TypeBoolean, mPos, 0);
+		if (c == '1')
+		{
+			mNodes[idx].mFlags = FLAG_TRUE;
+		}
+		return true;
+	}
+
+	case 'i':
+		type = LLSD::TypeInteger;
+		fixed_size = sizeof(U32);
+		break;
+
+	case 'r':
+		type = LLSD::TypeReal;
+		fixed_size = sizeof(F64);
+		break;
+
+	case 'd':
+		type = LLSD::TypeDate;
+		fixed_size = sizeof(F64);
+		break;
+
+	case 'u':
+		type = LLSD::TypeUUID;
+		fixed_size = UUID_BYTES;
+		break;
+
+	case 's':
+		return parseString(LLSD::TypeString);
+
+	case 'l':
+		return parseString(LLSD::TypeURI);
+
+	case 'b':
+		return parseString(LLSD::TypeBinary);
+
+	case '\'':
+	case '"':
+		return parseDelimited(c);
+
+	default:
+		llinfos << "Unrecognized character while parsing: int(" << (int)c << ")" << llendl;
+		return false;
+	}
+
+	if (mSize - mPos < fixed_size)
+	{
+		return false;
+	}
+	addNode(type, mPos, fixed_size);
+	mPos += fixed_size;
+	return true;
+}
+
+// Size prefixed string, URI or binary.
+bool LLSDBinaryView::parseString(U8 type)
+{
+	U32 size;
+	if (!readU32(size) || size > mSize - mPos)
+	{
+		return false;
+	}
+	addNode(type, mPos, size);
+	mPos += size;
+	return true;
+}
+
+// Notation style quoted string, the escape rules are those of
+// deserialize_string_delim().
+bool LLSDBinaryView::parseDelimited(char delim, U8 type)
+{
+	U32 start = mPos;
+	U8 flags = 0;
+	while (mPos < mSize)
+	{
+		char c = (char)mBuffer[mPos++];
+		if (c == '\\')
+		{
+			flags = FLAG_ESCAPED;
+			if (mPos >= mSize)
+			{
+				return false;
+			}
+			if ((char)mBuffer[mPos++] == 'x')
+			{
+				mPos += 2;
+			}
+		}
+		else if (c == delim)
+		{
+			S32 idx = addNode(type, start, mPos - 1 - start);
+			mNodes[idx].mFlags = flags;
+			return true;
+		}
+	}
+	return false;
+}
+
+void LLSDBinaryView::skipWhiteSpace()
+{
+	while (mPos < mSize && isspace(mBuffer[mPos]))
+	{
+		++mPos;
+	}
+}
+
+// See LLSDNotationParser::doParse() for the format. Separators are a bit
+// stricter: only white space and commas may come between the elements of
+// a map or an array.
+bool LLSDBinaryView::parseNotationValue(S32 depth)
+{
+	skipWhiteSpace();
+	if (depth > MAX_NESTING_DEPTH || mPos >= mSize)
+	{
+		return false;
+	}
+
+	char c = (char)mBuffer[mPos++];
+	switch (c)
+	{
+	case '{':
+	case '[':
+	{
+		bool map = (c == '{');
+		char close = map ? '}' : ']';
+		S32 idx = addNode(map ? LLSD::TypeMap : LLSD::TypeArray, mPos, 0);
+		S32 count = 0;
+		while (true)
+		{
+			skipWhiteSpace();
+			if (mPos >= mSize)
+			{
+				return false;
+			}
+			c = (char)mBuffer[mPos];
+			if (c == close)
+			{
+				++mPos;
+				break;
+			}
+			if (c == ',')
+			{
+				++mPos;
+				continue;
+			}
+			if (map)
+			{
+				if (!parseNotationKey())
+				{
+					return false;
+				}
+				skipWhiteSpace();
+				if (mPos >= mSize || (char)mBuffer[mPos++] != ':')
+				{
+					return false;
+				}
+			}
+			if (!parseNotationValue(depth + 1))
+			{
+				return false;
+			}
+			++count;
+		}
+		mNodes[idx].mCount = count;
+		mNodes[idx].mEnd = (S32)mNodes.size();
+		return true;
+	}
+
+	case '!':
+		addNode(LLSD::TypeUndefined, mPos, 0);
+		return true;
+
+	case '0':
+	case '1':
+	{
+		S32 idx = addNode(LLSD::TypeBoolean, mPos, 0);
+		if (c == '1')
+		{
+			mNodes[idx].mFlags = FLAG_TRUE;
+		}
+		return true;
+	}
+
+	case 't':
+	case 'T':
+	case 'f':
+	case 'F':
+		return parseNotationBoolean(c);
+
+	case 'i':
+		return parseNotationText(LLSD::TypeInteger);
+
+	case 'r':
+		return parseNotationText(LLSD::TypeReal);
+
+	case 'u':
+		return parseNotationText(LLSD::TypeUUID);
+
+	case '\'':
+	case '"':
+		return parseDelimited(c);
+
+	case 's':
+		return parseNotationRaw(LLSD::TypeString);
+
+	case 'l':
+	case 'd':
+	{
+		if (mPos >= mSize)
+		{
+			return false;
+		}
+		char delim = (char)mBuffer[mPos++];
+		if (delim != '"' && delim != '\'')
+		{
+			return false;
+		}
+		if (!parseDelimited(delim, c == 'l' ? LLSD::TypeURI : LLSD::TypeDate))
+		{
+			return false;
+		}
+		if (c == 'd')
+		{
+			mNodes.back().mFlags |= FLAG_TEXT;
+		}
+		return true;
+	}
+
+	case 'b':
+		return parseNotationBinary();
+
+	default:
+		llinfos << "Unrecognized character while parsing: int(" << (int)c << ")" << llendl;
+		return false;
+	}
+}
+
+// t, f, true or false in any case, see deserialize_boolean().
+bool LLSDBinaryView::parseNotationBoolean(char first)
+{
+	bool value = (first == 't' || first == 'T');
+	if (mPos < mSize && isalpha(mBuffer[mPos]))
+	{
+		const char* word = value ? "true" : "false";
+		for (S32 i = 1; word[i]; ++i)
+		{
+			if (mPos >= mSize || tolower(mBuffer[mPos]) != word[i])
+			{
+				return false;
+			}
+			++mPos;
+		}
+	}
+	S32 idx = addNode(LLSD::TypeBoolean, mPos, 0);
+	if (value)
+	{
+		mNodes[idx].mFlags = FLAG_TRUE;
+	}
+	return true;
+}
+
+// Integer, real or UUID. Only checked here, converted when read.
+bool LLSDBinaryView::parseNotationText(U8 type)
+{
+	U32 start = mPos;
+	if (type == LLSD::TypeUUID)
+	{
+		const U32 length = UUID_STR_LENGTH - 1;
+		if (mSize - mPos < length)
+		{
+			return false;
+		}
+		for (U32 i = 0; i < length; ++i)
+		{
+			char c = (char)mBuffer[mPos + i];
+			bool dash = (i == 8 || i == 13 || i == 18 || i == 23);
+			if (dash ? c != '-' : !isxdigit(c))
+			{
+				return false;
+			}
+		}
+		mPos += length;
+	}
+	else if (type == LLSD::TypeInteger)
+	{
+		if (mPos < mSize && (mBuffer[mPos] == '-' || mBuffer[mPos] == '+'))
+		{
+			++mPos;
+		}
+		U32 digits = mPos;
+		while (mPos < mSize && isdigit(mBuffer[mPos]))
+		{
+			++mPos;
+		}
+		if (mPos == digits)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		// Letters for nan and inf.
+		while (mPos < mSize && (isalnum(mBuffer[mPos]) || mBuffer[mPos] == '.' ||
+								mBuffer[mPos] == '-' || mBuffer[mPos] == '+'))
+		{
+			++mPos;
+		}
+		char text[64];
+		U32 len = mPos - start;
+		if (!len || len >= sizeof(text))
+		{
+			return false;
+		}
+		memcpy(text, mBuffer + start, len);
+		text[len] = '\0';
+		char* end;
+		strtod(text, &end);
+		if (end != text + len)
+		{
+			return false;
+		}
+	}
+	S32 idx = addNode(type, start, mPos - start);
+	mNodes[idx].mFlags = FLAG_TEXT;
+	return true;
+}
+
+// (size)"raw data", for strings and binaries, see deserialize_string_raw().
+bool LLSDBinaryView::parseNotationRaw(U8 type)
+{
+	if (mPos >= mSize || (char)mBuffer[mPos++] != '(')
+	{
+		return false;
+	}
+	U32 size = 0;
+	U32 digits = mPos;
+	while (mPos < mSize && isdigit(mBuffer[mPos]))
+	{
+		size = size * 10 + (mBuffer[mPos++] - '0');
+		if (size > mSize)
+		{
+			return false;
+		}
+	}
+	if (mPos == digits || mSize - mPos < 2 || (char)mBuffer[mPos++] != ')')
+	{
+		return false;
+	}
+	char quote = (char)mBuffer[mPos++];
+	if ((quote != '"' && quote != '\'') || size >= mSize - mPos)
+	{
+		return false;
+	}
+	addNode(type, mPos, size);
+	mPos += size;
+	quote = (char)mBuffer[mPos++];
+	return quote == '"' || quote == '\'';
+}
+
+// b(size)"raw data", b64"base 64" or b16"base 16", see
+// LLSDNotationParser::parseBinary().
+bool LLSDBinaryView::parseNotationBinary()
+{
+	if (mPos < mSize && mBuffer[mPos] == '(')
+	{
+		return parseNotationRaw(LLSD::TypeBinary);
+	}
+	if (mSize - mPos < 3 || mBuffer[mPos + 2] != '"')
+	{
+		return false;
+	}
+	bool base64 = !memcmp(mBuffer + mPos, "64", 2);
+	if (!base64 && memcmp(mBuffer + mPos, "16", 2))
+	{
+		return false;
+	}
+	mPos += 3;
+	U32 start = mPos;
+	while (mPos < mSize && mBuffer[mPos] != '"')
+	{
+		if (!base64 && !isxdigit(mBuffer[mPos]))
+		{
+			return false;
+		}
+		++mPos;
+	}
+	if (mPos >= mSize || (!base64 && ((mPos - start) & 1)))
+	{
+		return false;
+	}
+	S32 idx = addNode(LLSD::TypeBinary, start, mPos - start);
+	mNodes[idx].mFlags = base64 ? FLAG_BASE64 : FLAG_BASE16;
+	++mPos;
+	return true;
+}
+
+bool LLSDBinaryView::parseNotationKey()
+{
+	char c = (char)mBuffer[mPos++];
+	if (c == '"' || c == '\'')
+	{
+		return parseDelimited(c);
+	}
+	return c == 's' && parseNotationRaw(LLSD::TypeString);
+}
+
+LLSD::String LLSDBinaryView::getString(S32 index) const
+{
+	const Node& node = mNodes[index];
+	const char* begin = (const char*)mBuffer + node.mOffset;
+	const char* end = begin + node.mSize;
+	if (!(node.mFlags & FLAG_ESCAPED))
+	{
+		return LLSD::String(begin, end);
+	}
+
+	LLSD::String value;
+	value.reserve(node.mSize);
+	for (const char* p = begin; p < end; ++p)
+	{
+		if (*p != '\\')
+		{
+			value += *p;
+			continue;
+		}
+		// The parse made sure escapes are complete.
+		char c = *++p;
+		switch (c)
+		{
+		case 'x':
+		{
+			U8 byte = hex_as_nybble(p[1]) << 4;
+			byte |= hex_as_nybble(p[2]);
+			value += (char)byte;
+			p += 2;
+			break;
+		}
+		case 'a': value += '\a'; break;
+		case 'b': value += '\b'; break;
+		case 'f': value += '\f'; break;
+		case 'n': value += '\n'; break;
+		case 'r': value += '\r'; break;
+		case 't': value += '\t'; break;
+		case 'v': value += '\v'; break;
+		default: value += c; break;
+		}
+	}
+	return value;
+}
+
+std::string LLSDBinaryView::getText(S32 index) const
+{
+	const Node& node = mNodes[index];
+	return std::string((const char*)mBuffer + node.mOffset, node.mSize);
+}
+
+LLSD::Binary LLSDBinaryView::getBinary(S32 index) const
+{
+	const Node& node = mNodes[index];
+	const U8* payload = mBuffer + node.mOffset;
+	if (node.mFlags & FLAG_BASE64)
+	{
+		std::string encoded = getText(index);
+		LLSD::Binary value(apr_base64_decode_len(encoded.c_str()));
+		if (!value.empty())
+		{
+			value.resize(apr_base64_decode_binary(&value[0], encoded.c_str()));
+		}
+		return value;
+	}
+	if (node.mFlags & FLAG_BASE16)
+	{
+		LLSD::Binary value(node.mSize / 2);
+		for (U32 i = 0; i < value.size(); ++i)
+		{
+			value[i] = (hex_as_nybble(payload[2 * i]) << 4) | hex_as_nybble(payload[2 * i + 1]);
+		}
+		return value;
+	}
+	return LLSD::Binary(payload, payload + node.mSize);
+}
+
+LLSD LLSDBinaryView::getScalar(S32 index) const
+{
+	U8 type = mNodes[index].mType;
+	if (type == LLSD::TypeMap || type == LLSD::TypeArray)
+	{
+		// Containers don't convert to anything.
+		return LLSD();
+	}
+	return makeLLSD(index);
+}
+
+LLSD LLSDBinaryView::makeLLSD(S32 index) const
+{
+	const Node& node = mNodes[index];
+	const U8* payload = mBuffer + node.mOffset;
+	switch (node.mType)
+	{
+	case LLSD::TypeBoolean:
+		return LLSD((node.mFlags & FLAG_TRUE) != 0);
+
+	case LLSD::TypeInteger:
+	{
+		if (node.mFlags & FLAG_TEXT)
+		{
+			return LLSD((S32)strtol(getText(index).c_str(), NULL, 10));
+		}
+		U32 value_nbo;
+		memcpy(&value_nbo, payload, sizeof(U32));
+		return LLSD((S32)ntohl(value_nbo));
+	}
+
+	case LLSD::TypeReal:
+	{
+		if (node.mFlags & FLAG_TEXT)
+		{
+			return LLSD(strtod(getText(index).c_str(), NULL));
+		}
+		F64 real_nbo;
+		memcpy(&real_nbo, payload, sizeof(F64));
+		return LLSD(ll_ntohd(real_nbo));
+	}
+
+	case LLSD::TypeDate:
+	{
+		if (node.mFlags & FLAG_TEXT)
+		{
+			return LLSD(LLDate(getString(index)));
+		}
+		// Dates are not byte swapped, see LLSDBinaryFormatter::format().
+		F64 real;
+		memcpy(&real, payload, sizeof(F64));
+		return LLSD(LLDate(real));
+	}
+
+	case LLSD::TypeUUID:
+	{
+		if (node.mFlags & FLAG_TEXT)
+		{
+			return LLSD(LLUUID(getText(index)));
+		}
+		LLUUID id;
+		memcpy(id.mData, payload, UUID_BYTES);
+		return LLSD(id);
+	}
+
+	case LLSD::TypeString:
+		return LLSD(getString(index));
+
+	case LLSD::TypeURI:
+		return LLSD(LLURI(getString(index)));
+
+	case LLSD::TypeBinary:
+		return LLSD(getBinary(index));
+
+	case LLSD::TypeArray:
+	{
+		LLSD array = LLSD::emptyArray();
+		S32 child = index + 1;
+		for (S32 i = 0; i < node.mCount; ++i)
+		{
+			array.append(makeLLSD(child));
+			child = mNodes[child].mEnd;
+		}
+		return array;
+	}
+
+	case LLSD::TypeMap:
+	{
+		LLSD map = LLSD::emptyMap();
+		S32 child = index + 1;
+		for (S32 i = 0; i < node.mCount; ++i)
+		{
+			map.insert(getString(child), makeLLSD(child + 1));
+			child = mNodes[child + 1].mEnd;
+		}
+		return map;
+	}
+
+	default:
+		return LLSD();
+	}
+}
+
+/**
+ * LLSDView
+ */
+
+LLSD::Type LLSDView::type() const
+{
+	return mDoc ? (LLSD::Type)mDoc->mNodes[mIndex].mType : LLSD::TypeUndefined;
+}
+
+S32 LLSDView::size() const
+{
+	if (!isMap() && !isArray())
+	{
+		return 0;
+	}
+	return mDoc->mNodes[mIndex].mCount;
+}
+
+bool LLSDView::has(const char* key) const
+{
+	return get(key).mDoc != NULL;
+}
+
+LLSDView LLSDView::get(const char* key) const
+{
+	if (!isMap())
+	{
+		return LLSDView();
+	}
+	const S32 count = mDoc->mNodes[mIndex].mCount;
+	S32 child = mIndex + 1;
+	for (S32 i = 0; i < count; ++i)
+	{
+		// Like LLSD::insert(), the first of duplicate keys wins.
+		if (LLSDView(mDoc, child).equals(key))
+		{
+			return LLSDView(mDoc, child + 1);
+		}
+		child = mDoc->mNodes[child + 1].mEnd;
+	}
+	return LLSDView();
+}
+
+LLSDView LLSDView::get(S32 index) const
+{
+	if (!isArray() || index < 0 || index >= mDoc->mNodes[mIndex].mCount)
+	{
+		return LLSDView();
+	}
+	S32 child = mIndex + 1;
+	while (index--)
+	{
+		child = mDoc->mNodes[child].mEnd;
+	}
+	return LLSDView(mDoc, child);
+}
+
+LLSD::Boolean LLSDView::asBoolean() const
+{
+	if (type() == LLSD::TypeBoolean)
+	{
+		return (mDoc->mNodes[mIndex].mFlags & LLSDBinaryView::FLAG_TRUE) != 0;
+	}
+	return mDoc ? mDoc->getScalar(mIndex).asBoolean() : false;
+}
+
+LLSD::Integer LLSDView::asInteger() const
+{
+	if (type() == LLSD::TypeInteger && !(mDoc->mNodes[mIndex].mFlags & LLSDBinaryView::FLAG_TEXT))
+	{
+		U32 value_nbo;
+		memcpy(&value_nbo, mDoc->mBuffer + mDoc->mNodes[mIndex].mOffset, sizeof(U32));
+		return (S32)ntohl(value_nbo);
+	}
+	return mDoc ? mDoc->getScalar(mIndex).asInteger() : 0;
+}
+
+LLSD::Real LLSDView::asReal() const
+{
+	return mDoc ? mDoc->getScalar(mIndex).asReal() : 0.0;
+}
+
+LLSD::UUID LLSDView::asUUID() const
+{
+	if (type() == LLSD::TypeUUID && !(mDoc->mNodes[mIndex].mFlags & LLSDBinaryView::FLAG_TEXT))
+	{
+		LLUUID id;
+		memcpy(id.mData, mDoc->mBuffer + mDoc->mNodes[mIndex].mOffset, UUID_BYTES);
+		return id;
+	}
+	return mDoc ? mDoc->getScalar(mIndex).asUUID() : LLUUID::null;
+}
+
+LLSD::String LLSDView::asString() const
+{
+	if (type() == LLSD::TypeString)
+	{
+		return mDoc->getString(mIndex);
+	}
+	return mDoc ? mDoc->getScalar(mIndex).asString() : LLStringUtil::null;
+}
+
+LLSD::Date LLSDView::asDate() const
+{
+	return mDoc ? mDoc->getScalar(mIndex).asDate() : LLDate();
+}
+
+LLSD::URI LLSDView::asURI() const
+{
+	return mDoc ? mDoc->getScalar(mIndex).asURI() : LLURI();
+}
+
+LLSD::Binary LLSDView::asBinary() const
+{
+	if (type() == LLSD::TypeBinary)
+	{
+		return mDoc->getBinary(mIndex);
+	}
+	return mDoc ? mDoc->getScalar(mIndex).asBinary() : LLSD::Binary();
+}
+
+const char* LLSDView::data() const
+{
+	LLSD::Type t = type();
+	if (t != LLSD::TypeString && t != LLSD::TypeURI && t != LLSD::TypeBinary)
+	{
+		return NULL;
+	}
+	const LLSDBinaryView::Node& node = mDoc->mNodes[mIndex];
+	if (node.mFlags & LLSDBinaryView::FLAG_ENCODED)
+	{
+		return NULL;
+	}
+	return (const char*)mDoc->mBuffer + node.mOffset;
+}
+
+S32 LLSDView::dataSize() const
+{
+	return data() ? (S32)mDoc->mNodes[mIndex].mSize : 0;
+}
+
+bool LLSDView::equals(const char* str) const
+{
+	if (!isString())
+	{
+		return false;
+	}
+	const char* bytes = data();
+	if (!bytes)
+	{
+		return asString() == str;
+	}
+	size_t len = strlen(str);
+	return len == (size_t)dataSize() && !memcmp(bytes, str, len);
+}
+
+LLSD LLSDView::asLLSD() const
+{
+	return mDoc ? mDoc->makeLLSD(mIndex) : LLSD();
+}
+
+LLSDView::const_iterator LLSDView::begin() const
+{
+	if (!size())
+	{
+		return end();
+	}
+	return const_iterator(mDoc, mIndex + 1, isMap());
+}
+
+LLSDView::const_iterator LLSDView::end() const
+{
+	if (!mDoc)
+	{
+		return const_iterator();
+	}
+	return const_iterator(mDoc, mDoc->mNodes[mIndex].mEnd, isMap());
+}
+
+LLSDView LLSDView::const_iterator::operator*() const
+{
+	return LLSDView(mDoc, mMap ? mIndex + 1 : mIndex);
+}
+
+LLSDView LLSDView::const_iterator::key() const
+{
+	return mMap ? LLSDView(mDoc, mIndex) : LLSDView();
+}
+
+LLSDView::const_iterator& LLSDView::const_iterator::operator++()
+{
+	mIndex = mDoc->mNodes[mMap ? mIndex + 1 : mIndex].mEnd;
+	return *this;
+}
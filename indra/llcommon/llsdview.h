@@ -0,0 +1,214 @@
+/**
+ * @file llsdview.h
+ * @brief Read-only LLSD views into a binary serialized buffer.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDVIEW_H
+#define LL_LLSDVIEW_H
+
+#include <vector>
+#include "llsd.h"
+
+class LLSDBinaryView;
+
+/**
+ * @class LLSDView
+ * @brief Lightweight handle to one value inside an LLSDBinaryView.
+ *
+ * Views are cheap to copy. Nothing is converted or allocated until one of
+ * the as*() accessors is called; strings, URIs and binaries that need no
+ * unescaping can be read in place through data() and dataSize(). A view is
+ * only valid as long as the LLSDBinaryView it came from and the buffer
+ * that one parsed.
+ *
+ * Lookups on a view that is not a map or an array yield an undefined view,
+ * so chains like view["a"]["b"][2].asInteger() are safe.
+ */
+class LL_COMMON_API LLSDView
+{
+public:
+	LLSDView() : mDoc(NULL), mIndex(0) { }
+
+	LLSD::Type type() const;
+	bool isUndefined() const	{ return type() == LLSD::TypeUndefined; }
+	bool isDefined() const		{ return type() != LLSD::TypeUndefined; }
+	bool isMap() const			{ return type() == LLSD::TypeMap; }
+	bool isArray() const		{ return type() == LLSD::TypeArray; }
+	bool isString() const		{ return type() == LLSD::TypeString; }
+	bool isBinary() const		{ return type() == LLSD::TypeBinary; }
+
+	// Number of elements of an array or of key/value pairs of a map.
+	S32 size() const;
+
+	// Map lookup: a linear scan comparing the keys in place.
+	bool has(const char* key) const;
+	LLSDView get(const char* key) const;
+	LLSDView operator[](const char* key) const		{ return get(key); }
+	LLSDView operator[](const std::string& key) const { return get(key.c_str()); }
+	// Array lookup, walks index elements. Use the iterators to visit all.
+	LLSDView get(S32 index) const;
+	LLSDView operator[](S32 index) const			{ return get(index); }
+
+	// Scalars follow the LLSD conversion rules.
+	LLSD::Boolean	asBoolean() const;
+	LLSD::Integer	asInteger() const;
+	LLSD::Real		asReal() const;
+	LLSD::UUID		asUUID() const;
+	LLSD::String	asString() const;
+	LLSD::Date		asDate() const;
+	LLSD::URI		asURI() const;
+	LLSD::Binary	asBinary() const;
+
+	// In place access to the bytes of a string, URI or binary. Returns NULL
+	// when the value is of another type or is a string with escapes, which
+	// has to go through asString().
+	const char* data() const;
+	S32 dataSize() const;
+	// Compares a string value without copying it.
+	bool equals(const char* str) const;
+
+	// Deep copy into a regular LLSD tree.
+	LLSD asLLSD() const;
+
+	/**
+	 * @brief Iterates the elements of an array or the pairs of a map.
+	 *
+	 * For maps, key() is the key and operator*() the value.
+	 */
+	class LL_COMMON_API const_iterator
+	{
+	public:
+		const_iterator() : mDoc(NULL), mIndex(0), mMap(false) { }
+		LLSDView operator*() const;
+		LLSDView key() const;
+		const_iterator& operator++();
+		bool operator==(const const_iterator& rhs) const { return mIndex == rhs.mIndex && mDoc == rhs.mDoc; }
+		bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		friend class LLSDView;
+		const_iterator(const LLSDBinaryView* doc, S32 index, bool map)
+		:	mDoc(doc), mIndex(index), mMap(map) { }
+
+		const LLSDBinaryView* mDoc;
+		S32 mIndex;		// the element, or for maps the key node
+		bool mMap;
+	};
+	const_iterator begin() const;
+	const_iterator end() const;
+
+private:
+	friend class LLSDBinaryView;
+	LLSDView(const LLSDBinaryView* doc, S32 index) : mDoc(doc), mIndex(index) { }
+
+	const LLSDBinaryView* mDoc;
+	S32 mIndex;
+};
+
+/**
+ * @class LLSDBinaryView
+ * @brief Parses binary or notation LLSD in place and hands out LLSDViews
+ * into it.
+ *
+ * Unlike LLSDBinaryParser this works on a complete buffer instead of a
+ * stream, and it does not build an LLSD tree: the parse only validates the
+ * structure and records the position of every value in a flat table, so
+ * strings, binaries and map keys are never copied unless asked for. Also
+ * accepts the notation style quoted strings that LLSDBinaryParser accepts
+ * inside binary LLSD.
+ *
+ * parseNotation() reads the format of LLSDNotationParser instead. Numbers,
+ * UUIDs and dates are then kept as text and converted when read, and
+ * base 64 or base 16 binaries are decoded when read, so data() is NULL for
+ * those.
+ *
+ * The buffer is not copied and must outlive the LLSDBinaryView.
+ */
+class LL_COMMON_API LLSDBinaryView
+{
+public:
+	LLSDBinaryView();
+
+	// Parses one value from the start of buffer. Returns the number of bytes
+	// used, or LLSDParser::PARSE_FAILURE. Parsing again drops previous views.
+	S32 parse(const U8* buffer, S32 size);
+	// Same for notation LLSD. Leading white space counts as used.
+	S32 parseNotation(const U8* buffer, S32 size);
+	void clear();
+
+	LLSDView root() const { return mNodes.empty() ? LLSDView() : LLSDView(this, 0); }
+
+private:
+	friend class LLSDView;
+
+	enum
+	{
+		FLAG_TRUE = 1,		// boolean value
+		FLAG_ESCAPED = 2,	// quoted string that needs unescaping
+		FLAG_TEXT = 4,		// notation integer, real or UUID
+		FLAG_BASE64 = 8,	// notation binary, encoded
+		FLAG_BASE16 = 16,
+		FLAG_ENCODED = FLAG_ESCAPED | FLAG_BASE64 | FLAG_BASE16	// no in place access
+	};
+
+	struct Node
+	{
+		U8	mType;			// LLSD::Type
+		U8	mFlags;
+		U16	mPad;
+		S32	mCount;			// array elements or map pairs
+		S32	mEnd;			// index of the node after this subtree
+		U32	mOffset;		// start of the payload in the buffer
+		U32	mSize;			// payload length
+	};
+
+	S32 parseBuffer(const U8* buffer, S32 size, bool notation);
+	bool parseValue(S32 depth);
+	bool parseString(U8 type);
+	bool parseDelimited(char delim, U8 type = LLSD::TypeString);
+	bool readU32(U32& value);
+	S32 addNode(U8 type, U32 offset, U32 size);
+
+	// Notation, see LLSDNotationParser::doParse().
+	bool parseNotationValue(S32 depth);
+	bool parseNotationBoolean(char first);
+	bool parseNotationText(U8 type);
+	bool parseNotationRaw(U8 type);
+	bool parseNotationBinary();
+	bool parseNotationKey();
+	void skipWhiteSpace();
+
+	LLSD::String getString(S32 index) const;
+	std::string getText(S32 index) const;
+	LLSD::Binary getBinary(S32 index) const;
+	LLSD getScalar(S32 index) const;
+	LLSD makeLLSD(S32 index) const;
+
+	std::vector<Node> mNodes;
+	const U8* mBuffer;
+	U32 mSize;
+	U32 mPos;			// parse position
+};
+
+#endif // LL_LLSDVIEW_H
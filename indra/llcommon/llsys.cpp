@@ -602,6 +602,24 @@ LLCPUInfo::LLCPUInfo()
 	mFamily = proc.getCPUFamilyName();
 	mCPUString = "Unknown";
 
+#if LL_WINDOWS
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	mCoreCount = (U32)sys_info.dwNumberOfProcessors;
+#elif LL_DARWIN
+	int cores = 0;
+	size_t len = sizeof(cores);
+	if (sysctlbyname("hw.logicalcpu", &cores, &len, NULL, 0) != 0)
+	{
+		cores = 0;
+	}
+	mCoreCount = cores > 0 ? (U32)cores : 1;
+#else
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	mCoreCount = cores > 0 ? (U32)cores : 1;
+#endif
+	mCoreCount = llmax(mCoreCount, (U32)1);
+
 	out << proc.getCPUBrandName();
 	if (200 < mCPUMHz && mCPUMHz < 10000)           // *NOTE: cpu speed is often way wrong, do a sanity check
 	{
@@ -631,6 +649,11 @@ F64 LLCPUInfo::getMHz() const
 	return mCPUMHz;
 }
 
+U32 LLCPUInfo::getCoreCount() const
+{
+	return mCoreCount;
+}
+
 std::string LLCPUInfo::getCPUString() const
 {
 	return mCPUString;
@@ -647,6 +670,7 @@ void LLCPUInfo::stream(std::ostream& s) const
 	s << "->mHasSSE2:    " << (U32)mHasSSE2 << std::endl;
 	s << "->mHasAltivec: " << (U32)mHasAltivec << std::endl;
 	s << "->mCPUMHz:     " << mCPUMHz << std::endl;
+	s << "->mCoreCount:  " << mCoreCount << std::endl;
 	s << "->mCPUString:  " << mCPUString << std::endl;
 }
 
@@ -76,6 +76,8 @@ public:
 	bool hasSSE() const;
 	bool hasSSE2() const;
 	F64 getMHz() const;
+	// Number of logical processors, at least 1.
+	U32 getCoreCount() const;
 
 	// Family is "AMD Duron" or "Intel Pentium Pro"
 	const std::string& getFamily() const { return mFamily; }
@@ -85,6 +87,7 @@ private:
 	bool mHasSSE2;
 	bool mHasAltivec;
 	F64 mCPUMHz;
+	U32 mCoreCount;
 	std::string mFamily;
 	std::string mCPUString;
 };
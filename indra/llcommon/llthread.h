@@ -397,6 +397,25 @@ public:
 #endif
 };
 
+// Scoped read and write locks for AIRWLock, the counterparts of LLMutexLock.
+class LL_COMMON_API AIReadLock
+{
+public:
+	AIReadLock(AIRWLock& lock) : mLock(lock) { mLock.rdlock(); }
+	~AIReadLock() { mLock.rdunlock(); }
+private:
+	AIRWLock& mLock;
+};
+
+class LL_COMMON_API AIWriteLock
+{
+public:
+	AIWriteLock(AIRWLock& lock) : mLock(lock) { mLock.wrlock(); }
+	~AIWriteLock() { mLock.wrunlock(); }
+private:
+	AIRWLock& mLock;
+};
+
 #if LL_DEBUG
 class LL_COMMON_API AINRLock
 {
@@ -0,0 +1,385 @@
+/**
+ * @file llthreadpool.cpp
+ * @brief A fixed set of threads that run batches of jobs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llthreadpool.h"
+
+#include "llsys.h"
+#include "lltimer.h"
+
+// The pool and queue of the pool thread we are running on, if any.
+static ll_thread_local LLThreadPool* sCurrentPool = NULL;
+static ll_thread_local U32 sCurrentWorker = 0;
+
+struct LLThreadPool::Batch
+{
+	Job** mJobs;
+	U32 mCount;
+	LLAtomicU32 mNext;	// index of the next job to claim
+	LLAtomicU32 mRefs;	// the caller and each BatchTask, whichever is last deletes the batch
+	U32 mDone;			// jobs finished, protected by mDoneCondition
+};
+
+// Helps running the jobs of a batch. Might only run after the batch is
+// finished, hence the reference counting.
+class LLThreadPool::BatchTask : public LLThreadPool::Task
+{
+public:
+	BatchTask(LLThreadPool* pool, Batch* batch)
+		: mPool(pool), mBatch(batch) { }
+
+	/*virtual*/ void run()
+	{
+		U32 done = runJobs(*mBatch);
+		if (done)
+		{
+			mPool->mDoneCondition.lock();
+			mBatch->mDone += done;
+			mPool->mDoneCondition.broadcast();
+			mPool->mDoneCondition.unlock();
+		}
+		release();
+	}
+
+	// The caller ran every job we didn't claim, so only our reference is
+	// left to give up.
+	/*virtual*/ void drop()
+	{
+		release();
+	}
+
+private:
+	void release()
+	{
+		if (!--mBatch->mRefs)
+		{
+			delete mBatch;
+		}
+	}
+
+	LLThreadPool* mPool;
+	Batch* mBatch;
+};
+
+class LLThreadPool::Worker : public LLThread
+{
+public:
+	Worker(const std::string& name, LLThreadPool* pool, U32 index)
+		: LLThread(name), mPool(pool), mIndex(index) { }
+
+protected:
+	/*virtual*/ void run()
+	{
+		mPool->workerLoop(mIndex);
+	}
+
+private:
+	LLThreadPool* mPool;
+	U32 mIndex;
+};
+
+LLThreadPool* LLThreadPool::sInstance = NULL;
+
+//static
+void LLThreadPool::initClass(U32 thread_count)
+{
+	llassert(!sInstance);
+	if (!thread_count)
+	{
+		thread_count = llmax(gSysCPU.getCoreCount(), (U32)2) - 1;
+	}
+	sInstance = new LLThreadPool("Thread pool", thread_count);
+	llinfos << "Started " << thread_count << " pool threads" << llendl;
+}
+
+//static
+void LLThreadPool::cleanupClass()
+{
+	delete sInstance;
+	sInstance = NULL;
+}
+
+LLThreadPool::LLThreadPool(const std::string& name, U32 thread_count)
+	: mNextQueue(0),
+	  mPending(0),
+	  mSleeping(0),
+	  mQuitting(false)
+{
+	for (U32 i = 0; i < NUM_LANES; ++i)
+	{
+		mLanes[i].mQueued = 0;
+		mLanes[i].mStarted = 0;
+		mLanes[i].mLatencySum = 0;
+		mLanes[i].mMaxLatency = 0;
+	}
+	for (U32 i = 0; i < thread_count; ++i)
+	{
+		TaskQueue* queue = new TaskQueue;
+		for (U32 lane = 0; lane < NUM_LANES; ++lane)
+		{
+			queue->mCount[lane] = 0;
+		}
+		mQueues.push_back(queue);
+	}
+	for (U32 i = 0; i < thread_count; ++i)
+	{
+		Worker* worker = new Worker(llformat("%s %d", name.c_str(), i), this, i);
+		mWorkers.push_back(worker);
+		worker->start();
+	}
+}
+
+LLThreadPool::~LLThreadPool()
+{
+	mWakeCondition.lock();
+	mQuitting = true;
+	mWakeCondition.broadcast();
+	mWakeCondition.unlock();
+
+	// ~LLThread waits for the thread to stop.
+	for (std::vector<Worker*>::iterator iter = mWorkers.begin(); iter != mWorkers.end(); ++iter)
+	{
+		delete *iter;
+	}
+	mWorkers.clear();
+
+	U32 dropped = 0;
+	for (std::vector<TaskQueue*>::iterator iter = mQueues.begin(); iter != mQueues.end(); ++iter)
+	{
+		for (U32 lane = 0; lane < NUM_LANES; ++lane)
+		{
+			std::deque<Task*>& tasks = (*iter)->mTasks[lane];
+			dropped += tasks.size();
+			for (std::deque<Task*>::iterator task = tasks.begin(); task != tasks.end(); ++task)
+			{
+				(*task)->drop();
+				delete *task;
+			}
+		}
+		delete *iter;
+	}
+	mQueues.clear();
+	if (dropped)
+	{
+		llwarns << "Dropped " << dropped << " queued tasks" << llendl;
+	}
+}
+
+void LLThreadPool::post(Task* task, ELane lane)
+{
+	task->mQueuedClocks = LLFastTimer::getCPUClockCount32();
+	if (mQueues.empty())
+	{ //no threads, run it right away
+		task->run();
+		delete task;
+		return;
+	}
+
+	task->mQueuedTime = LLTimer::getTotalTime();
+	U32 index = sCurrentPool == this ? sCurrentWorker : (mNextQueue++ % (U32)mQueues.size());
+	TaskQueue* queue = mQueues[index];
+	queue->mMutex.lock();
+	queue->mTasks[lane].push_back(task);
+	queue->mCount[lane]++;
+	queue->mMutex.unlock();
+	mLanes[lane].mQueued++;
+	mPending++;
+
+	mWakeCondition.lock();
+	if (mSleeping)
+	{
+		mWakeCondition.signal();
+	}
+	mWakeCondition.unlock();
+}
+
+LLThreadPool::Task* LLThreadPool::takeTask(U32 index)
+{
+	if (!mPending)
+	{
+		return NULL;
+	}
+
+	U32 count = (U32)mQueues.size();
+	for (U32 lane = 0; lane < NUM_LANES; ++lane)
+	{
+		// Newest task of our own queue first, it's likely to be warm in the
+		// cache, then the oldest one of the others.
+		for (U32 i = 0; i < count; ++i)
+		{
+			TaskQueue* queue = mQueues[(index + i) % count];
+			if (!queue->mCount[lane])
+			{
+				continue;
+			}
+
+			std::deque<Task*>& tasks = queue->mTasks[lane];
+			Task* task = NULL;
+			queue->mMutex.lock();
+			if (!tasks.empty())
+			{
+				if (i == 0)
+				{
+					task = tasks.back();
+					tasks.pop_back();
+				}
+				else
+				{
+					task = tasks.front();
+					tasks.pop_front();
+				}
+				--queue->mCount[lane];
+			}
+			queue->mMutex.unlock();
+
+			if (task)
+			{
+				--mPending;
+				startTask(task, (ELane)lane);
+				return task;
+			}
+		}
+	}
+	return NULL;
+}
+
+void LLThreadPool::startTask(Task* task, ELane lane)
+{
+	LaneCounters& counters = mLanes[lane];
+	--counters.mQueued;
+	U64 latency = LLTimer::getTotalTime() - task->mQueuedTime;
+	counters.mMutex.lock();
+	++counters.mStarted;
+	counters.mLatencySum += latency;
+	counters.mMaxLatency = llmax(counters.mMaxLatency, latency);
+	counters.mMutex.unlock();
+}
+
+void LLThreadPool::workerLoop(U32 index)
+{
+	sCurrentPool = this;
+	sCurrentWorker = index;
+
+	while (true)
+	{
+		Task* task = takeTask(index);
+		if (task)
+		{
+			task->run();
+			delete task;
+			continue;
+		}
+
+		mWakeCondition.lock();
+		if (mQuitting)
+		{
+			mWakeCondition.unlock();
+			break;
+		}
+		if (!mPending)
+		{
+			++mSleeping;
+			mWakeCondition.wait();
+			--mSleeping;
+		}
+		mWakeCondition.unlock();
+	}
+
+	sCurrentPool = NULL;
+}
+
+void LLThreadPool::sampleLaneStats(ELane lane, LaneStats& stats)
+{
+	LaneCounters& counters = mLanes[lane];
+	stats.mQueued = counters.mQueued;
+	counters.mMutex.lock();
+	stats.mStarted = counters.mStarted;
+	stats.mAverageLatency = counters.mStarted ? (F32)((F64)counters.mLatencySum / counters.mStarted / 1000000.0) : 0.f;
+	stats.mMaxLatency = (F32)((F64)counters.mMaxLatency / 1000000.0);
+	counters.mStarted = 0;
+	counters.mLatencySum = 0;
+	counters.mMaxLatency = 0;
+	counters.mMutex.unlock();
+}
+
+//static
+U32 LLThreadPool::runJobs(Batch& batch)
+{
+	U32 done = 0;
+	while (true)
+	{
+		U32 index = batch.mNext++;
+		if (index >= batch.mCount)
+		{
+			break;
+		}
+		batch.mJobs[index]->run();
+		++done;
+	}
+	return done;
+}
+
+void LLThreadPool::runBatch(Job** jobs, U32 count)
+{
+	U32 helpers = llmin(count ? count - 1 : 0, getThreadCount());
+	if (!helpers)
+	{
+		for (U32 i = 0; i < count; ++i)
+		{
+			jobs[i]->run();
+		}
+		return;
+	}
+
+	Batch* batch = new Batch;
+	batch->mJobs = jobs;
+	batch->mCount = count;
+	batch->mNext = 0;
+	batch->mRefs = helpers + 1;
+	batch->mDone = 0;
+
+	for (U32 i = 0; i < helpers; ++i)
+	{
+		post(new BatchTask(this, batch), LANE_HIGH);
+	}
+
+	U32 done = runJobs(*batch);
+
+	mDoneCondition.lock();
+	batch->mDone += done;
+	while (batch->mDone < count)
+	{
+		mDoneCondition.wait();
+	}
+	mDoneCondition.unlock();
+
+	// BatchTasks that start from now on find no jobs left.
+	if (!--batch->mRefs)
+	{
+		delete batch;
+	}
+}
@@ -0,0 +1,260 @@
+/**
+ * @file llthreadpool.h
+ * @brief A fixed set of threads that run batches of jobs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTHREADPOOL_H
+#define LL_LLTHREADPOOL_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "llfasttimer.h"
+#include "llpointer.h"
+#include "llthread.h"
+
+// Threads shared by the subsystems that need background work done.
+//
+// Each pool thread has its own deque of tasks per priority lane. A thread
+// takes the newest task from its own deque and, when that is empty, steals
+// the oldest task of another thread, so busy subsystems spread over all
+// threads while lightly loaded ones don't keep threads of their own. All
+// deques are searched for a higher lane before a lower lane is touched.
+//
+// post() queues a task, which the pool deletes once it ran. runBatch() is
+// for work the caller would otherwise do itself and wait for, like culling
+// the spatial partitions of a frame: it hands a set of jobs to the pool,
+// runs jobs itself as well and returns once all of them have finished, so
+// jobs may freely use data owned by the caller. Jobs of one batch run
+// concurrently and in no particular order.
+//
+// Tasks that hand something back to the thread that posted them do so
+// through an LLThreadPoolResults, see below.
+class LL_COMMON_API LLThreadPool
+{
+public:
+	enum ELane
+	{
+		LANE_HIGH = 0,
+		LANE_NORMAL,
+		LANE_LOW,
+		NUM_LANES
+	};
+
+	class LL_COMMON_API Task
+	{
+	public:
+		Task() : mQueuedTime(0), mQueuedClocks(0) { }
+		virtual ~Task() { }
+		virtual void run() = 0;
+		// Called instead of run() when the pool shuts down before the task
+		// started. The task is deleted right after.
+		virtual void drop() { }
+
+	protected:
+		// LLFastTimer::getCPUClockCount32() at post(), for timing how long
+		// the task waited.
+		U32 getQueuedClocks() const						{ return mQueuedClocks; }
+
+	private:
+		friend class LLThreadPool;
+		U64 mQueuedTime;
+		U32 mQueuedClocks;
+	};
+
+	class LL_COMMON_API Job
+	{
+	public:
+		virtual ~Job() { }
+		virtual void run() = 0;
+	};
+
+	struct LaneStats
+	{
+		U32 mQueued;			// tasks waiting now
+		U32 mStarted;			// tasks started since the last sample
+		F32 mAverageLatency;	// seconds from post() to start, over the tasks started since the last sample
+		F32 mMaxLatency;
+	};
+
+	// Creates the shared pool. A thread_count of 0 means one thread per
+	// core, less one for the main thread.
+	static void initClass(U32 thread_count);
+	static void cleanupClass();
+	// The shared pool, NULL before initClass() and after cleanupClass().
+	static LLThreadPool* getInstance()					{ return sInstance; }
+
+	LLThreadPool(const std::string& name, U32 thread_count);
+	~LLThreadPool();
+
+	U32 getThreadCount() const							{ return (U32)mWorkers.size(); }
+
+	// Queues task. May be called from any thread; pool threads queue on
+	// their own deque, other threads spread tasks over all deques.
+	void post(Task* task, ELane lane = LANE_NORMAL);
+
+	// Runs jobs[0] to jobs[count - 1] and returns when all are done.
+	void runBatch(Job** jobs, U32 count);
+
+	// Fills stats and starts a new sampling period for the started count
+	// and the latencies.
+	void sampleLaneStats(ELane lane, LaneStats& stats);
+
+private:
+	struct Batch;
+	class BatchTask;
+	class Worker;
+	friend class BatchTask;
+	friend class Worker;
+
+	struct TaskQueue
+	{
+		LLMutex mMutex;
+		std::deque<Task*> mTasks[NUM_LANES];
+		LLAtomicU32 mCount[NUM_LANES];		// sizes of mTasks, for looking without locking
+	};
+
+	struct LaneCounters
+	{
+		LLAtomicU32 mQueued;
+		LLMutex mMutex;			// protects the members below
+		U32 mStarted;
+		U64 mLatencySum;
+		U64 mMaxLatency;
+	};
+
+	void workerLoop(U32 index);
+	Task* takeTask(U32 index);
+	void startTask(Task* task, ELane lane);
+	static U32 runJobs(Batch& batch);
+
+	std::vector<Worker*> mWorkers;
+	std::vector<TaskQueue*> mQueues;		// one per worker
+	LLAtomicU32 mNextQueue;					// round robin for posts from other threads
+	LaneCounters mLanes[NUM_LANES];
+
+	// Pool threads with nothing to do wait here for mPending to change.
+	LLCondition mWakeCondition;
+	LLAtomicU32 mPending;					// tasks in all queues
+	U32 mSleeping;							// protected by mWakeCondition
+	bool mQuitting;
+
+	// Signaled whenever a pool thread finished jobs of a batch.
+	LLCondition mDoneCondition;
+
+	static LLThreadPool* sInstance;
+};
+
+// Collects the results of tasks posted to a pool for the thread that posted
+// them, together with how long those tasks waited and ran, which that
+// thread adds to its fast timers.
+template<class T>
+class LLThreadPoolResults
+{
+public:
+	LLThreadPoolResults() : mExpected(0), mTimedCount(0), mWaitClocks(0), mRunClocks(0) { }
+
+	// Counts a task that will push() a result. Call before posting it.
+	void expect()
+	{
+		mCondition.lock();
+		++mExpected;
+		mCondition.unlock();
+	}
+
+	// Hands back the result of an expected task, from its run() or drop().
+	// Pointers are swapped rather than copied, so the reference count of
+	// the result is not touched on the pool thread. run_clocks 0 means the
+	// task didn't run and leaves the timing alone.
+	void push(T& result, U32 wait_clocks = 0, U32 run_clocks = 0)
+	{
+		mCondition.lock();
+		mResults.push_back(T());
+		moveResult(mResults.back(), result);
+		if (run_clocks)
+		{
+			++mTimedCount;
+			mWaitClocks += wait_clocks;
+			mRunClocks += run_clocks;
+		}
+		--mExpected;
+		mCondition.broadcast();
+		mCondition.unlock();
+	}
+
+	// Moves the results pushed so far to the end of results and adds the
+	// time their tasks waited and ran to wait_timer and run_timer.
+	void take(std::vector<T>& results, LLFastTimer::DeclareTimer* wait_timer = NULL, LLFastTimer::DeclareTimer* run_timer = NULL)
+	{
+		mCondition.lock();
+		for (typename std::vector<T>::iterator iter = mResults.begin(); iter != mResults.end(); ++iter)
+		{
+			results.push_back(T());
+			moveResult(results.back(), *iter);
+		}
+		mResults.clear();
+		if (mTimedCount)
+		{
+			if (wait_timer)
+			{
+				wait_timer->addTime(mWaitClocks, mTimedCount);
+			}
+			if (run_timer)
+			{
+				run_timer->addTime(mRunClocks, mTimedCount);
+			}
+			mTimedCount = 0;
+			mWaitClocks = 0;
+			mRunClocks = 0;
+		}
+		mCondition.unlock();
+	}
+
+	// Waits until every expected task pushed its result.
+	void waitForAll()
+	{
+		mCondition.lock();
+		while (mExpected)
+		{
+			mCondition.wait();
+		}
+		mCondition.unlock();
+	}
+
+private:
+	template<class U>
+	static void moveResult(U& to, U& from)						{ to = from; }
+	template<class U>
+	static void moveResult(LLPointer<U>& to, LLPointer<U>& from)	{ LLPointer<U>::swap(to, from); }
+
+	LLCondition mCondition;		// protects the members below
+	U32 mExpected;				// expected results not pushed yet
+	std::vector<T> mResults;
+	U32 mTimedCount;
+	U32 mWaitClocks;
+	U32 mRunClocks;
+};
+
+#endif // LL_LLTHREADPOOL_H
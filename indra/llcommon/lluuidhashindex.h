@@ -0,0 +1,261 @@
+/**
+ * @file lluuidhashindex.h
+ * @brief Open addressed hash table keyed on LLUUID.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLUUIDHASHINDEX_H
+#define LL_LLUUIDHASHINDEX_H
+
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "lluuid.h"
+
+// Maps LLUUIDs to values, stored in a single array and found by linear
+// probing from LLUUID::getCRC32(). It offers the part of the std::map
+// interface the viewer uses for lookup tables (find, count, operator[],
+// erase by key, iteration), so it can stand in for a std::map<LLUUID, T>
+// whose order doesn't matter. Iteration order is arbitrary.
+//
+// Inserting can grow the table, which invalidates all iterators and
+// references. Erasing moves entries within the table, so don't erase
+// while iterating.
+template <class T>
+class LLUUIDHashIndex
+{
+public:
+	typedef LLUUID key_type;
+	typedef T mapped_type;
+	typedef std::pair<LLUUID, T> value_type;
+	typedef size_t size_type;
+
+	template <class INDEX, class VALUE>
+	class iterator_base
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename LLUUIDHashIndex::value_type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef VALUE* pointer;
+		typedef VALUE& reference;
+
+		iterator_base() : mIndex(NULL), mSlot(0) { }
+		iterator_base(INDEX* index, size_type slot) : mIndex(index), mSlot(slot) { }
+		// Makes a const_iterator out of an iterator.
+		template <class OTHER_INDEX, class OTHER_VALUE>
+		iterator_base(const iterator_base<OTHER_INDEX, OTHER_VALUE>& other)
+			: mIndex(other.mIndex), mSlot(other.mSlot) { }
+
+		VALUE& operator*() const					{ return mIndex->mSlots[mSlot]; }
+		VALUE* operator->() const					{ return &mIndex->mSlots[mSlot]; }
+		iterator_base& operator++()					{ mSlot = mIndex->nextUsed(mSlot + 1); return *this; }
+		iterator_base operator++(int)				{ iterator_base tmp = *this; ++*this; return tmp; }
+		bool operator==(const iterator_base& rhs) const	{ return mSlot == rhs.mSlot; }
+		bool operator!=(const iterator_base& rhs) const	{ return mSlot != rhs.mSlot; }
+
+		INDEX* mIndex;
+		size_type mSlot;
+	};
+
+	typedef iterator_base<LLUUIDHashIndex, value_type> iterator;
+	typedef iterator_base<const LLUUIDHashIndex, const value_type> const_iterator;
+
+	LLUUIDHashIndex() : mSize(0), mShift(32) { }
+
+	iterator begin()								{ return iterator(this, nextUsed(0)); }
+	iterator end()									{ return iterator(this, mSlots.size()); }
+	const_iterator begin() const					{ return const_iterator(this, nextUsed(0)); }
+	const_iterator end() const						{ return const_iterator(this, mSlots.size()); }
+
+	size_type size() const							{ return mSize; }
+	bool empty() const								{ return !mSize; }
+
+	iterator find(const LLUUID& key)				{ return iterator(this, findSlot(key)); }
+	const_iterator find(const LLUUID& key) const	{ return const_iterator(this, findSlot(key)); }
+	size_type count(const LLUUID& key) const		{ return findSlot(key) != mSlots.size() ? 1 : 0; }
+
+	// Inserts a default constructed value when key isn't there yet.
+	T& operator[](const LLUUID& key)
+	{
+		size_type slot = findSlot(key);
+		if (slot == mSlots.size())
+		{
+			if ((mSize + 1) * 4 > mSlots.size() * 3)
+			{
+				rehash(mSlots.empty() ? MIN_CAPACITY : mSlots.size() * 2);
+			}
+			slot = insertSlot(key);
+			mSlots[slot].first = key;
+			mUsed[slot] = 1;
+			++mSize;
+		}
+		return mSlots[slot].second;
+	}
+
+	// Returns the number of entries removed, 0 or 1.
+	size_type erase(const LLUUID& key)
+	{
+		size_type hole = findSlot(key);
+		if (hole == mSlots.size())
+		{
+			return 0;
+		}
+
+		// Move back the entries after the hole that would no longer be
+		// found once it is empty, so no tombstones are needed.
+		const size_type mask = mSlots.size() - 1;
+		size_type slot = hole;
+		while (true)
+		{
+			slot = (slot + 1) & mask;
+			if (!mUsed[slot])
+			{
+				break;
+			}
+			size_type home = homeSlot(mSlots[slot].first);
+			bool reachable = hole <= slot ? (hole < home && home <= slot)
+										  : (hole < home || home <= slot);
+			if (!reachable)
+			{
+				mSlots[hole] = mSlots[slot];
+				hole = slot;
+			}
+		}
+		mSlots[hole] = value_type();	// drop the references the value holds
+		mUsed[hole] = 0;
+		--mSize;
+		return 1;
+	}
+
+	void clear()
+	{
+		mSlots.clear();
+		mUsed.clear();
+		mSize = 0;
+		mShift = 32;
+	}
+
+	// Grows the table so that count entries fit without rehashing.
+	void reserve(size_type count)
+	{
+		size_type capacity = mSlots.empty() ? (size_type)MIN_CAPACITY : mSlots.size();
+		while (count * 4 > capacity * 3)
+		{
+			capacity *= 2;
+		}
+		if (capacity > mSlots.size())
+		{
+			rehash(capacity);
+		}
+	}
+
+	void swap(LLUUIDHashIndex& other)
+	{
+		mSlots.swap(other.mSlots);
+		mUsed.swap(other.mUsed);
+		std::swap(mSize, other.mSize);
+		std::swap(mShift, other.mShift);
+	}
+
+private:
+	enum { MIN_CAPACITY = 16 };
+
+	// Fibonacci hashing, so that the high bits of the product pick the
+	// slot and similar CRCs still land far apart.
+	size_type homeSlot(const LLUUID& key) const
+	{
+		return (size_type)((key.getCRC32() * 2654435769U) >> mShift);
+	}
+
+	size_type nextUsed(size_type slot) const
+	{
+		while (slot < mUsed.size() && !mUsed[slot])
+		{
+			++slot;
+		}
+		return slot;
+	}
+
+	// Returns the slot holding key, or mSlots.size().
+	size_type findSlot(const LLUUID& key) const
+	{
+		if (!mSize)
+		{
+			return mSlots.size();
+		}
+		const size_type mask = mSlots.size() - 1;
+		for (size_type slot = homeSlot(key); ; slot = (slot + 1) & mask)
+		{
+			if (!mUsed[slot])
+			{
+				return mSlots.size();
+			}
+			if (mSlots[slot].first == key)
+			{
+				return slot;
+			}
+		}
+	}
+
+	// Returns the first free slot for a key that isn't in the table.
+	size_type insertSlot(const LLUUID& key) const
+	{
+		const size_type mask = mSlots.size() - 1;
+		size_type slot = homeSlot(key);
+		while (mUsed[slot])
+		{
+			slot = (slot + 1) & mask;
+		}
+		return slot;
+	}
+
+	void rehash(size_type capacity)
+	{
+		std::vector<value_type> old_slots(capacity);
+		std::vector<U8> old_used(capacity, 0);
+		old_slots.swap(mSlots);
+		old_used.swap(mUsed);
+		mShift = 32;
+		for (size_type i = capacity; i > 1; i >>= 1)
+		{
+			--mShift;
+		}
+		for (size_type i = 0; i < old_slots.size(); ++i)
+		{
+			if (old_used[i])
+			{
+				size_type slot = insertSlot(old_slots[i].first);
+				mSlots[slot] = old_slots[i];
+				mUsed[slot] = 1;
+			}
+		}
+	}
+
+	std::vector<value_type> mSlots;
+	std::vector<U8> mUsed;
+	size_type mSize;
+	U32 mShift;
+};
+
+#endif // LL_LLUUIDHASHINDEX_H
@@ -34,8 +34,9 @@
 //============================================================================
 // Run on MAIN thread
 
-LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause) :
-	LLQueuedThread(name, threaded, should_pause)
+LLWorkerThread::LLWorkerThread(const std::string& name, bool threaded, bool should_pause,
+							   LLThreadPool* pool, U32 pool_concurrency) :
+	LLQueuedThread(name, threaded, should_pause, pool, pool_concurrency)
 {
 	mDeleteMutex = new LLMutex;
 }
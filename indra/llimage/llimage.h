@@ -258,7 +258,7 @@ protected:
 
 public:
 	static AIThreadSafeSimpleDC<S32> sGlobalRawMemory;
-	static S32 sRawImageCount;
+	static LLAtomicS32 sRawImageCount;	// images may be decoded on several threads at once
 
 	static S32 sRawImageCachedCount;
 	S32 mCacheEntries;
@@ -348,7 +348,7 @@ protected:
 	S8 mDiscardLevel;
 	
 public:
-	static S32 sGlobalFormattedMemory;
+	static LLAtomicS32 sGlobalFormattedMemory;
 };
 
 #endif
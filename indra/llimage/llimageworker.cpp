@@ -32,8 +32,8 @@
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, LLThreadPool* pool, U32 pool_concurrency)
+	: LLQueuedThread("imagedecode", threaded, false, pool, pool_concurrency)
 {
 }
 
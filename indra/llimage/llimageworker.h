@@ -72,7 +72,9 @@ public:
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// With a pool, up to pool_concurrency images (0 for one per pool thread)
+	// are decoded at once on threads of the pool, see LLQueuedThread.
+	LLImageDecodeThread(bool threaded = true, LLThreadPool* pool = NULL, U32 pool_concurrency = 1);
 	virtual ~LLImageDecodeThread();
 
 	handle_t decodeImage(LLImageFormatted* image,
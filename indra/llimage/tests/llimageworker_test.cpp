@@ -38,6 +38,7 @@
 #include <algorithm>
 // Class to test
 #include "../llimageworker.h"
+#include "../llcommon/llthreadpool.h"
 // For timer class
 #include "../llcommon/lltimer.h"
 // Tut header
@@ -239,6 +240,43 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test an instance running on a thread pool, decoding several images at once
+		LLThreadPool pool("test", 2);
+		mThread = new LLImageDecodeThread(true, &pool, 0);
+		ensure("LLImageDecodeThread: pooled constructor failed", mThread != NULL);
+		ensure("LLImageDecodeThread: pooled instance has no pool", mThread->getThreadPool() == &pool);
+		ensure("LLImageDecodeThread: pooled concurrency incorrect", mThread->getPoolConcurrency() == 2);
+		const S32 COUNT = 8;
+		bool done[COUNT];
+		for (S32 i = 0; i < COUNT; ++i)
+		{
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL + i, 0, FALSE, new responder_test(&done[i]));
+		}
+		// Nothing is queued on the pool before update() creates the work requests
+		mThread->update(1);
+		const U32 INCREMENT_TIME = 100;				// 100 milliseconds
+		const U32 MAX_TIME = 100 * INCREMENT_TIME;	// Wait 10 seconds but no more
+		U32 total_time = 0;
+		S32 done_count = 0;
+		while (total_time < MAX_TIME)
+		{
+			done_count = std::count(done, done + COUNT, true);
+			if (done_count == COUNT)
+			{
+				break;
+			}
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+		}
+		ensure_equals("LLImageDecodeThread: pooled work units not processed", done_count, COUNT);
+		// The thread has to go before the pool it runs on
+		delete mThread;
+		mThread = NULL;
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
@@ -127,6 +127,10 @@ class LLInventoryItem : public LLInventoryObject
 public:
 	typedef LLDynamicArray<LLPointer<LLInventoryItem> > item_array_t;
 
+	// The binary cache reads and writes the members directly.
+	friend class LLInventoryCacheReader;
+	friend class LLInventoryCacheWriter;
+
 	//--------------------------------------------------------------------
 	// Initialization
 	//--------------------------------------------------------------------
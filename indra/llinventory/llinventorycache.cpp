@@ -0,0 +1,319 @@
+/**
+ * @file llinventorycache.cpp
+ * @brief Binary inventory cache file, mapped into memory when read.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llinventorycache.h"
+
+#include <algorithm>
+
+#include "llfile.h"
+#include "llinventory.h"
+#include "llthreadpool.h"
+
+using namespace LLInventoryCache;
+
+// Items decoded by one job of the pool.
+static const S32 ITEMS_PER_JOB = 4096;
+
+static bool item_parent_less(const ItemRecord& lhs, const ItemRecord& rhs)
+{
+	return lhs.mParentID < rhs.mParentID;
+}
+
+///----------------------------------------------------------------------------
+/// LLInventoryCacheWriter
+///----------------------------------------------------------------------------
+
+StringRef LLInventoryCacheWriter::addString(const std::string& str)
+{
+	StringRef ref;
+	ref.mOffset = (U32)mStrings.size();
+	ref.mSize = (U32)str.size();
+	mStrings.append(str);
+	return ref;
+}
+
+void LLInventoryCacheWriter::addCategory(const LLUUID& id, const LLUUID& parent_id, const LLUUID& owner_id,
+										 S32 version, LLFolderType::EType preferred_type, const std::string& name)
+{
+	CategoryRecord record;
+	record.mID = id;
+	record.mParentID = parent_id;
+	record.mOwnerID = owner_id;
+	record.mVersion = version;
+	record.mPreferredType = (S32)preferred_type;
+	record.mName = addString(name);
+	mCategories.push_back(record);
+}
+
+void LLInventoryCacheWriter::addItem(const LLInventoryItem& item)
+{
+	// Members rather than accessors: links answer those for their target.
+	const LLPermissions& perm = item.mPermissions;
+	ItemRecord record;
+	record.mID = item.mUUID;
+	record.mParentID = item.mParentUUID;
+	record.mAssetID = item.mAssetUUID;
+	record.mCreatorID = perm.getCreator();
+	record.mOwnerID = perm.getOwner();
+	record.mLastOwnerID = perm.getLastOwner();
+	record.mGroupID = perm.getGroup();
+	record.mMaskBase = perm.getMaskBase();
+	record.mMaskOwner = perm.getMaskOwner();
+	record.mMaskGroup = perm.getMaskGroup();
+	record.mMaskEveryone = perm.getMaskEveryone();
+	record.mMaskNextOwner = perm.getMaskNextOwner();
+	record.mFlags = item.mFlags;
+	record.mSalePrice = item.mSaleInfo.getSalePrice();
+	record.mCreationDate = (S32)item.mCreationDate;
+	record.mType = (S8)item.mType;
+	record.mInventoryType = (S8)item.mInventoryType;
+	record.mSaleType = (U8)item.mSaleInfo.getSaleType();
+	record.mGroupOwned = perm.isGroupOwned() ? 1 : 0;
+	record.mName = addString(item.mName);
+	record.mDescription = addString(item.mDescription);
+	mItems.push_back(record);
+}
+
+bool LLInventoryCacheWriter::write(const std::string& filename)
+{
+	std::stable_sort(mItems.begin(), mItems.end(), item_parent_less);
+
+	std::vector<GroupRecord> groups;
+	for (U32 i = 0; i < (U32)mItems.size(); ++i)
+	{
+		if (groups.empty() || groups.back().mParentID != mItems[i].mParentID)
+		{
+			GroupRecord group;
+			group.mParentID = mItems[i].mParentID;
+			group.mFirstItem = i;
+			group.mNumItems = 0;
+			groups.push_back(group);
+		}
+		++groups.back().mNumItems;
+	}
+
+	Header header;
+	header.mMagic = MAGIC;
+	header.mVersion = VERSION;
+	header.mNumCategories = (U32)mCategories.size();
+	header.mNumItems = (U32)mItems.size();
+	header.mNumGroups = (U32)groups.size();
+	header.mStringPoolSize = (U32)mStrings.size();
+
+	LLFILE* file = LLFile::fopen(filename, "wb");
+	if (!file)
+	{
+		llwarns << "unable to save inventory to: " << filename << llendl;
+		return false;
+	}
+	bool success = fwrite(&header, sizeof(Header), 1, file) == 1;
+	if (success && !mCategories.empty())
+	{
+		success = fwrite(&mCategories[0], sizeof(CategoryRecord), mCategories.size(), file) == mCategories.size();
+	}
+	if (success && !mItems.empty())
+	{
+		success = fwrite(&mItems[0], sizeof(ItemRecord), mItems.size(), file) == mItems.size();
+	}
+	if (success && !groups.empty())
+	{
+		success = fwrite(&groups[0], sizeof(GroupRecord), groups.size(), file) == groups.size();
+	}
+	if (success && !mStrings.empty())
+	{
+		success = fwrite(mStrings.data(), 1, mStrings.size(), file) == mStrings.size();
+	}
+	success = !fclose(file) && success;
+	if (!success)
+	{
+		llwarns << "unable to save inventory to: " << filename << llendl;
+		LLFile::remove(filename);
+	}
+	return success;
+}
+
+///----------------------------------------------------------------------------
+/// LLInventoryCacheReader
+///----------------------------------------------------------------------------
+
+class LLInventoryCacheDecodeJob : public LLThreadPool::Job
+{
+public:
+	LLInventoryCacheDecodeJob(const LLInventoryCacheReader& reader,
+							  const LLInventoryCacheReader::ItemFactory& factory,
+							  LLInventoryCacheReader::item_vec_t& items, S32 first, S32 count)
+		: mReader(&reader), mFactory(&factory), mItems(&items), mFirst(first), mCount(count) { }
+
+	/*virtual*/ void run()
+	{
+		for (S32 i = mFirst; i < mFirst + mCount; ++i)
+		{
+			LLInventoryItem* item = mFactory->createItem();
+			mReader->decodeItem(i, *item);
+			(*mItems)[i] = item;
+		}
+	}
+
+private:
+	const LLInventoryCacheReader* mReader;
+	const LLInventoryCacheReader::ItemFactory* mFactory;
+	LLInventoryCacheReader::item_vec_t* mItems;
+	S32 mFirst;
+	S32 mCount;
+};
+
+LLInventoryCacheReader::LLInventoryCacheReader()
+	: mHeader(NULL),
+	  mCategories(NULL),
+	  mItems(NULL),
+	  mGroups(NULL),
+	  mStrings(NULL)
+{
+}
+
+bool LLInventoryCacheReader::open(const std::string& filename)
+{
+	close();
+	if (!LLFile::isfile(filename) || !mFile.open(filename, LLMappedFile::READ_ONLY))
+	{
+		return false;
+	}
+
+	size_t size = mFile.getSize();
+	const Header* header = (const Header*)mFile.getData();
+	if (size < sizeof(Header) || header->mMagic != MAGIC || header->mVersion != VERSION)
+	{
+		llinfos << "Inventory cache " << filename << " has another format, ignoring it" << llendl;
+		mFile.close();
+		return false;
+	}
+
+	// 64 bit sums so that no count can overflow the check.
+	U64 categories_offset = sizeof(Header);
+	U64 items_offset = categories_offset + (U64)header->mNumCategories * sizeof(CategoryRecord);
+	U64 groups_offset = items_offset + (U64)header->mNumItems * sizeof(ItemRecord);
+	U64 strings_offset = groups_offset + (U64)header->mNumGroups * sizeof(GroupRecord);
+	if (strings_offset + header->mStringPoolSize != (U64)size)
+	{
+		llwarns << "Inventory cache " << filename << " is truncated or corrupt" << llendl;
+		mFile.close();
+		return false;
+	}
+
+	const U8* data = mFile.getData();
+	mHeader = header;
+	mCategories = (const CategoryRecord*)(data + categories_offset);
+	mItems = (const ItemRecord*)(data + items_offset);
+	mGroups = (const GroupRecord*)(data + groups_offset);
+	mStrings = (const char*)(data + strings_offset);
+	for (S32 i = 0; i < getNumGroups(); ++i)
+	{
+		if ((U64)mGroups[i].mFirstItem + mGroups[i].mNumItems > header->mNumItems)
+		{
+			llwarns << "Inventory cache " << filename << " is corrupt" << llendl;
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void LLInventoryCacheReader::close()
+{
+	mFile.close();
+	mHeader = NULL;
+	mCategories = NULL;
+	mItems = NULL;
+	mGroups = NULL;
+	mStrings = NULL;
+}
+
+std::string LLInventoryCacheReader::getString(const StringRef& ref) const
+{
+	if ((U64)ref.mOffset + ref.mSize > mHeader->mStringPoolSize)
+	{
+		return LLStringUtil::null;
+	}
+	return std::string(mStrings + ref.mOffset, ref.mSize);
+}
+
+void LLInventoryCacheReader::decodeItem(S32 i, LLInventoryItem& item) const
+{
+	const ItemRecord& record = mItems[i];
+	item.mUUID = record.mID;
+	item.mParentUUID = record.mParentID;
+	item.mAssetUUID = record.mAssetID;
+	item.mType = (LLAssetType::EType)record.mType;
+	item.mInventoryType = (LLInventoryType::EType)record.mInventoryType;
+	item.mName = getString(record.mName);
+	item.mDescription = getString(record.mDescription);
+	item.mFlags = record.mFlags;
+	item.mCreationDate = record.mCreationDate;
+	item.mSaleInfo.setSaleType((LLSaleInfo::EForSale)record.mSaleType);
+	item.mSaleInfo.setSalePrice(record.mSalePrice);
+
+	// Restore the permissions exactly as they were written, they were
+	// fixed up before.
+	LLPermissions& perm = item.mPermissions;
+	perm.init(record.mCreatorID, record.mOwnerID, record.mLastOwnerID, record.mGroupID);
+	perm.setMaskBase(record.mMaskBase);
+	perm.setMaskOwner(record.mMaskOwner);
+	perm.setMaskGroup(record.mMaskGroup);
+	perm.setMaskEveryone(record.mMaskEveryone);
+	perm.setMaskNext(record.mMaskNextOwner);
+	perm.yesReallySetOwner(record.mOwnerID, record.mGroupOwned != 0);
+}
+
+void LLInventoryCacheReader::decodeItems(const ItemFactory& factory, item_vec_t& items, LLThreadPool* pool) const
+{
+	S32 count = getNumItems();
+	items.clear();
+	items.resize(count);
+
+	std::vector<LLInventoryCacheDecodeJob> jobs;
+	jobs.reserve(count / ITEMS_PER_JOB + 1);
+	for (S32 first = 0; first < count; first += ITEMS_PER_JOB)
+	{
+		jobs.push_back(LLInventoryCacheDecodeJob(*this, factory, items, first, llmin(ITEMS_PER_JOB, count - first)));
+	}
+	if (pool && jobs.size() > 1)
+	{
+		std::vector<LLThreadPool::Job*> job_ptrs;
+		for (U32 i = 0; i < (U32)jobs.size(); ++i)
+		{
+			job_ptrs.push_back(&jobs[i]);
+		}
+		pool->runBatch(&job_ptrs[0], (U32)job_ptrs.size());
+	}
+	else
+	{
+		for (U32 i = 0; i < (U32)jobs.size(); ++i)
+		{
+			jobs[i].run();
+		}
+	}
+}
@@ -0,0 +1,184 @@
+/**
+ * @file llinventorycache.h
+ * @brief Binary inventory cache file, mapped into memory when read.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLINVENTORYCACHE_H
+#define LL_LLINVENTORYCACHE_H
+
+#include <string>
+#include <vector>
+
+#include "llfoldertype.h"
+#include "llmappedfile.h"
+#include "llpointer.h"
+#include "lluuid.h"
+
+class LLInventoryItem;
+class LLThreadPool;
+
+// Layout of a cache file, in the byte order of the machine that wrote it:
+//
+//   Header
+//   CategoryRecord[mNumCategories]
+//   ItemRecord[mNumItems], sorted by parent
+//   GroupRecord[mNumGroups], the range of items of each parent
+//   string pool, names and descriptions without terminators
+//
+// All records have a fixed size, so any range of items can be decoded
+// without looking at the others, and the items of a folder are found
+// without looking at their parents one by one.
+namespace LLInventoryCache
+{
+	const U32 MAGIC = 0x424e5649;		// "IVNB"
+	// Change when the layout of the records changes.
+	const U32 VERSION = 1;
+
+	struct Header
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mNumCategories;
+		U32 mNumItems;
+		U32 mNumGroups;
+		U32 mStringPoolSize;
+	};
+
+	struct StringRef
+	{
+		U32 mOffset;	// in the string pool
+		U32 mSize;
+	};
+
+	struct CategoryRecord
+	{
+		LLUUID mID;
+		LLUUID mParentID;
+		LLUUID mOwnerID;
+		S32 mVersion;
+		S32 mPreferredType;
+		StringRef mName;
+	};
+
+	struct ItemRecord
+	{
+		LLUUID mID;
+		LLUUID mParentID;
+		LLUUID mAssetID;
+		LLUUID mCreatorID;
+		LLUUID mOwnerID;
+		LLUUID mLastOwnerID;
+		LLUUID mGroupID;
+		U32 mMaskBase;
+		U32 mMaskOwner;
+		U32 mMaskGroup;
+		U32 mMaskEveryone;
+		U32 mMaskNextOwner;
+		U32 mFlags;
+		S32 mSalePrice;
+		S32 mCreationDate;
+		S8 mType;
+		S8 mInventoryType;
+		U8 mSaleType;
+		U8 mGroupOwned;
+		StringRef mName;
+		StringRef mDescription;
+	};
+
+	struct GroupRecord
+	{
+		LLUUID mParentID;
+		U32 mFirstItem;
+		U32 mNumItems;
+	};
+}
+
+// Collects categories and items and writes them as a cache file.
+class LLInventoryCacheWriter
+{
+public:
+	void addCategory(const LLUUID& id, const LLUUID& parent_id, const LLUUID& owner_id,
+					 S32 version, LLFolderType::EType preferred_type, const std::string& name);
+	void addItem(const LLInventoryItem& item);
+
+	// Sorts the items by parent and writes the file. Returns false when
+	// it could not be written completely.
+	bool write(const std::string& filename);
+
+private:
+	LLInventoryCache::StringRef addString(const std::string& str);
+
+	std::vector<LLInventoryCache::CategoryRecord> mCategories;
+	std::vector<LLInventoryCache::ItemRecord> mItems;
+	std::string mStrings;
+};
+
+// Maps a cache file and decodes its records.
+class LLInventoryCacheReader
+{
+public:
+	// Creates the objects items are decoded into. Called from pool threads.
+	class ItemFactory
+	{
+	public:
+		virtual ~ItemFactory() { }
+		virtual LLInventoryItem* createItem() const = 0;
+	};
+
+	typedef std::vector<LLPointer<LLInventoryItem> > item_vec_t;
+
+	LLInventoryCacheReader();
+
+	// Fails when the file is missing, was written with another VERSION or
+	// its size doesn't match the header.
+	bool open(const std::string& filename);
+	void close();
+
+	S32 getNumCategories() const			{ return mHeader ? (S32)mHeader->mNumCategories : 0; }
+	S32 getNumItems() const					{ return mHeader ? (S32)mHeader->mNumItems : 0; }
+	S32 getNumGroups() const				{ return mHeader ? (S32)mHeader->mNumGroups : 0; }
+	const LLInventoryCache::CategoryRecord& getCategory(S32 i) const	{ return mCategories[i]; }
+	const LLInventoryCache::ItemRecord& getItemRecord(S32 i) const		{ return mItems[i]; }
+	const LLInventoryCache::GroupRecord& getGroup(S32 i) const			{ return mGroups[i]; }
+
+	// Empty for references outside the string pool.
+	std::string getString(const LLInventoryCache::StringRef& ref) const;
+
+	// Fills item from record i.
+	void decodeItem(S32 i, LLInventoryItem& item) const;
+
+	// Creates and decodes all items, items[i] is the item of record i.
+	// The work is split over pool when it isn't NULL.
+	void decodeItems(const ItemFactory& factory, item_vec_t& items, LLThreadPool* pool) const;
+
+private:
+	LLMappedFile mFile;
+	const LLInventoryCache::Header* mHeader;
+	const LLInventoryCache::CategoryRecord* mCategories;
+	const LLInventoryCache::ItemRecord* mItems;
+	const LLInventoryCache::GroupRecord* mGroups;
+	const char* mStrings;
+};
+
+#endif // LL_LLINVENTORYCACHE_H
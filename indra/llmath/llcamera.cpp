@@ -291,6 +291,69 @@ S32 LLCamera::AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVec
 	return AABBInFrustumNoFarClip(center, radius, mRegionPlanes);
 }
 
+LLFrustumPlanes4::LLFrustumPlanes4(const LLCamera& camera, bool far_clip)
+	: mCount(0)
+{
+	U32 max_planes = llmin(camera.mPlaneCount, (U32) LLCamera::AGENT_PLANE_USER_CLIP_NUM);
+	for (U32 i = 0; i < max_planes; i++)
+	{
+		if (camera.mPlaneMask[i] >= LLCamera::PLANE_MASK_NUM ||
+			(!far_clip && i == LLCamera::AGENT_PLANE_FAR))
+		{
+			continue;
+		}
+		const LLPlane& p = camera.mAgentPlanes[i];
+		for (U32 j = 0; j < 3; j++)
+		{
+			mNormal[mCount][j].splat(p[j]);
+			mAbsNormal[mCount][j].splat(fabsf(p[j]));
+		}
+		mDist[mCount].splat(p[3]);
+		mCount++;
+	}
+}
+
+// Same test as LLCamera::AABBInFrustum(): a box is outside when even its
+// corner nearest to the inside of a plane is on the outer side of it, and
+// only partly in when its farthest corner is. Those corners are at
+// center -/+ sum(|n[i]| * radius[i]) along the plane normal.
+void LLFrustumPlanes4::AABBInFrustum(const LLVector4a* center, const LLVector4a* radius, S32* results) const
+{
+	const LLVector4a& zero = LLVector4a::getZero();
+	U32 outside = 0;
+	U32 partial = 0;
+	LLVector4a dist, proj, t;
+	for (U32 i = 0; i < mCount; i++)
+	{
+		dist.setMul(center[0], mNormal[i][0]);
+		t.setMul(center[1], mNormal[i][1]);
+		dist.add(t);
+		t.setMul(center[2], mNormal[i][2]);
+		dist.add(t);
+		dist.add(mDist[i]);
+
+		proj.setMul(radius[0], mAbsNormal[i][0]);
+		t.setMul(radius[1], mAbsNormal[i][1]);
+		proj.add(t);
+		t.setMul(radius[2], mAbsNormal[i][2]);
+		proj.add(t);
+
+		t.setSub(dist, proj);
+		outside |= t.greaterThan(zero).getGatheredBits();
+		if (outside == LLVector4Logical::MASK_XYZW)
+		{
+			break;
+		}
+		t.setAdd(dist, proj);
+		partial |= t.greaterThan(zero).getGatheredBits();
+	}
+
+	for (U32 i = 0; i < 4; i++)
+	{
+		results[i] = (outside & (1 << i)) ? 0 : ((partial & (1 << i)) ? 1 : 2);
+	}
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
@@ -221,6 +221,7 @@ public:
 	void setFixedDistance(F32 distance) { mFixedDistance = distance; }
 	
 	friend std::ostream& operator<<(std::ostream &s, const LLCamera &C);
+	friend class LLFrustumPlanes4;
 
 protected:
 	void calculateFrustumPlanes();
@@ -229,6 +230,29 @@ protected:
 	void calculateWorldFrustumPlanes();
 } LL_ALIGN_POSTFIX(16);
 
+// The agent frustum planes of an LLCamera, splatted for testing four boxes
+// at once against them.
+LL_ALIGN_PREFIX(16)
+class LLFrustumPlanes4
+{
+public:
+	// Uses the planes that AABBInFrustum() (far_clip) or
+	// AABBInFrustumNoFarClip() would use.
+	LLFrustumPlanes4(const LLCamera& camera, bool far_clip);
+
+	// Tests four boxes given as structure of arrays: center[0..2] and
+	// radius[0..2] hold the x, y and z components of all four boxes.
+	// Writes 0 (outside), 1 (partly in) or 2 (fully in) for each box to
+	// results[0..3], like AABBInFrustum().
+	void AABBInFrustum(const LLVector4a* center, const LLVector4a* radius, S32* results) const;
+
+private:
+	LL_ALIGN_16(LLVector4a mNormal[LLCamera::AGENT_PLANE_USER_CLIP_NUM][3]);
+	LL_ALIGN_16(LLVector4a mAbsNormal[LLCamera::AGENT_PLANE_USER_CLIP_NUM][3]);
+	LL_ALIGN_16(LLVector4a mDist[LLCamera::AGENT_PLANE_USER_CLIP_NUM]);
+	U32 mCount;
+} LL_ALIGN_POSTFIX(16);
+
 
 #endif
 
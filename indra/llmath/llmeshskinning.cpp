@@ -0,0 +1,189 @@
+/**
+ * @file llmeshskinning.cpp
+ * @brief Software skinning of rigged mesh faces.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llmeshskinning.h"
+
+// Faces are cut into jobs of this many vertices, so that one big face
+// spreads over several threads.
+static const U32 SKIN_JOB_VERTICES = 2048;
+// Below this, handing the batch to the pool costs more than it saves.
+static const U32 MIN_PARALLEL_VERTICES = 8192;
+
+//static
+void LLMeshSkinning::applyBindShape(const LLMatrix4a& bind_shape, LLMatrix4a* palette, U32 count)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		LLMatrix4a joint = palette[i];
+		for (U32 j = 0; j < 4; ++j)
+		{
+			joint.rotate4(bind_shape.mMatrix[j], palette[i].mMatrix[j]);
+		}
+	}
+}
+
+//static
+void LLMeshSkinning::skinVertices(const LLMatrix4a* palette, U32 palette_size, const LLVector4a* weights,
+								  const LLVector4a* positions, const LLVector4a* normals,
+								  LLVector4a* pos_out, LLVector4a* norm_out, U32 count)
+{
+	llassert(palette_size > 0);
+	const S32 max_joint = (S32)palette_size - 1;
+	if (!normals)
+	{
+		norm_out = NULL;
+	}
+
+	LL_ALIGN_16(S32 joint[4]);
+	for (U32 i = 0; i < count; ++i)
+	{
+		const LLVector4a& weight = weights[i];
+		__m128i joint_index = _mm_cvttps_epi32(weight);
+		_mm_store_si128((__m128i*) joint, joint_index);
+
+		LLVector4a influence;
+		influence.setSub(weight, LLVector4a(_mm_cvtepi32_ps(joint_index)));
+
+		LLQuad sum = _mm_add_ps(influence, _mm_movehl_ps(influence, influence));
+		F32 total = _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1))));
+		if (total > 0.f)
+		{
+			influence.mul(1.f / total);
+		}
+		else
+		{	//a vertex without influences is sent off to infinity, as it always was
+			influence.splat(F32_MAX);
+		}
+
+		const LLMatrix4a& m0 = palette[llclamp(joint[0], 0, max_joint)];
+		const LLMatrix4a& m1 = palette[llclamp(joint[1], 0, max_joint)];
+		const LLMatrix4a& m2 = palette[llclamp(joint[2], 0, max_joint)];
+		const LLMatrix4a& m3 = palette[llclamp(joint[3], 0, max_joint)];
+
+		LLVector4a w0 = _mm_shuffle_ps(influence, influence, _MM_SHUFFLE(0, 0, 0, 0));
+		LLVector4a w1 = _mm_shuffle_ps(influence, influence, _MM_SHUFFLE(1, 1, 1, 1));
+		LLVector4a w2 = _mm_shuffle_ps(influence, influence, _MM_SHUFFLE(2, 2, 2, 2));
+		LLVector4a w3 = _mm_shuffle_ps(influence, influence, _MM_SHUFFLE(3, 3, 3, 3));
+
+		LLMatrix4a blend;
+		for (U32 r = 0; r < 4; ++r)
+		{
+			LLVector4a a, b;
+			a.setMul(m0.mMatrix[r], w0);
+			b.setMul(m1.mMatrix[r], w1);
+			a.add(b);
+			b.setMul(m2.mMatrix[r], w2);
+			a.add(b);
+			b.setMul(m3.mMatrix[r], w3);
+			blend.mMatrix[r].setAdd(a, b);
+		}
+
+		blend.affineTransform(positions[i], pos_out[i]);
+
+		if (norm_out)
+		{
+			LLVector4a n;
+			blend.rotate(normals[i], n);
+			n.normalize3fast();
+			norm_out[i] = n;
+		}
+	}
+}
+
+void LLMeshSkinningBatch::SkinJob::run()
+{
+	LLMeshSkinning::skinVertices(mPalette, mPaletteSize, mWeights, mPositions, mNormals, mPosOut, mNormOut, mCount);
+}
+
+LLMeshSkinningBatch::LLMeshSkinningBatch()
+:	mVertexCount(0)
+{
+}
+
+U32 LLMeshSkinningBatch::addPalette(U32 count)
+{
+	U32 offset = mPalettes.size();
+	mPalettes.resize(offset + count);
+	return offset;
+}
+
+void LLMeshSkinningBatch::addFace(U32 palette_offset, U32 palette_size, const LLVector4a* weights,
+								  const LLVector4a* positions, const LLVector4a* normals,
+								  LLVector4a* pos_out, LLVector4a* norm_out, U32 count)
+{
+	if (!palette_size || !weights)
+	{
+		return;
+	}
+
+	for (U32 begin = 0; begin < count; begin += SKIN_JOB_VERTICES)
+	{
+		SkinJob job;
+		job.mPalette = NULL;	//set by run(), the palettes may still move
+		job.mPaletteOffset = palette_offset;
+		job.mPaletteSize = palette_size;
+		job.mWeights = weights + begin;
+		job.mPositions = positions + begin;
+		job.mNormals = normals ? normals + begin : NULL;
+		job.mPosOut = pos_out + begin;
+		job.mNormOut = norm_out ? norm_out + begin : NULL;
+		job.mCount = llmin(count - begin, SKIN_JOB_VERTICES);
+		mJobs.push_back(job);
+	}
+	mVertexCount += count;
+}
+
+void LLMeshSkinningBatch::run()
+{
+	for (U32 i = 0; i < mJobs.size(); ++i)
+	{
+		mJobs[i].mPalette = mPalettes.mArray + mJobs[i].mPaletteOffset;
+	}
+
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (pool && mJobs.size() > 1 && mVertexCount >= MIN_PARALLEL_VERTICES)
+	{
+		mJobPtrs.clear();
+		for (U32 i = 0; i < mJobs.size(); ++i)
+		{
+			mJobPtrs.push_back(&mJobs[i]);
+		}
+		pool->runBatch(&mJobPtrs[0], (U32)mJobPtrs.size());
+	}
+	else
+	{
+		for (U32 i = 0; i < mJobs.size(); ++i)
+		{
+			mJobs[i].run();
+		}
+	}
+
+	mJobs.clear();
+	mPalettes.resize(0);
+	mVertexCount = 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file llmeshskinning.h
+ * @brief Software skinning of rigged mesh faces.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLMESHSKINNING_H
+#define LL_LLMESHSKINNING_H
+
+#include <vector>
+
+#include "llalignedarray.h"
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llthreadpool.h"
+
+// Skins vertices on the CPU, for when the avatar shaders can't.
+//
+// A palette holds one matrix per joint of a skin: the inverse bind matrix
+// times the world matrix of the joint, with the bind shape matrix applied
+// in front by applyBindShape(), so a vertex is transformed once by the
+// blend of its joints instead of by the bind shape and then by the blend.
+class LLMeshSkinning
+{
+public:
+	static void applyBindShape(const LLMatrix4a& bind_shape, LLMatrix4a* palette, U32 count);
+
+	// Skins count vertices. Each weight packs up to four joint indices in
+	// the integer parts of its components and their influences in the
+	// fractions. normals and norm_out may be NULL.
+	static void skinVertices(const LLMatrix4a* palette, U32 palette_size, const LLVector4a* weights,
+							 const LLVector4a* positions, const LLVector4a* normals,
+							 LLVector4a* pos_out, LLVector4a* norm_out, U32 count);
+};
+
+// Collects the faces to skin in a frame and skins them together, spread
+// over the shared thread pool when there are enough vertices to pay for it.
+// Not thread safe; faces are queued and run from one thread.
+class LLMeshSkinningBatch
+{
+public:
+	LLMeshSkinningBatch();
+
+	// Makes room for a palette of count matrices and returns its offset.
+	U32 addPalette(U32 count);
+	// The matrices of the palette at offset; the pointer is only good until
+	// the next addPalette().
+	LLMatrix4a* getPalette(U32 offset)			{ return mPalettes.mArray + offset; }
+
+	// Queues count vertices of a face for skinning with the palette at
+	// palette_offset. The source and destination arrays must stay valid
+	// until run().
+	void addFace(U32 palette_offset, U32 palette_size, const LLVector4a* weights,
+				 const LLVector4a* positions, const LLVector4a* normals,
+				 LLVector4a* pos_out, LLVector4a* norm_out, U32 count);
+
+	bool empty() const							{ return mJobs.empty(); }
+	U32 getVertexCount() const					{ return mVertexCount; }
+
+	// Skins everything queued and empties the batch.
+	void run();
+
+private:
+	class SkinJob : public LLThreadPool::Job
+	{
+	public:
+		/*virtual*/ void run();
+
+		const LLMatrix4a* mPalette;
+		U32 mPaletteOffset;
+		U32 mPaletteSize;
+		const LLVector4a* mWeights;
+		const LLVector4a* mPositions;
+		const LLVector4a* mNormals;
+		LLVector4a* mPosOut;
+		LLVector4a* mNormOut;
+		U32 mCount;
+	};
+
+	LLAlignedArray<LLMatrix4a, 64> mPalettes;
+	std::vector<SkinJob> mJobs;
+	std::vector<LLThreadPool::Job*> mJobPtrs;
+	U32 mVertexCount;
+};
+
+#endif // LL_LLMESHSKINNING_H
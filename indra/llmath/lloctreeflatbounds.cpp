@@ -0,0 +1,107 @@
+/** 
+ * @file lloctreeflatbounds.cpp
+ * @brief Structure of arrays storage of octree node bounds for batched culling.
+ *
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lloctreeflatbounds.h"
+#include "llcamera.h"
+#include "llmemory.h"
+
+LLOctreeFlatBounds::LLOctreeFlatBounds()
+	: mBlocks(NULL),
+	  mBlockCount(0),
+	  mBlockCapacity(0)
+{
+}
+
+LLOctreeFlatBounds::~LLOctreeFlatBounds()
+{
+	ll_aligned_free_16(mBlocks);
+}
+
+S32 LLOctreeFlatBounds::allocateBlock()
+{
+	S32 block;
+	if (!mFreeBlocks.empty())
+	{
+		block = mFreeBlocks.back();
+		mFreeBlocks.pop_back();
+	}
+	else
+	{
+		if (mBlockCount == mBlockCapacity)
+		{
+			U32 capacity = llmax(mBlockCapacity * 2, (U32)64);
+			mBlocks = (Block*)ll_aligned_realloc_16(mBlocks, capacity * sizeof(Block), mBlockCapacity * sizeof(Block));
+			mBlockCapacity = capacity;
+		}
+		block = mBlockCount++;
+		mOwners.resize(mBlockCount * BLOCK_SLOTS);
+	}
+
+	for (U32 i = 0; i < BLOCK_SLOTS; i++)
+	{
+		mOwners[block * BLOCK_SLOTS + i] = NULL;
+	}
+	return block;
+}
+
+void LLOctreeFlatBounds::freeBlock(S32 block)
+{
+	llassert(block >= 0 && block < (S32)mBlockCount);
+	mFreeBlocks.push_back(block);
+}
+
+void LLOctreeFlatBounds::setBounds(S32 block, U32 slot, const void* owner, const LLVector4a& center, const LLVector4a& radius)
+{
+	llassert(block >= 0 && block < (S32)mBlockCount && slot < BLOCK_SLOTS);
+	Block& b = mBlocks[block];
+	U32 half = slot >> 2;
+	U32 lane = slot & 3;
+	for (U32 i = 0; i < 3; i++)
+	{
+		b.mCenter[half][i].getF32ptr()[lane] = center[i];
+		b.mRadius[half][i].getF32ptr()[lane] = radius[i];
+	}
+	mOwners[block * BLOCK_SLOTS + slot] = owner;
+}
+
+void LLOctreeFlatBounds::releaseSlot(S32 block, U32 slot, const void* owner)
+{
+	llassert(block >= 0 && block < (S32)mBlockCount && slot < BLOCK_SLOTS);
+	if (mOwners[block * BLOCK_SLOTS + slot] == owner)
+	{
+		mOwners[block * BLOCK_SLOTS + slot] = NULL;
+	}
+}
+
+void LLOctreeFlatBounds::frustumCheck(S32 block, const LLFrustumPlanes4& planes, S32* results) const
+{
+	const Block& b = mBlocks[block];
+	planes.AABBInFrustum(b.mCenter[0], b.mRadius[0], results);
+	planes.AABBInFrustum(b.mCenter[1], b.mRadius[1], results + 4);
+}
@@ -0,0 +1,86 @@
+/** 
+ * @file lloctreeflatbounds.h
+ * @brief Structure of arrays storage of octree node bounds for batched culling.
+ *
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLOCTREEFLATBOUNDS_H
+#define LL_LLOCTREEFLATBOUNDS_H
+
+#include <vector>
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+class LLFrustumPlanes4;
+
+// Bounding boxes of octree nodes, kept in blocks of eight: one block per
+// parent node, one slot per child octant. Within a block the centers and
+// radii are stored as structure of arrays, four slots per LLVector4a, so
+// that all children of a node can be tested against a frustum with two
+// passes of SIMD math instead of eight scalar tests.
+//
+// Blocks are handed out in allocation order and recycled through a free
+// list, so inserting or removing nodes only touches the slots involved.
+// Each slot remembers the object that last wrote it, so that readers can
+// tell stale slots (from children that moved or died) from current ones.
+class LLOctreeFlatBounds
+{
+public:
+	enum { BLOCK_SLOTS = 8, NO_BLOCK = -1 };
+
+	LLOctreeFlatBounds();
+	~LLOctreeFlatBounds();
+
+	S32 allocateBlock();
+	void freeBlock(S32 block);
+
+	void setBounds(S32 block, U32 slot, const void* owner, const LLVector4a& center, const LLVector4a& radius);
+	const void* getOwner(S32 block, U32 slot) const		{ return mOwners[block * BLOCK_SLOTS + slot]; }
+	// Marks a slot unused if owner still holds it.
+	void releaseSlot(S32 block, U32 slot, const void* owner);
+
+	// Tests all eight slots of a block, writing LLCamera::AABBInFrustum()
+	// style results to results[0..7]. Results of unused slots are garbage.
+	void frustumCheck(S32 block, const LLFrustumPlanes4& planes, S32* results) const;
+
+	U32 getBlockCount() const							{ return mBlockCount - (U32)mFreeBlocks.size(); }
+
+private:
+	LL_ALIGN_PREFIX(16)
+	struct Block
+	{
+		// [half][component]: slots 0-3 and 4-7, x, y and z.
+		LLVector4a mCenter[2][3];
+		LLVector4a mRadius[2][3];
+	} LL_ALIGN_POSTFIX(16);
+
+	Block* mBlocks;
+	U32 mBlockCount;
+	U32 mBlockCapacity;
+	std::vector<const void*> mOwners;
+	std::vector<S32> mFreeBlocks;
+};
+
+#endif // LL_LLOCTREEFLATBOUNDS_H
@@ -686,7 +686,8 @@ LLProfile::Face* LLProfile::addHole(const LLProfileParams& params, BOOL flat, F3
 
 	Face *face = addFace(mTotalOut, mTotal-mTotalOut,0,LL_FACE_INNER_SIDE, flat);
 
-	static LLAlignedArray<LLVector4a,64> pt;
+	// Not static: volumes of plain prims are also generated on pool threads.
+	LLAlignedArray<LLVector4a,64> pt;
 	pt.resize(mTotal) ;
 
 	for (S32 i=mTotalOut;i<mTotal;i++)
@@ -2045,7 +2046,7 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+LLAtomicS32 LLVolume::sNumMeshPoints(0);
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -2176,25 +2177,19 @@ BOOL LLVolume::generate()
 
 		for (S32 s = 0; s < sizeS; ++s)
 		{
-			F32* scale = mPathp->mPath[s].mScale.getF32ptr();
-			
-			F32 sc [] = 
-			{ scale[0], 0, 0, 0,
-				0, scale[1], 0, 0,
-				0, 0, scale[2], 0,
-					0, 0, 0, 1 };
-			
-			LLMatrix4 rot((F32*) mPathp->mPath[s].mRot.mMatrix);
-			LLMatrix4 scale_mat(sc);
-			
-			scale_mat *= rot;
+			const LLPath::PathPt& path_pt = mPathp->mPath[s];
+			const F32* scale = path_pt.mScale.getF32ptr();
 			
+			// The scale is diagonal, so scaling before rotating scales the
+			// rows of the rotation.
 			LLMatrix4a rot_mat;
-			rot_mat.loadu(scale_mat);
+			rot_mat.mMatrix[0].setMul(path_pt.mRot.mMatrix[0], scale[0]);
+			rot_mat.mMatrix[1].setMul(path_pt.mRot.mMatrix[1], scale[1]);
+			rot_mat.mMatrix[2].setMul(path_pt.mRot.mMatrix[2], scale[2]);
 			
 			LLVector4a* profile = mProfilep->mProfile.mArray;
 			LLVector4a* end_profile = profile+sizeT;
-			LLVector4a offset = mPathp->mPath[s].mPos;
+			LLVector4a offset = path_pt.mPos;
 
 			LLVector4a tmp;
 
@@ -2671,6 +2666,192 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 }
 
 
+// Layout of a block written by packDecodedFaces(): an LLDecodedFacesHeader,
+// then for each face an LLDecodedFaceHeader followed by the vertex block as
+// resizeVertices() allocates it (positions, normals, texture coordinates),
+// the index block as resizeIndices() allocates it, and the weights when
+// the face has any.
+struct LLDecodedFacesHeader
+{
+	U32 mFaceCount;
+	U32 mPad[3];
+};
+
+struct LLDecodedFaceHeader
+{
+	LLVector4a mExtents[2];
+	LLVector2 mTexCoordExtents[2];
+	S32 mNumVertices;
+	S32 mNumIndices;
+	U32 mHasWeights;
+	U32 mPad;
+};
+
+static U32 decoded_vertex_bytes(S32 num_verts)
+{
+	return sizeof(LLVector4a) * 2 * num_verts + (((num_verts * sizeof(LLVector2)) + 0xF) & ~0xF);
+}
+
+static U32 decoded_index_bytes(S32 num_indices)
+{
+	return ((num_indices * sizeof(U16)) + 0xF) & ~0xF;
+}
+
+void LLVolume::packDecodedFaces(std::vector<U8>& data) const
+{
+	U32 size = sizeof(LLDecodedFacesHeader);
+	for (U32 i = 0; i < mVolumeFaces.size(); ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+		size += sizeof(LLDecodedFaceHeader) + decoded_vertex_bytes(face.mNumVertices) + decoded_index_bytes(face.mNumIndices);
+		if (face.mWeights)
+		{
+			size += sizeof(LLVector4a) * face.mNumVertices;
+		}
+	}
+
+	// zero filled, so that the padding of the arrays is too
+	data.assign(size, 0);
+	U8* out = &data[0];
+
+	LLDecodedFacesHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mFaceCount = mVolumeFaces.size();
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	for (U32 i = 0; i < mVolumeFaces.size(); ++i)
+	{
+		const LLVolumeFace& face = mVolumeFaces[i];
+
+		LLDecodedFaceHeader face_header;
+		memset(&face_header, 0, sizeof(face_header));
+		face_header.mExtents[0] = face.mExtents[0];
+		face_header.mExtents[1] = face.mExtents[1];
+		face_header.mTexCoordExtents[0] = face.mTexCoordExtents[0];
+		face_header.mTexCoordExtents[1] = face.mTexCoordExtents[1];
+		face_header.mNumVertices = face.mNumVertices;
+		face_header.mNumIndices = face.mNumIndices;
+		face_header.mHasWeights = face.mWeights ? 1 : 0;
+		memcpy(out, &face_header, sizeof(face_header));
+		out += sizeof(face_header);
+
+		if (face.mNumVertices)
+		{	//normals and texture coordinates follow the positions
+			memcpy(out, face.mPositions, (sizeof(LLVector4a) * 2 + sizeof(LLVector2)) * face.mNumVertices);
+		}
+		out += decoded_vertex_bytes(face.mNumVertices);
+
+		if (face.mNumIndices)
+		{
+			memcpy(out, face.mIndices, sizeof(U16) * face.mNumIndices);
+		}
+		out += decoded_index_bytes(face.mNumIndices);
+
+		if (face.mWeights)
+		{
+			memcpy(out, face.mWeights, sizeof(LLVector4a) * face.mNumVertices);
+			out += sizeof(LLVector4a) * face.mNumVertices;
+		}
+	}
+
+	llassert(out == &data[0] + size);
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* data, U32 size)
+{
+	if (((size_t)data & 0xF) || size < sizeof(LLDecodedFacesHeader))
+	{
+		return false;
+	}
+
+	const U8* end = data + size;
+	const LLDecodedFacesHeader* header = (const LLDecodedFacesHeader*) data;
+	data += sizeof(LLDecodedFacesHeader);
+
+	U32 face_count = header->mFaceCount;
+	if (face_count == 0 || face_count > (U32)(end - data) / sizeof(LLDecodedFaceHeader))
+	{
+		return false;
+	}
+
+	mVolumeFaces.clear();
+	mVolumeFaces.resize(face_count);
+
+	for (U32 i = 0; i < face_count; ++i)
+	{
+		LLVolumeFace& face = mVolumeFaces[i];
+
+		if ((U32)(end - data) < sizeof(LLDecodedFaceHeader))
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+		const LLDecodedFaceHeader* face_header = (const LLDecodedFaceHeader*) data;
+		data += sizeof(LLDecodedFaceHeader);
+
+		S32 num_verts = face_header->mNumVertices;
+		S32 num_indices = face_header->mNumIndices;
+		if (num_verts < 0 || num_verts > 65536 || num_indices < 0 || num_indices > 0x1000000)
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+
+		U32 vertex_bytes = decoded_vertex_bytes(num_verts);
+		U32 index_bytes = decoded_index_bytes(num_indices);
+		U32 weight_bytes = face_header->mHasWeights ? sizeof(LLVector4a) * num_verts : 0;
+		if ((U32)(end - data) < vertex_bytes + index_bytes + weight_bytes)
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+
+		face.resizeVertices(num_verts);
+		if (num_verts)
+		{
+			LLVector4a::memcpyNonAliased16((F32*) face.mPositions, (const F32*) data, vertex_bytes);
+		}
+		data += vertex_bytes;
+
+		face.resizeIndices(num_indices);
+		if (num_indices)
+		{
+			LLVector4a::memcpyNonAliased16((F32*) face.mIndices, (const F32*) data, index_bytes);
+		}
+		if (num_verts)
+		{
+			for (S32 j = 0; j < num_indices; ++j)
+			{
+				if (face.mIndices[j] >= num_verts)
+				{	//garbage, don't hand it to the renderer
+					mVolumeFaces.clear();
+					return false;
+				}
+			}
+		}
+		data += index_bytes;
+
+		if (weight_bytes)
+		{
+			face.allocateWeights(num_verts);
+			LLVector4a::memcpyNonAliased16((F32*) face.mWeights, (const F32*) data, weight_bytes);
+			data += weight_bytes;
+		}
+
+		face.mExtents[0] = face_header->mExtents[0];
+		face.mExtents[1] = face_header->mExtents[1];
+		face.mTexCoordExtents[0] = face_header->mTexCoordExtents[0];
+		face.mTexCoordExtents[1] = face_header->mTexCoordExtents[1];
+		//the faces were stored after cacheOptimize()
+		face.mOptimized = TRUE;
+	}
+
+	mSculptLevel = 0;
+
+	return true;
+}
+
 BOOL LLVolume::isMeshAssetLoaded()
 {
 	return mIsMeshAssetLoaded;
@@ -6331,89 +6512,97 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	F32 begin_stex = floorf(profile[mBeginS][2]);
 	S32 num_s = ((mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2) ? mNumS/2 : mNumS;
 
-	S32 cur_vertex = 0;
 	S32 end_t = mBeginT+mNumT;
 	bool test = (mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2;
 
-	// Copy the vertices into the array
-	for (t = mBeginT; t < end_t; t++)
+	// Every row of the face takes the same profile points and S coordinates,
+	// so work those out once: offsets into a row of the mesh go to
+	// mesh_offset, S coordinates to the first row of tc.
+	std::vector<S32> mesh_offset;
+	mesh_offset.reserve(mNumS);
+	for (s = 0; s < num_s; s++)
 	{
-		tt = path_data[t].mTexT;
-		for (s = 0; s < num_s; s++)
+		if (mTypeMask & END_MASK)
 		{
-			if (mTypeMask & END_MASK)
+			if (s)
 			{
-				if (s)
-				{
-					ss = 1.f;
-				}
-				else
-				{
-					ss = 0.f;
-				}
+				ss = 1.f;
 			}
 			else
 			{
-				// Get s value for tex-coord.
-				if (!flat)
-				{
-					ss = profile[mBeginS + s][2];
-				}
-				else
-				{
-					ss = profile[mBeginS + s][2] - begin_stex;
-				}
-			}
-
-			if (sculpt_reverse_horizontal)
-			{
-				ss = 1.f - ss;
+				ss = 0.f;
 			}
-			
-			// Check to see if this triangle wraps around the array.
-			if (mBeginS + s >= max_s)
+		}
+		else
+		{
+			// Get s value for tex-coord.
+			if (!flat)
 			{
-				// We're wrapping
-				i = mBeginS + s + max_s*(t-1);
+				ss = profile[mBeginS + s][2];
 			}
 			else
 			{
-				i = mBeginS + s + max_s*t;
+				ss = profile[mBeginS + s][2] - begin_stex;
 			}
+		}
 
-			mesh[i].store4a((F32*)(pos+cur_vertex));
-			tc[cur_vertex].set(ss,tt);
-		
-			cur_vertex++;
+		if (sculpt_reverse_horizontal)
+		{
+			ss = 1.f - ss;
+		}
 
-			if (test && s > 0)
-			{
-				mesh[i].store4a((F32*)(pos+cur_vertex));
-				tc[cur_vertex].set(ss,tt);
-				cur_vertex++;
-			}
+		// Check to see if this triangle wraps around the array.
+		if (mBeginS + s >= max_s)
+		{
+			// We're wrapping
+			i = mBeginS + s - max_s;
 		}
-		
-		if ((mTypeMask & INNER_MASK) && (mTypeMask & FLAT_MASK) && mNumS > 2)
+		else
 		{
-			if (mTypeMask & OPEN_MASK)
-			{
-				s = num_s-1;
-			}
-			else
-			{
-				s = 0;
-			}
+			i = mBeginS + s;
+		}
 
-			i = mBeginS + s + max_s*t;
-			ss = profile[mBeginS + s][2] - begin_stex;
+		tc[mesh_offset.size()].mV[0] = ss;
+		mesh_offset.push_back(i);
 
-			mesh[i].store4a((F32*)(pos+cur_vertex));
-			tc[cur_vertex].set(ss,tt);
-			
-			cur_vertex++;
+		if (test && s > 0)
+		{
+			tc[mesh_offset.size()].mV[0] = ss;
+			mesh_offset.push_back(i);
 		}
 	}
+
+	if (test)
+	{
+		if (mTypeMask & OPEN_MASK)
+		{
+			s = num_s-1;
+		}
+		else
+		{
+			s = 0;
+		}
+
+		tc[mesh_offset.size()].mV[0] = profile[mBeginS + s][2] - begin_stex;
+		mesh_offset.push_back(mBeginS + s);
+	}
+
+	// Copy the vertices into the array
+	const S32 row_size = (S32)mesh_offset.size();
+	LLVector4a* dst_pos = pos;
+	LLVector2* dst_tc = tc;
+	for (t = mBeginT; t < end_t; t++)
+	{
+		tt = path_data[t].mTexT;
+		const LLVector4a* mesh_row = mesh.mArray + max_s*t;
+		for (s = 0; s < row_size; s++)
+		{
+			dst_pos[s] = mesh_row[mesh_offset[s]];
+			dst_tc[s].set(tc[s].mV[0], tt);
+		}
+		dst_pos += row_size;
+		dst_tc += row_size;
+	}
 	
 	mCenter->clear();
 
@@ -6465,63 +6654,59 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 	mCenter->setAdd(face_min, face_max);
 	mCenter->mul(0.5f);
 
-	S32 cur_index = 0;
-	S32 cur_edge = 0;
 	BOOL flat_face = mTypeMask & FLAT_MASK;
 
 	if (!partial_build)
 	{
-		// Now we generate the indices.
+		// Now we generate the indices, and for every triangle its neighbors
+		// (-1 for none) across its three edges.
+		const bool t_open = mNumT <= 3 || volume->getPath().isOpen() == TRUE;
+		const bool s_open = flat_face || volume->getProfile().isOpen() == TRUE;
+		const S32 row_tris = (mNumS-1)*2;
+		U16* dst_idx = mIndices;
+		S32* dst_edge = mEdge.empty() ? NULL : &mEdge[0];
 		for (t = 0; t < (mNumT-1); t++)
 		{
+			const S32 bottom = mNumS*t;
+			const S32 top = bottom + mNumS;
+			const S32 tri = row_tris*t;
+			// first triangle of the rows above and below, or -1 for none
+			const S32 tri_above = t < mNumT-2 ? tri + row_tris : (t_open ? -1 : 0);
+			const S32 tri_below = t > 0 ? tri - row_tris : (t_open ? -1 : row_tris*(mNumT-2));
+
 			for (s = 0; s < (mNumS-1); s++)
 			{	
-				mIndices[cur_index++] = s   + mNumS*t;			//bottom left
-				mIndices[cur_index++] = s+1 + mNumS*(t+1);		//top right
-				mIndices[cur_index++] = s   + mNumS*(t+1);		//top left
-				mIndices[cur_index++] = s   + mNumS*t;			//bottom left
-				mIndices[cur_index++] = s+1 + mNumS*t;			//bottom right
-				mIndices[cur_index++] = s+1 + mNumS*(t+1);		//top right
-
-				mEdge[cur_edge++] = (mNumS-1)*2*t+s*2+1;						//bottom left/top right neighbor face 
-				if (t < mNumT-2) {												//top right/top left neighbor face 
-					mEdge[cur_edge++] = (mNumS-1)*2*(t+1)+s*2+1;
-				}
-				else if (mNumT <= 3 || volume->getPath().isOpen() == TRUE) { //no neighbor
-					mEdge[cur_edge++] = -1;
-				}
-				else { //wrap on T
-					mEdge[cur_edge++] = s*2+1;
-				}
+				dst_idx[0] = s   + bottom;		//bottom left
+				dst_idx[1] = s+1 + top;			//top right
+				dst_idx[2] = s   + top;			//top left
+				dst_idx[3] = s   + bottom;		//bottom left
+				dst_idx[4] = s+1 + bottom;		//bottom right
+				dst_idx[5] = s+1 + top;			//top right
+				dst_idx += 6;
+
+				dst_edge[0] = tri+s*2+1;										//bottom left/top right neighbor face 
+				dst_edge[1] = tri_above < 0 ? -1 : tri_above+s*2+1;				//top right/top left neighbor face 
 				if (s > 0) {													//top left/bottom left neighbor face
-					mEdge[cur_edge++] = (mNumS-1)*2*t+s*2-1;
+					dst_edge[2] = tri+s*2-1;
 				}
-				else if (flat_face ||  volume->getProfile().isOpen() == TRUE) { //no neighbor
-					mEdge[cur_edge++] = -1;
+				else if (s_open) { //no neighbor
+					dst_edge[2] = -1;
 				}
 				else {	//wrap on S
-					mEdge[cur_edge++] = (mNumS-1)*2*t+(mNumS-2)*2+1;
-				}
-				
-				if (t > 0) {													//bottom left/bottom right neighbor face
-					mEdge[cur_edge++] = (mNumS-1)*2*(t-1)+s*2;
-				}
-				else if (mNumT <= 3 || volume->getPath().isOpen() == TRUE) { //no neighbor
-					mEdge[cur_edge++] = -1;
-				}
-				else { //wrap on T
-					mEdge[cur_edge++] = (mNumS-1)*2*(mNumT-2)+s*2;
+					dst_edge[2] = tri+(mNumS-2)*2+1;
 				}
+				dst_edge[3] = tri_below < 0 ? -1 : tri_below+s*2;				//bottom left/bottom right neighbor face
 				if (s < mNumS-2) {												//bottom right/top right neighbor face
-					mEdge[cur_edge++] = (mNumS-1)*2*t+(s+1)*2;
+					dst_edge[4] = tri+(s+1)*2;
 				}
-				else if (flat_face || volume->getProfile().isOpen() == TRUE) { //no neighbor
-					mEdge[cur_edge++] = -1;
+				else if (s_open) { //no neighbor
+					dst_edge[4] = -1;
 				}
 				else { //wrap on S
-					mEdge[cur_edge++] = (mNumS-1)*2*t;
+					dst_edge[4] = tri;
 				}
-				mEdge[cur_edge++] = (mNumS-1)*2*t+s*2;							//top right/bottom left neighbor face	
+				dst_edge[5] = tri+s*2;											//top right/bottom left neighbor face	
+				dst_edge += 6;
 			}
 		}
 	}
@@ -6538,19 +6723,14 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		dst += 4;
 	}
 
-	//generate normals 
+	//generate normals, adding the normal of every triangle to its corners
 	U32 count = mNumIndices/3;
 
 	LLVector4a* norm = mNormals;
 
-	static LLAlignedArray<LLVector4a, 64> triangle_normals;
-	triangle_normals.resize(count);
-	LLVector4a* output = triangle_normals.mArray;
-	LLVector4a* end_output = output+count;
-
 	U16* idx = mIndices;
 
-	while (output < end_output)
+	for (U32 i = 0; i < count; i++) //for each triangle
 	{
 		LLVector4a b,v1,v2;
 		b.load4a((F32*) (pos+idx[0]));
@@ -6586,23 +6766,8 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		// mQ = { 0, a[X]*b[Y] - a[Y]*b[X], a[Z]*b[X] - a[X]*b[Z], a[Y]*b[Z] - a[Z]*b[Y] }
 		vector1 = _mm_sub_ps( vector2, _mm_mul_ps( amQ, bmQ ));
 
-		llassert(v1.isFinite3());
-
-		v1.store4a((F32*) output);
-		
-		
-		output++;
-		idx += 3;
-	}
-
-	idx = mIndices;
-
-	LLVector4a* src = triangle_normals.mArray;
-	
-	for (U32 i = 0; i < count; i++) //for each triangle
-	{
-		LLVector4a c;
-		c.load4a((F32*) (src++));
+		const LLVector4a& c = v1;
+		llassert(c.isFinite3());
 
 		LLVector4a* n0p = norm+idx[0];
 		LLVector4a* n1p = norm+idx[1];
@@ -6619,8 +6784,6 @@ BOOL LLVolumeFace::createSide(LLVolume* volume, BOOL partial_build)
 		n1.add(c);
 		n2.add(c);
 
-		llassert(c.isFinite3());
-
 		//even out quad contributions
 		switch (i%2+1)
 		{
@@ -6793,16 +6956,11 @@ void CalculateTangentArray(U32 vertexCount, const LLVector4a *vertex, const LLVe
         const LLVector2& w2 = texcoord[i2];
         const LLVector2& w3 = texcoord[i3];
         
-		const F32* v1ptr = v1.getF32ptr();
-		const F32* v2ptr = v2.getF32ptr();
-		const F32* v3ptr = v3.getF32ptr();
-		
-        float x1 = v2ptr[0] - v1ptr[0];
-        float x2 = v3ptr[0] - v1ptr[0];
-        float y1 = v2ptr[1] - v1ptr[1];
-        float y2 = v3ptr[1] - v1ptr[1];
-        float z1 = v2ptr[2] - v1ptr[2];
-        float z2 = v3ptr[2] - v1ptr[2];
+		// Both edges at once, sdir and tdir work on all three axes in a
+		// vector each.
+		LLVector4a e1, e2;
+		e1.setSub(v2, v1);
+		e2.setSub(v3, v1);
         
         float s1 = w2.mV[0] - w1.mV[0];
         float s2 = w3.mV[0] - w1.mV[0];
@@ -6817,10 +6975,15 @@ void CalculateTangentArray(U32 vertexCount, const LLVector4a *vertex, const LLVe
 		llassert(llfinite(r));
 		llassert(!llisnan(r));
 
-		LLVector4a sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r,
-				(t2 * z1 - t1 * z2) * r);
-		LLVector4a tdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r,
-				(s1 * z2 - s2 * z1) * r);
+		LLVector4a sdir, tdir, tmp;
+		sdir.setMul(e1, t2);
+		tmp.setMul(e2, t1);
+		sdir.sub(tmp);
+		sdir.mul(r);
+		tdir.setMul(e2, s1);
+		tmp.setMul(e1, s2);
+		tdir.sub(tmp);
+		tdir.mul(r);
         
 		tan1[i1].add(sdir);
 		tan1[i2].add(sdir);
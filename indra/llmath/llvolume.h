@@ -58,6 +58,7 @@ class LLVolumeTriangle;
 #include "llpointer.h"
 #include "llfile.h"
 #include "llalignedarray.h"
+#include "llatomic.h"
 
 //============================================================================
 
@@ -1035,7 +1036,7 @@ public:
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static LLAtomicS32 sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -1062,6 +1063,13 @@ protected:
 public:
 	virtual bool unpackVolumeFaces(std::istream& is, S32 size);
 
+	// The faces as unpackVolumeFaces() leaves them, in a flat layout that
+	// unpackDecodedFaces() copies back without decoding anything. Every
+	// array starts on a 16 byte boundary of the block; data passed to
+	// unpackDecodedFaces() must be 16 byte aligned.
+	void packDecodedFaces(std::vector<U8>& data) const;
+	bool unpackDecodedFaces(const U8* data, U32 size);
+
 	virtual void setMeshAssetLoaded(BOOL loaded);
 	virtual BOOL isMeshAssetLoaded();
 
@@ -27,6 +27,8 @@
 
 #include "llvolumemgr.h"
 #include "llvolume.h"
+#include "llfasttimer.h"
+#include "llthreadpool.h"
 
 
 const F32 BASE_THRESHOLD = 0.03f;
@@ -40,11 +42,55 @@ F32 LLVolumeLODGroup::mDetailThresholds[NUM_LODS] = {BASE_THRESHOLD,
 //static
 F32 LLVolumeLODGroup::mDetailScales[NUM_LODS] = {1.f, 1.5f, 2.5f, 4.f};
 
+static LLFastTimer::DeclareTimer FTM_INSTALL_VOLUMES("Install Built Volumes");
+static LLFastTimer::DeclareTimer FTM_VOLUME_BUILD_WAIT("Volume Build Queue Wait");
+static LLFastTimer::DeclareTimer FTM_VOLUME_BUILD("Volume Build (Threads)");
+
+// Only these get all their faces when constructed: sculpties and meshes
+// get theirs from data that arrives later and flexies are unique.
+static bool can_build_elsewhere(const LLVolumeParams& volume_params)
+{
+	return volume_params.getSculptType() == LL_SCULPT_TYPE_NONE &&
+		   volume_params.getSculptID().isNull() &&
+		   volume_params.getPathParams().getCurveType() != LL_PCODE_PATH_FLEXIBLE;
+}
+
+class LLVolumeMgr::BuildTask : public LLThreadPool::Task
+{
+public:
+	BuildTask(LLVolumeMgr* mgr, const LLVolumeParams& volume_params, const S32 detail)
+		: mMgr(mgr)
+	{
+		mBuilt.mParams = volume_params;
+		mBuilt.mDetail = detail;
+		mBuilt.mVolume = NULL;
+	}
+
+	/*virtual*/ void run()
+	{
+		U32 start = LLFastTimer::getCPUClockCount32();
+		mBuilt.mVolume = new LLVolume(mBuilt.mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(mBuilt.mDetail));
+		U32 end = LLFastTimer::getCPUClockCount32();
+		mMgr->mBuiltVolumes->push(mBuilt, start - getQueuedClocks(), end - start);
+	}
+
+	/*virtual*/ void drop()
+	{
+		mMgr->mBuiltVolumes->push(mBuilt);
+	}
+
+private:
+	LLVolumeMgr* mMgr;
+	BuiltVolume mBuilt;
+};
+
 
 //============================================================================
 
 LLVolumeMgr::LLVolumeMgr()
-:	mDataMutex(NULL)
+:	mDataMutex(NULL),
+	mBuildPool(NULL),
+	mBuiltVolumes(NULL)
 {
 	// the LLMutex magic interferes with easy unit testing,
 	// so you now must manually call useMutex() to use it
@@ -57,10 +103,25 @@ LLVolumeMgr::~LLVolumeMgr()
 
 	delete mDataMutex;
 	mDataMutex = NULL;
+	delete mBuiltVolumes;
+	mBuiltVolumes = NULL;
 }
 
 BOOL LLVolumeMgr::cleanup()
 {
+	mBuildPool = NULL;
+	if (mBuiltVolumes)
+	{
+		// Builds still queued or running report back to this manager.
+		mBuiltVolumes->waitForAll();
+		std::vector<BuiltVolume> built;
+		mBuiltVolumes->take(built);
+		for (std::vector<BuiltVolume>::iterator iter = built.begin(); iter != built.end(); ++iter)
+		{
+			LLPointer<LLVolume> unused = iter->mVolume;
+		}
+	}
+
 	BOOL no_refs = TRUE;
 	if (mDataMutex)
 	{
@@ -89,7 +150,7 @@ BOOL LLVolumeMgr::cleanup()
 // Note however that LLVolumeLODGroup that contains the volume
 //  also holds a LLPointer so the volume will only go away after
 //  anything holding the volume and the LODGroup are destroyed
-LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32 detail)
+LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32 detail, bool allow_stand_in)
 {
 	LLVolumeLODGroup* volgroupp;
 	if (mDataMutex)
@@ -105,11 +166,99 @@ LLVolume* LLVolumeMgr::refVolume(const LLVolumeParams &volume_params, const S32
 	{
 		volgroupp = iter->second;
 	}
+	S32 lod = detail;
+	if (allow_stand_in && mBuildPool && detail > 0 && !volgroupp->hasLOD(detail) &&
+		can_build_elsewhere(volume_params))
+	{
+		if (!volgroupp->isLODPending(detail))
+		{
+			queueBuild(volgroupp, detail);
+		}
+		lod = volgroupp->getClosestLOD(detail);
+		if (lod < 0)
+		{
+			// Nothing to show yet; the lowest LOD is the cheapest to build here.
+			lod = 0;
+		}
+	}
+	if (mDataMutex)
+	{
+		mDataMutex->unlock();
+	}
+	return volgroupp->refLOD(lod);
+}
+
+bool LLVolumeMgr::isBuildPending(const LLVolumeParams& volume_params, const S32 detail) const
+{
+	LLVolumeLODGroup* volgroupp = getGroup(volume_params);
+	return volgroupp && volgroupp->isLODPending(detail);
+}
+
+void LLVolumeMgr::setBuildPool(LLThreadPool* pool)
+{
+	if (pool && !mBuiltVolumes)
+	{
+		mBuiltVolumes = new LLThreadPoolResults<BuiltVolume>;
+	}
+	mBuildPool = pool;
+	if (!pool && mBuiltVolumes)
+	{
+		// The old pool may go away after this, so let it finish the builds
+		// it still has and hand them to their groups.
+		mBuiltVolumes->waitForAll();
+		updateBuilds();
+	}
+}
+
+// protected, called with mDataMutex locked
+void LLVolumeMgr::queueBuild(LLVolumeLODGroup* volgroupp, const S32 detail)
+{
+	volgroupp->setLODPending(detail, true);
+	mBuiltVolumes->expect();
+	mBuildPool->post(new BuildTask(this, *volgroupp->getVolumeParams(), detail));
+}
+
+void LLVolumeMgr::updateBuilds()
+{
+	if (!mBuiltVolumes)
+	{
+		return;
+	}
+	LLFastTimer t(FTM_INSTALL_VOLUMES);
+
+	std::vector<BuiltVolume> built;
+	mBuiltVolumes->take(built, &FTM_VOLUME_BUILD_WAIT, &FTM_VOLUME_BUILD);
+	if (built.empty())
+	{
+		return;
+	}
+
+	if (mDataMutex)
+	{
+		mDataMutex->lock();
+	}
+	for (std::vector<BuiltVolume>::iterator iter = built.begin(); iter != built.end(); ++iter)
+	{
+		// The group may have gone when its last object did, or have built
+		// the LOD in place meanwhile.
+		volume_lod_group_map_t::iterator group_iter = mVolumeLODGroups.find(&iter->mParams);
+		if (group_iter != mVolumeLODGroups.end() && group_iter->second->isLODPending(iter->mDetail))
+		{
+			LLVolumeLODGroup* volgroupp = group_iter->second;
+			volgroupp->setLODPending(iter->mDetail, false);
+			if (iter->mVolume && !volgroupp->hasLOD(iter->mDetail))
+			{
+				volgroupp->setLOD(iter->mDetail, iter->mVolume);
+				continue;
+			}
+		}
+		// Taking the only reference deletes it again.
+		LLPointer<LLVolume> unused = iter->mVolume;
+	}
 	if (mDataMutex)
 	{
 		mDataMutex->unlock();
 	}
-	return volgroupp->refLOD(detail);
 }
 
 // virtual
@@ -253,6 +402,7 @@ LLVolumeLODGroup::LLVolumeLODGroup(const LLVolumeParams &params)
 	{
 		mLODRefs[i] = 0;
 		mAccessCount[i] = 0;
+		mLODPending[i] = false;
 	}
 }
 
@@ -301,6 +451,32 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 detail)
 	return mVolumeLODs[detail];
 }
 
+S32 LLVolumeLODGroup::getClosestLOD(const S32 detail) const
+{
+	if (mVolumeLODs[detail].notNull())
+	{
+		return detail;
+	}
+	for (S32 i = 1; i < NUM_LODS; i++)
+	{
+		if (detail + i < NUM_LODS && mVolumeLODs[detail + i].notNull())
+		{
+			return detail + i;
+		}
+		if (detail - i >= 0 && mVolumeLODs[detail - i].notNull())
+		{
+			return detail - i;
+		}
+	}
+	return -1;
+}
+
+void LLVolumeLODGroup::setLOD(const S32 detail, LLVolume* volumep)
+{
+	llassert(mVolumeLODs[detail].isNull());
+	mVolumeLODs[detail] = volumep;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -34,11 +34,14 @@
 #define LL_LLVOLUMEMGR_H
 
 #include <map>
+#include <vector>
 
 #include "llvolume.h"
 #include "llpointer.h"
 #include "llthread.h"
 
+class LLThreadPool;
+template<class T> class LLThreadPoolResults;
 class LLVolumeParams;
 class LLVolumeLODGroup;
 
@@ -64,6 +67,16 @@ public:
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
 	S32 getNumRefs() const { return mRefs; }
+
+	bool hasLOD(const S32 detail) const { return mVolumeLODs[detail].notNull(); }
+	// The existing LOD closest to detail, preferring the higher one, or -1.
+	S32 getClosestLOD(const S32 detail) const;
+
+	// Set while detail is being built on another thread.
+	bool isLODPending(const S32 detail) const { return mLODPending[detail]; }
+	void setLODPending(const S32 detail, bool pending) { mLODPending[detail] = pending; }
+	// Installs a volume that was built on another thread.
+	void setLOD(const S32 detail, LLVolume* volumep);
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
 
@@ -79,6 +92,7 @@ protected:
 	static F32 mDetailThresholds[NUM_LODS];
 	static F32 mDetailScales[NUM_LODS];
 	S32		mAccessCount[NUM_LODS];
+	bool	mLODPending[NUM_LODS];
 };
 
 class LLVolumeMgr
@@ -93,9 +107,24 @@ public:
 	// whatever calls getVolume() never owns the LLVolume* and
 	// cannot keep references for long since it may be deleted
 	// later.  For best results hold it in an LLPointer<LLVolume>.
-	virtual LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail);
+	//
+	// With allow_stand_in, a missing LOD of a plain prim is built on the
+	// build pool and another LOD of the same shape is returned meanwhile;
+	// check the detail of the result and ask again once isBuildPending()
+	// is false.
+	virtual LLVolume *refVolume(const LLVolumeParams &volume_params, const S32 detail, bool allow_stand_in = false);
 	virtual void unrefVolume(LLVolume *volumep);
 
+	// Builds requested with allow_stand_in run on pool, or in place when
+	// NULL. Like useMutex(), this must be called manually, once pool
+	// exists. Setting NULL waits for the builds still on the old pool, so
+	// do that before the pool is destroyed.
+	void setBuildPool(LLThreadPool* pool);
+	bool isBuildPending(const LLVolumeParams& volume_params, const S32 detail) const;
+	// Hands the volumes built since the last call to their groups. Call
+	// once a frame from the main thread.
+	void updateBuilds();
+
 	void dump();
 
 	// manually call this for mutex magic
@@ -113,6 +142,24 @@ protected:
 	volume_lod_group_map_t mVolumeLODGroups;
 
 	LLMutex* mDataMutex;
+
+private:
+	class BuildTask;
+	friend class BuildTask;
+
+	struct BuiltVolume
+	{
+		LLVolumeParams mParams;
+		S32 mDetail;
+		LLVolume* mVolume;		// NULL when the build was dropped
+	};
+
+	void queueBuild(LLVolumeLODGroup* volgroupp, const S32 detail);
+
+	LLThreadPool* mBuildPool;
+
+	// Builds handed back by the pool, NULL until there is a pool.
+	LLThreadPoolResults<BuiltVolume>* mBuiltVolumes;
 };
 
 #endif // LL_LLVOLUMEMGR_H
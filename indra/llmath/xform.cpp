@@ -31,6 +31,7 @@
 
 #include "linden_common.h"
 
+#include "llmath.h"
 #include "xform.h"
 
 LLXform::LLXform()
@@ -118,6 +119,140 @@ void LLXformMatrix::updateMatrix(BOOL update_bounds)
 	}
 }
 
+// static
+void LLXformMatrix::updateMatrices(LLXformMatrix** xforms, U32 count)
+{
+	U32 i = 0;
+	for ( ; i + 4 <= count; i += 4)
+	{
+		updateMatrices4(xforms + i);
+	}
+	for ( ; i < count; ++i)
+	{
+		xforms[i]->updateMatrix(FALSE);
+	}
+}
+
+// Lanes hold one xform each. The operations are done in the same order as
+// in update() and LLMatrix4::initAll() so that the results are the same.
+// static
+void LLXformMatrix::updateMatrices4(LLXformMatrix** xforms)
+{
+	LLXformMatrix* x0 = xforms[0];
+	LLXformMatrix* x1 = xforms[1];
+	LLXformMatrix* x2 = xforms[2];
+	LLXformMatrix* x3 = xforms[3];
+	LLXform* p0 = x0->mParent;
+	LLXform* p1 = x1->mParent;
+	LLXform* p2 = x2->mParent;
+	LLXform* p3 = x3->mParent;
+
+	const LLQuad sign = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const LLQuad one = _mm_set1_ps(1.f);
+	const LLQuad two = _mm_set1_ps(2.f);
+
+	// local position, scaled by the parent when it asks for it
+	LLQuad px = _mm_setr_ps(x0->mPosition.mV[VX], x1->mPosition.mV[VX], x2->mPosition.mV[VX], x3->mPosition.mV[VX]);
+	LLQuad py = _mm_setr_ps(x0->mPosition.mV[VY], x1->mPosition.mV[VY], x2->mPosition.mV[VY], x3->mPosition.mV[VY]);
+	LLQuad pz = _mm_setr_ps(x0->mPosition.mV[VZ], x1->mPosition.mV[VZ], x2->mPosition.mV[VZ], x3->mPosition.mV[VZ]);
+	if (p0->getScaleChildOffset() || p1->getScaleChildOffset() || p2->getScaleChildOffset() || p3->getScaleChildOffset())
+	{
+		const LLVector3 unit(1.f, 1.f, 1.f);
+		const LLVector3& s0 = p0->getScaleChildOffset() ? p0->getScale() : unit;
+		const LLVector3& s1 = p1->getScaleChildOffset() ? p1->getScale() : unit;
+		const LLVector3& s2 = p2->getScaleChildOffset() ? p2->getScale() : unit;
+		const LLVector3& s3 = p3->getScaleChildOffset() ? p3->getScale() : unit;
+		px = _mm_mul_ps(px, _mm_setr_ps(s0.mV[VX], s1.mV[VX], s2.mV[VX], s3.mV[VX]));
+		py = _mm_mul_ps(py, _mm_setr_ps(s0.mV[VY], s1.mV[VY], s2.mV[VY], s3.mV[VY]));
+		pz = _mm_mul_ps(pz, _mm_setr_ps(s0.mV[VZ], s1.mV[VZ], s2.mV[VZ], s3.mV[VZ]));
+	}
+
+	// parent world rotation
+	const LLQuad bx = _mm_setr_ps(p0->getWorldRotation().mQ[VX], p1->getWorldRotation().mQ[VX], p2->getWorldRotation().mQ[VX], p3->getWorldRotation().mQ[VX]);
+	const LLQuad by = _mm_setr_ps(p0->getWorldRotation().mQ[VY], p1->getWorldRotation().mQ[VY], p2->getWorldRotation().mQ[VY], p3->getWorldRotation().mQ[VY]);
+	const LLQuad bz = _mm_setr_ps(p0->getWorldRotation().mQ[VZ], p1->getWorldRotation().mQ[VZ], p2->getWorldRotation().mQ[VZ], p3->getWorldRotation().mQ[VZ]);
+	const LLQuad bw = _mm_setr_ps(p0->getWorldRotation().mQ[VW], p1->getWorldRotation().mQ[VW], p2->getWorldRotation().mQ[VW], p3->getWorldRotation().mQ[VW]);
+
+	// world position = position * parent world rotation + parent world position
+	const LLQuad rw = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_xor_ps(bx, sign), px), _mm_mul_ps(by, py)), _mm_mul_ps(bz, pz));
+	const LLQuad rx = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(bw, px), _mm_mul_ps(by, pz)), _mm_mul_ps(bz, py));
+	const LLQuad ry = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(bw, py), _mm_mul_ps(bz, px)), _mm_mul_ps(bx, pz));
+	const LLQuad rz = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(bw, pz), _mm_mul_ps(bx, py)), _mm_mul_ps(by, px));
+	const LLQuad nrw = _mm_xor_ps(rw, sign);
+	LLQuad wpx = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(nrw, bx), _mm_mul_ps(rx, bw)), _mm_mul_ps(ry, bz)), _mm_mul_ps(rz, by));
+	LLQuad wpy = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(nrw, by), _mm_mul_ps(ry, bw)), _mm_mul_ps(rz, bx)), _mm_mul_ps(rx, bz));
+	LLQuad wpz = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(nrw, bz), _mm_mul_ps(rz, bw)), _mm_mul_ps(rx, by)), _mm_mul_ps(ry, bx));
+	wpx = _mm_add_ps(wpx, _mm_setr_ps(p0->getWorldPosition().mV[VX], p1->getWorldPosition().mV[VX], p2->getWorldPosition().mV[VX], p3->getWorldPosition().mV[VX]));
+	wpy = _mm_add_ps(wpy, _mm_setr_ps(p0->getWorldPosition().mV[VY], p1->getWorldPosition().mV[VY], p2->getWorldPosition().mV[VY], p3->getWorldPosition().mV[VY]));
+	wpz = _mm_add_ps(wpz, _mm_setr_ps(p0->getWorldPosition().mV[VZ], p1->getWorldPosition().mV[VZ], p2->getWorldPosition().mV[VZ], p3->getWorldPosition().mV[VZ]));
+
+	// world rotation = rotation * parent world rotation
+	const LLQuad ax = _mm_setr_ps(x0->mRotation.mQ[VX], x1->mRotation.mQ[VX], x2->mRotation.mQ[VX], x3->mRotation.mQ[VX]);
+	const LLQuad ay = _mm_setr_ps(x0->mRotation.mQ[VY], x1->mRotation.mQ[VY], x2->mRotation.mQ[VY], x3->mRotation.mQ[VY]);
+	const LLQuad az = _mm_setr_ps(x0->mRotation.mQ[VZ], x1->mRotation.mQ[VZ], x2->mRotation.mQ[VZ], x3->mRotation.mQ[VZ]);
+	const LLQuad aw = _mm_setr_ps(x0->mRotation.mQ[VW], x1->mRotation.mQ[VW], x2->mRotation.mQ[VW], x3->mRotation.mQ[VW]);
+	const LLQuad qx = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bw, ax), _mm_mul_ps(bx, aw)), _mm_mul_ps(by, az)), _mm_mul_ps(bz, ay));
+	const LLQuad qy = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bw, ay), _mm_mul_ps(by, aw)), _mm_mul_ps(bz, ax)), _mm_mul_ps(bx, az));
+	const LLQuad qz = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bw, az), _mm_mul_ps(bz, aw)), _mm_mul_ps(bx, ay)), _mm_mul_ps(by, ax));
+	const LLQuad qw = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(bw, aw), _mm_mul_ps(bx, ax)), _mm_mul_ps(by, ay)), _mm_mul_ps(bz, az));
+
+	// world matrix from scale, world rotation and world position
+	const LLQuad sx = _mm_setr_ps(x0->mScale.mV[VX], x1->mScale.mV[VX], x2->mScale.mV[VX], x3->mScale.mV[VX]);
+	const LLQuad sy = _mm_setr_ps(x0->mScale.mV[VY], x1->mScale.mV[VY], x2->mScale.mV[VY], x3->mScale.mV[VY]);
+	const LLQuad sz = _mm_setr_ps(x0->mScale.mV[VZ], x1->mScale.mV[VZ], x2->mScale.mV[VZ], x3->mScale.mV[VZ]);
+	const LLQuad xx = _mm_mul_ps(qx, qx);
+	const LLQuad xy = _mm_mul_ps(qx, qy);
+	const LLQuad xz = _mm_mul_ps(qx, qz);
+	const LLQuad xw = _mm_mul_ps(qx, qw);
+	const LLQuad yy = _mm_mul_ps(qy, qy);
+	const LLQuad yz = _mm_mul_ps(qy, qz);
+	const LLQuad yw = _mm_mul_ps(qy, qw);
+	const LLQuad zz = _mm_mul_ps(qz, qz);
+	const LLQuad zw = _mm_mul_ps(qz, qw);
+
+	LL_ALIGN_16(F32 out[16][4]);
+	_mm_store_ps(out[0], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx));
+	_mm_store_ps(out[1], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, zw)), sx));
+	_mm_store_ps(out[2], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, yw)), sx));
+	_mm_store_ps(out[3], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, zw)), sy));
+	_mm_store_ps(out[4], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy));
+	_mm_store_ps(out[5], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, xw)), sy));
+	_mm_store_ps(out[6], _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, yw)), sz));
+	_mm_store_ps(out[7], _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, xw)), sz));
+	_mm_store_ps(out[8], _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz));
+	_mm_store_ps(out[9], wpx);
+	_mm_store_ps(out[10], wpy);
+	_mm_store_ps(out[11], wpz);
+	_mm_store_ps(out[12], qx);
+	_mm_store_ps(out[13], qy);
+	_mm_store_ps(out[14], qz);
+	_mm_store_ps(out[15], qw);
+
+	for (U32 i = 0; i < 4; ++i)
+	{
+		LLXformMatrix* xform = xforms[i];
+		xform->mWorldPosition.setVec(out[9][i], out[10][i], out[11][i]);
+		xform->mWorldRotation.mQ[VX] = out[12][i];
+		xform->mWorldRotation.mQ[VY] = out[13][i];
+		xform->mWorldRotation.mQ[VZ] = out[14][i];
+		xform->mWorldRotation.mQ[VW] = out[15][i];
+		F32 (*m)[4] = xform->mWorldMatrix.mMatrix;
+		m[0][0] = out[0][i];
+		m[0][1] = out[1][i];
+		m[0][2] = out[2][i];
+		m[1][0] = out[3][i];
+		m[1][1] = out[4][i];
+		m[1][2] = out[5][i];
+		m[2][0] = out[6][i];
+		m[2][1] = out[7][i];
+		m[2][2] = out[8][i];
+		m[3][0] = out[9][i];
+		m[3][1] = out[10][i];
+		m[3][2] = out[11][i];
+		m[3][3] = 1.f;
+	}
+}
+
 void LLXformMatrix::getMinMax(LLVector3& min, LLVector3& max) const
 {
 	min = mMin;
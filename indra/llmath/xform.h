@@ -152,6 +152,14 @@ public:
 	void updateMatrix(BOOL update_bounds = TRUE);
 	void getMinMax(LLVector3& min,LLVector3& max) const;
 
+	// Same as updateMatrix(FALSE) on every xform, four at a time with SSE.
+	// Every xform must have a parent that is up to date and that is not
+	// in the same batch.
+	static void updateMatrices(LLXformMatrix** xforms, U32 count);
+
+private:
+	static void updateMatrices4(LLXformMatrix** xforms);
+
 protected:
 	LLMatrix4	mWorldMatrix;
 	LLVector3	mMin;
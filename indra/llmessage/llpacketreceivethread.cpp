@@ -0,0 +1,244 @@
+/**
+ * @file llpacketreceivethread.cpp
+ * @brief Receives and prepares UDP packets off the main thread.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#if LL_WINDOWS
+	#include <winsock2.h>
+#else
+	#include <netinet/in.h>
+#endif
+
+#include "llproxy.h"
+#include "lltimer.h"
+#include "message.h"
+
+// How long the thread blocks waiting for a packet before looking whether
+// it should quit.
+static const S32 RECEIVE_WAIT_MS = 10;
+// Datagrams asked for per system call.
+static const S32 RECEIVE_BATCH = 32;
+
+void LLReceivedPacket::prepare(const U8* raw, S32 raw_size)
+{
+	mTrueSize = raw_size;
+	mSize = raw_size;
+	mCompressedSize = 0;
+	mMalformed = false;
+	mExpandOverflow = false;
+	mAckCount = 0;
+
+	if (raw_size < (S32)LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		memcpy(mData, raw, llmax(raw_size, 0));
+		return;
+	}
+
+	S32 size = raw_size;
+	if (raw[0] & LL_ACK_FLAG)
+	{
+		mAckCount = raw[--size];
+		mSize = size;
+		if (size < (S32)(mAckCount * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE))
+		{
+			mMalformed = true;
+			return;
+		}
+
+		// last to first, the order they were always acked in
+		S32 pos = size;
+		for (S32 i = 0; i < mAckCount; ++i)
+		{
+			pos -= sizeof(TPACKETID);
+			TPACKETID packet_id;
+			memcpy(&packet_id, raw + pos, sizeof(TPACKETID));	/* Flawfinder: ignore */
+			mAcks[i] = ntohl(packet_id);
+		}
+		size = pos;
+	}
+
+	if (raw[0] & LL_ZERO_CODE_FLAG)
+	{
+		mCompressedSize = size;
+		mSize = LLMessageSystem::zeroCodeExpand(raw, size, mData, mExpandOverflow);
+	}
+	else
+	{
+		memcpy(mData, raw, size);	/* Flawfinder: ignore */
+		mSize = size;
+	}
+}
+
+void LLReceivedPacket::copy(const LLReceivedPacket& packet)
+{
+	mSender = packet.mSender;
+	mReceivingIF = packet.mReceivingIF;
+	mTrueSize = packet.mTrueSize;
+	mSize = packet.mSize;
+	mCompressedSize = packet.mCompressedSize;
+	mMalformed = packet.mMalformed;
+	mExpandOverflow = packet.mExpandOverflow;
+	mReceivedTime = packet.mReceivedTime;
+	mAckCount = packet.mAckCount;
+	if (!mMalformed)
+	{
+		memcpy(mAcks, packet.mAcks, mAckCount * sizeof(TPACKETID));	/* Flawfinder: ignore */
+	}
+	memcpy(mData, packet.mData, llmax(mSize, 0));	/* Flawfinder: ignore */
+}
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket, U32 ring_size) :
+	LLThread("Packet receive"),
+	mSocket(socket),
+	mWritten(0),
+	mRead(0),
+	mUnwrapSOCKS(0),
+	mDropped(0),
+	mDroppedSampled(0),
+	mPopped(0),
+	mWaitTotal(0),
+	mWaitMax(0)
+{
+	U32 size = 1;
+	while (size < ring_size)
+	{
+		size <<= 1;
+	}
+	mRing.resize(size);
+	mRingMask = size - 1;
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	shutdown();
+}
+
+void LLPacketReceiveThread::run()
+{
+	std::vector<char> buffers(RECEIVE_BATCH * NET_BUFFER_SIZE);
+	LLNetDatagram datagrams[RECEIVE_BATCH];
+	for (S32 i = 0; i < RECEIVE_BATCH; ++i)
+	{
+		datagrams[i].mData = &buffers[i * NET_BUFFER_SIZE];
+	}
+
+	while (!isQuitting())
+	{
+		if (!wait_for_packet(mSocket, RECEIVE_WAIT_MS))
+		{
+			continue;
+		}
+
+		// drain the socket
+		S32 count;
+		do
+		{
+			count = receive_packets(mSocket, datagrams, RECEIVE_BATCH);
+			U64 now = totalTime();
+			bool unwrap_socks = mUnwrapSOCKS;
+			for (S32 i = 0; i < count; ++i)
+			{
+				push(datagrams[i], now, unwrap_socks);
+			}
+		}
+		while (count == RECEIVE_BATCH && !isQuitting());
+	}
+}
+
+void LLPacketReceiveThread::push(const LLNetDatagram& datagram, U64 now, bool unwrap_socks)
+{
+	U32 written = mWritten;
+	if (written - (U32)mRead > mRingMask)
+	{
+		mDropped++;
+		return;
+	}
+
+	LLReceivedPacket& packet = mRing[written & mRingMask];
+	const U8* raw = (const U8*)datagram.mData;
+	S32 raw_size = datagram.mSize;
+	if (unwrap_socks)
+	{
+		if (raw_size <= (S32)SOCKS_HEADER_SIZE)
+		{
+			return;
+		}
+		// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+		const proxywrap_t* header = (const proxywrap_t*)raw;
+		packet.mSender.setAddress(header->addr);
+		packet.mSender.setPort(ntohs(header->port));
+		raw += SOCKS_HEADER_SIZE;
+		raw_size -= SOCKS_HEADER_SIZE;
+	}
+	else
+	{
+		packet.mSender.setAddress(datagram.mSenderIP);
+		packet.mSender.setPort(datagram.mSenderPort);
+	}
+	packet.mReceivingIF.setAddress(datagram.mReceivingIP);
+	packet.mReceivingIF.setPort(INVALID_PORT);
+	packet.mReceivedTime = now;
+	packet.prepare(raw, raw_size);
+
+	// The increment is a full barrier, the packet is complete before the
+	// main thread can see it.
+	mWritten += 1;
+}
+
+bool LLPacketReceiveThread::popPacket(LLReceivedPacket& packet)
+{
+	U32 read = mRead;
+	if (read == (U32)mWritten)
+	{
+		return false;
+	}
+
+	const LLReceivedPacket& queued = mRing[read & mRingMask];
+	packet.copy(queued);
+	// hand the slot back
+	mRead += 1;
+
+	U64 wait = totalTime() - packet.mReceivedTime;
+	mWaitTotal += wait;
+	mWaitMax = llmax(mWaitMax, wait);
+	++mPopped;
+	return true;
+}
+
+void LLPacketReceiveThread::sampleStats(U32& dropped, U32& received, F32& average_wait_ms, F32& max_wait_ms)
+{
+	U32 dropped_total = mDropped;
+	dropped = dropped_total - mDroppedSampled;
+	mDroppedSampled = dropped_total;
+	received = mPopped;
+	average_wait_ms = mPopped ? (F32)((F64)mWaitTotal / mPopped / 1000.0) : 0.f;
+	max_wait_ms = (F32)((F64)mWaitMax / 1000.0);
+	mPopped = 0;
+	mWaitTotal = 0;
+	mWaitMax = 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file llpacketreceivethread.h
+ * @brief Receives and prepares UDP packets off the main thread.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include <vector>
+
+#include "llatomic.h"
+#include "llhost.h"
+#include "llthread.h"
+#include "net.h"
+
+// A packet the way LLMessageSystem::checkMessages() wants it: the acks
+// appended to it taken off and the rest zero code expanded.
+struct LLReceivedPacket
+{
+	LLHost mSender;
+	LLHost mReceivingIF;
+	S32 mTrueSize;			// as it came off the wire
+	S32 mSize;				// of mData
+	S32 mCompressedSize;	// before zero code expansion, 0 if it wasn't zero coded
+	bool mMalformed;		// claims more acks than it has room for
+	bool mExpandOverflow;	// expanded past NET_BUFFER_SIZE
+	U64 mReceivedTime;		// totalTime() it was received at
+	S32 mAckCount;
+	TPACKETID mAcks[255];	// host order
+	U8 mData[NET_BUFFER_SIZE];
+
+	// Everything but the hosts and the time, from a raw datagram. Packets
+	// too short to be valid are copied as they are.
+	void prepare(const U8* raw, S32 raw_size);
+	// Copies only what is used of the arrays.
+	void copy(const LLReceivedPacket& packet);
+};
+
+// Drains the message system socket as packets arrive, prepares them and
+// queues them for the main thread on a single producer, single consumer
+// ring. When the main thread falls behind and the ring fills up, packets
+// are dropped and counted rather than left to overflow the socket buffer;
+// reliable ones get resent.
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	// ring_size is rounded up to a power of two.
+	LLPacketReceiveThread(S32 socket, U32 ring_size = 256);
+	/*virtual*/ ~LLPacketReceiveThread();
+
+	// Main thread only. Copies the oldest packet into packet, returns false
+	// when there is none.
+	bool popPacket(LLReceivedPacket& packet);
+
+	// Main thread only, LLProxy can't be asked from here.
+	void setUnwrapSOCKS(bool unwrap)	{ mUnwrapSOCKS = unwrap ? 1 : 0; }
+
+	// Main thread only. Packets dropped on a full ring and the time packets
+	// waited in it, since the last call.
+	void sampleStats(U32& dropped, U32& received, F32& average_wait_ms, F32& max_wait_ms);
+
+protected:
+	/*virtual*/ void run();
+
+private:
+	void push(const LLNetDatagram& datagram, U64 now, bool unwrap_socks);
+
+	S32 mSocket;
+	std::vector<LLReceivedPacket> mRing;
+	U32 mRingMask;
+	LLAtomicU32 mWritten;		// only the thread adds to this
+	LLAtomicU32 mRead;			// only the main thread adds to this
+	LLAtomicU32 mUnwrapSOCKS;
+	LLAtomicU32 mDropped;
+
+	// main thread
+	U32 mDroppedSampled;
+	U32 mPopped;
+	U64 mWaitTotal;
+	U64 mWaitMax;
+};
+
+#endif // LL_LLPACKETRECEIVETHREAD_H
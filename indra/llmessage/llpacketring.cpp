@@ -257,24 +257,30 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 
 		mLastReceivingIF = ::get_receiving_interface();
 
-		if (packet_size)  // did we actually get a packet?
+		if (packet_size && dropReceivedPacket())  // did we actually get a packet?
 		{
-			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
-			{
-				mPacketsToDrop++;
-			}
-
-			if (mPacketsToDrop)
-			{
-				packet_size = 0;
-				mPacketsToDrop--;
-			}
+			packet_size = 0;
 		}
 	}
 
 	return packet_size;
 }
 
+BOOL LLPacketRing::dropReceivedPacket()
+{
+	if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
+	{
+		mPacketsToDrop++;
+	}
+
+	if (mPacketsToDrop)
+	{
+		mPacketsToDrop--;
+		return TRUE;
+	}
+	return FALSE;
+}
+
 BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host)
 {	
 	//<edit>
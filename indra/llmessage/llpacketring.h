@@ -51,6 +51,9 @@ public:
 	void setInBandwidth(const F32 bps);
 	void setOutBandwidth(const F32 bps);
 	S32  receivePacket (S32 socket, char *datap);
+	// Simulated packet loss for packets received elsewhere, TRUE when this
+	// one is to be dropped.
+	BOOL dropReceivedPacket();
 	S32  receiveFromRing (S32 socket, char *datap);
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
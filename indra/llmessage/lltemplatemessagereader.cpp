@@ -42,7 +42,7 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
-	mCurrentRMessageData(NULL),
+	mDecoded(false),
 	mMessageNumbers(number_template_map)
 {
 }
@@ -50,8 +50,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 //virtual 
 LLTemplateMessageReader::~LLTemplateMessageReader()
 {
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
 }
 
 //virtual
@@ -59,8 +57,89 @@ void LLTemplateMessageReader::clearMessage()
 {
 	mReceiveSize = -1;
 	mCurrentRMessageTemplate = NULL;
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
+	mDecoded = false;
+	// clear() keeps the capacity for the next message
+	mReceiveBuffer.clear();
+	mReadBlocks.clear();
+	mReadVars.clear();
+}
+
+S32 LLTemplateMessageReader::findBlock(const char* blockname) const
+{
+	const LLMessageTemplate::message_block_map_t& blocks = mCurrentRMessageTemplate->mMemberBlocks;
+	LLMessageTemplate::message_block_map_t::const_iterator iter = blocks.find((char*)blockname);
+	if (iter == blocks.end())
+	{
+		return -1;
+	}
+	return (S32)(iter - blocks.begin());
+}
+
+//static
+S32 LLTemplateMessageReader::findVariable(const LLMessageBlock* block, const char* varname)
+{
+	LLMessageBlock::message_variable_map_t::const_iterator iter = block->mMemberVariables.find(varname);
+	if (iter == block->mMemberVariables.end())
+	{
+		return -1;
+	}
+	return (S32)(iter - block->mMemberVariables.begin());
+}
+
+void LLTemplateMessageReader::copyReadVar(const ReadVar& var, const char* varname,
+										  void* datap, S32 size, S32 max_size) const
+{
+	if (size && size != var.mSize)
+	{
+		llerrs << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << var.mSize
+			<< " but copying into buffer of size " << size
+			<< llendl;
+		return;
+	}
+
+	if (!var.mSize)
+	{
+		return;
+	}
+
+	const U8* src = &mReceiveBuffer[0] + var.mOffset;
+	S32 copy_size = var.mSize;
+	if (max_size < copy_size)
+	{
+		llwarns << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << var.mSize
+			<< " but truncated to max size of " << max_size
+			<< llendl;
+		copy_size = max_size;
+	}
+
+#if LL_BIG_ENDIAN
+	htonmemcpy(datap, src, var.mType, copy_size);
+#else
+	// The packet is in network order, which is ours. Fixed sizes so that
+	// the compiler turns these into single unaligned loads.
+	switch (copy_size)
+	{
+	case 1:
+		*((U8*)datap) = *src;
+		break;
+	case 2:
+		memcpy(datap, src, 2);
+		break;
+	case 4:
+		memcpy(datap, src, 4);
+		break;
+	case 8:
+		memcpy(datap, src, 8);
+		break;
+	default:
+		memcpy(datap, src, copy_size);
+		break;
+	}
+#endif
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -72,78 +151,97 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mDecoded)
 	{
 		llerrs << "Invalid mCurrentMessageData in getData!" << llendl;
 		return;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || blocknum < 0 || blocknum >= mReadBlocks[block].mCount)
 	{
 		llerrs << "Block " << blockname << " #" << blocknum
-			<< " not in message " << mCurrentRMessageData->mName << llendl;
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
 		return;
 	}
 
-	LLMsgBlkData *msg_block_data = iter->second;
-	LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+	S32 var = findVariable(mCurrentRMessageTemplate->mMemberBlocks.begin()[block], varname);
+	if (var < 0)
+	{
+		llerrs << "Variable "<< varname << " not in message "
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
+		return;
+	}
+
+	copyReadVar(getReadVar(block, var, blocknum), varname, datap, size, max_size);
+}
 
-	if (!vardata.getName())
+bool LLTemplateMessageReader::resolveField(LLMessageField& field)
+{
+	if (field.mTemplate != mCurrentRMessageTemplate)
+	{
+		field.mTemplate = mCurrentRMessageTemplate;
+		field.mBlockIndex = findBlock(field.mBlock);
+		field.mVarIndex = -1;
+		if (field.mBlockIndex >= 0)
+		{
+			const LLMessageBlock* block = mCurrentRMessageTemplate->mMemberBlocks.begin()[field.mBlockIndex];
+			field.mVarIndex = findVariable(block, field.mVar);
+		}
+	}
+	return field.mVarIndex >= 0;
+}
+
+void LLTemplateMessageReader::getFieldData(LLMessageField& field, void *datap, S32 size,
+										   S32 blocknum, S32 max_size)
+{
+	if (mReceiveSize == -1 || !mDecoded)
 	{
-		llerrs << "Variable "<< vnamep << " not in message "
-			<< mCurrentRMessageData->mName<< " block " << bnamep << llendl;
+		llerrs << "No message waiting for decode of " << field.mBlock << " " << field.mVar << llendl;
 		return;
 	}
 
-	if (size && size != vardata.getSize())
+	if (!resolveField(field))
 	{
-		llerrs << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
-			<< " but copying into buffer of size " << size
-			<< llendl;
+		llerrs << "Variable " << field.mVar << " of block " << field.mBlock
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
 		return;
 	}
 
+	if (blocknum < 0 || blocknum >= mReadBlocks[field.mBlockIndex].mCount)
+	{
+		llerrs << "Block " << field.mBlock << " #" << blocknum
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
+		return;
+	}
 
-	const S32 vardata_size = vardata.getSize();
-	if( max_size >= vardata_size )
-	{   
-		switch( vardata_size )
-		{ 
-		case 1:
-			*((U8*)datap) = *((U8*)vardata.getData());
-			break;
-		case 2:
-			*((U16*)datap) = *((U16*)vardata.getData());
-			break;
-		case 4:
-			*((U32*)datap) = *((U32*)vardata.getData());
-			break;
-		case 8:
-			((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-			((U32*)datap)[1] = ((U32*)vardata.getData())[1];
-			break;
-		default:
-			memcpy(datap, vardata.getData(), vardata_size);
-			break;
-		}
+	copyReadVar(getReadVar(field.mBlockIndex, field.mVarIndex, blocknum),
+				field.mVar, datap, size, max_size);
+}
+
+S32 LLTemplateMessageReader::getFieldSize(LLMessageField& field, S32 blocknum)
+{
+	if (mReceiveSize == -1 || !mDecoded)
+	{	// This is a serious error - crash
+		llerrs << "No message waiting for decode of " << field.mBlock << " " << field.mVar << llendl;
+		return LL_MESSAGE_ERROR;
 	}
-	else
-	{
-		llwarns << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
-			<< " but truncated to max size of " << max_size
-			<< llendl;
 
-		memcpy(datap, vardata.getData(), max_size);
+	if (!resolveField(field))
+	{	// don't crash
+		llinfos << "Variable " << field.mVar << " of block " << field.mBlock
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
+		return field.mBlockIndex < 0 ? LL_BLOCK_NOT_IN_MESSAGE : LL_VARIABLE_NOT_IN_BLOCK;
 	}
+
+	if (blocknum < 0 || blocknum >= mReadBlocks[field.mBlockIndex].mCount)
+	{	// don't crash
+		llinfos << "Block " << field.mBlock << " #" << blocknum << " not in message "
+			<< mCurrentRMessageTemplate->mName << llendl;
+		return LL_BLOCK_NOT_IN_MESSAGE;
+	}
+
+	return getReadVar(field.mBlockIndex, field.mVarIndex, blocknum).mSize;
 }
 
 S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
@@ -155,22 +253,19 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mDecoded)
 	{
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
 		return -1;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0)
 	{
 		return 0;
 	}
 
-	return (iter->second)->mBlockNumber;
+	return mReadBlocks[block].mCount;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -182,43 +277,37 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mDecoded)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || !mReadBlocks[block].mCount)
 	{	// don't crash
-		llinfos << "Block " << bnamep << " not in message "
-			<< mCurrentRMessageData->mName << llendl;
+		llinfos << "Block " << blockname << " not in message "
+			<< mCurrentRMessageTemplate->mName << llendl;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	char *vnamep = (char *)varname; 
-
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	const LLMessageBlock* template_block = mCurrentRMessageTemplate->mMemberBlocks.begin()[block];
+	S32 var = findVariable(template_block, varname);
+	if (var < 0)
 	{	// don't crash
 		llinfos << "Variable " << varname << " not in message "
-			<< mCurrentRMessageData->mName << " block " << bnamep << llendl;
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+	if (template_block->mType != MBT_SINGLE)
 	{	// This is a serious error - crash
-		llerrs << "Block " << bnamep << " isn't type MBT_SINGLE,"
+		llerrs << "Block " << blockname << " isn't type MBT_SINGLE,"
 			" use getSize with blocknum argument!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	return vardata.getSize();
+	return getReadVar(block, var, 0).mSize;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -230,35 +319,29 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mDecoded)
 	{	// This is a serious error - crash
 		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; 
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || blocknum < 0 || blocknum >= mReadBlocks[block].mCount)
 	{	// don't crash
-		llinfos << "Block " << bnamep << " not in message " 
-			<< mCurrentRMessageData->mName << llendl;
+		llinfos << "Block " << blockname << " #" << blocknum << " not in message " 
+			<< mCurrentRMessageTemplate->mName << llendl;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	S32 var = findVariable(mCurrentRMessageTemplate->mMemberBlocks.begin()[block], varname);
+	if (var < 0)
 	{	// don't crash
-		llinfos << "Variable " << vnamep << " not in message "
-			<<  mCurrentRMessageData->mName << " block " << bnamep << llendl;
+		llinfos << "Variable " << varname << " not in message "
+			<<  mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	return vardata.getSize();
+	return getReadVar(block, var, blocknum).mSize;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname, 
@@ -535,18 +618,23 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 {
 	llassert( mReceiveSize >= 0 );
 	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
+	llassert( !mDecoded );
 
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-	// create base working data set
-	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
-	
-	// loop through the template building the data structure as we go
+	// Variables only record where they are, so keep a copy of the packet
+	// the handler can read from. Fixed size variables the packet is too
+	// short for get zeroes appended past mReceiveSize.
+	mReceiveBuffer.assign(buffer, buffer + mReceiveSize);
+	mReadBlocks.clear();
+	mReadVars.clear();
+	S32 padding_pos = mReceiveSize;
+	bool has_blocks = false;
+
+	// loop through the template recording every variable as we go
 	LLMessageTemplate::message_block_map_t::const_iterator iter;
 	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
 		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
@@ -594,26 +682,16 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			return FALSE;
 		}
 
-		LLMsgBlkData* cur_data_block = NULL;
+		ReadBlock read_block;
+		read_block.mFirstVar = (S32)mReadVars.size();
+		read_block.mCount = repeat_number;
+		read_block.mVarCount = (S32)mbci->mMemberVariables.size();
+		mReadBlocks.push_back(read_block);
+		has_blocks = has_blocks || repeat_number;
 
 		// now loop through the block
 		for (i = 0; i < repeat_number; i++)
 		{
-			if (i)
-			{
-				// build new name to prevent collisions
-				// TODO: This should really change to a vector
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-				cur_data_block->mName = mbci->mName + i;
-			}
-			else
-			{
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-			}
-
-			// add the block to the message
-			mCurrentRMessageData->addBlock(cur_data_block);
-
 			// now read the variables
 			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
 					 mbci->mMemberVariables.begin();
@@ -621,9 +699,8 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			{
 				const LLMessageVariable& mvci = **iter;
 
-				// ok, build out the variables
-				// add variable block
-				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				ReadVar read_var;
+				read_var.mType = mvci.getType();
 
 				// what type of variable?
 				if (mvci.getType() == MVT_VARIABLE)
@@ -664,38 +741,46 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 					}
 					decode_pos += data_size;
 
-					cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+					if (decode_pos + (S64)tsize > mReceiveSize)
+					{
+						// never hand out bytes the packet doesn't have
+						if (!custom)
+							logRanOffEndOfPacket(sender, decode_pos, tsize);
+						tsize = llmax(mReceiveSize - decode_pos, 0);
+					}
+
+					read_var.mOffset = llmin(decode_pos, mReceiveSize);
+					read_var.mSize = tsize;
 					decode_pos += tsize;
 				}
 				else
 				{
 					// fixed!
-					// so, copy data pointer and set data size to fixed size
+					// so, record the position and the fixed size
+					read_var.mSize = mvci.getSize();
 					if ((decode_pos + mvci.getSize()) > mReceiveSize)
 					{
 						if(!custom)
 							logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
 
 						// default to 0s.
-						U32 size = mvci.getSize();
-						std::vector<U8> data(size, 0);
-						cur_data_block->addData(mvci.getName(), &(data[0]), 
-												size, mvci.getType());
+						read_var.mOffset = padding_pos;
+						padding_pos += read_var.mSize;
+						mReceiveBuffer.resize(padding_pos, 0);
 					}
 					else
 					{
-						cur_data_block->addData(mvci.getName(), 
-												&buffer[decode_pos], 
-												mvci.getSize(), 
-												mvci.getType());
+						read_var.mOffset = decode_pos;
 					}
 					decode_pos += mvci.getSize();
 				}
+				mReadVars.push_back(read_var);
 			}
 		}
 	}
+	mDecoded = true;
 
-	if (mCurrentRMessageData->mMemberBlocks.empty()
+	if (!has_blocks
 		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
 	{
 		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
@@ -827,9 +912,40 @@ bool LLTemplateMessageReader::isUdpBanned() const
 //virtual 
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
-	if(NULL == mCurrentRMessageTemplate)
+	if(NULL == mCurrentRMessageTemplate || !mDecoded)
     {
         return;
     }
-	builder.copyFromMessageData(*mCurrentRMessageData);
+
+	// Forwarding is rare enough to build the block tree the builder
+	// understands on demand.
+	LLMsgData data(mCurrentRMessageTemplate->mName);
+	S32 block = 0;
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		 iter != mCurrentRMessageTemplate->mMemberBlocks.end();
+		 ++iter, ++block)
+	{
+		const LLMessageBlock* mbci = *iter;
+		const ReadBlock& read_block = mReadBlocks[block];
+		for (S32 i = 0; i < read_block.mCount; ++i)
+		{
+			// build new name to prevent collisions
+			LLMsgBlkData* block_data = new LLMsgBlkData(mbci->mName, read_block.mCount);
+			block_data->mName = mbci->mName + i;
+			data.addBlock(block_data);
+
+			S32 var = 0;
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end();
+				 ++var_iter, ++var)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				const ReadVar& read_var = getReadVar(block, var, i);
+				block_data->addVariable(mvci.getName(), mvci.getType());
+				block_data->addData((char*)mvci.getName(), &mReceiveBuffer[0] + read_var.mOffset,
+									read_var.mSize, mvci.getType());
+			}
+		}
+	}
+	builder.copyFromMessageData(data);
 }
@@ -28,11 +28,14 @@
 #define LL_LLTEMPLATEMESSAGEREADER_H
 
 #include "llmessagereader.h"
+#include "llmsgvariabletype.h"
 
 #include <map>
+#include <vector>
 
+class LLMessageBlock;
+class LLMessageField;
 class LLMessageTemplate;
-class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
 {
@@ -102,6 +105,12 @@ public:
 						 const LLHost& sender, bool trusted = false, bool custom = false);
 	BOOL readMessage(const U8* buffer, const LLHost& sender);
 
+	// Reads a variable through the block and variable indices cached in
+	// field, see LLMessageField. Same checks as getBinaryData().
+	void getFieldData(LLMessageField& field, void *datap, S32 size = 0,
+					  S32 blocknum = 0, S32 max_size = S32_MAX);
+	S32 getFieldSize(LLMessageField& field, S32 blocknum = 0);
+
 	bool isTrusted() const;
 	bool isBanned(bool trusted_source) const;
 	bool isUdpBanned() const;
@@ -119,10 +128,45 @@ private:
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender, bool custom);
 
+	// One variable of one block instance of the decoded message.
+	struct ReadVar
+	{
+		S32 mOffset;			// into mReceiveBuffer
+		S32 mSize;
+		EMsgVariableType mType;
+	};
+
+	// One block of the template, with all instances of it in the message.
+	struct ReadBlock
+	{
+		S32 mFirstVar;			// into mReadVars
+		S32 mCount;				// instances in the message
+		S32 mVarCount;			// variables per instance
+	};
+
+	S32 findBlock(const char* blockname) const;
+	static S32 findVariable(const LLMessageBlock* block, const char* varname);
+	bool resolveField(LLMessageField& field);
+	const ReadVar& getReadVar(S32 block, S32 var, S32 blocknum) const
+	{
+		const ReadBlock& read_block = mReadBlocks[block];
+		return mReadVars[read_block.mFirstVar + blocknum * read_block.mVarCount + var];
+	}
+	void copyReadVar(const ReadVar& var, const char* varname,
+					 void* datap, S32 size, S32 max_size) const;
+
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
-	LLMsgData* mCurrentRMessageData;
+	bool mDecoded;
 	message_template_number_map_t& mMessageNumbers;
+
+	// The decoded message refers to a copy of the packet, followed by
+	// zeroes for fixed size variables the packet ran short of. All three
+	// keep their memory from message to message, so decoding doesn't
+	// allocate once they have grown to the largest message.
+	std::vector<U8> mReceiveBuffer;
+	std::vector<ReadBlock> mReadBlocks;		// indexed like the template's blocks
+	std::vector<ReadVar> mReadVars;
 	friend class LLFloaterMessageLogItem;
 };
 
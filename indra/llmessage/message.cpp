@@ -79,7 +79,9 @@
 #include "v3math.h"
 #include "v4math.h"
 #include "lltransfertargetvfile.h"
+#include "llpacketreceivethread.h"
 #include "llpacketring.h"
+#include "llproxy.h"
 
 class AIHTTPTimeoutPolicy;
 extern AIHTTPTimeoutPolicy fnPtrResponder_timeout;
@@ -249,7 +251,9 @@ LLMessageSystem::LLMessageSystem(const std::string& filename, U32 port,
 								 const F32 circuit_heartbeat_interval, const F32 circuit_timeout) :
 	mCircuitInfo(circuit_heartbeat_interval, circuit_timeout),
 	mLastMessageFromTrustedMessageService(false),
-	mPacketRing(new LLPacketRing)
+	mPacketRing(new LLPacketRing),
+	mReceiveThread(NULL),
+	mReceivedPacket(new LLReceivedPacket)
 {
 	init();
 
@@ -365,6 +369,11 @@ LLMessageSystem::~LLMessageSystem()
 	mMessageTemplates.clear(); // don't delete templates.
 	for_each(mMessageNumbers.begin(), mMessageNumbers.end(), DeletePairedPointer());
 	mMessageNumbers.clear();
+
+	// before the socket goes
+	stopReceiveThread();
+	delete mReceivedPacket;
+	mReceivedPacket = NULL;
 	
 	if (!mbError)
 	{
@@ -407,6 +416,29 @@ void LLMessageSystem::clearReceiveState()
 }
 
 
+void LLMessageSystem::startReceiveThread()
+{
+	if (mReceiveThread || mbError)
+	{
+		return;
+	}
+	LL_INFOS("Messaging") << "Receiving packets on a thread" << llendl;
+	mReceiveThread = new LLPacketReceiveThread(mSocket);
+	mReceiveThread->setUnwrapSOCKS(LLProxy::isSOCKSProxyEnabled());
+	mReceiveThread->start();
+}
+
+void LLMessageSystem::stopReceiveThread()
+{
+	if (mReceiveThread)
+	{
+		// packets still queued get dropped, like ones in the socket buffer would
+		mReceiveThread->shutdown();
+		delete mReceiveThread;
+		mReceiveThread = NULL;
+	}
+}
+
 BOOL LLMessageSystem::poll(F32 seconds)
 {
 	S32 num_socks;
@@ -552,26 +584,42 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 		
 		BOOL recv_reliable = FALSE;
 		BOOL recv_resent = FALSE;
-		S32 acks = 0;
-		S32 true_rcv_size = 0;
-
-		U8* buffer = mTrueReceiveBuffer;
+		LLReceivedPacket& packet = *mReceivedPacket;
 
-		mTrueReceiveSize = mPacketRing->receivePacket(mSocket, (char *)mTrueReceiveBuffer);
-		// If you want to dump all received packets into SecondLife.log, uncomment this
-		//dumpPacketToLog();
+		if (mReceiveThread)
+		{
+			// already acked apart and expanded
+			mReceiveThread->setUnwrapSOCKS(LLProxy::isSOCKSProxyEnabled());
+			if (!mReceiveThread->popPacket(packet) || mPacketRing->dropReceivedPacket())
+			{
+				packet.mTrueSize = 0;
+				packet.mSize = 0;
+			}
+			mLastSender = packet.mSender;
+			mLastReceivingIF = packet.mReceivingIF;
+		}
+		else
+		{
+			S32 true_size = mPacketRing->receivePacket(mSocket, (char *)mTrueReceiveBuffer);
+			// If you want to dump all received packets into SecondLife.log, uncomment this
+			//dumpPacketToLog();
+			packet.prepare(mTrueReceiveBuffer, true_size);
+			mLastSender = mPacketRing->getLastSender();
+			mLastReceivingIF = mPacketRing->getLastReceivingInterface();
+		}
 
-		receive_size = mTrueReceiveSize;
-		mLastSender = mPacketRing->getLastSender();
-		mLastReceivingIF = mPacketRing->getLastReceivingInterface();
+		U8* buffer = packet.mData;
+		mTrueReceiveSize = packet.mTrueSize;
+		receive_size = packet.mSize;
+		S32 acks = packet.mAckCount;
 		
-		if (receive_size < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
+		if (mTrueReceiveSize < (S32) LL_MINIMUM_VALID_PACKET_SIZE)
 		{
 			// A receive size of zero is OK, that means that there are no more packets available.
 			// Ones that are non-zero but below the minimum packet size are worrisome.
-			if (receive_size > 0)
+			if (mTrueReceiveSize > 0)
 			{
-				LL_WARNS("Messaging") << "Invalid (too short) packet discarded " << receive_size << llendl;
+				LL_WARNS("Messaging") << "Invalid (too short) packet discarded " << mTrueReceiveSize << llendl;
 				callExceptionFunc(MX_PACKET_TOO_SHORT);
 			}
 			// no data in packet receive buffer
@@ -583,28 +631,30 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 			LLCircuitData* cdp;
 			
 			// note if packet acks are appended.
-			if(buffer[0] & LL_ACK_FLAG)
+			if (packet.mMalformed)
 			{
-				acks += buffer[--receive_size];
-				true_rcv_size = receive_size;
-				if(receive_size >= ((S32)(acks * sizeof(TPACKETID) + LL_MINIMUM_VALID_PACKET_SIZE)))
-				{
-					receive_size -= acks * sizeof(TPACKETID);
-				}
-				else
-				{
-					// mal-formed packet. ignore it and continue with
-					// the next one
-					LL_WARNS("Messaging") << "Malformed packet received. Packet size "
-						<< receive_size << " with invalid no. of acks " << acks
-						<< llendl;
-					valid_packet = FALSE;
-					continue;
-				}
+				// mal-formed packet. ignore it and continue with
+				// the next one
+				LL_WARNS("Messaging") << "Malformed packet received. Packet size "
+					<< receive_size << " with invalid no. of acks " << acks
+					<< llendl;
+				valid_packet = FALSE;
+				continue;
 			}
 
 			// process the message as normal
-			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			mIncomingCompressedSize = packet.mCompressedSize;
+			mTotalBytesIn += mIncomingCompressedSize ? mIncomingCompressedSize : receive_size;
+			if (mIncomingCompressedSize)
+			{
+				mCompressedPacketsIn++;
+				mCompressedBytesIn += mIncomingCompressedSize;
+				mUncompressedBytesIn += receive_size;
+			}
+			if (packet.mExpandOverflow)
+			{
+				callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+			}
 			mCurrentRecvPacketID = ntohl(*((U32*)(&buffer[1])));
 			host = getSender();
 
@@ -615,18 +665,12 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 			// this message came in on if it's valid, and NULL if the
 			// circuit was bogus.
 
-			if(cdp && (acks > 0) && ((S32)(acks * sizeof(TPACKETID)) < (true_rcv_size)))
+			if(cdp && (acks > 0))
 			{
-				TPACKETID packet_id;
-				U32 mem_id=0;
 				for(S32 i = 0; i < acks; ++i)
 				{
-					true_rcv_size -= sizeof(TPACKETID);
-					memcpy(&mem_id, &mTrueReceiveBuffer[true_rcv_size], /* Flawfinder: ignore*/
-					     sizeof(TPACKETID));
-					packet_id = ntohl(mem_id);
-					//LL_INFOS("Messaging") << "got ack: " << packet_id << llendl;
-					cdp->ackReliablePacket(packet_id);
+					//LL_INFOS("Messaging") << "got ack: " << packet.mAcks[i] << llendl;
+					cdp->ackReliablePacket(packet.mAcks[i]);
 				}
 				if (!cdp->getUnackedPacketCount())
 				{
@@ -771,6 +815,18 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count )
 	if ((mt_sec - mCircuitPrintTime) > mCircuitPrintFreq)
 	{
 		dumpCircuitInfo();
+		if (mReceiveThread)
+		{
+			U32 dropped, received;
+			F32 average_wait_ms, max_wait_ms;
+			mReceiveThread->sampleStats(dropped, received, average_wait_ms, max_wait_ms);
+			if (dropped)
+			{
+				LL_WARNS("Messaging") << "Receive queue full, dropped " << dropped << " packets" << llendl;
+			}
+			LL_DEBUGS("Messaging") << "Receive queue: " << received << " packets, waited "
+				<< average_wait_ms << " ms average, " << max_wait_ms << " ms max" << llendl;
+		}
 		mCircuitPrintTime = mt_sec;
 	}
 
@@ -2896,13 +2952,27 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 	S32 in_size = *data_size;
 	mCompressedPacketsIn++;
 	mCompressedBytesIn += *data_size;
-	
-	*data[0] &= (~LL_ZERO_CODE_FLAG);
 
-	S32 count = (*data_size);  
+	bool overflow = false;
+	*data_size = zeroCodeExpand(*data, in_size, mEncodedRecvBuffer, overflow);
+	*data = mEncodedRecvBuffer;
+	if (overflow)
+	{
+		callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
+	}
+	mUncompressedBytesIn += *data_size;
+
+	return(in_size);
+}
+
+//static
+S32 LLMessageSystem::zeroCodeExpand(const U8* in, S32 in_size, U8* out, bool& overflow)
+{
+	overflow = false;
+	S32 count = in_size;
 	
-	U8 *inptr = (U8 *)*data;
-	U8 *outptr = (U8 *)mEncodedRecvBuffer;
+	const U8 *inptr = in;
+	U8 *outptr = out;
 
 // skip the packet id field
 
@@ -2911,6 +2981,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		count--;
 		*outptr++ = *inptr++;
 	}
+	out[0] &= (~LL_ZERO_CODE_FLAG);
 
 // reconstruct encoded packet, keeping track of net size gain
 
@@ -2919,11 +2990,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 	while (count--)
 	{
-		if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-1]))
+		if (outptr > (&out[MAX_BUFFER_SIZE-1]))
 		{
 			LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 1" << llendl;
-			callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-			outptr = mEncodedRecvBuffer;					
+			overflow = true;
+			outptr = out;
 			break;
 		}
 		if (!((*outptr++ = *inptr++)))
@@ -2931,11 +3002,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 			while (((count--)) && (!(*inptr)))
 			{
 				*outptr++ = *inptr++;
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-256]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-256]))
   				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 2" << llendl;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;
+					overflow = true;
+					outptr = out;
 					count = -1;
 					break;
   				}
@@ -2950,11 +3021,11 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 
 			else
 			{
-  				if (outptr > (&mEncodedRecvBuffer[MAX_BUFFER_SIZE-(*inptr)]))
+  				if (outptr > (&out[MAX_BUFFER_SIZE-(*inptr)]))
 				{
   					LL_WARNS("Messaging") << "attempt to write past reasonable encoded buffer size 3" << llendl;
-					callExceptionFunc(MX_WROTE_PAST_BUFFER_SIZE);
-					outptr = mEncodedRecvBuffer;					
+					overflow = true;
+					outptr = out;
 				}
 				memset(outptr,0,(*inptr) - 1);
 				outptr += ((*inptr) - 1);
@@ -2963,11 +3034,7 @@ S32 LLMessageSystem::zeroCodeExpand(U8** data, S32* data_size)
 		}		
 	}
 	
-	*data = mEncodedRecvBuffer;
-	*data_size = (S32)(outptr - mEncodedRecvBuffer);
-	mUncompressedBytesIn += *data_size;
-
-	return(in_size);
+	return (S32)(outptr - out);
 }
 
 
@@ -3967,6 +4034,76 @@ void LLMessageSystem::getString(const char *block, const char *var,
 				  blocknum);
 }
 
+void LLMessageSystem::getBinaryDataFast(LLMessageField& field, void *datap, S32 size, 
+										S32 blocknum, S32 max_size)
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		mTemplateMessageReader->getFieldData(field, datap, size, blocknum, max_size);
+	}
+	else
+	{
+		getBinaryDataFast(field.mBlock, field.mVar, datap, size, blocknum, max_size);
+	}
+}
+
+void LLMessageSystem::getU8Fast(LLMessageField& field, U8 &u, S32 blocknum)
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		mTemplateMessageReader->getFieldData(field, &u, sizeof(U8), blocknum);
+	}
+	else
+	{
+		getU8Fast(field.mBlock, field.mVar, u, blocknum);
+	}
+}
+
+void LLMessageSystem::getU32Fast(LLMessageField& field, U32 &d, S32 blocknum)
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		mTemplateMessageReader->getFieldData(field, &d, sizeof(U32), blocknum);
+	}
+	else
+	{
+		getU32Fast(field.mBlock, field.mVar, d, blocknum);
+	}
+}
+
+void LLMessageSystem::getU64Fast(LLMessageField& field, U64 &d, S32 blocknum)
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		mTemplateMessageReader->getFieldData(field, &d, sizeof(U64), blocknum);
+	}
+	else
+	{
+		getU64Fast(field.mBlock, field.mVar, d, blocknum);
+	}
+}
+
+void LLMessageSystem::getUUIDFast(LLMessageField& field, LLUUID &u, S32 blocknum)
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		mTemplateMessageReader->getFieldData(field, &u.mData[0], sizeof(u.mData), blocknum);
+	}
+	else
+	{
+		getUUIDFast(field.mBlock, field.mVar, u, blocknum);
+	}
+}
+
+S32	LLMessageSystem::getSizeFast(LLMessageField& field, S32 blocknum) const
+{
+	if (mMessageReader == mTemplateMessageReader)
+	{
+		return mTemplateMessageReader->getFieldSize(field, blocknum);
+	}
+	return getSizeFast(field.mBlock, blocknum, field.mVar);
+}
+
 BOOL	LLMessageSystem::has(const char *blockname) const
 {
 	return getNumberOfBlocks(blockname) > 0;
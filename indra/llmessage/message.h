@@ -197,7 +197,35 @@ class LLSDMessageBuilder;
 class LLMessageReader;
 class LLTemplateMessageReader;
 class LLSDMessageReader;
+class LLMessageTemplate;
+class LLPacketReceiveThread;
+struct LLReceivedPacket;
 
+// A block and variable of a template message that a handler reads for
+// every instance of a block. The template reader caches where they are in
+// the current message's template, so repeated reads skip the name lookups.
+// Meant to be a function static in the handler:
+//
+//	static LLMessageField sObjectID(_PREHASH_ObjectData, _PREHASH_ID);
+//	msg->getU32Fast(sObjectID, local_id, i);
+class LLMessageField
+{
+public:
+	LLMessageField(const char* block, const char* var) :
+		mBlock(block),
+		mVar(var),
+		mTemplate(NULL),
+		mBlockIndex(-1),
+		mVarIndex(-1)
+	{
+	}
+
+	const char* mBlock;				// prehashed names
+	const char* mVar;
+	const LLMessageTemplate* mTemplate;	// the indices below are for this one
+	S32 mBlockIndex;
+	S32 mVarIndex;
+};
 
 
 class LLUseCircuitCodeResponder
@@ -220,6 +248,13 @@ class LLMessageSystem : public LLMessageSenderInterface
 
  public:
 	LLPacketRing*				mPacketRing;
+
+	// Receives, acks apart, and expands packets on a thread of its own
+	// instead of in checkMessages(). Not with the LLPacketRing inbound
+	// throttle, which has to pull packets itself.
+	void startReceiveThread();
+	void stopReceiveThread();
+	bool hasReceiveThread() const			{ return mReceiveThread != NULL; }
 	LLReliablePacketParams			mReliablePacketParams;
 
 	// Set this flag to TRUE when you want *very* verbose logs.
@@ -466,6 +501,9 @@ public:
 
 	S32     zeroCode(U8 **data, S32 *data_size);
 	S32		zeroCodeExpand(U8 **data, S32 *data_size);
+	// Expands in_size zero coded bytes at in into out, which has room for
+	// MAX_BUFFER_SIZE. Thread safe. Returns the expanded size.
+	static S32 zeroCodeExpand(const U8* in, S32 in_size, U8* out, bool& overflow);
 	S32		zeroCodeAdjustCurrentSendTotal();
 
 	// Uses ping-based retry
@@ -568,6 +606,15 @@ public:
 	void getStringFast(	const char *block, const char *var, std::string& outstr, S32 blocknum = 0);
 	void	getString(	const char *block, const char *var, std::string& outstr, S32 blocknum = 0);
 
+	// Same as above, through indices cached in field for template
+	// messages. Only for the handler's thread, like the rest.
+	void	getBinaryDataFast(LLMessageField& field, void *datap, S32 size, S32 blocknum = 0, S32 max_size = S32_MAX);
+	void	getU8Fast(LLMessageField& field, U8 &data, S32 blocknum = 0);
+	void	getU32Fast(LLMessageField& field, U32 &data, S32 blocknum = 0);
+	void	getU64Fast(LLMessageField& field, U64 &data, S32 blocknum = 0);
+	void	getUUIDFast(LLMessageField& field, LLUUID &uuid, S32 blocknum = 0);
+	S32		getSizeFast(LLMessageField& field, S32 blocknum = 0) const;
+
 
 	// Utility functions to generate a replay-resistant digest check
 	// against the shared secret. The window specifies how much of a
@@ -787,6 +834,9 @@ private:
 	U8	mTrueReceiveBuffer[MAX_BUFFER_SIZE];
 	S32	mTrueReceiveSize;
 
+	LLPacketReceiveThread* mReceiveThread;
+	LLReceivedPacket* mReceivedPacket;		// the one being handled
+
 	// Must be valid during decode
 	
 	BOOL	mbError;
@@ -38,6 +38,7 @@
 #else
     #include <unistd.h>
 	#include <sys/types.h>
+	#include <sys/select.h>
 	#include <sys/socket.h>
 	#include <netinet/in.h>
 	#include <arpa/inet.h>
@@ -115,6 +116,17 @@ U32 get_receiving_interface_ip(void)
 	return gsnReceivingIFAddr;
 }
 
+BOOL wait_for_packet(int hSocket, S32 timeout_ms)
+{
+	fd_set read_set;
+	FD_ZERO(&read_set);
+	FD_SET(hSocket, &read_set);
+	struct timeval timeout;
+	timeout.tv_sec = timeout_ms / 1000;
+	timeout.tv_usec = (timeout_ms % 1000) * 1000;
+	return select(hSocket + 1, &read_set, NULL, NULL, &timeout) > 0;
+}
+
 const char* u32_to_ip_string(U32 ip)
 {
 	static char buffer[MAXADDRSTR];	 /* Flawfinder: ignore */ 
@@ -341,6 +353,38 @@ S32 receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+	S32 received = 0;
+	while (received < count)
+	{
+		LLNetDatagram& datagram = datagrams[received];
+		SOCKADDR_IN src_addr;
+		int addr_size = sizeof(src_addr);
+		int nRet = recvfrom(hSocket, datagram.mData, NET_BUFFER_SIZE, 0, (struct sockaddr*)&src_addr, &addr_size);
+		if (nRet == SOCKET_ERROR)
+		{
+			int error = WSAGetLastError();
+			if (WSAECONNRESET == error)
+			{
+				// an ICMP port unreachable for an earlier send, try the next one
+				continue;
+			}
+			if (WSAEWOULDBLOCK != error)
+			{
+				llinfos << "receive_packets() failed, Error: " << error << llendl;
+			}
+			break;
+		}
+		datagram.mSize = nRet;
+		datagram.mSenderIP = src_addr.sin_addr.s_addr;
+		datagram.mSenderPort = ntohs(src_addr.sin_port);
+		datagram.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		++received;
+	}
+	return received;
+}
+
 // Returns TRUE on success.
 BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort)
 {
@@ -601,6 +645,76 @@ int receive_packet(int hSocket, char * receiveBuffer)
 	return nRet;
 }
 
+S32 receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count)
+{
+#if LL_LINUX
+	// One system call for the whole batch.
+	const S32 MAX_BATCH = 64;
+	struct mmsghdr msgs[MAX_BATCH];
+	struct iovec iovs[MAX_BATCH];
+	struct sockaddr_in src_addrs[MAX_BATCH];
+	char cmsgs[MAX_BATCH][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, MAX_BATCH);
+	memset(msgs, 0, sizeof(msgs[0]) * count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = datagrams[i].mData;
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &src_addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(src_addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received <= 0)
+	{
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		LLNetDatagram& datagram = datagrams[i];
+		datagram.mSize = msgs[i].msg_len;
+		datagram.mSenderIP = src_addrs[i].sin_addr.s_addr;
+		datagram.mSenderPort = ntohs(src_addrs[i].sin_port);
+		datagram.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsgptr != NULL;
+			 cmsgptr = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsgptr))
+		{
+			if (cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO)
+			{
+				// same choice as recvfrom_destip()
+				datagram.mReceivingIP = ((in_pktinfo*)CMSG_DATA(cmsgptr))->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+	return received;
+#else
+	S32 received = 0;
+	while (received < count)
+	{
+		LLNetDatagram& datagram = datagrams[received];
+		struct sockaddr_in src_addr;
+		socklen_t addr_size = sizeof(src_addr);
+		int nRet = recvfrom(hSocket, datagram.mData, NET_BUFFER_SIZE, 0, (struct sockaddr*)&src_addr, &addr_size);
+		if (nRet <= 0)
+		{
+			break;
+		}
+		datagram.mSize = nRet;
+		datagram.mSenderIP = src_addr.sin_addr.s_addr;
+		datagram.mSenderPort = ntohs(src_addr.sin_port);
+		datagram.mReceivingIP = INVALID_HOST_IP_ADDRESS;
+		++received;
+	}
+	return received;
+#endif
+}
+
 BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient, int nPort)
 {
 	int		ret;
@@ -43,6 +43,24 @@ void	end_net(S32& socket_out);
 // returns size of packet or -1 in case of error
 S32		receive_packet(int hSocket, char * receiveBuffer);
 
+// One datagram of a batch receive. Unlike receive_packet(), nothing is
+// kept in globals, so a thread of its own can use these.
+struct LLNetDatagram
+{
+	char*	mData;			// NET_BUFFER_SIZE bytes to receive into
+	S32		mSize;
+	U32		mSenderIP;
+	U32		mSenderPort;
+	U32		mReceivingIP;	// INVALID_HOST_IP_ADDRESS where unknown
+};
+
+// Receives up to count datagrams that are already waiting, without
+// blocking, with recvmmsg() where there is one. Returns how many.
+S32		receive_packets(int hSocket, LLNetDatagram* datagrams, S32 count);
+
+// Waits up to timeout_ms for something to receive. Returns TRUE if there is.
+BOOL	wait_for_packet(int hSocket, S32 timeout_ms);
+
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
 //void	get_sender(char * tmp);
@@ -30,6 +30,7 @@
 #include "llmemory.h"
 #include "llconvexdecomposition.h"
 #include "llsdserialize.h"
+#include "llsdview.h"
 #include "llvector4a.h"
 #if LL_MSVC
 #pragma warning (push)
@@ -2245,19 +2246,16 @@ bool LLModel::loadDecomposition(LLSD& header, std::istream& is)
 }
 
 
-LLMeshSkinInfo::LLMeshSkinInfo(LLSD& skin)
-{
-	fromLLSD(skin);
-}
-
-void LLMeshSkinInfo::fromLLSD(LLSD& skin)
+// Reads an LLSD or an LLSDView, they have the same accessors.
+template<class T>
+static void skin_info_from_sd(LLMeshSkinInfo& info, T& skin)
 {
 	if (skin.has("joint_names"))
 	{
 		const U32 joint_count = llmin((U32)skin["joint_names"].size(),(U32)64);
 		for (U32 i = 0; i < joint_count; ++i)
 		{
-			mJointNames.push_back(skin["joint_names"][i]);
+			info.mJointNames.push_back(skin["joint_names"][i].asString());
 		}
 	}
 
@@ -2274,7 +2272,7 @@ void LLMeshSkinInfo::fromLLSD(LLSD& skin)
 				}
 			}
 
-			mInvBindMatrix.push_back(mat);
+			info.mInvBindMatrix.push_back(mat);
 		}
 	}
 
@@ -2284,7 +2282,7 @@ void LLMeshSkinInfo::fromLLSD(LLSD& skin)
 		{
 			for (U32 k = 0; k < 4; k++)
 			{
-				mBindShapeMatrix.mMatrix[j][k] = skin["bind_shape_matrix"][j*4+k].asReal();
+				info.mBindShapeMatrix.mMatrix[j][k] = skin["bind_shape_matrix"][j*4+k].asReal();
 			}
 		}
 	}
@@ -2302,16 +2300,36 @@ void LLMeshSkinInfo::fromLLSD(LLSD& skin)
 				}
 			}
 			
-			mAlternateBindMatrix.push_back(mat);
+			info.mAlternateBindMatrix.push_back(mat);
 		}
 	}
 
 	if (skin.has("pelvis_offset"))
 	{
-		mPelvisOffset = skin["pelvis_offset"].asReal();
+		info.mPelvisOffset = skin["pelvis_offset"].asReal();
 	}
 }
 
+LLMeshSkinInfo::LLMeshSkinInfo(LLSD& skin)
+{
+	fromLLSD(skin);
+}
+
+LLMeshSkinInfo::LLMeshSkinInfo(const LLSDView& skin)
+{
+	fromLLSDView(skin);
+}
+
+void LLMeshSkinInfo::fromLLSD(LLSD& skin)
+{
+	skin_info_from_sd(*this, skin);
+}
+
+void LLMeshSkinInfo::fromLLSDView(const LLSDView& skin)
+{
+	skin_info_from_sd(*this, skin);
+}
+
 LLSD LLMeshSkinInfo::asLLSD(bool include_joints) const
 {
 	LLSD ret;
@@ -34,6 +34,7 @@
 
 class daeElement;
 class domMesh;
+class LLSDView;
 
 #define MAX_MODEL_FACES 8
 
@@ -49,7 +50,9 @@ public:
 
 	LLMeshSkinInfo() { }
 	LLMeshSkinInfo(LLSD& data);
+	LLMeshSkinInfo(const LLSDView& data);
 	void fromLLSD(LLSD& data);
+	void fromLLSDView(const LLSDView& data);
 	LLSD asLLSD(bool include_joints) const;
 	LLMatrix4 mBindShapeMatrix;
 	float mPelvisOffset;
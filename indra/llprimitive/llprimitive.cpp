@@ -744,7 +744,7 @@ BOOL LLPrimitive::setVolume(const LLVolumeParams &volume_params, const S32 detai
 			}
 		}
 
-		volumep = sVolumeManager->refVolume(volume_params, detail);
+		volumep = sVolumeManager->refVolume(volume_params, detail, allowVolumeStandIn());
 		if (volumep == mVolumep)
 		{
 			sVolumeManager->unrefVolume( volumep );  // LLVolumeMgr::refVolume() creates a reference, but we don't need a second one.
@@ -355,6 +355,9 @@ public:
 	const LLVolume *getVolumeConst() const { return mVolumep; }		// HACK for Windoze confusion about ostream operator in LLVolume
 	LLVolume *getVolume() const { return mVolumep; }
 	virtual BOOL setVolume(const LLVolumeParams &volume_params, const S32 detail, bool unique_volume = false);
+	// Whether setVolume() may settle for another LOD of the shape while the
+	// requested one is built in the background.
+	virtual bool allowVolumeStandIn() const { return false; }
 
 	// Modify texture entry properties
 	inline BOOL validTE(const U8 te_num) const;
@@ -43,6 +43,7 @@
     
 #include "llstl.h"
 #include "lltimer.h"
+#include "llvfsmapped.h"
     
 const S32 FILE_BLOCK_MASK = 0x000003FF;	 // 1024-byte blocks
 const S32 VFS_CLEANUP_SIZE = 5242880;  // how much space we free up in a single stroke
@@ -211,10 +212,11 @@ struct LLVFSFileBlock_less
 const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
      
 
-LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
+LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash, const BOOL use_mapped_store)
 :	mRemoveAfterCrash(remove_after_crash),
 	mDataFP(NULL),
-	mIndexFP(NULL)
+	mIndexFP(NULL),
+	mMappedStore(NULL)
 {
 	mDataMutex = new LLMutex;
 
@@ -227,6 +229,19 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 	mReadOnly = read_only;
 	mIndexFilename = index_filename;
 	mDataFilename = data_filename;
+
+	if (use_mapped_store)
+	{
+		mMappedStore = new LLVFSMappedStore;
+		if (mMappedStore->open(mIndexFilename, mDataFilename, mReadOnly, presize, mRemoveAfterCrash))
+		{
+			LL_INFOS("VFS") << "Using mapped VFS data file " << mDataFilename << LL_ENDL;
+			return;
+		}
+		LL_WARNS("VFS") << "Couldn't open mapped VFS, falling back to the classic VFS format" << LL_ENDL;
+		delete mMappedStore;
+		mMappedStore = NULL;
+	}
     
 	const char *file_mode = mReadOnly ? "rb" : "r+b";
     
@@ -546,6 +561,14 @@ LLVFS::~LLVFS()
 	{
 		LL_ERRS("VFS") << "LLVFS destroyed with mutex locked" << LL_ENDL;
 	}
+
+	if (mMappedStore)
+	{
+		delete mMappedStore;
+		mMappedStore = NULL;
+		delete mDataMutex;
+		return;
+	}
 	
 	unlockAndClose(mIndexFP);
 	mIndexFP = NULL;
@@ -582,9 +605,10 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 		const std::string& data_filename, 
 		const BOOL read_only, 
 		const U32 presize, 
-		const BOOL remove_after_crash)
+		const BOOL remove_after_crash,
+		const BOOL use_mapped_store)
 {
-	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash);
+	LLVFS * new_vfs = new LLVFS(index_filename, data_filename, read_only, presize, remove_after_crash, use_mapped_store);
 
 	if( !new_vfs->isValid() )
 	{	// First name failed, retry with new names
@@ -598,7 +622,7 @@ LLVFS * LLVFS::createLLVFS(const std::string& index_filename,
 			retry_vfs_data_name = data_filename + llformat(".%u", count);
 
 			delete new_vfs;	// Delete bad VFS and try again
-			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash);
+			new_vfs = new LLVFS(retry_vfs_index_name, retry_vfs_data_name, read_only, presize, remove_after_crash, use_mapped_store);
 
 			count++;
 		}
@@ -651,6 +675,11 @@ BOOL LLVFS::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
+	if (mMappedStore)
+	{
+		return mMappedStore->getExists(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -678,6 +707,11 @@ S32	 LLVFS::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
 
 	}
 
+	if (mMappedStore)
+	{
+		return mMappedStore->getSize(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -704,6 +738,11 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
 
+	if (mMappedStore)
+	{
+		return mMappedStore->getMaxSize(file_id, file_type);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -723,6 +762,11 @@ S32  LLVFS::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 
 BOOL LLVFS::checkAvailable(S32 max_size)
 {
+	if (mMappedStore)
+	{
+		return mMappedStore->checkAvailable(max_size);
+	}
+
 	lockData();
 	
 	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
@@ -749,6 +793,11 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 		return FALSE;
 	}
 
+	if (mMappedStore)
+	{
+		return mMappedStore->setMaxSize(file_id, file_type, max_size);
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -942,6 +991,12 @@ void LLVFS::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempt to write to read-only VFS" << llendl;
 	}
 
+	if (mMappedStore)
+	{
+		mMappedStore->renameFile(file_id, file_type, new_id, new_type);
+		return;
+	}
+
 	lockData();
 	
 	LLVFSFileSpecifier new_spec(new_id, new_type);
@@ -1030,6 +1085,12 @@ void LLVFS::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type
 		llerrs << "Attempt to write to read-only VFS" << llendl;
 	}
 
+	if (mMappedStore)
+	{
+		mMappedStore->removeFile(file_id, file_type);
+		return;
+	}
+
     lockData();
 	
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1059,6 +1120,11 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 	llassert(location >= 0);
 	llassert(length >= 0);
 
+	if (mMappedStore)
+	{
+		return mMappedStore->getData(file_id, file_type, buffer, location, length);
+	}
+
 	BOOL do_read = FALSE;
 	
     lockData();
@@ -1110,6 +1176,11 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
     
 	llassert(length > 0);
 
+	if (mMappedStore)
+	{
+		return mMappedStore->storeData(file_id, file_type, buffer, location, length);
+	}
+
     lockData();
     
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1185,6 +1256,12 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
  
 void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mMappedStore)
+	{
+		mMappedStore->incLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1211,6 +1288,12 @@ void LLVFS::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mMappedStore)
+	{
+		mMappedStore->decLock(file_id, file_type, lock);
+		return;
+	}
+
 	lockData();
 
 	LLVFSFileSpecifier spec(file_id, file_type);
@@ -1235,6 +1318,11 @@ void LLVFS::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, E
 
 BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
 {
+	if (mMappedStore)
+	{
+		return mMappedStore->isLocked(file_id, file_type, lock);
+	}
+
 	lockData();
 	
 	BOOL res = FALSE;
@@ -1631,6 +1719,11 @@ void LLVFS::pokeFiles()
 	{
 		llerrs << "Attempting to use invalid VFS!" << llendl;
 	}
+	if (mMappedStore)
+	{
+		// The mapping takes care of paging the data in.
+		return;
+	}
 	U32 word;
 	
 	// only write data if we actually read 4 bytes
@@ -1661,6 +1754,12 @@ void LLVFS::pokeFiles()
     
 void LLVFS::dumpMap()
 {
+	if (mMappedStore)
+	{
+		mMappedStore->dumpStatistics();
+		return;
+	}
+
 	llinfos << "Files:" << llendl;
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
 	{
@@ -1682,6 +1781,12 @@ void LLVFS::dumpMap()
 // Very slow, do not call routinely. JC
 void LLVFS::audit()
 {
+	if (mMappedStore)
+	{
+		mMappedStore->audit();
+		return;
+	}
+
 	// Lock the mutex through this whole function.
 	LLMutexLock lock_data(mDataMutex);
 	
@@ -1824,6 +1929,11 @@ void LLVFS::audit()
 // Slow, do not call in release.
 void LLVFS::checkMem()
 {
+	if (mMappedStore)
+	{
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -1851,6 +1961,15 @@ void LLVFS::checkMem()
 
 void LLVFS::dumpLockCounts()
 {
+	if (mMappedStore)
+	{
+		for (S32 i = 0; i < VFSLOCK_COUNT; i++)
+		{
+			llinfos << "LockType: " << i << ": " << mMappedStore->getLockCount((EVFSLock)i) << llendl;
+		}
+		return;
+	}
+
 	S32 i;
 	for (i = 0; i < VFSLOCK_COUNT; i++)
 	{
@@ -1860,6 +1979,12 @@ void LLVFS::dumpLockCounts()
 
 void LLVFS::dumpStatistics()
 {
+	if (mMappedStore)
+	{
+		mMappedStore->dumpStatistics();
+		return;
+	}
+
 	lockData();
 	
 	// Investigate file blocks.
@@ -2034,6 +2159,12 @@ std::string get_extension(LLAssetType::EType type)
 
 void LLVFS::listFiles()
 {
+	if (mMappedStore)
+	{
+		mMappedStore->listFiles();
+		return;
+	}
+
 	lockData();
 	
 	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
@@ -2056,53 +2187,61 @@ void LLVFS::listFiles()
 	unlockData();
 }
 
-std::map<LLVFSFileSpecifier, LLVFSFileBlock*> LLVFS::getFileList()
+LLVFS::file_size_map_t LLVFS::getFileList()
 {
+	file_size_map_t files;
+	if (mMappedStore)
+	{
+		mMappedStore->getFileList(files);
+		return files;
+	}
+
 	//have to do this so as not to mess with the gods of threading
 	lockData();
-	fileblock_map mFileList = mFileBlocks;
+	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	{
+		LLVFSFileBlock *file_block = it->second;
+		if (file_block->mLength != BLOCK_LENGTH_INVALID && file_block->mSize > 0)
+		{
+			files[it->first] = file_block->mSize;
+		}
+	}
 	unlockData();
 
-	return mFileList;
+	return files;
 }
 
 #include "llapr.h"
 void LLVFS::dumpFiles()
 {
-	lockData();
-	
+	// Works on a copy of the list, so that getData() can lock as it likes.
+	file_size_map_t files = getFileList();
+
 	S32 files_extracted = 0;
-	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	for (file_size_map_t::iterator it = files.begin(); it != files.end(); ++it)
 	{
-		LLVFSFileSpecifier file_spec = it->first;
-		LLVFSFileBlock *file_block = it->second;
-		S32 length = file_block->mLength;
-		S32 size = file_block->mSize;
-		if (length != BLOCK_LENGTH_INVALID && size > 0)
+		LLUUID id = it->first.mFileID;
+		LLAssetType::EType type = it->first.mFileType;
+		std::vector<U8> buffer(it->second);
+
+		S32 size = getData(id, type, &buffer[0], 0, it->second);
+		if (size <= 0)
 		{
-			LLUUID id = file_spec.mFileID;
-			LLAssetType::EType type = file_spec.mFileType;
-			std::vector<U8> buffer(size);
+			continue;
+		}
 
-			unlockData();
-			getData(id, type, &buffer[0], 0, size);
-			lockData();
-			
-			std::string extension = get_extension(type);
-			std::string filename = id.asString() + extension;
-			llinfos << " Writing " << filename << llendl;
-			
-			LLAPRFile outfile(filename, LL_APR_WB);
-			outfile.write(&buffer[0], size);
-			outfile.close();
+		std::string extension = get_extension(type);
+		std::string filename = id.asString() + extension;
+		llinfos << " Writing " << filename << llendl;
 
-			files_extracted++;
-		}
+		LLAPRFile outfile(filename, LL_APR_WB);
+		outfile.write(&buffer[0], size);
+		outfile.close();
+
+		files_extracted++;
 	}
-	
-	unlockData();
 
-	llinfos << "Extracted " << files_extracted << " files out of " << mFileBlocks.size() << llendl;
+	llinfos << "Extracted " << files_extracted << " files out of " << files.size() << llendl;
 }
 
 //============================================================================
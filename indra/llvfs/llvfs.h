@@ -53,6 +53,8 @@ enum EVFSLock
 	VFSLOCK_COUNT = 3
 };
 
+class LLVFSMappedStore;
+
 //<edit>
 //the VFS explorer requires that the class definition of these be available outside of llvfs
 class LLVFSBlock
@@ -119,17 +121,24 @@ private:
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL use_mapped_store);
 public:
 	~LLVFS();
 
 	// Use this function normally to create LLVFS files
 	// Pass 0 to not presize
+	// When use_mapped_store is set the files are memory-mapped and indexed
+	// by a hash table (see llvfsmapped.h) instead of the classic block index.
+	// If that fails, the classic backend is used.
 	static LLVFS * createLLVFS(const std::string& index_filename, 
 			const std::string& data_filename, 
 			const BOOL read_only, 
 			const U32 presize, 
-			const BOOL remove_after_crash);
+			const BOOL remove_after_crash,
+			const BOOL use_mapped_store = FALSE);
+
+	bool isMapped() const			{ return mMappedStore != NULL; }
 
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
@@ -198,7 +207,9 @@ protected:
 //<edit>
 public:
 	typedef std::map<LLVFSFileSpecifier, LLVFSFileBlock*> fileblock_map;
-	std::map<LLVFSFileSpecifier, LLVFSFileBlock*> getFileList();
+	// Stored size of every file holding data, by file.
+	typedef std::map<LLVFSFileSpecifier, S32> file_size_map_t;
+	file_size_map_t getFileList();
 //</edit>
 protected:
 	fileblock_map mFileBlocks;
@@ -221,6 +232,10 @@ protected:
 
 	S32 mLockCounts[VFSLOCK_COUNT];
 	BOOL mRemoveAfterCrash;
+
+	// Non-NULL when running on the memory-mapped backend, in which case all
+	// of the above (except mReadOnly and mValid) is unused.
+	LLVFSMappedStore* mMappedStore;
 };
 
 extern LLVFS *gVFS;
@@ -0,0 +1,943 @@
+/**
+ * @file llvfsmapped.cpp
+ * @brief Memory-mapped, lock-striped storage backend for LLVFS
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvfsmapped.h"
+
+#include <algorithm>
+#include <vector>
+
+const U32 INDEX_MAGIC = 0x4D534656;			// "VFSM"
+const U32 INDEX_VERSION = 1;
+const U32 INDEX_MIN_CAPACITY = 4096;
+const U32 INDEX_BYTES_PER_SLOT_HINT = 65536;	// initial capacity is one slot per 64KB of data
+const S32 FILE_BLOCK_MASK = 0x000003FF;		// 1024-byte blocks, as in llvfs.cpp
+const S32 VFS_CLEANUP_SIZE = 5242880;			// how much space we free up in a single stroke
+
+LLVFSMappedStore::LLVFSMappedStore()
+:	mReadOnly(TRUE)
+{
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		mLockCounts[i] = 0;
+	}
+}
+
+LLVFSMappedStore::~LLVFSMappedStore()
+{
+	close();
+}
+
+//static
+U32 LLVFSMappedStore::hashSpec(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	// Asset ids are random, so the cheap UUID hash distributes well already;
+	// the type is mixed in so that e.g. a texture and its baked copy differ.
+	return file_id.getCRC32() ^ ((U32)file_type * 0x9E3779B9);
+}
+
+void LLVFSMappedStore::touch(IndexSlot* slot) const
+{
+	if (mReadOnly)
+	{
+		return;
+	}
+	// Avoid dirtying the index page when nothing changed.
+	U32 now = (U32)time(NULL);
+	if (slot->mAccessTime != now)
+	{
+		slot->mAccessTime = now;
+	}
+}
+
+bool LLVFSMappedStore::open(const std::string& index_filename, const std::string& data_filename,
+							BOOL read_only, U32 data_size, BOOL remove_after_crash)
+{
+	close();
+
+	mReadOnly = read_only;
+	mIndexFilename = index_filename;
+
+	LLMappedFile::EMode mode = mReadOnly ? LLMappedFile::READ_ONLY : LLMappedFile::READ_WRITE;
+	if (!mDataFile.open(data_filename, mode, mReadOnly ? 0 : data_size))
+	{
+		// This includes the case of another viewer instance holding the lock.
+		LL_WARNS("VFS") << "Couldn't map VFS data file " << data_filename << LL_ENDL;
+		close();
+		return false;
+	}
+	U32 actual_data_size = (U32)mDataFile.getSize();
+
+	bool valid = false;
+	llstat fbuf;
+	if (!LLFile::stat(index_filename, &fbuf) && (size_t)fbuf.st_size >= sizeof(IndexHeader) &&
+		mIndexFile.open(index_filename, mode))
+	{
+		const IndexHeader* header = getHeader();
+		size_t expected_size = sizeof(IndexHeader) + (size_t)header->mCapacity * sizeof(IndexSlot);
+		valid = header->mMagic == INDEX_MAGIC &&
+				header->mVersion == INDEX_VERSION &&
+				header->mCapacity >= INDEX_MIN_CAPACITY &&
+				(header->mCapacity & (header->mCapacity - 1)) == 0 &&
+				mIndexFile.getSize() == expected_size &&
+				header->mDataSize == actual_data_size;
+		if (valid && !header->mClean && remove_after_crash)
+		{
+			LL_WARNS("VFS") << "VFS: File left open on last run, clearing mapped VFS index " << index_filename << LL_ENDL;
+			valid = false;
+		}
+		if (valid && !rebuildFreeList())
+		{
+			LL_WARNS("VFS") << "VFS corruption: overlapping or out of range entries in " << index_filename << LL_ENDL;
+			valid = false;
+		}
+	}
+
+	if (!valid)
+	{
+		if (mReadOnly)
+		{
+			LL_WARNS("VFS") << "Can't use " << index_filename << " as read-only mapped VFS index" << LL_ENDL;
+			close();
+			return false;
+		}
+
+		U32 capacity = INDEX_MIN_CAPACITY;
+		while (capacity < actual_data_size / INDEX_BYTES_PER_SLOT_HINT)
+		{
+			capacity <<= 1;
+		}
+		if (!resetIndex(capacity))
+		{
+			close();
+			return false;
+		}
+		mFreeBlocksByLength.clear();
+		mFreeBlocksByLocation.clear();
+		addFreeBlock(0, (S32)actual_data_size);
+	}
+
+	if (!mReadOnly)
+	{
+		getHeader()->mClean = 0;
+		mIndexFile.flush(false);
+	}
+
+	LL_INFOS("VFS") << "Using mapped VFS index " << index_filename << " (" << getHeader()->mCount
+					<< " files, " << getHeader()->mCapacity << " slots)" << LL_ENDL;
+	return true;
+}
+
+void LLVFSMappedStore::close()
+{
+	if (mIndexFile.isOpen() && !mReadOnly)
+	{
+		getHeader()->mClean = 1;
+		mDataFile.flush(false);
+		mIndexFile.flush(false);
+	}
+	mIndexFile.close();
+	mDataFile.close();
+	mFreeBlocksByLength.clear();
+	mFreeBlocksByLocation.clear();
+}
+
+void LLVFSMappedStore::flush()
+{
+	mDataFile.flush(true);
+	mIndexFile.flush(true);
+}
+
+//============================================================================
+// Hash table
+//============================================================================
+
+LLVFSMappedStore::IndexSlot* LLVFSMappedStore::findSlot(const LLUUID &file_id, const LLAssetType::EType file_type, U32 hash) const
+{
+	const U32 mask = getHeader()->mCapacity - 1;
+	IndexSlot* slots = getSlots();
+	for (U32 i = hash & mask; ; i = (i + 1) & mask)
+	{
+		IndexSlot* slot = slots + i;
+		if (slot->mState == SLOT_EMPTY)
+		{
+			return NULL;
+		}
+		if (slot->mState == SLOT_USED &&
+			slot->mFileType == (S32)file_type &&
+			!memcmp(slot->mFileID, file_id.mData, UUID_BYTES))
+		{
+			return slot;
+		}
+	}
+}
+
+LLVFSMappedStore::IndexSlot* LLVFSMappedStore::insertSlot(const LLUUID &file_id, const LLAssetType::EType file_type, U32 hash)
+{
+	IndexHeader* header = getHeader();
+	const U32 mask = header->mCapacity - 1;
+	IndexSlot* slots = getSlots();
+	U32 i = hash & mask;
+	while (slots[i].mState == SLOT_USED)
+	{
+		i = (i + 1) & mask;
+	}
+
+	IndexSlot* slot = slots + i;
+	if (slot->mState == SLOT_DELETED)
+	{
+		header->mTombstones--;
+	}
+	memcpy(slot->mFileID, file_id.mData, UUID_BYTES);
+	slot->mFileType = (S32)file_type;
+	slot->mLocation = 0;
+	slot->mLength = 0;
+	slot->mSize = 0;
+	slot->mAccessTime = (U32)time(NULL);
+	slot->mState = SLOT_USED;
+	header->mCount++;
+	return slot;
+}
+
+void LLVFSMappedStore::eraseSlot(IndexSlot* slot)
+{
+	if (slot->mLength > 0)
+	{
+		addFreeBlock(slot->mLocation, slot->mLength);
+	}
+	slot->mState = SLOT_DELETED;
+	slot->mLength = 0;
+	slot->mSize = 0;
+
+	IndexHeader* header = getHeader();
+	header->mCount--;
+	header->mTombstones++;
+}
+
+// Makes sure that extra more entries can be inserted without the load
+// factor going over 3/4. May remap the index, invalidating slot pointers.
+bool LLVFSMappedStore::reserveSlots(U32 extra)
+{
+	IndexHeader* header = getHeader();
+	U32 capacity = header->mCapacity;
+	if ((header->mCount + header->mTombstones + extra) * 4 <= capacity * 3)
+	{
+		return true;
+	}
+
+	// Grow when more than half of the slots hold live entries, otherwise
+	// rehashing at the same size is enough to get rid of the tombstones.
+	while ((header->mCount + extra) * 2 > capacity)
+	{
+		capacity <<= 1;
+	}
+
+	std::vector<IndexSlot> live;
+	live.reserve(header->mCount);
+	IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		if (slots[i].mState == SLOT_USED)
+		{
+			live.push_back(slots[i]);
+		}
+	}
+
+	if (!resetIndex(capacity))
+	{
+		return false;
+	}
+
+	header = getHeader();
+	slots = getSlots();
+	const U32 mask = capacity - 1;
+	for (std::vector<IndexSlot>::const_iterator iter = live.begin(); iter != live.end(); ++iter)
+	{
+		LLUUID id;
+		memcpy(id.mData, iter->mFileID, UUID_BYTES);
+		U32 i = hashSpec(id, (LLAssetType::EType)iter->mFileType) & mask;
+		while (slots[i].mState != SLOT_EMPTY)
+		{
+			i = (i + 1) & mask;
+		}
+		slots[i] = *iter;
+	}
+	header->mCount = (U32)live.size();
+	header->mClean = 0;
+
+	LL_DEBUGS("VFS") << "Rehashed mapped VFS index to " << capacity << " slots" << LL_ENDL;
+	return true;
+}
+
+bool LLVFSMappedStore::resetIndex(U32 capacity)
+{
+	size_t size = sizeof(IndexHeader) + (size_t)capacity * sizeof(IndexSlot);
+	bool success = mIndexFile.isOpen() ? mIndexFile.resize(size)
+									   : mIndexFile.open(mIndexFilename, LLMappedFile::READ_WRITE, size);
+	if (success && mIndexFile.getSize() != size)
+	{
+		success = mIndexFile.resize(size);
+	}
+	if (!success)
+	{
+		LL_WARNS("VFS") << "Couldn't create mapped VFS index " << mIndexFilename << LL_ENDL;
+		return false;
+	}
+
+	memset(mIndexFile.getData(), 0, size);
+	IndexHeader* header = getHeader();
+	header->mMagic = INDEX_MAGIC;
+	header->mVersion = INDEX_VERSION;
+	header->mCapacity = capacity;
+	header->mDataSize = (U32)mDataFile.getSize();
+	return true;
+}
+
+//============================================================================
+// Free space
+//============================================================================
+
+bool LLVFSMappedStore::rebuildFreeList()
+{
+	mFreeBlocksByLength.clear();
+	mFreeBlocksByLocation.clear();
+
+	const U32 data_size = (U32)mDataFile.getSize();
+	std::vector<std::pair<U32, S32> > used;
+	IndexHeader* header = getHeader();
+	IndexSlot* slots = getSlots();
+	U32 count = 0;
+	U32 tombstones = 0;
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		IndexSlot& slot = slots[i];
+		if (slot.mState == SLOT_DELETED)
+		{
+			tombstones++;
+		}
+		else if (slot.mState == SLOT_USED)
+		{
+			if (slot.mLength <= 0 ||
+				slot.mLocation >= data_size ||
+				(U32)slot.mLength > data_size - slot.mLocation ||
+				slot.mSize < 0 ||
+				slot.mSize > slot.mLength ||
+				slot.mFileType < LLAssetType::AT_NONE ||
+				slot.mFileType >= LLAssetType::AT_COUNT)
+			{
+				return false;
+			}
+			used.push_back(std::make_pair(slot.mLocation, slot.mLength));
+			count++;
+		}
+		else if (slot.mState != SLOT_EMPTY)
+		{
+			return false;
+		}
+	}
+	header->mCount = count;
+	header->mTombstones = tombstones;
+
+	std::sort(used.begin(), used.end());
+
+	U32 loc = 0;
+	for (std::vector<std::pair<U32, S32> >::const_iterator iter = used.begin(); iter != used.end(); ++iter)
+	{
+		if (iter->first < loc)
+		{
+			mFreeBlocksByLength.clear();
+			mFreeBlocksByLocation.clear();
+			return false;
+		}
+		if (iter->first > loc)
+		{
+			addFreeBlock(loc, (S32)(iter->first - loc));
+		}
+		loc = iter->first + iter->second;
+	}
+	if (loc < data_size)
+	{
+		addFreeBlock(loc, (S32)(data_size - loc));
+	}
+	return true;
+}
+
+static void erase_length_entry(std::multimap<S32, U32>& by_length, S32 length, U32 location)
+{
+	std::multimap<S32, U32>::iterator iter = by_length.lower_bound(length);
+	std::multimap<S32, U32>::iterator end = by_length.upper_bound(length);
+	for ( ; iter != end; ++iter)
+	{
+		if (iter->second == location)
+		{
+			by_length.erase(iter);
+			return;
+		}
+	}
+	llerrs << "Mapped VFS free block at " << location << " missing from length map" << llendl;
+}
+
+void LLVFSMappedStore::addFreeBlock(U32 location, S32 length)
+{
+	// Merge with the neighbours, if they are free too.
+	blocks_location_map_t::iterator next = mFreeBlocksByLocation.lower_bound(location);
+	if (next != mFreeBlocksByLocation.begin())
+	{
+		blocks_location_map_t::iterator prev = next;
+		--prev;
+		if (prev->first + prev->second == location)
+		{
+			erase_length_entry(mFreeBlocksByLength, prev->second, prev->first);
+			location = prev->first;
+			length += prev->second;
+			mFreeBlocksByLocation.erase(prev);
+		}
+	}
+	if (next != mFreeBlocksByLocation.end() && location + length == next->first)
+	{
+		erase_length_entry(mFreeBlocksByLength, next->second, next->first);
+		length += next->second;
+		mFreeBlocksByLocation.erase(next);
+	}
+
+	mFreeBlocksByLocation[location] = length;
+	mFreeBlocksByLength.insert(blocks_length_map_t::value_type(length, location));
+}
+
+void LLVFSMappedStore::useFreeSpace(U32 location, S32 length)
+{
+	blocks_location_map_t::iterator iter = mFreeBlocksByLocation.find(location);
+	llassert_always(iter != mFreeBlocksByLocation.end() && iter->second >= length);
+
+	S32 remaining = iter->second - length;
+	erase_length_entry(mFreeBlocksByLength, iter->second, location);
+	mFreeBlocksByLocation.erase(iter);
+	if (remaining > 0)
+	{
+		mFreeBlocksByLocation[location + length] = remaining;
+		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(remaining, location + length));
+	}
+}
+
+// Table write lock must be held. May evict least recently used files to
+// make room; the immune slot is never evicted.
+bool LLVFSMappedStore::findFreeBlock(S32 size, const IndexSlot* immune, U32& location)
+{
+	blocks_length_map_t::iterator fit = mFreeBlocksByLength.lower_bound(size);
+	if (fit != mFreeBlocksByLength.end())
+	{
+		location = fit->second;
+		return true;
+	}
+
+	// Collect eviction candidates, oldest first.
+	std::vector<std::pair<U32, S32> > lru;
+	IndexHeader* header = getHeader();
+	IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		IndexSlot* slot = slots + i;
+		if (slot->mState == SLOT_USED && slot != immune && !isLockedInternal(slot))
+		{
+			lru.push_back(std::make_pair(slot->mAccessTime, (S32)i));
+		}
+	}
+	std::sort(lru.begin(), lru.end());
+
+	S32 cleaned = 0;
+	bool found = false;
+	for (std::vector<std::pair<U32, S32> >::const_iterator iter = lru.begin(); iter != lru.end(); ++iter)
+	{
+		IndexSlot* slot = slots + iter->second;
+		cleaned += slot->mLength;
+		eraseSlot(slot);
+
+		fit = mFreeBlocksByLength.lower_bound(size);
+		found = fit != mFreeBlocksByLength.end();
+		// Free a decent chunk at once so that we don't sort the whole
+		// index again for the next request.
+		if (found && cleaned >= VFS_CLEANUP_SIZE)
+		{
+			break;
+		}
+	}
+
+	if (found)
+	{
+		LL_DEBUGS("VFS") << "Mapped VFS: evicted " << cleaned << " bytes of LRU files" << LL_ENDL;
+		location = fit->second;
+	}
+	return found;
+}
+
+bool LLVFSMappedStore::isLockedInternal(const IndexSlot* slot)
+{
+	LLUUID id;
+	memcpy(id.mData, slot->mFileID, UUID_BYTES);
+	LLAssetType::EType type = (LLAssetType::EType)slot->mFileType;
+	Stripe& stripe = getStripe(hashSpec(id, type));
+
+	LLMutexLock lock(&stripe.mMutex);
+	lock_map_t::const_iterator iter = stripe.mLocks.find(LLVFSFileSpecifier(id, type));
+	if (iter == stripe.mLocks.end())
+	{
+		return false;
+	}
+	for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+	{
+		if (iter->second.mCounts[i] > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//============================================================================
+// Public interface
+//============================================================================
+
+BOOL LLVFSMappedStore::getExists(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	U32 hash = hashSpec(file_id, file_type);
+	AIReadLock table_lock(mTableLock);
+	LLMutexLock lock(&getStripe(hash).mMutex);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (slot)
+	{
+		touch(slot);
+	}
+	return (slot && slot->mLength > 0) ? TRUE : FALSE;
+}
+
+S32 LLVFSMappedStore::getSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	U32 hash = hashSpec(file_id, file_type);
+	AIReadLock table_lock(mTableLock);
+	LLMutexLock lock(&getStripe(hash).mMutex);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (!slot)
+	{
+		return 0;
+	}
+	touch(slot);
+	return slot->mSize;
+}
+
+S32 LLVFSMappedStore::getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	U32 hash = hashSpec(file_id, file_type);
+	AIReadLock table_lock(mTableLock);
+	LLMutexLock lock(&getStripe(hash).mMutex);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (!slot)
+	{
+		return 0;
+	}
+	touch(slot);
+	return slot->mLength;
+}
+
+BOOL LLVFSMappedStore::checkAvailable(S32 max_size)
+{
+	AIReadLock table_lock(mTableLock);
+	return mFreeBlocksByLength.lower_bound(max_size) != mFreeBlocksByLength.end() ? TRUE : FALSE;
+}
+
+BOOL LLVFSMappedStore::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size)
+{
+	// round all sizes upward to KB increments, except for textures (see LLVFS::setMaxSize)
+	if (file_type != LLAssetType::AT_TEXTURE && (max_size & FILE_BLOCK_MASK))
+	{
+		max_size += FILE_BLOCK_MASK;
+		max_size &= ~FILE_BLOCK_MASK;
+	}
+
+	U32 hash = hashSpec(file_id, file_type);
+	AIWriteLock table_lock(mTableLock);
+
+	// Make room for a new entry up front, this may remap the index.
+	if (!reserveSlots(1))
+	{
+		return FALSE;
+	}
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (slot)
+	{
+		touch(slot);
+
+		if (max_size == slot->mLength)
+		{
+			return TRUE;
+		}
+		if (max_size < slot->mLength)
+		{
+			// this file is shrinking
+			addFreeBlock(slot->mLocation + max_size, slot->mLength - max_size);
+			slot->mLength = max_size;
+			if (slot->mLength < slot->mSize)
+			{
+				llerrs << "Truncating virtual file " << file_id << " to " << slot->mLength << " bytes" << llendl;
+				slot->mSize = slot->mLength;
+			}
+			return TRUE;
+		}
+
+		// this file is growing, first check for an adjacent free block to grow into
+		S32 size_increase = max_size - slot->mLength;
+		blocks_location_map_t::iterator adjacent = mFreeBlocksByLocation.find(slot->mLocation + slot->mLength);
+		if (adjacent != mFreeBlocksByLocation.end() && adjacent->second >= size_increase)
+		{
+			useFreeSpace(adjacent->first, size_increase);
+			slot->mLength = max_size;
+			return TRUE;
+		}
+
+		U32 new_location;
+		if (!findFreeBlock(max_size, slot, new_location))
+		{
+			llwarns << "VFS: No space (" << max_size << ") to resize existing vfile " << file_id << llendl;
+			return FALSE;
+		}
+
+		useFreeSpace(new_location, max_size);
+		if (slot->mSize > 0)
+		{
+			memcpy(mDataFile.getData() + new_location, mDataFile.getData() + slot->mLocation, slot->mSize);
+		}
+		addFreeBlock(slot->mLocation, slot->mLength);
+		slot->mLocation = new_location;
+		slot->mLength = max_size;
+		return TRUE;
+	}
+
+	U32 location;
+	if (!findFreeBlock(max_size, NULL, location))
+	{
+		llwarns << "VFS: No space (" << max_size << ") for new virtual file " << file_id << llendl;
+		return FALSE;
+	}
+
+	useFreeSpace(location, max_size);
+	slot = insertSlot(file_id, file_type, hash);
+	slot->mLocation = location;
+	slot->mLength = max_size;
+	return TRUE;
+}
+
+void LLVFSMappedStore::renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+								  const LLUUID &new_id, const LLAssetType::EType &new_type)
+{
+	if (file_id == new_id && file_type == new_type)
+	{
+		return;
+	}
+
+	U32 old_hash = hashSpec(file_id, file_type);
+	U32 new_hash = hashSpec(new_id, new_type);
+	AIWriteLock table_lock(mTableLock);
+
+	IndexSlot* src = findSlot(file_id, file_type, old_hash);
+	if (!src)
+	{
+		llwarns << "VFS: Attempt to rename nonexistent vfile " << file_id << ":" << file_type << llendl;
+		return;
+	}
+
+	// Purge whatever is stored under the new name.
+	IndexSlot* dest = findSlot(new_id, new_type, new_hash);
+	if (dest)
+	{
+		eraseSlot(dest);
+	}
+
+	// The locks move along with the file.
+	Stripe* first = &getStripe(old_hash);
+	Stripe* second = &getStripe(new_hash);
+	if (second < first)
+	{
+		std::swap(first, second);
+	}
+	first->mMutex.lock();
+	if (second != first)
+	{
+		second->mMutex.lock();
+	}
+	LLVFSFileSpecifier old_spec(file_id, file_type);
+	LLVFSFileSpecifier new_spec(new_id, new_type);
+	lock_map_t& old_locks = getStripe(old_hash).mLocks;
+	lock_map_t& new_locks = getStripe(new_hash).mLocks;
+	lock_map_t::iterator dest_locks = new_locks.find(new_spec);
+	if (dest_locks != new_locks.end())
+	{
+		for (S32 i = 0; i < (S32)VFSLOCK_COUNT; i++)
+		{
+			if (dest_locks->second.mCounts[i])
+			{
+				llerrs << "Renaming VFS block to a locked file." << llendl;
+			}
+		}
+		new_locks.erase(dest_locks);
+	}
+	lock_map_t::iterator src_locks = old_locks.find(old_spec);
+	if (src_locks != old_locks.end())
+	{
+		new_locks[new_spec] = src_locks->second;
+		old_locks.erase(src_locks);
+	}
+	if (second != first)
+	{
+		second->mMutex.unlock();
+	}
+	first->mMutex.unlock();
+
+	// Reinsert under the new key; there is room since we just erased src.
+	U32 location = src->mLocation;
+	S32 length = src->mLength;
+	S32 size = src->mSize;
+	src->mLength = 0;		// don't let eraseSlot free the data
+	eraseSlot(src);
+	IndexSlot* slot = insertSlot(new_id, new_type, new_hash);
+	slot->mLocation = location;
+	slot->mLength = length;
+	slot->mSize = size;
+}
+
+void LLVFSMappedStore::removeFile(const LLUUID &file_id, const LLAssetType::EType file_type)
+{
+	U32 hash = hashSpec(file_id, file_type);
+	AIWriteLock table_lock(mTableLock);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (slot)
+	{
+		eraseSlot(slot);
+	}
+	else
+	{
+		llwarns << "VFS: attempting to remove nonexistent file " << file_id << " type " << file_type << llendl;
+	}
+}
+
+S32 LLVFSMappedStore::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length)
+{
+	llassert(location >= 0);
+	llassert(length >= 0);
+
+	U32 hash = hashSpec(file_id, file_type);
+	AIReadLock table_lock(mTableLock);
+	LLMutexLock lock(&getStripe(hash).mMutex);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (!slot)
+	{
+		return 0;
+	}
+	touch(slot);
+
+	if (location > slot->mSize)
+	{
+		llwarns << "VFS: Attempt to read location " << location << " in file " << file_id << " of length " << slot->mSize << llendl;
+		return 0;
+	}
+	if (length > slot->mSize - location)
+	{
+		length = slot->mSize - location;
+	}
+	memcpy(buffer, mDataFile.getData() + slot->mLocation + location, length);
+	return length;
+}
+
+S32 LLVFSMappedStore::storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length)
+{
+	llassert(length > 0);
+
+	U32 hash = hashSpec(file_id, file_type);
+	AIReadLock table_lock(mTableLock);
+	LLMutexLock lock(&getStripe(hash).mMutex);
+
+	IndexSlot* slot = findSlot(file_id, file_type, hash);
+	if (!slot)
+	{
+		return 0;
+	}
+
+	if (location == -1)
+	{
+		location = slot->mSize;
+	}
+	llassert(location >= 0);
+	touch(slot);
+
+	if (location > slot->mLength)
+	{
+		llwarns << "VFS: Attempt to write to location " << location
+				<< " in file " << file_id
+				<< " type " << S32(file_type)
+				<< " of size " << slot->mSize
+				<< " block length " << slot->mLength
+				<< llendl;
+		return length;
+	}
+	if (length > slot->mLength - location)
+	{
+		llwarns << "VFS: Truncating write to virtual file " << file_id << " type " << S32(file_type) << llendl;
+		length = slot->mLength - location;
+	}
+
+	memcpy(mDataFile.getData() + slot->mLocation + location, buffer, length);
+	if (location + length > slot->mSize)
+	{
+		slot->mSize = location + length;
+	}
+	return length;
+}
+
+void LLVFSMappedStore::incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Stripe& stripe = getStripe(hashSpec(file_id, file_type));
+	LLMutexLock stripe_lock(&stripe.mMutex);
+
+	stripe.mLocks[LLVFSFileSpecifier(file_id, file_type)].mCounts[lock]++;
+	mLockCounts[lock]++;
+}
+
+void LLVFSMappedStore::decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Stripe& stripe = getStripe(hashSpec(file_id, file_type));
+	LLMutexLock stripe_lock(&stripe.mMutex);
+
+	lock_map_t::iterator iter = stripe.mLocks.find(LLVFSFileSpecifier(file_id, file_type));
+	if (iter == stripe.mLocks.end())
+	{
+		return;
+	}
+
+	S32* counts = iter->second.mCounts;
+	if (counts[lock] > 0)
+	{
+		counts[lock]--;
+	}
+	else
+	{
+		llwarns << "VFS: Decrementing zero-value lock " << lock << llendl;
+	}
+	mLockCounts[lock] -= 1;
+
+	if (!counts[VFSLOCK_OPEN] && !counts[VFSLOCK_READ] && !counts[VFSLOCK_APPEND])
+	{
+		stripe.mLocks.erase(iter);
+	}
+}
+
+BOOL LLVFSMappedStore::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock)
+{
+	Stripe& stripe = getStripe(hashSpec(file_id, file_type));
+	LLMutexLock stripe_lock(&stripe.mMutex);
+
+	lock_map_t::const_iterator iter = stripe.mLocks.find(LLVFSFileSpecifier(file_id, file_type));
+	return (iter != stripe.mLocks.end() && iter->second.mCounts[lock] > 0) ? TRUE : FALSE;
+}
+
+//============================================================================
+// Debugging
+//============================================================================
+
+void LLVFSMappedStore::audit()
+{
+	AIWriteLock table_lock(mTableLock);
+	if (!rebuildFreeList())
+	{
+		llwarns << "Mapped VFS audit failed: overlapping or out of range entries" << llendl;
+	}
+	else
+	{
+		llinfos << "Mapped VFS audit OK, " << getHeader()->mCount << " files" << llendl;
+	}
+}
+
+void LLVFSMappedStore::dumpStatistics()
+{
+	AIReadLock table_lock(mTableLock);
+
+	const IndexHeader* header = getHeader();
+	S64 total_free = 0;
+	S32 largest_free = 0;
+	for (blocks_location_map_t::const_iterator iter = mFreeBlocksByLocation.begin(); iter != mFreeBlocksByLocation.end(); ++iter)
+	{
+		total_free += iter->second;
+		largest_free = llmax(largest_free, iter->second);
+	}
+
+	llinfos << "Mapped VFS: " << header->mCount << " files in " << header->mCapacity << " slots ("
+			<< header->mTombstones << " tombstones)" << llendl;
+	llinfos << "Mapped VFS: " << mFreeBlocksByLocation.size() << " free blocks, " << total_free
+			<< " bytes free, largest " << largest_free << " bytes, data file " << header->mDataSize << " bytes" << llendl;
+}
+
+void LLVFSMappedStore::listFiles()
+{
+	AIReadLock table_lock(mTableLock);
+
+	const IndexHeader* header = getHeader();
+	const IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		const IndexSlot& slot = slots[i];
+		if (slot.mState == SLOT_USED && slot.mSize > 0)
+		{
+			LLUUID id;
+			memcpy(id.mData, slot.mFileID, UUID_BYTES);
+			llinfos << " File: " << id
+					<< " Type: " << LLAssetType::getDesc((LLAssetType::EType)slot.mFileType)
+					<< " Size: " << slot.mSize
+					<< llendl;
+		}
+	}
+}
+
+void LLVFSMappedStore::getFileList(LLVFS::file_size_map_t& files)
+{
+	AIReadLock table_lock(mTableLock);
+
+	const IndexHeader* header = getHeader();
+	const IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		const IndexSlot& slot = slots[i];
+		if (slot.mState == SLOT_USED && slot.mSize > 0)
+		{
+			LLUUID id;
+			memcpy(id.mData, slot.mFileID, UUID_BYTES);
+			files[LLVFSFileSpecifier(id, (LLAssetType::EType)slot.mFileType)] = slot.mSize;
+		}
+	}
+}
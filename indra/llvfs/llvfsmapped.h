@@ -0,0 +1,173 @@
+/**
+ * @file llvfsmapped.h
+ * @brief Memory-mapped, lock-striped storage backend for LLVFS
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVFSMAPPED_H
+#define LL_LLVFSMAPPED_H
+
+#include <map>
+#include "llvfs.h"
+#include "llmappedfile.h"
+
+// The mapped store keeps the same public semantics as the classic LLVFS
+// file backend, but:
+//  - the data file is memory-mapped, reads and writes are memcpy's;
+//  - the index is an open-addressed hash table living in its own mapped
+//    file, so there is no separate in-memory map to keep in sync;
+//  - instead of one mutex for everything, the table is protected by a
+//    reader/writer lock that is only write-locked when entries are created,
+//    moved or removed, and the per-file data and bookkeeping is protected
+//    by one of STRIPE_COUNT mutexes selected by the hash of the file
+//    specifier. Readers of different assets therefore never block each other.
+//
+// Lock order: mTableLock before any stripe mutex.
+class LLVFSMappedStore
+{
+public:
+	LLVFSMappedStore();
+	~LLVFSMappedStore();
+
+	// Opens (or creates) the store. data_size is the size the data file is
+	// grown to when it is smaller. Returns false when the files could not be
+	// opened or mapped, in which case the caller should fall back to the
+	// classic backend.
+	bool open(const std::string& index_filename, const std::string& data_filename,
+			  BOOL read_only, U32 data_size, BOOL remove_after_crash);
+	void close();
+
+	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32	 getSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32  getMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type);
+	BOOL checkAvailable(S32 max_size);
+	BOOL setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type, S32 max_size);
+	void renameFile(const LLUUID &file_id, const LLAssetType::EType file_type,
+					const LLUUID &new_id, const LLAssetType::EType &new_type);
+	void removeFile(const LLUUID &file_id, const LLAssetType::EType file_type);
+	S32  getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8 *buffer, S32 location, S32 length);
+	S32  storeData(const LLUUID &file_id, const LLAssetType::EType file_type, const U8 *buffer, S32 location, S32 length);
+
+	void incLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	void decLock(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
+
+	void flush();
+	void audit();
+	void dumpStatistics();
+	void listFiles();
+	void getFileList(LLVFS::file_size_map_t& files);
+	S32  getLockCount(EVFSLock lock) const { return mLockCounts[lock]; }
+
+	enum { STRIPE_COUNT = 64 };
+
+private:
+	// On-disk layout of the index file: one IndexHeader followed by
+	// mCapacity IndexSlots. Everything is stored in native byte order;
+	// a file written on a machine with the other endianness fails the
+	// magic check and is rebuilt.
+	struct IndexHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mCapacity;		// always a power of two
+		U32 mCount;			// SLOT_USED entries
+		U32 mTombstones;	// SLOT_DELETED entries
+		U32 mDataSize;		// size of the data file this index describes
+		U32 mClean;			// 0 while the store is open for writing
+		U32 mPad;
+	};
+
+	enum ESlotState
+	{
+		SLOT_EMPTY = 0,
+		SLOT_USED = 1,
+		SLOT_DELETED = 2
+	};
+
+	struct IndexSlot
+	{
+		U8  mFileID[UUID_BYTES];
+		S32 mFileType;
+		U32 mState;
+		U32 mLocation;
+		S32 mLength;		// allocated block size
+		S32 mSize;			// bytes actually stored
+		U32 mAccessTime;
+	};
+
+	struct LockCounts
+	{
+		LockCounts() { mCounts[VFSLOCK_OPEN] = mCounts[VFSLOCK_READ] = mCounts[VFSLOCK_APPEND] = 0; }
+		S32 mCounts[VFSLOCK_COUNT];
+	};
+	typedef std::map<LLVFSFileSpecifier, LockCounts> lock_map_t;
+
+	struct Stripe
+	{
+		LLMutex mMutex;
+		lock_map_t mLocks;
+	};
+
+	typedef std::multimap<S32, U32> blocks_length_map_t;	// length -> location
+	typedef std::map<U32, S32> blocks_location_map_t;		// location -> length
+
+	static U32 hashSpec(const LLUUID &file_id, const LLAssetType::EType file_type);
+	Stripe& getStripe(U32 hash) { return mStripes[(hash >> 16) & (STRIPE_COUNT - 1)]; }
+
+	IndexHeader* getHeader() const { return (IndexHeader*)mIndexFile.getData(); }
+	IndexSlot* getSlots() const { return (IndexSlot*)(mIndexFile.getData() + sizeof(IndexHeader)); }
+
+	// Table lock (read or write) must be held.
+	IndexSlot* findSlot(const LLUUID &file_id, const LLAssetType::EType file_type, U32 hash) const;
+	// Table write lock must be held.
+	IndexSlot* insertSlot(const LLUUID &file_id, const LLAssetType::EType file_type, U32 hash);
+	void eraseSlot(IndexSlot* slot);
+	bool reserveSlots(U32 extra);
+	bool resetIndex(U32 capacity);
+	bool rebuildFreeList();
+	void addFreeBlock(U32 location, S32 length);
+	void useFreeSpace(U32 location, S32 length);
+	bool findFreeBlock(S32 size, const IndexSlot* immune, U32& location);
+	bool isLockedInternal(const IndexSlot* slot);
+
+	// Records an access, unless the index is mapped read only.
+	void touch(IndexSlot* slot) const;
+
+private:
+	LLMappedFile	mIndexFile;
+	LLMappedFile	mDataFile;
+	std::string		mIndexFilename;
+	BOOL			mReadOnly;
+
+	AIRWLock		mTableLock;
+	Stripe			mStripes[STRIPE_COUNT];
+
+	// Protected by the table write lock.
+	blocks_length_map_t		mFreeBlocksByLength;
+	blocks_location_map_t	mFreeBlocksByLocation;
+
+	LLAtomicS32		mLockCounts[VFSLOCK_COUNT];
+};
+
+#endif // LL_LLVFSMAPPED_H
@@ -42,6 +42,7 @@
 #include "v3color.h"
 #include "llrect.h"
 #include "llxmltree.h"
+#include "llxmlcompiledcache.h"
 #include "llsdserialize.h"
 
 #if LL_RELEASE_WITH_DEBUG_INFO || LL_DEBUG
@@ -937,21 +938,25 @@ U32 LLControlGroup::loadFromFile(const std::string& filename, bool set_default_v
 		return 0; //Already included this file.
 
 	LLSD settings;
-	llifstream infile;
-	infile.open(filename);
-	if(!infile.is_open())
+	if (!LLXMLCompiledCache::readLLSD(filename, settings))
 	{
-		llwarns << "Cannot find file " << filename << " to load." << llendl;
-		return 0;
-	}
+		llifstream infile;
+		infile.open(filename);
+		if(!infile.is_open())
+		{
+			llwarns << "Cannot find file " << filename << " to load." << llendl;
+			return 0;
+		}
 
-	S32 ret = LLSDSerialize::fromXML(settings, infile);
+		S32 ret = LLSDSerialize::fromXML(settings, infile);
 
-	if (ret <= 0)
-	{
-		infile.close();
-		llwarns << "Unable to open LLSD control file " << filename << ". Trying Legacy Method." << llendl;		
-		return loadFromFileLegacy(filename, TRUE, TYPE_STRING);
+		if (ret <= 0)
+		{
+			infile.close();
+			llwarns << "Unable to open LLSD control file " << filename << ". Trying Legacy Method." << llendl;		
+			return loadFromFileLegacy(filename, TRUE, TYPE_STRING);
+		}
+		LLXMLCompiledCache::writeLLSD(filename, settings);
 	}
 
 	U32	validitems = 0;
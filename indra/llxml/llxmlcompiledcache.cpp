@@ -0,0 +1,484 @@
+/**
+ * @file llxmlcompiledcache.cpp
+ * @brief Disk cache of parsed XUI trees and settings files.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llxmlcompiledcache.h"
+
+#include <sstream>
+
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "llmd5.h"
+#include "llsd.h"
+#include "llsdserialize.h"
+#include "llstringtable.h"
+
+static const U32 XML_COMPILED_CACHE_MAGIC = 0x4c4d5843;	// "CXML"
+// Bump when the node layout below, the way StartXMLNode() interprets
+// attributes or the binary LLSD format changes.
+static const U32 XML_COMPILED_CACHE_VERSION = 1;
+
+static const char* XUI_EXTENSION = ".xui";
+static const char* LLSD_EXTENSION = ".llsd";
+
+// Bits of the header flags of a compiled XUI file; a tree parsed with other
+// stripping settings has other values.
+enum
+{
+	XUI_STRIP_ESCAPED_STRINGS = 1,
+	XUI_STRIP_WHITESPACE_VALUES = 2
+};
+
+struct LLXMLCompiledFileHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U32 mFlags;
+	U32 mDataSize;
+	U64 mSourceSize;
+	U64 mSourceTime;
+};
+
+// One node of a compiled XUI tree. The string members are indices in the
+// string table in front of the nodes. The attributes, then the children of
+// a node follow it, each with their own attributes and children.
+struct LLXMLCompiledNode
+{
+	U32 mName;
+	U32 mValue;
+	U32 mID;
+	U32 mIsAttribute;
+	U32 mType;
+	U32 mEncoding;
+	U32 mVersionMajor;
+	U32 mVersionMinor;
+	U32 mLength;
+	U32 mPrecision;
+	S32 mLineNumber;
+	U32 mNumAttributes;
+	U32 mNumChildren;
+};
+
+std::string LLXMLCompiledCache::sCacheDir;
+LLAtomicU32 LLXMLCompiledCache::sHits;
+LLAtomicU32 LLXMLCompiledCache::sMisses;
+LLAtomicU32 LLXMLCompiledCache::sBytesRead;
+LLAtomicU32 LLXMLCompiledCache::sBytesWritten;
+
+static bool get_source_info(const std::string& filename, U64& size, U64& time)
+{
+	llstat file_info;
+	if (LLFile::stat(filename, &file_info))
+	{
+		return false;
+	}
+	size = (U64)file_info.st_size;
+	time = (U64)file_info.st_mtime;
+	return true;
+}
+
+static U32 get_xui_flags()
+{
+	U32 flags = 0;
+	if (LLXMLNode::sStripEscapedStrings)
+	{
+		flags |= XUI_STRIP_ESCAPED_STRINGS;
+	}
+	if (LLXMLNode::sStripWhitespaceValues)
+	{
+		flags |= XUI_STRIP_WHITESPACE_VALUES;
+	}
+	return flags;
+}
+
+static void append_u32(std::string& data, U32 value)
+{
+	data.append((const char*)&value, sizeof(value));
+}
+
+class LLXMLCompiledWriter
+{
+public:
+	LLXMLCompiledWriter() : mNodeCount(0)	{ addString(LLStringUtil::null); }
+
+	void addNode(const LLXMLNode* node)
+	{
+		LLXMLCompiledNode record;
+		record.mName = addString(node->getName() ? node->getName()->mString : "");
+		record.mValue = addString(node->getValue());
+		record.mID = addString(node->mID);
+		record.mIsAttribute = node->mIsAttribute ? 1 : 0;
+		record.mType = node->mType;
+		record.mEncoding = node->mEncoding;
+		record.mVersionMajor = node->mVersionMajor;
+		record.mVersionMinor = node->mVersionMinor;
+		record.mLength = node->mLength;
+		record.mPrecision = node->mPrecision;
+		record.mLineNumber = node->mLineNumber;
+		record.mNumAttributes = node->mAttributes.size();
+		record.mNumChildren = 0;
+		if (node->mChildren.notNull())
+		{
+			for (LLXMLNode* child = node->mChildren->head; child; child = child->mNext)
+			{
+				++record.mNumChildren;
+			}
+		}
+		mNodes.append((const char*)&record, sizeof(record));
+		++mNodeCount;
+
+		for (LLXMLAttribList::const_iterator iter = node->mAttributes.begin();
+			 iter != node->mAttributes.end(); ++iter)
+		{
+			addNode(iter->second);
+		}
+		if (node->mChildren.notNull())
+		{
+			for (LLXMLNode* child = node->mChildren->head; child; child = child->mNext)
+			{
+				addNode(child);
+			}
+		}
+	}
+
+	void finish(std::string& data)
+	{
+		append_u32(data, mStrings.size());
+		for (std::vector<const std::string*>::const_iterator iter = mStrings.begin();
+			 iter != mStrings.end(); ++iter)
+		{
+			append_u32(data, (*iter)->size());
+			data.append(**iter);
+			data.push_back('\0');
+		}
+		append_u32(data, mNodeCount);
+		data.append(mNodes);
+	}
+
+private:
+	U32 addString(const std::string& str)
+	{
+		std::pair<std::map<std::string, U32>::iterator, bool> result =
+			mStringIndex.insert(std::make_pair(str, (U32)mStrings.size()));
+		if (result.second)
+		{
+			mStrings.push_back(&result.first->first);
+		}
+		return result.first->second;
+	}
+
+	std::map<std::string, U32> mStringIndex;
+	std::vector<const std::string*> mStrings;
+	std::string mNodes;
+	U32 mNodeCount;
+};
+
+class LLXMLCompiledReader
+{
+public:
+	LLXMLCompiledReader(const U8* data, U32 size) : mPos(data), mEnd(data + size), mNodesLeft(0)	{ }
+
+	LLXMLNodePtr readTree()
+	{
+		U32 count;
+		if (!read(&count, sizeof(count)) || count > (U32)(mEnd - mPos))
+		{
+			return NULL;
+		}
+		mStrings.resize(count);
+		mLengths.resize(count);
+		mNames.resize(count, NULL);
+		for (U32 i = 0; i < count; ++i)
+		{
+			U32 length;
+			if (!read(&length, sizeof(length)) || length >= (U32)(mEnd - mPos) || mPos[length])
+			{
+				return NULL;
+			}
+			mStrings[i] = (const char*)mPos;
+			mLengths[i] = length;
+			mPos += length + 1;
+		}
+		if (!read(&mNodesLeft, sizeof(mNodesLeft)) ||
+			(U64)mNodesLeft * sizeof(LLXMLCompiledNode) != (U64)(mEnd - mPos))
+		{
+			return NULL;
+		}
+		LLXMLNodePtr root = readNode();
+		if (mNodesLeft)
+		{
+			return NULL;
+		}
+		return root;
+	}
+
+private:
+	bool read(void* dest, U32 size)
+	{
+		if ((U32)(mEnd - mPos) < size)
+		{
+			return false;
+		}
+		memcpy(dest, mPos, size);
+		mPos += size;
+		return true;
+	}
+
+	LLXMLNodePtr readNode()
+	{
+		LLXMLCompiledNode record;
+		if (!mNodesLeft || !read(&record, sizeof(record)))
+		{
+			return NULL;
+		}
+		--mNodesLeft;
+		U32 count = mStrings.size();
+		if (record.mName >= count || record.mValue >= count || record.mID >= count ||
+			record.mType > LLXMLNode::TYPE_NODEREF || record.mEncoding > LLXMLNode::ENCODING_HEX ||
+			record.mNumAttributes + record.mNumChildren > mNodesLeft)
+		{
+			return NULL;
+		}
+
+		if (!mNames[record.mName])
+		{
+			mNames[record.mName] = gStringTable.addStringEntry(mStrings[record.mName]);
+		}
+		LLXMLNodePtr node = new LLXMLNode(mNames[record.mName], record.mIsAttribute != 0);
+		node->mID.assign(mStrings[record.mID], mLengths[record.mID]);
+		node->setValue(std::string(mStrings[record.mValue], mLengths[record.mValue]));
+		node->mType = (LLXMLNode::ValueType)record.mType;
+		node->mEncoding = (LLXMLNode::Encoding)record.mEncoding;
+		node->mVersionMajor = record.mVersionMajor;
+		node->mVersionMinor = record.mVersionMinor;
+		node->mLength = record.mLength;
+		node->mPrecision = record.mPrecision;
+		node->setLineNumber(record.mLineNumber);
+
+		// Same order as StartXMLNode(): attributes first, then the children
+		// in document order.
+		U32 num_nodes = record.mNumAttributes + record.mNumChildren;
+		for (U32 i = 0; i < num_nodes; ++i)
+		{
+			LLXMLNodePtr child = readNode();
+			if (child.isNull() || (i < record.mNumAttributes) != (bool)child->mIsAttribute)
+			{
+				return NULL;
+			}
+			node->addChild(child);
+		}
+		return node;
+	}
+
+	const U8* mPos;
+	const U8* mEnd;
+	U32 mNodesLeft;
+	std::vector<const char*> mStrings;
+	std::vector<U32> mLengths;
+	std::vector<LLStringTableEntry*> mNames;
+};
+
+//static
+void LLXMLCompiledCache::initCache(const std::string& dir, bool create)
+{
+	if (create)
+	{
+		LLFile::mkdir(dir);
+	}
+	if (!LLFile::isdir(dir))
+	{
+		if (create)
+		{
+			llwarns << "No compiled XML cache, couldn't create " << dir << llendl;
+		}
+		sCacheDir.clear();
+		return;
+	}
+	llinfos << "Using compiled XML cache in " << dir << llendl;
+	sCacheDir = dir;
+}
+
+//static
+std::string LLXMLCompiledCache::getFilename(const std::string& filename, const char* extension)
+{
+	LLMD5 path_hash;
+	path_hash.update(filename);
+	path_hash.finalize();
+	char hex[33];
+	path_hash.hex_digest(hex);
+#if LL_WINDOWS
+	return sCacheDir + "\\" + hex + extension;
+#else
+	return sCacheDir + "/" + hex + extension;
+#endif
+}
+
+//static
+bool LLXMLCompiledCache::map(const std::string& filename, const char* extension, U32 flags,
+							 LLMappedFile& file, const U8*& data, U32& size)
+{
+	U64 source_size, source_time;
+	if (!isEnabled() || !get_source_info(filename, source_size, source_time))
+	{
+		return false;
+	}
+
+	std::string compiled_filename = getFilename(filename, extension);
+	if (!file.open(compiled_filename, LLMappedFile::READ_ONLY))
+	{
+		sMisses++;
+		return false;
+	}
+
+	const LLXMLCompiledFileHeader* header = (const LLXMLCompiledFileHeader*) file.getData();
+	bool valid = file.getSize() >= sizeof(LLXMLCompiledFileHeader) &&
+				 header->mMagic == XML_COMPILED_CACHE_MAGIC &&
+				 header->mVersion == XML_COMPILED_CACHE_VERSION &&
+				 header->mFlags == flags &&
+				 header->mSourceSize == source_size &&
+				 header->mSourceTime == source_time &&
+				 header->mDataSize == file.getSize() - sizeof(LLXMLCompiledFileHeader);
+	if (!valid)
+	{
+		file.close();
+		discard(filename, extension);
+		return false;
+	}
+
+	data = file.getData() + sizeof(LLXMLCompiledFileHeader);
+	size = header->mDataSize;
+	return true;
+}
+
+//static
+void LLXMLCompiledCache::discard(const std::string& filename, const char* extension)
+{
+	std::string compiled_filename = getFilename(filename, extension);
+	LL_DEBUGS("XMLNode") << "Discarding stale compiled file " << compiled_filename << " of " << filename << LL_ENDL;
+	LLFile::remove_nowarn(compiled_filename);
+	sMisses++;
+}
+
+//static
+void LLXMLCompiledCache::write(const std::string& filename, const char* extension, U32 flags, const std::string& data)
+{
+	LLXMLCompiledFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mMagic = XML_COMPILED_CACHE_MAGIC;
+	header.mVersion = XML_COMPILED_CACHE_VERSION;
+	header.mFlags = flags;
+	header.mDataSize = data.size();
+	if (!get_source_info(filename, header.mSourceSize, header.mSourceTime))
+	{
+		return;
+	}
+
+	if (LLFile::write_replace(getFilename(filename, extension), &header, sizeof(header), data.data(), data.size()))
+	{
+		sBytesWritten += sizeof(header) + data.size();
+	}
+}
+
+//static
+bool LLXMLCompiledCache::readNode(const std::string& filename, LLXMLNodePtr& node)
+{
+	LLMappedFile file;
+	const U8* data;
+	U32 size;
+	if (!map(filename, XUI_EXTENSION, get_xui_flags(), file, data, size))
+	{
+		return false;
+	}
+
+	LLXMLCompiledReader reader(data, size);
+	LLXMLNodePtr root = reader.readTree();
+	file.close();
+	if (root.isNull())
+	{
+		discard(filename, XUI_EXTENSION);
+		return false;
+	}
+
+	sHits++;
+	sBytesRead += size;
+	node = root;
+	return true;
+}
+
+//static
+void LLXMLCompiledCache::writeNode(const std::string& filename, const LLXMLNode* node)
+{
+	if (!isEnabled() || !node)
+	{
+		return;
+	}
+
+	LLXMLCompiledWriter writer;
+	writer.addNode(node);
+	std::string data;
+	writer.finish(data);
+	write(filename, XUI_EXTENSION, get_xui_flags(), data);
+}
+
+//static
+bool LLXMLCompiledCache::readLLSD(const std::string& filename, LLSD& sd)
+{
+	LLMappedFile file;
+	const U8* data;
+	U32 size;
+	if (!map(filename, LLSD_EXTENSION, 0, file, data, size))
+	{
+		return false;
+	}
+
+	LLSD result;
+	bool valid = LLSDSerialize::fromBinaryBuffer(result, data, size) == (S32)size;
+	file.close();
+	if (!valid)
+	{
+		discard(filename, LLSD_EXTENSION);
+		return false;
+	}
+
+	sHits++;
+	sBytesRead += size;
+	sd = result;
+	return true;
+}
+
+//static
+void LLXMLCompiledCache::writeLLSD(const std::string& filename, const LLSD& sd)
+{
+	if (!isEnabled())
+	{
+		return;
+	}
+
+	std::ostringstream stream;
+	LLSDSerialize::toBinary(sd, stream);
+	write(filename, LLSD_EXTENSION, 0, stream.str());
+}
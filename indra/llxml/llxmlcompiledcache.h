@@ -0,0 +1,90 @@
+/**
+ * @file llxmlcompiledcache.h
+ * @brief Disk cache of parsed XUI trees and settings files.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLXMLCOMPILEDCACHE_H
+#define LL_LLXMLCOMPILEDCACHE_H
+
+#include <string>
+
+#include "llatomic.h"
+#include "llxmlnode.h"
+
+class LLMappedFile;
+class LLSD;
+
+// Keeps what LLXMLNode::parseFile() and LLControlGroup::loadFromFile() made
+// of an XML file on disk, one file per source file, so that the next
+// session maps it and rebuilds the result without running expat or the
+// LLSD XML parser. XUI trees are stored as a string table and a flat list
+// of nodes with their type, encoding and the other attributes the parser
+// interprets already applied; settings are stored as binary LLSD.
+//
+// A compiled file is only used while the size and modification time of its
+// source file and the format version match, so an edited skin or settings
+// file is simply parsed again.
+//
+// The cache is opt-in: it is off until initCache() is called, and
+// initCache(dir, false) only turns it on when dir was created before.
+class LLXMLCompiledCache
+{
+public:
+	// Enables the cache in dir. When create is false the cache is only
+	// enabled if dir already exists.
+	static void initCache(const std::string& dir, bool create);
+	// Stops using the cache; the caller removes the directory.
+	static void disableCache()				{ sCacheDir.clear(); }
+	static bool isEnabled()					{ return !sCacheDir.empty(); }
+
+	// Rebuilds the node tree parsed from filename. Returns false on a miss.
+	static bool readNode(const std::string& filename, LLXMLNodePtr& node);
+	static void writeNode(const std::string& filename, const LLXMLNode* node);
+
+	// Same for the LLSD of a settings file.
+	static bool readLLSD(const std::string& filename, LLSD& sd);
+	static void writeLLSD(const std::string& filename, const LLSD& sd);
+
+	static U32 getHits()					{ return sHits; }
+	static U32 getMisses()					{ return sMisses; }
+	static U32 getBytesRead()				{ return sBytesRead; }
+	static U32 getBytesWritten()			{ return sBytesWritten; }
+
+private:
+	static std::string getFilename(const std::string& filename, const char* extension);
+	// Maps the compiled file of filename and checks it against its source.
+	// On success data and size describe the payload behind the header.
+	static bool map(const std::string& filename, const char* extension, U32 flags,
+					LLMappedFile& file, const U8*& data, U32& size);
+	static void discard(const std::string& filename, const char* extension);
+	static void write(const std::string& filename, const char* extension, U32 flags, const std::string& data);
+
+	static std::string sCacheDir;
+
+	static LLAtomicU32 sHits;
+	static LLAtomicU32 sMisses;
+	static LLAtomicU32 sBytesRead;
+	static LLAtomicU32 sBytesWritten;
+};
+
+#endif // LL_LLXMLCOMPILEDCACHE_H
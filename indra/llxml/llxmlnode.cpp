@@ -31,6 +31,7 @@
 #include <map>
 
 #include "llxmlnode.h"
+#include "llxmlcompiledcache.h"
 
 #include "v3color.h"
 #include "v4color.h"
@@ -745,6 +746,14 @@ LLXMLNodePtr LLXMLNode::replaceNode(LLXMLNodePtr node, LLXMLNodePtr update_node)
 // static
 bool LLXMLNode::parseFile(const std::string& filename, LLXMLNodePtr& node, LLXMLNode* defaults_tree)
 {
+	if (LLXMLCompiledCache::readNode(filename, node))
+	{
+		LL_DEBUGS("XMLNode") << "loaded compiled XML file: " << filename << LL_ENDL;
+		node->setDefault(defaults_tree);
+		node->updateDefault();
+		return true;
+	}
+
 	// Read file
 	LL_DEBUGS("XMLNode") << "parsing XML file: " << filename << LL_ENDL;
 	LLFILE* fp = LLFile::fopen(filename, "rb");		/* Flawfinder: ignore */
@@ -762,8 +771,13 @@ bool LLXMLNode::parseFile(const std::string& filename, LLXMLNodePtr& node, LLXML
 	buffer[nread] = 0;
 	fclose(fp);
 
-	bool rv = parseBuffer(buffer, nread, node, defaults_tree);
+	bool well_formed = false;
+	bool rv = parseBuffer(buffer, nread, node, defaults_tree, &well_formed);
 	delete [] buffer;
+	if (rv && well_formed)
+	{
+		LLXMLCompiledCache::writeNode(filename, node);
+	}
 	return rv;
 }
 
@@ -772,7 +786,8 @@ bool LLXMLNode::parseBuffer(
 	U8* buffer,
 	U32 length,
 	LLXMLNodePtr& node, 
-	LLXMLNode* defaults)
+	LLXMLNode* defaults,
+	bool* well_formed)
 {
 	// Init
 	XML_Parser my_parser = XML_ParserCreate(NULL);
@@ -788,13 +803,18 @@ bool LLXMLNode::parseBuffer(
 	XML_SetUserData(my_parser, (void *)file_node_ptr);
 
 	// Do the parsing
-	if (XML_Parse(my_parser, (const char *)buffer, length, TRUE) != XML_STATUS_OK)
+	bool parsed = XML_Parse(my_parser, (const char *)buffer, length, TRUE) == XML_STATUS_OK;
+	if (!parsed)
 	{
 		llwarns << "Error parsing xml error code: "
 				<< XML_ErrorString(XML_GetErrorCode(my_parser))
 				<< " on line " << XML_GetCurrentLineNumber(my_parser)
 				<< llendl;
 	}
+	if (well_formed)
+	{
+		*well_formed = parsed;
+	}
 
 	// Deinit
 	XML_ParserFree(my_parser);
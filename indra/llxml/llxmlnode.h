@@ -141,11 +141,13 @@ public:
 		const std::string& filename,
 		LLXMLNodePtr& node, 
 		LLXMLNode* defaults_tree);
+	// well_formed, when given, is set to whether expat accepted all of buffer.
 	static bool parseBuffer(
 		U8* buffer,
 		U32 length,
 		LLXMLNodePtr& node, 
-		LLXMLNode* defaults);
+		LLXMLNode* defaults,
+		bool* well_formed = NULL);
 	static bool parseStream(
 		std::istream& str,
 		LLXMLNodePtr& node, 
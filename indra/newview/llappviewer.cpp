@@ -52,6 +52,8 @@
 #include "llmarketplacefunctions.h"
 #include "llmarketplacenotifications.h"
 #include "llmd5.h"
+#include "llmeshdecodedcache.h"
+#include "llxmlcompiledcache.h"
 #include "llmeshrepository.h"
 #include "llmodaldialog.h"
 #include "llpumpio.h"
@@ -116,6 +118,7 @@
 #include "llviewerkeyboard.h"
 #include "lllfsthread.h"
 #include "llworkerthread.h"
+#include "llthreadpool.h"
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
@@ -368,6 +371,8 @@ void init_default_trans_args()
 // File scope definitons
 const char *VFS_DATA_FILE_BASE = "data.db2.x.";
 const char *VFS_INDEX_FILE_BASE = "index.db2.x.";
+const char *VFS_MAPPED_DATA_FILE_BASE = "data.db2.m.";
+const char *VFS_MAPPED_INDEX_FILE_BASE = "index.db2.m.";
 
 static std::string gSecondLife;
 std::string gWindowTitle;
@@ -500,6 +505,7 @@ static void settings_to_globals()
 	gShowObjectUpdates = gSavedSettings.getBOOL("ShowObjectUpdates");
 	LLWorldMapView::sMapScale =  llmax(.1f,gSavedSettings.getF32("MapScale"));
 	LLHoverView::sShowHoverTips = gSavedSettings.getBOOL("ShowHoverTips");
+	LLSDArenaScope::sEnabled = gSavedSettings.getBOOL("LLSDUseArena");
 }
 
 static void settings_modify()
@@ -1779,6 +1785,11 @@ bool LLAppViewer::cleanup()
     sTextureFetch = NULL;
 	delete sImageDecodeThread;
     sImageDecodeThread = NULL;
+	if (LLPrimitive::getVolumeManager())
+	{
+		LLPrimitive::getVolumeManager()->setBuildPool(NULL);
+	}
+	LLThreadPool::cleanupClass();
 
 
 	llinfos << "Cleaning up Media and Textures" << llendflush;
@@ -1906,13 +1917,25 @@ bool LLAppViewer::initThreads()
 	AICurlInterface::startCurlThread(&gSavedSettings);
 
 	LLImage::initClass();
+
+	// Shared worker threads
+	if (enable_threads)
+	{
+		LLThreadPool::initClass(gSavedSettings.getU32("ThreadPoolSize"));
+	}
 	
 	LLVFSThread::initClass(enable_threads && false);
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
-	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	LLThreadPool* decode_pool = gSavedSettings.getBOOL("ThreadPoolImageDecode") ? pool : NULL;
+	LLThreadPool* cache_pool = gSavedSettings.getBOOL("ThreadPoolTextureCache") ? pool : NULL;
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, decode_pool,
+															  gSavedSettings.getU32("ImageDecodeThreads"));
+	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true, cache_pool);
+	// Volume LODs; the volume manager was made in initConfiguration().
+	LLPrimitive::getVolumeManager()->setBuildPool(gSavedSettings.getBOOL("ThreadPoolVolumeBuild") ? pool : NULL);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
 													enable_threads && true,
@@ -2089,6 +2112,11 @@ bool LLAppViewer::initConfiguration()
 	AIWriteAccess<settings_map_type> settings_w(gSettings);
 	settings_map_type& settings(*settings_w);
 
+	// The compiled XML cache has to be up before the first settings file is
+	// read, so it is remembered by the existence of its directory rather
+	// than by XMLCompiledCache. That setting is applied below.
+	LLXMLCompiledCache::initCache(getXMLCompiledCacheDir(), false);
+
 	//Set up internal pointers	
 	settings[sGlobalSettingsName] = &gSavedSettings;
 	settings[sPerAccountSettingsName] = &gSavedPerAccountSettings;
@@ -2250,6 +2278,8 @@ bool LLAppViewer::initConfiguration()
 	// - apply command line settings 
 	clp.notify(); 
 
+	setXMLCompiledCacheEnabled(gSavedSettings.getBOOL("XMLCompiledCache"));
+
 	// Register the core crash option as soon as we can
 	// if we want gdb post-mortem on cores we need to be up and running
 	// ASAP or we might miss init issue etc.
@@ -3240,7 +3270,7 @@ U32 LLAppViewer::getObjectCacheVersion()
 {
 	// Viewer object cache version, change if object update
 	// format changes. JC
-	const U32 INDRA_OBJECT_CACHE_VERSION = 14;
+	const U32 INDRA_OBJECT_CACHE_VERSION = 15;
 
 	return INDRA_OBJECT_CACHE_VERSION;
 }
@@ -3334,6 +3364,11 @@ bool LLAppViewer::initCache()
 
 	LLVOCache::getInstance()->initCache(LL_PATH_CACHE, gSavedSettings.getU32("CacheNumberOfRegionsForObjects"), getObjectCacheVersion()) ;
 
+	if (gSavedSettings.getBOOL("MeshDecodedCache"))
+	{
+		LLMeshDecodedCache::initCache(LL_PATH_CACHE, gSavedSettings.getU32("MeshDecodedCacheSize"), read_only);
+	}
+
 	LLSplashScreen::update(LLTrans::getString("StartupInitializingVFS"));
 	
 	// Init the VFS
@@ -3360,6 +3395,12 @@ bool LLAppViewer::initCache()
 	std::string static_vfs_index_file;
 	std::string static_vfs_data_file;
 
+	// The mapped store uses its own file names so that switching formats
+	// never feeds one backend the other's index.
+	const BOOL use_mapped_vfs = gSavedSettings.getBOOL("VFSUseMappedStore");
+	const char* vfs_data_file_base = use_mapped_vfs ? VFS_MAPPED_DATA_FILE_BASE : VFS_DATA_FILE_BASE;
+	const char* vfs_index_file_base = use_mapped_vfs ? VFS_MAPPED_INDEX_FILE_BASE : VFS_INDEX_FILE_BASE;
+
 	if (gSavedSettings.getBOOL("AllowMultipleViewers"))
 	{
 		// don't mess with renaming the VFS in this case
@@ -3373,7 +3414,7 @@ bool LLAppViewer::initCache()
 		} while(new_salt == old_salt);
 	}
 
-	old_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u",old_salt);
+	old_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, vfs_data_file_base) + llformat("%u",old_salt);
 
 	// make sure this file exists
 	llstat s;
@@ -3382,7 +3423,7 @@ bool LLAppViewer::initCache()
 	{
 		// doesn't exist, look for a data file
 		std::string mask;
-		mask = VFS_DATA_FILE_BASE;
+		mask = vfs_data_file_base;
 		mask += "*";
 
 		std::string dir;
@@ -3403,7 +3444,7 @@ bool LLAppViewer::initCache()
 		}
 	}
 
-	old_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u",old_salt);
+	old_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, vfs_index_file_base) + llformat("%u",old_salt);
 
 	stat_result = LLFile::stat(old_vfs_index_file, &s);
 	if (stat_result)
@@ -3419,19 +3460,19 @@ bool LLAppViewer::initCache()
 		dir = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, "");
 
 		std::string mask;
-		mask = VFS_DATA_FILE_BASE;
+		mask = vfs_data_file_base;
 		mask += "*";
 
 		gDirUtilp->deleteFilesInDir(dir, mask);
 
-		mask = VFS_INDEX_FILE_BASE;
+		mask = vfs_index_file_base;
 		mask += "*";
 
 		gDirUtilp->deleteFilesInDir(dir, mask);
 	}
 
-	new_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_DATA_FILE_BASE) + llformat("%u", new_salt);
-	new_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, VFS_INDEX_FILE_BASE) + llformat("%u", new_salt);
+	new_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, vfs_data_file_base) + llformat("%u", new_salt);
+	new_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_CACHE, vfs_index_file_base) + llformat("%u", new_salt);
 
 	static_vfs_data_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_data.db2");
 	static_vfs_index_file = gDirUtilp->getExpandedFilename(LL_PATH_APP_SETTINGS, "static_index.db2");
@@ -3456,7 +3497,7 @@ bool LLAppViewer::initCache()
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
-	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
+	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false, use_mapped_vfs);
 	if (!gVFS)
 	{
 		return false;
@@ -3493,11 +3534,40 @@ void LLAppViewer::addOnIdleCallback(const boost::function<void()>& cb)
 	LLDeferredTaskList::instance().addTask(cb);
 }
 
+//static
+std::string LLAppViewer::getXMLCompiledCacheDir()
+{
+	// The cache location picked in the preferences isn't known before the
+	// settings are loaded, so this one lives in the default location.
+	return gDirUtilp->add(gDirUtilp->getCacheDir(true), "xmlcompiled");
+}
+
+void LLAppViewer::setXMLCompiledCacheEnabled(bool enabled)
+{
+	std::string cache_dir = getXMLCompiledCacheDir();
+	if (enabled)
+	{
+		if (!LLXMLCompiledCache::isEnabled())
+		{
+			LLFile::mkdir(gDirUtilp->getCacheDir(true));
+			LLXMLCompiledCache::initCache(cache_dir, true);
+		}
+	}
+	else if (LLFile::isdir(cache_dir))
+	{
+		llinfos << "Removing compiled XML cache at " << cache_dir << llendl;
+		LLXMLCompiledCache::disableCache();
+		gDirUtilp->deleteFilesInDir(cache_dir, "*");
+		LLFile::rmdir(cache_dir);
+	}
+}
+
 void LLAppViewer::purgeCache()
 {
 	LL_INFOS("AppCache") << "Purging Cache and Texture Cache..." << LL_ENDL;
 	LLAppViewer::getTextureCache()->purgeCache(LL_PATH_CACHE);
 	LLVOCache::getInstance()->removeCache(LL_PATH_CACHE);
+	LLMeshDecodedCache::removeCache(LL_PATH_CACHE);
 	std::string mask = "*.*";
 	gDirUtilp->deleteFilesInDir(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, ""), mask);
 }
@@ -3752,6 +3822,13 @@ void LLAppViewer::idle()
 	// here.
 	request_initial_instant_messages();
 
+	// Hand object caches read in the background to their regions, this
+	// is where they send the handshake reply, also during login.
+	if (LLVOCache::hasInstance())
+	{
+		LLVOCache::getInstance()->update();
+	}
+
 	///////////////////////////////////
 	//
 	// Special case idle if still starting up
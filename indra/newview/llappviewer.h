@@ -166,6 +166,7 @@ public:
 	void addOnIdleCallback(const boost::function<void()>& cb); // add a callback to fire (once) when idle
 
 	void purgeCache(); // Clear the local cache. 
+	void setXMLCompiledCacheEnabled(bool enabled); // Creates or removes the compiled XML cache.
 
 	// Metrics policy helper statics.
 	static void metricsUpdateRegion(U64 region_handle);
@@ -191,6 +192,7 @@ private:
 	bool initConfiguration(); // Initialize settings from the command line/config file.
 
 	bool initCache(); // Initialize local client cache.
+	static std::string getXMLCompiledCacheDir();
 	void checkMemory() ;
 
 	// We have switched locations of both Mac and Windows cache, make sure
@@ -38,6 +38,7 @@
 #include "llvoavatar.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
+#include "llmeshskinning.h"
 
 #include "llagent.h" //for gAgent.needsRenderAvatar()
 #include "lldrawable.h"
@@ -1461,12 +1462,66 @@ void LLDrawPoolAvatar::updateRiggedFaceVertexBuffer(LLVOAvatar* avatar, LLFace*
 		}
 	}
 
-	if (sShaderLevel <= 0 && face->mLastSkinTime < avatar->getLastSkinTime())
+	if (sShaderLevel <= 0 && face->mLastSkinTime < avatar->getLastSkinTime() && buffer.notNull())
 	{
-		avatar->updateSoftwareSkinnedVertices(skin, weight, vol_face, buffer);
+		queueSoftwareSkinnedFace(avatar, skin, weight, vol_face, buffer);
 	}
 }
 
+// Faces of the avatar being updated that wait to be skinned on the CPU,
+// with the palette of each skin built once for all the faces that use it.
+static LLMeshSkinningBatch sSkinningBatch;
+static std::map<const LLMeshSkinInfo*, std::pair<U32, U32> > sSkinningPalettes;
+static std::vector<LLPointer<LLVertexBuffer> > sSkinningBuffers;
+
+void LLDrawPoolAvatar::queueSoftwareSkinnedFace(LLVOAvatar* avatar, const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer* buffer)
+{
+	std::map<const LLMeshSkinInfo*, std::pair<U32, U32> >::iterator iter = sSkinningPalettes.find(skin);
+	if (iter == sSkinningPalettes.end())
+	{
+		U32 offset = sSkinningBatch.addPalette(JOINT_COUNT);
+		U32 count = avatar->buildSkinPalette(skin, sSkinningBatch.getPalette(offset));
+		if (!count)
+		{
+			return;
+		}
+		iter = sSkinningPalettes.insert(std::make_pair(skin, std::make_pair(offset, count))).first;
+	}
+
+	LLStrider<LLVector3> position;
+	LLStrider<LLVector3> normal;
+
+	bool has_normal = buffer->hasDataType(LLVertexBuffer::TYPE_NORMAL);
+	buffer->getVertexStrider(position);
+
+	if (has_normal)
+	{
+		buffer->getNormalStrider(normal);
+	}
+
+	LLVector4a* pos = (LLVector4a*) position.get();
+	LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
+
+	U32 count = llmin((U32) buffer->getNumVerts(), (U32) vol_face.mNumVertices);
+	sSkinningBatch.addFace(iter->second.first, iter->second.second, weight, vol_face.mPositions,
+						   norm ? vol_face.mNormals : NULL, pos, norm, count);
+	sSkinningBuffers.push_back(buffer);
+}
+
+static LLFastTimer::DeclareTimer FTM_RIGGED_SKINNING("Software Skinning");
+
+//static
+void LLDrawPoolAvatar::skinQueuedFaces()
+{
+	if (!sSkinningBatch.empty())
+	{
+		LLFastTimer t(FTM_RIGGED_SKINNING);
+		sSkinningBatch.run();
+	}
+	sSkinningPalettes.clear();
+	sSkinningBuffers.clear();
+}
+
 void LLDrawPoolAvatar::renderRigged(LLVOAvatar* avatar, U32 type, bool glow)
 {
 	if ((avatar->isSelf() && !gAgent.needsRenderAvatar()) || !gMeshRepo.meshRezEnabled())
@@ -1748,6 +1803,8 @@ void LLDrawPoolAvatar::updateRiggedVertexBuffers(LLVOAvatar* avatar)
 			updateRiggedFaceVertexBuffer(avatar, face, skin, volume, vol_face);
 		}
 	}
+
+	skinQueuedFaces();
 }
 
 void LLDrawPoolAvatar::renderRiggedSimple(LLVOAvatar* avatar)
@@ -147,6 +147,10 @@ public:
 									  LLVolume* volume,
 									  const LLVolumeFace& vol_face);
 	void updateRiggedVertexBuffers(LLVOAvatar* avatar);
+	void queueSoftwareSkinnedFace(LLVOAvatar* avatar, const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer* buffer);
+	// Skins the faces queued by updateRiggedFaceVertexBuffer() when there
+	// are no avatar shaders.
+	static void skinQueuedFaces();
 
 	void renderRigged(LLVOAvatar* avatar, U32 type, bool glow = false);
 	void renderRiggedSimple(LLVOAvatar* avatar);
@@ -548,7 +548,9 @@ static LLFastTimer::DeclareTimer FTM_FILTER("Filter Inventory");
 void LLFolderView::filter( LLInventoryFilter& filter )
 {
 	LLFastTimer t2(FTM_FILTER);
-	filter.setFilterCount(llclamp(gSavedSettings.getS32("FilterItemsPerFrame"), 1, 5000));
+	static const LLCachedControl<F32> filter_time_per_frame("FilterTimePerFrame");
+	filter.setFilterCount(llclamp(gSavedSettings.getS32("FilterItemsPerFrame"), 1, 5000),
+						  llmax((F32)filter_time_per_frame, 0.f) / 1000.f);
 
 	if (getCompletedFilterGeneration() < filter.getCurrentGeneration())
 	{
@@ -2104,11 +2106,13 @@ void LLFolderView::setShowSingleSelection(BOOL show)
 void LLFolderView::addItemID(const LLUUID& id, LLFolderViewItem* itemp)
 {
 	mItemMap[id] = itemp;
+	mSearchIndex.add(id, itemp->getSearchableLabel());
 }
 
 void LLFolderView::removeItemID(const LLUUID& id)
 {
 	mItemMap.erase(id);
+	mSearchIndex.remove(id);
 }
 
 LLFastTimer::DeclareTimer FTM_GET_ITEM_BY_ID("Get FolderViewItem by ID");
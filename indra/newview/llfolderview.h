@@ -42,6 +42,7 @@
 #define LL_LLFOLDERVIEW_H
 
 #include "llfolderviewitem.h"	// because LLFolderView is-a LLFolderViewFolder
+#include "llfolderviewsearchindex.h"
 
 #include "lluictrl.h"
 #include "v4color.h"
@@ -231,6 +232,8 @@ public:
 	void addItemID(const LLUUID& id, LLFolderViewItem* itemp);
 	void removeItemID(const LLUUID& id);
 	LLFolderViewItem* getItemByID(const LLUUID& id);
+	// The searchable labels of the items added with addItemID().
+	LLFolderViewSearchIndex& getSearchIndex() { return mSearchIndex; }
 	LLFolderViewFolder* getFolderByID(const LLUUID& id);
 
 	void	doIdle();						// Real idle routine
@@ -316,6 +319,7 @@ protected:
 	S32								mMinWidth;
 	S32								mRunningHeight;
 	std::map<LLUUID, LLFolderViewItem*> mItemMap;
+	LLFolderViewSearchIndex			mSearchIndex;
 	BOOL							mDragAndDropThisFrame;
 	
 	LLUUID							mSelectThisID; // if non null, select this item
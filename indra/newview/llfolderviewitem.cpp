@@ -454,7 +454,7 @@ void LLFolderViewItem::filter( LLInventoryFilter& filter)
 
 	setFiltered(passed_filter, filter.getCurrentGeneration());
 	mStringMatchOffset = filter.getStringMatchOffset();
-	filter.decrementFilterCount();
+	filter.decrementFilterCount(!filter.wasRejectedByString());
 
 	if (getRoot()->getDebugFilters())
 	{
@@ -646,6 +646,12 @@ void LLFolderViewItem::updateSearchLabelType()
 		}
 		mSearchable += mSearchableLabelCreator;
 	}
+
+	// The root is still being constructed when it sets its own label.
+	if (mListener && mRoot && mRoot != this)
+	{
+		mRoot->getSearchIndex().update(mListener->getUUID(), mSearchable);
+	}
 }
 
 const std::string& LLFolderViewItem::getSearchableLabel()
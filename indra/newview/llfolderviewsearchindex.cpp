@@ -0,0 +1,303 @@
+/**
+ * @file llfolderviewsearchindex.cpp
+ * @brief Trigram index over the searchable labels of a folder view.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include "llviewerprecompiledheaders.h"
+
+#include "llfolderviewsearchindex.h"
+
+#include <algorithm>
+#include <iterator>
+
+static const U32 NO_MATCH = U32_MAX;
+
+// Three consecutive bytes. Labels and filter strings are both upper cased
+// UTF-8, so characters spanning several bytes need no special care.
+static inline U32 trigram_at(const std::string& str, size_t pos)
+{
+	return ((U32)(U8)str[pos] << 16) | ((U32)(U8)str[pos + 1] << 8) | (U32)(U8)str[pos + 2];
+}
+
+static inline U32 trigram_count(const std::string& str)
+{
+	return str.size() < 3 ? 0 : (U32)str.size() - 2;
+}
+
+LLFolderViewSearchIndex::LLFolderViewSearchIndex()
+:	mPostingEntries(0),
+	mLiveEntries(0),
+	mHasSearch(false)
+{
+}
+
+void LLFolderViewSearchIndex::add(const LLUUID& id, const std::string& label)
+{
+	S32 slot;
+	LLUUIDHashIndex<S32>::const_iterator iter = mSlots.find(id);
+	if (iter != mSlots.end())
+	{
+		slot = iter->second;
+	}
+	else
+	{
+		if (!mFreeSlots.empty())
+		{
+			slot = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		else
+		{
+			slot = (S32)mLabels.size();
+			mLabels.push_back(std::string());
+			mUsed.push_back(0);
+			mMatchOffsets.push_back(NO_MATCH);
+		}
+		mSlots[id] = slot;
+		mUsed[slot] = 1;
+	}
+	setLabel(slot, label);
+}
+
+void LLFolderViewSearchIndex::update(const LLUUID& id, const std::string& label)
+{
+	LLUUIDHashIndex<S32>::const_iterator iter = mSlots.find(id);
+	if (iter != mSlots.end())
+	{
+		setLabel(iter->second, label);
+	}
+}
+
+void LLFolderViewSearchIndex::remove(const LLUUID& id)
+{
+	LLUUIDHashIndex<S32>::const_iterator iter = mSlots.find(id);
+	if (iter == mSlots.end())
+	{
+		return;
+	}
+	S32 slot = iter->second;
+	mSlots.erase(id);
+
+	// Its postings go stale, searches skip unused slots.
+	mLiveEntries -= trigram_count(mLabels[slot]);
+	mLabels[slot].clear();
+	mUsed[slot] = 0;
+	mMatchOffsets[slot] = NO_MATCH;
+	mFreeSlots.push_back(slot);
+}
+
+void LLFolderViewSearchIndex::clear()
+{
+	mSlots.clear();
+	mLabels.clear();
+	mUsed.clear();
+	mFreeSlots.clear();
+	mPostings.clear();
+	mPostingEntries = 0;
+	mLiveEntries = 0;
+	mHasSearch = false;
+	mSearchString.clear();
+	mMatches.clear();
+	mMatchOffsets.clear();
+}
+
+bool LLFolderViewSearchIndex::findMatch(const LLUUID& id, const std::string& sub_string, std::string::size_type& offset)
+{
+	LLUUIDHashIndex<S32>::const_iterator iter = mSlots.find(id);
+	if (iter == mSlots.end())
+	{
+		return false;
+	}
+	if (!mHasSearch || sub_string != mSearchString)
+	{
+		search(sub_string);
+	}
+	U32 match = mMatchOffsets[iter->second];
+	offset = match == NO_MATCH ? std::string::npos : (std::string::size_type)match;
+	return true;
+}
+
+void LLFolderViewSearchIndex::setLabel(S32 slot, const std::string& label)
+{
+	std::string& current = mLabels[slot];
+	if (current == label && !current.empty())
+	{
+		return;
+	}
+	mLiveEntries -= trigram_count(current);
+	current = label;
+
+	// A posting stays sorted while labels come in slot order, a label
+	// that changes later or a reused slot has it sorted before the next
+	// search.
+	U32 count = trigram_count(label);
+	for (U32 i = 0; i < count; ++i)
+	{
+		Posting& posting = mPostings[trigram_at(label, i)];
+		if (!posting.mSlots.empty())
+		{
+			if (posting.mSlots.back() == slot)
+			{
+				continue;
+			}
+			if (posting.mSlots.back() > slot)
+			{
+				posting.mSorted = false;
+			}
+		}
+		posting.mSlots.push_back(slot);
+		++mPostingEntries;
+	}
+	mLiveEntries += count;
+
+	// Keep the last result right for this item.
+	if (mHasSearch)
+	{
+		std::string::size_type offset = label.find(mSearchString);
+		if (offset == std::string::npos)
+		{
+			mMatchOffsets[slot] = NO_MATCH;
+		}
+		else
+		{
+			mMatchOffsets[slot] = (U32)offset;
+			mMatches.push_back(slot);
+		}
+	}
+
+	// Stale entries only cost time while searching, drop them once they
+	// outnumber the live ones.
+	if (mPostingEntries > 2 * mLiveEntries + 65536)
+	{
+		rebuildPostings();
+	}
+}
+
+void LLFolderViewSearchIndex::search(const std::string& sub_string)
+{
+	std::vector<S32> candidates;
+	if (mHasSearch && !mSearchString.empty() && sub_string.find(mSearchString) != std::string::npos)
+	{
+		// Typing on: whatever holds the new string held the old one.
+		candidates.swap(mMatches);
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+	}
+	else
+	{
+		findCandidates(sub_string, candidates);
+	}
+
+	std::fill(mMatchOffsets.begin(), mMatchOffsets.end(), NO_MATCH);
+	mMatches.clear();
+	for (std::vector<S32>::const_iterator iter = candidates.begin(); iter != candidates.end(); ++iter)
+	{
+		S32 slot = *iter;
+		if (!mUsed[slot])
+		{
+			continue;
+		}
+		std::string::size_type offset = mLabels[slot].find(sub_string);
+		if (offset != std::string::npos)
+		{
+			mMatchOffsets[slot] = (U32)offset;
+			mMatches.push_back(slot);
+		}
+	}
+
+	mSearchString = sub_string;
+	mHasSearch = true;
+}
+
+void LLFolderViewSearchIndex::findCandidates(const std::string& sub_string, std::vector<S32>& candidates)
+{
+	candidates.clear();
+	U32 count = trigram_count(sub_string);
+	if (!count)
+	{
+		// Too short to use the index, every label has to be searched.
+		for (S32 slot = 0; slot < (S32)mUsed.size(); ++slot)
+		{
+			if (mUsed[slot])
+			{
+				candidates.push_back(slot);
+			}
+		}
+		return;
+	}
+
+	// Intersect the postings of all trigrams, smallest first.
+	std::vector<std::pair<size_t, Posting*> > postings;
+	for (U32 i = 0; i < count; ++i)
+	{
+		posting_map_t::iterator iter = mPostings.find(trigram_at(sub_string, i));
+		if (iter == mPostings.end())
+		{
+			return;
+		}
+		Posting& posting = iter->second;
+		if (!posting.mSorted)
+		{
+			std::sort(posting.mSlots.begin(), posting.mSlots.end());
+			posting.mSlots.erase(std::unique(posting.mSlots.begin(), posting.mSlots.end()), posting.mSlots.end());
+			posting.mSorted = true;
+		}
+		postings.push_back(std::make_pair(posting.mSlots.size(), &posting));
+	}
+	std::sort(postings.begin(), postings.end());
+
+	candidates = postings[0].second->mSlots;
+	std::vector<S32> intersection;
+	for (U32 i = 1; i < (U32)postings.size() && !candidates.empty(); ++i)
+	{
+		const std::vector<S32>& slots = postings[i].second->mSlots;
+		intersection.clear();
+		std::set_intersection(candidates.begin(), candidates.end(), slots.begin(), slots.end(),
+							  std::back_inserter(intersection));
+		candidates.swap(intersection);
+	}
+}
+
+void LLFolderViewSearchIndex::rebuildPostings()
+{
+	mPostings.clear();
+	mPostingEntries = 0;
+	for (S32 slot = 0; slot < (S32)mLabels.size(); ++slot)
+	{
+		if (!mUsed[slot])
+		{
+			continue;
+		}
+		const std::string& label = mLabels[slot];
+		U32 count = trigram_count(label);
+		for (U32 i = 0; i < count; ++i)
+		{
+			std::vector<S32>& slots = mPostings[trigram_at(label, i)].mSlots;
+			if (slots.empty() || slots.back() != slot)
+			{
+				slots.push_back(slot);
+				++mPostingEntries;
+			}
+		}
+	}
+}
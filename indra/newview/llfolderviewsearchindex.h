@@ -0,0 +1,87 @@
+/**
+ * @file llfolderviewsearchindex.h
+ * @brief Trigram index over the searchable labels of a folder view.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLFOLDERVIEWSEARCHINDEX_H
+#define LL_LLFOLDERVIEWSEARCHINDEX_H
+
+#include <string>
+#include <vector>
+#include <boost/unordered_map.hpp>
+
+#include "lluuidhashindex.h"
+
+// Keeps a copy of the searchable label of every item of a folder view,
+// and for every three byte sequence the items whose label holds it, so
+// that a filter sub-string is resolved to the matching items once instead
+// of searching every label. The result of the last search is kept: a
+// search for a string that contains the previous one only looks at the
+// items that matched before, and items whose label changes are checked
+// again as they are updated.
+class LLFolderViewSearchIndex
+{
+public:
+	LLFolderViewSearchIndex();
+
+	// Indexes the label of an item, replacing the one it had.
+	void add(const LLUUID& id, const std::string& label);
+	// Like add() but ignores items that aren't indexed.
+	void update(const LLUUID& id, const std::string& label);
+	void remove(const LLUUID& id);
+	void clear();
+
+	// Sets offset to where sub_string starts in the label of item id, or to
+	// std::string::npos. Returns false when the item isn't indexed.
+	bool findMatch(const LLUUID& id, const std::string& sub_string, std::string::size_type& offset);
+
+private:
+	void setLabel(S32 slot, const std::string& label);
+	void search(const std::string& sub_string);
+	void findCandidates(const std::string& sub_string, std::vector<S32>& candidates);
+	void rebuildPostings();
+
+	struct Posting
+	{
+		Posting() : mSorted(true) { }
+		std::vector<S32> mSlots;	// may hold stale and repeated slots
+		bool mSorted;
+	};
+	typedef boost::unordered_map<U32, Posting> posting_map_t;
+
+	LLUUIDHashIndex<S32> mSlots;
+	std::vector<std::string> mLabels;
+	std::vector<U8> mUsed;
+	std::vector<S32> mFreeSlots;
+
+	posting_map_t mPostings;
+	U32 mPostingEntries;	// in all postings
+	U32 mLiveEntries;		// for the labels as they are now
+
+	bool mHasSearch;
+	std::string mSearchString;
+	std::vector<S32> mMatches;			// slots that matched, may be repeated
+	std::vector<U32> mMatchOffsets;		// per slot
+};
+
+#endif // LL_LLFOLDERVIEWSEARCHINDEX_H
@@ -76,6 +76,9 @@ LLInventoryFilter::LLInventoryFilter(const std::string& name)
 	mMustPassGeneration = S32_MAX;
 	mMinRequiredGeneration = 0;
 	mFilterCount = 0;
+	mFilterTimeLimit = 0.f;
+	mFilterChecks = 0;
+	mRejectedByString = false;
 	mNextFilterGeneration = mFilterGeneration + 1;
 
 	mLastLogoff = gSavedPerAccountSettings.getU32("LastLogoff");
@@ -96,6 +99,20 @@ BOOL LLInventoryFilter::check(LLFolderViewItem* item)
 	const LLUUID item_id = listener ? listener->getUUID() : LLUUID::null;
 	const bool passed_clipboard = item_id.notNull() ? checkAgainstClipboard(item_id) : true;
 
+	// The sub-string goes first: the folder view's search index answers
+	// it without looking at the label, and most items fail it.
+	mRejectedByString = false;
+	mSubStringMatchOffset = std::string::npos;
+	if (mFilterSubString.size())
+	{
+		const std::string& label = item->getSearchableLabel();
+		LLFolderView* root = item->getRoot();
+		if (!root || !root->getSearchIndex().findMatch(item_id, mFilterSubString, mSubStringMatchOffset))
+		{
+			mSubStringMatchOffset = label.find(mFilterSubString);
+		}
+	}
+
 	// If it's a folder and we're showing all folders, return automatically.
 	const BOOL is_folder = (dynamic_cast<const LLFolderViewFolder*>(item) != NULL);
 	if (is_folder && (mFilterOps.mShowFolderState == LLInventoryFilter::SHOW_ALL_FOLDERS))
@@ -103,7 +120,11 @@ BOOL LLInventoryFilter::check(LLFolderViewItem* item)
 		return passed_clipboard;
 	}
 
-	mSubStringMatchOffset = mFilterSubString.size() ? item->getSearchableLabel().find(mFilterSubString) : std::string::npos;
+	if (mFilterSubString.size() && mSubStringMatchOffset == std::string::npos)
+	{
+		mRejectedByString = true;
+		return FALSE;
+	}
 
 	const BOOL passed_filtertype = checkAgainstFilterType(item);
 	const BOOL passed_permissions = checkAgainstPermissions(item);
@@ -113,8 +134,7 @@ BOOL LLInventoryFilter::check(LLFolderViewItem* item)
 						 passed_permissions &&
 						 passed_filterlink &&
 						 passed_clipboard &&
-						 passed_wearable &&
-						 (mFilterSubString.size() == 0 || mSubStringMatchOffset != std::string::npos));
+						 passed_wearable);
 
 	return passed;
 }
@@ -1003,18 +1023,30 @@ const std::string& LLInventoryFilter::getName() const
 	return mName; 
 }
 
-void LLInventoryFilter::setFilterCount(S32 count) 
+void LLInventoryFilter::setFilterCount(S32 count, F32 time_limit) 
 { 
 	mFilterCount = count; 
+	mFilterTimeLimit = time_limit;
+	mFilterChecks = 0;
+	mFilterTimer.reset();
 }
 S32 LLInventoryFilter::getFilterCount() const
 {
 	return mFilterCount;
 }
 
-void LLInventoryFilter::decrementFilterCount() 
+void LLInventoryFilter::decrementFilterCount(bool checked_in_full) 
 { 
-	mFilterCount--; 
+	if (checked_in_full)
+	{
+		mFilterCount--; 
+	}
+	// Looking at the clock every item would cost more than the cheap checks.
+	if (mFilterTimeLimit > 0.f && !(++mFilterChecks & 31) &&
+		mFilterTimer.getElapsedTimeF32() > mFilterTimeLimit)
+	{
+		mFilterCount = -1;
+	}
 }
 
 S32 LLInventoryFilter::getCurrentGeneration() const 
@@ -29,6 +29,7 @@
 
 #include "llinventorytype.h"
 #include "llpermissionsflags.h"
+#include "lltimer.h"
 
 class LLFolderViewItem;
 class LLFolderViewFolder;
@@ -154,9 +155,14 @@ public:
 	// +-------------------------------------------------------------------+
 	// + Count
 	// +-------------------------------------------------------------------+
-	void 				setFilterCount(S32 count);
+	// Starts the budget of a frame: count items that are checked in full,
+	// and at most time_limit seconds (none when 0) overall.
+	void 				setFilterCount(S32 count, F32 time_limit = 0.f);
 	S32 				getFilterCount() const;
-	void 				decrementFilterCount();
+	// Items that failed on the search index alone only count against
+	// the time limit.
+	void 				decrementFilterCount(bool checked_in_full = true);
+	bool				wasRejectedByString() const { return mRejectedByString; }
 
 	// +-------------------------------------------------------------------+
 	// + Default
@@ -215,6 +221,10 @@ private:
 	S32						mNextFilterGeneration;
 
 	S32						mFilterCount;
+	F32						mFilterTimeLimit;
+	LLTimer					mFilterTimer;
+	U32						mFilterChecks;
+	bool					mRejectedByString;
 	EFilterBehavior 		mFilterBehavior;
 
 	BOOL 					mModified;
@@ -48,6 +48,8 @@
 #include "llcallbacklist.h"
 #include "llvoavatarself.h"
 #include "llgesturemgr.h"
+#include "llinventorycache.h"
+#include "llthreadpool.h"
 #include <typeinfo>
 #include "statemachine/aievent.h"
 
@@ -75,6 +77,7 @@ BOOL LLInventoryModel::sFirstTimeInViewer2 = TRUE;
 
 //BOOL decompress_file(const char* src_filename, const char* dst_filename);
 const char CACHE_FORMAT_STRING[] = "%s.inv"; 
+const char CACHE_BINARY_FORMAT_STRING[] = "%s.invb";
 
 struct InventoryIDPtrLess
 {
@@ -1588,6 +1591,17 @@ void LLInventoryModel::cache(
 	std::string inventory_filename;
 	agent_id.toString(agent_id_str);
 	std::string path(gDirUtilp->getExpandedFilename(LL_PATH_CACHE, agent_id_str));
+	std::string binary_filename = llformat(CACHE_BINARY_FORMAT_STRING, path.c_str());
+	if (saveToBinaryFile(binary_filename, categories, items))
+	{
+		// The text cache would only be read if the binary one goes missing,
+		// and it would be older than it by then.
+		inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
+		LLFile::remove(inventory_filename + ".gz");
+		return;
+	}
+
+	llwarns << "Unable to write " << binary_filename << ", falling back to the text cache" << llendl;
 	inventory_filename = llformat(CACHE_FORMAT_STRING, path.c_str());
 	saveToFile(inventory_filename, categories, items);
 	std::string gzip_filename(inventory_filename);
@@ -1624,7 +1638,7 @@ void LLInventoryModel::addCategory(LLViewerInventoryCategory* category)
 	}
 }
 
-void LLInventoryModel::addItem(LLViewerInventoryItem* item)
+bool LLInventoryModel::addItem(LLViewerInventoryItem* item)
 {
 	llassert(item);
 	if(item)
@@ -1636,7 +1650,7 @@ void LLInventoryModel::addItem(LLViewerInventoryItem* item)
 		    || LLAssetType::lookup(item->getType()) == LLAssetType::badLookup())
 		{
 			llwarns << "Got bad asset type for item [ name: " << item->getName() << " type: " << item->getType() << " inv-type: " << item->getInventoryType() << " ], ignoring." << llendl;
-			return;
+			return false;
 		}
 
 		// This condition means that we tried to add a link without the baseobj being in memory.
@@ -1647,7 +1661,9 @@ void LLInventoryModel::addItem(LLViewerInventoryItem* item)
 		}
 
 		mItemMap[item->getUUID()] = item;
+		return true;
 	}
+	return false;
 }
 
 // Empty the entire contents
@@ -1664,6 +1680,7 @@ void LLInventoryModel::empty()
 		mParentChildItemTree.end(),
 		DeletePairedPointer());
 	mParentChildItemTree.clear();
+	mCachedItemParents.clear();
 	mCategoryMap.clear(); // remove all references (should delete entries)
 	mItemMap.clear(); // remove all references (should delete entries)
 	mLastItem = NULL;
@@ -1900,26 +1917,52 @@ bool LLInventoryModel::loadSkeleton(
 		const S32 NO_VERSION = LLViewerInventoryCategory::VERSION_UNKNOWN;
 		std::string gzip_filename(inventory_filename);
 		gzip_filename.append(".gz");
-		LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
 		bool remove_inventory_file = false;
-		if (fp)
+		bool is_cache_obsolete = false;
+		item_group_vec_t item_groups;
+		bool loaded = loadFromBinaryFile(llformat(CACHE_BINARY_FORMAT_STRING, path.c_str()),
+										 categories, items, item_groups);
+		if (!loaded)
 		{
-			fclose(fp);
-			fp = NULL;
-			if (gunzip_file(gzip_filename, inventory_filename))
+			LLFILE* fp = LLFile::fopen(gzip_filename, "rb");
+			if (fp)
 			{
-				// we only want to remove the inventory file if it was
-				// gzipped before we loaded, and we successfully
-				// gunziped it.
-				remove_inventory_file = true;
+				fclose(fp);
+				fp = NULL;
+				if (gunzip_file(gzip_filename, inventory_filename))
+				{
+					// we only want to remove the inventory file if it was
+					// gzipped before we loaded, and we successfully
+					// gunziped it.
+					remove_inventory_file = true;
+				}
+				else
+				{
+					llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				}
 			}
-			else
+			loaded = loadFromFile(inventory_filename, categories, items, is_cache_obsolete);
+			if (loaded)
 			{
-				llinfos << "Unable to gunzip " << gzip_filename << llendl;
+				// The text cache isn't sorted, group runs of items that
+				// share a parent.
+				S32 count = items.count();
+				for (S32 i = 0; i < count; ++i)
+				{
+					const LLUUID& parent_id = items[i]->getParentUUID();
+					if (item_groups.empty() || item_groups.back().mParentID != parent_id)
+					{
+						ItemGroup group;
+						group.mParentID = parent_id;
+						group.mFirst = i;
+						group.mCount = 0;
+						item_groups.push_back(group);
+					}
+					++item_groups.back().mCount;
+				}
 			}
 		}
-		bool is_cache_obsolete = false;
-		if (loadFromFile(inventory_filename, categories, items, is_cache_obsolete))
+		if (loaded)
 		{
 			// We were able to find a cache of files. So, use what we
 			// found to generate a set of categories we should add. We
@@ -1960,6 +2003,8 @@ bool LLInventoryModel::loadSkeleton(
 			// go ahead and add the cats returned during the download
 			std::set<LLUUID>::const_iterator not_cached_id = cached_ids.end();
 			cached_category_count = cached_ids.size();
+			mCategoryMap.reserve(mCategoryMap.size() + temp_cats.size());
+			mItemMap.reserve(mItemMap.size() + items.count());
 			for(cat_set_t::iterator it = temp_cats.begin(); it != temp_cats.end(); ++it)
 			{
 				if (cached_ids.find((*it)->getUUID()) == not_cached_id)
@@ -1975,43 +2020,75 @@ bool LLInventoryModel::loadSkeleton(
 			}
 
 			// Add all the items loaded which are parented to a
-			// category with a correctly cached parent
+			// category with a correctly cached parent. Each folder is
+			// looked up once, and its item array is filled here so that
+			// buildParentChildMap() doesn't have to visit these items again.
 			S32 bad_link_count = 0;
 			S32 good_link_count = 0;
 			S32 recovered_link_count = 0;
 			cat_map_t::iterator unparented = mCategoryMap.end();
-			for(item_array_t::const_iterator item_iter = items.begin();
-				item_iter != items.end();
-				++item_iter)
+			for(item_group_vec_t::const_iterator group_iter = item_groups.begin();
+				group_iter != item_groups.end();
+				++group_iter)
 			{
-				LLViewerInventoryItem *item = (*item_iter).get();
-				const cat_map_t::iterator cit = mCategoryMap.find(item->getParentUUID());
-				
-				if(cit != unparented)
+				const ItemGroup& group = *group_iter;
+				const cat_map_t::iterator cit = mCategoryMap.find(group.mParentID);
+				if(cit == unparented)
 				{
-					const LLViewerInventoryCategory* cat = cit->second.get();
-					if(cat->getVersion() != NO_VERSION)
+					continue;
+				}
+				const LLViewerInventoryCategory* cat = cit->second.get();
+				if(cat->getVersion() == NO_VERSION)
+				{
+					continue;
+				}
+
+				// A folder may have more than one run of items in the cache,
+				// the later ones add to the array of the first.
+				item_array_t* itemsp = NULL;
+				if (mParentChildItemTree.count(group.mParentID) == 0)
+				{
+					itemsp = new item_array_t;
+					itemsp->reserve(group.mCount);
+					mParentChildItemTree[group.mParentID] = itemsp;
+					mCachedItemParents.insert(group.mParentID);
+				}
+				else if (mCachedItemParents.count(group.mParentID))
+				{
+					itemsp = mParentChildItemTree[group.mParentID];
+				}
+
+				S32 added = 0;
+				for (S32 i = group.mFirst; i < group.mFirst + group.mCount; ++i)
+				{
+					LLViewerInventoryItem *item = items[i].get();
+					if (item->getUUID().isNull())
 					{
-						// This can happen if the linked object's baseobj is removed from the cache but the linked object is still in the cache.
-						if (item->getIsBrokenLink())
-						{
-							//bad_link_count++;
-							lldebugs << "Attempted to add cached link item without baseobj present ( name: "
-									 << item->getName() << " itemID: " << item->getUUID()
-									 << " assetID: " << item->getAssetUUID()
-									 << " ).  Ignoring and invalidating " << cat->getName() << " . " << llendl;
-							possible_broken_links.push_back(item);
-							continue;
-						}
-						else if (item->getIsLinkType())
-						{
-							good_link_count++;
-						}
-						addItem(item);
-						cached_item_count += 1;
-						++child_counts[cat->getUUID()];
+						continue;
+					}
+					// This can happen if the linked object's baseobj is removed from the cache but the linked object is still in the cache.
+					if (item->getIsBrokenLink())
+					{
+						//bad_link_count++;
+						lldebugs << "Attempted to add cached link item without baseobj present ( name: "
+								 << item->getName() << " itemID: " << item->getUUID()
+								 << " assetID: " << item->getAssetUUID()
+								 << " ).  Ignoring and invalidating " << cat->getName() << " . " << llendl;
+						possible_broken_links.push_back(item);
+						continue;
+					}
+					else if (item->getIsLinkType())
+					{
+						good_link_count++;
+					}
+					if (addItem(item) && itemsp)
+					{
+						itemsp->put(item);
 					}
+					++added;
 				}
+				cached_item_count += added;
+				child_counts[group.mParentID].mValue += added;
 			}
 			if (possible_broken_links.size() > 0)
 			{
@@ -2031,7 +2108,10 @@ bool LLInventoryModel::loadSkeleton(
 					else
 					{
 						// was marked as broken because of loading order, its actually fine to load
-						addItem(item);
+						if (addItem(item) && mCachedItemParents.count(cat->getUUID()))
+						{
+							mParentChildItemTree[cat->getUUID()]->put(item);
+						}
 						cached_item_count += 1;
 						++child_counts[cat->getUUID()];
 						recovered_link_count++;
@@ -2223,17 +2303,23 @@ void LLInventoryModel::buildParentChildMap()
 
 	// Now the items. We allocated in the last step, so now all we
 	// have to do is iterate over the items and put them in the right
-	// place.
+	// place. Items of folders loadSkeleton() filled are there already.
 	item_array_t items;
 	if(!mItemMap.empty())
 	{
 		LLPointer<LLViewerInventoryItem> item;
+		const bool check_cached = !mCachedItemParents.empty();
 		for(item_map_t::iterator iit = mItemMap.begin(); iit != mItemMap.end(); ++iit)
 		{
 			item = (*iit).second;
+			if (check_cached && mCachedItemParents.count(item->getParentUUID()))
+			{
+				continue;
+			}
 			items.put(item);
 		}
 	}
+	mCachedItemParents.clear();
 	count = items.count();
 	lost = 0;
 	uuid_vec_t lost_item_ids;
@@ -2313,6 +2399,9 @@ void LLInventoryModel::buildParentChildMap()
 			
 			std::string name = "My Inventory";
 			LLUUID prev_root_id = mRootFolderID;
+			// The index is hashed, so pick among several candidates by
+			// version and then by id rather than by the order we meet them.
+			LLViewerInventoryCategory* best_root = NULL;
 			for (parent_cat_map_t::const_iterator it = mParentChildCategoryTree.begin(),
 					 it_end = mParentChildCategoryTree.end(); it != it_end; ++it)
 			{
@@ -2320,20 +2409,27 @@ void LLInventoryModel::buildParentChildMap()
 				for (cat_array_t::const_iterator cat_it = cat_array->begin(),
 						 cat_it_end = cat_array->end(); cat_it != cat_it_end; ++cat_it)
 					{
-					LLPointer<LLViewerInventoryCategory> category = *cat_it;
+					LLViewerInventoryCategory* category = *cat_it;
 
 					if(category && category->getPreferredType() != LLFolderType::FT_ROOT_INVENTORY)
 						continue;
 					if ( category && 0 == LLStringUtil::compareInsensitive(name, category->getName()) )
 					{
-						if(category->getUUID()!=mRootFolderID)
+						if (!best_root
+							|| category->getVersion() > best_root->getVersion()
+							|| (category->getVersion() == best_root->getVersion()
+								&& category->getUUID() < best_root->getUUID()))
 						{
-							LLUUID& new_inv_root_folder_id = const_cast<LLUUID&>(mRootFolderID);
-							new_inv_root_folder_id = category->getUUID();
+							best_root = category;
 						}
 					}
 				}
 			}
+			if (best_root && best_root->getUUID() != mRootFolderID)
+			{
+				LLUUID& new_inv_root_folder_id = const_cast<LLUUID&>(mRootFolderID);
+				new_inv_root_folder_id = best_root->getUUID();
+			}
 
 			// 'My Inventory',
 			// root of the agent's inv found.
@@ -2520,6 +2616,96 @@ bool LLInventoryModel::saveToFile(const std::string& filename,
 	return true;
 }
 
+namespace
+{
+	// Decodes cached items straight into viewer items.
+	class LLViewerItemFactory : public LLInventoryCacheReader::ItemFactory
+	{
+	public:
+		/*virtual*/ LLInventoryItem* createItem() const
+		{
+			return new LLViewerInventoryItem;
+		}
+	};
+}
+
+// static
+bool LLInventoryModel::loadFromBinaryFile(const std::string& filename,
+										  cat_array_t& categories,
+										  item_array_t& items,
+										  item_group_vec_t& item_groups)
+{
+	LLInventoryCacheReader reader;
+	if (!reader.open(filename))
+	{
+		if (LLFile::isfile(filename))
+		{
+			llwarns << "Invalid or outdated inventory cache " << filename << ", removing" << llendl;
+			LLFile::remove(filename);
+		}
+		return false;
+	}
+	llinfos << "LLInventoryModel::loadFromBinaryFile(" << filename << ")" << llendl;
+
+	S32 count = reader.getNumCategories();
+	categories.reserve(count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLInventoryCache::CategoryRecord& record = reader.getCategory(i);
+		LLPointer<LLViewerInventoryCategory> cat =
+			new LLViewerInventoryCategory(record.mID, record.mParentID,
+										  (LLFolderType::EType)record.mPreferredType,
+										  reader.getString(record.mName), record.mOwnerID);
+		cat->setVersion(record.mVersion);
+		categories.put(cat);
+	}
+
+	LLInventoryCacheReader::item_vec_t decoded;
+	reader.decodeItems(LLViewerItemFactory(), decoded, LLThreadPool::getInstance());
+	items.reserve(decoded.size());
+	for (LLInventoryCacheReader::item_vec_t::const_iterator iter = decoded.begin();
+		 iter != decoded.end(); ++iter)
+	{
+		items.put(static_cast<LLViewerInventoryItem*>(iter->get()));
+	}
+
+	count = reader.getNumGroups();
+	item_groups.resize(count);
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLInventoryCache::GroupRecord& record = reader.getGroup(i);
+		item_groups[i].mParentID = record.mParentID;
+		item_groups[i].mFirst = (S32)record.mFirstItem;
+		item_groups[i].mCount = (S32)record.mNumItems;
+	}
+	return true;
+}
+
+// static
+bool LLInventoryModel::saveToBinaryFile(const std::string& filename,
+										const cat_array_t& categories,
+										const item_array_t& items)
+{
+	llinfos << "LLInventoryModel::saveToBinaryFile(" << filename << ")" << llendl;
+	LLInventoryCacheWriter writer;
+	S32 count = categories.count();
+	for (S32 i = 0; i < count; ++i)
+	{
+		const LLViewerInventoryCategory* cat = categories[i];
+		if (cat->getVersion() != LLViewerInventoryCategory::VERSION_UNKNOWN)
+		{
+			writer.addCategory(cat->getUUID(), cat->getParentUUID(), cat->getOwnerID(),
+							   cat->getVersion(), cat->getPreferredType(), cat->getName());
+		}
+	}
+	count = items.count();
+	for (S32 i = 0; i < count; ++i)
+	{
+		writer.addItem(*items[i]);
+	}
+	return writer.write(filename);
+}
+
 // message handling functionality
 // static
 void LLInventoryModel::registerCallbacks(LLMessageSystem* msg)
@@ -33,6 +33,7 @@
 #include "llframetimer.h"
 #include "llhttpclient.h"
 #include "lluuid.h"
+#include "lluuidhashindex.h"
 #include "llpermissionsflags.h"
 #include "llstring.h"
 
@@ -154,16 +155,21 @@ private:
 	// information in a lot of different ways so we can access
 	// the inventory using several different identifiers.
 	// mInventory member data is the 'master' list of inventory, and
-	// mCategoryMap and mItemMap store uuid->object mappings. 
-	typedef std::map<LLUUID, LLPointer<LLViewerInventoryCategory> > cat_map_t;
-	typedef std::map<LLUUID, LLPointer<LLViewerInventoryItem> > item_map_t;
+	// mCategoryMap and mItemMap store uuid->object mappings. They are
+	// hash indices since nothing depends on their order and lookups
+	// by id happen for every folder and item visited.
+	typedef LLUUIDHashIndex<LLPointer<LLViewerInventoryCategory> > cat_map_t;
+	typedef LLUUIDHashIndex<LLPointer<LLViewerInventoryItem> > item_map_t;
 	cat_map_t mCategoryMap;
 	item_map_t mItemMap;
 	// This last set of indices is used to map parents to children.
-	typedef std::map<LLUUID, cat_array_t*> parent_cat_map_t;
-	typedef std::map<LLUUID, item_array_t*> parent_item_map_t;
+	typedef LLUUIDHashIndex<cat_array_t*> parent_cat_map_t;
+	typedef LLUUIDHashIndex<item_array_t*> parent_item_map_t;
 	parent_cat_map_t mParentChildCategoryTree;
 	parent_item_map_t mParentChildItemTree;
+	// Folders whose entry in mParentChildItemTree was filled while
+	// loading the cache, buildParentChildMap() leaves their items alone.
+	std::set<LLUUID> mCachedItemParents;
 
 	//--------------------------------------------------------------------
 	// Login
@@ -407,7 +413,8 @@ public:
 	// should be passed pointers of newly created objects, and the
 	// instance will take over the memory management from there.
 	void addCategory(LLViewerInventoryCategory* category);
-	void addItem(LLViewerInventoryItem* item);
+	// Returns false when the item was refused.
+	bool addItem(LLViewerInventoryItem* item);
 
 /**                    Mutators
  **                                                                            **
@@ -524,6 +531,15 @@ public:
 	//--------------------------------------------------------------------
 protected:
 	friend class LLLocalInventory;
+	// Items that share a parent, consecutive entries of an item_array_t.
+	struct ItemGroup
+	{
+		LLUUID mParentID;
+		S32 mFirst;
+		S32 mCount;
+	};
+	typedef std::vector<ItemGroup> item_group_vec_t;
+
 	static bool loadFromFile(const std::string& filename,
 							 cat_array_t& categories,
 							 item_array_t& items,
@@ -531,6 +547,15 @@ protected:
 	static bool saveToFile(const std::string& filename,
 						   const cat_array_t& categories,
 						   const item_array_t& items); 
+	// The binary cache, decoded on the thread pool. Its items come
+	// sorted by parent, item_groups tells where each parent starts.
+	static bool loadFromBinaryFile(const std::string& filename,
+								   cat_array_t& categories,
+								   item_array_t& items,
+								   item_group_vec_t& item_groups);
+	static bool saveToBinaryFile(const std::string& filename,
+								 const cat_array_t& categories,
+								 const item_array_t& items);
 
 	//--------------------------------------------------------------------
 	// Message handling functionality
@@ -0,0 +1,199 @@
+/**
+ * @file llmeshdecodedcache.cpp
+ * @brief Disk cache of decoded mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshdecodedcache.h"
+
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llmappedfile.h"
+#include "llvolume.h"
+
+static const std::string MESH_DECODED_CACHE_DIRNAME("meshdecoded");
+static const U32 MESH_DECODED_CACHE_MAGIC = 0x4c4d4453;	// "SDML"
+// Bump when the layout of LLVolume::packDecodedFaces() or the decode
+// in LLVolume::unpackVolumeFaces() changes.
+static const U32 MESH_DECODED_CACHE_VERSION = 1;
+
+struct LLMeshDecodedFileHeader
+{
+	U32 mMagic;
+	U32 mVersion;
+	U8 mMeshID[UUID_BYTES];
+	S32 mLOD;
+	U32 mSculptFlags;
+	S32 mSourceSize;
+	U32 mDataSize;
+	U32 mPad[2];	// the faces start 16 byte aligned
+};
+
+std::string LLMeshDecodedCache::sCacheDir;
+bool LLMeshDecodedCache::sReadOnly = false;
+LLAtomicU32 LLMeshDecodedCache::sHits;
+LLAtomicU32 LLMeshDecodedCache::sMisses;
+LLAtomicU32 LLMeshDecodedCache::sBytesRead;
+LLAtomicU32 LLMeshDecodedCache::sBytesWritten;
+
+static U32 get_sculpt_flags(const LLVolumeParams& mesh_params)
+{
+	return mesh_params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT);
+}
+
+//static
+void LLMeshDecodedCache::initCache(ELLPath location, U32 max_size_mb, bool read_only)
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(location, MESH_DECODED_CACHE_DIRNAME);
+	sReadOnly = read_only;
+	if (!read_only)
+	{
+		LLFile::mkdir(cache_dir);
+	}
+	if (!LLFile::isdir(cache_dir))
+	{
+		llwarns << "No decoded mesh cache, couldn't create " << cache_dir << llendl;
+		return;
+	}
+
+	// The files aren't touched when they are read, so there is nothing to
+	// evict by; start over once the cache outgrew its budget.
+	U64 total_size = 0;
+	U32 file_count = 0;
+	std::string filename;
+	LLDirIterator iter(cache_dir, "*.lod");
+	while (iter.next(filename))
+	{
+		llstat file_info;
+		if (!LLFile::stat(gDirUtilp->add(cache_dir, filename), &file_info))
+		{
+			total_size += file_info.st_size;
+			++file_count;
+		}
+	}
+
+	if (!read_only && total_size > (U64)max_size_mb * 1024 * 1024)
+	{
+		llinfos << "Decoded mesh cache holds " << total_size / (1024 * 1024) << " MB in "
+				<< file_count << " files, more than " << max_size_mb << " MB. Emptying it." << llendl;
+		gDirUtilp->deleteFilesInDir(cache_dir, "*");
+	}
+
+	sCacheDir = cache_dir;
+}
+
+//static
+void LLMeshDecodedCache::removeCache(ELLPath location)
+{
+	std::string cache_dir = gDirUtilp->getExpandedFilename(location, MESH_DECODED_CACHE_DIRNAME);
+	llinfos << "Removing cache at " << cache_dir << llendl;
+	gDirUtilp->deleteFilesInDir(cache_dir, "*");
+	LLFile::rmdir(cache_dir);
+	sCacheDir.clear();
+}
+
+//static
+std::string LLMeshDecodedCache::getFilename(const LLVolumeParams& mesh_params, S32 lod)
+{
+	return gDirUtilp->add(sCacheDir, llformat("%s_%d_%u.lod", mesh_params.getSculptID().asString().c_str(),
+											  lod, get_sculpt_flags(mesh_params)));
+}
+
+//static
+bool LLMeshDecodedCache::read(const LLVolumeParams& mesh_params, S32 lod, S32 source_size, LLVolume* volume)
+{
+	if (!isEnabled())
+	{
+		return false;
+	}
+
+	std::string filename = getFilename(mesh_params, lod);
+	LLMappedFile file;
+	if (!file.open(filename, LLMappedFile::READ_ONLY))
+	{
+		sMisses++;
+		return false;
+	}
+
+	const LLMeshDecodedFileHeader* header = (const LLMeshDecodedFileHeader*) file.getData();
+	bool valid = file.getSize() >= sizeof(LLMeshDecodedFileHeader) &&
+				 header->mMagic == MESH_DECODED_CACHE_MAGIC &&
+				 header->mVersion == MESH_DECODED_CACHE_VERSION &&
+				 !memcmp(header->mMeshID, mesh_params.getSculptID().mData, UUID_BYTES) &&
+				 header->mLOD == lod &&
+				 header->mSculptFlags == get_sculpt_flags(mesh_params) &&
+				 header->mSourceSize == source_size &&
+				 header->mDataSize == file.getSize() - sizeof(LLMeshDecodedFileHeader);
+
+	// header points into the mapping, done with once the file is closed
+	U32 size = valid ? header->mDataSize : 0;
+	if (valid)
+	{
+		valid = volume->unpackDecodedFaces(file.getData() + sizeof(LLMeshDecodedFileHeader), size);
+	}
+	file.close();
+
+	if (!valid)
+	{
+		LL_DEBUGS("MeshStreaming") << "Discarding stale decoded mesh file " << filename << LL_ENDL;
+		if (!sReadOnly)
+		{
+			LLFile::remove(filename);
+		}
+		sMisses++;
+		return false;
+	}
+
+	sHits++;
+	sBytesRead += size;
+	return true;
+}
+
+//static
+void LLMeshDecodedCache::write(const LLVolumeParams& mesh_params, S32 lod, S32 source_size, const LLVolume* volume)
+{
+	if (!isEnabled() || sReadOnly)
+	{
+		return;
+	}
+
+	std::vector<U8> data;
+	volume->packDecodedFaces(data);
+
+	LLMeshDecodedFileHeader header;
+	memset(&header, 0, sizeof(header));
+	header.mMagic = MESH_DECODED_CACHE_MAGIC;
+	header.mVersion = MESH_DECODED_CACHE_VERSION;
+	memcpy(header.mMeshID, mesh_params.getSculptID().mData, UUID_BYTES);
+	header.mLOD = lod;
+	header.mSculptFlags = get_sculpt_flags(mesh_params);
+	header.mSourceSize = source_size;
+	header.mDataSize = data.size();
+
+	if (LLFile::write_replace(getFilename(mesh_params, lod), &header, sizeof(header), data.empty() ? NULL : &data[0], data.size()))
+	{
+		sBytesWritten += sizeof(header) + data.size();
+	}
+}
@@ -0,0 +1,78 @@
+/**
+ * @file llmeshdecodedcache.h
+ * @brief Disk cache of decoded mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLMESHDECODEDCACHE_H
+#define LL_LLMESHDECODEDCACHE_H
+
+#include <string>
+
+#include "llatomic.h"
+#include "lldir.h"
+
+class LLVolume;
+class LLVolumeParams;
+
+// Keeps the decoded faces of mesh LODs on disk, one file per LOD, in the
+// layout of LLVolume::packDecodedFaces(). A mesh LOD read from here is
+// mapped and copied into its faces; the inflate, LLSD parse and
+// dequantization of the asset are skipped. Files are checked against the
+// mesh id, LOD, mirror and invert flags, the size of the LOD block in the
+// asset and a format version, so a stale or foreign file is a miss.
+//
+// read() and write() may be called from any thread once initCache() is
+// done; they only touch their own file.
+class LLMeshDecodedCache
+{
+public:
+	// Creates the cache directory under location. The cache is emptied
+	// when it grew beyond max_size_mb since the last session.
+	static void initCache(ELLPath location, U32 max_size_mb, bool read_only);
+	static void removeCache(ELLPath location);
+	static bool isEnabled()					{ return !sCacheDir.empty(); }
+
+	// Fills volume with the cached faces of lod of the mesh of mesh_params.
+	// source_size is the size of the LOD block in the mesh asset.
+	static bool read(const LLVolumeParams& mesh_params, S32 lod, S32 source_size, LLVolume* volume);
+	// Stores the faces volume decoded for lod.
+	static void write(const LLVolumeParams& mesh_params, S32 lod, S32 source_size, const LLVolume* volume);
+
+	static U32 getHits()					{ return sHits; }
+	static U32 getMisses()					{ return sMisses; }
+	static U32 getBytesRead()				{ return sBytesRead; }
+	static U32 getBytesWritten()			{ return sBytesWritten; }
+
+private:
+	static std::string getFilename(const LLVolumeParams& mesh_params, S32 lod);
+
+	static std::string sCacheDir;
+	static bool sReadOnly;
+
+	static LLAtomicU32 sHits;
+	static LLAtomicU32 sMisses;
+	static LLAtomicU32 sBytesRead;
+	static LLAtomicU32 sBytesWritten;
+};
+
+#endif // LL_LLMESHDECODEDCACHE_H
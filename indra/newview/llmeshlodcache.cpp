@@ -0,0 +1,176 @@
+/**
+ * @file llmeshlodcache.cpp
+ * @brief Shared, size bounded cache of decoded mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llmeshlodcache.h"
+
+LLMeshLODCache::LLMeshLODCache()
+:	mBytes(0),
+	mMaxBytes(0),
+	mHits(0),
+	mMisses(0),
+	mEvictions(0)
+{
+}
+
+LLMeshLODCache::~LLMeshLODCache()
+{
+	clear();
+}
+
+void LLMeshLODCache::setMaxBytes(U64 max_bytes)
+{
+	mMaxBytes = max_bytes;
+	evict(mMaxBytes);
+}
+
+//static
+S32 LLMeshLODCache::getSlot(const LLVolumeParams& mesh_params, S32 lod)
+{
+	if (lod < 0 || lod >= LLVolumeLODGroup::NUM_LODS)
+	{
+		return -1;
+	}
+	U8 sculpt_type = mesh_params.getSculptType();
+	S32 variant = ((sculpt_type & LL_SCULPT_FLAG_MIRROR) ? 1 : 0) + ((sculpt_type & LL_SCULPT_FLAG_INVERT) ? 2 : 0);
+	return variant * LLVolumeLODGroup::NUM_LODS + lod;
+}
+
+LLVolume* LLMeshLODCache::get(const LLVolumeParams& mesh_params, S32 lod)
+{
+	S32 slot = getSlot(mesh_params, lod);
+	if (slot < 0)
+	{
+		return NULL;
+	}
+
+	mesh_map_t::iterator iter = mMeshes.find(mesh_params.getSculptID());
+	if (iter == mMeshes.end() || iter->second.mLOD[slot].mVolume.isNull())
+	{
+		++mMisses;
+		return NULL;
+	}
+
+	LODEntry& entry = iter->second.mLOD[slot];
+	mLRU.splice(mLRU.begin(), mLRU, entry.mLRUIter);
+	++mHits;
+	return entry.mVolume;
+}
+
+void LLMeshLODCache::put(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume)
+{
+	S32 slot = getSlot(mesh_params, lod);
+	if (slot < 0 || !volume)
+	{
+		return;
+	}
+
+	const LLUUID& mesh_id = mesh_params.getSculptID();
+	remove(mesh_id, slot);
+
+	U64 bytes = getVolumeBytes(volume);
+	if (bytes > mMaxBytes)
+	{	// wouldn't fit even in an empty cache
+		return;
+	}
+	evict(mMaxBytes - bytes);
+
+	LODEntry& entry = mMeshes[mesh_id].mLOD[slot];
+	entry.mVolume = volume;
+	entry.mBytes = bytes;
+	entry.mLRUIter = mLRU.insert(mLRU.begin(), lod_key_t(mesh_id, slot));
+	mBytes += bytes;
+}
+
+void LLMeshLODCache::clear()
+{
+	mMeshes.clear();
+	mLRU.clear();
+	mBytes = 0;
+}
+
+void LLMeshLODCache::remove(const LLUUID& mesh_id, S32 slot)
+{
+	mesh_map_t::iterator iter = mMeshes.find(mesh_id);
+	if (iter == mMeshes.end())
+	{
+		return;
+	}
+
+	MeshEntry& mesh = iter->second;
+	LODEntry& entry = mesh.mLOD[slot];
+	if (entry.mVolume.notNull())
+	{
+		mLRU.erase(entry.mLRUIter);
+		mBytes -= entry.mBytes;
+		entry.mVolume = NULL;
+		entry.mBytes = 0;
+	}
+
+	for (S32 i = 0; i < NUM_SLOTS; ++i)
+	{
+		if (mesh.mLOD[i].mVolume.notNull())
+		{
+			return;
+		}
+	}
+	mMeshes.erase(iter);
+}
+
+void LLMeshLODCache::evict(U64 max_bytes)
+{
+	while (mBytes > max_bytes && !mLRU.empty())
+	{
+		lod_key_t key = mLRU.back();
+		remove(key.first, key.second);
+		++mEvictions;
+	}
+}
+
+//static
+U64 LLMeshLODCache::getVolumeBytes(const LLVolume* volume)
+{
+	U64 bytes = sizeof(LLVolume);
+	for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+	{
+		const LLVolumeFace& face = volume->getVolumeFace(i);
+		U64 vertices = face.mNumVertices;
+		// positions, normals and texture coordinates share one block
+		bytes += sizeof(LLVolumeFace) + vertices * (sizeof(LLVector4a) * 2 + sizeof(LLVector2));
+		bytes += face.mNumIndices * sizeof(U16);
+		bytes += face.mEdge.size() * sizeof(S32);
+		if (face.mWeights)
+		{
+			bytes += vertices * sizeof(LLVector4a);
+		}
+		if (face.mTangents)
+		{
+			bytes += vertices * sizeof(LLVector4a);
+		}
+	}
+	return bytes;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file llmeshlodcache.h
+ * @brief Shared, size bounded cache of decoded mesh LODs.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#ifndef LL_LLMESHLODCACHE_H
+#define LL_LLMESHLODCACHE_H
+
+#include <list>
+#include <boost/unordered_map.hpp>
+
+#include "llpointer.h"
+#include "lluuid.h"
+#include "sguuidhash.h"
+#include "llvolumemgr.h"
+
+// Keeps the decoded faces of mesh LODs by mesh asset id and LOD, so that
+// objects using a mesh whose volume was freed, or using it with other
+// volume parameters, copy the faces from here instead of reading and
+// decoding the LOD block again. Least recently used LODs are evicted once
+// the cached faces take more than the budget.
+//
+// Entries hold a reference to the decoded volume; LLVolume isn't thread
+// safe reference counted, so this must only be used from the main thread.
+class LLMeshLODCache
+{
+public:
+	LLMeshLODCache();
+	~LLMeshLODCache();
+
+	// Evicts entries until the cache fits in max_bytes.
+	void setMaxBytes(U64 max_bytes);
+
+	// Returns the decoded volume for lod of the mesh of mesh_params, or
+	// NULL, and counts a hit or a miss. Besides the mesh id, only the
+	// mirror and invert flags of the parameters change what is decoded.
+	LLVolume* get(const LLVolumeParams& mesh_params, S32 lod);
+	// Caches a decoded volume, replacing the one held for that LOD.
+	void put(const LLVolumeParams& mesh_params, S32 lod, LLVolume* volume);
+	void clear();
+
+	U32 getHits() const			{ return mHits; }
+	U32 getMisses() const		{ return mMisses; }
+	U32 getEvictions() const	{ return mEvictions; }
+	U32 getCount() const		{ return (U32)mLRU.size(); }
+	U64 getBytes() const		{ return mBytes; }
+
+	// Memory used by the faces of a volume.
+	static U64 getVolumeBytes(const LLVolume* volume);
+
+private:
+	// Index into MeshEntry::mLOD, -1 for an invalid LOD.
+	static S32 getSlot(const LLVolumeParams& mesh_params, S32 lod);
+	void remove(const LLUUID& mesh_id, S32 slot);
+	void evict(U64 max_bytes);
+
+	typedef std::pair<LLUUID, S32> lod_key_t;
+	typedef std::list<lod_key_t> lru_list_t;
+
+	struct LODEntry
+	{
+		LLPointer<LLVolume> mVolume;
+		U64 mBytes;
+		lru_list_t::iterator mLRUIter;
+	};
+
+	// One slot per LOD for each combination of the mirror and invert flags.
+	enum { NUM_SLOTS = LLVolumeLODGroup::NUM_LODS * 4 };
+
+	struct MeshEntry
+	{
+		LODEntry mLOD[NUM_SLOTS];
+	};
+	typedef boost::unordered_map<LLUUID, MeshEntry> mesh_map_t;
+
+	mesh_map_t mMeshes;
+	lru_list_t mLRU;	// most recently used first
+	U64 mBytes;
+	U64 mMaxBytes;
+
+	U32 mHits;
+	U32 mMisses;
+	U32 mEvictions;
+};
+
+#endif // LL_LLMESHLODCACHE_H
@@ -41,10 +41,12 @@
 #include "lleconomy.h"
 #include "llimagej2c.h"
 #include "llhost.h"
+#include "llmeshdecodedcache.h"
 #include "llnotificationsutil.h"
 #include "llsd.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
+#include "llsdview.h"
 #include "llthread.h"
 #include "llvfile.h"
 #include "llviewercontrol.h"
@@ -1118,6 +1120,15 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 				
 		if (version <= MAX_MESH_VERSION && offset >= 0 && size > 0)
 		{
+			//check for a decoded copy of this LOD first
+			LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+			if (LLMeshDecodedCache::read(mesh_params, lod, size, volume))
+			{
+				LoadedMesh mesh(volume, mesh_params, lod);
+				LLMutexLock lock(mMutex);
+				mLoadedQ.push(mesh);
+				return true;
+			}
 
 			//check VFS for mesh asset
 			LLVFile file(gVFS, mesh_id, LLAssetType::AT_MESH);
@@ -1187,26 +1198,25 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 	U32 header_size = 0;
 	if (data_size > 0)
 	{
-		std::string res_str((char*) data, data_size);
+		static const std::string deprecated_header("<? LLSD/Binary ?>");
 
-		std::string deprecated_header("<? LLSD/Binary ?>");
-
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
+		if (data_size > (S32)deprecated_header.size() &&
+			!memcmp(data, deprecated_header.data(), deprecated_header.size()))
 		{
-			res_str = res_str.substr(deprecated_header.size()+1, data_size);
 			header_size = deprecated_header.size()+1;
 		}
-		data_size = res_str.size();
-
-		std::istringstream stream(res_str);
 
-		if (!LLSDSerialize::fromBinary(header, stream, data_size))
+		// Parse straight from the buffer, the stream parser copied it twice.
+		LLSDBinaryView view;
+		S32 used = view.parse(data + header_size, data_size - header_size);
+		if (used <= 0 || !view.root().isMap())
 		{
 			llwarns << "Mesh header parse error.  Not a valid mesh asset!" << llendl;
 			return false;
 		}
 
-		header_size += stream.tellg();
+		header = view.root().asLLSD();
+		header_size += used;
 	}
 	else
 	{
@@ -1253,6 +1263,8 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 	{
 		if (volume->getNumFaces() > 0)
 		{
+			LLMeshDecodedCache::write(mesh_params, lod, data_size, volume);
+
 			LoadedMesh mesh(volume, mesh_params, lod);
 			{
 				LLMutexLock lock(mMutex);
@@ -1267,7 +1279,9 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 
 bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
-	LLSD skin;
+	// Read the skin straight out of the decompressed block.
+	LLSDBinaryView skin;
+	std::vector<U8> skin_buffer;
 
 	if (data_size > 0)
 	{
@@ -1275,7 +1289,7 @@ bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 dat
 
 		std::istringstream stream(res_str);
 
-		if (!unzip_llsd(skin, stream, data_size))
+		if (!unzip_llsd(skin, skin_buffer, stream, data_size))
 		{
 			llwarns << "Mesh skin info parse error.  Not a valid mesh asset!" << llendl;
 			return false;
@@ -1283,7 +1297,7 @@ bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 dat
 	}
 	
 	{
-		LLMeshSkinInfo info(skin);
+		LLMeshSkinInfo info(skin.root());
 		info.mMeshID = mesh_id;
 
 		//llinfos<<"info pelvis offset"<<info.mPelvisOffset<<llendl;
@@ -1779,6 +1793,7 @@ void LLMeshRepoThread::notifyLoadedMeshes()
 		
 		if (mesh.mVolume && mesh.mVolume->getNumVolumeFaces() > 0)
 		{
+			gMeshRepo.mLODCache.put(mesh.mMeshParams, mesh.mLOD, mesh.mVolume);
 			gMeshRepo.notifyMeshLoaded(mesh.mMeshParams, mesh.mVolume);
 		}
 		else
@@ -2301,6 +2316,14 @@ void LLMeshRepository::shutdown()
 {
 	llinfos << "Shutting down mesh repository." << llendl;
 
+	llinfos << "Decoded mesh LOD cache: " << mLODCache.getHits() << " hits, " << mLODCache.getMisses()
+			<< " misses, " << mLODCache.getEvictions() << " evictions." << llendl;
+	mLODCache.clear();
+	while (!mCachedLODQ.empty())
+	{
+		mCachedLODQ.pop();
+	}
+
 	mThread->mSignal->signal();
 	
 	while (!mThread->isStopped())
@@ -2344,8 +2367,17 @@ S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_para
 		{
 			//first request for this mesh
 			mLoadingMeshes[detail][mesh_params].insert(vobj->getID());
-			mPendingRequests.push_back(LLMeshRepoThread::LODRequest(mesh_params, detail));
-			LLMeshRepository::sLODPending++;
+
+			LLVolume* cached = mLODCache.get(mesh_params, detail);
+			if (cached)
+			{	//decoded already, hand it out with the next loaded meshes
+				mCachedLODQ.push(LLMeshRepoThread::LoadedMesh(cached, mesh_params, detail));
+			}
+			else
+			{
+				mPendingRequests.push_back(LLMeshRepoThread::LODRequest(mesh_params, detail));
+				LLMeshRepository::sLODPending++;
+			}
 		}
 	}
 
@@ -2469,6 +2501,20 @@ void LLMeshRepository::notifyLoadedMeshes()
 	//call completed callbacks on finished decompositions
 	mDecompThread->notifyCompleted();
 
+	static const LLCachedControl<U32> lod_cache_size("MeshLODCacheSize");
+	mLODCache.setMaxBytes((U64)lod_cache_size * 1024 * 1024);
+
+	if (!mCachedLODQ.empty())
+	{	//LODs found in the decoded LOD cache by loadMesh()
+		LLMutexLock lock(mMeshMutex);
+		while (!mCachedLODQ.empty())
+		{
+			LLMeshRepoThread::LoadedMesh mesh = mCachedLODQ.front();
+			mCachedLODQ.pop();
+			notifyMeshLoaded(mesh.mMeshParams, mesh.mVolume);
+		}
+	}
+
 	if (!mThread->mSignal->tryLock())
 	{ //curl thread is churning, wait for it to go idle
 		return;
@@ -29,6 +29,7 @@
 
 #include "llassettype.h"
 #include "llmodel.h"
+#include "llmeshlodcache.h"
 #include "lluuid.h"
 #include "llviewertexture.h"
 #include "llvolume.h"
@@ -521,6 +522,12 @@ public:
 	LLMutex*					mMeshMutex;
 	
 	std::vector<LLMeshRepoThread::LODRequest> mPendingRequests;
+
+	//decoded LODs shared by all volumes using a mesh, main thread only
+	LLMeshLODCache mLODCache;
+
+	//LODs loadMesh() found in mLODCache, to notify with the loaded meshes
+	std::queue<LLMeshRepoThread::LoadedMesh> mCachedLODQ;
 	
 	//list of mesh ids awaiting skin info
 	typedef std::map<LLUUID, std::set<LLUUID> > skin_load_map;
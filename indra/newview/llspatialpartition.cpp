@@ -59,9 +59,20 @@
 #include "llvolumemgr.h"
 #include "llglslshader.h"
 #include "llviewershadermgr.h"
+#include "llthreadpool.h"
 
 static LLFastTimer::DeclareTimer FTM_FRUSTUM_CULL("Frustum Culling");
 static LLFastTimer::DeclareTimer FTM_CULL_REBOUND("Cull Rebound");
+static LLFastTimer::DeclareTimer FTM_CULL_FRUSTUM_PASS("Frustum Pass");
+static LLFastTimer::DeclareTimer FTM_CULL_HUD("Cull HUD");
+static LLFastTimer::DeclareTimer FTM_CULL_TERRAIN("Cull Terrain");
+static LLFastTimer::DeclareTimer FTM_CULL_WATER("Cull Water");
+static LLFastTimer::DeclareTimer FTM_CULL_TREE("Cull Trees");
+static LLFastTimer::DeclareTimer FTM_CULL_PARTICLE("Cull Particles");
+static LLFastTimer::DeclareTimer FTM_CULL_GRASS("Cull Grass");
+static LLFastTimer::DeclareTimer FTM_CULL_VOLUME("Cull Volumes");
+static LLFastTimer::DeclareTimer FTM_CULL_BRIDGE("Cull Bridges");
+static LLFastTimer::DeclareTimer FTM_CULL_OTHER("Cull Other");
 
 const F32 SG_OCCLUSION_FUDGE = 0.25f;
 #define SG_DISCARD_TOLERANCE 0.01f
@@ -788,6 +799,7 @@ void LLSpatialGroup::shift(const LLVector4a &offset)
 	mObjectBounds[0].add(offset);
 	mObjectExtents[0].add(offset);
 	mObjectExtents[1].add(offset);
+	updateFlatBounds();
 
 	if (!mSpatialPartition->mRenderByGroup && 
 		mSpatialPartition->mPartitionType != LLViewerRegion::PARTITION_TREE &&
@@ -1052,7 +1064,9 @@ LLSpatialGroup::LLSpatialGroup(OctreeNode* node, LLSpatialPartition* part) :
 	mDistance(0.f),
 	mDepth(0.f),
 	mLastUpdateDistance(-1.f), 
-	mLastUpdateTime(gFrameTimeSeconds)
+	mLastUpdateTime(gFrameTimeSeconds),
+	mFlatBlock(LLOctreeFlatBounds::NO_BLOCK),
+	mFlatParentBlock(LLOctreeFlatBounds::NO_BLOCK)
 {
 	ll_assert_aligned(this,16);
 	
@@ -1280,6 +1294,18 @@ void LLSpatialGroup::handleDestruction(const TreeNode* node)
 		}
 	}
 
+	//give back our slot in the parent's block and the block for our children
+	if (mFlatParentBlock != LLOctreeFlatBounds::NO_BLOCK)
+	{
+		mSpatialPartition->mFlatBounds.releaseSlot(mFlatParentBlock, mOctreeNode->getOctant(), this);
+		mFlatParentBlock = LLOctreeFlatBounds::NO_BLOCK;
+	}
+	if (mFlatBlock != LLOctreeFlatBounds::NO_BLOCK)
+	{
+		mSpatialPartition->mFlatBounds.freeBlock(mFlatBlock);
+		mFlatBlock = LLOctreeFlatBounds::NO_BLOCK;
+	}
+
 	clearDrawMap();
 	mVertexBuffer = NULL;
 	mBufferMap.clear();
@@ -1365,6 +1391,8 @@ BOOL LLSpatialGroup::rebound()
 {
 	if (!isState(DIRTY))
 	{	//return TRUE if we're not empty
+		//bounds are unchanged, but we may have been moved to a new parent
+		updateFlatBounds();
 		return TRUE;
 	}
 	
@@ -1420,10 +1448,33 @@ BOOL LLSpatialGroup::rebound()
 	}
 	
 	clearState(DIRTY);
+	updateFlatBounds();
 
 	return TRUE;
 }
 
+void LLSpatialGroup::updateFlatBounds()
+{
+	OctreeNode* parent_node = mOctreeNode ? mOctreeNode->getOctParent() : NULL;
+	LLSpatialGroup* parent = parent_node ? (LLSpatialGroup*) parent_node->getListener(0) : NULL;
+	if (!parent)
+	{ //the root has no slot
+		return;
+	}
+
+	LLOctreeFlatBounds& flat_bounds = mSpatialPartition->mFlatBounds;
+	if (parent->mFlatBlock == LLOctreeFlatBounds::NO_BLOCK)
+	{
+		parent->mFlatBlock = flat_bounds.allocateBlock();
+	}
+	if (mFlatParentBlock != LLOctreeFlatBounds::NO_BLOCK && mFlatParentBlock != parent->mFlatBlock)
+	{ //moved to a new parent
+		flat_bounds.releaseSlot(mFlatParentBlock, mOctreeNode->getOctant(), this);
+	}
+	flat_bounds.setBounds(parent->mFlatBlock, mOctreeNode->getOctant(), this, mBounds[0], mBounds[1]);
+	mFlatParentBlock = parent->mFlatBlock;
+}
+
 static LLFastTimer::DeclareTimer FTM_OCCLUSION_READBACK("Readback Occlusion");
 static LLFastTimer::DeclareTimer FTM_OCCLUSION_WAIT("Occlusion Wait");
 
@@ -1779,11 +1830,12 @@ void LLSpatialPartition::shift(const LLVector4a &offset)
 	shifter.traverse(mOctree);
 }
 
+LL_ALIGN_PREFIX(16)
 class LLOctreeCull : public LLSpatialGroup::OctreeTraveler
 {
 public:
-	LLOctreeCull(LLCamera* camera)
-		: mCamera(camera), mRes(0) { }
+	LLOctreeCull(LLCamera* camera, bool far_clip = false)
+		: mPlanes(*camera, far_clip), mCamera(camera), mRes(0), mPrecomputed(-1), mRecord(NULL) { }
 
 	virtual bool earlyFail(LLSpatialGroup* group)
 	{
@@ -1804,7 +1856,16 @@ public:
 	{
 		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
 
-		if (earlyFail(group))
+		//result of the batched test of our parent's children, if any
+		S32 precomputed = mPrecomputed;
+		mPrecomputed = -1;
+
+		U32 entry = 0;
+		if (mRecord)
+		{ //frustum pass only, earlyFail() is done by apply()
+			entry = record(group);
+		}
+		else if (earlyFail(group))
 		{
 			return;
 		}
@@ -1816,20 +1877,129 @@ public:
 		}
 		else
 		{
-			mRes = frustumCheck(group);
+			mRes = precomputed >= 0 ? finishFrustumCheck(group, precomputed) : frustumCheck(group);
 				
-			if (mRes)
+			if (mRes == 1)
+			{ //partially in, run on down testing all children at once
+				traversePartial(n, group);
+			}
+			else if (mRes)
 			{ //at least partially in, run on down
 				LLSpatialGroup::OctreeTraveler::traverse(n);
 			}
 
 			mRes = 0;
 		}
+
+		if (mRecord)
+		{
+			(*mRecord)[entry].mSize = mRecord->size() - entry;
+		}
+	}
+
+	U32 record(LLSpatialGroup* group)
+	{
+		LLSpatialCullRecord::Entry entry;
+		entry.mGroup = group;
+		entry.mSize = 1;
+		entry.mFlags = 0;
+		mRecord->push_back(entry);
+		return mRecord->size() - 1;
+	}
+
+	//frustum pass of the root node n alone, so that the subtrees of its
+	//children can be recorded separately; returns in child_res the mRes
+	//each child's traversal starts with, or -1 if it is not traversed
+	void recordRoot(const LLSpatialGroup::OctreeNode* n, std::vector<S32>& child_res)
+	{
+		LLSpatialGroup* group = (LLSpatialGroup*) n->getListener(0);
+		record(group);
+
+		child_res.assign(n->getChildCount(), -1);
+		mRes = frustumCheck(group);
+		if (mRes)
+		{
+			n->accept(this);
+
+			//mirrors what traverse() does to mRes while walking the children
+			S32 res = mRes;
+			for (U32 i = 0; i < n->getChildCount(); i++)
+			{
+				child_res[i] = res;
+				LLSpatialGroup* child = (LLSpatialGroup*) n->getChild(i)->getListener(0);
+				if (res != 2 && !(res && child->isState(LLSpatialGroup::SKIP_FRUSTUM_CHECK)))
+				{
+					res = 0;
+				}
+			}
+		}
+		mRes = 0;
+	}
+
+	//second pass of a recorded cull, on the main thread
+	void apply(const LLSpatialCullRecord::entry_list_t& entries)
+	{
+		U32 i = 0;
+		while (i < entries.size())
+		{
+			const LLSpatialCullRecord::Entry& entry = entries[i];
+			if (earlyFail(entry.mGroup))
+			{
+				i += entry.mSize;
+				continue;
+			}
+
+			if (entry.mFlags & LLSpatialCullRecord::VISIT)
+			{
+				preprocess(entry.mGroup);
+				if (entry.mFlags & LLSpatialCullRecord::PROCESS)
+				{
+					processGroup(entry.mGroup);
+				}
+			}
+			++i;
+		}
+	}
+
+	void traversePartial(const LLSpatialGroup::OctreeNode* n, LLSpatialGroup* group)
+	{
+		n->accept(this);
+
+		U32 count = n->getChildCount();
+		if (count < 2 || group->mFlatBlock == LLOctreeFlatBounds::NO_BLOCK)
+		{
+			for (U32 i = 0; i < count; i++)
+			{
+				traverse(n->getChild(i));
+			}
+			return;
+		}
+
+		const LLOctreeFlatBounds& flat_bounds = group->mSpatialPartition->mFlatBounds;
+		S32 results[LLOctreeFlatBounds::BLOCK_SLOTS];
+		flat_bounds.frustumCheck(group->mFlatBlock, mPlanes, results);
+
+		for (U32 i = 0; i < count; i++)
+		{
+			const LLSpatialGroup::OctreeNode* child = n->getChild(i);
+			U8 octant = child->getOctant();
+			if (flat_bounds.getOwner(group->mFlatBlock, octant) == child->getListener(0))
+			{ //slot is current, otherwise the child is tested on its own
+				mPrecomputed = results[octant];
+			}
+			traverse(child);
+		}
 	}
 	
 	virtual S32 frustumCheck(const LLSpatialGroup* group)
 	{
-		S32 res = mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
+		return finishFrustumCheck(group, mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]));
+	}
+
+	//applies whatever frustumCheck() adds to the plain box test, which
+	//mPlanes may have done for several groups at once
+	virtual S32 finishFrustumCheck(const LLSpatialGroup* group, S32 res)
+	{
 		if (res != 0)
 		{
 			res = llmin(res, AABBSphereIntersect(group->mExtents[0], group->mExtents[1], mCamera->getOrigin(), mCamera->mFrustumCornerDist));
@@ -1884,6 +2054,17 @@ public:
 	{	
 		LLSpatialGroup* group = (LLSpatialGroup*) branch->getListener(0);
 
+		if (mRecord)
+		{
+			llassert(mRecord->back().mGroup == group);
+			mRecord->back().mFlags = LLSpatialCullRecord::VISIT;
+			if (checkObjects(branch, group))
+			{
+				mRecord->back().mFlags |= LLSpatialCullRecord::PROCESS;
+			}
+			return;
+		}
+
 		preprocess(group);
 		
 		if (checkObjects(branch, group))
@@ -1892,9 +2073,12 @@ public:
 		}
 	}
 
+	LL_ALIGN_16(LLFrustumPlanes4 mPlanes); //planes used by frustumCheck(), subclasses must match
 	LLCamera *mCamera;
 	S32 mRes;
-};
+	S32 mPrecomputed;
+	LLSpatialCullRecord::entry_list_t* mRecord; //if not NULL, only do the frustum pass and record what it reaches
+} LL_ALIGN_POSTFIX(16);
 
 class LLOctreeCullNoFarClip : public LLOctreeCull
 {
@@ -1907,6 +2091,11 @@ public:
 		return mCamera->AABBInFrustumNoFarClip(group->mBounds[0], group->mBounds[1]);
 	}
 
+	virtual S32 finishFrustumCheck(const LLSpatialGroup* group, S32 res)
+	{
+		return res;
+	}
+
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
 		S32 res = mCamera->AABBInFrustumNoFarClip(group->mObjectBounds[0], group->mObjectBounds[1]);
@@ -1918,13 +2107,18 @@ class LLOctreeCullShadow : public LLOctreeCull
 {
 public:
 	LLOctreeCullShadow(LLCamera* camera)
-		: LLOctreeCull(camera) { }
+		: LLOctreeCull(camera, true) { }
 
 	virtual S32 frustumCheck(const LLSpatialGroup* group)
 	{
 		return mCamera->AABBInFrustum(group->mBounds[0], group->mBounds[1]);
 	}
 
+	virtual S32 finishFrustumCheck(const LLSpatialGroup* group, S32 res)
+	{
+		return res;
+	}
+
 	virtual S32 frustumCheckObjects(const LLSpatialGroup* group)
 	{
 		return mCamera->AABBInFrustum(group->mObjectBounds[0], group->mObjectBounds[1]);
@@ -2276,6 +2470,215 @@ S32 LLSpatialPartition::cull(LLCamera &camera, std::vector<LLDrawable *>* result
 	return 0;
 }
 
+enum ECullMode
+{
+	CULL_DEFAULT,
+	CULL_NO_FAR_CLIP,
+	CULL_SHADOW
+};
+
+//the culler cull() would use
+static ECullMode get_cull_mode(const LLSpatialPartition* part)
+{
+	if (LLPipeline::sShadowRender)
+	{
+		return CULL_SHADOW;
+	}
+	if (part->mInfiniteFarClip || !LLPipeline::sUseFarClip)
+	{
+		return CULL_NO_FAR_CLIP;
+	}
+	return CULL_DEFAULT;
+}
+
+static LLFastTimer::DeclareTimer& get_cull_timer(U32 partition_type)
+{
+	switch (partition_type)
+	{
+	case LLViewerRegion::PARTITION_HUD:
+	case LLViewerRegion::PARTITION_HUD_PARTICLE:
+		return FTM_CULL_HUD;
+	case LLViewerRegion::PARTITION_TERRAIN:
+		return FTM_CULL_TERRAIN;
+	case LLViewerRegion::PARTITION_VOIDWATER:
+	case LLViewerRegion::PARTITION_WATER:
+		return FTM_CULL_WATER;
+	case LLViewerRegion::PARTITION_TREE:
+		return FTM_CULL_TREE;
+	case LLViewerRegion::PARTITION_PARTICLE:
+		return FTM_CULL_PARTICLE;
+	case LLViewerRegion::PARTITION_GRASS:
+		return FTM_CULL_GRASS;
+	case LLViewerRegion::PARTITION_VOLUME:
+		return FTM_CULL_VOLUME;
+	case LLViewerRegion::PARTITION_BRIDGE:
+		return FTM_CULL_BRIDGE;
+	default:
+		return FTM_CULL_OTHER;
+	}
+}
+
+//frustum pass of one subtree, run on a pool thread
+class LLSpatialCullJob : public LLThreadPool::Job
+{
+public:
+	LLSpatialCullJob(LLCamera* camera, ECullMode mode, const LLSpatialGroup::OctreeNode* node, S32 res)
+		: mCamera(camera), mMode(mode), mNode(node), mRes(res) { }
+
+	/*virtual*/ void run()
+	{
+		switch (mMode)
+		{
+		case CULL_SHADOW:
+			{
+				LLOctreeCullShadow culler(mCamera);
+				record(culler);
+			}
+			break;
+		case CULL_NO_FAR_CLIP:
+			{
+				LLOctreeCullNoFarClip culler(mCamera);
+				record(culler);
+			}
+			break;
+		default:
+			{
+				LLOctreeCull culler(mCamera);
+				record(culler);
+			}
+			break;
+		}
+	}
+
+	void record(LLOctreeCull& culler)
+	{
+		culler.mRecord = &mEntries;
+		culler.mRes = mRes;
+		culler.traverse(mNode);
+	}
+
+	LLCamera* mCamera;
+	ECullMode mMode;
+	const LLSpatialGroup::OctreeNode* mNode;
+	S32 mRes;
+	LLSpatialCullRecord::entry_list_t mEntries;
+};
+
+static void record_root(LLCamera* camera, ECullMode mode, const LLSpatialGroup::OctreeNode* root,
+						LLSpatialCullRecord::entry_list_t& entries, std::vector<S32>& child_res)
+{
+	switch (mode)
+	{
+	case CULL_SHADOW:
+		{
+			LLOctreeCullShadow culler(camera);
+			culler.mRecord = &entries;
+			culler.recordRoot(root, child_res);
+		}
+		break;
+	case CULL_NO_FAR_CLIP:
+		{
+			LLOctreeCullNoFarClip culler(camera);
+			culler.mRecord = &entries;
+			culler.recordRoot(root, child_res);
+		}
+		break;
+	default:
+		{
+			LLOctreeCull culler(camera);
+			culler.mRecord = &entries;
+			culler.recordRoot(root, child_res);
+		}
+		break;
+	}
+}
+
+//static
+void LLSpatialPartition::cullParallel(LLCamera& camera, const std::vector<LLSpatialPartition*>& partitions)
+{
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (!pool)
+	{
+		for (U32 i = 0; i < partitions.size(); ++i)
+		{
+			partitions[i]->cull(camera);
+		}
+		return;
+	}
+
+	{
+		LLFastTimer ftm(FTM_CULL_REBOUND);
+		for (U32 i = 0; i < partitions.size(); ++i)
+		{
+			LLSpatialGroup* group = (LLSpatialGroup*) partitions[i]->mOctree->getListener(0);
+			group->rebound();
+		}
+	}
+
+	//the volume partition holds most of the groups, so its root's children
+	//are recorded separately and appended to the root's entries afterwards
+	std::deque<LLSpatialCullJob> jobs;
+	std::vector<LLSpatialCullRecord::entry_list_t> roots(partitions.size());
+	std::vector<U32> first_job(partitions.size() + 1);
+	for (U32 i = 0; i < partitions.size(); ++i)
+	{
+		LLSpatialPartition* part = partitions[i];
+		ECullMode mode = get_cull_mode(part);
+		first_job[i] = jobs.size();
+		if (part->mPartitionType == LLViewerRegion::PARTITION_VOLUME && part->mOctree->getChildCount() > 1)
+		{
+			std::vector<S32> child_res;
+			record_root(&camera, mode, part->mOctree, roots[i], child_res);
+			for (U32 j = 0; j < child_res.size(); ++j)
+			{
+				if (child_res[j] >= 0)
+				{
+					jobs.push_back(LLSpatialCullJob(&camera, mode, part->mOctree->getChild(j), child_res[j]));
+				}
+			}
+		}
+		else
+		{
+			jobs.push_back(LLSpatialCullJob(&camera, mode, part->mOctree, 0));
+		}
+	}
+	first_job[partitions.size()] = jobs.size();
+
+	{
+		LLFastTimer ftm(FTM_CULL_FRUSTUM_PASS);
+		std::vector<LLThreadPool::Job*> job_ptrs;
+		job_ptrs.reserve(jobs.size());
+		for (std::deque<LLSpatialCullJob>::iterator iter = jobs.begin(); iter != jobs.end(); ++iter)
+		{
+			job_ptrs.push_back(&*iter);
+		}
+		if (!job_ptrs.empty())
+		{
+			pool->runBatch(&job_ptrs[0], job_ptrs.size());
+		}
+	}
+
+	LLFastTimer ftm(FTM_FRUSTUM_CULL);
+	LLOctreeCull applier(&camera);
+	for (U32 i = 0; i < partitions.size(); ++i)
+	{
+		LLFastTimer ftm(get_cull_timer(partitions[i]->mPartitionType));
+		LLSpatialCullRecord::entry_list_t& entries = roots[i];
+		if (entries.empty())
+		{
+			applier.apply(jobs[first_job[i]].mEntries);
+			continue;
+		}
+
+		for (U32 j = first_job[i]; j < first_job[i + 1]; ++j)
+		{
+			entries.insert(entries.end(), jobs[j].mEntries.begin(), jobs[j].mEntries.end());
+		}
+		entries[0].mSize = entries.size();
+		applier.apply(entries);
+	}
+}
+
 BOOL earlyFail(LLCamera* camera, LLSpatialGroup* group)
 {
 	if (camera->getOrigin().isExactlyZero())
@@ -47,6 +47,7 @@
 #include "llface.h"
 #include "llviewercamera.h"
 #include "llvector4a.h"
+#include "lloctreeflatbounds.h"
 #include <queue>
 
 #define SG_STATE_INHERIT_MASK (OCCLUDED)
@@ -353,6 +354,7 @@ public:
 	BOOL boundObjects(BOOL empty, LLVector4a& newMin, LLVector4a& newMax);
 	void unbound();
 	BOOL rebound();
+	void updateFlatBounds(); //copy mBounds into the parent's block of LLSpatialPartition::mFlatBounds
 	void checkOcclusion(); //read back last occlusion query (if any)
 	void doOcclusion(LLCamera* camera); //issue occlusion query
 	void destroyGL(bool keep_occlusion = false);
@@ -439,6 +441,9 @@ public:
 	
 	F32 mPixelArea;
 	F32 mRadius;
+
+	S32 mFlatBlock; //block in LLSpatialPartition::mFlatBounds holding the bounds of our children
+	S32 mFlatParentBlock; //block our own bounds were last written to
 } LL_ALIGN_POSTFIX(64);
 
 inline LLSpatialGroup::eOcclusionState operator|(const LLSpatialGroup::eOcclusionState &a, const LLSpatialGroup::eOcclusionState &b) 
@@ -463,6 +468,29 @@ public:
 	virtual LLVertexBuffer* createVertexBuffer(U32 type_mask, U32 usage);
 };
 
+// Groups reached by the frustum pass of a cull, in the order the cull
+// visits them. The frustum pass only reads the octree and the camera, so it
+// can run on LLThreadPool threads; the occlusion and render list work is
+// then done on the main thread by replaying the entries.
+class LLSpatialCullRecord
+{
+public:
+	enum
+	{
+		VISIT = 1,		// at least partly in the frustum
+		PROCESS = 2		// and so are the objects of the group
+	};
+
+	struct Entry
+	{
+		LLSpatialGroup* mGroup;
+		U32 mSize;		// entries for mGroup and its subtree, skipped when the group is occluded
+		U32 mFlags;
+	};
+
+	typedef std::vector<Entry> entry_list_t;
+};
+
 class LLSpatialPartition: public LLGeometryManager
 {
 public:
@@ -495,6 +523,7 @@ public:
 
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results = NULL, BOOL for_select = FALSE); // Cull on arbitrary frustum
+	static void cullParallel(LLCamera& camera, const std::vector<LLSpatialPartition*>& partitions); // cull() for each partition, frustum tests on the thread pool
 	
 	BOOL isVisible(const LLVector3& v);
 	bool isHUDPartition() ;
@@ -526,6 +555,7 @@ public:
 	BOOL mDepthMask; //if TRUE, objects in this partition will be written to depth during alpha rendering
 	U32 mDrawableType;
 	U32 mPartitionType;
+	LLOctreeFlatBounds mFlatBounds; //bounds of group children, for testing all children of a group at once
 };
 
 // class for creating bridges between spatial partitions
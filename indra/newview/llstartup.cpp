@@ -453,6 +453,7 @@ void init_audio()
 				gAudiop->setMuted(TRUE);
 				if(gSavedSettings.getBOOL("AllowLargeSounds"))
 					gAudiop->setAllowLargeSounds(true);
+				gAudiop->setDecodedCacheSize(gSavedSettings.getU32("AudioDecodedCacheSize") * 1024 * 1024);
 			}
 			else
 			{
@@ -772,6 +773,11 @@ bool idle_startup()
 				msg->mPacketRing->setUseOutThrottle(TRUE);
 				msg->mPacketRing->setOutBandwidth(outBandwidth);
 			}
+			// the simulated inbound throttle pulls packets itself
+			if (inBandwidth == 0.f && gSavedSettings.getBOOL("MessageReceiveThread"))
+			{
+				msg->startReceiveThread();
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
@@ -27,6 +27,7 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "lltexturecache.h"
+#include "lltexturecachemapped.h"
 
 #include "llapr.h"
 #include "lldir.h"
@@ -401,6 +402,13 @@ bool LLTextureCacheRemoteWorker::doRead()
 		done = true;
 	}
 
+	// The mapped store keeps header and body together, a single copy does it all
+	if (!done && (mState == CACHE) && mCache->mMappedStore)
+	{
+		mDataSize = mCache->mMappedStore->read(mID, mOffset, mDataSize, mReadData, mImageSize);
+		done = true;
+	}
+
 	// Second state / stage : identify the cache or not...
 	if (!done && (mState == CACHE))
 	{
@@ -547,6 +555,18 @@ bool LLTextureCacheRemoteWorker::doWrite()
 	
 	// No LOCAL state for write(): because it doesn't make much sense to cache a local file...
 
+	// Mapped store: header and body go to the same block
+	if (!done && (mState == CACHE) && mCache->mMappedStore)
+	{
+		if (!mCache->mMappedStore->write(mID, mWriteData, mDataSize, mImageSize))
+		{
+			LL_DEBUGS("TextureCache") << "LLTextureCacheWorker: "  << mID
+					<< " Unable to write to the mapped texture cache!" << LL_ENDL;
+			mDataSize = -1; // failed
+		}
+		done = true;
+	}
+
 	// Second state / stage : set an entry in the headers entry (texture.entries) file
 	if (!done && (mState == CACHE))
 	{
@@ -737,12 +757,15 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 //////////////////////////////////////////////////////////////////////////////
 
-LLTextureCache::LLTextureCache(bool threaded)
-	: LLWorkerThread("TextureCache", threaded),
+// Cache workers share the header and entry data, so with a pool they still
+// run one at a time.
+LLTextureCache::LLTextureCache(bool threaded, LLThreadPool* pool)
+	: LLWorkerThread("TextureCache", threaded, false, pool, 1),
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mDoPurge(FALSE),
+	  mMappedStore(NULL)
 {
 }
 
@@ -750,6 +773,7 @@ LLTextureCache::~LLTextureCache()
 {
 	clearDeleteList();
 	writeUpdatedEntries();
+	delete mMappedStore;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -798,7 +822,14 @@ S32 LLTextureCache::update(F32 max_time_ms)
 	if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
 	{
 		timer.reset();
-		writeUpdatedEntries();
+		if (mMappedStore)
+		{
+			mMappedStore->flush();
+		}
+		else
+		{
+			writeUpdatedEntries();
+		}
 	}
 
 	return res;
@@ -826,6 +857,11 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
+	if (mMappedStore)
+	{
+		return mMappedStore->exists(id);
+	}
+
 	LLMutexLock lock(&mHeaderMutex);
 	id_map_t::const_iterator iter = mHeaderIDMap.find(id);
 	
@@ -871,6 +907,26 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 
 	return FALSE;
 }
+S64 LLTextureCache::getUsage()
+{
+	return mMappedStore ? mMappedStore->getUsage() : mTexturesSizeTotal;
+}
+
+S64 LLTextureCache::getMaxUsage()
+{
+	return mMappedStore ? mMappedStore->getMaxUsage() : sCacheMaxTexturesSize;
+}
+
+U32 LLTextureCache::getEntries()
+{
+	return mMappedStore ? mMappedStore->getEntries() : mHeaderEntriesInfo.mEntries;
+}
+
+U32 LLTextureCache::getMaxEntries()
+{
+	return mMappedStore ? mMappedStore->getMaxEntries() : sCacheMaxEntries;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 //static
@@ -880,6 +936,8 @@ U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
 const char* cache_filename = "texture.cache";
+const char* mapped_index_filename = "texture.mapindex";
+const char* mapped_data_filename = "texture.mapdata";
 const char* old_textures_dirname = "textures";
 //change the location of the texture cache to prevent from being deleted by old version viewers.
 const char* textures_dirname = "texturecache";
@@ -974,6 +1032,19 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 			LLFile::mkdir(dirname);
 		}
 	}
+
+	// The mapped store keeps the headers inline, so it gets their share too.
+	if (gSavedSettings.getBOOL("TextureCacheUseMappedStore") && openMappedStore(sCacheMaxTexturesSize + header_size))
+	{
+		return max_size;
+	}
+
+	if (!mReadOnly)
+	{
+		// Don't leave a mapped store from an earlier session taking up space.
+		LLFile::remove_nowarn(gDirUtilp->getExpandedFilename(location, textures_dirname, mapped_index_filename));
+		LLFile::remove_nowarn(gDirUtilp->getExpandedFilename(location, textures_dirname, mapped_data_filename));
+	}
 	readHeaderCache();
 	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
 
@@ -982,6 +1053,31 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 	return max_size; // unused cache space
 }
 
+//called in the main thread, from initCache(...)
+bool LLTextureCache::openMappedStore(S64 max_size)
+{
+	std::string delem = gDirUtilp->getDirDelimiter();
+	mMappedStore = new LLTextureCacheMappedStore;
+	if (!mMappedStore->open(mTexturesDirName + delem + mapped_index_filename,
+							mTexturesDirName + delem + mapped_data_filename,
+							mReadOnly, max_size))
+	{
+		LL_WARNS("TextureCache") << "Couldn't open the mapped texture cache, using the classic one" << LL_ENDL;
+		delete mMappedStore;
+		mMappedStore = NULL;
+		return false;
+	}
+
+	if (!mReadOnly && LLAPRFile::isExist(mHeaderEntriesFileName))
+	{
+		// Switching over from the classic cache: drop its files.
+		purgeAllTextures(false);
+		LLAPRFile::remove(mHeaderEntriesFileName);
+		LLAPRFile::remove(mHeaderDataFileName);
+	}
+	return true;
+}
+
 //----------------------------------------------------------------------------
 // mHeaderMutex must be locked for the following functions!
 
@@ -1564,6 +1660,12 @@ void LLTextureCache::purgeTextures(bool validate)
 		return;
 	}
 
+	if (mMappedStore)
+	{
+		mMappedStore->purge((mMappedStore->getMaxUsage() * (S64)((1.f-TEXTURE_CACHE_PURGE_AMOUNT)*100)) / 100);
+		return;
+	}
+
 	if (!mThreaded)
 	{
 		// *FIX:Mani - watchdog off.
@@ -1922,7 +2024,11 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 {
 	//llwarns << "Removing texture from cache: " << id << llendl;
 	bool ret = false;
-	if (!mReadOnly)
+	if (mMappedStore)
+	{
+		ret = mMappedStore->remove(id);
+	}
+	else if (!mReadOnly)
 	{
 		lockHeaders();
 
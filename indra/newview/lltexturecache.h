@@ -36,6 +36,7 @@
 
 class LLImageFormatted;
 class LLTextureCacheWorker;
+class LLTextureCacheMappedStore;
 
 class LLTextureCache : public LLWorkerThread
 {
@@ -98,7 +99,7 @@ public:
 		}
 	};
 	
-	LLTextureCache(bool threaded);
+	LLTextureCache(bool threaded, LLThreadPool* pool = NULL);
 	~LLTextureCache();
 
 	/*virtual*/ S32 update(F32 max_time_ms);	
@@ -129,10 +130,10 @@ public:
 	// debug
 	S32 getNumReads() { return mReaders.size(); }
 	S32 getNumWrites() { return mWriters.size(); }
-	S64 getUsage() { return mTexturesSizeTotal; }
-	S64 getMaxUsage() { return sCacheMaxTexturesSize; }
-	U32 getEntries() { return mHeaderEntriesInfo.mEntries; }
-	U32 getMaxEntries() { return sCacheMaxEntries; };
+	S64 getUsage();
+	S64 getMaxUsage();
+	U32 getEntries();
+	U32 getMaxEntries();
 	BOOL isInCache(const LLUUID& id) ;
 	BOOL isInLocal(const LLUUID& id) ;
 
@@ -149,6 +150,7 @@ private:
 	void performDelayedPurge();
 	void purgeAllTextures(bool purge_directories);
 	void purgeTextures(bool validate);
+	bool openMappedStore(S64 max_size);
 	LLAPRFile* openHeaderEntriesFile(bool readonly, S32 offset);
 	void closeHeaderEntriesFile();
 	void readEntriesHeader();
@@ -204,6 +206,9 @@ private:
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
 
+	// Replaces all of the above when TextureCacheUseMappedStore is set.
+	LLTextureCacheMappedStore* mMappedStore;
+
 	typedef std::map<S32, Entry> idx_entry_map_t;
 	idx_entry_map_t mUpdatedEntryMap;
 
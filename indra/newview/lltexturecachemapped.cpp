@@ -0,0 +1,720 @@
+/**
+ * @file lltexturecachemapped.cpp
+ * @brief Memory-mapped, slab-allocated storage backend for LLTextureCache
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturecachemapped.h"
+
+#include <algorithm>
+
+#include "llatomic.h"
+#include "llimage.h"
+#include "llmemory.h"
+
+const U32 INDEX_MAGIC = 0x4D435854;			// "TXCM"
+const U32 INDEX_VERSION = 1;
+const U32 INDEX_MIN_CAPACITY = 4096;
+const U32 INDEX_BYTES_PER_SLOT_HINT = 32768;	// initial capacity is one slot per 32KB of data
+const U32 DATA_GROW_SLABS = 16;					// the data file grows 64MB at a time
+const F32 PURGE_AMOUNT = .20f;					// as TEXTURE_CACHE_PURGE_AMOUNT in lltexturecache.cpp
+
+LLTextureCacheMappedStore::LLTextureCacheMappedStore()
+:	mReadOnly(TRUE),
+	mMaxSlabs(0),
+	mUsage(0)
+{
+}
+
+LLTextureCacheMappedStore::~LLTextureCacheMappedStore()
+{
+	close();
+}
+
+//static
+U32 LLTextureCacheMappedStore::getClassForSize(S32 size)
+{
+	U32 size_class = 0;
+	while (size_class < CLASS_COUNT - 1 && (S32)getBlockSize(size_class) < size)
+	{
+		size_class++;
+	}
+	return size_class;
+}
+
+bool LLTextureCacheMappedStore::open(const std::string& index_filename, const std::string& data_filename,
+									 BOOL read_only, S64 max_size)
+{
+	close();
+
+	mReadOnly = read_only;
+	mIndexFilename = index_filename;
+	mMaxSlabs = (U32)llmax(max_size / SLAB_SIZE, (S64)1);
+
+	LLMappedFile::EMode mode = mReadOnly ? LLMappedFile::READ_ONLY : LLMappedFile::READ_WRITE;
+	if (!mDataFile.open(data_filename, mode, mReadOnly ? 0 : SLAB_SIZE))
+	{
+		// This includes the case of another viewer instance holding the lock.
+		LL_WARNS("TextureCache") << "Couldn't map texture cache data file " << data_filename << LL_ENDL;
+		close();
+		return false;
+	}
+	if (mDataFile.getSize() % SLAB_SIZE)
+	{
+		// A partially grown file, the tail can't hold anything we know about.
+		if (mReadOnly || !mDataFile.resize(mDataFile.getSize() - mDataFile.getSize() % SLAB_SIZE))
+		{
+			close();
+			return false;
+		}
+	}
+	U32 slab_count = (U32)(mDataFile.getSize() / SLAB_SIZE);
+
+	bool valid = false;
+	llstat fbuf;
+	if (!LLFile::stat(index_filename, &fbuf) && (size_t)fbuf.st_size >= sizeof(IndexHeader) &&
+		mIndexFile.open(index_filename, mode))
+	{
+		const IndexHeader* header = getHeader();
+		size_t expected_size = sizeof(IndexHeader) + (size_t)header->mCapacity * sizeof(IndexSlot);
+		valid = header->mMagic == INDEX_MAGIC &&
+				header->mVersion == INDEX_VERSION &&
+				header->mCapacity >= INDEX_MIN_CAPACITY &&
+				(header->mCapacity & (header->mCapacity - 1)) == 0 &&
+				mIndexFile.getSize() == expected_size &&
+				header->mSlabCount == slab_count;
+		if (valid && !header->mClean)
+		{
+			// Writes go straight to the page cache, so unless the whole system
+			// went down the files are consistent. Validate them anyway.
+			LL_WARNS("TextureCache") << "Texture cache was not closed properly, validating " << index_filename << LL_ENDL;
+		}
+		if (valid && !rebuildFreeLists())
+		{
+			LL_WARNS("TextureCache") << "Texture cache corruption: bad entries in " << index_filename << LL_ENDL;
+			valid = false;
+		}
+	}
+
+	if (!valid)
+	{
+		if (mReadOnly)
+		{
+			LL_WARNS("TextureCache") << "Can't use " << index_filename << " as read-only texture cache index" << LL_ENDL;
+			close();
+			return false;
+		}
+
+		U32 capacity = INDEX_MIN_CAPACITY;
+		while ((S64)capacity < (S64)mMaxSlabs * SLAB_SIZE / INDEX_BYTES_PER_SLOT_HINT)
+		{
+			capacity <<= 1;
+		}
+		if (!resetIndex(capacity) || !rebuildFreeLists())
+		{
+			close();
+			return false;
+		}
+	}
+
+	if (!mReadOnly && slab_count > mMaxSlabs)
+	{
+		// The cache size was lowered since the last run.
+		IndexSlot* slots = getSlots();
+		for (U32 i = 0; i < getHeader()->mCapacity; i++)
+		{
+			if (slots[i].mState == SLOT_USED && slots[i].mBlock / BLOCKS_PER_SLAB >= mMaxSlabs)
+			{
+				eraseSlot(slots + i);
+			}
+		}
+		if (!mDataFile.resize((size_t)mMaxSlabs * SLAB_SIZE))
+		{
+			close();
+			return false;
+		}
+		getHeader()->mSlabCount = mMaxSlabs;
+		rebuildFreeLists();
+	}
+
+	if (!mReadOnly)
+	{
+		getHeader()->mClean = 0;
+		mIndexFile.flush(false);
+	}
+
+	LL_INFOS("TextureCache") << "Using mapped texture cache " << index_filename << " (" << getHeader()->mCount
+							 << " textures, " << mUsage / (1024 * 1024) << " MB)" << LL_ENDL;
+	return true;
+}
+
+void LLTextureCacheMappedStore::close()
+{
+	if (mIndexFile.isOpen() && mDataFile.isOpen() && !mReadOnly)
+	{
+		getHeader()->mClean = 1;
+		mDataFile.flush(false);
+		mIndexFile.flush(false);
+	}
+	mIndexFile.close();
+	mDataFile.close();
+	mSlabClass.clear();
+	mSlabUsed.clear();
+	mFreeSlabs.clear();
+	for (U32 i = 0; i < CLASS_COUNT; i++)
+	{
+		mFreeBlocks[i].clear();
+	}
+	mUsage = 0;
+}
+
+void LLTextureCacheMappedStore::flush()
+{
+	AIReadLock lock(mLock);
+	if (isOpen() && !mReadOnly)
+	{
+		mDataFile.flush(true);
+		mIndexFile.flush(true);
+	}
+}
+
+//static
+void LLTextureCacheMappedStore::touch(IndexSlot* slot)
+{
+	// read() gets here with only the read lock held, so other readers may
+	// stamp the same slot at the same time; the stamp is stored atomically.
+	// An unchanged stamp isn't stored, to keep the index page clean.
+	volatile apr_uint32_t* stamp = (volatile apr_uint32_t*)&slot->mTime;
+	apr_uint32_t now = (apr_uint32_t)time(NULL);
+	if (apr_atomic_read32(stamp) != now)
+	{
+		apr_atomic_set32(stamp, now);
+	}
+}
+
+//============================================================================
+// Public accessors
+//============================================================================
+
+S32 LLTextureCacheMappedStore::read(const LLUUID& id, S32 offset, S32 size, U8*& data, S32& image_size)
+{
+	AIReadLock lock(mLock);
+	if (!isOpen())
+	{
+		return 0;
+	}
+	IndexSlot* slot = findSlot(id);
+	if (!slot)
+	{
+		return 0;
+	}
+
+	image_size = slot->mImageSize;
+	S32 bytes = llmin(size, slot->mDataSize - offset);
+	if (bytes <= 0)
+	{
+		return 0;
+	}
+	data = (U8*)ALLOCATE_MEM(LLImageBase::getPrivatePool(), bytes);
+	memcpy(data, getBlockData(slot->mBlock) + offset, bytes);
+
+	if (!mReadOnly)
+	{
+		touch(slot);
+	}
+	return bytes;
+}
+
+bool LLTextureCacheMappedStore::write(const LLUUID& id, const U8* data, S32 datasize, S32 imagesize)
+{
+	if (mReadOnly || datasize <= 0)
+	{
+		return false;
+	}
+	if (datasize > (S32)SLAB_SIZE)
+	{
+		LL_DEBUGS("TextureCache") << "Texture " << id << " too large for the mapped cache: " << datasize << LL_ENDL;
+		return false;
+	}
+
+	AIWriteLock lock(mLock);
+	if (!isOpen())
+	{
+		return false;
+	}
+
+	U32 size_class = getClassForSize(datasize);
+	IndexSlot* slot = findSlot(id);
+	if (slot && slot->mImageSize == imagesize && slot->mDataSize == datasize &&
+		!memcmp(getBlockData(slot->mBlock), data, datasize))
+	{
+		// Nothing changed, don't dirty the pages.
+		touch(slot);
+		return true;
+	}
+	if (slot && slot->mClass != size_class)
+	{
+		eraseSlot(slot);
+		slot = NULL;
+	}
+
+	if (!slot)
+	{
+		U32 block;
+		if (!allocBlock(size_class, block))
+		{
+			purgeInternal((getMaxUsage() * (S64)((1.f - PURGE_AMOUNT) * 100)) / 100);
+			if (!allocBlock(size_class, block))
+			{
+				// Everything free is in slabs of other size classes.
+				reclaimSlab();
+				if (!allocBlock(size_class, block))
+				{
+					LL_WARNS("TextureCache") << "No room in the mapped texture cache for " << id << LL_ENDL;
+					return false;
+				}
+			}
+		}
+		if (!reserveSlots(1))
+		{
+			if (isOpen())
+			{
+				freeBlock(block, size_class);
+			}
+			return false;
+		}
+		slot = insertSlot(id);
+		slot->mBlock = block;
+		slot->mClass = size_class;
+	}
+
+	memcpy(getBlockData(slot->mBlock), data, datasize);
+	slot->mDataSize = datasize;
+	slot->mImageSize = imagesize;
+	touch(slot);
+	return true;
+}
+
+bool LLTextureCacheMappedStore::remove(const LLUUID& id)
+{
+	if (mReadOnly)
+	{
+		return false;
+	}
+	AIWriteLock lock(mLock);
+	if (!isOpen())
+	{
+		return false;
+	}
+	IndexSlot* slot = findSlot(id);
+	if (!slot)
+	{
+		return false;
+	}
+	eraseSlot(slot);
+	return true;
+}
+
+bool LLTextureCacheMappedStore::exists(const LLUUID& id)
+{
+	AIReadLock lock(mLock);
+	return isOpen() && findSlot(id) != NULL;
+}
+
+void LLTextureCacheMappedStore::purge(S64 target_size)
+{
+	if (mReadOnly)
+	{
+		return;
+	}
+	AIWriteLock lock(mLock);
+	if (isOpen())
+	{
+		purgeInternal(target_size);
+	}
+}
+
+//============================================================================
+// Hash table
+//============================================================================
+
+LLTextureCacheMappedStore::IndexSlot* LLTextureCacheMappedStore::findSlot(const LLUUID& id) const
+{
+	const U32 mask = getHeader()->mCapacity - 1;
+	IndexSlot* slots = getSlots();
+	for (U32 i = id.getCRC32() & mask; ; i = (i + 1) & mask)
+	{
+		IndexSlot* slot = slots + i;
+		if (slot->mState == SLOT_EMPTY)
+		{
+			return NULL;
+		}
+		if (slot->mState == SLOT_USED && !memcmp(slot->mID, id.mData, UUID_BYTES))
+		{
+			return slot;
+		}
+	}
+}
+
+LLTextureCacheMappedStore::IndexSlot* LLTextureCacheMappedStore::insertSlot(const LLUUID& id)
+{
+	IndexHeader* header = getHeader();
+	const U32 mask = header->mCapacity - 1;
+	IndexSlot* slots = getSlots();
+	U32 i = id.getCRC32() & mask;
+	while (slots[i].mState == SLOT_USED)
+	{
+		i = (i + 1) & mask;
+	}
+
+	IndexSlot* slot = slots + i;
+	if (slot->mState == SLOT_DELETED)
+	{
+		header->mTombstones--;
+	}
+	memcpy(slot->mID, id.mData, UUID_BYTES);
+	slot->mBlock = 0;
+	slot->mClass = 0;
+	slot->mImageSize = 0;
+	slot->mDataSize = 0;
+	touch(slot);
+	slot->mState = SLOT_USED;
+	header->mCount++;
+	return slot;
+}
+
+void LLTextureCacheMappedStore::eraseSlot(IndexSlot* slot)
+{
+	freeBlock(slot->mBlock, slot->mClass);
+	slot->mState = SLOT_DELETED;
+	slot->mDataSize = 0;
+
+	IndexHeader* header = getHeader();
+	header->mCount--;
+	header->mTombstones++;
+}
+
+// Makes sure that extra more entries can be inserted without the load
+// factor going over 3/4. May remap the index, invalidating slot pointers.
+bool LLTextureCacheMappedStore::reserveSlots(U32 extra)
+{
+	IndexHeader* header = getHeader();
+	U32 capacity = header->mCapacity;
+	if ((header->mCount + header->mTombstones + extra) * 4 <= capacity * 3)
+	{
+		return true;
+	}
+
+	// Grow when more than half of the slots hold live entries, otherwise
+	// rehashing at the same size is enough to get rid of the tombstones.
+	while ((header->mCount + extra) * 2 > capacity)
+	{
+		capacity <<= 1;
+	}
+
+	std::vector<IndexSlot> live;
+	live.reserve(header->mCount);
+	IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		if (slots[i].mState == SLOT_USED)
+		{
+			live.push_back(slots[i]);
+		}
+	}
+
+	if (!resetIndex(capacity))
+	{
+		return false;
+	}
+
+	header = getHeader();
+	slots = getSlots();
+	const U32 mask = capacity - 1;
+	for (std::vector<IndexSlot>::const_iterator iter = live.begin(); iter != live.end(); ++iter)
+	{
+		LLUUID id;
+		memcpy(id.mData, iter->mID, UUID_BYTES);
+		U32 i = id.getCRC32() & mask;
+		while (slots[i].mState != SLOT_EMPTY)
+		{
+			i = (i + 1) & mask;
+		}
+		slots[i] = *iter;
+	}
+	header->mCount = (U32)live.size();
+
+	LL_DEBUGS("TextureCache") << "Rehashed mapped texture cache index to " << capacity << " slots" << LL_ENDL;
+	return true;
+}
+
+bool LLTextureCacheMappedStore::resetIndex(U32 capacity)
+{
+	size_t size = sizeof(IndexHeader) + (size_t)capacity * sizeof(IndexSlot);
+	bool success = mIndexFile.isOpen() ? mIndexFile.resize(size)
+									   : mIndexFile.open(mIndexFilename, LLMappedFile::READ_WRITE, size);
+	if (success && mIndexFile.getSize() != size)
+	{
+		success = mIndexFile.resize(size);
+	}
+	if (!success)
+	{
+		LL_WARNS("TextureCache") << "Couldn't create mapped texture cache index " << mIndexFilename << LL_ENDL;
+		return false;
+	}
+
+	memset(mIndexFile.getData(), 0, size);
+	IndexHeader* header = getHeader();
+	header->mMagic = INDEX_MAGIC;
+	header->mVersion = INDEX_VERSION;
+	header->mCapacity = capacity;
+	header->mSlabCount = (U32)(mDataFile.getSize() / SLAB_SIZE);
+	return true;
+}
+
+//============================================================================
+// Slabs
+//============================================================================
+
+bool LLTextureCacheMappedStore::rebuildFreeLists()
+{
+	const U32 slab_count = (U32)(mDataFile.getSize() / SLAB_SIZE);
+	mSlabClass.assign(slab_count, -1);
+	mSlabUsed.assign(slab_count, 0);
+	mFreeSlabs.clear();
+	for (U32 i = 0; i < CLASS_COUNT; i++)
+	{
+		mFreeBlocks[i].clear();
+	}
+	mUsage = 0;
+
+	// Blocks never straddle slabs and all blocks of a slab have the same
+	// size, so two entries overlap exactly when they start at the same block.
+	std::vector<bool> used(slab_count * BLOCKS_PER_SLAB, false);
+	IndexHeader* header = getHeader();
+	IndexSlot* slots = getSlots();
+	U32 count = 0;
+	U32 tombstones = 0;
+	for (U32 i = 0; i < header->mCapacity; i++)
+	{
+		IndexSlot& slot = slots[i];
+		if (slot.mState == SLOT_DELETED)
+		{
+			tombstones++;
+		}
+		else if (slot.mState == SLOT_USED)
+		{
+			U32 slab = slot.mBlock / BLOCKS_PER_SLAB;
+			if (slot.mClass >= CLASS_COUNT ||
+				slab >= slab_count ||
+				slot.mBlock % getBlocksPerClass(slot.mClass) ||
+				used[slot.mBlock] ||
+				(mSlabClass[slab] >= 0 && mSlabClass[slab] != (S32)slot.mClass) ||
+				slot.mDataSize <= 0 ||
+				(U32)slot.mDataSize > getBlockSize(slot.mClass) ||
+				slot.mImageSize < slot.mDataSize)
+			{
+				return false;
+			}
+			used[slot.mBlock] = true;
+			mSlabClass[slab] = (S32)slot.mClass;
+			mSlabUsed[slab]++;
+			mUsage += getBlockSize(slot.mClass);
+			count++;
+		}
+		else if (slot.mState != SLOT_EMPTY)
+		{
+			return false;
+		}
+	}
+	header->mCount = count;
+	header->mTombstones = tombstones;
+
+	for (U32 slab = 0; slab < slab_count; slab++)
+	{
+		if (mSlabClass[slab] < 0)
+		{
+			mFreeSlabs.insert(slab);
+			continue;
+		}
+		U32 step = getBlocksPerClass(mSlabClass[slab]);
+		for (U32 block = slab * BLOCKS_PER_SLAB; block < (slab + 1) * BLOCKS_PER_SLAB; block += step)
+		{
+			if (!used[block])
+			{
+				mFreeBlocks[mSlabClass[slab]].insert(block);
+			}
+		}
+	}
+	return true;
+}
+
+bool LLTextureCacheMappedStore::allocBlock(U32 size_class, U32& block)
+{
+	block_set_t& free_blocks = mFreeBlocks[size_class];
+	if (!free_blocks.empty())
+	{
+		// Lowest address first keeps the used part of the file compact.
+		block = *free_blocks.begin();
+		free_blocks.erase(free_blocks.begin());
+	}
+	else if (!mFreeSlabs.empty() || growDataFile())
+	{
+		U32 slab = *mFreeSlabs.begin();
+		mFreeSlabs.erase(mFreeSlabs.begin());
+		mSlabClass[slab] = (S32)size_class;
+		block = slab * BLOCKS_PER_SLAB;
+		U32 step = getBlocksPerClass(size_class);
+		for (U32 next = block + step; next < (slab + 1) * BLOCKS_PER_SLAB; next += step)
+		{
+			free_blocks.insert(free_blocks.end(), next);
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	mSlabUsed[block / BLOCKS_PER_SLAB]++;
+	mUsage += getBlockSize(size_class);
+	return true;
+}
+
+void LLTextureCacheMappedStore::freeBlock(U32 block, U32 size_class)
+{
+	U32 slab = block / BLOCKS_PER_SLAB;
+	llassert(mSlabClass[slab] == (S32)size_class && mSlabUsed[slab] > 0);
+	mUsage -= getBlockSize(size_class);
+	if (--mSlabUsed[slab] == 0)
+	{
+		// Hand the whole slab back so that any size class can use it.
+		block_set_t& free_blocks = mFreeBlocks[size_class];
+		free_blocks.erase(free_blocks.lower_bound(slab * BLOCKS_PER_SLAB),
+						  free_blocks.lower_bound((slab + 1) * BLOCKS_PER_SLAB));
+		mSlabClass[slab] = -1;
+		mFreeSlabs.insert(slab);
+	}
+	else
+	{
+		mFreeBlocks[size_class].insert(block);
+	}
+}
+
+bool LLTextureCacheMappedStore::growDataFile()
+{
+	U32 slab_count = (U32)mSlabClass.size();
+	if (slab_count >= mMaxSlabs)
+	{
+		return false;
+	}
+	U32 new_count = llmin(slab_count + DATA_GROW_SLABS, mMaxSlabs);
+	if (!mDataFile.resize((size_t)new_count * SLAB_SIZE))
+	{
+		// Probably out of address space, don't try again.
+		LL_WARNS("TextureCache") << "Couldn't grow mapped texture cache to " << new_count << " slabs" << LL_ENDL;
+		mMaxSlabs = slab_count;
+		return false;
+	}
+	getHeader()->mSlabCount = new_count;
+	mSlabClass.resize(new_count, -1);
+	mSlabUsed.resize(new_count, 0);
+	for (U32 slab = slab_count; slab < new_count; slab++)
+	{
+		mFreeSlabs.insert(slab);
+	}
+	return true;
+}
+
+// LRU sweep over the index, in place.
+void LLTextureCacheMappedStore::purgeInternal(S64 target_size)
+{
+	if (mUsage <= target_size)
+	{
+		return;
+	}
+
+	typedef std::vector<std::pair<U32, U32> > time_idx_vec_t;
+	time_idx_vec_t time_idx;
+	time_idx.reserve(getHeader()->mCount);
+	IndexSlot* slots = getSlots();
+	for (U32 i = 0; i < getHeader()->mCapacity; i++)
+	{
+		if (slots[i].mState == SLOT_USED)
+		{
+			time_idx.push_back(std::make_pair(slots[i].mTime, i));
+		}
+	}
+	std::sort(time_idx.begin(), time_idx.end());
+
+	S64 start_usage = mUsage;
+	S32 purge_count = 0;
+	for (time_idx_vec_t::const_iterator iter = time_idx.begin();
+		 iter != time_idx.end() && mUsage > target_size; ++iter)
+	{
+		eraseSlot(slots + iter->second);
+		purge_count++;
+	}
+
+	LL_INFOS("TextureCache") << "TEXTURE CACHE: PURGED: " << purge_count
+							 << " FREED: " << (start_usage - mUsage) / (1024 * 1024) << " MB"
+							 << " ENTRIES: " << getHeader()->mCount << LL_ENDL;
+}
+
+// Empties the slab whose most recently used entry is the oldest.
+void LLTextureCacheMappedStore::reclaimSlab()
+{
+	std::vector<U32> newest(mSlabClass.size(), 0);
+	IndexSlot* slots = getSlots();
+	const U32 capacity = getHeader()->mCapacity;
+	for (U32 i = 0; i < capacity; i++)
+	{
+		if (slots[i].mState == SLOT_USED)
+		{
+			U32& time = newest[slots[i].mBlock / BLOCKS_PER_SLAB];
+			time = llmax(time, slots[i].mTime);
+		}
+	}
+
+	S32 victim = -1;
+	for (U32 slab = 0; slab < newest.size(); slab++)
+	{
+		if (mSlabClass[slab] >= 0 && (victim < 0 || newest[slab] < newest[victim]))
+		{
+			victim = (S32)slab;
+		}
+	}
+	if (victim < 0)
+	{
+		return;
+	}
+
+	for (U32 i = 0; i < capacity; i++)
+	{
+		if (slots[i].mState == SLOT_USED && slots[i].mBlock / BLOCKS_PER_SLAB == (U32)victim)
+		{
+			eraseSlot(slots + i);
+		}
+	}
+}
@@ -0,0 +1,173 @@
+/**
+ * @file lltexturecachemapped.h
+ * @brief Memory-mapped, slab-allocated storage backend for LLTextureCache
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTURECACHEMAPPED_H
+#define LL_LLTEXTURECACHEMAPPED_H
+
+#include <set>
+#include <vector>
+#include "llmappedfile.h"
+#include "llthread.h"
+#include "lluuid.h"
+
+// Alternative storage for LLTextureCache. Instead of a header entries file,
+// a header data file and one body file per texture, everything lives in
+// two memory-mapped files:
+//  - the index, an open-addressed hash table keyed by texture id, so that
+//    looking up an entry is a pointer dereference;
+//  - the data file, carved into SLAB_SIZE slabs. Each slab holds blocks of
+//    one power of two size class and a texture (header and body together)
+//    is stored in the smallest block it fits in.
+// Slab assignments and free lists are not stored; they are rebuilt from
+// the index when the store is opened.
+//
+// The whole store is protected by one reader/writer lock. Lookups and reads
+// only take the read lock; writes, removals and purges take the write lock.
+class LLTextureCacheMappedStore
+{
+public:
+	LLTextureCacheMappedStore();
+	~LLTextureCacheMappedStore();
+
+	// Opens (or creates) the store. max_size is the maximum size of the data
+	// file; a larger file left behind by an earlier run is trimmed. Returns
+	// false when the files could not be opened or mapped, in which case the
+	// caller should fall back to the classic backend.
+	bool open(const std::string& index_filename, const std::string& data_filename,
+			  BOOL read_only, S64 max_size);
+	void close();
+	bool isOpen() const { return mIndexFile.isOpen() && mDataFile.isOpen(); }
+
+	// Copies at most size bytes starting at offset into a buffer allocated
+	// from the image private pool. Returns the number of bytes copied, 0 when
+	// the texture is not cached. image_size is set to the full image size.
+	S32 read(const LLUUID& id, S32 offset, S32 size, U8*& data, S32& image_size);
+	// Stores the first datasize bytes of a texture of imagesize bytes,
+	// replacing what was cached before unless that is the same data. Evicts
+	// the least recently used textures when there is no room left.
+	bool write(const LLUUID& id, const U8* data, S32 datasize, S32 imagesize);
+	bool remove(const LLUUID& id);
+	bool exists(const LLUUID& id);
+
+	// Evicts least recently used textures until at most target_size bytes
+	// of the data file are in use.
+	void purge(S64 target_size);
+	void flush();
+
+	S64 getUsage() const { return mUsage; }
+	S64 getMaxUsage() const { return (S64)mMaxSlabs * SLAB_SIZE; }
+	U32 getEntries() const { return isOpen() ? getHeader()->mCount : 0; }
+	// The index grows as needed; what bounds the entries is the data file,
+	// every texture taking at least one block of the smallest size.
+	U32 getMaxEntries() const { return mMaxSlabs * BLOCKS_PER_SLAB; }
+
+	enum
+	{
+		MIN_BLOCK_SHIFT = 11,	// 2 KB, twice a header record
+		MAX_BLOCK_SHIFT = 22,	// 4 MB
+		CLASS_COUNT = MAX_BLOCK_SHIFT - MIN_BLOCK_SHIFT + 1,
+		SLAB_SIZE = 1 << MAX_BLOCK_SHIFT,
+		BLOCKS_PER_SLAB = 1 << (MAX_BLOCK_SHIFT - MIN_BLOCK_SHIFT)
+	};
+
+private:
+	// On-disk layout of the index file: one IndexHeader followed by
+	// mCapacity IndexSlots, in native byte order.
+	struct IndexHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		U32 mCapacity;		// always a power of two
+		U32 mCount;			// SLOT_USED entries
+		U32 mTombstones;	// SLOT_DELETED entries
+		U32 mSlabCount;		// size of the data file in slabs
+		U32 mClean;			// 0 while the store is open for writing
+		U32 mPad;
+	};
+
+	enum ESlotState
+	{
+		SLOT_EMPTY = 0,
+		SLOT_USED = 1,
+		SLOT_DELETED = 2
+	};
+
+	struct IndexSlot
+	{
+		U8  mID[UUID_BYTES];
+		U32 mState;
+		U32 mBlock;			// location in the data file, in units of the smallest block
+		U32 mClass;			// block size is 1 << (mClass + MIN_BLOCK_SHIFT)
+		S32 mImageSize;
+		S32 mDataSize;
+		U32 mTime;			// last access, seconds since 1/1/1970, see touch()
+	};
+
+	typedef std::set<U32> block_set_t;
+
+	static U32 getClassForSize(S32 size);
+	static U32 getBlockSize(U32 size_class) { return 1U << (size_class + MIN_BLOCK_SHIFT); }
+	static U32 getBlocksPerClass(U32 size_class) { return 1U << size_class; }
+
+	IndexHeader* getHeader() const { return (IndexHeader*)mIndexFile.getData(); }
+	IndexSlot* getSlots() const { return (IndexSlot*)(mIndexFile.getData() + sizeof(IndexHeader)); }
+	U8* getBlockData(U32 block) const { return mDataFile.getData() + ((size_t)block << MIN_BLOCK_SHIFT); }
+
+	// Read or write lock must be held.
+	IndexSlot* findSlot(const LLUUID& id) const;
+	// Write lock must be held.
+	IndexSlot* insertSlot(const LLUUID& id);
+	void eraseSlot(IndexSlot* slot);
+	bool reserveSlots(U32 extra);
+	bool resetIndex(U32 capacity);
+	bool rebuildFreeLists();
+	bool allocBlock(U32 size_class, U32& block);
+	void freeBlock(U32 block, U32 size_class);
+	bool growDataFile();
+	void purgeInternal(S64 target_size);
+	void reclaimSlab();
+
+	// Stamps the access time used by the LRU purge.
+	static void touch(IndexSlot* slot);
+
+private:
+	LLMappedFile	mIndexFile;
+	LLMappedFile	mDataFile;
+	std::string		mIndexFilename;
+	BOOL			mReadOnly;
+	U32				mMaxSlabs;
+
+	AIRWLock		mLock;
+
+	// Protected by the write lock.
+	std::vector<S32>	mSlabClass;			// size class of every slab, -1 when free
+	std::vector<U32>	mSlabUsed;			// blocks in use per slab
+	block_set_t			mFreeSlabs;
+	block_set_t			mFreeBlocks[CLASS_COUNT];
+	S64					mUsage;				// bytes of allocated blocks
+};
+
+#endif // LL_LLTEXTURECACHEMAPPED_H
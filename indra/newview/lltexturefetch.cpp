@@ -965,9 +965,12 @@ void LLTextureFetchWorker::setDesiredDiscard(S32 discard, S32 size)
 	}
 }
 
+// May be called from any thread
 void LLTextureFetchWorker::setImagePriority(F32 priority)
 {
 // 	llassert_always(priority >= 0 && priority <= LLViewerTexture::maxDecodePriority());
+	// mState and mDecodeHandle change under mWorkMutex on the fetch and decode threads.
+	LLMutexLock lock(&mWorkMutex);
 	F32 delta = fabs(priority - mImagePriority);
 	if (delta > (mImagePriority * .05f) || mState == DONE)
 	{
@@ -975,6 +978,11 @@ void LLTextureFetchWorker::setImagePriority(F32 priority)
 		calcWorkPriority();
 		U32 work_priority = mWorkPriority | (getPriority() & LLWorkerThread::PRIORITY_HIGHBITS);
 		setPriority(work_priority);
+		if (mState == DECODE_IMAGE_UPDATE && mDecodeHandle)
+		{
+			// Keep a queued decode in step, so that the decode threads pick the most wanted images first.
+			mFetcher->mImageDecodeThread->setPriority(mDecodeHandle, LLWorkerThread::PRIORITY_NORMAL | mWorkPriority);
+		}
 	}
 }
 
@@ -2591,9 +2599,7 @@ bool LLTextureFetch::updateRequestPriority(const LLUUID& id, F32 priority)
 	LLTextureFetchWorker* worker = getWorker(id);
 	if (worker)
 	{
-		worker->lockWorkMutex();
 		worker->setImagePriority(priority);
-		worker->unlockWorkMutex();
 		res = true;
 	}
 	return res;
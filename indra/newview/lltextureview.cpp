@@ -35,6 +35,7 @@
 #include "lllfsthread.h"
 #include "llui.h"
 #include "llimageworker.h"
+#include "llthreadpool.h"
 #include "llrender.h"
 
 #include "aicurlperservice.h"
@@ -670,7 +671,7 @@ void LLGLTexMemBar::draw()
 					LLAppViewer::getTextureCache()->getNumReads(), LLAppViewer::getTextureCache()->getNumWrites(),
 					LLLFSThread::sLocal->getPending(),
 					LLAppViewer::getImageDecodeThread()->getPending(),
-					LLImageRaw::sRawImageCount, LLImageRaw::sRawImageCachedCount,
+					(S32)LLImageRaw::sRawImageCount, LLImageRaw::sRawImageCachedCount,
 					AICurlInterface::getNumHTTPCommands(),
 					AICurlInterface::getNumHTTPQueued(),
 					AICurlInterface::getNumHTTPAdded(),
@@ -691,6 +692,36 @@ void LLGLTexMemBar::draw()
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, v_offset + line_height*2,
 											 color, LLFontGL::LEFT, LLFontGL::TOP);
 
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	if (pool)
+	{
+		// Sampling starts a new period for the latencies, so only do it once a second.
+		static LLFrameTimer sample_timer;
+		static LLThreadPool::LaneStats lane_stats[LLThreadPool::NUM_LANES];
+		if (sample_timer.getElapsedTimeF32() >= 1.f)
+		{
+			sample_timer.reset();
+			for (S32 lane = 0; lane < LLThreadPool::NUM_LANES; ++lane)
+			{
+				pool->sampleLaneStats((LLThreadPool::ELane)lane, lane_stats[lane]);
+			}
+		}
+		left += LLFontGL::getFontMonospace()->getWidth(text);
+		text = llformat(" Pool(%u) H:%u %.1f/%.1fms N:%u %.1f/%.1fms L:%u %.1f/%.1fms",
+						pool->getThreadCount(),
+						lane_stats[LLThreadPool::LANE_HIGH].mQueued,
+						lane_stats[LLThreadPool::LANE_HIGH].mAverageLatency * 1000.f,
+						lane_stats[LLThreadPool::LANE_HIGH].mMaxLatency * 1000.f,
+						lane_stats[LLThreadPool::LANE_NORMAL].mQueued,
+						lane_stats[LLThreadPool::LANE_NORMAL].mAverageLatency * 1000.f,
+						lane_stats[LLThreadPool::LANE_NORMAL].mMaxLatency * 1000.f,
+						lane_stats[LLThreadPool::LANE_LOW].mQueued,
+						lane_stats[LLThreadPool::LANE_LOW].mAverageLatency * 1000.f,
+						lane_stats[LLThreadPool::LANE_LOW].mMaxLatency * 1000.f);
+		LLFontGL::getFontMonospace()->renderUTF8(text, 0, left, v_offset + line_height*2,
+												 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+	}
+
 	S32 dx1 = 0;
 	if (LLAppViewer::getTextureFetch()->mDebugPause)
 	{
@@ -72,6 +72,7 @@
 #include "llerrorcontrol.h"
 #include "sgversion.h"
 #include "llappviewer.h"
+#include "llimageworker.h"
 #include "llvosurfacepatch.h"
 #include "llvowlsky.h"
 #include "llworldmapview.h"
@@ -139,6 +140,15 @@ bool handleStateMachineMaxTimeChanged(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleImageDecodeThreadsChanged(const LLSD& newvalue)
+{
+	if (LLAppViewer::getImageDecodeThread())
+	{
+		LLAppViewer::getImageDecodeThread()->setPoolConcurrency(newvalue.asInteger());
+	}
+	return true;
+}
+
 static bool handleSetShaderChanged(const LLSD& newvalue)
 {
 	// changing shader level may invalidate existing cached bump maps, as the shader type determines the format of the bump map it expects - clear and repopulate the bump cache
@@ -636,6 +646,19 @@ static bool handleAllowLargeSounds(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleAudioDecodedCacheSizeChanged(const LLSD& newvalue)
+{
+	if(gAudiop)
+		gAudiop->setDecodedCacheSize((U32)newvalue.asInteger() * 1024 * 1024);
+	return true;
+}
+
+static bool handleXMLCompiledCacheChanged(const LLSD& newvalue)
+{
+	LLAppViewer::instance()->setXMLCompiledCacheEnabled(newvalue.asBoolean());
+	return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 void settings_setup_listeners()
 {
@@ -698,6 +721,7 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderUseImpostors")->getSignal()->connect(boost::bind(&handleRenderUseImpostorsChanged, _2));
 	gSavedSettings.getControl("RenderDebugGL")->getSignal()->connect(boost::bind(&handleRenderDebugGLChanged, _2));
 	gSavedSettings.getControl("RenderDebugPipeline")->getSignal()->connect(boost::bind(&handleRenderDebugPipelineChanged, _2));
+	gSavedSettings.getControl("ImageDecodeThreads")->getSignal()->connect(boost::bind(&handleImageDecodeThreadsChanged, _2));
 	gSavedSettings.getControl("RenderResolutionDivisor")->getSignal()->connect(boost::bind(&handleRenderResolutionDivisorChanged, _2));
 	gSavedSettings.getControl("RenderDeferred")->getSignal()->connect(boost::bind(&handleRenderDeferredChanged, _2));
 	gSavedSettings.getControl("RenderShadowDetail")->getSignal()->connect(boost::bind(&handleSetShaderChanged, _2));
@@ -828,6 +852,8 @@ void settings_setup_listeners()
     // [/Ansariel: Display name support]
 
 	gSavedSettings.getControl("AllowLargeSounds")->getSignal()->connect(boost::bind(&handleAllowLargeSounds, _2));
+	gSavedSettings.getControl("AudioDecodedCacheSize")->getSignal()->connect(boost::bind(&handleAudioDecodedCacheSizeChanged, _2));
+	gSavedSettings.getControl("XMLCompiledCache")->getSignal()->connect(boost::bind(&handleXMLCompiledCacheChanged, _2));
 	gSavedSettings.getControl("LiruUseZQSDKeys")->getSignal()->connect(boost::bind(load_default_bindings, _2));
 }
 
@@ -1371,8 +1371,10 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 #ifdef DEBUG_UPDATE_TYPE
 				llinfos << "TI:" << getID() << llendl;
 #endif
-				length = mesgsys->getSizeFast(_PREHASH_ObjectData, block_num, _PREHASH_ObjectData);
-				mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_ObjectData, data, length, block_num);
+				// terse updates are the bulk of the object traffic
+				static LLMessageField sTerseData(_PREHASH_ObjectData, _PREHASH_ObjectData);
+				length = mesgsys->getSizeFast(sTerseData, block_num);
+				mesgsys->getBinaryDataFast(sTerseData, data, length, block_num);
 				count = 0;
 				LLVector4 collision_plane;
 				
@@ -1515,7 +1517,8 @@ U32 LLViewerObject::processUpdateMessage(LLMessageSystem *mesgsys,
 				}
 
 				U8 state;
-				mesgsys->getU8Fast(_PREHASH_ObjectData, _PREHASH_State, state, block_num );
+				static LLMessageField sTerseState(_PREHASH_ObjectData, _PREHASH_State);
+				mesgsys->getU8Fast(sTerseState, state, block_num);
 				mState = state;
 				break;
 			}
@@ -386,6 +386,14 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 	LLDataPackerBinaryBuffer compressed_dp(compressed_dpbuffer, 2048);
 	LLDataPacker *cached_dpp = NULL;
 	LLViewerStatsRecorder& recorder = LLViewerStatsRecorder::instance();
+
+	// Read for every object, so skip looking up the names each time.
+	static LLMessageField sObjectID(_PREHASH_ObjectData, _PREHASH_ID);
+	static LLMessageField sObjectCRC(_PREHASH_ObjectData, _PREHASH_CRC);
+	static LLMessageField sObjectUpdateFlags(_PREHASH_ObjectData, _PREHASH_UpdateFlags);
+	static LLMessageField sObjectData(_PREHASH_ObjectData, _PREHASH_Data);
+	static LLMessageField sObjectFullID(_PREHASH_ObjectData, _PREHASH_FullID);
+	static LLMessageField sObjectPCode(_PREHASH_ObjectData, _PREHASH_PCode);
 	
 	for (i = 0; i < num_objects; i++)
 	{
@@ -398,8 +406,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		{
 			U32 id;
 			U32 crc;
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, id, i);
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_CRC, crc, i);
+			mesgsys->getU32Fast(sObjectID, id, i);
+			mesgsys->getU32Fast(sObjectCRC, crc, i);
 			msg_size += sizeof(U32) * 2;
 		
 			// Lookup data packer and add this id to cache miss lists if necessary.
@@ -429,11 +437,11 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 			U32 flags = 0;
 			if (update_type != OUT_TERSE_IMPROVED)
 			{
-				mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_UpdateFlags, flags, i);
+				mesgsys->getU32Fast(sObjectUpdateFlags, flags, i);
 			}
 			
-			uncompressed_length = mesgsys->getSizeFast(_PREHASH_ObjectData, i, _PREHASH_Data);
-			mesgsys->getBinaryDataFast(_PREHASH_ObjectData, _PREHASH_Data, compressed_dpbuffer, 0, i);
+			uncompressed_length = mesgsys->getSizeFast(sObjectData, i);
+			mesgsys->getBinaryDataFast(sObjectData, compressed_dpbuffer, 0, i);
 			compressed_dp.assignBuffer(compressed_dpbuffer, uncompressed_length);
 
 			if (update_type != OUT_TERSE_IMPROVED) // OUT_FULL_COMPRESSED only?
@@ -458,7 +466,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 		else if (update_type != OUT_FULL) // !compressed, !OUT_FULL ==> OUT_FULL_CACHED only?
 		{
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			mesgsys->getU32Fast(sObjectID, local_id, i);
 			msg_size += sizeof(U32);
 
 			getUUIDFromLocal(fullid,
@@ -473,8 +481,8 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 		}
 		else // OUT_FULL only?
 		{
-			mesgsys->getUUIDFast(_PREHASH_ObjectData, _PREHASH_FullID, fullid, i);
-			mesgsys->getU32Fast(_PREHASH_ObjectData, _PREHASH_ID, local_id, i);
+			mesgsys->getUUIDFast(sObjectFullID, fullid, i);
+			mesgsys->getU32Fast(sObjectID, local_id, i);
 			msg_size += sizeof(LLUUID);
 			msg_size += sizeof(U32);
 			// llinfos << "Full Update, obj " << local_id << ", global ID" << fullid << "from " << mesgsys->getSender() << llendl;
@@ -538,7 +546,7 @@ void LLViewerObjectList::processObjectUpdate(LLMessageSystem *mesgsys,
 					continue;
 				}
 
-				mesgsys->getU8Fast(_PREHASH_ObjectData, _PREHASH_PCode, pcode, i);
+				mesgsys->getU8Fast(sObjectPCode, pcode, i);
 				msg_size += sizeof(U8);
 
 			}
@@ -992,6 +1000,9 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 	
 	std::vector<LLViewerObject*>::iterator idle_end = idle_list.begin()+idle_count;
 
+	// avatar skeletons are updated together once every object had its idle update
+	LLVOAvatar::beginSkeletonUpdates();
+
 	static const LLCachedControl<bool> freeze_time("FreezeTime",0);
 	if (freeze_time)
 	{
@@ -1027,6 +1038,7 @@ void LLViewerObjectList::update(LLAgent &agent, LLWorld &world)
 		LLViewerTextureAnim::updateClass();
 	}
 
+	LLVOAvatar::finishSkeletonUpdates();
 
 
 	fetchObjectCosts();
@@ -149,6 +149,9 @@ public:
 	LLVLComposition *mCompositionp;		// Composition layer for the surface
 
 	LLVOCacheEntry::vocache_entry_map_t		mCacheMap;
+	// The cache file as read from disk, entries not in mCacheMap yet are
+	// looked up here.
+	LLPointer<LLVOCacheStore>				mCacheStore;
 	// time?
 	// LRU info?
 
@@ -312,6 +315,7 @@ LLViewerRegion::LLViewerRegion(const U64 &handle,
 	mHttpUrl(""),
 	mCacheLoaded(FALSE),
 	mCacheDirty(FALSE),
+	mCacheLoadID(0),
 	mReleaseNotesRequested(FALSE),
 	mCapabilitiesReceived(false),
 	mFeaturesReceived(false),
@@ -460,11 +464,11 @@ void LLViewerRegion::setRegionID(const LLUUID& region_id)
 	mImpl->mRegionID = region_id;
 }
 
-void LLViewerRegion::loadObjectCache()
+bool LLViewerRegion::loadObjectCache()
 {
 	if (mCacheLoaded)
 	{
-		return;
+		return mCacheLoadID != 0;
 	}
 
 	// Presume success.  If it fails, we don't want to try again.
@@ -472,10 +476,17 @@ void LLViewerRegion::loadObjectCache()
 
 	if(LLVOCache::hasInstance())
 	{
-		LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap) ;
+		mCacheLoadID = LLVOCache::getInstance()->readFromCache(mHandle, mImpl->mCacheID) ;
 	}
+	return mCacheLoadID != 0;
 }
 
+void LLViewerRegion::objectCacheLoaded(LLVOCacheStore* store)
+{
+	mCacheLoadID = 0;
+	mImpl->mCacheStore = store;
+	sendRegionHandshakeReply();
+}
 
 void LLViewerRegion::saveObjectCache()
 {
@@ -484,14 +495,15 @@ void LLViewerRegion::saveObjectCache()
 		return;
 	}
 
-	if (mImpl->mCacheMap.empty())
+	if (mImpl->mCacheMap.empty() && mImpl->mCacheStore.isNull())
 	{
 		return;
 	}
 
 	if(LLVOCache::hasInstance())
 	{
-		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheMap, mCacheDirty) ;
+		// Takes over the entries, they are written and deleted in the background.
+		LLVOCache::getInstance()->writeToCache(mHandle, mImpl->mCacheID, mImpl->mCacheStore, mImpl->mCacheMap, mCacheDirty) ;
 		mCacheDirty = FALSE;
 	}
 
@@ -500,6 +512,8 @@ void LLViewerRegion::saveObjectCache()
 		delete iter->second;
 	}
 	mImpl->mCacheMap.clear();
+	mImpl->mCacheStore = NULL;
+	mCacheLoadID = 0;
 }
 
 void LLViewerRegion::sendMessage()
@@ -1355,7 +1369,7 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLViewerObjec
 	U32 local_id = objectp->getLocalID();
 	U32 crc = objectp->getCRC();
 
-	LLVOCacheEntry* entry = get_if_there(mImpl->mCacheMap, local_id, (LLVOCacheEntry*)NULL);
+	LLVOCacheEntry* entry = getCacheEntry(local_id);
 
 	if (entry)
 	{
@@ -1392,13 +1406,29 @@ LLViewerRegion::eCacheUpdateResult LLViewerRegion::cacheFullUpdate(LLViewerObjec
 	return result;
 }
 
+LLVOCacheEntry* LLViewerRegion::getCacheEntry(U32 local_id)
+{
+	LLVOCacheEntry* entry = get_if_there(mImpl->mCacheMap, local_id, (LLVOCacheEntry*)NULL);
+	if (!entry && mImpl->mCacheStore.notNull())
+	{
+		const LLVOCacheStore::IndexEntry* index = mImpl->mCacheStore->find(local_id);
+		if (index)
+		{
+			entry = new LLVOCacheEntry(index->mLocalID, index->mCRC, index->mHitCount, index->mDupeCount,
+									   index->mCRCChangeCount, mImpl->mCacheStore->getData(*index), (S32)index->mSize);
+			mImpl->mCacheMap[local_id] = entry;
+		}
+	}
+	return entry;
+}
+
 // Get data packer for this object, if we have cached data
 // AND the CRC matches. JC
 LLDataPacker *LLViewerRegion::getDP(U32 local_id, U32 crc, U8 &cache_miss_type)
 {
 	//llassert(mCacheLoaded);  This assert failes often, changing to early-out -- davep, 2010/10/18
 
-	LLVOCacheEntry* entry = get_if_there(mImpl->mCacheMap, local_id, (LLVOCacheEntry*)NULL);
+	LLVOCacheEntry* entry = getCacheEntry(local_id);
 
 	if (entry)
 	{
@@ -1538,6 +1568,10 @@ void LLViewerRegion::dumpCache()
 	}
 
 	llinfos << "Count " << mImpl->mCacheMap.size() << llendl;
+	if (mImpl->mCacheStore.notNull())
+	{
+		llinfos << "Stored " << mImpl->mCacheStore->getNumEntries() << llendl;
+	}
 	for (i = 0; i < BINS; i++)
 	{
 		llinfos << "Hits " << i << " " << hit_bin[i] << llendl;
@@ -1673,13 +1707,22 @@ void LLViewerRegion::unpackRegionHandshake()
 
 
 	// Now that we have the name, we can load the cache file
-	// off disk.
-	loadObjectCache();
+	// off disk. When that happens in the background the reply
+	// is sent once it is done, so cached object updates find
+	// the index in memory.
+	if (!loadObjectCache())
+	{
+		sendRegionHandshakeReply();
+	}
+}
 
+void LLViewerRegion::sendRegionHandshakeReply()
+{
 	// After loading cache, signal that simulator can start
 	// sending data.
 	// TODO: Send all upstream viewer->sim handshake info here.
-	LLHost host = msg->getSender();
+	LLMessageSystem* msg = gMessageSystem;
+	const LLHost& host = mImpl->mHost;
 	msg->newMessage("RegionHandshakeReply");
 	msg->nextBlock("AgentData");
 	msg->addUUID("AgentID", gAgent.getID());
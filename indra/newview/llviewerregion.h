@@ -68,6 +68,7 @@ class LLViewerParcelOverlay;
 class LLSurface;
 class LLVOCache;
 class LLVOCacheEntry;
+class LLVOCacheStore;
 class LLSpatialPartition;
 class LLEventPump;
 class LLCapabilityListener;
@@ -114,9 +115,13 @@ public:
 				   const F32 region_width_meters);
 	~LLViewerRegion();
 
-	// Call this after you have the region name and handle.
-	void loadObjectCache();
+	// Call this after you have the region name and handle. Returns true
+	// when the cache is read in the background, objectCacheLoaded() is
+	// called once it is done.
+	bool loadObjectCache();
 	void saveObjectCache();
+	bool isObjectCacheLoading(U32 read_id) const	{ return mCacheLoadID && mCacheLoadID == read_id; }
+	void objectCacheLoaded(LLVOCacheStore* store);
 
 	void sendMessage(); // Send the current message to this region's simulator
 	void sendReliableMessage(); // Send the current message to this region's simulator
@@ -346,6 +351,7 @@ public:
 	void dumpCache();
 
 	void unpackRegionHandshake();
+	void sendRegionHandshakeReply();
 
 	void calculateCenterGlobal();
 	void calculateCameraDistance();
@@ -388,6 +394,8 @@ protected:
 	void disconnectAllNeighbors();
 	void initStats();
 	void initPartitions();
+	// The entry of local_id, copied out of the cache store on first use.
+	LLVOCacheEntry* getCacheEntry(U32 local_id);
 
 public:
 	LLWind  mWind;
@@ -459,6 +467,7 @@ private:
 	// a structure of size 2^14 = 16,000
 	BOOL									mCacheLoaded;
 	BOOL                                    mCacheDirty;
+	U32										mCacheLoadID;	// read in progress, 0 when none
 
 	LLDynamicArray<U32>						mCacheMissFull;
 	LLDynamicArray<U32>						mCacheMissCRC;
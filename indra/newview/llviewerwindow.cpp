@@ -41,6 +41,8 @@
 
 #include "llagent.h"
 #include "llagentcamera.h"
+#include "llmeshdecodedcache.h"
+#include "llxmlcompiledcache.h"
 #include "llmeshrepository.h"
 #include "llpanellogin.h"
 #include "llviewerkeyboard.h"
@@ -687,6 +689,31 @@ public:
 				addText(xpos, ypos, llformat("%.3f/%.3f MB Mesh Cache Read/Write ", LLMeshRepository::sCacheBytesRead/(1024.f*1024.f), LLMeshRepository::sCacheBytesWritten/(1024.f*1024.f)));
 
 				ypos += y_inc;
+
+				const LLMeshLODCache& lod_cache = gMeshRepo.mLODCache;
+				addText(xpos, ypos, llformat("%d/%d/%d Mesh LOD Cache Hits/Misses/Evictions, %.3f MB in %d LODs",
+					lod_cache.getHits(), lod_cache.getMisses(), lod_cache.getEvictions(),
+					lod_cache.getBytes()/(1024.f*1024.f), lod_cache.getCount()));
+
+				ypos += y_inc;
+
+				if (LLMeshDecodedCache::isEnabled())
+				{
+					addText(xpos, ypos, llformat("%d/%d Decoded Mesh Cache Hits/Misses, %.3f/%.3f MB Read/Write",
+						LLMeshDecodedCache::getHits(), LLMeshDecodedCache::getMisses(),
+						LLMeshDecodedCache::getBytesRead()/(1024.f*1024.f), LLMeshDecodedCache::getBytesWritten()/(1024.f*1024.f)));
+
+					ypos += y_inc;
+				}
+
+				if (LLXMLCompiledCache::isEnabled())
+				{
+					addText(xpos, ypos, llformat("%d/%d Compiled XML Cache Hits/Misses, %.3f/%.3f MB Read/Write",
+						LLXMLCompiledCache::getHits(), LLXMLCompiledCache::getMisses(),
+						LLXMLCompiledCache::getBytesRead()/(1024.f*1024.f), LLXMLCompiledCache::getBytesWritten()/(1024.f*1024.f)));
+
+					ypos += y_inc;
+				}
 			}
 
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
@@ -69,6 +69,7 @@
 #include "llkeyframewalkmotion.h"
 #include "llmanipscale.h"  // for get_default_max_prim_scale()
 #include "llmeshrepository.h"
+#include "llmeshskinning.h"
 #include "llmutelist.h"
 #include "llnotificationsutil.h"
 #include "llquantize.h"
@@ -77,6 +78,7 @@
 #include "llresmgr.h"
 #include "llselectmgr.h"
 #include "llsprite.h"
+#include "llthreadpool.h"
 #include "lltargetingmotion.h"
 #include "lltoolmorph.h"
 #include "llviewercamera.h"
@@ -1006,6 +1008,8 @@ F32 LLVOAvatar::sLODFactor = 1.f;
 F32 LLVOAvatar::sPhysicsLODFactor = 1.f;
 BOOL LLVOAvatar::sUseImpostors = FALSE;
 BOOL LLVOAvatar::sJointDebug = FALSE;
+bool LLVOAvatar::sQueueSkeletonUpdates = false;
+std::vector<LLPointer<LLVOAvatar> > LLVOAvatar::sQueuedSkeletons;
 F32 LLVOAvatar::sUnbakedTime = 0.f;
 F32 LLVOAvatar::sUnbakedUpdateTime = 0.f;
 F32 LLVOAvatar::sGreyTime = 0.f;
@@ -1067,6 +1071,8 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mPreviousFullyLoaded(FALSE),
 	mFullyLoadedInitialized(FALSE),
 	mSupportsAlphaLayers(FALSE),
+	mSkeletonQueued(false),
+	mSkeletonJointUpdates(0),
 	mLoadedCallbacksPaused(FALSE),
 	mHasPelvisOffset( FALSE ),
 	mLastRezzedStatus(-1),
@@ -2556,6 +2562,100 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, LLWorld &world, const F64 &time)
 	idleUpdateRenderCost();
 }
 
+static LLFastTimer::DeclareTimer FTM_AVATAR_SKELETONS("Avatar Skeletons");
+static LLFastTimer::DeclareTimer FTM_AVATAR_SKELETON_UPDATE("Avatar Skeleton Update");
+
+//pose and skeleton of one avatar, run on a pool thread
+class LLAvatarSkeletonJob : public LLThreadPool::Job
+{
+public:
+	LLAvatarSkeletonJob(LLVOAvatar* avatar) : mAvatar(avatar), mClocks(0) { }
+
+	/*virtual*/ void run()
+	{
+		U32 start = LLFastTimer::getCPUClockCount32();
+		mAvatar->getMotionController().finishDeferredUpdate();
+		mAvatar->updateSkeleton();
+		mClocks = LLFastTimer::getCPUClockCount32() - start;
+	}
+
+	LLVOAvatar* mAvatar;
+	U32 mClocks;	// CPU clocks run() took, fast timers can't run off the main thread
+};
+
+//static
+void LLVOAvatar::beginSkeletonUpdates()
+{
+	sQueueSkeletonUpdates = true;
+}
+
+//static
+void LLVOAvatar::finishSkeletonUpdates()
+{
+	sQueueSkeletonUpdates = false;
+	if (sQueuedSkeletons.empty())
+	{
+		return;
+	}
+
+	std::vector<LLAvatarSkeletonJob> jobs;
+	jobs.reserve(sQueuedSkeletons.size());
+	for (U32 i = 0; i < sQueuedSkeletons.size(); ++i)
+	{
+		if (!sQueuedSkeletons[i]->isDead())
+		{
+			jobs.push_back(LLAvatarSkeletonJob(sQueuedSkeletons[i]));
+		}
+	}
+
+	{
+		// The wall clock time of the whole pass, the main thread waits here.
+		LLFastTimer t(FTM_AVATAR_SKELETONS);
+		LLThreadPool* pool = LLThreadPool::getInstance();
+		if (pool && jobs.size() > 1)
+		{
+			std::vector<LLThreadPool::Job*> job_ptrs;
+			job_ptrs.reserve(jobs.size());
+			for (U32 i = 0; i < jobs.size(); ++i)
+			{
+				job_ptrs.push_back(&jobs[i]);
+			}
+			pool->runBatch(&job_ptrs[0], job_ptrs.size());
+		}
+		else
+		{
+			for (U32 i = 0; i < jobs.size(); ++i)
+			{
+				jobs[i].run();
+			}
+		}
+	}
+
+	// The time of each avatar, reported outside "Avatar Skeletons" since
+	// jobs on different threads overlap and can add up to more than the
+	// wall clock time.
+	for (U32 i = 0; i < jobs.size(); ++i)
+	{
+		LLVOAvatar* avatar = jobs[i].mAvatar;
+		FTM_AVATAR_SKELETON_UPDATE.addTime(jobs[i].mClocks, 1);
+		LLJoint::sNumUpdates += avatar->mSkeletonJointUpdates;
+		avatar->finishCharacterUpdate();
+	}
+
+	for (U32 i = 0; i < sQueuedSkeletons.size(); ++i)
+	{
+		sQueuedSkeletons[i]->mSkeletonQueued = false;
+	}
+	sQueuedSkeletons.clear();
+}
+
+//only touches the joints of this avatar, so that the skeletons of several
+//avatars can be updated at once
+void LLVOAvatar::updateSkeleton()
+{
+	mSkeletonJointUpdates = mFlatSkeleton.updateWorldMatrices(mRoot);
+}
+
 void LLVOAvatar::idleUpdateVoiceVisualizer(bool voice_enabled)
 {
 	bool render_visualizer = voice_enabled;
@@ -4243,11 +4343,57 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 	// store data relevant to motions
 	mSpeed = speed;
 
-	// update animations
+	// update animations; while skeletons are queued, sampling the keyframe
+	// curves and blending the pose are left to finishSkeletonUpdates()
+	mMotionController.setDeferUpdate(sQueueSkeletonUpdates);
 	if (mSpecialRenderMode == 1) // Animation Preview
 		updateMotions(LLCharacter::FORCE_UPDATE);
 	else
 		updateMotions(LLCharacter::NORMAL_UPDATE);
+	mMotionController.setDeferUpdate(false);
+
+	if (sQueueSkeletonUpdates)
+	{
+		if (!mSkeletonQueued)
+		{
+			mSkeletonQueued = true;
+			sQueuedSkeletons.push_back(this);
+		}
+	}
+	else
+	{
+		{
+			LLFastTimer t(FTM_AVATAR_SKELETON_UPDATE);
+			updateSkeleton();
+		}
+		LLJoint::sNumUpdates += mSkeletonJointUpdates;
+		finishCharacterUpdate();
+	}
+
+	if (!mDebugText.size() && mText.notNull())
+	{
+		mText->markDead();
+		mText = NULL;
+	}
+	else if (mDebugText.size())
+	{
+		setDebugText(mDebugText);
+	}
+	mDebugText.clear();
+
+	//mesh vertices need to be reskinned
+	mNeedsSkin = TRUE;
+
+	return TRUE;
+}
+//-----------------------------------------------------------------------------
+// finishCharacterUpdate()
+// The part of updateCharacter() that needs the pose of this update, run
+// once the skeleton is updated.
+//-----------------------------------------------------------------------------
+void LLVOAvatar::finishCharacterUpdate()
+{
+	LLVector3 normal;
 
 	// update head position
 	updateHeadOffset();
@@ -4333,25 +4479,8 @@ BOOL LLVOAvatar::updateCharacter(LLAgent &agent)
 			}
 		}
 	}
-
-	mRoot->updateWorldMatrixChildren();
-
-	if (!mDebugText.size() && mText.notNull())
-	{
-		mText->markDead();
-		mText = NULL;
-	}
-	else if (mDebugText.size())
-	{
-		setDebugText(mDebugText);
-	}
-	mDebugText.clear();
-
-	//mesh vertices need to be reskinned
-	mNeedsSkin = TRUE;
-
-	return TRUE;
 }
+
 //-----------------------------------------------------------------------------
 // updateHeadOffset()
 //-----------------------------------------------------------------------------
@@ -8824,32 +8953,10 @@ void LLVOAvatar::updateLODRiggedAttachments( void )
 	rebuildRiggedAttachments();
 }
 
-void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer)
+U32 LLVOAvatar::buildSkinPalette(const LLMeshSkinInfo* skin, LLMatrix4a* palette)
 {
-	//perform software vertex skinning for this face
-	LLStrider<LLVector3> position;
-	LLStrider<LLVector3> normal;
-
-	bool has_normal = buffer->hasDataType(LLVertexBuffer::TYPE_NORMAL);
-	buffer->getVertexStrider(position);
-
-	if (has_normal)
-	{
-		buffer->getNormalStrider(normal);
-	}
-
-	LLVector4a* pos = (LLVector4a*) position.get();
-
-	LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
-	
-	//build matrix palette
-	LLMatrix4a mp[JOINT_COUNT];
-	LLMatrix4* mat = (LLMatrix4*) mp;
-
 	U32 count = llmin((U32) skin->mJointNames.size(), (U32) JOINT_COUNT);
 
-	llassert_always(count);
-
 	for (U32 j = 0; j < count; ++j)
 	{
 		LLJoint* joint = getJoint(skin->mJointNames[j]);
@@ -8859,64 +8966,51 @@ void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const
 		}
 		if (joint)
 		{
-			mat[j] = skin->mInvBindMatrix[j];
-			mat[j] *= joint->getWorldMatrix();
+			LLMatrix4 mat = skin->mInvBindMatrix[j];
+			mat *= joint->getWorldMatrix();
+			palette[j].loadu(mat);
+		}
+		else
+		{
+			palette[j].loadu(LLMatrix4());
 		}
 	}
 
 	LLMatrix4a bind_shape_matrix;
 	bind_shape_matrix.loadu(skin->mBindShapeMatrix);
+	LLMeshSkinning::applyBindShape(bind_shape_matrix, palette, count);
 
-	for (U32 j = 0; j < (U32)buffer->getNumVerts(); ++j)
-	{
-		LLMatrix4a final_mat;
-		final_mat.clear();
-
-		S32 idx[4];
+	return count;
+}
 
-		LLVector4 wght;
+void LLVOAvatar::updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer)
+{
+	//perform software vertex skinning for this face
+	LLStrider<LLVector3> position;
+	LLStrider<LLVector3> normal;
 
-		F32 scale = 0.f;
-		for (U32 k = 0; k < 4; k++)
-		{
-			F32 w = weight[j][k];
+	bool has_normal = buffer->hasDataType(LLVertexBuffer::TYPE_NORMAL);
+	buffer->getVertexStrider(position);
 
-			idx[k] = (S32) floorf(w);
-			wght[k] = w - floorf(w);
-			scale += wght[k];
-		}
+	if (has_normal)
+	{
+		buffer->getNormalStrider(normal);
+	}
 
-		if(scale > 0.f)
-			wght *= 1.f/scale;
-		else
-			wght = LLVector4(F32_MAX,F32_MAX,F32_MAX,F32_MAX);
+	LLVector4a* pos = (LLVector4a*) position.get();
 
-		for (U32 k = 0; k < 4; k++)
-		{
-			F32 w = wght[k];
-			LLMatrix4a src;
-			src.setMul(mp[idx[k]], w);
+	LLVector4a* norm = has_normal ? (LLVector4a*) normal.get() : NULL;
+	
+	//build matrix palette
+	LLMatrix4a mp[JOINT_COUNT];
+	U32 count = buildSkinPalette(skin, mp);
 
-			final_mat.add(src);
-		}
-		
-		LLVector4a& v = vol_face.mPositions[j];
-		LLVector4a t;
-		LLVector4a dst;
-		bind_shape_matrix.affineTransform(v, t);
-		final_mat.affineTransform(t, dst);
-		pos[j] = dst;
+	llassert_always(count);
 
-		if (norm)
-		{
-			LLVector4a& n = vol_face.mNormals[j];
-			bind_shape_matrix.rotate(n, t);
-			final_mat.rotate(t, dst);
-			dst.normalize3fast();
-			norm[j] = dst;
-		}
-	}
+	LLMeshSkinning::skinVertices(mp, count, weight, vol_face.mPositions, norm ? vol_face.mNormals : NULL,
+								 pos, norm, (U32)buffer->getNumVerts());
 }
+
 U32 LLVOAvatar::getPartitionType() const
 { 
 	// Avatars merely exist as drawables in the bridge partition
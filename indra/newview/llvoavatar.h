@@ -41,6 +41,7 @@
 #include "lldrawpoolalpha.h"
 #include "llviewerobject.h"
 #include "llcharacter.h"
+#include "llflatskeleton.h"
 #include "llcontrol.h"
 #include "llviewerjointmesh.h"
 #include "llviewerjointattachment.h"
@@ -80,6 +81,7 @@ class LLTexGlobalColor;
 class LLViewerJoint;
 struct LLAppearanceMessageContents;
 class LLMeshSkinInfo;
+class LLMatrix4a;
 
 class SHClientTagMgr : public LLSingleton<SHClientTagMgr>, public boost::signals2::trackable
 {
@@ -182,6 +184,9 @@ public:
 	/*virtual*/ BOOL   	 	 	updateLOD();
 	BOOL  	 	 	 	 	updateJointLODs();
 	void						updateLODRiggedAttachments( void );
+	// Fills palette, which must hold JOINT_COUNT matrices, with the skinning
+	// matrices of skin for the current pose and returns how many were set.
+	U32							buildSkinPalette(const LLMeshSkinInfo* skin, LLMatrix4a* palette);
 	void						updateSoftwareSkinnedVertices(const LLMeshSkinInfo* skin, const LLVector4a* weight, const LLVolumeFace& vol_face, LLVertexBuffer *buffer);
 	/*virtual*/ BOOL   	 	 	isActive() const; // Whether this object needs to do an idleUpdate.
 	S32 						totalTextureMemForUUIDS(std::set<LLUUID>& ids);
@@ -304,6 +309,24 @@ public:
 	void 			idleUpdateRenderCost();
 	void 			idleUpdateBelowWater();
 
+	// Between these two calls updateCharacter() leaves sampling the keyframe
+	// motions, blending the pose and the world matrices of the skeleton to
+	// finishSkeletonUpdates(), which does this for all those avatars at once
+	// across the thread pool. The rest of the motion update, which may use
+	// state outside the avatar, still runs in updateCharacter(). Joints read
+	// in between still have the pose of the previous update, what needs the
+	// new pose goes in finishCharacterUpdate(), run after the skeleton.
+	static void		beginSkeletonUpdates();
+	static void		finishSkeletonUpdates();
+	void			updateSkeleton();
+	void			finishCharacterUpdate();
+private:
+	LLFlatSkeleton	mFlatSkeleton; // joints of mRoot in update order
+	bool			mSkeletonQueued;
+	U32				mSkeletonJointUpdates;	// joints updated by the last updateSkeleton()
+	static bool		sQueueSkeletonUpdates;
+	static std::vector<LLPointer<LLVOAvatar> > sQueuedSkeletons;
+
 	//--------------------------------------------------------------------
 	// Static preferences (controlled by user settings/menus)
 	//--------------------------------------------------------------------
@@ -34,9 +34,14 @@
 
 #include "llvocache.h"
 
+#include <algorithm>
+
 #include "llerror.h"
+#include "llfile.h"
 #include "llregionhandle.h"
 #include "llviewercontrol.h"
+#include "llviewerregion.h"
+#include "llworld.h"
 
 BOOL check_read(LLAPRFile* apr_file, void* src, S32 n_bytes) 
 {
@@ -64,6 +69,19 @@ LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &
 	mDP = dp; //memcpy
 }
 
+LLVOCacheEntry::LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, const U8* data, S32 size)
+	:
+	mLocalID(local_id),
+	mCRC(crc),
+	mHitCount(hit_count),
+	mDupeCount(dupe_count),
+	mCRCChangeCount(crc_change_count)
+{
+	mBuffer = new U8[size];
+	memcpy(mBuffer, data, size);
+	mDP.assignBuffer(mBuffer, size);
+}
+
 LLVOCacheEntry::LLVOCacheEntry()
 	:
 	mLocalID(0),
@@ -76,71 +94,6 @@ LLVOCacheEntry::LLVOCacheEntry()
 	mDP.assignBuffer(mBuffer, 0);
 }
 
-LLVOCacheEntry::LLVOCacheEntry(LLAPRFile* apr_file)
-	: mBuffer(NULL)
-{
-	S32 size = -1;
-	BOOL success;
-
-	mDP.assignBuffer(mBuffer, 0);
-	success = check_read(apr_file, &mLocalID, sizeof(U32));
-	if(success)
-	{
-		success = check_read(apr_file, &mCRC, sizeof(U32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mHitCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mDupeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &mCRCChangeCount, sizeof(S32));
-	}
-	if(success)
-	{
-		success = check_read(apr_file, &size, sizeof(S32));
-
-	// Corruption in the cache entries
-	if ((size > 10000) || (size < 1))
-	{
-		// We've got a bogus size, skip reading it.
-		// We won't bother seeking, because the rest of this file
-		// is likely bogus, and will be tossed anyway.
-			llwarns << "Bogus cache entry, size " << size << ", aborting!" << llendl;
-			success = FALSE;
-		}
-	}
-	if(success && size > 0)
-	{
-		mBuffer = new U8[size];
-		success = check_read(apr_file, mBuffer, size);
-
-		if(success)
-		{
-			mDP.assignBuffer(mBuffer, size);
-		}
-		else
-		{
-			delete[] mBuffer ;
-			mBuffer = NULL ;
-		}
-	}
-
-	if(!success)
-	{
-		mLocalID = 0;
-		mCRC = 0;
-		mHitCount = 0;
-		mDupeCount = 0;
-		mCRCChangeCount = 0;
-		mBuffer = NULL;
-	}
-}
-
 LLVOCacheEntry::~LLVOCacheEntry()
 {
 	mDP.freeBuffer();
@@ -193,53 +146,155 @@ void LLVOCacheEntry::dump() const
 		<< llendl;
 }
 
-BOOL LLVOCacheEntry::writeToFile(LLAPRFile* apr_file) const
+//-------------------------------------------------------------------
+//LLVOCache
+//-------------------------------------------------------------------
+// Format string used to construct filename for the object cache
+static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
+
+const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
+const U32 MIN_ENTRIES_TO_PURGE = 16 ;
+const U32 INVALID_TIME = 0 ;
+const char* object_cache_dirname = "objectcache";
+const char* header_filename = "object.cache";
+
+LLVOCache* LLVOCache::sInstance = NULL;
+
+// Work for the cache IO queue.
+class LLVOCache::ReadRequest : public LLVOCacheIOQueue::Request
 {
-	BOOL success;
-	success = check_write(apr_file, (void*)&mLocalID, sizeof(U32));
-	if(success)
+public:
+	ReadRequest(LLVOCache* cache, U32 read_id, U64 handle, const LLUUID& id, const std::string& filename)
+		: mCache(cache), mReadID(read_id), mHandle(handle), mID(id), mFilename(filename) { }
+
+	/*virtual*/ void run()
 	{
-		success = check_write(apr_file, (void*)&mCRC, sizeof(U32));
+		// The store waits in the cache until update() collects it, so a write
+		// of the same file queued in between can unmap it.
+		LLPointer<LLVOCacheStore> store = new LLVOCacheStore;
+		if (!store->open(mFilename, mID))
+		{
+			store = NULL;
+		}
+		mCache->setReadStore(mHandle, mReadID, store);
 	}
-	if(success)
+	/*virtual*/ void done()
 	{
-		success = check_write(apr_file, (void*)&mHitCount, sizeof(S32));
+		ReadRequest* read = this;
+		mCache->mCompletedReads.push(read);
 	}
-	if(success)
+
+	LLVOCache* mCache;
+	U32 mReadID;
+	U64 mHandle;
+	LLUUID mID;
+	std::string mFilename;
+};
+
+class LLVOCache::WriteRequest : public LLVOCacheIOQueue::Request
+{
+public:
+	WriteRequest(LLVOCache* cache, U64 handle, const LLUUID& id, const std::string& filename,
+				 LLPointer<LLVOCacheStore>& store, LLVOCacheEntry::vocache_entry_map_t& entries)
+		: mCache(cache), mHandle(handle), mID(id), mFilename(filename)
 	{
-		success = check_write(apr_file, (void*)&mDupeCount, sizeof(S32));
+		// Hold the only reference, so that dropping it unmaps the file.
+		LLPointer<LLVOCacheStore>::swap(mStore, store);
+		mEntries.swap(entries);
 	}
-	if(success)
+
+	~WriteRequest()
 	{
-		success = check_write(apr_file, (void*)&mCRCChangeCount, sizeof(S32));
+		for (LLVOCacheEntry::vocache_entry_map_t::iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+		{
+			delete iter->second;
+		}
 	}
-	if(success)
+
+	/*virtual*/ void run()
 	{
-		S32 size = mDP.getBufferSize();
-		success = check_write(apr_file, (void*)&size, sizeof(S32));
-	
-		if(success)
+		// A read nobody collected yet would keep the old file mapped.
+		mCache->dropReadStore(mHandle);
+
+		if (mStore.isNull())
+		{
+			// The region left before its read completed, keep what is on disk.
+			LLPointer<LLVOCacheStore> store = new LLVOCacheStore;
+			if (store->open(mFilename, mID))
+			{
+				mStore = store;
+			}
+		}
+
+		std::vector<LLVOCacheStore::IndexEntry> index;
+		std::vector<const U8*> data;
+		index.reserve(mEntries.size());
+		data.reserve(mEntries.size());
+		for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = mEntries.begin(); iter != mEntries.end(); ++iter)
+		{
+			const LLVOCacheEntry* cache_entry = iter->second;
+			LLVOCacheStore::IndexEntry entry;
+			entry.mLocalID = cache_entry->getLocalID();
+			entry.mCRC = cache_entry->getCRC();
+			entry.mHitCount = cache_entry->getHitCount();
+			entry.mDupeCount = cache_entry->getDupeCount();
+			entry.mCRCChangeCount = cache_entry->getCRCChangeCount();
+			entry.mOffset = 0;
+			entry.mSize = llmax(cache_entry->getDataSize(), 0);
+			index.push_back(entry);
+			data.push_back(cache_entry->getData());
+		}
+
+		if (!LLVOCacheStore::write(mFilename, mID, mStore, index, data, MAX_OBJECT_CACHE_ENTRIES))
 		{
-			success = check_write(apr_file, (void*)mBuffer, size);
+			llwarns << "Failed to write object cache file " << mFilename << ", the objects of this visit are lost" << llendl;
 		}
 	}
 
-	return success ;
-}
+	LLVOCache* mCache;
+	U64 mHandle;
+	LLUUID mID;
+	std::string mFilename;
+	LLPointer<LLVOCacheStore> mStore;
+	LLVOCacheEntry::vocache_entry_map_t mEntries;
+};
 
-//-------------------------------------------------------------------
-//LLVOCache
-//-------------------------------------------------------------------
-// Format string used to construct filename for the object cache
-static const char OBJECT_CACHE_FILENAME[] = "objects_%d_%d.slc";
+class LLVOCache::HeaderRequest : public LLVOCacheIOQueue::Request
+{
+public:
+	HeaderRequest(const std::string& filename, const HeaderEntryInfo& entry)
+		: mFilename(filename), mEntry(entry) { }
 
-const U32 MAX_NUM_OBJECT_ENTRIES = 128 ;
-const U32 MIN_ENTRIES_TO_PURGE = 16 ;
-const U32 INVALID_TIME = 0 ;
-const char* object_cache_dirname = "objectcache";
-const char* header_filename = "object.cache";
+	/*virtual*/ void run()
+	{
+		LLAPRFile apr_file(mFilename, APR_WRITE|APR_BINARY);
+		apr_file.seek(APR_SET, mEntry.mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
+		if (!check_write(&apr_file, (void*)&mEntry, sizeof(HeaderEntryInfo)))
+		{
+			llwarns << "Failed to update cache header index " << mEntry.mIndex << ". handle = " << mEntry.mHandle << llendl;
+		}
+	}
 
-LLVOCache* LLVOCache::sInstance = NULL;
+	std::string mFilename;
+	HeaderEntryInfo mEntry;
+};
+
+class LLVOCache::RemoveRequest : public LLVOCacheIOQueue::Request
+{
+public:
+	RemoveRequest(LLVOCache* cache, U64 handle, const std::string& filename)
+		: mCache(cache), mHandle(handle), mFilename(filename) { }
+
+	/*virtual*/ void run()
+	{
+		mCache->dropReadStore(mHandle);
+		LLFile::remove(mFilename);
+	}
+
+	LLVOCache* mCache;
+	U64 mHandle;
+	std::string mFilename;
+};
 
 //static 
 LLVOCache* LLVOCache::getInstance() 
@@ -271,16 +326,26 @@ LLVOCache::LLVOCache():
 	mInitialized(FALSE),
 	mReadOnly(TRUE),
 	mNumEntries(0),
-	mCacheSize(1)
+	mCacheSize(1),
+	mNextReadID(0)
 {
 	mEnabled = gSavedSettings.getBOOL("ObjectCacheEnabled");
 }
 
 LLVOCache::~LLVOCache()
 {
+	mIOQueue.flushRequests();
+	std::vector<ReadRequest*> completed;
+	mCompletedReads.take(completed);
+	for (std::vector<ReadRequest*>::iterator iter = completed.begin(); iter != completed.end(); ++iter)
+	{
+		delete *iter;
+	}
+	mReadStores.clear();
+
 	if(mEnabled)
 	{
-		writeCacheHeader();
+		// The header is updated entry by entry as regions are written.
 		clearCacheInMemory();
 	}
 }
@@ -339,6 +404,12 @@ void LLVOCache::removeCache(ELLPath location)
 
 	llinfos << "about to remove the object cache due to settings." << llendl ;
 
+	mIOQueue.flushRequests();
+	// Uncollected reads would keep their files mapped.
+	mReadStoresMutex.lock();
+	mReadStores.clear();
+	mReadStoresMutex.unlock();
+
 	std::string mask = "*";
 	std::string cache_dir = gDirUtilp->getExpandedFilename(location, object_cache_dirname);
 	llinfos << "Removing cache at " << cache_dir << llendl;
@@ -360,6 +431,12 @@ void LLVOCache::removeCache()
 
 	llinfos << "about to remove the object cache due to some error." << llendl ;
 
+	mIOQueue.flushRequests();
+	// Uncollected reads would keep their files mapped.
+	mReadStoresMutex.lock();
+	mReadStores.clear();
+	mReadStoresMutex.unlock();
+
 	std::string mask = "*";
 	llinfos << "Removing cache at " << mObjectCacheDirName << llendl;
 	gDirUtilp->deleteFilesInDir(mObjectCacheDirName, mask); 
@@ -439,7 +516,7 @@ void LLVOCache::removeFromCache(HeaderEntryInfo* entry)
 
 	std::string filename;
 	getObjectCacheFilename(entry->mHandle, filename);
-	LLAPRFile::remove(filename);
+	mIOQueue.queueRequest(new RemoveRequest(this, entry->mHandle, filename));
 	entry->mTime = INVALID_TIME ;
 	updateEntry(entry) ; //update the head file.
 }
@@ -488,7 +565,9 @@ void LLVOCache::readCacheHeader()
 					continue ; //an empty entry
 				}
 
-				entry->mIndex = mNumEntries++ ;
+				// Entries are updated in place, keep the slot they came from.
+				entry->mIndex = num_read - 1 ;
+				mNumEntries++ ;
 				mHeaderEntryQueue.insert(entry) ;
 				mHandleEntryMap[entry->mHandle] = entry ;
 				entry = NULL ;
@@ -579,20 +658,30 @@ void LLVOCache::writeCacheHeader()
 	return ;
 }
 
-BOOL LLVOCache::updateEntry(const HeaderEntryInfo* entry)
+void LLVOCache::updateEntry(const HeaderEntryInfo* entry)
 {
-	LLAPRFile apr_file(mHeaderFileName, APR_WRITE|APR_BINARY);
-	apr_file.seek(APR_SET, entry->mIndex * sizeof(HeaderEntryInfo) + sizeof(HeaderMetaInfo)) ;
+	mIOQueue.queueRequest(new HeaderRequest(mHeaderFileName, *entry));
+}
 
-	return check_write(&apr_file, (void*)entry, sizeof(HeaderEntryInfo)) ;
+S32 LLVOCache::getFreeIndex() const
+{
+	std::vector<bool> used(MAX_NUM_OBJECT_ENTRIES, false);
+	for (handle_entry_map_t::const_iterator iter = mHandleEntryMap.begin(); iter != mHandleEntryMap.end(); ++iter)
+	{
+		if (iter->second->mIndex >= 0 && iter->second->mIndex < (S32)MAX_NUM_OBJECT_ENTRIES)
+		{
+			used[iter->second->mIndex] = true;
+		}
+	}
+	return (S32)(std::find(used.begin(), used.end(), false) - used.begin());
 }
 
-void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) 
+U32 LLVOCache::readFromCache(U64 handle, const LLUUID& id) 
 {
 	if(!mEnabled)
 	{
 		llwarns << "Not reading cache for handle " << handle << "): Cache is currently disabled." << llendl;
-		return ;
+		return 0;
 	}
 	llassert_always(mInitialized);
 
@@ -600,59 +689,41 @@ void LLVOCache::readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::voca
 	if(iter == mHandleEntryMap.end()) //no cache
 	{
 		llwarns << "No handle map entry for " << handle << llendl;
-		return ;
+		return 0;
 	}
 
-	bool success = true ;
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	if (!++mNextReadID)
 	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_READ|APR_BINARY);
-	
-		LLUUID cache_id ;
-		success = check_read(&apr_file, cache_id.mData, UUID_BYTES) ;
-	
-		if(success)
-		{		
-			if(cache_id != id)
-			{
-				llinfos << "Cache ID doesn't match for this region, discarding"<< llendl;
-				success = false ;
-			}
-
-			if(success)
-			{
-				S32 num_entries;
-				success = check_read(&apr_file, &num_entries, sizeof(S32)) ;
-	
-				if(success)
-				{
-					for (S32 i = 0; i < num_entries; i++)
-					{
-						LLVOCacheEntry* entry = new LLVOCacheEntry(&apr_file);
-						if (!entry->getLocalID())
-						{
-							llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
-							delete entry ;
-							success = false ;
-							break ;
-						}
-						cache_entry_map[entry->getLocalID()] = entry;
-					}
-				}
-			}
-		}		
+		++mNextReadID;
 	}
-	
-	if(!success)
+	mCompletedReads.expect();
+	mIOQueue.queueRequest(new ReadRequest(this, mNextReadID, handle, id, filename));
+	return mNextReadID;
+}
+
+void LLVOCache::update()
+{
+	std::vector<ReadRequest*> completed;
+	mCompletedReads.take(completed);
+
+	for (std::vector<ReadRequest*>::iterator iter = completed.begin(); iter != completed.end(); ++iter)
 	{
-		if(cache_entry_map.empty())
+		ReadRequest* read = *iter;
+		LLPointer<LLVOCacheStore> store = takeReadStore(read->mHandle, read->mReadID);
+		// The region may be gone, or may have asked again since.
+		LLViewerRegion* regionp = LLWorld::getInstance()->getRegionFromHandle(read->mHandle);
+		if (regionp && regionp->isObjectCacheLoading(read->mReadID))
 		{
-			removeEntry(iter->second) ;
+			if (store.isNull())
+			{
+				removeEntry(read->mHandle);
+			}
+			regionp->objectCacheLoaded(store);
 		}
+		delete read;
 	}
-
-	return ;
 }
 	
 void LLVOCache::purgeEntries(U32 size)
@@ -669,7 +740,7 @@ void LLVOCache::purgeEntries(U32 size)
 	mNumEntries = mHandleEntryMap.size() ;
 }
 
-void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) 
+void LLVOCache::writeToCache(U64 handle, const LLUUID& id, LLPointer<LLVOCacheStore>& store, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) 
 {
 	if(!mEnabled)
 	{
@@ -696,9 +767,10 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 		entry = new HeaderEntryInfo();
 		entry->mHandle = handle ;
 		entry->mTime = time(NULL) ;
-		entry->mIndex = mNumEntries++;
+		entry->mIndex = getFreeIndex();
 		mHeaderEntryQueue.insert(entry) ;
 		mHandleEntryMap[handle] = entry ;
+		mNumEntries = mHandleEntryMap.size() ;
 	}
 	else
 	{
@@ -713,11 +785,7 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 	}
 
 	//update cache header
-	if(!updateEntry(entry))
-	{
-		llwarns << "Failed to update cache header index " << entry->mIndex << ". handle = " << handle << llendl;
-		return ; //update failed.
-	}
+	updateEntry(entry);
 
 	if(!dirty_cache)
 	{
@@ -726,33 +794,44 @@ void LLVOCache::writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry:
 	}
 
 	//write to cache file
-	bool success = true ;
-	{
-		std::string filename;
-		getObjectCacheFilename(handle, filename);
-		LLAPRFile apr_file(filename, APR_CREATE|APR_WRITE|APR_BINARY);
-	
-		success = check_write(&apr_file, (void*)id.mData, UUID_BYTES) ;
+	std::string filename;
+	getObjectCacheFilename(handle, filename);
+	mIOQueue.queueRequest(new WriteRequest(this, handle, id, filename, store, cache_entry_map));
+}
 
-	
-		if(success)
-		{
-			S32 num_entries = cache_entry_map.size() ;
-			success = check_write(&apr_file, &num_entries, sizeof(S32));
-	
-			for (LLVOCacheEntry::vocache_entry_map_t::const_iterator iter = cache_entry_map.begin(); success && iter != cache_entry_map.end(); ++iter)
-			{
-				success = iter->second->writeToFile(&apr_file) ;
-			}
-		}
+void LLVOCache::setReadStore(U64 handle, U32 read_id, LLVOCacheStore* store)
+{
+	LLMutexLock lock(&mReadStoresMutex);
+	if (store)
+	{
+		mReadStores[handle] = std::make_pair(read_id, LLPointer<LLVOCacheStore>(store));
 	}
-
-	if(!success)
+	else
 	{
-		removeEntry(entry) ;
-
+		mReadStores.erase(handle);
 	}
+}
 
-	return ;
+LLPointer<LLVOCacheStore> LLVOCache::takeReadStore(U64 handle, U32 read_id)
+{
+	LLPointer<LLVOCacheStore> store;
+	LLMutexLock lock(&mReadStoresMutex);
+	read_store_map_t::iterator iter = mReadStores.find(handle);
+	if (iter != mReadStores.end() && iter->second.first == read_id)
+	{
+		store = iter->second.second;
+		mReadStores.erase(iter);
+	}
+	return store;
 }
 
+void LLVOCache::dropReadStore(U64 handle)
+{
+	LLMutexLock lock(&mReadStoresMutex);
+	read_store_map_t::iterator iter = mReadStores.find(handle);
+	if (iter != mReadStores.end())
+	{
+		llinfos << "Dropping uncollected object cache read of region " << handle << " before its file changes" << llendl;
+		mReadStores.erase(iter);
+	}
+}
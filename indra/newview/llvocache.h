@@ -37,6 +37,10 @@
 #include "lldatapacker.h"
 #include "lldlinked.h"
 #include "lldir.h"
+#include "llpointer.h"
+#include "llthread.h"
+#include "llthreadpool.h"
+#include "llvocachestore.h"
 
 
 //---------------------------------------------------------------------------
@@ -47,17 +51,19 @@ class LLVOCacheEntry
 {
 public:
 	LLVOCacheEntry(U32 local_id, U32 crc, LLDataPackerBinaryBuffer &dp);
-	LLVOCacheEntry(LLAPRFile* apr_file);
+	LLVOCacheEntry(U32 local_id, U32 crc, S32 hit_count, S32 dupe_count, S32 crc_change_count, const U8* data, S32 size);
 	LLVOCacheEntry();
 	~LLVOCacheEntry();
 
 	U32 getLocalID() const			{ return mLocalID; }
 	U32 getCRC() const				{ return mCRC; }
 	S32 getHitCount() const			{ return mHitCount; }
+	S32 getDupeCount() const		{ return mDupeCount; }
 	S32 getCRCChangeCount() const	{ return mCRCChangeCount; }
+	const U8* getData() const		{ return mBuffer; }
+	S32 getDataSize() const			{ return mDP.getBufferSize(); }
 
 	void dump() const;
-	BOOL writeToFile(LLAPRFile* apr_file) const;
 	void assignCRC(U32 crc, LLDataPackerBinaryBuffer &dp);
 	LLDataPackerBinaryBuffer *getDP(U32 crc);
 	void recordHit();
@@ -77,7 +83,9 @@ protected:
 };
 
 //
-//Note: LLVOCache is not thread-safe
+//Note: LLVOCache is not thread-safe, except for the IO queue. All file
+//access other than reading the header at startup goes through that queue,
+//so it happens in the order it was requested and off the main thread.
 //
 class LLVOCache
 {
@@ -111,6 +119,19 @@ private:
 	};
 	typedef std::set<HeaderEntryInfo*, header_entry_less> header_entry_queue_t;
 	typedef std::map<U64, HeaderEntryInfo*> handle_entry_map_t;
+
+	class ReadRequest;
+	class WriteRequest;
+	class HeaderRequest;
+	class RemoveRequest;
+	friend class ReadRequest;
+	friend class WriteRequest;
+	friend class RemoveRequest;
+
+	// Stores of completed reads, by region handle, until update() collects
+	// them. Kept here rather than in the requests so that a write or removal
+	// of the same file can unmap them first.
+	typedef std::map<U64, std::pair<U32, LLPointer<LLVOCacheStore> > > read_store_map_t;
 private:
 	LLVOCache() ;
 
@@ -120,10 +141,20 @@ public:
 	void initCache(ELLPath location, U32 size, U32 cache_version) ;
 	void removeCache(ELLPath location) ;
 
-	void readFromCache(U64 handle, const LLUUID& id, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map) ;
-	void writeToCache(U64 handle, const LLUUID& id, const LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) ;
+	// Queues reading the cache file of a region. Returns 0 when there is
+	// nothing to read, otherwise an ID that update() passes to the region
+	// together with the store once the read completed.
+	U32  readFromCache(U64 handle, const LLUUID& id) ;
+	// Queues writing the objects of a region. The entries in cache_entry_map
+	// and the reference in store are taken over, leaving both empty, so the
+	// old file is no longer mapped when it gets replaced; entries of store
+	// that aren't in the map are kept.
+	void writeToCache(U64 handle, const LLUUID& id, LLPointer<LLVOCacheStore>& store, LLVOCacheEntry::vocache_entry_map_t& cache_entry_map, BOOL dirty_cache) ;
 	void removeEntry(U64 handle) ;
 
+	// Hands completed reads to their regions. Main thread only.
+	void update() ;
+
 	void setReadOnly(BOOL read_only) {mReadOnly = read_only;} 
 
 private:
@@ -137,7 +168,15 @@ private:
 	void removeCache() ;
 	void removeEntry(HeaderEntryInfo* entry) ;
 	void purgeEntries(U32 size);
-	BOOL updateEntry(const HeaderEntryInfo* entry);
+	void updateEntry(const HeaderEntryInfo* entry);
+	S32  getFreeIndex() const;
+
+	// IO thread side of the read stores, a NULL store means the read failed.
+	void setReadStore(U64 handle, U32 read_id, LLVOCacheStore* store);
+	// Main thread side, NULL unless read_id is the last read of handle.
+	LLPointer<LLVOCacheStore> takeReadStore(U64 handle, U32 read_id);
+	// Called on the IO thread before the file of handle changes.
+	void dropReadStore(U64 handle);
 	
 private:
 	BOOL                 mEnabled;
@@ -151,6 +190,12 @@ private:
 	header_entry_queue_t mHeaderEntryQueue;
 	handle_entry_map_t   mHandleEntryMap;	
 
+	U32                  mNextReadID;
+	LLVOCacheIOQueue     mIOQueue;
+	LLThreadPoolResults<ReadRequest*> mCompletedReads;
+	LLMutex              mReadStoresMutex;		// protects mReadStores
+	read_store_map_t     mReadStores;
+
 	static LLVOCache* sInstance ;
 public:
 	static LLVOCache* getInstance() ;
@@ -0,0 +1,303 @@
+/**
+ * @file llvocachestore.cpp
+ * @brief Mapped region object cache files and the queue doing their IO.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "llvocachestore.h"
+
+#include "llerror.h"
+#include "llfile.h"
+#include "llthreadpool.h"
+
+//---------------------------------------------------------------------------
+// LLVOCacheStore
+//---------------------------------------------------------------------------
+
+// Layout of a region cache file:
+//   U32 magic, LLUUID region cache id, S32 number of entries,
+//   IndexEntry[number of entries] sorted by local ID,
+//   the packed data of the entries.
+static const U32 OBJECT_CACHE_MAGIC = 0x32434f56;	// "VOC2"
+static const S32 OBJECT_CACHE_INDEX_OFFSET = sizeof(U32) + UUID_BYTES + sizeof(S32);
+static const U32 MAX_OBJECT_CACHE_ENTRY_SIZE = 10000;
+
+LLVOCacheStore::LLVOCacheStore()
+	: mIndex(NULL),
+	  mNumEntries(0)
+{
+}
+
+LLVOCacheStore::~LLVOCacheStore()
+{
+}
+
+bool LLVOCacheStore::open(const std::string& filename, const LLUUID& id)
+{
+	if (!LLFile::isfile(filename) || !mFile.open(filename, LLMappedFile::READ_ONLY))
+	{
+		return false;
+	}
+
+	const U8* data = mFile.getData();
+	size_t size = mFile.getSize();
+	if (size < (size_t)OBJECT_CACHE_INDEX_OFFSET || *(const U32*)data != OBJECT_CACHE_MAGIC)
+	{
+		llwarns << "Bad object cache file " << filename << ", discarding" << llendl;
+		mFile.close();
+		return false;
+	}
+	if (memcmp(data + sizeof(U32), id.mData, UUID_BYTES))
+	{
+		llinfos << "Cache ID doesn't match for this region, discarding" << llendl;
+		mFile.close();
+		return false;
+	}
+
+	S32 num_entries = *(const S32*)(data + sizeof(U32) + UUID_BYTES);
+	bool success = num_entries >= 0 &&
+		(size - OBJECT_CACHE_INDEX_OFFSET) / sizeof(IndexEntry) >= (size_t)num_entries;
+	const IndexEntry* index = (const IndexEntry*)(data + OBJECT_CACHE_INDEX_OFFSET);
+	for (S32 i = 0; success && i < num_entries; ++i)
+	{
+		// Entries have to be sorted for find() and their data in the file.
+		success = (i == 0 || index[i - 1].mLocalID < index[i].mLocalID) &&
+				  index[i].mSize > 0 && index[i].mSize <= MAX_OBJECT_CACHE_ENTRY_SIZE &&
+				  index[i].mOffset <= size && size - index[i].mOffset >= index[i].mSize;
+	}
+	if (!success)
+	{
+		llwarns << "Aborting cache file load for " << filename << ", cache file corruption!" << llendl;
+		mFile.close();
+		return false;
+	}
+
+	// Touch every page while still on the IO thread, so the main thread
+	// doesn't wait for the disk when it copies entries out.
+	U32 sum = 0;
+	for (size_t offset = 0; offset < size; offset += 4096)
+	{
+		sum += data[offset];
+	}
+	static volatile U32 sink;
+	sink = sum;
+
+	mIndex = index;
+	mNumEntries = num_entries;
+	return true;
+}
+
+const LLVOCacheStore::IndexEntry* LLVOCacheStore::find(U32 local_id) const
+{
+	S32 low = 0;
+	S32 high = mNumEntries;
+	while (low < high)
+	{
+		S32 mid = (low + high) / 2;
+		if (mIndex[mid].mLocalID < local_id)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	if (low < mNumEntries && mIndex[low].mLocalID == local_id)
+	{
+		return &mIndex[low];
+	}
+	return NULL;
+}
+
+//static
+bool LLVOCacheStore::write(const std::string& filename, const LLUUID& id, LLPointer<LLVOCacheStore>& store,
+						   const std::vector<IndexEntry>& entries, const std::vector<const U8*>& data,
+						   U32 max_entries)
+{
+	// Merge both sorted lists, the new entries replace those of the store.
+	std::vector<IndexEntry> index;
+	std::vector<const U8*> index_data;
+	S32 count = store.notNull() ? store->getNumEntries() : 0;
+	index.reserve(entries.size() + count);
+	index_data.reserve(index.capacity());
+	size_t next = 0;
+	S32 i = 0;
+	while ((next < entries.size() || i < count) && index.size() < max_entries)
+	{
+		if (i < count && (next == entries.size() || store->getIndexEntry(i).mLocalID < entries[next].mLocalID))
+		{
+			index.push_back(store->getIndexEntry(i));
+			index_data.push_back(store->getData(index.back()));
+			++i;
+		}
+		else
+		{
+			if (i < count && store->getIndexEntry(i).mLocalID == entries[next].mLocalID)
+			{
+				++i;
+			}
+			if (entries[next].mSize > 0)
+			{
+				index.push_back(entries[next]);
+				index_data.push_back(data[next]);
+			}
+			++next;
+		}
+	}
+
+	S32 num_entries = (S32)index.size();
+	U32 offset = OBJECT_CACHE_INDEX_OFFSET + num_entries * sizeof(IndexEntry);
+	for (S32 j = 0; j < num_entries; ++j)
+	{
+		index[j].mOffset = offset;
+		offset += index[j].mSize;
+	}
+
+	// Build the whole file so it goes out in a single write.
+	std::vector<U8> buffer(offset);
+	U8* dst = &buffer[0];
+	*(U32*)dst = OBJECT_CACHE_MAGIC;
+	memcpy(dst + sizeof(U32), id.mData, UUID_BYTES);
+	memcpy(dst + sizeof(U32) + UUID_BYTES, &num_entries, sizeof(S32));
+	if (num_entries)
+	{
+		memcpy(dst + OBJECT_CACHE_INDEX_OFFSET, &index[0], num_entries * sizeof(IndexEntry));
+	}
+	for (S32 j = 0; j < num_entries; ++j)
+	{
+		memcpy(dst + index[j].mOffset, index_data[j], index[j].mSize);
+	}
+
+	// Unmap the old file before replacing it, Windows can't replace a
+	// mapped file.
+	index_data.clear();
+	if (store.notNull() && store->getNumRefs() > 1)
+	{
+		llwarns << "Object cache file " << filename << " is still mapped, replacing it may fail" << llendl;
+	}
+	store = NULL;
+
+	return LLFile::write_replace(filename, dst, buffer.size());
+}
+
+//---------------------------------------------------------------------------
+// LLVOCacheIOQueue
+//---------------------------------------------------------------------------
+
+class LLVOCacheIOQueue::IOTask : public LLThreadPool::Task
+{
+public:
+	IOTask(LLVOCacheIOQueue* queue) : mQueue(queue) { }
+	/*virtual*/ void run()
+	{
+		mQueue->processRequests();
+	}
+	/*virtual*/ void drop()
+	{
+		// flushRequests() runs the rest.
+		mQueue->mRequestCondition.lock();
+		mQueue->mProcessing = false;
+		mQueue->mRequestCondition.broadcast();
+		mQueue->mRequestCondition.unlock();
+	}
+
+private:
+	LLVOCacheIOQueue* mQueue;
+};
+
+LLVOCacheIOQueue::LLVOCacheIOQueue()
+	: mProcessing(false)
+{
+}
+
+LLVOCacheIOQueue::~LLVOCacheIOQueue()
+{
+	flushRequests();
+}
+
+void LLVOCacheIOQueue::queueRequest(Request* request)
+{
+	LLThreadPool* pool = LLThreadPool::getInstance();
+	mRequestCondition.lock();
+	mRequests.push_back(request);
+	bool start = !mProcessing;
+	mProcessing = true;
+	mRequestCondition.unlock();
+
+	if (start)
+	{
+		// A single task works through the queue, so requests for the same
+		// file never overtake each other. It goes on the high lane: regions
+		// hold back their handshake reply until their cache file is read,
+		// and normal lane work could otherwise keep it waiting.
+		if (pool)
+		{
+			pool->post(new IOTask(this), LLThreadPool::LANE_HIGH);
+		}
+		else
+		{
+			processRequests();
+		}
+	}
+}
+
+void LLVOCacheIOQueue::processRequests()
+{
+	while (true)
+	{
+		mRequestCondition.lock();
+		if (mRequests.empty())
+		{
+			mProcessing = false;
+			mRequestCondition.broadcast();
+			mRequestCondition.unlock();
+			return;
+		}
+		Request* request = mRequests.front();
+		mRequests.pop_front();
+		mRequestCondition.unlock();
+
+		request->run();
+		request->done();
+	}
+}
+
+void LLVOCacheIOQueue::flushRequests()
+{
+	mRequestCondition.lock();
+	while (mProcessing)
+	{
+		mRequestCondition.wait();
+	}
+	bool left = !mRequests.empty();
+	mProcessing = left;
+	mRequestCondition.unlock();
+
+	if (left)
+	{
+		processRequests();
+	}
+}
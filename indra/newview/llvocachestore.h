@@ -0,0 +1,130 @@
+/**
+ * @file llvocachestore.h
+ * @brief Mapped region object cache files and the queue doing their IO.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOCACHESTORE_H
+#define LL_LLVOCACHESTORE_H
+
+#include <deque>
+#include <vector>
+
+#include "llmappedfile.h"
+#include "llpointer.h"
+#include "llthread.h"
+#include "lluuid.h"
+
+//---------------------------------------------------------------------------
+// The cache file of one region, mapped into memory.
+//
+// The file starts with an index sorted by local ID, followed by the packed
+// object data. Nothing but the index is looked at when the file is opened;
+// entries are copied out one at a time when a cached object update asks
+// for them. Stores are opened on the cache IO thread and only used by the
+// main thread once handed to the region.
+class LLVOCacheStore : public LLThreadSafeRefCount
+{
+public:
+	struct IndexEntry
+	{
+		U32 mLocalID;
+		U32 mCRC;
+		S32 mHitCount;
+		S32 mDupeCount;
+		S32 mCRCChangeCount;
+		U32 mOffset;		// from the start of the file
+		U32 mSize;
+	};
+
+	LLVOCacheStore();
+
+	// Maps filename and checks its index. Fails when the file is missing,
+	// corrupt or belongs to another region than id.
+	bool open(const std::string& filename, const LLUUID& id);
+
+	S32 getNumEntries() const						{ return mNumEntries; }
+	const IndexEntry& getIndexEntry(S32 i) const	{ return mIndex[i]; }
+	const U8* getData(const IndexEntry& index) const { return mFile.getData() + index.mOffset; }
+
+	// Binary search of the index, NULL when local_id isn't cached.
+	const IndexEntry* find(U32 local_id) const;
+
+	// Replaces filename with a file of region id holding entries, whose data
+	// is in data and whose offsets are ignored, and the entries of store
+	// that have no entry of the same local ID there. Entries must be sorted
+	// by local ID, those of size 0 are left out. At most max_entries are
+	// written. Drops the reference in store before the file is replaced,
+	// which has to be the last one as a mapped file can't be replaced on
+	// Windows.
+	static bool write(const std::string& filename, const LLUUID& id, LLPointer<LLVOCacheStore>& store,
+					  const std::vector<IndexEntry>& entries, const std::vector<const U8*>& data,
+					  U32 max_entries);
+
+protected:
+	~LLVOCacheStore();
+
+private:
+	LLMappedFile		mFile;
+	const IndexEntry*	mIndex;
+	S32					mNumEntries;
+};
+
+//---------------------------------------------------------------------------
+// Runs the requests given to it one after the other, in order, on the
+// shared thread pool, or right away when there is no pool. Requests for
+// the same file thus never overtake each other.
+class LLVOCacheIOQueue
+{
+public:
+	class Request
+	{
+	public:
+		virtual ~Request() { }
+		virtual void run() = 0;
+		// Called on the same thread right after run(). Deletes the request
+		// unless it is handed on.
+		virtual void done()								{ delete this; }
+	};
+
+	LLVOCacheIOQueue();
+	// Runs what is still queued.
+	~LLVOCacheIOQueue();
+
+	void queueRequest(Request* request);
+	// Waits for the pool to finish and runs what is left on this thread.
+	void flushRequests();
+
+private:
+	class IOTask;
+	friend class IOTask;
+
+	// Runs queued requests until the queue is empty.
+	void processRequests();
+
+	LLCondition          mRequestCondition;		// protects the members below
+	std::deque<Request*> mRequests;
+	bool                 mProcessing;			// an IOTask is queued or running
+};
+
+#endif
@@ -227,6 +227,7 @@ LLVOVolume::LLVOVolume(const LLUUID &id, const LLPCode pcode, LLViewerRegion *re
 	mNumFaces = 0;
 	mLODChanged = FALSE;
 	mSculptChanged = FALSE;
+	mVolumeStandIn = FALSE;
 	mSpotLightPriority = 0.f;
 
 	mMediaImplList.resize(getNumTEs());
@@ -1012,7 +1013,9 @@ BOOL LLVOVolume::setVolume(const LLVolumeParams &params_in, const S32 detail, bo
 
 	}
 
-	if ((LLPrimitive::setVolume(volume_params, lod, (mVolumeImpl && mVolumeImpl->isVolumeUnique()))) || mSculptChanged)
+	BOOL changed = LLPrimitive::setVolume(volume_params, lod, (mVolumeImpl && mVolumeImpl->isVolumeUnique()));
+	mVolumeStandIn = getVolume() && getVolume()->getDetail() != LLVolumeLODGroup::getVolumeScaleFromDetail(lod);
+	if (changed || mSculptChanged)
 	{
 		mFaceMappingChanged = TRUE;
 		
@@ -1291,6 +1294,12 @@ BOOL LLVOVolume::updateLOD()
 	
 	BOOL lod_changed = calcLOD();
 
+	if (!lod_changed && mVolumeStandIn)
+	{
+		// Swap in the volume of mLOD once it has been built.
+		lod_changed = !LLPrimitive::getVolumeManager()->isBuildPending(getVolume()->getParams(), mLOD);
+	}
+
 	if (lod_changed)
 	{
 		gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_VOLUME, FALSE);
@@ -108,6 +108,7 @@
 #include "llwlparammanager.h"
 #include "llwaterparammanager.h"
 #include "llspatialpartition.h"
+#include "llthreadpool.h"
 #include "llmutelist.h"
 #include "llfloatertools.h"
 #include "llpanelface.h"
@@ -2401,6 +2402,10 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 		mCubeVB->setBuffer(LLVertexBuffer::MAP_VERTEX);
 	}
 	
+	static const LLCachedControl<bool> parallel_cull("RenderParallelCull", true);
+	bool cull_parallel = parallel_cull && LLThreadPool::getInstance();
+	std::vector<LLSpatialPartition*> partitions;
+
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
 	{
@@ -2422,10 +2427,30 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result, S32 water_cl
 			{
 				if (hasRenderType(part->mDrawableType))
 				{
-					part->cull(camera);
+					if (cull_parallel)
+					{
+						partitions.push_back(part);
+					}
+					else
+					{
+						part->cull(camera);
+					}
 				}
 			}
 		}
+
+		//the user clip plane differs per region, so regions can only be
+		//culled together when there is none
+		if (water_clip != 0 && !partitions.empty())
+		{
+			LLSpatialPartition::cullParallel(camera, partitions);
+			partitions.clear();
+		}
+	}
+
+	if (!partitions.empty())
+	{
+		LLSpatialPartition::cullParallel(camera, partitions);
 	}
 
 	if (bound_shader)
@@ -2781,6 +2806,7 @@ void LLPipeline::rebuildPriorityGroups()
 	assertInitialized();
 
 	gMeshRepo.notifyLoadedMeshes();
+	LLPrimitive::getVolumeManager()->updateBuilds();
 
 	mGroupQ1Locked = true;
 	// Iterate through all drawables on the priority build queue,
@@ -0,0 +1,197 @@
+/**
+ * @file llfolderviewsearchindex_test.cpp
+ * @brief Test cases for LLFolderViewSearchIndex
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../llfolderviewsearchindex.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+namespace tut
+{
+	struct searchindex_test
+	{
+		LLFolderViewSearchIndex mIndex;
+		std::vector<LLUUID> mIDs;
+
+		searchindex_test()
+		{
+			mIDs.resize(64);
+			for (U32 i = 0; i < mIDs.size(); ++i)
+			{
+				mIDs[i].generate();
+			}
+		}
+
+		// Labels come in folded, the way LLFolderViewItem hands them over.
+		void add(S32 i, std::string label)
+		{
+			LLStringUtil::toUpper(label);
+			mIndex.add(mIDs[i], label);
+		}
+
+		std::string::size_type find(S32 i, std::string sub_string)
+		{
+			LLStringUtil::toUpper(sub_string);
+			std::string::size_type offset = 0;
+			ensure("item is indexed", mIndex.findMatch(mIDs[i], sub_string, offset));
+			return offset;
+		}
+
+		bool matches(S32 i, const std::string& sub_string)
+		{
+			return find(i, sub_string) != std::string::npos;
+		}
+	};
+
+	typedef test_group<searchindex_test> searchindex_t;
+	typedef searchindex_t::object searchindex_object_t;
+	tut::searchindex_t tut_searchindex("LLFolderViewSearchIndex");
+
+	// Sub-string lookup, short strings and missing items
+	template<> template<>
+	void searchindex_object_t::test<1>()
+	{
+		add(0, "Shirt - Blue Denim");
+		add(1, "Pants - Denim");
+		add(2, "Hat");
+
+		ensure_equals("offset in label", find(0, "denim"), (std::string::size_type)13);
+		ensure_equals("offset in other label", find(1, "denim"), (std::string::size_type)8);
+		ensure("no match", !matches(2, "denim"));
+		ensure("whole label", matches(2, "hat"));
+		ensure("longer than label", !matches(2, "hats"));
+
+		// Under three characters every label is searched.
+		ensure_equals("two characters", find(0, "bl"), (std::string::size_type)8);
+		ensure("two characters elsewhere", matches(2, "at"));
+		ensure("empty string", matches(1, ""));
+
+		std::string::size_type offset;
+		ensure("item that isn't indexed", !mIndex.findMatch(mIDs[3], "DENIM", offset));
+	}
+
+	// Case folding
+	template<> template<>
+	void searchindex_object_t::test<2>()
+	{
+		add(0, "Shirt - Blue Denim");
+		add(1, "shirt - blue denim");
+
+		ensure("lower case", matches(0, "blue"));
+		ensure("upper case", matches(0, "BLUE"));
+		ensure("mixed case", matches(1, "bLuE dEn"));
+
+		// The index itself doesn't fold, that is up to the caller.
+		std::string::size_type offset;
+		mIndex.findMatch(mIDs[0], "blue", offset);
+		ensure("unfolded filter", offset == std::string::npos);
+	}
+
+	// Typing on narrows the previous result, backspacing widens it again
+	template<> template<>
+	void searchindex_object_t::test<3>()
+	{
+		add(0, "Blue Shirt");
+		add(1, "Blue Shoes");
+		add(2, "Black Shoes");
+
+		ensure("first", matches(0, "sh"));
+		ensure("narrowed", matches(1, "shoe"));
+		ensure("narrowed out", !matches(0, "shoe"));
+		ensure("narrowed further", matches(2, "shoes"));
+		ensure("widened", matches(0, "sh"));
+		ensure("other string", matches(2, "black"));
+		ensure("other string out", !matches(1, "black"));
+	}
+
+	// Renaming keeps the last result right and moves the label in the index
+	template<> template<>
+	void searchindex_object_t::test<4>()
+	{
+		add(0, "Old Name");
+		add(1, "Other Item");
+		ensure("before rename", matches(0, "old"));
+
+		// Renamed while the search is current.
+		add(0, "New Name");
+		ensure("old label gone", !matches(0, "old"));
+		ensure("new label", matches(0, "new"));
+
+		// update() renames but doesn't add.
+		mIndex.update(mIDs[0], "RENAMED AGAIN");
+		mIndex.update(mIDs[5], "NOT ADDED");
+		ensure("updated", matches(0, "renamed"));
+		ensure("stale trigrams", !matches(0, "new name"));
+		std::string::size_type offset;
+		ensure("update doesn't add", !mIndex.findMatch(mIDs[5], "ADDED", offset));
+
+		// Many renames leave stale postings that get dropped on the way.
+		for (S32 i = 0; i < 2000; ++i)
+		{
+			add(0, llformat("Item number %d with a fairly long label to index", i));
+		}
+		ensure("last rename", matches(0, "number 1999 "));
+		ensure("earlier rename", !matches(0, "number 1998 "));
+		ensure("other item", matches(1, "other"));
+	}
+
+	// Removed items aren't found, their slots are reused
+	template<> template<>
+	void searchindex_object_t::test<5>()
+	{
+		for (S32 i = 0; i < 10; ++i)
+		{
+			add(i, llformat("Folder %d", i));
+		}
+		ensure("before remove", matches(3, "folder"));
+
+		mIndex.remove(mIDs[3]);
+		mIndex.remove(mIDs[7]);
+		mIndex.remove(mIDs[20]);
+		std::string::size_type offset;
+		ensure("removed", !mIndex.findMatch(mIDs[3], "FOLDER", offset));
+
+		// New items take the freed slots, the old labels must not show.
+		add(30, "Texture");
+		add(31, "Sound");
+		ensure("new item", matches(30, "texture"));
+		ensure("reused slot", !matches(31, "folder"));
+		ensure("reused slot label", matches(31, "sound"));
+		ensure("kept item", matches(4, "folder 4"));
+
+		// Added again after being removed.
+		add(3, "Folder 3 again");
+		ensure("added again", matches(3, "again"));
+
+		mIndex.clear();
+		ensure("cleared", !mIndex.findMatch(mIDs[4], "FOLDER", offset));
+		add(4, "Folder 4");
+		ensure("after clear", matches(4, "folder"));
+	}
+}
@@ -0,0 +1,270 @@
+/**
+ * @file llmeshdecodedcache_test.cpp
+ * @brief Test cases for LLMeshDecodedCache
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../llmeshdecodedcache.h"
+
+#include <algorithm>
+
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llfile.h"
+#include "llvolume.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+// A mesh volume with two faces of known content, as if a LOD was decoded.
+// The second face is rigged.
+class LLTestDecodedVolume : public LLVolume
+{
+public:
+	LLTestDecodedVolume(const LLVolumeParams& params, S32 vertices)
+	:	LLVolume(params, 1.f)
+	{
+		mVolumeFaces.clear();
+		mVolumeFaces.resize(2);
+		for (S32 f = 0; f < 2; ++f)
+		{
+			LLVolumeFace& face = mVolumeFaces[f];
+			S32 count = vertices + f * 7;
+			face.resizeVertices(count);
+			face.resizeIndices(count * 3);
+			for (S32 i = 0; i < count; ++i)
+			{
+				face.mPositions[i].set((F32)i, (F32)f, -(F32)i);
+				face.mNormals[i].set(0.f, 0.f, 1.f);
+				face.mTexCoords[i].set((F32)i / count, (F32)f);
+			}
+			for (S32 i = 0; i < count * 3; ++i)
+			{
+				face.mIndices[i] = (U16)((i * 5 + f) % count);
+			}
+			if (f == 1)
+			{
+				face.allocateWeights(count);
+				for (S32 i = 0; i < count; ++i)
+				{
+					face.mWeights[i].set(1.5f, 2.25f, 0.f, (F32)i);
+				}
+			}
+			face.mExtents[0].set(0.f, (F32)f, -(F32)count);
+			face.mExtents[1].set((F32)count, (F32)f, 0.f);
+			face.mTexCoordExtents[0].set(0.f, 0.f);
+			face.mTexCoordExtents[1].set(1.f, (F32)f);
+		}
+	}
+};
+
+namespace tut
+{
+	struct meshdecodedcache_test
+	{
+		meshdecodedcache_test()
+		{
+			LLMeshDecodedCache::initCache(LL_PATH_TEMP, 512, false);
+			mID.generate();
+		}
+		~meshdecodedcache_test()
+		{
+			LLMeshDecodedCache::removeCache(LL_PATH_TEMP);
+		}
+
+		LLVolumeParams meshParams(U8 flags = 0) const
+		{
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+			params.setSculptID(mID, LL_SCULPT_TYPE_MESH | flags);
+			return params;
+		}
+
+		// The only file in the cache directory.
+		static std::string cacheFile()
+		{
+			std::string dir = gDirUtilp->getExpandedFilename(LL_PATH_TEMP, "meshdecoded");
+			std::string filename;
+			LLDirIterator iter(dir, "*.lod");
+			return iter.next(filename) ? gDirUtilp->add(dir, filename) : std::string();
+		}
+
+		static void ensureSameFaces(const char* msg, const LLVolume* expected, const LLVolume* actual)
+		{
+			ensure_equals(msg, actual->getNumVolumeFaces(), expected->getNumVolumeFaces());
+			for (S32 f = 0; f < expected->getNumVolumeFaces(); ++f)
+			{
+				const LLVolumeFace& a = expected->getVolumeFace(f);
+				const LLVolumeFace& b = actual->getVolumeFace(f);
+				ensure_equals(msg, b.mNumVertices, a.mNumVertices);
+				ensure_equals(msg, b.mNumIndices, a.mNumIndices);
+				ensure(msg, !memcmp(b.mPositions, a.mPositions, sizeof(LLVector4a) * a.mNumVertices));
+				ensure(msg, !memcmp(b.mNormals, a.mNormals, sizeof(LLVector4a) * a.mNumVertices));
+				ensure(msg, !memcmp(b.mTexCoords, a.mTexCoords, sizeof(LLVector2) * a.mNumVertices));
+				ensure(msg, !memcmp(b.mIndices, a.mIndices, sizeof(U16) * a.mNumIndices));
+				ensure_equals(msg, b.mWeights != NULL, a.mWeights != NULL);
+				if (a.mWeights)
+				{
+					ensure(msg, !memcmp(b.mWeights, a.mWeights, sizeof(LLVector4a) * a.mNumVertices));
+				}
+				ensure(msg, b.mExtents[0].equals3(a.mExtents[0]) && b.mExtents[1].equals3(a.mExtents[1]));
+				ensure(msg, b.mTexCoordExtents[0] == a.mTexCoordExtents[0] &&
+							b.mTexCoordExtents[1] == a.mTexCoordExtents[1]);
+			}
+		}
+
+		LLUUID mID;
+	};
+
+	typedef test_group<meshdecodedcache_test> meshdecodedcache_t;
+	typedef meshdecodedcache_t::object meshdecodedcache_object_t;
+	tut::meshdecodedcache_t tut_meshdecodedcache("LLMeshDecodedCache");
+
+	// A written LOD reads back into the same faces
+	template<> template<>
+	void meshdecodedcache_object_t::test<1>()
+	{
+		ensure("not enabled", LLMeshDecodedCache::isEnabled());
+		LLPointer<LLVolume> volume = new LLTestDecodedVolume(meshParams(), 40);
+		LLPointer<LLVolume> loaded = new LLVolume(meshParams(), 1.f);
+		U32 hits = LLMeshDecodedCache::getHits();
+		U32 misses = LLMeshDecodedCache::getMisses();
+
+		ensure("hit before write", !LLMeshDecodedCache::read(meshParams(), 2, 1234, loaded));
+		ensure_equals("miss counted", LLMeshDecodedCache::getMisses(), misses + 1);
+
+		U32 written = LLMeshDecodedCache::getBytesWritten();
+		LLMeshDecodedCache::write(meshParams(), 2, 1234, volume);
+		ensure("nothing written", LLMeshDecodedCache::getBytesWritten() > written);
+
+		std::vector<U8> packed;
+		volume->packDecodedFaces(packed);
+		U32 read = LLMeshDecodedCache::getBytesRead();
+		ensure("miss after write", LLMeshDecodedCache::read(meshParams(), 2, 1234, loaded));
+		ensure_equals("hit counted", LLMeshDecodedCache::getHits(), hits + 1);
+		ensure_equals("bytes read", LLMeshDecodedCache::getBytesRead() - read, (U32)packed.size());
+		ensureSameFaces("read faces", volume, loaded);
+
+		// a second hit counts the same again
+		LLPointer<LLVolume> reloaded = new LLVolume(meshParams(), 1.f);
+		ensure("second read missed", LLMeshDecodedCache::read(meshParams(), 2, 1234, reloaded));
+		ensure_equals("second hit counted", LLMeshDecodedCache::getHits(), hits + 2);
+		ensure_equals("second bytes read", LLMeshDecodedCache::getBytesRead() - read, 2 * (U32)packed.size());
+		ensureSameFaces("reread faces", volume, reloaded);
+	}
+
+	// Other LODs, flags and asset sizes miss, a stale file is deleted
+	template<> template<>
+	void meshdecodedcache_object_t::test<2>()
+	{
+		LLPointer<LLVolume> volume = new LLTestDecodedVolume(meshParams(), 20);
+		LLPointer<LLVolume> loaded = new LLVolume(meshParams(), 1.f);
+		LLMeshDecodedCache::write(meshParams(), 3, 500, volume);
+
+		ensure("other lod hit", !LLMeshDecodedCache::read(meshParams(), 2, 500, loaded));
+		ensure("mirrored hit", !LLMeshDecodedCache::read(meshParams(LL_SCULPT_FLAG_MIRROR), 3, 500, loaded));
+		ensure("inverted hit", !LLMeshDecodedCache::read(meshParams(LL_SCULPT_FLAG_INVERT), 3, 500, loaded));
+		ensure("still there", !cacheFile().empty());
+
+		ensure("other asset size hit", !LLMeshDecodedCache::read(meshParams(), 3, 501, loaded));
+		ensure("stale file kept", cacheFile().empty());
+		ensure("deleted file hit", !LLMeshDecodedCache::read(meshParams(), 3, 500, loaded));
+	}
+
+	// Damaged files miss and are deleted
+	template<> template<>
+	void meshdecodedcache_object_t::test<3>()
+	{
+		LLPointer<LLVolume> volume = new LLTestDecodedVolume(meshParams(), 20);
+		LLPointer<LLVolume> loaded = new LLVolume(meshParams(), 1.f);
+		LLMeshDecodedCache::write(meshParams(), 1, 77, volume);
+		std::string filename = cacheFile();
+		ensure("no file", !filename.empty());
+
+		llstat stat_data;
+		LLFile::stat(filename, &stat_data);
+		std::vector<U8> file(stat_data.st_size);
+		LLFILE* fp = LLFile::fopen(filename, "rb");
+		ensure("reading file failed", fp && fread(&file[0], 1, file.size(), fp) == file.size());
+		LLFile::close(fp);
+
+		// cut short
+		ensure("writing file failed", LLFile::write_replace(filename, &file[0], file.size() - 16));
+		ensure("truncated hit", !LLMeshDecodedCache::read(meshParams(), 1, 77, loaded));
+		ensure("truncated kept", cacheFile().empty());
+
+		// an index of the last face points past its vertices
+		const LLVolumeFace& face = volume->getVolumeFace(1);
+		const U8* indices = (const U8*)face.mIndices;
+		std::vector<U8>::iterator found = std::search(file.begin(), file.end(), indices, indices + sizeof(U16) * face.mNumIndices);
+		ensure("indices not found", found != file.end());
+		found[0] = 0xff;
+		found[1] = 0xff;
+		ensure("writing file failed", LLFile::write_replace(filename, &file[0], file.size()));
+		ensure("damaged hit", !LLMeshDecodedCache::read(meshParams(), 1, 77, loaded));
+		ensure("damaged kept", cacheFile().empty());
+	}
+
+	// A read only cache reads but doesn't write or delete
+	template<> template<>
+	void meshdecodedcache_object_t::test<4>()
+	{
+		LLPointer<LLVolume> volume = new LLTestDecodedVolume(meshParams(), 20);
+		LLPointer<LLVolume> loaded = new LLVolume(meshParams(), 1.f);
+		LLMeshDecodedCache::write(meshParams(), 0, 10, volume);
+
+		LLMeshDecodedCache::initCache(LL_PATH_TEMP, 512, true);
+		ensure("read only miss", LLMeshDecodedCache::read(meshParams(), 0, 10, loaded));
+		ensure("read only stale hit", !LLMeshDecodedCache::read(meshParams(), 0, 11, loaded));
+		ensure("read only deleted", !cacheFile().empty());
+
+		LLMeshDecodedCache::write(meshParams(), 1, 10, volume);
+		ensure("read only wrote", !LLMeshDecodedCache::read(meshParams(), 1, 10, loaded));
+	}
+
+	// The cache is emptied at startup once it outgrew its budget, and is
+	// off once removed
+	template<> template<>
+	void meshdecodedcache_object_t::test<5>()
+	{
+		LLPointer<LLVolume> volume = new LLTestDecodedVolume(meshParams(), 20);
+		LLPointer<LLVolume> loaded = new LLVolume(meshParams(), 1.f);
+		LLMeshDecodedCache::write(meshParams(), 2, 10, volume);
+
+		LLMeshDecodedCache::initCache(LL_PATH_TEMP, 1, false);
+		ensure("emptied below budget", LLMeshDecodedCache::read(meshParams(), 2, 10, loaded));
+		LLMeshDecodedCache::initCache(LL_PATH_TEMP, 0, false);
+		ensure("not emptied", cacheFile().empty());
+		ensure("hit after emptying", !LLMeshDecodedCache::read(meshParams(), 2, 10, loaded));
+
+		LLMeshDecodedCache::write(meshParams(), 2, 10, volume);
+		LLMeshDecodedCache::removeCache(LL_PATH_TEMP);
+		ensure("enabled after removal", !LLMeshDecodedCache::isEnabled());
+		U32 misses = LLMeshDecodedCache::getMisses();
+		ensure("hit after removal", !LLMeshDecodedCache::read(meshParams(), 2, 10, loaded));
+		ensure_equals("disabled cache counted a miss", LLMeshDecodedCache::getMisses(), misses);
+	}
+}
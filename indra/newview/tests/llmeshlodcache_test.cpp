@@ -0,0 +1,203 @@
+/**
+ * @file llmeshlodcache_test.cpp
+ * @brief Test cases for LLMeshLODCache
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../llmeshlodcache.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+// A mesh volume with one face of the given size, as if a LOD was decoded.
+class LLTestMeshVolume : public LLVolume
+{
+public:
+	LLTestMeshVolume(const LLVolumeParams& params, S32 vertices)
+	:	LLVolume(params, 1.f)
+	{
+		mVolumeFaces.clear();
+		mVolumeFaces.resize(1);
+		mVolumeFaces[0].resizeVertices(vertices);
+		mVolumeFaces[0].resizeIndices(vertices);
+	}
+};
+
+namespace tut
+{
+	struct meshlodcache_test
+	{
+		LLMeshLODCache mCache;
+
+		static LLVolumeParams meshParams(const LLUUID& id, U8 flags = 0)
+		{
+			LLVolumeParams params;
+			params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+			params.setSculptID(id, LL_SCULPT_TYPE_MESH | flags);
+			return params;
+		}
+
+		static LLUUID newID()
+		{
+			LLUUID id;
+			id.generate();
+			return id;
+		}
+	};
+
+	typedef test_group<meshlodcache_test> meshlodcache_t;
+	typedef meshlodcache_t::object meshlodcache_object_t;
+	tut::meshlodcache_t tut_meshlodcache("LLMeshLODCache");
+
+	// Hits, misses and byte accounting
+	template<> template<>
+	void meshlodcache_object_t::test<1>()
+	{
+		mCache.setMaxBytes(1024 * 1024);
+		LLVolumeParams params = meshParams(newID());
+		ensure("empty cache", mCache.get(params, 3) == NULL);
+		ensure_equals("miss counted", mCache.getMisses(), 1U);
+
+		LLPointer<LLVolume> volume = new LLTestMeshVolume(params, 100);
+		U64 bytes = LLMeshLODCache::getVolumeBytes(volume);
+		ensure("faces counted", bytes > sizeof(LLVolume) + 100 * sizeof(LLVector4a));
+		mCache.put(params, 3, volume);
+		ensure_equals("count", mCache.getCount(), 1U);
+		ensure_equals("bytes", mCache.getBytes(), bytes);
+
+		ensure("hit", mCache.get(params, 3) == volume.get());
+		ensure_equals("hit counted", mCache.getHits(), 1U);
+		ensure("other lod", mCache.get(params, 2) == NULL);
+		ensure_equals("other lod missed", mCache.getMisses(), 2U);
+
+		// Replacing a LOD only counts the new volume.
+		LLPointer<LLVolume> bigger = new LLTestMeshVolume(params, 400);
+		mCache.put(params, 3, bigger);
+		ensure_equals("replaced count", mCache.getCount(), 1U);
+		ensure_equals("replaced bytes", mCache.getBytes(), LLMeshLODCache::getVolumeBytes(bigger));
+		ensure("replaced", mCache.get(params, 3) == bigger.get());
+
+		LLPointer<LLVolume> other = new LLTestMeshVolume(meshParams(newID()), 50);
+		mCache.put(meshParams(other->getParams().getSculptID()), 0, other);
+		ensure_equals("two meshes", mCache.getBytes(),
+					  LLMeshLODCache::getVolumeBytes(bigger) + LLMeshLODCache::getVolumeBytes(other));
+
+		mCache.clear();
+		ensure_equals("cleared count", mCache.getCount(), 0U);
+		ensure_equals("cleared bytes", mCache.getBytes(), (U64)0);
+		ensure("cleared", mCache.get(params, 3) == NULL);
+	}
+
+	// The mirror and invert flags have slots of their own
+	template<> template<>
+	void meshlodcache_object_t::test<2>()
+	{
+		mCache.setMaxBytes(1024 * 1024);
+		LLUUID id = newID();
+		const U8 flags[4] = { 0, LL_SCULPT_FLAG_MIRROR, LL_SCULPT_FLAG_INVERT, LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT };
+
+		LLPointer<LLVolume> plain = new LLTestMeshVolume(meshParams(id), 10);
+		mCache.put(meshParams(id), 1, plain);
+		ensure("mirrored isn't plain", mCache.get(meshParams(id, LL_SCULPT_FLAG_MIRROR), 1) == NULL);
+		ensure("inverted isn't plain", mCache.get(meshParams(id, LL_SCULPT_FLAG_INVERT), 1) == NULL);
+
+		LLPointer<LLVolume> volumes[4];
+		U64 bytes = 0;
+		for (S32 i = 0; i < 4; ++i)
+		{
+			volumes[i] = new LLTestMeshVolume(meshParams(id, flags[i]), 10 + i);
+			mCache.put(meshParams(id, flags[i]), 1, volumes[i]);
+			bytes += LLMeshLODCache::getVolumeBytes(volumes[i]);
+		}
+		ensure_equals("one entry per variant", mCache.getCount(), 4U);
+		ensure_equals("variant bytes", mCache.getBytes(), bytes);
+		for (S32 i = 0; i < 4; ++i)
+		{
+			ensure("own variant", mCache.get(meshParams(id, flags[i]), 1) == volumes[i].get());
+			ensure("variant lods apart", mCache.get(meshParams(id, flags[i]), 0) == NULL);
+		}
+
+		// The last LOD of the last variant is a valid slot too.
+		ensure("highest lod slot", mCache.get(meshParams(id, flags[3]), LLVolumeLODGroup::NUM_LODS - 1) == NULL);
+
+		// Invalid LODs are neither cached nor counted.
+		U32 misses = mCache.getMisses();
+		mCache.put(meshParams(id), -1, plain);
+		mCache.put(meshParams(id), LLVolumeLODGroup::NUM_LODS, plain);
+		ensure("negative lod", mCache.get(meshParams(id), -1) == NULL);
+		ensure("lod past the end", mCache.get(meshParams(id), LLVolumeLODGroup::NUM_LODS) == NULL);
+		ensure_equals("invalid lods not cached", mCache.getCount(), 4U);
+		ensure_equals("invalid lods not counted", mCache.getMisses(), misses);
+	}
+
+	// Least recently used LODs go first
+	template<> template<>
+	void meshlodcache_object_t::test<3>()
+	{
+		LLVolumeParams params[4];
+		LLPointer<LLVolume> volumes[4];
+		for (S32 i = 0; i < 4; ++i)
+		{
+			params[i] = meshParams(newID());
+			volumes[i] = new LLTestMeshVolume(params[i], 100);
+		}
+		U64 size = LLMeshLODCache::getVolumeBytes(volumes[0]);
+		mCache.setMaxBytes(size * 3);
+
+		mCache.put(params[0], 2, volumes[0]);
+		mCache.put(params[1], 2, volumes[1]);
+		mCache.put(params[2], 2, volumes[2]);
+		ensure_equals("fits", mCache.getEvictions(), 0U);
+
+		// Using the oldest makes the second one the least recently used.
+		ensure("touch oldest", mCache.get(params[0], 2) == volumes[0].get());
+		mCache.put(params[3], 2, volumes[3]);
+		ensure_equals("one evicted", mCache.getEvictions(), 1U);
+		ensure_equals("count after eviction", mCache.getCount(), 3U);
+		ensure_equals("bytes after eviction", mCache.getBytes(), size * 3);
+		ensure("least recently used evicted", mCache.get(params[1], 2) == NULL);
+		ensure("touched kept", mCache.get(params[0], 2) == volumes[0].get());
+		ensure("newest kept", mCache.get(params[3], 2) == volumes[3].get());
+
+		// Shrinking the budget keeps the most recently used.
+		mCache.setMaxBytes(size);
+		ensure_equals("shrunk count", mCache.getCount(), 1U);
+		ensure_equals("shrunk bytes", mCache.getBytes(), size);
+		ensure("most recent kept", mCache.get(params[3], 2) == volumes[3].get());
+		ensure_equals("evictions", mCache.getEvictions(), 3U);
+
+		// What doesn't fit in the whole budget isn't cached at all.
+		LLPointer<LLVolume> huge = new LLTestMeshVolume(params[1], 1000);
+		mCache.put(params[1], 2, huge);
+		ensure("too big", mCache.get(params[1], 2) == NULL);
+		ensure("too big evicts nothing", mCache.get(params[3], 2) == volumes[3].get());
+
+		// The cache holds its own reference.
+		LLVolume* cached = volumes[3];
+		volumes[3] = NULL;
+		ensure("reference held", mCache.get(params[3], 2) == cached);
+	}
+}
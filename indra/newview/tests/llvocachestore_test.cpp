@@ -0,0 +1,286 @@
+/**
+ * @file llvocachestore_test.cpp
+ * @brief Test cases for LLVOCacheStore and LLVOCacheIOQueue
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../llvocachestore.h"
+
+#include "llfile.h"
+#include "llthreadpool.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+// Appends its number to a list, the queue runs one request at a time.
+class LLTestCacheRequest : public LLVOCacheIOQueue::Request
+{
+public:
+	LLTestCacheRequest(std::vector<S32>& order, S32 number)
+		: mOrder(order), mNumber(number) { }
+	/*virtual*/ void run()
+	{
+		mOrder.push_back(mNumber);
+	}
+
+private:
+	std::vector<S32>& mOrder;
+	S32 mNumber;
+};
+
+namespace tut
+{
+	struct vocachestore_test
+	{
+		vocachestore_test()
+		{
+			mFilename = std::string(LLFile::tmpdir()) + "llvocachestore_test.slc";
+			mRegionID.generate();
+			LLFile::remove_nowarn(mFilename);
+		}
+		~vocachestore_test()
+		{
+			LLFile::remove_nowarn(mFilename);
+		}
+
+		// Adds an entry for local_id holding size bytes of local_id & 0xff.
+		void addEntry(U32 local_id, U32 size)
+		{
+			LLVOCacheStore::IndexEntry entry;
+			entry.mLocalID = local_id;
+			entry.mCRC = local_id * 3;
+			entry.mHitCount = 1;
+			entry.mDupeCount = 0;
+			entry.mCRCChangeCount = 0;
+			entry.mOffset = 0;
+			entry.mSize = size;
+			mEntries.push_back(entry);
+			mBuffers.push_back(std::vector<U8>(size + 1, (U8)local_id));
+		}
+
+		bool write(LLPointer<LLVOCacheStore>& store, U32 max_entries = 50000)
+		{
+			std::vector<const U8*> data;
+			for (size_t i = 0; i < mBuffers.size(); ++i)
+			{
+				data.push_back(&mBuffers[i][0]);
+			}
+			bool result = LLVOCacheStore::write(mFilename, mRegionID, store, mEntries, data, max_entries);
+			mEntries.clear();
+			mBuffers.clear();
+			return result;
+		}
+
+		LLPointer<LLVOCacheStore> open()
+		{
+			LLPointer<LLVOCacheStore> store = new LLVOCacheStore;
+			if (!store->open(mFilename, mRegionID))
+			{
+				store = NULL;
+			}
+			return store;
+		}
+
+		// Checks that store holds local_id with size bytes of its data.
+		void checkEntry(const char* msg, const LLVOCacheStore* store, U32 local_id, U32 size)
+		{
+			const LLVOCacheStore::IndexEntry* entry = store->find(local_id);
+			ensure(msg, entry != NULL);
+			ensure_equals(msg, entry->mLocalID, local_id);
+			ensure_equals(msg, entry->mCRC, local_id * 3);
+			ensure_equals(msg, entry->mSize, size);
+			const U8* data = store->getData(*entry);
+			for (U32 i = 0; i < size; ++i)
+			{
+				if (data[i] != (U8)local_id)
+				{
+					fail(msg);
+				}
+			}
+		}
+
+		std::string mFilename;
+		LLUUID mRegionID;
+		std::vector<LLVOCacheStore::IndexEntry> mEntries;
+		std::vector<std::vector<U8> > mBuffers;
+	};
+
+	typedef test_group<vocachestore_test> vocachestore_t;
+	typedef vocachestore_t::object vocachestore_object_t;
+	tut::vocachestore_t tut_vocachestore("LLVOCacheStore");
+
+	template<> template<>
+	void vocachestore_object_t::test<1>()
+	{
+		// written entries are found again after opening
+		LLPointer<LLVOCacheStore> store;
+		addEntry(3, 10);
+		addEntry(7, 1);
+		addEntry(20, 300);
+		ensure("write failed", write(store));
+
+		store = open();
+		ensure("open failed", store.notNull());
+		ensure_equals("entry count", store->getNumEntries(), 3);
+		checkEntry("entry 3", store, 3, 10);
+		checkEntry("entry 7", store, 7, 1);
+		checkEntry("entry 20", store, 20, 300);
+		ensure("found 0", store->find(0) == NULL);
+		ensure("found 5", store->find(5) == NULL);
+		ensure("found 21", store->find(21) == NULL);
+	}
+
+	template<> template<>
+	void vocachestore_object_t::test<2>()
+	{
+		// new entries replace those of the store, empty ones remove them
+		LLPointer<LLVOCacheStore> store;
+		addEntry(1, 4);
+		addEntry(2, 4);
+		addEntry(3, 4);
+		addEntry(4, 4);
+		ensure("first write failed", write(store));
+
+		store = open();
+		ensure("first open failed", store.notNull());
+		addEntry(0, 8);
+		addEntry(2, 16);
+		addEntry(3, 0);
+		addEntry(5, 8);
+		ensure("second write failed", write(store));
+		ensure("store still held", store.isNull());
+
+		store = open();
+		ensure("second open failed", store.notNull());
+		ensure_equals("entry count", store->getNumEntries(), 5);
+		checkEntry("new entry 0", store, 0, 8);
+		checkEntry("kept entry 1", store, 1, 4);
+		checkEntry("replaced entry 2", store, 2, 16);
+		ensure("removed entry 3", store->find(3) == NULL);
+		checkEntry("kept entry 4", store, 4, 4);
+		checkEntry("new entry 5", store, 5, 8);
+	}
+
+	template<> template<>
+	void vocachestore_object_t::test<3>()
+	{
+		// no more than max_entries are written, lowest local IDs first
+		LLPointer<LLVOCacheStore> store;
+		for (U32 i = 0; i < 10; ++i)
+		{
+			addEntry(i, 2);
+		}
+		ensure("write failed", write(store, 4));
+
+		store = open();
+		ensure("open failed", store.notNull());
+		ensure_equals("entry count", store->getNumEntries(), 4);
+		checkEntry("entry 3", store, 3, 2);
+		ensure("found entry 4", store->find(4) == NULL);
+	}
+
+	template<> template<>
+	void vocachestore_object_t::test<4>()
+	{
+		// missing files, files of other regions and corrupt ones don't open
+		ensure("opened missing file", open().isNull());
+
+		LLPointer<LLVOCacheStore> store;
+		addEntry(1, 4);
+		ensure("write failed", write(store));
+		LLUUID region_id = mRegionID;
+		mRegionID.generate();
+		ensure("opened file of another region", open().isNull());
+		mRegionID = region_id;
+		ensure("valid file didn't open", open().notNull());
+
+		U8 garbage[64];
+		memset(garbage, 0x5a, sizeof(garbage));
+		ensure("writing garbage failed", LLFile::write_replace(mFilename, garbage, sizeof(garbage)));
+		ensure("opened garbage", open().isNull());
+
+		// An index pointing past the end of the file.
+		addEntry(1, 4);
+		ensure("rewrite failed", write(store));
+		llstat stat_data;
+		LLFile::stat(mFilename, &stat_data);
+		std::vector<U8> file(stat_data.st_size);
+		LLFILE* fp = LLFile::fopen(mFilename, "rb");
+		ensure("reading file failed", fp && fread(&file[0], 1, file.size(), fp) == file.size());
+		LLFile::close(fp);
+		file.resize(file.size() - 2);
+		ensure("writing truncated file failed", LLFile::write_replace(mFilename, &file[0], file.size()));
+		ensure("opened truncated file", open().isNull());
+	}
+
+	template<> template<>
+	void vocachestore_object_t::test<5>()
+	{
+		// without a pool requests run right away, in order
+		std::vector<S32> order;
+		LLVOCacheIOQueue queue;
+		for (S32 i = 0; i < 3; ++i)
+		{
+			queue.queueRequest(new LLTestCacheRequest(order, i));
+			ensure_equals("request didn't run", order.size(), (size_t)(i + 1));
+		}
+		queue.flushRequests();
+		for (S32 i = 0; i < 3; ++i)
+		{
+			ensure_equals("order", order[i], i);
+		}
+	}
+
+	template<> template<>
+	void vocachestore_object_t::test<6>()
+	{
+		// on the pool requests run in order and flushRequests() waits for them
+		LLThreadPool::initClass(3);
+		std::vector<S32> order;
+		{
+			LLVOCacheIOQueue queue;
+			for (S32 i = 0; i < 100; ++i)
+			{
+				queue.queueRequest(new LLTestCacheRequest(order, i));
+			}
+			queue.flushRequests();
+			ensure_equals("flushed requests", order.size(), (size_t)100);
+			for (S32 i = 0; i < 100; ++i)
+			{
+				ensure_equals("order", order[i], i);
+			}
+
+			// The destructor runs what is still queued.
+			for (S32 i = 100; i < 110; ++i)
+			{
+				queue.queueRequest(new LLTestCacheRequest(order, i));
+			}
+		}
+		LLThreadPool::cleanupClass();
+		ensure_equals("requests left", order.size(), (size_t)110);
+		ensure_equals("last request", order.back(), 109);
+	}
+}
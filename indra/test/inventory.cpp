@@ -34,7 +34,9 @@
 
 #include "linden_common.h"
 #include "lltut.h"
+#include "llfile.h"
 #include "llinventory.h"
+#include "llinventorycache.h"
 #include "llsd.h"
 
 #if LL_WINDOWS
@@ -536,4 +538,70 @@ namespace tut
 		ensure_equals("5.name::getName() failed", src1->getName(), src2->getName());
 			
 	}
+
+	template<> template<>
+	void inventory_object::test<15>()
+	{
+		class ItemFactory : public LLInventoryCacheReader::ItemFactory
+		{
+		public:
+			/*virtual*/ LLInventoryItem* createItem() const { return new LLInventoryItem; }
+		};
+
+		LLPointer<LLInventoryCategory> cat = create_random_inventory_cat();
+		LLPointer<LLInventoryItem> src1 = create_random_inventory_item();
+		LLPointer<LLInventoryItem> src2 = create_random_inventory_item();
+		LLPointer<LLInventoryItem> src3 = new LLInventoryItem(src1);
+		src3->generateUUID();
+		src3->rename("Another Object");
+
+		std::string filename = std::string(LLFile::tmpdir()) + "inventory_test.invb";
+		LLInventoryCacheWriter writer;
+		writer.addCategory(cat->getUUID(), cat->getParentUUID(), LLUUID::null, 7,
+						   cat->getPreferredType(), cat->getName());
+		writer.addItem(*src1);
+		writer.addItem(*src2);
+		writer.addItem(*src3);
+		ensure("1.write() failed", writer.write(filename));
+
+		LLInventoryCacheReader reader;
+		ensure("2.open() failed", reader.open(filename));
+		ensure_equals("3.getNumCategories() failed", reader.getNumCategories(), 1);
+		ensure_equals("4.getNumItems() failed", reader.getNumItems(), 3);
+		ensure_equals("5.getNumGroups() failed", reader.getNumGroups(), 2);
+		ensure_equals("6.category id failed", reader.getCategory(0).mID, cat->getUUID());
+		ensure_equals("7.category version failed", reader.getCategory(0).mVersion, 7);
+		ensure_equals("8.category name failed", reader.getString(reader.getCategory(0).mName), cat->getName());
+
+		LLInventoryCacheReader::item_vec_t items;
+		reader.decodeItems(ItemFactory(), items, NULL);
+		ensure_equals("9.decodeItems() failed", (S32)items.size(), 3);
+		for (S32 i = 0; i < reader.getNumGroups(); ++i)
+		{
+			const LLInventoryCache::GroupRecord& group = reader.getGroup(i);
+			bool first_parent = group.mParentID == src1->getParentUUID();
+			ensure_equals("10.group size failed", group.mNumItems, first_parent ? 2U : 1U);
+			// Items of a folder keep the order they were added in.
+			LLInventoryItem* expected = first_parent ? src1.get() : src2.get();
+			LLInventoryItem* item = items[group.mFirstItem];
+			ensure_equals("11.item id failed", item->getUUID(), expected->getUUID());
+			ensure_equals("12.parent id failed", item->getParentUUID(), expected->getParentUUID());
+			ensure_equals("13.asset id failed", item->getAssetUUID(), expected->getAssetUUID());
+			ensure_equals("14.name failed", item->getName(), expected->getName());
+			ensure_equals("15.description failed", item->getDescription(), expected->getDescription());
+			ensure_equals("16.type failed", item->getType(), expected->getType());
+			ensure_equals("17.inventory type failed", item->getInventoryType(), expected->getInventoryType());
+			ensure_equals("18.flags failed", item->getFlags(), expected->getFlags());
+			ensure_equals("19.creation date failed", item->getCreationDate(), expected->getCreationDate());
+			ensure("20.permissions failed", item->getPermissions() == expected->getPermissions());
+			ensure("21.sale info failed", item->getSaleInfo() == expected->getSaleInfo());
+			if (first_parent)
+			{
+				ensure_equals("22.second item failed", items[group.mFirstItem + 1]->getUUID(), src3->getUUID());
+			}
+		}
+
+		reader.close();
+		LLFile::remove(filename);
+	}
 }
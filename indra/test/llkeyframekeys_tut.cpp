@@ -0,0 +1,170 @@
+/**
+ * @file llkeyframekeys_tut.cpp
+ * @brief Tests for the keyframe curve key search.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "llkeyframekeys.h"
+#include "lltut.h"
+
+namespace tut
+{
+	struct keyframe_keys_test
+	{
+		struct Key
+		{
+			Key(F32 time = 0.f, S32 value = 0) : mTime(time), mValue(value) {}
+			F32 mTime;
+			S32 mValue;
+		};
+		typedef std::vector<Key> key_list_t;
+
+		// Keys at 0, 1, ..., count - 1.
+		key_list_t makeKeys(S32 count)
+		{
+			key_list_t keys;
+			for (S32 i = 0; i < count; ++i)
+			{
+				ll_insert_key(keys, Key((F32)i, i));
+			}
+			return keys;
+		}
+
+		// What a fresh cursor finds, i.e. a plain binary search.
+		U32 lookup(const key_list_t& keys, F32 time)
+		{
+			U32 cursor = 0;
+			return ll_find_key(keys, time, cursor);
+		}
+	};
+	typedef test_group<keyframe_keys_test> keyframe_keys_test_t;
+	typedef keyframe_keys_test_t::object keyframe_keys_test_object_t;
+	tut::keyframe_keys_test_t tut_keyframe_keys_test("llkeyframekeys");
+
+	// forward playback with a persistent cursor, including skipping segments
+	template<> template<>
+	void keyframe_keys_test_object_t::test<1>()
+	{
+		key_list_t keys = makeKeys(10);
+		U32 cursor = 0;
+		ensure_equals("before first", ll_find_key(keys, -1.f, cursor), 0U);
+		ensure_equals("on first", ll_find_key(keys, 0.f, cursor), 0U);
+		for (F32 time = 0.05f; time < 9.f; time += 0.1f)
+		{
+			U32 right = ll_find_key(keys, time, cursor);
+			ensure_equals("forward step", right, lookup(keys, time));
+			ensure_equals("cursor follows", cursor, right);
+			ensure("right key brackets time", keys[right].mTime >= time && keys[right - 1].mTime < time);
+		}
+		ensure_equals("on a key", ll_find_key(keys, 9.f, cursor), 9U);
+		ensure_equals("past the end", ll_find_key(keys, 12.f, cursor), 10U);
+
+		cursor = 1;
+		ensure_equals("jump ahead", ll_find_key(keys, 7.5f, cursor), 8U);
+		ensure_equals("cursor after jump", cursor, 8U);
+	}
+
+	// seeking backward from anywhere, including from past the end
+	template<> template<>
+	void keyframe_keys_test_object_t::test<2>()
+	{
+		key_list_t keys = makeKeys(10);
+		U32 cursor = 0;
+		ll_find_key(keys, 8.5f, cursor);
+		ensure_equals("back one segment", ll_find_key(keys, 7.5f, cursor), 8U);
+		ensure_equals("back several", ll_find_key(keys, 2.25f, cursor), 3U);
+		ensure_equals("back onto a key", ll_find_key(keys, 2.f, cursor), 2U);
+		ensure_equals("back to start", ll_find_key(keys, 0.f, cursor), 0U);
+
+		ll_find_key(keys, 20.f, cursor);
+		ensure_equals("cursor past the end", cursor, 10U);
+		ensure_equals("back from the end", ll_find_key(keys, 4.5f, cursor), 5U);
+
+		// A cursor left over from a longer curve.
+		cursor = 50;
+		ensure_equals("stale cursor", ll_find_key(keys, 3.5f, cursor), 4U);
+	}
+
+	// looping: time wraps from the end back to near the start
+	template<> template<>
+	void keyframe_keys_test_object_t::test<3>()
+	{
+		key_list_t keys = makeKeys(5);
+		U32 cursor = 0;
+		const F32 duration = 4.f;
+		F32 time = 0.f;
+		for (S32 frame = 0; frame < 100; ++frame)
+		{
+			time += 0.3f;
+			if (time > duration)
+			{
+				time -= duration;
+			}
+			U32 right = ll_find_key(keys, time, cursor);
+			ensure_equals("looped lookup", right, lookup(keys, time));
+		}
+
+		ll_find_key(keys, 3.9f, cursor);
+		ensure_equals("before wrap", cursor, 4U);
+		ensure_equals("wrapped", ll_find_key(keys, 0.1f, cursor), 1U);
+		ensure_equals("continue after wrap", ll_find_key(keys, 0.4f, cursor), 1U);
+		ensure_equals("next segment", ll_find_key(keys, 1.2f, cursor), 2U);
+	}
+
+	// single key and empty curves
+	template<> template<>
+	void keyframe_keys_test_object_t::test<4>()
+	{
+		key_list_t keys = makeKeys(1);
+		U32 cursor = 0;
+		ensure_equals("before only key", ll_find_key(keys, -0.5f, cursor), 0U);
+		ensure_equals("on only key", ll_find_key(keys, 0.f, cursor), 0U);
+		ensure_equals("after only key", ll_find_key(keys, 0.5f, cursor), 1U);
+		ensure_equals("back to only key", ll_find_key(keys, 0.f, cursor), 0U);
+		ensure_equals("after again", ll_find_key(keys, 3.f, cursor), 1U);
+
+		key_list_t empty;
+		cursor = 3;
+		ensure_equals("empty", ll_find_key(empty, 1.f, cursor), 0U);
+		ensure_equals("empty cursor", cursor, 0U);
+	}
+
+	// insertion keeps the list sorted and replaces keys at the same time
+	template<> template<>
+	void keyframe_keys_test_object_t::test<5>()
+	{
+		key_list_t keys;
+		ll_insert_key(keys, Key(2.f, 2));
+		ll_insert_key(keys, Key(0.f, 0));
+		ll_insert_key(keys, Key(3.f, 3));
+		ll_insert_key(keys, Key(1.f, 1));
+		ll_insert_key(keys, Key(2.f, 20));
+		ensure_equals("size", keys.size(), (size_t)4);
+		for (U32 i = 0; i < keys.size(); ++i)
+		{
+			ensure_equals("sorted", keys[i].mTime, (F32)i);
+		}
+		ensure_equals("replaced", keys[2].mValue, 20);
+	}
+}
@@ -0,0 +1,196 @@
+/**
+ * @file lloctreeflatbounds_tut.cpp
+ * @brief Tests for the flat octree node bounds and the batched frustum test.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "llcamera.h"
+#include "lloctreeflatbounds.h"
+#include "lltut.h"
+
+namespace tut
+{
+	struct octree_flat_bounds_test
+	{
+		octree_flat_bounds_test()
+		{
+			// Looking down -z from the origin, near plane at 1, far plane at
+			// 10, corners ordered the way LLViewerCamera unprojects them.
+			LLVector3 frust[LLCamera::AGENT_FRUSTRUM_NUM] =
+			{
+				LLVector3(-1.f, -1.f, -1.f), LLVector3(1.f, -1.f, -1.f),
+				LLVector3(1.f, 1.f, -1.f), LLVector3(-1.f, 1.f, -1.f),
+				LLVector3(-10.f, -10.f, -10.f), LLVector3(10.f, -10.f, -10.f),
+				LLVector3(10.f, 10.f, -10.f), LLVector3(-10.f, 10.f, -10.f)
+			};
+			mCamera.calcAgentFrustumPlanes(frust);
+		}
+
+		// Compares the batched test of a grid of boxes, eight at a time,
+		// with LLCamera::AABBInFrustum(). Returns how many boxes had each
+		// result.
+		void compareWithCamera(bool far_clip, S32* counts)
+		{
+			LLFrustumPlanes4 planes(mCamera, far_clip);
+			S32 block = mBounds.allocateBlock();
+			LLVector4a centers[LLOctreeFlatBounds::BLOCK_SLOTS];
+			LLVector4a radii[LLOctreeFlatBounds::BLOCK_SLOTS];
+			counts[0] = counts[1] = counts[2] = 0;
+			U32 slot = 0;
+			for (S32 x = -12; x <= 12; x += 3)
+			for (S32 y = -12; y <= 12; y += 3)
+			for (S32 z = -14; z <= 4; z += 2)
+			{
+				centers[slot].set((F32)x, (F32)y, (F32)z);
+				F32 r = 0.25f + 0.5f * (F32)((x + y + z + 100) % 5);
+				radii[slot].set(r, r * 0.5f, r * 2.f);
+				mBounds.setBounds(block, slot, this, centers[slot], radii[slot]);
+				if (++slot < LLOctreeFlatBounds::BLOCK_SLOTS)
+				{
+					continue;
+				}
+
+				S32 results[LLOctreeFlatBounds::BLOCK_SLOTS];
+				mBounds.frustumCheck(block, planes, results);
+				for (slot = 0; slot < LLOctreeFlatBounds::BLOCK_SLOTS; ++slot)
+				{
+					S32 expected = far_clip ? mCamera.AABBInFrustum(centers[slot], radii[slot])
+											: mCamera.AABBInFrustumNoFarClip(centers[slot], radii[slot]);
+					ensure_equals("batched result differs", results[slot], expected);
+					counts[expected]++;
+				}
+				slot = 0;
+			}
+			mBounds.freeBlock(block);
+		}
+
+		LLCamera mCamera;
+		LLOctreeFlatBounds mBounds;
+	};
+
+	typedef test_group<octree_flat_bounds_test> octree_flat_bounds_t;
+	typedef octree_flat_bounds_t::object octree_flat_bounds_object_t;
+	tut::octree_flat_bounds_t tut_octree_flat_bounds("LLOctreeFlatBounds");
+
+	template<> template<>
+	void octree_flat_bounds_object_t::test<1>()
+	{
+		// the camera setup sees what it should
+		LLVector4a radius(0.5f, 0.5f, 0.5f);
+		LLVector4a center(0.f, 0.f, -5.f);
+		ensure_equals("inside", mCamera.AABBInFrustum(center, radius), 2);
+		center.set(0.f, 0.f, -1.f);
+		ensure_equals("across near plane", mCamera.AABBInFrustum(center, radius), 1);
+		center.set(0.f, 0.f, 5.f);
+		ensure_equals("behind", mCamera.AABBInFrustum(center, radius), 0);
+		center.set(0.f, 0.f, -12.f);
+		ensure_equals("past far plane", mCamera.AABBInFrustum(center, radius), 0);
+		ensure_equals("past far plane, no far clip", mCamera.AABBInFrustumNoFarClip(center, radius), 2);
+	}
+
+	template<> template<>
+	void octree_flat_bounds_object_t::test<2>()
+	{
+		// batched results match the scalar test, with and without far clip
+		S32 counts[3];
+		compareWithCamera(true, counts);
+		ensure("no box outside", counts[0] > 0);
+		ensure("no box partly in", counts[1] > 0);
+		ensure("no box inside", counts[2] > 0);
+
+		S32 no_far_counts[3];
+		compareWithCamera(false, no_far_counts);
+		ensure("far clip ignored", no_far_counts[0] < counts[0]);
+	}
+
+	template<> template<>
+	void octree_flat_bounds_object_t::test<3>()
+	{
+		// a user clip plane is tested like the others
+		mCamera.setUserClipPlane(LLPlane(LLVector3(0.f, 0.f, 0.f), LLVector3(1.f, 0.f, 0.f)));
+		S32 counts[3];
+		compareWithCamera(true, counts);
+		mCamera.disableUserClipPlane();
+		S32 no_user_counts[3];
+		compareWithCamera(true, no_user_counts);
+		ensure("user clip plane ignored", counts[0] > no_user_counts[0]);
+	}
+
+	template<> template<>
+	void octree_flat_bounds_object_t::test<4>()
+	{
+		// slots start unused and keep track of their owner
+		int a, b;
+		LLVector4a center(1.f, 2.f, 3.f);
+		LLVector4a radius(1.f, 1.f, 1.f);
+		S32 block = mBounds.allocateBlock();
+		for (U32 slot = 0; slot < LLOctreeFlatBounds::BLOCK_SLOTS; ++slot)
+		{
+			ensure("new slot used", mBounds.getOwner(block, slot) == NULL);
+		}
+
+		mBounds.setBounds(block, 3, &a, center, radius);
+		ensure("owner not set", mBounds.getOwner(block, 3) == &a);
+		mBounds.releaseSlot(block, 3, &b);
+		ensure("released by another owner", mBounds.getOwner(block, 3) == &a);
+		mBounds.setBounds(block, 3, &b, center, radius);
+		mBounds.releaseSlot(block, 3, &a);
+		ensure("released by former owner", mBounds.getOwner(block, 3) == &b);
+		mBounds.releaseSlot(block, 3, &b);
+		ensure("slot not released", mBounds.getOwner(block, 3) == NULL);
+		mBounds.freeBlock(block);
+	}
+
+	template<> template<>
+	void octree_flat_bounds_object_t::test<5>()
+	{
+		// freed blocks are reused and cleared, the storage grows past its
+		// first allocation without losing bounds
+		int owner;
+		LLVector4a center(0.f, 0.f, -5.f);
+		LLVector4a radius(0.5f, 0.5f, 0.5f);
+		std::vector<S32> blocks;
+		for (S32 i = 0; i < 200; ++i)
+		{
+			S32 block = mBounds.allocateBlock();
+			ensure_equals("block handed out twice", block, i);
+			mBounds.setBounds(block, i % LLOctreeFlatBounds::BLOCK_SLOTS, &owner, center, radius);
+			blocks.push_back(block);
+		}
+		ensure_equals("block count", mBounds.getBlockCount(), (U32)200);
+
+		LLFrustumPlanes4 planes(mCamera, true);
+		S32 results[LLOctreeFlatBounds::BLOCK_SLOTS];
+		mBounds.frustumCheck(7, planes, results);
+		ensure_equals("bounds lost when growing", results[7], 2);
+
+		mBounds.freeBlock(blocks[5]);
+		mBounds.freeBlock(blocks[9]);
+		ensure_equals("block count after free", mBounds.getBlockCount(), (U32)198);
+		S32 block = mBounds.allocateBlock();
+		ensure("freed block not reused", block == 5 || block == 9);
+		ensure("reused block not cleared", mBounds.getOwner(block, block % LLOctreeFlatBounds::BLOCK_SLOTS) == NULL);
+		ensure_equals("block count after reuse", mBounds.getBlockCount(), (U32)199);
+	}
+}
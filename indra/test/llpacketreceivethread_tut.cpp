@@ -0,0 +1,256 @@
+/**
+ * @file llpacketreceivethread_tut.cpp
+ * @brief Tests for preparing received packets and the receive ring.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+
+#if LL_WINDOWS
+	#include <winsock2.h>
+#else
+	#include <netinet/in.h>
+#endif
+
+#include "llpacketreceivethread.h"
+#include "lltimer.h"
+#include "message.h"
+#include "net.h"
+#include "lltut.h"
+
+namespace tut
+{
+	struct packet_receive_test
+	{
+		packet_receive_test()
+		{
+			mPacket = new LLReceivedPacket;
+		}
+		~packet_receive_test()
+		{
+			delete mPacket;
+		}
+
+		// A packet header with flags and sequence number, followed by body.
+		static std::vector<U8> makePacket(U8 flags, U32 sequence, const U8* body, S32 body_size)
+		{
+			std::vector<U8> raw(LL_PACKET_ID_SIZE, 0);
+			raw[0] = flags;
+			raw[1] = (U8)(sequence >> 24);
+			raw[2] = (U8)(sequence >> 16);
+			raw[3] = (U8)(sequence >> 8);
+			raw[4] = (U8)sequence;
+			raw.insert(raw.end(), body, body + body_size);
+			return raw;
+		}
+
+		// Appends acks the way LLCircuitData does: network order, then the
+		// count in the last byte.
+		static void appendAcks(std::vector<U8>& raw, const TPACKETID* acks, S32 count)
+		{
+			for (S32 i = 0; i < count; ++i)
+			{
+				TPACKETID packet_id = htonl(acks[i]);
+				const U8* bytes = (const U8*)&packet_id;
+				raw.insert(raw.end(), bytes, bytes + sizeof(TPACKETID));
+			}
+			raw.push_back((U8)count);
+		}
+
+		void ensureData(const char* msg, const U8* expected, S32 size)
+		{
+			ensure_equals(msg, mPacket->mSize, size);
+			ensure(msg, !memcmp(mPacket->mData, expected, size));
+		}
+
+		LLReceivedPacket* mPacket;		// too big for the stack of some test threads
+	};
+
+	typedef test_group<packet_receive_test> packet_receive_t;
+	typedef packet_receive_t::object packet_receive_object_t;
+	tut::packet_receive_t tut_packet_receive("LLPacketReceiveThread");
+
+	template<> template<>
+	void packet_receive_object_t::test<1>()
+	{
+		// packets too short to be valid and plain ones are copied as they are
+		const U8 body[] = { 0xff, 0x01, 0x02, 0x03 };
+		std::vector<U8> raw = makePacket(0, 7, body, sizeof(body));
+		mPacket->prepare(&raw[0], 3);
+		ensure_equals("short true size", mPacket->mTrueSize, 3);
+		ensureData("short data", &raw[0], 3);
+		ensure_equals("short acks", mPacket->mAckCount, 0);
+
+		mPacket->prepare(&raw[0], (S32)raw.size());
+		ensure_equals("plain true size", mPacket->mTrueSize, (S32)raw.size());
+		ensureData("plain data", &raw[0], (S32)raw.size());
+		ensure_equals("plain compressed size", mPacket->mCompressedSize, 0);
+		ensure("plain malformed", !mPacket->mMalformed);
+		ensure("plain overflow", !mPacket->mExpandOverflow);
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<2>()
+	{
+		// appended acks are taken off and decoded last to first
+		const U8 body[] = { 0xff, 0x01, 0x02, 0x03 };
+		const TPACKETID acks[] = { 0x01020304, 17, 0xfffffffe };
+		std::vector<U8> plain = makePacket(LL_ACK_FLAG, 9, body, sizeof(body));
+		std::vector<U8> raw = plain;
+		appendAcks(raw, acks, 3);
+
+		mPacket->prepare(&raw[0], (S32)raw.size());
+		ensure_equals("true size", mPacket->mTrueSize, (S32)raw.size());
+		ensure("malformed", !mPacket->mMalformed);
+		ensure_equals("ack count", mPacket->mAckCount, 3);
+		ensure_equals("first ack", mPacket->mAcks[0], acks[2]);
+		ensure_equals("second ack", mPacket->mAcks[1], acks[1]);
+		ensure_equals("third ack", mPacket->mAcks[2], acks[0]);
+		ensureData("data", &plain[0], (S32)plain.size());
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<3>()
+	{
+		// a packet claiming more acks than it has room for is malformed
+		const U8 body[] = { 0xff, 0x01 };
+		const TPACKETID acks[] = { 1, 2 };
+		std::vector<U8> raw = makePacket(LL_ACK_FLAG, 3, body, sizeof(body));
+		appendAcks(raw, acks, 2);
+		raw.back() = 5;
+
+		mPacket->prepare(&raw[0], (S32)raw.size());
+		ensure("not malformed", mPacket->mMalformed);
+		ensure_equals("ack count", mPacket->mAckCount, 5);
+		ensure_equals("size", mPacket->mSize, (S32)raw.size() - 1);
+
+		// copying it leaves the acks alone
+		LLReceivedPacket* copy = new LLReceivedPacket;
+		copy->copy(*mPacket);
+		ensure("copy not malformed", copy->mMalformed);
+		ensure_equals("copy size", copy->mSize, mPacket->mSize);
+		delete copy;
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<4>()
+	{
+		// zero coded packets are expanded, with and without acks
+		const U8 body[] = { 0xff, 0x00, 0x05, 0x01, 0x00, 0x02, 0x07 };
+		const U8 expanded_body[] = { 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x07 };
+		std::vector<U8> expanded = makePacket(0, 11, expanded_body, sizeof(expanded_body));
+		std::vector<U8> raw = makePacket(LL_ZERO_CODE_FLAG, 11, body, sizeof(body));
+
+		mPacket->prepare(&raw[0], (S32)raw.size());
+		ensure_equals("compressed size", mPacket->mCompressedSize, (S32)raw.size());
+		ensure("overflow", !mPacket->mExpandOverflow);
+		ensureData("expanded data", &expanded[0], (S32)expanded.size());
+
+		const TPACKETID acks[] = { 42 };
+		S32 compressed_size = (S32)raw.size();
+		raw[0] |= LL_ACK_FLAG;
+		appendAcks(raw, acks, 1);
+		expanded[0] = LL_ACK_FLAG;
+		mPacket->prepare(&raw[0], (S32)raw.size());
+		ensure_equals("acked compressed size", mPacket->mCompressedSize, compressed_size);
+		ensure_equals("acked ack count", mPacket->mAckCount, 1);
+		ensure_equals("acked ack", mPacket->mAcks[0], (TPACKETID)42);
+		ensureData("acked expanded data", &expanded[0], (S32)expanded.size());
+
+		LLReceivedPacket* copy = new LLReceivedPacket;
+		copy->copy(*mPacket);
+		ensure_equals("copy compressed size", copy->mCompressedSize, compressed_size);
+		ensure_equals("copy ack", copy->mAcks[0], (TPACKETID)42);
+		ensure_equals("copy size", copy->mSize, mPacket->mSize);
+		ensure("copy data", !memcmp(copy->mData, mPacket->mData, copy->mSize));
+		delete copy;
+	}
+
+	template<> template<>
+	void packet_receive_object_t::test<5>()
+	{
+		// the ring hands packets over in order, drops them when full and
+		// keeps working after wrapping around
+		S32 socket = 0;
+		int port = NET_USE_OS_ASSIGNED_PORT;
+		ensure_equals("start_net failed", start_net(socket, port), 0);
+		U32 loopback = ip_string_to_u32("127.0.0.1");
+
+		// Queue ten packets on the socket before the thread starts, the
+		// thread drains them in one batch into a ring of four.
+		for (U32 i = 0; i < 10; ++i)
+		{
+			U8 body[] = { 0xff, 0x01, (U8)i };
+			std::vector<U8> raw = makePacket(0, i, body, sizeof(body));
+			ensure("send failed", send_packet(socket, (const char*)&raw[0], (S32)raw.size(), loopback, port));
+		}
+		ms_sleep(50);
+
+		LLPacketReceiveThread* thread = new LLPacketReceiveThread(socket, 3);
+		thread->start();
+
+		U32 dropped_total = 0;
+		U32 dropped, received;
+		F32 average_wait, max_wait;
+		for (S32 i = 0; i < 500 && dropped_total < 6; ++i)
+		{
+			ms_sleep(10);
+			thread->sampleStats(dropped, received, average_wait, max_wait);
+			dropped_total += dropped;
+		}
+		ensure_equals("dropped", dropped_total, (U32)6);
+
+		for (U32 i = 0; i < 4; ++i)
+		{
+			ensure("packet missing", thread->popPacket(*mPacket));
+			ensure_equals("order", (U32)mPacket->mData[LL_PACKET_ID_SIZE + 2], i);
+			ensure_equals("sender address", mPacket->mSender.getAddress(), loopback);
+			ensure_equals("sender port", mPacket->mSender.getPort(), (U32)port);
+		}
+		ensure("ring not empty", !thread->popPacket(*mPacket));
+		thread->sampleStats(dropped, received, average_wait, max_wait);
+		ensure_equals("received", received, (U32)4);
+
+		for (U32 i = 10; i < 16; ++i)
+		{
+			U8 body[] = { 0xff, 0x01, (U8)i };
+			std::vector<U8> raw = makePacket(0, i, body, sizeof(body));
+			ensure("send failed", send_packet(socket, (const char*)&raw[0], (S32)raw.size(), loopback, port));
+
+			bool popped = false;
+			for (S32 j = 0; j < 500 && !popped; ++j)
+			{
+				popped = thread->popPacket(*mPacket);
+				if (!popped)
+				{
+					ms_sleep(10);
+				}
+			}
+			ensure("packet after wrap missing", popped);
+			ensure_equals("order after wrap", (U32)mPacket->mData[LL_PACKET_ID_SIZE + 2], i);
+		}
+
+		delete thread;
+		end_net(socket);
+	}
+}
@@ -769,6 +769,115 @@ namespace tut
 		ensure("type is a string", v.isString());
 	}
 
+	class SDArenaEnabler
+		///< turns arenas on for the scope of a test
+	{
+	private:
+		bool mWasEnabled;
+	public:
+		SDArenaEnabler() : mWasEnabled(LLSDArenaScope::sEnabled) { LLSDArenaScope::sEnabled = true; }
+		~SDArenaEnabler() { LLSDArenaScope::sEnabled = mWasEnabled; }
+	};
+
+	template<> template<>
+	void SDTestObject::test<15>()
+		// arena allocated documents
+	{
+		SDArenaEnabler enabler;
+		SDCleanupCheck check;
+
+		LLSD kept;
+		{
+			LLSD doc;
+			{
+				LLSDArenaScope arena;
+				doc["name"] = "document";
+				doc["list"].append(1);
+				doc["list"].append("two");
+				doc["inner"]["value"] = 3.5;
+			}
+
+			LLSD copy = doc;
+			copy["name"] = "changed";
+			copy["list"].append(3);
+			ensureTypeAndValue("arena node copied on write", doc["name"], "document");
+			ensureTypeAndValue("copy changed", copy["name"], "changed");
+			ensure_equals("arena array unaltered", doc["list"].size(), 2);
+			ensure_equals("copy array changed", copy["list"].size(), 3);
+
+			kept = doc["inner"];
+		}
+		// The document was released, the part we kept must still be valid.
+		ensureTypeAndValue("kept value", kept["value"], 3.5);
+	}
+
+	template<> template<>
+	void SDTestObject::test<16>()
+		// arena values are copied on write and released one by one
+	{
+		SDArenaEnabler enabler;
+		SDCleanupCheck check;
+
+		LLSD kept;
+		{
+			LLSDArenaScope arena;
+			LLSD doc;
+			doc["name"] = "document";
+			doc["inner"]["value"] = 3.5;
+			for (S32 i = 0; i < 100; ++i)
+			{
+				doc["list"].append(i);
+			}
+
+			// Still building: a copy must not change the original.
+			LLSD copy = doc;
+			copy["name"] = "changed";
+			copy["inner"]["value"] = 1.0;
+			ensureTypeAndValue("original name while building", doc["name"], "document");
+			ensureTypeAndValue("original inner while building", doc["inner"]["value"], 3.5);
+			ensureTypeAndValue("copy name while building", copy["name"], "changed");
+
+			kept = doc["inner"];
+		}
+
+		// Everything but the kept subtree went away with the document.
+		U32 outstanding = LLSD::outstandingCount();
+		LLSD value = kept["value"];
+		kept = LLSD();
+		ensureTypeAndValue("value outlives its map", value, 3.5);
+		ensure_equals("map released on its own", LLSD::outstandingCount(), outstanding - 1);
+		value = LLSD();
+		ensure_equals("subtree released", LLSD::outstandingCount(), outstanding - 2);
+	}
+
+	template<> template<>
+	void SDTestObject::test<17>()
+		// a value kept from a document holds on to its chunk only
+	{
+		SDArenaEnabler enabler;
+		SDCleanupCheck check;
+
+		U32 chunks = LLSDArenaScope::getChunkCount();
+		LLSD kept;
+		{
+			LLSD doc;
+			{
+				LLSDArenaScope arena;
+				doc["name"] = "document";
+				for (S32 i = 0; i < 1000; ++i)
+				{
+					doc["list"].append(i);
+				}
+			}
+			ensure("document spans chunks", LLSDArenaScope::getChunkCount() > chunks + 1);
+			kept = doc["list"][500];
+		}
+		ensureTypeAndValue("kept value", kept, 500);
+		ensure_equals("one chunk kept", LLSDArenaScope::getChunkCount(), chunks + 1);
+		kept = LLSD();
+		ensure_equals("all chunks freed", LLSDArenaScope::getChunkCount(), chunks);
+	}
+
 	/* TO DO:
 		conversion of undefined to UUID, Date, URI and Binary
 		conversion of undefined to map and array
@@ -0,0 +1,305 @@
+/**
+ * @file llsdview_tut.cpp
+ * @brief Test cases for LLSDBinaryView and LLSDView
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "llsdview.h"
+#include "llsdserialize.h"
+#include "llsdutil.h"
+#include "lltut.h"
+
+#include <sstream>
+
+namespace tut
+{
+	struct sd_view_test
+	{
+		std::string mBuffer;
+		LLSDBinaryView mView;
+
+		S32 parse(const LLSD& sd, const std::string& trailer = std::string())
+		{
+			std::ostringstream str;
+			LLSDSerialize::toBinary(sd, str);
+			mBuffer = str.str() + trailer;
+			return mView.parse((const U8*)mBuffer.data(), (S32)mBuffer.size());
+		}
+
+		static LLSD sample()
+		{
+			LLSD sd;
+			sd["version"] = 3;
+			sd["name"] = "mesh";
+			sd["ratio"] = 0.5;
+			sd["flag"] = true;
+			sd["id"] = LLUUID("8a6ac8a6-2a83-4d8e-8e0a-6e9b0d9d8a3c");
+			sd["high_lod"]["offset"] = 128;
+			sd["high_lod"]["size"] = 4096;
+			LLSD::Binary bin;
+			bin.push_back(1);
+			bin.push_back(0);
+			bin.push_back(255);
+			sd["blob"] = bin;
+			sd["list"].append(10);
+			sd["list"].append("eleven");
+			sd["list"].append(LLSD());
+			sd["list"].append(12.5);
+			return sd;
+		}
+	};
+	typedef test_group<sd_view_test> sd_view_test_t;
+	typedef sd_view_test_t::object sd_view_test_object_t;
+	tut::sd_view_test_t tut_sd_view_test("llsdview");
+
+	// asLLSD() gives back what was serialized
+	template<> template<>
+	void sd_view_test_object_t::test<1>()
+	{
+		LLSD sd = sample();
+		ensure_equals("bytes used", parse(sd), (S32)mBuffer.size());
+		ensure("round trip", llsd_equals(mView.root().asLLSD(), sd));
+
+		LLSD empty_map = LLSD::emptyMap();
+		parse(empty_map);
+		ensure("empty map", mView.root().isMap());
+		ensure_equals("empty map size", mView.root().size(), 0);
+		ensure("empty map begin", mView.root().begin() == mView.root().end());
+
+		parse(LLSD(42));
+		ensure_equals("scalar root", mView.root().asInteger(), 42);
+	}
+
+	// map lookups, and chains through missing keys
+	template<> template<>
+	void sd_view_test_object_t::test<2>()
+	{
+		parse(sample());
+		LLSDView root = mView.root();
+		ensure("map", root.isMap());
+		ensure_equals("map size", root.size(), 8);
+		ensure("has version", root.has("version"));
+		ensure("has no lowest_lod", !root.has("lowest_lod"));
+		ensure_equals("version", root["version"].asInteger(), 3);
+		ensure_equals("ratio", root["ratio"].asReal(), 0.5);
+		ensure("flag", root["flag"].asBoolean());
+		ensure_equals("id", root["id"].asUUID(), LLUUID("8a6ac8a6-2a83-4d8e-8e0a-6e9b0d9d8a3c"));
+		ensure_equals("nested offset", root["high_lod"]["offset"].asInteger(), 128);
+		ensure_equals("nested size", root[std::string("high_lod")]["size"].asInteger(), 4096);
+		ensure_equals("integer as string", root["version"].asString(), std::string("3"));
+
+		ensure("missing key", root["lowest_lod"].isUndefined());
+		ensure_equals("missing chain", root["lowest_lod"]["size"].asInteger(), 0);
+		ensure("key of a scalar", root["version"]["size"].isUndefined());
+		ensure("index of a map", root[0].isUndefined());
+		ensure("default view", LLSDView()["a"][1].isUndefined());
+	}
+
+	// array lookups and iteration over arrays and maps
+	template<> template<>
+	void sd_view_test_object_t::test<3>()
+	{
+		LLSD sd = sample();
+		parse(sd);
+		LLSDView list = mView.root()["list"];
+		ensure("array", list.isArray());
+		ensure_equals("array size", list.size(), 4);
+		ensure_equals("element 0", list[0].asInteger(), 10);
+		ensure_equals("element 1", list[1].asString(), std::string("eleven"));
+		ensure("element 2", list[2].isUndefined());
+		ensure_equals("element 3", list[3].asReal(), 12.5);
+		ensure("past the end", list[4].isUndefined());
+		ensure("negative index", list[-1].isUndefined());
+
+		S32 count = 0;
+		for (LLSDView::const_iterator iter = list.begin(); iter != list.end(); ++iter)
+		{
+			ensure("array iteration", llsd_equals((*iter).asLLSD(), sd["list"][count]));
+			++count;
+		}
+		ensure_equals("array iterated", count, 4);
+
+		// Iteration skips over nested subtrees.
+		count = 0;
+		LLSDView root = mView.root();
+		for (LLSDView::const_iterator iter = root.begin(); iter != root.end(); ++iter)
+		{
+			std::string key = iter.key().asString();
+			ensure("map key " + key, sd.has(key));
+			ensure("map value " + key, llsd_equals((*iter).asLLSD(), sd[key]));
+			++count;
+		}
+		ensure_equals("map iterated", count, sd.size());
+	}
+
+	// in place access to strings and binaries
+	template<> template<>
+	void sd_view_test_object_t::test<4>()
+	{
+		parse(sample());
+		LLSDView name = mView.root()["name"];
+		ensure("string", name.isString());
+		ensure_equals("string size", name.dataSize(), 4);
+		ensure("string in place", name.data() >= mBuffer.data() && name.data() < mBuffer.data() + mBuffer.size());
+		ensure("string bytes", !memcmp(name.data(), "mesh", 4));
+		ensure("equals", name.equals("mesh"));
+		ensure("not equals prefix", !name.equals("mes"));
+		ensure("not equals longer", !name.equals("meshes"));
+
+		LLSDView blob = mView.root()["blob"];
+		ensure("binary", blob.isBinary());
+		ensure_equals("binary size", blob.dataSize(), 3);
+		ensure_equals("binary byte", (U8)blob.data()[2], (U8)255);
+		ensure_equals("binary copy", blob.asBinary().size(), (size_t)3);
+
+		ensure("no data for integers", mView.root()["version"].data() == NULL);
+	}
+
+	// notation style quoted strings with escapes are unescaped on request
+	template<> template<>
+	void sd_view_test_object_t::test<5>()
+	{
+		static const char doc[] = "{\x00\x00\x00\x02k\x00\x00\x00\x01" "a'x\\ty\\x41'" "'b's\x00\x00\x00\x01z}";
+		S32 size = sizeof(doc) - 1;
+		ensure_equals("parsed", mView.parse((const U8*)doc, size), size);
+		LLSDView a = mView.root()["a"];
+		ensure("escaped string", a.isString());
+		ensure_equals("unescaped", a.asString(), std::string("x\tyA"));
+		ensure("no in place data", a.data() == NULL);
+		ensure_equals("quoted key", mView.root()["b"].asString(), std::string("z"));
+	}
+
+	// bytes used with trailing data, and failures on broken buffers
+	template<> template<>
+	void sd_view_test_object_t::test<6>()
+	{
+		LLSD sd = sample();
+		std::ostringstream str;
+		LLSDSerialize::toBinary(sd, str);
+		S32 length = (S32)str.str().size();
+
+		ensure_equals("trailing data", parse(sd, "trailing mesh data"), length);
+		ensure("trailing round trip", llsd_equals(mView.root().asLLSD(), sd));
+
+		const U8* buffer = (const U8*)mBuffer.data();
+		for (S32 cut = 0; cut < length; cut += 7)
+		{
+			ensure_equals("truncated", mView.parse(buffer, cut), (S32)LLSDParser::PARSE_FAILURE);
+			ensure("truncated root", mView.root().isUndefined());
+		}
+
+		static const char bogus_count[] = "[\x7f\xff\xff\xff" "i\x00\x00\x00\x01]";
+		ensure_equals("bogus count", mView.parse((const U8*)bogus_count, sizeof(bogus_count) - 1), (S32)LLSDParser::PARSE_FAILURE);
+		static const char bad_type[] = "[\x00\x00\x00\x01" "q]";
+		ensure_equals("bad type", mView.parse((const U8*)bad_type, sizeof(bad_type) - 1), (S32)LLSDParser::PARSE_FAILURE);
+	}
+
+	// notation written by LLSDNotationFormatter reads back the same
+	template<> template<>
+	void sd_view_test_object_t::test<7>()
+	{
+		LLSD sd = sample();
+		sd["when"] = LLDate(1000000000.0);
+		sd["link"] = LLURI("http://example.com/a?b=1");
+		sd["quote"] = "it's \"quoted\"\n";
+
+		std::ostringstream str;
+		LLSDSerialize::toNotation(sd, str);
+		mBuffer = str.str();
+		ensure_equals("bytes used", mView.parseNotation((const U8*)mBuffer.data(), (S32)mBuffer.size()), (S32)mBuffer.size());
+		ensure("round trip", llsd_equals(mView.root().asLLSD(), sd));
+		ensure_equals("version", mView.root()["version"].asInteger(), 3);
+		ensure_equals("id", mView.root()["id"].asUUID(), LLUUID("8a6ac8a6-2a83-4d8e-8e0a-6e9b0d9d8a3c"));
+		ensure("blob", mView.root()["blob"].asBinary() == sd["blob"].asBinary());
+
+		LLSD parsed;
+		ensure("from buffer", LLSDSerialize::fromNotationBuffer(parsed, (const U8*)mBuffer.data(), (S32)mBuffer.size()) > 0);
+		ensure("from buffer round trip", llsd_equals(parsed, sd));
+	}
+
+	// every notation form of a value
+	template<> template<>
+	void sd_view_test_object_t::test<8>()
+	{
+		mBuffer = " [ i-7, r1.5e3, 1, true, F, tRuE, 'q\\'t', s(3)\"a,c\", b16\"0aFF\", b64\"AQD/\","
+				  " b(2)\"x]\", l\"http://x/\", u8a6ac8a6-2a83-4d8e-8e0a-6e9b0d9d8a3c,"
+				  " d\"2006-02-01T14:29:53Z\", {'k':!, s(1)\"s\" : i2}, [] ]trailing";
+		S32 used = mView.parseNotation((const U8*)mBuffer.data(), (S32)mBuffer.size());
+		ensure_equals("bytes used", used, (S32)mBuffer.size() - 8);
+		LLSDView list = mView.root();
+		ensure_equals("size", list.size(), 16);
+		ensure_equals("integer", list[0].asInteger(), -7);
+		ensure_equals("real", list[1].asReal(), 1500.0);
+		ensure("one", list[2].asBoolean());
+		ensure("true", list[3].asBoolean());
+		ensure("F", !list[4].asBoolean() && list[4].type() == LLSD::TypeBoolean);
+		ensure("mixed case", list[5].asBoolean());
+		ensure_equals("escaped", list[6].asString(), std::string("q't"));
+		ensure("sized string in place", list[7].equals("a,c") && list[7].data() != NULL);
+
+		LLSD::Binary bin16 = list[8].asBinary();
+		ensure_equals("base 16 size", bin16.size(), (size_t)2);
+		ensure("base 16", bin16[0] == 0x0a && bin16[1] == 0xff);
+		ensure("base 16 not in place", list[8].data() == NULL);
+		LLSD::Binary bin64 = list[9].asBinary();
+		ensure_equals("base 64 size", bin64.size(), (size_t)3);
+		ensure("base 64", bin64[0] == 1 && bin64[1] == 0 && bin64[2] == 255);
+		ensure_equals("sized binary", list[10].dataSize(), 2);
+		ensure("sized binary bytes", !memcmp(list[10].data(), "x]", 2));
+
+		ensure_equals("uri", list[11].asURI().asString(), std::string("http://x/"));
+		ensure_equals("uuid", list[12].asUUID(), LLUUID("8a6ac8a6-2a83-4d8e-8e0a-6e9b0d9d8a3c"));
+		ensure_equals("date", list[13].asDate().asString(), LLDate("2006-02-01T14:29:53Z").asString());
+		ensure("undefined in map", list[14].has("k") && list[14]["k"].isUndefined());
+		ensure_equals("sized key", list[14]["s"].asInteger(), 2);
+		ensure("empty array", list[15].isArray() && list[15].size() == 0);
+	}
+
+	// broken notation fails, whatever was parsed before
+	template<> template<>
+	void sd_view_test_object_t::test<9>()
+	{
+		static const char* const bad[] =
+		{
+			"", "   ", "[i]", "[i1", "{'a' i1}", "{a:i1}", "tru", "fals", "r", "rx",
+			"u8a6ac8a6-2a83-4d8e-8e0a", "u8a6ac8a6x2a83-4d8e-8e0a-6e9b0d9d8a3c",
+			"'open", "s(5)\"ab\"", "s(x)\"\"", "b16\"abc\"", "b16\"zz\"", "b64\"AQD",
+			"b(3)\"ab", "l", "d2006", "q", "[1 ? 2]"
+		};
+		for (U32 i = 0; i < LL_ARRAY_SIZE(bad); ++i)
+		{
+			std::string doc(bad[i]);
+			ensure_equals("bad: " + doc, mView.parseNotation((const U8*)doc.data(), (S32)doc.size()), (S32)LLSDParser::PARSE_FAILURE);
+			ensure("bad root: " + doc, mView.root().isUndefined());
+		}
+
+		std::string deep(1000, '[');
+		ensure_equals("too deep", mView.parseNotation((const U8*)deep.data(), (S32)deep.size()), (S32)LLSDParser::PARSE_FAILURE);
+
+		LLSD kept(5);
+		std::string doc("[i1,");
+		ensure_equals("from buffer fails", LLSDSerialize::fromNotationBuffer(kept, (const U8*)doc.data(), (S32)doc.size()), (S32)LLSDParser::PARSE_FAILURE);
+		ensure_equals("left alone", kept.asInteger(), 5);
+	}
+}
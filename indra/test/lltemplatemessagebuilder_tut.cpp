@@ -970,5 +970,32 @@ namespace tut
 		ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
 		delete reader;
 	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<46>()
+		// indexed field reads of repeated blocks
+	{
+		LLMessageTemplate messageTemplate = defaultTemplate();
+		messageTemplate.addBlock(defaultBlock(MVT_U32, 4));
+		LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+		builder->addU32(_PREHASH_Test0, 0x11111111);
+		builder->nextBlock(_PREHASH_Test0);
+		builder->addU32(_PREHASH_Test0, 0x22222222);
+		builder->nextBlock(_PREHASH_Test0);
+		builder->addU32(_PREHASH_Test0, 0x33333333);
+		LLTemplateMessageReader* reader = setReader(messageTemplate, builder);
+
+		LLMessageField field(_PREHASH_Test0, _PREHASH_Test0);
+		U32 outValue = 0;
+		ensure_equals("Ensure 3 repeats", reader->getNumberOfBlocks(_PREHASH_Test0), 3);
+		reader->getFieldData(field, &outValue, sizeof(U32), 2);
+		ensure_equals("Ensure third value", outValue, (U32)0x33333333);
+		reader->getFieldData(field, &outValue, sizeof(U32), 1);
+		ensure_equals("Ensure second value", outValue, (U32)0x22222222);
+		ensure_equals("Ensure field size", reader->getFieldSize(field, 0), 4);
+		reader->getU32(_PREHASH_Test0, _PREHASH_Test0, outValue, 0);
+		ensure_equals("Ensure first value by name", outValue, (U32)0x11111111);
+		delete reader;
+	}
 }
 
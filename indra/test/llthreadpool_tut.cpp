@@ -0,0 +1,275 @@
+/**
+ * @file llthreadpool_tut.cpp
+ * @brief Tests for the shared thread pool.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "lltut.h"
+
+namespace tut
+{
+	// Keeps a pool thread busy until opened.
+	struct Gate
+	{
+		Gate() : mStarted(false), mOpen(false) { }
+
+		void waitStarted()
+		{
+			mCondition.lock();
+			while (!mStarted)
+			{
+				mCondition.wait();
+			}
+			mCondition.unlock();
+		}
+
+		void open()
+		{
+			mCondition.lock();
+			mOpen = true;
+			mCondition.broadcast();
+			mCondition.unlock();
+		}
+
+		LLCondition mCondition;
+		bool mStarted;
+		bool mOpen;
+	};
+
+	class GateTask : public LLThreadPool::Task
+	{
+	public:
+		GateTask(Gate& gate) : mGate(gate) { }
+
+		/*virtual*/ void run()
+		{
+			mGate.mCondition.lock();
+			mGate.mStarted = true;
+			mGate.mCondition.broadcast();
+			while (!mGate.mOpen)
+			{
+				mGate.mCondition.wait();
+			}
+			mGate.mCondition.unlock();
+		}
+
+	private:
+		Gate& mGate;
+	};
+
+	// Records the lane it was posted on when it runs.
+	class LaneTask : public LLThreadPool::Task
+	{
+	public:
+		LaneTask(LLThreadPool::ELane lane, LLMutex& mutex, std::vector<S32>& order, LLAtomicU32& count)
+			: mLane(lane), mMutex(mutex), mOrder(order), mCount(count) { }
+
+		/*virtual*/ void run()
+		{
+			mMutex.lock();
+			mOrder.push_back(mLane);
+			mMutex.unlock();
+			mCount++;
+		}
+
+	private:
+		LLThreadPool::ELane mLane;
+		LLMutex& mMutex;
+		std::vector<S32>& mOrder;
+		LLAtomicU32& mCount;
+	};
+
+	class CountTask : public LLThreadPool::Task
+	{
+	public:
+		CountTask(LLAtomicU32& count) : mCount(count) { }
+		/*virtual*/ void run()							{ mCount++; }
+
+	private:
+		LLAtomicU32& mCount;
+	};
+
+	class CountJob : public LLThreadPool::Job
+	{
+	public:
+		CountJob() : mRuns(0) { }
+		/*virtual*/ void run()							{ mRuns++; }
+
+		LLAtomicU32 mRuns;
+	};
+
+	struct thread_pool_test
+	{
+		// Waits until count reaches expected, or gives up after ten seconds.
+		static bool waitForCount(LLAtomicU32& count, U32 expected)
+		{
+			for (S32 i = 0; i < 1000 && count < expected; ++i)
+			{
+				ms_sleep(10);
+			}
+			return count == expected;
+		}
+
+		static bool allRanOnce(CountJob* jobs, U32 count)
+		{
+			for (U32 i = 0; i < count; ++i)
+			{
+				if (jobs[i].mRuns != 1)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+	typedef test_group<thread_pool_test> thread_pool_test_t;
+	typedef thread_pool_test_t::object thread_pool_test_object_t;
+	tut::thread_pool_test_t tut_thread_pool_test("llthreadpool");
+
+	// tasks queued behind a busy thread are stolen by the idle one
+	template<> template<>
+	void thread_pool_test_object_t::test<1>()
+	{
+		LLThreadPool pool("Steal test", 2);
+		Gate gate;
+		pool.post(new GateTask(gate));
+		gate.waitStarted();
+
+		// Posts from this thread alternate between the two queues, so half
+		// of these can only run when the idle thread steals them.
+		LLAtomicU32 count(0);
+		for (U32 i = 0; i < 8; ++i)
+		{
+			pool.post(new CountTask(count));
+		}
+		bool all_ran = waitForCount(count, 8);
+		gate.open();
+		ensure("all ran while one thread was busy", all_ran);
+	}
+
+	// higher lanes are taken first, whatever the order of posting
+	template<> template<>
+	void thread_pool_test_object_t::test<2>()
+	{
+		LLThreadPool pool("Lane test", 1);
+		Gate gate;
+		pool.post(new GateTask(gate));
+		gate.waitStarted();
+
+		LLMutex mutex;
+		std::vector<S32> order;
+		LLAtomicU32 count(0);
+		const LLThreadPool::ELane lanes[] = { LLThreadPool::LANE_LOW, LLThreadPool::LANE_NORMAL, LLThreadPool::LANE_HIGH,
+											  LLThreadPool::LANE_LOW, LLThreadPool::LANE_HIGH };
+		for (U32 i = 0; i < LL_ARRAY_SIZE(lanes); ++i)
+		{
+			pool.post(new LaneTask(lanes[i], mutex, order, count), lanes[i]);
+		}
+		gate.open();
+		ensure("all ran", waitForCount(count, 5));
+
+		mutex.lock();
+		std::vector<S32> ran(order);
+		mutex.unlock();
+		ensure_equals("tasks ran", ran.size(), (size_t)5);
+		ensure_equals("first high", ran[0], (S32)LLThreadPool::LANE_HIGH);
+		ensure_equals("second high", ran[1], (S32)LLThreadPool::LANE_HIGH);
+		ensure_equals("then normal", ran[2], (S32)LLThreadPool::LANE_NORMAL);
+		ensure_equals("then low", ran[3], (S32)LLThreadPool::LANE_LOW);
+		ensure_equals("last low", ran[4], (S32)LLThreadPool::LANE_LOW);
+	}
+
+	// runBatch returns once every job ran, each exactly once
+	template<> template<>
+	void thread_pool_test_object_t::test<3>()
+	{
+		LLThreadPool pool("Batch test", 3);
+		const U32 count = 64;
+		CountJob jobs[count];
+		LLThreadPool::Job* job_ptrs[count];
+		for (U32 i = 0; i < count; ++i)
+		{
+			job_ptrs[i] = &jobs[i];
+		}
+		pool.runBatch(job_ptrs, count);
+		ensure("all ran once", allRanOnce(jobs, count));
+
+		// Again, so helpers of the first batch that start late meet a
+		// finished batch.
+		for (U32 i = 0; i < count; ++i)
+		{
+			jobs[i].mRuns = 0;
+		}
+		pool.runBatch(job_ptrs, count);
+		ensure("all ran once again", allRanOnce(jobs, count));
+	}
+
+	// a batch finishes even when no pool thread gets to help
+	template<> template<>
+	void thread_pool_test_object_t::test<4>()
+	{
+		LLThreadPool pool("Busy batch test", 1);
+		Gate gate;
+		pool.post(new GateTask(gate));
+		gate.waitStarted();
+
+		const U32 count = 4;
+		CountJob jobs[count];
+		LLThreadPool::Job* job_ptrs[count];
+		for (U32 i = 0; i < count; ++i)
+		{
+			job_ptrs[i] = &jobs[i];
+		}
+		pool.runBatch(job_ptrs, count);
+		ensure("all ran once", allRanOnce(jobs, count));
+
+		// The helper still queued finds nothing left to do.
+		LLAtomicU32 done(0);
+		pool.post(new CountTask(done), LLThreadPool::LANE_LOW);
+		gate.open();
+		ensure("helper let go", waitForCount(done, 1));
+	}
+
+	// without threads, tasks and batches run on the caller
+	template<> template<>
+	void thread_pool_test_object_t::test<5>()
+	{
+		LLThreadPool pool("No threads test", 0);
+		LLAtomicU32 count(0);
+		pool.post(new CountTask(count));
+		ensure_equals("ran right away", (U32)count, (U32)1);
+
+		const U32 jobs_count = 3;
+		CountJob jobs[jobs_count];
+		LLThreadPool::Job* job_ptrs[jobs_count];
+		for (U32 i = 0; i < jobs_count; ++i)
+		{
+			job_ptrs[i] = &jobs[i];
+		}
+		pool.runBatch(job_ptrs, jobs_count);
+		ensure("all ran once", allRanOnce(jobs, jobs_count));
+	}
+}
@@ -0,0 +1,116 @@
+/**
+ * @file lluuidhashindex_tut.cpp
+ * @brief Test cases for LLUUIDHashIndex
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lluuidhashindex.h"
+#include "lltut.h"
+
+#include <map>
+
+namespace tut
+{
+	struct hash_index_test
+	{
+	};
+	typedef test_group<hash_index_test> hash_index_test_t;
+	typedef hash_index_test_t::object hash_index_test_object_t;
+	tut::hash_index_test_t tut_hash_index_test("lluuidhashindex");
+
+	// insert, find, erase against std::map
+	template<> template<>
+	void hash_index_test_object_t::test<1>()
+	{
+		LLUUIDHashIndex<S32> index;
+		std::map<LLUUID, S32> reference;
+		std::vector<LLUUID> ids(2000);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			ids[i].generate();
+		}
+		ids[0].setNull();
+
+		for (S32 i = 0; i < 20000; ++i)
+		{
+			const LLUUID& id = ids[(i * 7919) % ids.size()];
+			switch (i % 3)
+			{
+			case 0:
+				index[id] = i;
+				reference[id] = i;
+				break;
+			case 1:
+				ensure_equals("erase failed", index.erase(id), reference.erase(id));
+				break;
+			default:
+			{
+				LLUUIDHashIndex<S32>::const_iterator iter = ((const LLUUIDHashIndex<S32>&)index).find(id);
+				std::map<LLUUID, S32>::const_iterator ref_iter = reference.find(id);
+				ensure_equals("find failed", iter == index.end(), ref_iter == reference.end());
+				if (ref_iter != reference.end())
+				{
+					ensure_equals("value failed", iter->second, ref_iter->second);
+				}
+			}
+			}
+			ensure_equals("size failed", index.size(), reference.size());
+		}
+
+		size_t visited = 0;
+		for (LLUUIDHashIndex<S32>::iterator iter = index.begin(); iter != index.end(); ++iter)
+		{
+			ensure_equals("iteration failed", iter->second, reference[iter->first]);
+			++visited;
+		}
+		ensure_equals("iteration count failed", visited, reference.size());
+	}
+
+	// erasing keeps colliding keys reachable
+	template<> template<>
+	void hash_index_test_object_t::test<2>()
+	{
+		// Same CRC, so all of them probe from the same slot.
+		LLUUIDHashIndex<S32> index;
+		std::vector<LLUUID> ids(64);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			U32* words = (U32*)ids[i].mData;
+			words[0] = i;
+			words[1] = 100 - i;
+			index[ids[i]] = i;
+		}
+		for (U32 i = 0; i < ids.size(); i += 2)
+		{
+			ensure_equals("erase failed", index.erase(ids[i]), (size_t)1);
+		}
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			ensure_equals("count failed", index.count(ids[i]), (size_t)(i % 2));
+		}
+
+		index.clear();
+		ensure("clear failed", index.empty() && index.begin() == index.end());
+	}
+}
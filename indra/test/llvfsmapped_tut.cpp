@@ -0,0 +1,273 @@
+/**
+ * @file llvfsmapped_tut.cpp
+ * @brief Test cases for LLVFSMappedStore
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "lltimer.h"
+#include "llvfsmapped.h"
+#include "lltut.h"
+
+#include "llfile.h"
+
+namespace tut
+{
+	struct vfs_mapped_test
+	{
+		vfs_mapped_test()
+		{
+			mIndexFilename = std::string(LLFile::tmpdir()) + "llvfsmapped_tut.index";
+			mDataFilename = std::string(LLFile::tmpdir()) + "llvfsmapped_tut.data";
+			removeFiles();
+		}
+		~vfs_mapped_test()
+		{
+			mStore.close();
+			removeFiles();
+		}
+
+		void removeFiles()
+		{
+			LLFile::remove_nowarn(mIndexFilename);
+			LLFile::remove_nowarn(mDataFilename);
+		}
+
+		bool open()
+		{
+			return mStore.open(mIndexFilename, mDataFilename, FALSE, DATA_SIZE, FALSE);
+		}
+
+		// Creates a file of max_size holding size bytes of value.
+		void makeFile(const LLUUID& id, S32 max_size, S32 size, U8 value)
+		{
+			ensure("setMaxSize failed", mStore.setMaxSize(id, LLAssetType::AT_SOUND, max_size));
+			std::vector<U8> data(size, value);
+			ensure_equals("storeData failed", mStore.storeData(id, LLAssetType::AT_SOUND, &data[0], 0, size), size);
+		}
+
+		// Checks that id holds size bytes of value.
+		void checkFile(const char* msg, const LLUUID& id, S32 size, U8 value)
+		{
+			ensure_equals(msg, mStore.getSize(id, LLAssetType::AT_SOUND), size);
+			std::vector<U8> data(size + 16, 0);
+			ensure_equals(msg, mStore.getData(id, LLAssetType::AT_SOUND, &data[0], 0, (S32)data.size()), size);
+			for (S32 i = 0; i < size; ++i)
+			{
+				if (data[i] != value)
+				{
+					fail(msg);
+				}
+			}
+		}
+
+		enum { DATA_SIZE = 1024 * 1024 };
+
+		LLVFSMappedStore mStore;
+		std::string mIndexFilename;
+		std::string mDataFilename;
+	};
+	typedef test_group<vfs_mapped_test> vfs_mapped_test_t;
+	typedef vfs_mapped_test_t::object vfs_mapped_test_object_t;
+	tut::vfs_mapped_test_t tut_vfs_mapped_test("llvfsmapped");
+
+	// create: new files start empty and sizes round up to 1KB
+	template<> template<>
+	void vfs_mapped_test_object_t::test<1>()
+	{
+		ensure("open failed", open());
+		LLUUID id;
+		id.generate();
+		ensure("new store not empty", !mStore.getExists(id, LLAssetType::AT_SOUND));
+		ensure_equals("size of missing file", mStore.getSize(id, LLAssetType::AT_SOUND), 0);
+
+		ensure("setMaxSize failed", mStore.setMaxSize(id, LLAssetType::AT_SOUND, 1000));
+		ensure("created file missing", mStore.getExists(id, LLAssetType::AT_SOUND));
+		ensure_equals("max size not rounded up", mStore.getMaxSize(id, LLAssetType::AT_SOUND), 1024);
+		ensure_equals("new file not empty", mStore.getSize(id, LLAssetType::AT_SOUND), 0);
+		ensure("other type exists", !mStore.getExists(id, LLAssetType::AT_TEXTURE));
+
+		ensure("texture setMaxSize failed", mStore.setMaxSize(id, LLAssetType::AT_TEXTURE, 1000));
+		ensure_equals("texture size rounded", mStore.getMaxSize(id, LLAssetType::AT_TEXTURE), 1000);
+	}
+
+	// store/get: writes at an offset, appends and reads are clamped to the size
+	template<> template<>
+	void vfs_mapped_test_object_t::test<2>()
+	{
+		ensure("open failed", open());
+		LLUUID id;
+		id.generate();
+		makeFile(id, 4096, 100, 7);
+		checkFile("first write", id, 100, 7);
+
+		std::vector<U8> more(50, 7);
+		ensure_equals("append failed", mStore.storeData(id, LLAssetType::AT_SOUND, &more[0], -1, 50), 50);
+		checkFile("append", id, 150, 7);
+
+		U8 byte = 0;
+		ensure_equals("read at offset", mStore.getData(id, LLAssetType::AT_SOUND, &byte, 149, 1), 1);
+		ensure_equals("read at offset value", byte, 7);
+		ensure_equals("read past the end", mStore.getData(id, LLAssetType::AT_SOUND, &byte, 150, 1), 0);
+
+		std::vector<U8> too_much(5000, 1);
+		ensure_equals("write not truncated", mStore.storeData(id, LLAssetType::AT_SOUND, &too_much[0], 0, 5000), 4096);
+		checkFile("truncated write", id, 4096, 1);
+	}
+
+	// setMaxSize growth: in place into free space and by moving past a neighbour
+	template<> template<>
+	void vfs_mapped_test_object_t::test<3>()
+	{
+		ensure("open failed", open());
+		LLUUID first, second;
+		first.generate();
+		second.generate();
+
+		makeFile(first, 1024, 1024, 3);
+		ensure("grow into free space failed", mStore.setMaxSize(first, LLAssetType::AT_SOUND, 4096));
+		ensure_equals("grown max size", mStore.getMaxSize(first, LLAssetType::AT_SOUND), 4096);
+		checkFile("grown in place", first, 1024, 3);
+
+		// A neighbour right behind it forces the file to move.
+		makeFile(second, 2048, 2048, 9);
+		ensure("grow past neighbour failed", mStore.setMaxSize(first, LLAssetType::AT_SOUND, 64 * 1024));
+		ensure_equals("moved max size", mStore.getMaxSize(first, LLAssetType::AT_SOUND), 64 * 1024);
+		checkFile("moved file", first, 1024, 3);
+		checkFile("neighbour", second, 2048, 9);
+
+		ensure("shrink failed", mStore.setMaxSize(first, LLAssetType::AT_SOUND, 2048));
+		ensure_equals("shrunk max size", mStore.getMaxSize(first, LLAssetType::AT_SOUND), 2048);
+		checkFile("shrunk file", first, 1024, 3);
+	}
+
+	// rename over an existing file replaces it
+	template<> template<>
+	void vfs_mapped_test_object_t::test<4>()
+	{
+		ensure("open failed", open());
+		LLUUID source, target;
+		source.generate();
+		target.generate();
+		makeFile(source, 2048, 2000, 5);
+		makeFile(target, 1024, 1000, 6);
+
+		mStore.renameFile(source, LLAssetType::AT_SOUND, target, LLAssetType::AT_SOUND);
+		ensure("source still exists", !mStore.getExists(source, LLAssetType::AT_SOUND));
+		ensure_equals("target max size", mStore.getMaxSize(target, LLAssetType::AT_SOUND), 2048);
+		checkFile("renamed file", target, 2000, 5);
+
+		mStore.renameFile(target, LLAssetType::AT_SOUND, target, LLAssetType::AT_ANIMATION);
+		ensure("old type still exists", !mStore.getExists(target, LLAssetType::AT_SOUND));
+		ensure_equals("retyped size", mStore.getSize(target, LLAssetType::AT_ANIMATION), 2000);
+	}
+
+	// remove frees the space for other files
+	template<> template<>
+	void vfs_mapped_test_object_t::test<5>()
+	{
+		ensure("open failed", open());
+		std::vector<LLUUID> ids(4);
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			ids[i].generate();
+			makeFile(ids[i], DATA_SIZE / 4, 100, (U8)i);
+		}
+		ensure("store should be full", !mStore.checkAvailable(DATA_SIZE / 4));
+
+		mStore.removeFile(ids[1], LLAssetType::AT_SOUND);
+		ensure("removed file exists", !mStore.getExists(ids[1], LLAssetType::AT_SOUND));
+		ensure("removed space not available", mStore.checkAvailable(DATA_SIZE / 4));
+		for (U32 i = 0; i < ids.size(); ++i)
+		{
+			if (i != 1)
+			{
+				checkFile("remaining file", ids[i], 100, (U8)i);
+			}
+		}
+
+		LLVFS::file_size_map_t files;
+		mStore.getFileList(files);
+		ensure_equals("file list size", files.size(), (size_t)3);
+		ensure_equals("listed size", files[LLVFSFileSpecifier(ids[0], LLAssetType::AT_SOUND)], 100);
+	}
+
+	// reopen: the index and the data survive a clean close
+	template<> template<>
+	void vfs_mapped_test_object_t::test<6>()
+	{
+		ensure("open failed", open());
+		LLUUID kept, removed;
+		kept.generate();
+		removed.generate();
+		makeFile(kept, 4096, 3000, 11);
+		makeFile(removed, 4096, 3000, 12);
+		mStore.removeFile(removed, LLAssetType::AT_SOUND);
+		mStore.close();
+
+		ensure("reopen failed", open());
+		checkFile("reopened file", kept, 3000, 11);
+		ensure("removed file came back", !mStore.getExists(removed, LLAssetType::AT_SOUND));
+
+		// New files are placed by the free list rebuilt from the index.
+		LLUUID added;
+		added.generate();
+		makeFile(added, 4096, 4096, 13);
+		checkFile("file added after reopen", added, 4096, 13);
+		checkFile("file kept after reopen", kept, 3000, 11);
+	}
+
+	// read only: lookups on a read only index work and leave it alone
+	template<> template<>
+	void vfs_mapped_test_object_t::test<7>()
+	{
+		ensure("open failed", open());
+		LLUUID id, missing;
+		id.generate();
+		missing.generate();
+		makeFile(id, 4096, 3000, 21);
+		mStore.close();
+
+		llstat stat_data;
+		LLFile::stat(mIndexFilename, &stat_data);
+		std::vector<U8> index(stat_data.st_size);
+		LLFILE* fp = LLFile::fopen(mIndexFilename, "rb");
+		ensure("reading index failed", fp && fread(&index[0], 1, index.size(), fp) == index.size());
+		LLFile::close(fp);
+
+		// A lookup in a later second than the write would record the access.
+		ms_sleep(1100);
+		ensure("read only open failed", mStore.open(mIndexFilename, mDataFilename, TRUE, DATA_SIZE, FALSE));
+		ensure("file missing", mStore.getExists(id, LLAssetType::AT_SOUND));
+		ensure_equals("max size", mStore.getMaxSize(id, LLAssetType::AT_SOUND), 4096);
+		checkFile("read only file", id, 3000, 21);
+		ensure("missing file found", !mStore.getExists(missing, LLAssetType::AT_SOUND));
+		mStore.close();
+
+		std::vector<U8> after(index.size());
+		fp = LLFile::fopen(mIndexFilename, "rb");
+		ensure("rereading index failed", fp && fread(&after[0], 1, after.size(), fp) == after.size());
+		LLFile::close(fp);
+		ensure("read only index changed", index == after);
+	}
+}
@@ -0,0 +1,129 @@
+/**
+ * @file llvolumemgr_tut.cpp
+ * @brief Tests for building volume LODs on a thread pool.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+#include <tut/tut.hpp>
+#include "linden_common.h"
+#include "llthreadpool.h"
+#include "lltimer.h"
+#include "llvolumemgr.h"
+#include "lltut.h"
+
+namespace tut
+{
+	struct volume_mgr_test
+	{
+		volume_mgr_test() : mPool("Volume build test", 2)
+		{
+			mParams.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+			mMgr.setBuildPool(&mPool);
+		}
+
+		~volume_mgr_test()
+		{
+			mMgr.setBuildPool(NULL);
+		}
+
+		// Installs finished builds until detail is no longer pending, or
+		// gives up after ten seconds.
+		bool waitForBuild(S32 detail)
+		{
+			for (S32 i = 0; i < 1000 && mMgr.isBuildPending(mParams, detail); ++i)
+			{
+				ms_sleep(10);
+				mMgr.updateBuilds();
+			}
+			return !mMgr.isBuildPending(mParams, detail);
+		}
+
+		LLThreadPool mPool;
+		LLVolumeMgr mMgr;
+		LLVolumeParams mParams;
+	};
+	typedef test_group<volume_mgr_test> volume_mgr_test_t;
+	typedef volume_mgr_test_t::object volume_mgr_test_object_t;
+	tut::volume_mgr_test_t tut_volume_mgr_test("llvolumemgr");
+
+	// a missing LOD is built on the pool while the lowest LOD stands in
+	template<> template<>
+	void volume_mgr_test_object_t::test<1>()
+	{
+		LLVolume* stand_in = mMgr.refVolume(mParams, 3, true);
+		ensure_equals("stand-in detail", stand_in->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(0));
+		ensure("build pending", mMgr.isBuildPending(mParams, 3));
+		ensure("build finished", waitForBuild(3));
+
+		LLVolume* built = mMgr.refVolume(mParams, 3, true);
+		ensure_equals("built detail", built->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure("built faces", built->getNumVolumeFaces() > 0);
+
+		LLPointer<LLVolume> in_place = new LLVolume(mParams, LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure_equals("same faces as in place", built->getNumVolumeFaces(), in_place->getNumVolumeFaces());
+		ensure_equals("same vertices as in place", built->getVolumeFace(0).mNumVertices, in_place->getVolumeFace(0).mNumVertices);
+
+		mMgr.unrefVolume(built);
+		mMgr.unrefVolume(stand_in);
+	}
+
+	// the closest existing LOD stands in while the build runs
+	template<> template<>
+	void volume_mgr_test_object_t::test<2>()
+	{
+		LLVolume* high = mMgr.refVolume(mParams, 3);
+		ensure_equals("built in place", high->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+
+		LLVolume* stand_in = mMgr.refVolume(mParams, 2, true);
+		ensure_equals("higher LOD stands in", stand_in->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		LLVolume* again = mMgr.refVolume(mParams, 2, true);
+		ensure_equals("still standing in", again->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(3));
+		ensure("build finished", waitForBuild(2));
+
+		LLVolume* built = mMgr.refVolume(mParams, 2, true);
+		ensure_equals("built detail", built->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+
+		mMgr.unrefVolume(built);
+		mMgr.unrefVolume(again);
+		mMgr.unrefVolume(stand_in);
+		mMgr.unrefVolume(high);
+	}
+
+	// clearing the pool installs the builds it still had
+	template<> template<>
+	void volume_mgr_test_object_t::test<3>()
+	{
+		LLVolume* stand_in = mMgr.refVolume(mParams, 1, true);
+		ensure("build pending", mMgr.isBuildPending(mParams, 1));
+		mMgr.setBuildPool(NULL);
+		ensure("no longer pending", !mMgr.isBuildPending(mParams, 1));
+		ensure("installed", mMgr.getGroup(mParams)->hasLOD(1));
+
+		// Without a pool, missing LODs are built in place.
+		LLVolume* in_place = mMgr.refVolume(mParams, 2, true);
+		ensure_equals("built in place", in_place->getDetail(), LLVolumeLODGroup::getVolumeScaleFromDetail(2));
+		ensure("nothing pending", !mMgr.isBuildPending(mParams, 2));
+
+		mMgr.unrefVolume(in_place);
+		mMgr.unrefVolume(stand_in);
+	}
+}
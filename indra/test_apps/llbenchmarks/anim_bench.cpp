@@ -0,0 +1,538 @@
+/**
+ * @file anim_bench.cpp
+ * @brief Times replaying keyframe animations on synthetic avatar skeletons.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: anim_bench [--avatars <count>] [--anim <file.anim>]...
+//
+// Builds --avatars skeletons shaped like the avatar one, 26 bones each with
+// a collision volume and an attachment point, and plays two animations on
+// every avatar: the curves of each are sampled into joint states, blended
+// per joint with LLJointStateBlender and the world matrices are updated.
+// The animations are read from the --anim files (version 1.0 keyframe
+// files) or made up when none are given. A frame is timed with the world
+// matrices updated by LLJoint::updateWorldMatrixChildren() and with
+// LLFlatSkeleton; the world matrix update alone is timed for both too. The
+// largest world matrix difference between the two is printed first.
+
+#include "linden_common.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "llbenchmark.h"
+#include "llflatskeleton.h"
+#include "lljoint.h"
+#include "lljointstate.h"
+#include "llmath.h"
+#include "llpose.h"
+#include "llquantize.h"
+#include "llquaternion.h"
+#include "llrand.h"
+#include "v3math.h"
+
+struct BoneDesc
+{
+	const char* mName;
+	S32 mParent;
+	F32 mPosition[3];
+};
+
+static const BoneDesc BONES[] =
+{
+	{ "mPelvis", -1, { 0.f, 0.f, 1.067f } },
+	{ "mTorso", 0, { 0.f, 0.f, 0.084f } },
+	{ "mChest", 1, { -0.015f, 0.f, 0.205f } },
+	{ "mNeck", 2, { -0.01f, 0.f, 0.251f } },
+	{ "mHead", 3, { 0.f, 0.f, 0.076f } },
+	{ "mSkull", 4, { 0.f, 0.f, 0.079f } },
+	{ "mEyeRight", 4, { 0.098f, -0.036f, 0.079f } },
+	{ "mEyeLeft", 4, { 0.098f, 0.036f, 0.079f } },
+	{ "mCollarLeft", 2, { -0.021f, 0.085f, 0.165f } },
+	{ "mShoulderLeft", 8, { 0.f, 0.079f, 0.f } },
+	{ "mElbowLeft", 9, { 0.f, 0.248f, 0.f } },
+	{ "mWristLeft", 10, { 0.f, 0.205f, 0.f } },
+	{ "mCollarRight", 2, { -0.021f, -0.085f, 0.165f } },
+	{ "mShoulderRight", 12, { 0.f, -0.079f, 0.f } },
+	{ "mElbowRight", 13, { 0.f, -0.248f, 0.f } },
+	{ "mWristRight", 14, { 0.f, -0.205f, 0.f } },
+	{ "mHipRight", 0, { 0.034f, -0.129f, -0.041f } },
+	{ "mKneeRight", 16, { -0.001f, 0.049f, -0.491f } },
+	{ "mAnkleRight", 17, { -0.029f, 0.f, -0.468f } },
+	{ "mFootRight", 18, { 0.112f, 0.f, -0.061f } },
+	{ "mToeRight", 19, { 0.109f, 0.f, 0.f } },
+	{ "mHipLeft", 0, { 0.034f, 0.127f, -0.041f } },
+	{ "mKneeLeft", 21, { -0.001f, -0.046f, -0.491f } },
+	{ "mAnkleLeft", 22, { -0.029f, 0.001f, -0.468f } },
+	{ "mFootLeft", 23, { 0.112f, 0.f, -0.061f } },
+	{ "mToeLeft", 24, { 0.109f, 0.f, 0.f } },
+};
+static const U32 BONE_COUNT = LL_ARRAY_SIZE(BONES);
+
+struct RotationKey
+{
+	F32 mTime;
+	LLQuaternion mRotation;
+};
+
+struct PositionKey
+{
+	F32 mTime;
+	LLVector3 mPosition;
+};
+
+struct JointCurves
+{
+	S32 mBone;
+	S32 mPriority;
+	std::vector<RotationKey> mRotationKeys;
+	std::vector<PositionKey> mPositionKeys;
+};
+
+struct Animation
+{
+	S32 mPriority;
+	F32 mDuration;
+	std::vector<JointCurves> mJoints;
+};
+
+class AnimReader
+{
+public:
+	AnimReader(const std::vector<U8>& data) : mData(data), mOffset(0), mFailed(false) { }
+
+	bool failed() const { return mFailed; }
+
+	void read(void* value, U32 size)
+	{
+		if (mOffset + size > mData.size())
+		{
+			mFailed = true;
+			memset(value, 0, size);
+			return;
+		}
+		memcpy(value, &mData[mOffset], size);
+		mOffset += size;
+	}
+	U16 readU16() { U16 value; read(&value, sizeof(value)); return value; }
+	S32 readS32() { S32 value; read(&value, sizeof(value)); return value; }
+	F32 readF32() { F32 value; read(&value, sizeof(value)); return value; }
+	std::string readString()
+	{
+		std::string value;
+		while (mOffset < mData.size() && mData[mOffset])
+		{
+			value += (char)mData[mOffset++];
+		}
+		mFailed |= mOffset >= mData.size();
+		mOffset++;
+		return value;
+	}
+
+private:
+	const std::vector<U8>& mData;
+	U32 mOffset;
+	bool mFailed;
+};
+
+static S32 find_bone(const std::string& name)
+{
+	for (U32 i = 0; i < BONE_COUNT; ++i)
+	{
+		if (name == BONES[i].mName)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+// Reads the curves of a version 1.0 keyframe file, in the layout of
+// LLKeyframeMotion::serialize(). Joints that aren't bones are skipped.
+static bool read_animation(const std::vector<U8>& data, Animation& anim)
+{
+	AnimReader reader(data);
+	U16 version = reader.readU16();
+	U16 sub_version = reader.readU16();
+	if (version != 1 || sub_version != 0)
+	{
+		return false;
+	}
+	anim.mPriority = llclamp(reader.readS32(), (S32)LLJoint::LOW_PRIORITY, (S32)LLJoint::HIGHEST_PRIORITY);
+	anim.mDuration = reader.readF32();
+	reader.readString();	// emote name
+	reader.readF32();		// loop in point
+	reader.readF32();		// loop out point
+	reader.readS32();		// loop
+	reader.readF32();		// ease in duration
+	reader.readF32();		// ease out duration
+	reader.readS32();		// hand pose
+	S32 joint_count = reader.readS32();
+	if (reader.failed() || anim.mDuration <= 0.f || joint_count < 0)
+	{
+		return false;
+	}
+	for (S32 j = 0; j < joint_count && !reader.failed(); ++j)
+	{
+		JointCurves curves;
+		curves.mBone = find_bone(reader.readString());
+		curves.mPriority = reader.readS32();
+		S32 key_count = reader.readS32();
+		for (S32 k = 0; k < key_count && !reader.failed(); ++k)
+		{
+			RotationKey key;
+			key.mTime = U16_to_F32(reader.readU16(), 0.f, anim.mDuration);
+			LLVector3 rot_vec;
+			rot_vec.mV[VX] = U16_to_F32(reader.readU16(), -1.f, 1.f);
+			rot_vec.mV[VY] = U16_to_F32(reader.readU16(), -1.f, 1.f);
+			rot_vec.mV[VZ] = U16_to_F32(reader.readU16(), -1.f, 1.f);
+			key.mRotation.unpackFromVector3(rot_vec);
+			curves.mRotationKeys.push_back(key);
+		}
+		key_count = reader.readS32();
+		for (S32 k = 0; k < key_count && !reader.failed(); ++k)
+		{
+			PositionKey key;
+			key.mTime = U16_to_F32(reader.readU16(), 0.f, anim.mDuration);
+			key.mPosition.mV[VX] = U16_to_F32(reader.readU16(), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			key.mPosition.mV[VY] = U16_to_F32(reader.readU16(), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			key.mPosition.mV[VZ] = U16_to_F32(reader.readU16(), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			curves.mPositionKeys.push_back(key);
+		}
+		if (curves.mBone >= 0 && (!curves.mRotationKeys.empty() || !curves.mPositionKeys.empty()))
+		{
+			anim.mJoints.push_back(curves);
+		}
+	}
+	return !reader.failed() && !anim.mJoints.empty();
+}
+
+static void make_animation(Animation& anim)
+{
+	anim.mPriority = ll_rand(LLJoint::HIGHEST_PRIORITY + 1);
+	anim.mDuration = 2.f + ll_frand(4.f);
+	for (U32 b = 0; b < BONE_COUNT; ++b)
+	{
+		JointCurves curves;
+		curves.mBone = b;
+		curves.mPriority = LLJoint::USE_MOTION_PRIORITY;
+		const U32 KEY_COUNT = 12;
+		for (U32 k = 0; k < KEY_COUNT; ++k)
+		{
+			RotationKey key;
+			key.mTime = anim.mDuration * k / (KEY_COUNT - 1);
+			LLVector3 axis(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+			key.mRotation = LLQuaternion(ll_frand(0.8f) - 0.4f, axis + LLVector3(0.f, 0.f, 0.01f));
+			curves.mRotationKeys.push_back(key);
+			if (b == 0)
+			{
+				PositionKey pos_key;
+				pos_key.mTime = key.mTime;
+				pos_key.mPosition.setVec(ll_frand(0.2f) - 0.1f, ll_frand(0.2f) - 0.1f, ll_frand(0.1f));
+				curves.mPositionKeys.push_back(pos_key);
+			}
+		}
+		anim.mJoints.push_back(curves);
+	}
+}
+
+template <class Key>
+static U32 find_key(const std::vector<Key>& keys, F32 time)
+{
+	U32 k = 0;
+	while (k + 2 < keys.size() && keys[k + 1].mTime <= time)
+	{
+		++k;
+	}
+	return k;
+}
+
+static F32 key_fraction(F32 time, F32 start, F32 end)
+{
+	return end > start ? llclamp((time - start) / (end - start), 0.f, 1.f) : 0.f;
+}
+
+static LLQuaternion sample_rotation(const std::vector<RotationKey>& keys, F32 time)
+{
+	if (keys.size() == 1)
+	{
+		return keys[0].mRotation;
+	}
+	U32 k = find_key(keys, time);
+	return nlerp(key_fraction(time, keys[k].mTime, keys[k + 1].mTime), keys[k].mRotation, keys[k + 1].mRotation);
+}
+
+static LLVector3 sample_position(const std::vector<PositionKey>& keys, F32 time)
+{
+	if (keys.size() == 1)
+	{
+		return keys[0].mPosition;
+	}
+	U32 k = find_key(keys, time);
+	return lerp(keys[k].mPosition, keys[k + 1].mPosition, key_fraction(time, keys[k].mTime, keys[k + 1].mTime));
+}
+
+struct Avatar
+{
+	Avatar(const std::vector<Animation>& anims, U32 first_anim, const LLVector3& position, F32 phase)
+	{
+		mRoot = new LLJoint();
+		mRoot->setup("mRoot");
+		mRoot->setPosition(position);
+		for (U32 b = 0; b < BONE_COUNT; ++b)
+		{
+			LLJoint* bone = new LLJoint();
+			bone->setup(BONES[b].mName, BONES[b].mParent < 0 ? mRoot : mBones[BONES[b].mParent]);
+			bone->setPosition(LLVector3(BONES[b].mPosition));
+			mBones.push_back(bone);
+
+			LLJoint* volume = new LLJoint();
+			volume->setup(std::string(BONES[b].mName) + "Volume", bone);
+			volume->setScale(LLVector3(0.1f, 0.1f, 0.1f));
+			mExtras.push_back(volume);
+
+			LLJoint* attachment = new LLJoint();
+			attachment->setup(std::string(BONES[b].mName) + "Attachment", bone);
+			attachment->setPosition(LLVector3(0.05f, 0.f, 0.f));
+			mExtras.push_back(attachment);
+		}
+		mBlenders.resize(BONE_COUNT);
+
+		// the second animation is half blended in, as when one fades in
+		for (U32 a = 0; a < 2; ++a)
+		{
+			const Animation& anim = anims[(first_anim + a) % anims.size()];
+			mAnimations.push_back(&anim);
+			mTimeOffsets.push_back(phase * anim.mDuration);
+			mStates.push_back(std::vector<LLPointer<LLJointState> >());
+			for (U32 j = 0; j < anim.mJoints.size(); ++j)
+			{
+				LLJointState* state = new LLJointState(mBones[anim.mJoints[j].mBone]);
+				state->setUsage((anim.mJoints[j].mRotationKeys.empty() ? 0 : LLJointState::ROT) |
+								(anim.mJoints[j].mPositionKeys.empty() ? 0 : LLJointState::POS));
+				state->setWeight(a ? 0.5f : 1.f);
+				mStates.back().push_back(state);
+			}
+		}
+	}
+
+	~Avatar()
+	{
+		delete mRoot;
+		for (U32 i = 0; i < mBones.size(); ++i)
+		{
+			delete mBones[i];
+		}
+		for (U32 i = 0; i < mExtras.size(); ++i)
+		{
+			delete mExtras[i];
+		}
+	}
+
+	void sampleAndBlend(F32 time)
+	{
+		for (U32 a = 0; a < mAnimations.size(); ++a)
+		{
+			const Animation& anim = *mAnimations[a];
+			F32 anim_time = fmodf(time + mTimeOffsets[a], anim.mDuration);
+			for (U32 j = 0; j < anim.mJoints.size(); ++j)
+			{
+				const JointCurves& curves = anim.mJoints[j];
+				LLJointState* state = mStates[a][j];
+				if (!curves.mRotationKeys.empty())
+				{
+					state->setRotation(sample_rotation(curves.mRotationKeys, anim_time));
+				}
+				if (!curves.mPositionKeys.empty())
+				{
+					state->setPosition(sample_position(curves.mPositionKeys, anim_time));
+				}
+				S32 priority = curves.mPriority == LLJoint::USE_MOTION_PRIORITY ? anim.mPriority : curves.mPriority;
+				mBlenders[curves.mBone].addJointState(state, priority + a, FALSE);
+			}
+		}
+		for (U32 b = 0; b < BONE_COUNT; ++b)
+		{
+			mBlenders[b].blendJointStates();
+		}
+	}
+
+	LLJoint* mRoot;
+	std::vector<LLJoint*> mBones;
+	std::vector<LLJoint*> mExtras;
+	std::vector<LLJointStateBlender> mBlenders;
+	std::vector<const Animation*> mAnimations;
+	std::vector<F32> mTimeOffsets;
+	std::vector<std::vector<LLPointer<LLJointState> > > mStates;
+	LLFlatSkeleton mFlatSkeleton;
+};
+
+static const F32 FRAME_TIME = 1.f / 45.f;
+
+struct Frame
+{
+	Frame(std::vector<Avatar*>& avatars, bool flat) : mAvatars(avatars), mFlat(flat), mTime(0.f) { }
+	void operator()()
+	{
+		mTime += FRAME_TIME;
+		for (U32 i = 0; i < mAvatars.size(); ++i)
+		{
+			Avatar* avatar = mAvatars[i];
+			avatar->sampleAndBlend(mTime);
+			if (mFlat)
+			{
+				avatar->mFlatSkeleton.updateWorldMatrices(avatar->mRoot);
+			}
+			else
+			{
+				avatar->mRoot->updateWorldMatrixChildren();
+			}
+		}
+		gBenchmarkSink += mAvatars.size();
+	}
+	std::vector<Avatar*>& mAvatars;
+	bool mFlat;
+	F32 mTime;
+};
+
+// Moves every avatar, so that all of its world matrices are updated.
+struct WorldMatrices
+{
+	WorldMatrices(std::vector<Avatar*>& avatars, bool flat) : mAvatars(avatars), mFlat(flat) { }
+	void operator()()
+	{
+		for (U32 i = 0; i < mAvatars.size(); ++i)
+		{
+			Avatar* avatar = mAvatars[i];
+			avatar->mRoot->setPosition(avatar->mRoot->getPosition() + LLVector3(0.01f, 0.f, 0.f));
+			if (mFlat)
+			{
+				avatar->mFlatSkeleton.updateWorldMatrices(avatar->mRoot);
+			}
+			else
+			{
+				avatar->mRoot->updateWorldMatrixChildren();
+			}
+		}
+		gBenchmarkSink += mAvatars.size();
+	}
+	std::vector<Avatar*>& mAvatars;
+	bool mFlat;
+};
+
+static F32 max_matrix_difference(const std::vector<Avatar*>& a, const std::vector<Avatar*>& b)
+{
+	F32 max_diff = 0.f;
+	for (U32 i = 0; i < a.size(); ++i)
+	{
+		std::vector<LLJoint*> joints_a(a[i]->mBones);
+		joints_a.insert(joints_a.end(), a[i]->mExtras.begin(), a[i]->mExtras.end());
+		std::vector<LLJoint*> joints_b(b[i]->mBones);
+		joints_b.insert(joints_b.end(), b[i]->mExtras.begin(), b[i]->mExtras.end());
+		for (U32 j = 0; j < joints_a.size(); ++j)
+		{
+			const LLMatrix4& ma = joints_a[j]->getXform()->getWorldMatrix();
+			const LLMatrix4& mb = joints_b[j]->getXform()->getWorldMatrix();
+			for (U32 r = 0; r < 4; ++r)
+			{
+				for (U32 c = 0; c < 4; ++c)
+				{
+					max_diff = llmax(max_diff, fabsf(ma.mMatrix[r][c] - mb.mMatrix[r][c]));
+				}
+			}
+		}
+	}
+	return max_diff;
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	U32 avatar_count = 60;
+	std::vector<Animation> anims;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--avatars")
+		{
+			avatar_count = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--anim")
+		{
+			std::vector<U8> data;
+			Animation anim;
+			if (!ll_benchmark_load_file(argv[i + 1], data) || !read_animation(data, anim))
+			{
+				printf("Couldn't read %s\n", argv[i + 1]);
+				return 1;
+			}
+			anims.push_back(anim);
+		}
+	}
+	if (anims.empty())
+	{
+		for (U32 i = 0; i < 8; ++i)
+		{
+			anims.push_back(Animation());
+			make_animation(anims.back());
+		}
+	}
+
+	std::vector<Avatar*> recursive_avatars;
+	std::vector<Avatar*> flat_avatars;
+	for (U32 i = 0; i < avatar_count; ++i)
+	{
+		LLVector3 position(ll_frand(256.f), ll_frand(256.f), 20.f + ll_frand(10.f));
+		F32 phase = ll_frand();
+		recursive_avatars.push_back(new Avatar(anims, i, position, phase));
+		flat_avatars.push_back(new Avatar(anims, i, position, phase));
+	}
+	printf("%u avatars of %u joints, %u animations\n", avatar_count,
+		   (U32)(1 + BONE_COUNT + recursive_avatars[0]->mExtras.size()), (U32)anims.size());
+
+	Frame recursive_frame(recursive_avatars, false);
+	Frame flat_frame(flat_avatars, true);
+	recursive_frame();
+	flat_frame();
+	printf("largest world matrix difference %g\n", max_matrix_difference(recursive_avatars, flat_avatars));
+
+	F64 recursive_seconds = ll_benchmark("frame, recursive update", recursive_frame);
+	F64 flat_seconds = ll_benchmark("frame, flat skeleton", flat_frame);
+	printf("  %.2fx faster\n", recursive_seconds / flat_seconds);
+
+	WorldMatrices recursive_matrices(recursive_avatars, false);
+	WorldMatrices flat_matrices(flat_avatars, true);
+	recursive_seconds = ll_benchmark("world matrices, recursive update", recursive_matrices);
+	flat_seconds = ll_benchmark("world matrices, flat skeleton", flat_matrices);
+	printf("  %.2fx faster\n", recursive_seconds / flat_seconds);
+
+	for (U32 i = 0; i < avatar_count; ++i)
+	{
+		delete recursive_avatars[i];
+		delete flat_avatars[i];
+	}
+	return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * @file invcache_bench.cpp
+ * @brief Compares loading the text and the binary inventory cache.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Usage: invcache_bench [--items <count>] [--folders <count>] [--threads <count>]
+//
+// An inventory of the given size (150000 items in 2000 folders by default)
+// is generated and written once in each format to the temporary
+// directory. Each pass then loads a cache the way LLInventoryModel does
+// and puts every item into the item array of its folder, like
+// buildParentChildMap(). The text cache is read uncompressed, so the
+// gunzip that precedes it at login is not counted.
+
+#include "linden_common.h"
+
+#include <cstdio>
+#include <map>
+
+#include "llbenchmark.h"
+#include "llfile.h"
+#include "llformat.h"
+#include "llinventory.h"
+#include "llinventorycache.h"
+#include "llpermissionsflags.h"
+#include "llthreadpool.h"
+
+typedef std::vector<LLPointer<LLInventoryItem> > item_vec_t;
+typedef std::map<LLUUID, item_vec_t> folder_map_t;
+
+static void make_inventory(S32 item_count, S32 folder_count,
+						   std::vector<LLPointer<LLInventoryCategory> >& folders, item_vec_t& items)
+{
+	LLUUID owner_id = LLUUID::generateNewID();
+	LLUUID root_id = LLUUID::generateNewID();
+	folders.push_back(new LLInventoryCategory(root_id, LLUUID::null, LLFolderType::FT_ROOT_INVENTORY, "My Inventory"));
+	for (S32 i = 1; i < folder_count; ++i)
+	{
+		folders.push_back(new LLInventoryCategory(LLUUID::generateNewID(), root_id, LLFolderType::FT_NONE,
+												  llformat("Folder %d", i)));
+	}
+
+	LLPermissions perm;
+	perm.init(owner_id, owner_id, owner_id, LLUUID::null);
+	perm.initMasks(PERM_ALL, PERM_ALL, PERM_NONE, PERM_NONE, PERM_MOVE | PERM_TRANSFER);
+	for (S32 i = 0; i < item_count; ++i)
+	{
+		// Hand out items round robin so that the cache isn't already
+		// sorted by folder.
+		const LLUUID& parent_id = folders[i % folder_count]->getUUID();
+		items.push_back(new LLInventoryItem(LLUUID::generateNewID(), parent_id, perm, LLUUID::generateNewID(),
+											LLAssetType::AT_OBJECT, LLInventoryType::IT_OBJECT,
+											llformat("Item number %d with a typical length name", i),
+											(i % 3) ? "(No Description)" : "A longer description that somebody bothered to type in",
+											LLSaleInfo(LLSaleInfo::FS_NOT, 10), 0, 1357000000 + i));
+	}
+}
+
+static bool write_text_cache(const std::string& filename,
+							 const std::vector<LLPointer<LLInventoryCategory> >& folders, const item_vec_t& items)
+{
+	LLFILE* fp = LLFile::fopen(filename, "wb");
+	if (!fp)
+	{
+		return false;
+	}
+	fprintf(fp, "\tinv_cache_version\t2\n");
+	for (U32 i = 0; i < (U32)folders.size(); ++i)
+	{
+		folders[i]->exportFile(fp);
+	}
+	for (U32 i = 0; i < (U32)items.size(); ++i)
+	{
+		items[i]->exportFile(fp);
+	}
+	fclose(fp);
+	return true;
+}
+
+static bool write_binary_cache(const std::string& filename,
+							   const std::vector<LLPointer<LLInventoryCategory> >& folders, const item_vec_t& items)
+{
+	LLInventoryCacheWriter writer;
+	for (U32 i = 0; i < (U32)folders.size(); ++i)
+	{
+		const LLInventoryCategory* cat = folders[i];
+		writer.addCategory(cat->getUUID(), cat->getParentUUID(), LLUUID::null, 1,
+						   cat->getPreferredType(), cat->getName());
+	}
+	for (U32 i = 0; i < (U32)items.size(); ++i)
+	{
+		writer.addItem(*items[i]);
+	}
+	return writer.write(filename);
+}
+
+// The loop of LLInventoryModel::loadFromFile(), followed by one map
+// lookup per item.
+static void load_text_cache(const std::string& filename, folder_map_t& folders)
+{
+	folders.clear();
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (!fp)
+	{
+		return;
+	}
+	char buffer[MAX_STRING];		/*Flawfinder: ignore*/
+	char keyword[MAX_STRING];		/*Flawfinder: ignore*/
+	char value[MAX_STRING];			/*Flawfinder: ignore*/
+	item_vec_t items;
+	while (!feof(fp) && fgets(buffer, MAX_STRING, fp))
+	{
+		sscanf(buffer, " %126s %126s", keyword, value);	/* Flawfinder: ignore */
+		if (!strcmp("inv_category", keyword))
+		{
+			LLPointer<LLInventoryCategory> cat = new LLInventoryCategory;
+			if (cat->importFile(fp))
+			{
+				folders[cat->getUUID()];
+			}
+		}
+		else if (!strcmp("inv_item", keyword))
+		{
+			LLPointer<LLInventoryItem> item = new LLInventoryItem;
+			if (item->importFile(fp))
+			{
+				items.push_back(item);
+			}
+		}
+	}
+	fclose(fp);
+
+	for (U32 i = 0; i < (U32)items.size(); ++i)
+	{
+		folders[items[i]->getParentUUID()].push_back(items[i]);
+	}
+}
+
+class LLBenchItemFactory : public LLInventoryCacheReader::ItemFactory
+{
+public:
+	/*virtual*/ LLInventoryItem* createItem() const		{ return new LLInventoryItem; }
+};
+
+// LLInventoryModel::loadFromBinaryFile() and loadSkeleton(): decode all
+// items, then one lookup per folder.
+static void load_binary_cache(const std::string& filename, LLThreadPool* pool, folder_map_t& folders)
+{
+	folders.clear();
+	LLInventoryCacheReader reader;
+	if (!reader.open(filename))
+	{
+		return;
+	}
+	for (S32 i = 0; i < reader.getNumCategories(); ++i)
+	{
+		LLPointer<LLInventoryCategory> cat = new LLInventoryCategory(reader.getCategory(i).mID,
+																	 reader.getCategory(i).mParentID,
+																	 (LLFolderType::EType)reader.getCategory(i).mPreferredType,
+																	 reader.getString(reader.getCategory(i).mName));
+		folders[cat->getUUID()];
+	}
+	item_vec_t items;
+	reader.decodeItems(LLBenchItemFactory(), items, pool);
+	for (S32 i = 0; i < reader.getNumGroups(); ++i)
+	{
+		const LLInventoryCache::GroupRecord& group = reader.getGroup(i);
+		item_vec_t& folder = folders[group.mParentID];
+		folder.insert(folder.end(), items.begin() + group.mFirstItem,
+					  items.begin() + group.mFirstItem + group.mNumItems);
+	}
+}
+
+struct TextLoad
+{
+	TextLoad(const std::string& filename) : mFilename(filename) { }
+	void operator()()
+	{
+		folder_map_t folders;
+		load_text_cache(mFilename, folders);
+		gBenchmarkSink += folders.size();
+	}
+	std::string mFilename;
+};
+
+struct BinaryLoad
+{
+	BinaryLoad(const std::string& filename, LLThreadPool* pool) : mFilename(filename), mPool(pool) { }
+	void operator()()
+	{
+		folder_map_t folders;
+		load_binary_cache(mFilename, mPool, folders);
+		gBenchmarkSink += folders.size();
+	}
+	std::string mFilename;
+	LLThreadPool* mPool;
+};
+
+static bool same_item(const LLInventoryItem* a, const LLInventoryItem* b)
+{
+	return a->getUUID() == b->getUUID() &&
+		   a->getParentUUID() == b->getParentUUID() &&
+		   a->getAssetUUID() == b->getAssetUUID() &&
+		   a->getName() == b->getName() &&
+		   a->getDescription() == b->getDescription() &&
+		   a->getPermissions() == b->getPermissions() &&
+		   a->getSaleInfo() == b->getSaleInfo() &&
+		   a->getCreationDate() == b->getCreationDate();
+}
+
+// Both loaders have to produce the same folders holding the same items.
+static bool check_same(const std::string& text_filename, const std::string& binary_filename)
+{
+	folder_map_t text, binary;
+	load_text_cache(text_filename, text);
+	load_binary_cache(binary_filename, NULL, binary);
+	if (text.empty() || text.size() != binary.size())
+	{
+		return false;
+	}
+	for (folder_map_t::const_iterator iter = text.begin(); iter != text.end(); ++iter)
+	{
+		folder_map_t::const_iterator other = binary.find(iter->first);
+		if (other == binary.end() || other->second.size() != iter->second.size())
+		{
+			return false;
+		}
+		// Both keep the order in which items were written.
+		for (U32 i = 0; i < (U32)iter->second.size(); ++i)
+		{
+			if (!same_item(iter->second[i], other->second[i]))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	S32 item_count = 150000;
+	S32 folder_count = 2000;
+	U32 max_threads = 4;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--items")
+		{
+			item_count = llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--folders")
+		{
+			folder_count = llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--threads")
+		{
+			max_threads = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	std::vector<LLPointer<LLInventoryCategory> > folders;
+	item_vec_t items;
+	make_inventory(item_count, folder_count, folders, items);
+
+	std::string text_filename = std::string(LLFile::tmpdir()) + "invcache_bench.inv";
+	std::string binary_filename = std::string(LLFile::tmpdir()) + "invcache_bench.invb";
+	if (!write_text_cache(text_filename, folders, items) ||
+		!write_binary_cache(binary_filename, folders, items))
+	{
+		printf("Couldn't write the caches to %s\n", LLFile::tmpdir());
+		return 1;
+	}
+	items.clear();
+
+	llstat text_stat, binary_stat;
+	LLFile::stat(text_filename, &text_stat);
+	LLFile::stat(binary_filename, &binary_stat);
+	printf("%d items in %d folders: text cache %u KB, binary cache %u KB\n", item_count, folder_count,
+		   (U32)(text_stat.st_size / 1024), (U32)(binary_stat.st_size / 1024));
+
+	if (!check_same(text_filename, binary_filename))
+	{
+		printf("The caches don't load the same inventory\n");
+		LLFile::remove(text_filename);
+		LLFile::remove(binary_filename);
+		return 1;
+	}
+
+	TextLoad text_load(text_filename);
+	BinaryLoad binary_load(binary_filename, NULL);
+	F64 text_seconds = ll_benchmark("text cache", text_load, (F64)text_stat.st_size);
+	ll_benchmark("binary cache, 1 thread", binary_load, (F64)binary_stat.st_size);
+	for (U32 threads = 2; threads <= max_threads; threads *= 2)
+	{
+		LLThreadPool pool("invcache", threads);
+		BinaryLoad pool_load(binary_filename, &pool);
+		F64 seconds = ll_benchmark(llformat("binary cache, %u threads", threads), pool_load, (F64)binary_stat.st_size);
+		printf("  %.1fx faster than the text cache\n", text_seconds / seconds);
+	}
+
+	LLFile::remove(text_filename);
+	LLFile::remove(binary_filename);
+	return 0;
+}
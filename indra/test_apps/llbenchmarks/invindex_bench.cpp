@@ -0,0 +1,247 @@
+/**
+ * @file invindex_bench.cpp
+ * @brief Compares std::map and LLUUIDHashIndex as inventory model indices.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+// Usage: invindex_bench [--items <count>] [--folders <count>]
+//
+// Builds the indices LLInventoryModel keeps (id to folder, id to item and
+// folder id to child arrays) over a generated tree, 200000 items in 4000
+// folders by default, once with std::map and once with LLUUIDHashIndex.
+// It then times getItem() for every item in random order and a
+// collectDescendentsIf() over the whole tree.
+
+#include "linden_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#include "llbenchmark.h"
+#include "llpointer.h"
+#include "llrefcount.h"
+#include "lluuidhashindex.h"
+
+struct BenchObject : public LLRefCount
+{
+	BenchObject(const LLUUID& id, const LLUUID& parent_id) : mID(id), mParentID(parent_id) { }
+	LLUUID mID;
+	LLUUID mParentID;
+};
+
+typedef std::vector<LLPointer<BenchObject> > object_array_t;
+
+// The parts of LLInventoryModel that are looked up by id.
+template <template <class> class MAP>
+struct BenchModel
+{
+	typedef typename MAP<LLPointer<BenchObject> >::type object_map_t;
+	typedef typename MAP<object_array_t*>::type parent_map_t;
+
+	~BenchModel()
+	{
+		for (typename parent_map_t::iterator iter = mChildCats.begin(); iter != mChildCats.end(); ++iter)
+		{
+			delete iter->second;
+		}
+		for (typename parent_map_t::iterator iter = mChildItems.begin(); iter != mChildItems.end(); ++iter)
+		{
+			delete iter->second;
+		}
+	}
+
+	void addCategory(BenchObject* cat)
+	{
+		mCategories[cat->mID] = cat;
+		mChildCats[cat->mID] = new object_array_t;
+		mChildItems[cat->mID] = new object_array_t;
+		if (cat->mParentID.notNull())
+		{
+			mChildCats[cat->mParentID]->push_back(cat);
+		}
+	}
+
+	void addItem(BenchObject* item)
+	{
+		mItems[item->mID] = item;
+		mChildItems[item->mParentID]->push_back(item);
+	}
+
+	BenchObject* getItem(const LLUUID& id) const
+	{
+		typename object_map_t::const_iterator iter = mItems.find(id);
+		return iter != mItems.end() ? iter->second.get() : NULL;
+	}
+
+	// collectDescendentsIf() with a functor that takes everything.
+	void collectDescendents(const LLUUID& id, object_array_t& cats, object_array_t& items) const
+	{
+		typename parent_map_t::const_iterator cat_iter = mChildCats.find(id);
+		if (cat_iter != mChildCats.end())
+		{
+			const object_array_t& children = *cat_iter->second;
+			for (U32 i = 0; i < (U32)children.size(); ++i)
+			{
+				cats.push_back(children[i]);
+				collectDescendents(children[i]->mID, cats, items);
+			}
+		}
+		typename parent_map_t::const_iterator item_iter = mChildItems.find(id);
+		if (item_iter != mChildItems.end())
+		{
+			const object_array_t& children = *item_iter->second;
+			items.insert(items.end(), children.begin(), children.end());
+		}
+	}
+
+	object_map_t mCategories;
+	object_map_t mItems;
+	parent_map_t mChildCats;
+	parent_map_t mChildItems;
+};
+
+template <class T> struct StdMap { typedef std::map<LLUUID, T> type; };
+template <class T> struct HashIndex { typedef LLUUIDHashIndex<T> type; };
+
+static LLUUID random_id()
+{
+	LLUUID id;
+	id.generate();
+	return id;
+}
+
+// Every folder below the root has four subfolders until folder_count is
+// reached, items are spread over all of them.
+static void make_tree(S32 item_count, S32 folder_count, object_array_t& folders, object_array_t& items)
+{
+	folders.push_back(new BenchObject(random_id(), LLUUID::null));
+	for (S32 i = 1; i < folder_count; ++i)
+	{
+		S32 parent = i < 8 ? 0 : (i - 8) / 4 + 1;
+		folders.push_back(new BenchObject(random_id(), folders[llmin(parent, i - 1)]->mID));
+	}
+	for (S32 i = 0; i < item_count; ++i)
+	{
+		items.push_back(new BenchObject(random_id(), folders[i % folder_count]->mID));
+	}
+}
+
+template <class MODEL>
+struct GetItems
+{
+	GetItems(const MODEL& model, const std::vector<LLUUID>& ids) : mModel(model), mIDs(ids) { }
+	void operator()()
+	{
+		for (U32 i = 0; i < (U32)mIDs.size(); ++i)
+		{
+			gBenchmarkSink += mModel.getItem(mIDs[i]) != NULL;
+		}
+	}
+	const MODEL& mModel;
+	const std::vector<LLUUID>& mIDs;
+};
+
+template <class MODEL>
+struct CollectDescendents
+{
+	CollectDescendents(const MODEL& model, const LLUUID& root_id) : mModel(model), mRootID(root_id) { }
+	void operator()()
+	{
+		object_array_t cats, items;
+		mModel.collectDescendents(mRootID, cats, items);
+		gBenchmarkSink += cats.size() + items.size();
+	}
+	const MODEL& mModel;
+	LLUUID mRootID;
+};
+
+template <class MODEL>
+static void fill(MODEL& model, const object_array_t& folders, const object_array_t& items)
+{
+	for (U32 i = 0; i < (U32)folders.size(); ++i)
+	{
+		model.addCategory(folders[i]);
+	}
+	for (U32 i = 0; i < (U32)items.size(); ++i)
+	{
+		model.addItem(items[i]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	S32 item_count = 200000;
+	S32 folder_count = 4000;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--items")
+		{
+			item_count = llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--folders")
+		{
+			folder_count = llmax(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	object_array_t folders, items;
+	make_tree(item_count, folder_count, folders, items);
+	std::vector<LLUUID> ids;
+	for (U32 i = 0; i < (U32)items.size(); ++i)
+	{
+		ids.push_back(items[i]->mID);
+	}
+	std::random_shuffle(ids.begin(), ids.end());
+	const LLUUID& root_id = folders[0]->mID;
+
+	BenchModel<StdMap> map_model;
+	BenchModel<HashIndex> hash_model;
+	fill(map_model, folders, items);
+	fill(hash_model, folders, items);
+
+	object_array_t map_cats, map_items, hash_cats, hash_items;
+	map_model.collectDescendents(root_id, map_cats, map_items);
+	hash_model.collectDescendents(root_id, hash_cats, hash_items);
+	if (map_cats != hash_cats || map_items != hash_items || (S32)map_items.size() != item_count)
+	{
+		printf("The indices don't hold the same tree\n");
+		return 1;
+	}
+	printf("%d items in %d folders\n", item_count, folder_count);
+
+	GetItems<BenchModel<StdMap> > map_get(map_model, ids);
+	GetItems<BenchModel<HashIndex> > hash_get(hash_model, ids);
+	F64 map_seconds = ll_benchmark("getItem, std::map", map_get);
+	F64 hash_seconds = ll_benchmark("getItem, LLUUIDHashIndex", hash_get);
+	printf("  %.1fx faster, %.1f nsec per lookup\n", map_seconds / hash_seconds, hash_seconds * 1.0e9 / ids.size());
+
+	CollectDescendents<BenchModel<StdMap> > map_collect(map_model, root_id);
+	CollectDescendents<BenchModel<HashIndex> > hash_collect(hash_model, root_id);
+	map_seconds = ll_benchmark("collectDescendentsIf, std::map", map_collect);
+	hash_seconds = ll_benchmark("collectDescendentsIf, LLUUIDHashIndex", hash_collect);
+	printf("  %.1fx faster\n", map_seconds / hash_seconds);
+	return 0;
+}
@@ -0,0 +1,196 @@
+/**
+ * @file j2cdecode_bench.cpp
+ * @brief Measures JPEG2000 decode throughput for a range of decode thread counts.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: j2cdecode_bench <directory> [--threads <count>] [--discard <level>] [--repeat <count>]
+//
+// Decodes every .j2c file in the directory through an LLImageDecodeThread
+// running on a private LLThreadPool, at each discard level from 0 up to
+// --discard (default 3) and with 1, 2, 4 ... up to --threads decode threads
+// (default: one per core). The best of --repeat (default 3) passes is
+// reported per image, with the throughput counted in compressed bytes.
+
+#include "linden_common.h"
+
+#include <cstdio>
+
+#include "llbenchmark.h"
+#include "llcontrol.h"
+#include "lldir.h"
+#include "lldiriterator.h"
+#include "llformat.h"
+#include "llimage.h"
+#include "llimagej2c.h"
+#include "llimageworker.h"
+#include "llmemory.h"
+#include "llsys.h"
+#include "llthreadpool.h"
+
+// LLImageJ2C reads a setting from here.
+LLControlGroup gSavedSettings("Global");
+
+typedef std::vector<std::vector<U8> > file_list_t;
+
+class CountResponder : public LLImageDecodeThread::Responder
+{
+public:
+	CountResponder(LLAtomicU32& done, LLAtomicU32& failed) : mDone(done), mFailed(failed) { }
+	/*virtual*/ void completed(bool success, LLImageRaw* raw, LLImageRaw* aux)
+	{
+		if (!success)
+		{
+			mFailed++;
+		}
+		mDone++;
+	}
+
+private:
+	LLAtomicU32& mDone;
+	LLAtomicU32& mFailed;
+};
+
+// Decodes all files once at discard and returns the seconds it took.
+// Copying the files into images isn't timed.
+static F64 decode_all(LLImageDecodeThread& decoder, const file_list_t& files, S32 discard, U32& failed)
+{
+	std::vector<LLPointer<LLImageJ2C> > images;
+	for (file_list_t::const_iterator iter = files.begin(); iter != files.end(); ++iter)
+	{
+		LLPointer<LLImageJ2C> image = new LLImageJ2C;
+		memcpy(image->allocateData((S32)iter->size()), &(*iter)[0], iter->size());
+		images.push_back(image);
+	}
+
+	LLAtomicU32 done(0);
+	LLAtomicU32 fails(0);
+	LLTimer timer;
+	for (U32 i = 0; i < images.size(); ++i)
+	{
+		decoder.decodeImage(images[i], LLQueuedThread::PRIORITY_NORMAL, discard, FALSE,
+							new CountResponder(done, fails));
+	}
+	// update() turns the decodeImage() calls into requests, like the viewer does once a frame.
+	while (done < images.size())
+	{
+		decoder.update(0);
+		ms_sleep(1);
+	}
+	F64 seconds = timer.getElapsedTimeF64();
+	failed = fails;
+	return seconds;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <directory> [--threads <count>] [--discard <level>] [--repeat <count>]\n", argv[0]);
+		return 1;
+	}
+
+	ll_benchmark_init();
+	LLPrivateMemoryPoolManager::initClass(FALSE, 0);
+	LLImage::initClass();
+
+	U32 max_threads = llmax(gSysCPU.getCoreCount(), (U32)1);
+	S32 max_discard = 3;
+	U32 repeat = 3;
+	for (S32 i = 2; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--threads")
+		{
+			max_threads = llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--discard")
+		{
+			max_discard = llclamp(atoi(argv[i + 1]), 0, MAX_DISCARD_LEVEL);
+		}
+		else if (arg == "--repeat")
+		{
+			repeat = llmax(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	std::string dir = argv[1];
+	file_list_t files;
+	F64 total_bytes = 0.0;
+	LLDirIterator iter(dir, "*.j2c");
+	std::string name;
+	while (iter.next(name))
+	{
+		std::vector<U8> data;
+		if (ll_benchmark_load_file(dir + gDirUtilp->getDirDelimiter() + name, data))
+		{
+			total_bytes += data.size();
+			files.push_back(std::vector<U8>());
+			files.back().swap(data);
+		}
+	}
+	if (files.empty())
+	{
+		printf("No .j2c files found in %s\n", dir.c_str());
+		return 1;
+	}
+	printf("%u files, %.1f KB on average, %s\n", (U32)files.size(), total_bytes / files.size() / 1024.0,
+		   LLImageJ2C::getEngineInfo().c_str());
+
+	for (S32 discard = 0; discard <= max_discard; ++discard)
+	{
+		F64 single_thread_seconds = 0.0;
+		U32 threads = 1;
+		while (true)
+		{
+			LLThreadPool pool("j2cdecode", threads);
+			LLImageDecodeThread decoder(true, &pool, threads);
+			F64 best = 0.0;
+			U32 failed = 0;
+			for (U32 pass = 0; pass < repeat; ++pass)
+			{
+				F64 seconds = decode_all(decoder, files, discard, failed);
+				best = pass ? llmin(best, seconds) : seconds;
+			}
+			if (threads == 1)
+			{
+				single_thread_seconds = best;
+			}
+			ll_benchmark_report(llformat("discard %d, %u threads (%.2fx)", discard, threads, single_thread_seconds / best),
+								(U32)files.size(), best, total_bytes / files.size());
+			if (failed)
+			{
+				printf("  %u images failed to decode\n", failed);
+			}
+
+			if (threads == max_threads)
+			{
+				break;
+			}
+			threads = llmin(threads * 2, max_threads);
+		}
+	}
+
+	LLImage::cleanupClass();
+	return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file llbenchmark.cpp
+ * @brief Helpers shared by the micro benchmarks.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llbenchmark.h"
+
+#include <cstdio>
+
+#include "llaprpool.h"
+#include "llcommon.h"
+#include "llerrorcontrol.h"
+
+volatile U32 gBenchmarkSink = 0;
+
+void ll_benchmark_init()
+{
+	ll_init_apr();
+	LLCommon::initClass();
+
+	LLError::initForApplication(".");
+	LLError::setDefaultLevel(LLError::LEVEL_WARN);
+}
+
+bool ll_benchmark_load_file(const std::string& filename, std::vector<U8>& data)
+{
+	llifstream file(filename, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	if (size <= 0)
+	{
+		return false;
+	}
+	data.resize((size_t)size);
+	file.read((char*)&data[0], size);
+	return file.good();
+}
+
+void ll_benchmark_report(const std::string& name, U32 iterations, F64 seconds, F64 bytes_per_iteration)
+{
+	F64 usec = seconds * 1000000.0 / iterations;
+	if (bytes_per_iteration > 0.0)
+	{
+		F64 mb_per_sec = bytes_per_iteration * iterations / seconds / (1024.0 * 1024.0);
+		printf("%-48s %10u iterations %12.3f usec/iteration %10.1f MB/s\n",
+			   name.c_str(), iterations, usec, mb_per_sec);
+	}
+	else
+	{
+		printf("%-48s %10u iterations %12.3f usec/iteration\n",
+			   name.c_str(), iterations, usec);
+	}
+	fflush(stdout);
+}
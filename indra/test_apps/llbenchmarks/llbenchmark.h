@@ -0,0 +1,75 @@
+/**
+ * @file llbenchmark.h
+ * @brief Helpers shared by the micro benchmarks.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLBENCHMARK_H
+#define LL_LLBENCHMARK_H
+
+#include <string>
+#include <vector>
+#include "lltimer.h"
+
+// Sets up APR, timers and logging (warnings and up).
+void ll_benchmark_init();
+
+// Reads a whole file. Returns false when it can't be read.
+bool ll_benchmark_load_file(const std::string& filename, std::vector<U8>& data);
+
+// Prints one result line.
+void ll_benchmark_report(const std::string& name, U32 iterations, F64 seconds, F64 bytes_per_iteration = 0.0);
+
+// Results are added here so that the compiler can't drop the work.
+extern volatile U32 gBenchmarkSink;
+
+// Calls body() repeatedly, doubling the number of calls until one batch
+// takes at least min_seconds, and reports the time per call of that batch.
+// Returns the seconds per call.
+template <class Body>
+F64 ll_benchmark(const std::string& name, Body& body, F64 bytes_per_iteration = 0.0, F64 min_seconds = 0.5)
+{
+	body(); // warm up caches and allocators
+
+	U32 iterations = 1;
+	F64 elapsed = 0.0;
+	while (true)
+	{
+		LLTimer timer;
+		for (U32 i = 0; i < iterations; ++i)
+		{
+			body();
+		}
+		elapsed = timer.getElapsedTimeF64();
+		if (elapsed >= min_seconds || iterations >= (1U << 30))
+		{
+			break;
+		}
+		iterations *= 2;
+	}
+
+	ll_benchmark_report(name, iterations, elapsed, bytes_per_iteration);
+	return elapsed / iterations;
+}
+
+#endif // LL_LLBENCHMARK_H
@@ -0,0 +1,308 @@
+/**
+ * @file llsdview_bench.cpp
+ * @brief Compares LLSDBinaryView with the stream based LLSDBinaryParser.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: llsdview_bench [--mesh <file>] [--ais <file>] [--items <count>]
+//
+// Without files, payloads shaped like a mesh asset header and an AIS
+// inventory fetch are generated. Files must hold binary LLSD, optionally
+// preceded by the "<? LLSD/Binary ?>" line; a mesh asset can be given as
+// a whole since only the header at its start is parsed.
+
+#include "linden_common.h"
+
+#include <cstdio>
+#include <sstream>
+
+#include "llbenchmark.h"
+#include "lldate.h"
+#include "llformat.h"
+#include "llsdserialize.h"
+#include "llsdview.h"
+
+static const std::string LLSD_BINARY_HEADER_LINE("<? LLSD/Binary ?>\n");
+
+static LLSD make_mesh_header()
+{
+	static const char* lods[] = { "lowest_lod", "low_lod", "medium_lod", "high_lod",
+								  "physics_convex", "physics_mesh", "skin" };
+	LLSD header;
+	header["version"] = 1;
+	header["creator"] = LLUUID::generateNewID();
+	header["date"] = LLDate::now();
+	S32 offset = 0;
+	for (U32 i = 0; i < LL_ARRAY_SIZE(lods); ++i)
+	{
+		S32 size = 4096 << (i % 4);
+		header[lods[i]]["offset"] = offset;
+		header[lods[i]]["size"] = size;
+		offset += size;
+	}
+	return header;
+}
+
+static LLSD make_ais_payload(S32 item_count)
+{
+	LLSD payload;
+	LLUUID folder_id = LLUUID::generateNewID();
+	LLUUID owner_id = LLUUID::generateNewID();
+	payload["category_id"] = folder_id;
+	payload["name"] = "Objects";
+	payload["version"] = 42;
+	payload["type_default"] = 6;
+
+	LLSD& items = payload["_embedded"]["items"];
+	for (S32 i = 0; i < item_count; ++i)
+	{
+		LLSD item;
+		item["item_id"] = LLUUID::generateNewID();
+		item["parent_id"] = folder_id;
+		item["asset_id"] = LLUUID::generateNewID();
+		item["name"] = llformat("Item number %d with a typical length name", i);
+		item["desc"] = (i % 3) ? "(No Description)" : "A longer description that somebody bothered to type in";
+		item["type"] = 6;
+		item["inv_type"] = 6;
+		item["flags"] = 0;
+		item["created_at"] = 1357000000 + i;
+
+		LLSD& perms = item["permissions"];
+		perms["owner_id"] = owner_id;
+		perms["creator_id"] = owner_id;
+		perms["last_owner_id"] = owner_id;
+		perms["group_id"] = LLUUID::null;
+		perms["base_mask"] = (S32)0x7fffffff;
+		perms["owner_mask"] = (S32)0x7fffffff;
+		perms["group_mask"] = 0;
+		perms["everyone_mask"] = 0;
+		perms["next_owner_mask"] = (S32)0x82000;
+		perms["is_owner_group"] = false;
+
+		item["sale_info"]["sale_price"] = 10;
+		item["sale_info"]["sale_type"] = 0;
+
+		items.append(item);
+	}
+	payload["_embedded"]["categories"] = LLSD::emptyArray();
+	payload["_links"]["self"]["href"] = "/category/" + folder_id.asString();
+	return payload;
+}
+
+static void to_buffer(const LLSD& sd, std::vector<U8>& buffer)
+{
+	std::ostringstream ostr;
+	LLSDSerialize::toBinary(sd, ostr);
+	std::string str = ostr.str();
+	buffer.assign(str.begin(), str.end());
+}
+
+static void strip_header_line(std::vector<U8>& buffer)
+{
+	if (buffer.size() > LLSD_BINARY_HEADER_LINE.size() &&
+		!memcmp(&buffer[0], LLSD_BINARY_HEADER_LINE.data(), LLSD_BINARY_HEADER_LINE.size()))
+	{
+		buffer.erase(buffer.begin(), buffer.begin() + LLSD_BINARY_HEADER_LINE.size());
+	}
+}
+
+// What the viewer did until now: copy into a string, wrap it in a stream
+// and build the whole tree.
+struct StreamParse
+{
+	StreamParse(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		std::string str((const char*)&mBuffer[0], mBuffer.size());
+		std::istringstream istr(str);
+		LLSD sd;
+		LLSDSerialize::fromBinary(sd, istr, (S32)mBuffer.size());
+		gBenchmarkSink += sd.size();
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+// Building the whole tree from the buffer, as unzip_llsd() does now.
+struct ViewToLLSD
+{
+	ViewToLLSD(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		LLSD sd;
+		gBenchmarkSink += LLSDSerialize::fromBinaryBuffer(sd, &mBuffer[0], (S32)mBuffer.size());
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+// Only parsing, no access at all.
+struct ViewParse
+{
+	ViewParse(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		LLSDBinaryView view;
+		gBenchmarkSink += view.parse(&mBuffer[0], (S32)mBuffer.size());
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+// Reading what LLMeshRepoThread needs to fetch a LOD.
+struct ViewMeshLookup
+{
+	ViewMeshLookup(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		LLSDBinaryView view;
+		view.parse(&mBuffer[0], (S32)mBuffer.size());
+		LLSDView lod = view.root()["high_lod"];
+		gBenchmarkSink += lod["offset"].asInteger() + lod["size"].asInteger();
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+// Visiting every item for its id, name and owner, like building
+// inventory items from an AIS response.
+struct ViewAISWalk
+{
+	ViewAISWalk(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		LLSDBinaryView view;
+		view.parse(&mBuffer[0], (S32)mBuffer.size());
+		LLSDView items = view.root()["_embedded"]["items"];
+		for (LLSDView::const_iterator iter = items.begin(); iter != items.end(); ++iter)
+		{
+			LLSDView item = *iter;
+			gBenchmarkSink += item["item_id"].asUUID().mData[0];
+			gBenchmarkSink += item["name"].dataSize();
+			gBenchmarkSink += item["permissions"]["owner_id"].asUUID().mData[0];
+		}
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+// The same walk over a tree built by the stream parser.
+struct StreamAISWalk
+{
+	StreamAISWalk(const std::vector<U8>& buffer) : mBuffer(buffer) { }
+	void operator()()
+	{
+		std::string str((const char*)&mBuffer[0], mBuffer.size());
+		std::istringstream istr(str);
+		LLSD sd;
+		LLSDSerialize::fromBinary(sd, istr, (S32)mBuffer.size());
+		const LLSD& items = sd["_embedded"]["items"];
+		for (LLSD::array_const_iterator iter = items.beginArray(); iter != items.endArray(); ++iter)
+		{
+			const LLSD& item = *iter;
+			gBenchmarkSink += item["item_id"].asUUID().mData[0];
+			gBenchmarkSink += item["name"].asString().size();
+			gBenchmarkSink += item["permissions"]["owner_id"].asUUID().mData[0];
+		}
+	}
+	const std::vector<U8>& mBuffer;
+};
+
+static bool check_same(const std::string& name, const std::vector<U8>& buffer)
+{
+	std::string str((const char*)&buffer[0], buffer.size());
+	std::istringstream istr(str);
+	LLSD from_stream;
+	LLSDSerialize::fromBinary(from_stream, istr, (S32)buffer.size());
+	LLSD from_view;
+	LLSDSerialize::fromBinaryBuffer(from_view, &buffer[0], (S32)buffer.size());
+
+	std::ostringstream a, b;
+	LLSDSerialize::toNotation(from_stream, a);
+	LLSDSerialize::toNotation(from_view, b);
+	if (from_stream.isUndefined() || a.str() != b.str())
+	{
+		printf("%s: parsers disagree or the payload is not binary LLSD, skipping\n", name.c_str());
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	std::vector<U8> mesh;
+	std::vector<U8> ais;
+	S32 item_count = 1000;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--items")
+		{
+			item_count = atoi(argv[i + 1]);
+		}
+		else if ((arg == "--mesh" && !ll_benchmark_load_file(argv[i + 1], mesh)) ||
+				 (arg == "--ais" && !ll_benchmark_load_file(argv[i + 1], ais)))
+		{
+			printf("Couldn't read %s\n", argv[i + 1]);
+			return 1;
+		}
+	}
+	if (mesh.empty())
+	{
+		to_buffer(make_mesh_header(), mesh);
+	}
+	if (ais.empty())
+	{
+		to_buffer(make_ais_payload(item_count), ais);
+	}
+	strip_header_line(mesh);
+	strip_header_line(ais);
+
+	if (check_same("mesh header", mesh))
+	{
+		printf("mesh header: %u bytes\n", (U32)mesh.size());
+		StreamParse stream_parse(mesh);
+		ViewToLLSD view_to_llsd(mesh);
+		ViewParse view_parse(mesh);
+		ViewMeshLookup view_lookup(mesh);
+		ll_benchmark("mesh header: stream parse", stream_parse);
+		ll_benchmark("mesh header: buffer parse to LLSD", view_to_llsd);
+		ll_benchmark("mesh header: view parse", view_parse);
+		ll_benchmark("mesh header: view parse + LOD lookup", view_lookup);
+	}
+
+	if (check_same("AIS payload", ais))
+	{
+		F64 bytes = (F64)ais.size();
+		printf("AIS payload: %u bytes\n", (U32)ais.size());
+		StreamParse stream_parse(ais);
+		StreamAISWalk stream_walk(ais);
+		ViewToLLSD view_to_llsd(ais);
+		ViewParse view_parse(ais);
+		ViewAISWalk view_walk(ais);
+		ll_benchmark("AIS: stream parse", stream_parse, bytes);
+		ll_benchmark("AIS: stream parse + item walk", stream_walk, bytes);
+		ll_benchmark("AIS: buffer parse to LLSD", view_to_llsd, bytes);
+		ll_benchmark("AIS: view parse", view_parse, bytes);
+		ll_benchmark("AIS: view parse + item walk", view_walk, bytes);
+	}
+
+	return 0;
+}
@@ -0,0 +1,396 @@
+/**
+ * @file morph_bench.cpp
+ * @brief Times applying avatar morph targets to their meshes.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: morph_bench [--meshes <count>] [--vertices <count>] [--morphs <count>] [--changes <count>]
+//
+// Replays visual param changes against synthetic avatar meshes, each with
+// --morphs morph targets moving a random span of 5% to 40% of its vertices,
+// one in five of them masked. Three patterns are timed: a slider drag
+// (four morphs per update, as a slider drives a few morphs), an appearance
+// update changing --changes morphs at once, and an appearance blend
+// changing every morph. Each is timed with the code
+// LLPolyMorphTarget::apply() used before, which normalized the normals and
+// binormals of a vertex for every morph moving it, and with
+// LLPolyMorphAccumulator, which normalizes them once per update. The
+// largest normal difference between the two is printed first.
+
+#include "linden_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "llbenchmark.h"
+#include "llformat.h"
+#include "llmath.h"
+#include "llpolymorph.h"
+#include "llrand.h"
+#include "v2math.h"
+
+static const F32 NORMAL_SOFTEN_FACTOR = 0.65f;
+
+struct MeshArrays
+{
+	MeshArrays(U32 count) : mCount(count)
+	{
+		mCoords = alloc(count);
+		mScaledNormals = alloc(count);
+		mNormals = alloc(count);
+		mScaledBinormals = alloc(count);
+		mBinormals = alloc(count);
+		mClothingWeights = alloc(count);
+		mTexCoords = new LLVector2[count];
+		for (U32 i = 0; i < count; ++i)
+		{
+			mCoords[i].set(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+			mNormals[i].set(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+			mNormals[i].normalize3fast();
+			mScaledNormals[i] = mNormals[i];
+			mBinormals[i] = mNormals[i];
+			mScaledBinormals[i] = mNormals[i];
+			mClothingWeights[i].clear();
+			mTexCoords[i].set(ll_frand(), ll_frand());
+		}
+		mAccumulator.init(count, mCoords, mScaledNormals, mNormals, mScaledBinormals, mBinormals, mClothingWeights, mTexCoords);
+	}
+	~MeshArrays()
+	{
+		ll_aligned_free_16(mCoords);
+		ll_aligned_free_16(mScaledNormals);
+		ll_aligned_free_16(mNormals);
+		ll_aligned_free_16(mScaledBinormals);
+		ll_aligned_free_16(mBinormals);
+		ll_aligned_free_16(mClothingWeights);
+		delete[] mTexCoords;
+	}
+	void copyFrom(const MeshArrays& other)
+	{
+		LLVector4a::memcpyNonAliased16(mCoords->getF32ptr(), other.mCoords->getF32ptr(), mCount * sizeof(LLVector4a));
+		LLVector4a::memcpyNonAliased16(mScaledNormals->getF32ptr(), other.mScaledNormals->getF32ptr(), mCount * sizeof(LLVector4a));
+		LLVector4a::memcpyNonAliased16(mNormals->getF32ptr(), other.mNormals->getF32ptr(), mCount * sizeof(LLVector4a));
+		LLVector4a::memcpyNonAliased16(mScaledBinormals->getF32ptr(), other.mScaledBinormals->getF32ptr(), mCount * sizeof(LLVector4a));
+		LLVector4a::memcpyNonAliased16(mBinormals->getF32ptr(), other.mBinormals->getF32ptr(), mCount * sizeof(LLVector4a));
+		LLVector4a::memcpyNonAliased16(mClothingWeights->getF32ptr(), other.mClothingWeights->getF32ptr(), mCount * sizeof(LLVector4a));
+		std::copy(other.mTexCoords, other.mTexCoords + mCount, mTexCoords);
+	}
+	static LLVector4a* alloc(U32 count)
+	{
+		return (LLVector4a*)ll_aligned_malloc_16(count * sizeof(LLVector4a));
+	}
+
+	U32 mCount;
+	LLVector4a* mCoords;
+	LLVector4a* mScaledNormals;
+	LLVector4a* mNormals;
+	LLVector4a* mScaledBinormals;
+	LLVector4a* mBinormals;
+	LLVector4a* mClothingWeights;
+	LLVector2* mTexCoords;
+	LLPolyMorphAccumulator mAccumulator;
+};
+
+struct Morph
+{
+	U32 mMesh;
+	LLPolyMorphData* mData;
+	std::vector<F32> mMask;		// empty when not masked
+	bool mClothing;
+};
+
+static LLPolyMorphData* make_morph_data(U32 mesh_vertices)
+{
+	LLPolyMorphData* data = new LLPolyMorphData("bench");
+	U32 count = llmax((U32)(mesh_vertices * (0.05f + ll_frand(0.35f))), (U32)1);
+	U32 first = ll_rand(mesh_vertices - count + 1);
+	data->mCoords = MeshArrays::alloc(count);
+	data->mNormals = MeshArrays::alloc(count);
+	data->mBinormals = MeshArrays::alloc(count);
+	data->mTexCoords = new LLVector2[count];
+	data->mVertexIndices = new U32[count];
+	data->mNumIndices = count;
+	for (U32 i = 0; i < count; ++i)
+	{
+		data->mVertexIndices[i] = first + i;
+		data->mCoords[i].set(ll_frand(0.1f) - 0.05f, ll_frand(0.1f) - 0.05f, ll_frand(0.1f) - 0.05f);
+		data->mNormals[i].set(ll_frand(0.5f) - 0.25f, ll_frand(0.5f) - 0.25f, ll_frand(0.5f) - 0.25f);
+		data->mBinormals[i].set(ll_frand(0.5f) - 0.25f, ll_frand(0.5f) - 0.25f, ll_frand(0.5f) - 0.25f);
+		data->mTexCoords[i].set(ll_frand(0.01f), ll_frand(0.01f));
+	}
+	data->updateDegenerateBinormals();
+	return data;
+}
+
+// The per-vertex work LLPolyMorphTarget::apply() did before
+// LLPolyMorphAccumulator, normalizing as it went.
+static void apply_reference(const Morph& morph, F32 delta_weight, MeshArrays& mesh)
+{
+	LLVector4a *coords = mesh.mCoords;
+	LLVector4a *scaled_normals = mesh.mScaledNormals;
+	LLVector4a *normals = mesh.mNormals;
+	LLVector4a *scaled_binormals = mesh.mScaledBinormals;
+	LLVector4a *binormals = mesh.mBinormals;
+	LLVector4a *clothing_weights = mesh.mClothingWeights;
+	LLVector2 *tex_coords = mesh.mTexCoords;
+	const LLPolyMorphData* morph_data = morph.mData;
+	const F32 *maskWeightArray = morph.mMask.empty() ? NULL : &morph.mMask[0];
+
+	for(U32 vert_index_morph = 0; vert_index_morph < morph_data->mNumIndices; vert_index_morph++)
+	{
+		S32 vert_index_mesh = morph_data->mVertexIndices[vert_index_morph];
+
+		F32 maskWeight = 1.f;
+		if (maskWeightArray)
+		{
+			maskWeight = maskWeightArray[vert_index_morph];
+		}
+
+		LLVector4a pos = morph_data->mCoords[vert_index_morph];
+		pos.mul(delta_weight*maskWeight);
+		coords[vert_index_mesh].add(pos);
+
+		if (morph.mClothing)
+		{
+			LLVector4a clothing_offset = morph_data->mCoords[vert_index_morph];
+			clothing_offset.mul(delta_weight * maskWeight);
+			LLVector4a* clothing_weight = &clothing_weights[vert_index_mesh];
+			clothing_weight->add(clothing_offset);
+			clothing_weight->getF32ptr()[VW] = maskWeight;
+		}
+
+		LLVector4a norm = morph_data->mNormals[vert_index_morph];
+		norm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
+		scaled_normals[vert_index_mesh].add(norm);
+		norm = scaled_normals[vert_index_mesh];
+		norm.normalize3fast();
+		normals[vert_index_mesh] = norm;
+
+		LLVector4a binorm = morph_data->mBinormals[vert_index_morph];
+		if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
+		{
+			binorm.set(1,0,0,1);
+		}
+
+		binorm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
+		scaled_binormals[vert_index_mesh].add(binorm);
+		LLVector4a tangent;
+		tangent.setCross3(scaled_binormals[vert_index_mesh], norm);
+		LLVector4a& normalized_binormal = binormals[vert_index_mesh];
+
+		normalized_binormal.setCross3(norm, tangent);
+		normalized_binormal.normalize3fast();
+
+		tex_coords[vert_index_mesh] += morph_data->mTexCoords[vert_index_morph] * delta_weight * maskWeight;
+	}
+}
+
+// A replay is a list of updates, each a list of morph and weight delta.
+typedef std::vector<std::pair<U32, F32> > update_t;
+typedef std::vector<update_t> replay_t;
+
+static void make_replay(U32 morph_count, U32 changes, U32 updates, replay_t& replay)
+{
+	replay.resize(updates);
+	for (U32 u = 0; u < updates; ++u)
+	{
+		for (U32 c = 0; c < changes; ++c)
+		{
+			U32 morph = changes >= morph_count ? c : ll_rand(morph_count);
+			replay[u].push_back(std::make_pair(morph, ll_frand(0.2f) - 0.1f));
+		}
+	}
+}
+
+struct ReplayReference
+{
+	ReplayReference(std::vector<Morph>& morphs, std::vector<MeshArrays*>& meshes, const replay_t& replay)
+	:	mMorphs(morphs), mMeshes(meshes), mReplay(replay) { }
+	void operator()()
+	{
+		for (U32 u = 0; u < mReplay.size(); ++u)
+		{
+			const update_t& update = mReplay[u];
+			for (U32 c = 0; c < update.size(); ++c)
+			{
+				const Morph& morph = mMorphs[update[c].first];
+				apply_reference(morph, update[c].second, *mMeshes[morph.mMesh]);
+			}
+		}
+		gBenchmarkSink += mReplay.size();
+	}
+	std::vector<Morph>& mMorphs;
+	std::vector<MeshArrays*>& mMeshes;
+	const replay_t& mReplay;
+};
+
+// Reads the normals after every update, as the avatar does when it
+// rebuilds its geometry.
+struct ReplayAccumulator
+{
+	ReplayAccumulator(std::vector<Morph>& morphs, std::vector<MeshArrays*>& meshes, const replay_t& replay)
+	:	mMorphs(morphs), mMeshes(meshes), mReplay(replay) { }
+	void operator()()
+	{
+		for (U32 u = 0; u < mReplay.size(); ++u)
+		{
+			const update_t& update = mReplay[u];
+			for (U32 c = 0; c < update.size(); ++c)
+			{
+				const Morph& morph = mMorphs[update[c].first];
+				mMeshes[morph.mMesh]->mAccumulator.addMorph(morph.mData, update[c].second,
+															 morph.mMask.empty() ? NULL : &morph.mMask[0], morph.mClothing);
+			}
+			for (U32 m = 0; m < mMeshes.size(); ++m)
+			{
+				mMeshes[m]->mAccumulator.updateNormals();
+			}
+		}
+		gBenchmarkSink += mReplay.size();
+	}
+	std::vector<Morph>& mMorphs;
+	std::vector<MeshArrays*>& mMeshes;
+	const replay_t& mReplay;
+};
+
+static F32 max_normal_difference(const std::vector<MeshArrays*>& a, const std::vector<MeshArrays*>& b)
+{
+	F32 max_diff = 0.f;
+	for (U32 m = 0; m < a.size(); ++m)
+	{
+		for (U32 i = 0; i < a[m]->mCount; ++i)
+		{
+			LLVector4a diff;
+			diff.setSub(a[m]->mNormals[i], b[m]->mNormals[i]);
+			max_diff = llmax(max_diff, diff.getLength3().getF32());
+			diff.setSub(a[m]->mBinormals[i], b[m]->mBinormals[i]);
+			max_diff = llmax(max_diff, diff.getLength3().getF32());
+		}
+	}
+	return max_diff;
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	U32 mesh_count = 4;
+	U32 vertices = 2500;
+	U32 morphs_per_mesh = 40;
+	U32 changes = 40;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--meshes")
+		{
+			mesh_count = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--vertices")
+		{
+			vertices = (U32)llmax(atoi(argv[i + 1]), 16);
+		}
+		else if (arg == "--morphs")
+		{
+			morphs_per_mesh = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--changes")
+		{
+			changes = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	std::vector<MeshArrays*> reference_meshes;
+	std::vector<MeshArrays*> meshes;
+	std::vector<Morph> morphs;
+	for (U32 m = 0; m < mesh_count; ++m)
+	{
+		reference_meshes.push_back(new MeshArrays(vertices));
+		meshes.push_back(new MeshArrays(vertices));
+		meshes.back()->copyFrom(*reference_meshes.back());
+		for (U32 i = 0; i < morphs_per_mesh; ++i)
+		{
+			Morph morph;
+			morph.mMesh = m;
+			morph.mData = make_morph_data(vertices);
+			morph.mClothing = ll_rand(4) == 0;
+			if (ll_rand(5) == 0)
+			{
+				morph.mMask.resize(morph.mData->mNumIndices);
+				for (U32 v = 0; v < morph.mMask.size(); ++v)
+				{
+					morph.mMask[v] = ll_frand();
+				}
+			}
+			morphs.push_back(morph);
+		}
+	}
+	U32 morph_count = (U32)morphs.size();
+	printf("%u meshes of %u vertices, %u morphs\n", mesh_count, vertices, morph_count);
+
+	struct Pattern
+	{
+		const char* mName;
+		U32 mChanges;
+		U32 mUpdates;
+	};
+	const Pattern patterns[] =
+	{
+		{ "slider drag", 4, 16 },
+		{ "appearance update", llmin(changes, morph_count), 4 },
+		{ "appearance blend", morph_count, 1 },
+	};
+
+	for (U32 p = 0; p < LL_ARRAY_SIZE(patterns); ++p)
+	{
+		for (U32 m = 0; m < mesh_count; ++m)
+		{
+			meshes[m]->copyFrom(*reference_meshes[m]);
+		}
+
+		replay_t replay;
+		make_replay(morph_count, patterns[p].mChanges, patterns[p].mUpdates, replay);
+
+		ReplayReference reference(morphs, reference_meshes, replay);
+		ReplayAccumulator accumulator(morphs, meshes, replay);
+		reference();
+		accumulator();
+		printf("%s, %u morphs per update: largest normal difference %g\n", patterns[p].mName,
+			   patterns[p].mChanges, max_normal_difference(reference_meshes, meshes));
+
+		F64 reference_seconds = ll_benchmark(llformat("%s, normalize per morph", patterns[p].mName), reference);
+		F64 seconds = ll_benchmark(llformat("%s, normalize per update", patterns[p].mName), accumulator);
+		printf("  %.1fx faster\n", reference_seconds / seconds);
+	}
+
+	for (U32 i = 0; i < morphs.size(); ++i)
+	{
+		delete morphs[i].mData;
+	}
+	for (U32 m = 0; m < mesh_count; ++m)
+	{
+		delete reference_meshes[m];
+		delete meshes[m];
+	}
+	return 0;
+}
@@ -0,0 +1,347 @@
+/**
+ * @file skinning_bench.cpp
+ * @brief Times software skinning of rigged mesh faces.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: skinning_bench [--avatars <count>] [--vertices <count>] [--threads <count>]
+//
+// Skins synthetic rigged faces, each vertex weighted to between one and
+// four of 52 joints, the way the viewer does when there are no avatar
+// shaders: first with the per-vertex code the viewer used before, then
+// with LLMeshSkinning on one thread, then through LLMeshSkinningBatch on
+// the shared thread pool. Every avatar wears --vertices vertices split
+// over faces of up to 4096 vertices sharing one skin. The largest
+// difference from the old results is printed before the timings.
+
+#include "linden_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "llbenchmark.h"
+#include "llformat.h"
+#include "llmath.h"
+#include "llmatrix4a.h"
+#include "llmeshskinning.h"
+#include "llquaternion.h"
+#include "llrand.h"
+#include "llthreadpool.h"
+#include "m4math.h"
+#include "v4math.h"
+
+static const U32 JOINT_COUNT = 52;
+static const U32 FACE_VERTICES = 4096;
+
+struct SkinFace
+{
+	U32 mAvatar;
+	U32 mCount;
+	LLVector4a* mWeights;
+	LLVector4a* mPositions;
+	LLVector4a* mNormals;
+	LLVector4a* mPosOut;
+	LLVector4a* mNormOut;
+};
+
+struct SkinScene
+{
+	LLMatrix4a mBindShape;
+	// Inverse bind times world matrices, one palette per avatar.
+	std::vector<LLMatrix4a*> mJoints;
+	std::vector<SkinFace> mFaces;
+};
+
+static LLVector4a* alloc_vectors(U32 count)
+{
+	return (LLVector4a*)ll_aligned_malloc_16(count * sizeof(LLVector4a));
+}
+
+static void make_scene(U32 avatars, U32 vertices, SkinScene& scene)
+{
+	LLMatrix4 bind_shape;
+	bind_shape.initAll(LLVector3(1.1f, 0.9f, 1.f), LLQuaternion(0.3f, LLVector3(0.f, 0.f, 1.f)), LLVector3(0.1f, 0.2f, 0.3f));
+	scene.mBindShape.loadu(bind_shape);
+
+	for (U32 a = 0; a < avatars; ++a)
+	{
+		LLMatrix4a* joints = (LLMatrix4a*)ll_aligned_malloc_16(JOINT_COUNT * sizeof(LLMatrix4a));
+		for (U32 j = 0; j < JOINT_COUNT; ++j)
+		{
+			LLQuaternion rot(ll_frand(F_PI), LLVector3(ll_frand(), ll_frand(), ll_frand() + 0.1f));
+			LLMatrix4 mat;
+			mat.initAll(LLVector3(1.f, 1.f, 1.f), rot, LLVector3(ll_frand(), ll_frand(), ll_frand()));
+			joints[j].loadu(mat);
+		}
+		scene.mJoints.push_back(joints);
+
+		for (U32 done = 0; done < vertices; done += FACE_VERTICES)
+		{
+			SkinFace face;
+			face.mAvatar = a;
+			face.mCount = llmin(vertices - done, FACE_VERTICES);
+			face.mWeights = alloc_vectors(face.mCount);
+			face.mPositions = alloc_vectors(face.mCount);
+			face.mNormals = alloc_vectors(face.mCount);
+			face.mPosOut = alloc_vectors(face.mCount);
+			face.mNormOut = alloc_vectors(face.mCount);
+			for (U32 i = 0; i < face.mCount; ++i)
+			{
+				F32 w[4] = { 0.f, 0.f, 0.f, 0.f };
+				U32 influences = 1 + ll_rand(4);
+				F32 left = 1.f;
+				for (U32 k = 0; k < influences; ++k)
+				{
+					F32 influence = k + 1 < influences ? left * ll_frand(0.9f) : left;
+					left -= influence;
+					w[k] = (F32)ll_rand(JOINT_COUNT) + llclamp(influence, 0.01f, 0.99f);
+				}
+				face.mWeights[i].loadua(w);
+				face.mPositions[i].set(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+				face.mNormals[i].set(ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f, ll_frand(2.f) - 1.f);
+				face.mNormals[i].normalize3fast();
+			}
+			scene.mFaces.push_back(face);
+		}
+	}
+}
+
+static void free_scene(SkinScene& scene)
+{
+	for (U32 i = 0; i < scene.mJoints.size(); ++i)
+	{
+		ll_aligned_free_16(scene.mJoints[i]);
+	}
+	for (U32 i = 0; i < scene.mFaces.size(); ++i)
+	{
+		SkinFace& face = scene.mFaces[i];
+		ll_aligned_free_16(face.mWeights);
+		ll_aligned_free_16(face.mPositions);
+		ll_aligned_free_16(face.mNormals);
+		ll_aligned_free_16(face.mPosOut);
+		ll_aligned_free_16(face.mNormOut);
+	}
+}
+
+// The per-vertex skinning LLVOAvatar::updateSoftwareSkinnedVertices() did
+// before LLMeshSkinning.
+static void skin_reference(const LLMatrix4a* mp, const LLMatrix4a& bind_shape_matrix, const SkinFace& face,
+						   LLVector4a* pos, LLVector4a* norm)
+{
+	const LLVector4a* weight = face.mWeights;
+	for (U32 j = 0; j < face.mCount; ++j)
+	{
+		LLMatrix4a final_mat;
+		final_mat.clear();
+
+		S32 idx[4];
+
+		LLVector4 wght;
+
+		F32 scale = 0.f;
+		for (U32 k = 0; k < 4; k++)
+		{
+			F32 w = weight[j][k];
+
+			idx[k] = (S32) floorf(w);
+			wght[k] = w - floorf(w);
+			scale += wght[k];
+		}
+
+		if(scale > 0.f)
+			wght *= 1.f/scale;
+		else
+			wght = LLVector4(F32_MAX,F32_MAX,F32_MAX,F32_MAX);
+
+		for (U32 k = 0; k < 4; k++)
+		{
+			F32 w = wght[k];
+			LLMatrix4a src;
+			src.setMul(mp[idx[k]], w);
+
+			final_mat.add(src);
+		}
+
+		LLVector4a t;
+		LLVector4a dst;
+		bind_shape_matrix.affineTransform(face.mPositions[j], t);
+		final_mat.affineTransform(t, dst);
+		pos[j] = dst;
+
+		bind_shape_matrix.rotate(face.mNormals[j], t);
+		final_mat.rotate(t, dst);
+		dst.normalize3fast();
+		norm[j] = dst;
+	}
+}
+
+struct SkinReference
+{
+	SkinReference(SkinScene& scene) : mScene(scene) { }
+	void operator()()
+	{
+		for (U32 i = 0; i < mScene.mFaces.size(); ++i)
+		{
+			SkinFace& face = mScene.mFaces[i];
+			skin_reference(mScene.mJoints[face.mAvatar], mScene.mBindShape, face, face.mPosOut, face.mNormOut);
+		}
+		gBenchmarkSink += mScene.mFaces.size();
+	}
+	SkinScene& mScene;
+};
+
+// Builds each palette once per avatar, as LLDrawPoolAvatar does.
+struct SkinSimd
+{
+	SkinSimd(SkinScene& scene) : mScene(scene) { }
+	void operator()()
+	{
+		LLMatrix4a palette[JOINT_COUNT];
+		U32 avatar = U32_MAX;
+		for (U32 i = 0; i < mScene.mFaces.size(); ++i)
+		{
+			SkinFace& face = mScene.mFaces[i];
+			if (face.mAvatar != avatar)
+			{
+				avatar = face.mAvatar;
+				std::copy(mScene.mJoints[avatar], mScene.mJoints[avatar] + JOINT_COUNT, palette);
+				LLMeshSkinning::applyBindShape(mScene.mBindShape, palette, JOINT_COUNT);
+			}
+			LLMeshSkinning::skinVertices(palette, JOINT_COUNT, face.mWeights, face.mPositions, face.mNormals,
+										 face.mPosOut, face.mNormOut, face.mCount);
+		}
+		gBenchmarkSink += mScene.mFaces.size();
+	}
+	SkinScene& mScene;
+};
+
+// Queues the faces of each avatar and runs them together, as
+// LLDrawPoolAvatar::updateRiggedVertexBuffers() does.
+struct SkinBatch
+{
+	SkinBatch(SkinScene& scene) : mScene(scene) { }
+	void operator()()
+	{
+		U32 avatar = U32_MAX;
+		U32 offset = 0;
+		for (U32 i = 0; i < mScene.mFaces.size(); ++i)
+		{
+			SkinFace& face = mScene.mFaces[i];
+			if (face.mAvatar != avatar)
+			{
+				mBatch.run();
+				avatar = face.mAvatar;
+				offset = mBatch.addPalette(JOINT_COUNT);
+				LLMatrix4a* palette = mBatch.getPalette(offset);
+				std::copy(mScene.mJoints[avatar], mScene.mJoints[avatar] + JOINT_COUNT, palette);
+				LLMeshSkinning::applyBindShape(mScene.mBindShape, palette, JOINT_COUNT);
+			}
+			mBatch.addFace(offset, JOINT_COUNT, face.mWeights, face.mPositions, face.mNormals,
+						   face.mPosOut, face.mNormOut, face.mCount);
+		}
+		mBatch.run();
+		gBenchmarkSink += mScene.mFaces.size();
+	}
+	SkinScene& mScene;
+	LLMeshSkinningBatch mBatch;
+};
+
+static F32 max_difference(const SkinScene& scene, const std::vector<LLVector4a*>& expected)
+{
+	F32 max_diff = 0.f;
+	for (U32 i = 0; i < scene.mFaces.size(); ++i)
+	{
+		const SkinFace& face = scene.mFaces[i];
+		for (U32 j = 0; j < face.mCount; ++j)
+		{
+			LLVector4a diff;
+			diff.setSub(face.mPosOut[j], expected[i][j]);
+			max_diff = llmax(max_diff, diff.getLength3().getF32());
+		}
+	}
+	return max_diff;
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	U32 avatars = 8;
+	U32 vertices = 60000;
+	U32 max_threads = 4;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--avatars")
+		{
+			avatars = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--vertices")
+		{
+			vertices = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+		else if (arg == "--threads")
+		{
+			max_threads = (U32)llmax(atoi(argv[i + 1]), 1);
+		}
+	}
+
+	SkinScene scene;
+	make_scene(avatars, vertices, scene);
+	F64 total_vertices = (F64)avatars * vertices;
+
+	// Keep the old positions to compare the new ones with.
+	SkinReference reference(scene);
+	reference();
+	std::vector<LLVector4a*> expected;
+	for (U32 i = 0; i < scene.mFaces.size(); ++i)
+	{
+		expected.push_back(alloc_vectors(scene.mFaces[i].mCount));
+		LLVector4a::memcpyNonAliased16(expected.back()->getF32ptr(), scene.mFaces[i].mPosOut->getF32ptr(), scene.mFaces[i].mCount * sizeof(LLVector4a));
+	}
+
+	SkinSimd simd(scene);
+	simd();
+	printf("%u avatars of %u vertices, largest position difference: %g\n", avatars, vertices, max_difference(scene, expected));
+
+	F64 reference_seconds = ll_benchmark("per-vertex palette blend", reference);
+	printf("  %.1f ns per vertex\n", reference_seconds * 1e9 / total_vertices);
+	F64 seconds = ll_benchmark("LLMeshSkinning, 1 thread", simd);
+	printf("  %.1f ns per vertex, %.1fx faster\n", seconds * 1e9 / total_vertices, reference_seconds / seconds);
+	for (U32 threads = 1; threads <= max_threads; threads *= 2)
+	{
+		LLThreadPool::initClass(threads);
+		SkinBatch batch(scene);
+		seconds = ll_benchmark(llformat("LLMeshSkinningBatch, %u pool threads", threads), batch);
+		printf("  %.1f ns per vertex, %.1fx faster\n", seconds * 1e9 / total_vertices, reference_seconds / seconds);
+		LLThreadPool::cleanupClass();
+	}
+
+	for (U32 i = 0; i < expected.size(); ++i)
+	{
+		ll_aligned_free_16(expected[i]);
+	}
+	free_scene(scene);
+	return 0;
+}
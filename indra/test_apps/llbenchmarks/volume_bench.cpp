@@ -0,0 +1,177 @@
+/**
+ * @file volume_bench.cpp
+ * @brief Times prim geometry generation for every prim type and LOD.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: volume_bench [--checksum]
+//
+// Builds the faces of a range of prim shapes at each of the four LOD
+// detail scales, once without and once with tangents. --checksum prints a
+// hash of the generated positions, normals, texture coordinates, indices,
+// tangents and edges, so that the output of two builds of LLVolume can be
+// compared before comparing their timings.
+
+#include "linden_common.h"
+
+#include <cstdio>
+
+#include "llbenchmark.h"
+#include "llformat.h"
+#include "llvolume.h"
+#include "llvolumemgr.h"
+
+struct ShapeDesc
+{
+	const char* mName;
+	U8 mProfile;
+	U8 mPath;
+	F32 mBeginS, mEndS;
+	F32 mRatioX, mRatioY;
+	F32 mShearX;
+	F32 mHollow;
+	F32 mTwistBegin, mTwistEnd;
+};
+
+static const ShapeDesc SHAPES[] =
+{
+	{ "box",				LL_PCODE_PROFILE_SQUARE,		LL_PCODE_PATH_LINE,		0.f, 1.f,	1.f, 1.f,	0.f,	0.f,	0.f, 0.f },
+	{ "twisted box",		LL_PCODE_PROFILE_SQUARE,		LL_PCODE_PATH_LINE,		0.f, 1.f,	1.f, 1.f,	0.f,	0.f,	-0.5f, 0.5f },
+	{ "prism",				LL_PCODE_PROFILE_SQUARE,		LL_PCODE_PATH_LINE,		0.f, 1.f,	0.f, 1.f,	-0.5f,	0.f,	0.f, 0.f },
+	{ "cylinder",			LL_PCODE_PROFILE_CIRCLE,		LL_PCODE_PATH_LINE,		0.f, 1.f,	1.f, 1.f,	0.f,	0.f,	0.f, 0.f },
+	{ "sphere",				LL_PCODE_PROFILE_CIRCLE_HALF,	LL_PCODE_PATH_CIRCLE,	0.f, 1.f,	1.f, 1.f,	0.f,	0.f,	0.f, 0.f },
+	{ "torus",				LL_PCODE_PROFILE_CIRCLE,		LL_PCODE_PATH_CIRCLE,	0.f, 1.f,	1.f, 0.25f,	0.f,	0.f,	0.f, 0.f },
+	{ "tube",				LL_PCODE_PROFILE_SQUARE,		LL_PCODE_PATH_CIRCLE,	0.f, 1.f,	1.f, 0.25f,	0.f,	0.f,	0.f, 0.f },
+	{ "ring",				LL_PCODE_PROFILE_EQUALTRI,		LL_PCODE_PATH_CIRCLE,	0.f, 1.f,	1.f, 0.25f,	0.f,	0.f,	0.f, 0.f },
+	{ "hollow cut torus",	LL_PCODE_PROFILE_CIRCLE | LL_PCODE_HOLE_CIRCLE,	LL_PCODE_PATH_CIRCLE,	0.1f, 0.8f,	1.f, 0.25f,	0.f,	0.5f,	-1.f, 1.f },
+};
+
+static LLVolumeParams make_params(const ShapeDesc& shape)
+{
+	LLVolumeParams params;
+	params.setType(shape.mProfile, shape.mPath);
+	params.setBeginAndEndS(shape.mBeginS, shape.mEndS);
+	params.setBeginAndEndT(0.f, 1.f);
+	params.setRatio(shape.mRatioX, shape.mRatioY);
+	params.setShear(shape.mShearX, 0.f);
+	params.setHollow(shape.mHollow);
+	params.setTwistBegin(shape.mTwistBegin);
+	params.setTwistEnd(shape.mTwistEnd);
+	return params;
+}
+
+static U32 hash_bytes(U32 hash, const void* data, size_t size)
+{
+	const U8* bytes = (const U8*)data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 16777619U;
+	}
+	return hash;
+}
+
+static void create_tangents(LLVolume* volume)
+{
+	for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+	{
+		const_cast<LLVolumeFace&>(volume->getVolumeFace(i)).createTangents();
+	}
+}
+
+struct BuildVolume
+{
+	BuildVolume(const LLVolumeParams& params, F32 detail, bool tangents)
+	:	mParams(params), mDetail(detail), mTangents(tangents) { }
+	void operator()()
+	{
+		LLPointer<LLVolume> volume = new LLVolume(mParams, mDetail);
+		if (mTangents)
+		{
+			create_tangents(volume);
+		}
+		gBenchmarkSink += volume->getNumVolumeFaces();
+	}
+	const LLVolumeParams& mParams;
+	F32 mDetail;
+	bool mTangents;
+};
+
+static void print_checksum(const std::string& name, const LLVolumeParams& params, F32 detail)
+{
+	LLPointer<LLVolume> volume = new LLVolume(params, detail);
+	create_tangents(volume);
+
+	U32 hash = 2166136261U;
+	S32 vertices = 0;
+	for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+	{
+		const LLVolumeFace& face = volume->getVolumeFace(i);
+		vertices += face.mNumVertices;
+		hash = hash_bytes(hash, face.mPositions, face.mNumVertices * sizeof(LLVector4a));
+		hash = hash_bytes(hash, face.mNormals, face.mNumVertices * sizeof(LLVector4a));
+		hash = hash_bytes(hash, face.mTexCoords, face.mNumVertices * sizeof(LLVector2));
+		hash = hash_bytes(hash, face.mIndices, face.mNumIndices * sizeof(U16));
+		hash = hash_bytes(hash, face.mTangents, face.mNumVertices * sizeof(LLVector4a));
+		if (!face.mEdge.empty())
+		{
+			hash = hash_bytes(hash, &face.mEdge[0], face.mEdge.size() * sizeof(S32));
+		}
+	}
+	printf("%-48s %6d vertices  checksum %08x\n", name.c_str(), vertices, hash);
+}
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	bool checksum = argc > 1 && std::string(argv[1]) == "--checksum";
+
+	F64 total = 0.0;
+	F64 total_tangents = 0.0;
+	for (U32 i = 0; i < LL_ARRAY_SIZE(SHAPES); ++i)
+	{
+		LLVolumeParams params = make_params(SHAPES[i]);
+		for (S32 lod = 0; lod < LLVolumeLODGroup::NUM_LODS; ++lod)
+		{
+			F32 detail = LLVolumeLODGroup::getVolumeScaleFromDetail(lod);
+			std::string name = llformat("%s, LOD %d", SHAPES[i].mName, lod);
+			if (checksum)
+			{
+				print_checksum(name, params, detail);
+				continue;
+			}
+
+			BuildVolume build(params, detail, false);
+			BuildVolume build_tangents(params, detail, true);
+			total += ll_benchmark(name, build, 0.0, 0.2);
+			total_tangents += ll_benchmark(name + " + tangents", build_tangents, 0.0, 0.2);
+		}
+	}
+
+	if (!checksum)
+	{
+		printf("all shapes and LODs: %.3f usec, %.3f usec with tangents\n",
+			   total * 1000000.0, total_tangents * 1000000.0);
+	}
+	return 0;
+}
@@ -0,0 +1,287 @@
+/**
+ * @file xml_bench.cpp
+ * @brief Loads XUI and settings files parsed and from the compiled XML cache.
+ *
+ * $LicenseInfo:firstyear=2013&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2013, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Usage: xml_bench [--xui <file.xml>]... [--settings <settings.xml>]...
+//
+// Loads the --xui files with LLXMLNode::parseFile() and the --settings
+// files into a fresh LLControlGroup, the way the viewer does at startup,
+// once with the XML parsed and once from LLXMLCompiledCache. Without
+// files, a floater of 300 widgets and a settings file of 2000 entries are
+// written to the temporary directory. The cache goes into the temporary
+// directory too and is emptied at the end. Before timing, every XUI tree
+// read from the cache is checked against the parsed one.
+
+#include "linden_common.h"
+
+#include <cstdio>
+#include <sstream>
+
+#include "llbenchmark.h"
+#include "llcontrol.h"
+#include "lldir.h"
+#include "llfile.h"
+#include "llformat.h"
+#include "llxmlcompiledcache.h"
+#include "llxmlnode.h"
+
+static bool write_text(const std::string& filename, const std::string& text)
+{
+	LLFILE* fp = LLFile::fopen(filename, "wb");
+	if (!fp)
+	{
+		return false;
+	}
+	bool written = fwrite(text.data(), text.size(), 1, fp) == 1;
+	return LLFile::close(fp) == 0 && written;
+}
+
+// A floater shaped like the larger ones in skins/default/xui.
+static std::string make_xui()
+{
+	static const char* widgets[] = { "button", "check_box", "line_editor", "text", "combo_box", "slider" };
+	std::ostringstream xui;
+	xui << "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"yes\" ?>\n";
+	xui << "<floater can_close=\"true\" can_drag_on_left=\"false\" can_minimize=\"true\" can_resize=\"true\"\n"
+		<< "     height=\"600\" min_height=\"300\" min_width=\"400\" name=\"bench\" title=\"Benchmark\" width=\"500\">\n";
+	for (U32 panel = 0; panel < 10; ++panel)
+	{
+		xui << "\t<panel border=\"true\" bottom=\"-580\" follows=\"left|top|right|bottom\" height=\"540\" left=\"10\"\n"
+			<< "\t     label=\"Panel " << panel << "\" name=\"panel_" << panel << "\" width=\"480\">\n";
+		for (U32 i = 0; i < 30; ++i)
+		{
+			const char* widget = widgets[(panel + i) % LL_ARRAY_SIZE(widgets)];
+			xui << "\t\t<" << widget << " bottom_delta=\"-20\" follows=\"left|top\" font=\"SansSerifSmall\" height=\"16\"\n"
+				<< "\t\t     label=\"Label " << i << "\" left=\"" << 10 + (i % 3) * 150 << "\" mouse_opaque=\"true\"\n"
+				<< "\t\t     name=\"" << widget << "_" << panel << "_" << i << "\" tool_tip=\"Tool tip of widget "
+				<< i << " on panel " << panel << "\" width=\"140\">\n"
+				<< "\t\t\tValue " << i << "\n"
+				<< "\t\t</" << widget << ">\n";
+		}
+		xui << "\t</panel>\n";
+	}
+	xui << "</floater>\n";
+	return xui.str();
+}
+
+// A settings file in the layout of app_settings/settings.xml.
+static std::string make_settings()
+{
+	static const char* types[] = { "Boolean", "S32", "F32", "String", "Color4", "Vector3" };
+	std::ostringstream settings;
+	settings << "<?xml version=\"1.0\" ?>\n<llsd>\n  <map>\n";
+	for (U32 i = 0; i < 2000; ++i)
+	{
+		U32 type = i % LL_ARRAY_SIZE(types);
+		settings << "    <key>BenchSetting" << i << "</key>\n    <map>\n"
+				 << "      <key>Comment</key>\n      <string>Setting " << i << " of the settings benchmark, a " << types[type] << ".</string>\n"
+				 << "      <key>Persist</key>\n      <integer>1</integer>\n"
+				 << "      <key>Type</key>\n      <string>" << types[type] << "</string>\n"
+				 << "      <key>Value</key>\n";
+		switch (type)
+		{
+		case 0:
+		case 1:
+			settings << "      <integer>" << i % 2 << "</integer>\n";
+			break;
+		case 2:
+			settings << "      <real>" << i * 0.5f << "</real>\n";
+			break;
+		case 3:
+			settings << "      <string>value " << i << "</string>\n";
+			break;
+		default:
+			settings << "      <array>\n";
+			for (U32 c = 0; c < (type == 4 ? 4U : 3U); ++c)
+			{
+				settings << "        <real>" << c * 0.25f << "</real>\n";
+			}
+			settings << "      </array>\n";
+			break;
+		}
+		settings << "    </map>\n";
+	}
+	settings << "  </map>\n</llsd>\n";
+	return settings.str();
+}
+
+static std::string tree_text(LLXMLNodePtr node)
+{
+	std::ostringstream text;
+	node->writeToOstream(text);
+	return text.str();
+}
+
+struct LoadXUI
+{
+	LoadXUI(const std::vector<std::string>& files) : mFiles(files) { }
+
+	void operator()()
+	{
+		for (std::vector<std::string>::const_iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+		{
+			LLXMLNodePtr root;
+			if (LLXMLNode::parseFile(*iter, root, NULL))
+			{
+				gBenchmarkSink += (U32)root->mAttributes.size();
+			}
+		}
+	}
+
+	const std::vector<std::string>& mFiles;
+};
+
+struct LoadSettings
+{
+	LoadSettings(const std::vector<std::string>& files) : mFiles(files), mGroups(0) { }
+
+	void operator()()
+	{
+		// Each pass declares the controls anew, like the first load of the
+		// default settings at startup.
+		LLControlGroup group(llformat("xml_bench%u", mGroups++));
+		for (std::vector<std::string>::const_iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+		{
+			gBenchmarkSink += group.loadFromFile(*iter, true);
+		}
+	}
+
+	const std::vector<std::string>& mFiles;
+	U32 mGroups;
+};
+
+int main(int argc, char** argv)
+{
+	ll_benchmark_init();
+
+	std::vector<std::string> xui_files;
+	std::vector<std::string> settings_files;
+	for (S32 i = 1; i + 1 < argc; i += 2)
+	{
+		std::string arg = argv[i];
+		if (arg == "--xui")
+		{
+			xui_files.push_back(argv[i + 1]);
+		}
+		else if (arg == "--settings")
+		{
+			settings_files.push_back(argv[i + 1]);
+		}
+	}
+
+	std::vector<std::string> generated_files;
+	if (xui_files.empty() && settings_files.empty())
+	{
+		std::string xui_filename = std::string(LLFile::tmpdir()) + "xml_bench_floater.xml";
+		std::string settings_filename = std::string(LLFile::tmpdir()) + "xml_bench_settings.xml";
+		if (!write_text(xui_filename, make_xui()) || !write_text(settings_filename, make_settings()))
+		{
+			printf("Couldn't write the XML files to %s\n", LLFile::tmpdir());
+			return 1;
+		}
+		xui_files.push_back(xui_filename);
+		settings_files.push_back(settings_filename);
+		generated_files = xui_files;
+		generated_files.push_back(settings_filename);
+	}
+
+	F64 xui_bytes = 0.0;
+	F64 settings_bytes = 0.0;
+	for (std::vector<std::string>::const_iterator iter = xui_files.begin(); iter != xui_files.end(); ++iter)
+	{
+		llstat file_info;
+		if (LLFile::stat(*iter, &file_info))
+		{
+			printf("Couldn't read %s\n", iter->c_str());
+			return 1;
+		}
+		xui_bytes += file_info.st_size;
+	}
+	for (std::vector<std::string>::const_iterator iter = settings_files.begin(); iter != settings_files.end(); ++iter)
+	{
+		llstat file_info;
+		if (LLFile::stat(*iter, &file_info))
+		{
+			printf("Couldn't read %s\n", iter->c_str());
+			return 1;
+		}
+		settings_bytes += file_info.st_size;
+	}
+	printf("%u XUI files of %u KB, %u settings files of %u KB\n", (U32)xui_files.size(), (U32)(xui_bytes / 1024),
+		   (U32)settings_files.size(), (U32)(settings_bytes / 1024));
+
+	std::string cache_dir = std::string(LLFile::tmpdir()) + "xml_bench_cache";
+
+	// Compare the parsed trees with the compiled ones before timing.
+	U32 mismatches = 0;
+	for (std::vector<std::string>::const_iterator iter = xui_files.begin(); iter != xui_files.end(); ++iter)
+	{
+		LLXMLCompiledCache::disableCache();
+		LLXMLNodePtr parsed;
+		if (!LLXMLNode::parseFile(*iter, parsed, NULL))
+		{
+			continue;
+		}
+		LLXMLCompiledCache::initCache(cache_dir, true);
+		LLXMLCompiledCache::writeNode(*iter, parsed);
+		LLXMLNodePtr compiled;
+		if (!LLXMLCompiledCache::readNode(*iter, compiled) || tree_text(parsed) != tree_text(compiled))
+		{
+			printf("%s doesn't load the same from the cache\n", iter->c_str());
+			++mismatches;
+		}
+	}
+
+	LoadXUI load_xui(xui_files);
+	LoadSettings load_settings(settings_files);
+
+	LLXMLCompiledCache::disableCache();
+	F64 xui_parse_seconds = xui_files.empty() ? 0.0 : ll_benchmark("XUI, parsed", load_xui, xui_bytes);
+	F64 settings_parse_seconds = settings_files.empty() ? 0.0 : ll_benchmark("settings, parsed", load_settings, settings_bytes);
+
+	// The warm up pass of each benchmark writes the compiled files.
+	LLXMLCompiledCache::initCache(cache_dir, true);
+	if (!xui_files.empty())
+	{
+		F64 seconds = ll_benchmark("XUI, compiled cache", load_xui, xui_bytes);
+		printf("  %.2fx faster\n", xui_parse_seconds / seconds);
+	}
+	if (!settings_files.empty())
+	{
+		F64 seconds = ll_benchmark("settings, compiled cache", load_settings, settings_bytes);
+		printf("  %.2fx faster\n", settings_parse_seconds / seconds);
+	}
+	printf("%u hits, %u misses, %u KB written\n", LLXMLCompiledCache::getHits(), LLXMLCompiledCache::getMisses(),
+		   LLXMLCompiledCache::getBytesWritten() / 1024);
+
+	LLXMLCompiledCache::disableCache();
+	gDirUtilp->deleteFilesInDir(cache_dir, "*");
+	LLFile::rmdir(cache_dir);
+	for (std::vector<std::string>::const_iterator iter = generated_files.begin(); iter != generated_files.end(); ++iter)
+	{
+		LLFile::remove(*iter);
+	}
+	return mismatches ? 1 : 0;
+}